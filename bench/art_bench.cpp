@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include "art.h"
+#include "bench_data.h"
+
+namespace {
+    struct art_fixture_t {
+        art_tree tree;
+        std::vector<std::string> words;
+
+        explicit art_fixture_t(size_t num_words): words(bench_data::words(num_words)) {
+            art_tree_init(&tree);
+
+            for(size_t i = 0; i < words.size(); i++) {
+                art_document document(i, i, {0});
+                art_insert(&tree, (const unsigned char*) words[i].c_str(), words[i].size() + 1, &document);
+            }
+        }
+
+        ~art_fixture_t() {
+            art_tree_destroy(&tree);
+        }
+    };
+}
+
+// queries are words of the tree with their last letter replaced, so that a typo is needed to match them
+static void BM_ArtFuzzySearch(benchmark::State& state) {
+    static art_fixture_t fixture(100000);
+    const int max_cost = state.range(0);
+    const bool prefix = state.range(1);
+
+    std::vector<std::string> queries;
+    for(size_t i = 0; i < 100; i++) {
+        std::string query = fixture.words[i * 997 % fixture.words.size()];
+        query.back() = (query.back() == 'z') ? 'y' : 'z';
+        queries.push_back(prefix ? query.substr(0, 4) : query);
+    }
+
+    std::vector<art_leaf*> leaves;
+    size_t query_index = 0;
+
+    for(auto _: state) {
+        const std::string& query = queries[query_index++ % queries.size()];
+        leaves.clear();
+        art_fuzzy_search(&fixture.tree, (const unsigned char*) query.c_str(), query.size() + (prefix ? 0 : 1),
+                         0, max_cost, 10, FREQUENCY, prefix, nullptr, 0, leaves);
+        benchmark::DoNotOptimize(leaves.data());
+    }
+}
+
+BENCHMARK(BM_ArtFuzzySearch)->ArgNames({"cost", "prefix"})->ArgsProduct({{0, 1, 2}, {0, 1}});
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <sys/resource.h>
+#include <atomic>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "collection_manager.h"
+#include "store.h"
+#include "threadpool.h"
+#include "bench_data.h"
+
+/*
+    Collections of the benchmarks that index documents: a few standard schemas, seeded documents for them, and a
+    collection manager over an empty store.
+*/
+namespace bench_collection {
+    enum schema_t {
+        TEXT_SCHEMA,
+        FACET_SCHEMA,
+        GEO_SCHEMA,
+        INFIX_SCHEMA,
+        MIXED_SCHEMA
+    };
+
+    static constexpr const char* SCHEMA_NAMES[] = {"text", "facet", "geo", "infix", "mixed"};
+
+    inline std::vector<field> schema_fields(int64_t schema) {
+        std::vector<field> fields = {field("title", field_types::STRING, false)};
+
+        if(schema == TEXT_SCHEMA || schema == MIXED_SCHEMA) {
+            fields.emplace_back("description", field_types::STRING, false);
+            fields.emplace_back("points", field_types::INT32, false);
+        }
+
+        if(schema == FACET_SCHEMA || schema == MIXED_SCHEMA) {
+            fields.emplace_back("brand", field_types::STRING, true);
+            fields.emplace_back("tags", field_types::STRING_ARRAY, true);
+            fields.emplace_back("price", field_types::FLOAT, true);
+            fields.emplace_back("sizes", field_types::INT32_ARRAY, true);
+            fields.emplace_back("in_stock", field_types::BOOL, true);
+        }
+
+        if(schema == GEO_SCHEMA || schema == MIXED_SCHEMA) {
+            fields.emplace_back("location", field_types::GEOPOINT, false);
+            fields.emplace_back("created_at", field_types::INT64, false);
+        }
+
+        if(schema == INFIX_SCHEMA || schema == MIXED_SCHEMA) {
+            field sku("sku", field_types::STRING, false, false, true, "", -1, 1);
+            fields.push_back(sku);
+        }
+
+        return fields;
+    }
+
+    // documents with a value of the type of each field, the text of which is drawn from a common vocabulary with
+    // Zipfian frequencies, facet strings from just a few hundred values
+    inline std::vector<std::string> documents(const std::vector<field>& fields, size_t num_docs) {
+        const std::vector<std::string>& vocabulary = bench_data::words(20000);
+
+        std::vector<double> weights(vocabulary.size());
+        for(size_t i = 0; i < weights.size(); i++) {
+            weights[i] = 1.0 / double(i + 1);
+        }
+
+        std::mt19937 gen(bench_data::SEED);
+        std::discrete_distribution<size_t> word_dist(weights.begin(), weights.end());
+        std::uniform_int_distribution<size_t> facet_value_dist(0, 299);
+        std::uniform_int_distribution<int64_t> int_dist(0, 1000000);
+        std::uniform_real_distribution<double> float_dist(0, 1000);
+        std::uniform_real_distribution<double> lat_dist(-90, 90);
+        std::uniform_real_distribution<double> lng_dist(-180, 180);
+
+        auto text = [&](size_t num_words) {
+            std::string text;
+            for(size_t i = 0; i < num_words; i++) {
+                text += (i == 0 ? "" : " ") + vocabulary[word_dist(gen)];
+            }
+            return text;
+        };
+
+        std::vector<std::string> docs;
+        docs.reserve(num_docs);
+
+        for(size_t i = 0; i < num_docs; i++) {
+            nlohmann::json doc;
+            doc["id"] = std::to_string(i);
+
+            for(const auto& a_field: fields) {
+                if(a_field.type == field_types::STRING) {
+                    if(a_field.infix) {
+                        doc[a_field.name] = "SKU-" + std::to_string(int_dist(gen)) + "-" + vocabulary[word_dist(gen)];
+                    } else if(a_field.facet) {
+                        doc[a_field.name] = vocabulary[facet_value_dist(gen)];
+                    } else {
+                        doc[a_field.name] = text(a_field.name == "title" ? 8 : 40);
+                    }
+                } else if(a_field.type == field_types::STRING_ARRAY) {
+                    doc[a_field.name] = {vocabulary[facet_value_dist(gen)], vocabulary[facet_value_dist(gen)],
+                                         vocabulary[facet_value_dist(gen)]};
+                } else if(a_field.type == field_types::INT32 || a_field.type == field_types::INT64) {
+                    doc[a_field.name] = int_dist(gen);
+                } else if(a_field.type == field_types::INT32_ARRAY || a_field.type == field_types::INT64_ARRAY) {
+                    doc[a_field.name] = {int_dist(gen) % 50, int_dist(gen) % 50};
+                } else if(a_field.type == field_types::FLOAT) {
+                    doc[a_field.name] = float_dist(gen);
+                } else if(a_field.type == field_types::BOOL) {
+                    doc[a_field.name] = (int_dist(gen) % 2 == 0);
+                } else if(a_field.type == field_types::GEOPOINT) {
+                    doc[a_field.name] = {lat_dist(gen), lng_dist(gen)};
+                }
+            }
+
+            docs.push_back(doc.dump());
+        }
+
+        return docs;
+    }
+
+    // the collection manager over an empty store at `state_dir`, with a thread pool of `num_threads`
+    struct collection_env_t {
+        Store* store;
+        ThreadPool* thread_pool;
+        std::atomic<bool> quit{false};
+        CollectionManager& collection_manager = CollectionManager::get_instance();
+
+        collection_env_t(const std::string& state_dir, size_t num_threads) {
+            system(("rm -rf " + state_dir + " && mkdir -p " + state_dir).c_str());
+            store = new Store(state_dir);
+            thread_pool = new ThreadPool(num_threads);
+            collection_manager.init(store, thread_pool, 1.0, "auth_key", quit, nullptr);
+            collection_manager.load(8, 1000);
+        }
+
+        ~collection_env_t() {
+            collection_manager.dispose();
+            thread_pool->shutdown();
+            delete thread_pool;
+            delete store;
+        }
+
+        // a new collection named `bench`, in place of the last one
+        Collection* create_collection(const std::vector<field>& fields) {
+            collection_manager.drop_collection("bench");
+            return collection_manager.create_collection("bench", 1, fields).get();
+        }
+    };
+
+    inline double peak_rss_mb() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / (1024.0 * 1024);
+#else
+        return usage.ru_maxrss / 1024.0;
+#endif
+    }
+}
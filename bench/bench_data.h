@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+    Datasets of the microbenchmarks. They are generated from fixed seeds, so that every run (and every build that
+    is compared) measures the same data, and kept free of test resources so that the suite runs anywhere.
+*/
+namespace bench_data {
+    static constexpr uint32_t SEED = 42;
+
+    // `num_ids` distinct ids out of [0, universe), sorted
+    inline std::vector<uint32_t> sorted_ids(size_t num_ids, uint32_t universe, uint32_t seed = SEED) {
+        std::mt19937 gen(seed);
+        std::vector<uint32_t> ids;
+
+        if(num_ids * 2 >= universe) {
+            // dense: keep each id with the probability of the density
+            std::bernoulli_distribution keep(double(num_ids) / universe);
+            for(uint32_t id = 0; id < universe && ids.size() < num_ids; id++) {
+                if(keep(gen)) {
+                    ids.push_back(id);
+                }
+            }
+
+            return ids;
+        }
+
+        std::uniform_int_distribution<uint32_t> dist(0, universe - 1);
+        while(ids.size() < num_ids) {
+            ids.push_back(dist(gen));
+            if(ids.size() == num_ids) {
+                std::sort(ids.begin(), ids.end());
+                ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+            }
+        }
+
+        return ids;
+    }
+
+    // `num_words` distinct lower case words of 3 to 12 letters, built from syllables so that they share prefixes
+    // the way the words of a language do
+    inline std::vector<std::string> words(size_t num_words, uint32_t seed = SEED) {
+        static const std::vector<std::string> syllables = {
+            "a", "an", "ar", "be", "ca", "co", "de", "di", "e", "en", "er", "es", "fo", "ga", "i", "in", "is",
+            "ka", "la", "le", "li", "lo", "ma", "me", "mi", "mo", "na", "ne", "o", "on", "or", "pa", "pe", "po",
+            "ra", "re", "ri", "ro", "sa", "se", "si", "so", "ta", "te", "ti", "to", "u", "un", "ur", "va", "ve"
+        };
+
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<size_t> syllable_dist(0, syllables.size() - 1);
+        std::uniform_int_distribution<size_t> num_syllables_dist(2, 5);
+
+        std::vector<std::string> words;
+        std::vector<std::string> seen;
+
+        while(words.size() < num_words) {
+            std::string word;
+            const size_t num_syllables = num_syllables_dist(gen);
+            for(size_t i = 0; i < num_syllables; i++) {
+                word += syllables[syllable_dist(gen)];
+            }
+
+            if(word.size() < 3 || word.size() > 12) {
+                continue;
+            }
+
+            words.push_back(std::move(word));
+
+            if(words.size() == num_words) {
+                std::vector<std::string> sorted_words = words;
+                std::sort(sorted_words.begin(), sorted_words.end());
+                sorted_words.erase(std::unique(sorted_words.begin(), sorted_words.end()), sorted_words.end());
+
+                if(sorted_words.size() != num_words) {
+                    // drop the repeats and draw more
+                    std::shuffle(sorted_words.begin(), sorted_words.end(), gen);
+                    words = std::move(sorted_words);
+                }
+            }
+        }
+
+        return words;
+    }
+
+    // text of `num_words` words drawn from `vocabulary` with Zipfian frequencies, as in natural text
+    inline std::string text(const std::vector<std::string>& vocabulary, size_t num_words, uint32_t seed = SEED) {
+        std::vector<double> weights(vocabulary.size());
+        for(size_t i = 0; i < weights.size(); i++) {
+            weights[i] = 1.0 / double(i + 1);
+        }
+
+        std::mt19937 gen(seed);
+        std::discrete_distribution<size_t> word_dist(weights.begin(), weights.end());
+
+        std::string text;
+        for(size_t i = 0; i < num_words; i++) {
+            if(i != 0) {
+                text += (i % 12 == 0) ? ". " : " ";
+            }
+
+            text += vocabulary[word_dist(gen)];
+        }
+
+        return text;
+    }
+
+    // `num_values` values out of [min, max]
+    inline std::vector<int64_t> values(size_t num_values, int64_t min, int64_t max, uint32_t seed = SEED) {
+        std::mt19937_64 gen(seed);
+        std::uniform_int_distribution<int64_t> dist(min, max);
+
+        std::vector<int64_t> values(num_values);
+        for(auto& value: values) {
+            value = dist(gen);
+        }
+
+        return values;
+    }
+}
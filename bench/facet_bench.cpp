@@ -0,0 +1,29 @@
+#include <benchmark/benchmark.h>
+#include "facet_column.h"
+#include "bench_data.h"
+
+// counts the values of a facet with `range(0)` distinct values over a result set of a tenth of the documents
+static void BM_FacetColumnCount(benchmark::State& state) {
+    const size_t num_docs = 1000000;
+    const size_t num_values = state.range(0);
+
+    facet_column_t column;
+    const std::vector<int64_t>& doc_values = bench_data::values(num_docs, 0, num_values - 1);
+    for(size_t seq_id = 0; seq_id < num_docs; seq_id++) {
+        column.set(seq_id, doc_values[seq_id] * 7919 + 1);
+    }
+
+    const std::vector<uint32_t>& result_ids = bench_data::sorted_ids(num_docs / 10, num_docs);
+    std::vector<uint32_t> counts(column.num_values());
+    std::vector<uint32_t> last_ids(column.num_values());
+
+    for(auto _: state) {
+        std::fill(counts.begin(), counts.end(), 0);
+        column.count(result_ids.data(), result_ids.size(), counts.data(), last_ids.data());
+        benchmark::DoNotOptimize(counts.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * result_ids.size());
+}
+
+BENCHMARK(BM_FacetColumnCount)->Arg(10)->Arg(1000)->Arg(100000);
@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include "bench_collection.h"
+
+/*
+    Indexing throughput of synthetic documents for a schema picked by the first argument, imported in batches of
+    the second argument's size with a thread pool of the third argument's size.
+
+    `items_per_second` is the number of documents indexed a second. The stage benchmark drives the phases of
+    `Collection::batch_index_in_memory()` one by one, and reports the seconds that each one took per iteration.
+    `peak_rss_mb` is the peak resident memory of the process so far, and `index_mb` the estimated heap held by the
+    index once all documents are in.
+*/
+
+using namespace bench_collection;
+
+namespace {
+    const std::string BENCH_STATE_DIR = "/tmp/typesense_bench/indexing";
+    const size_t NUM_DOCS = 20000;
+
+    void set_memory_counters(benchmark::State& state, Collection* collection) {
+        state.counters["peak_rss_mb"] = peak_rss_mb();
+        state.counters["index_mb"] = collection->get_memory_stats()["total_bytes"].get<size_t>() / (1024.0 * 1024);
+    }
+
+    void add_indexing_args(benchmark::internal::Benchmark* bench) {
+        bench->ArgNames({"schema", "batch", "threads"});
+
+        for(int64_t schema = TEXT_SCHEMA; schema <= MIXED_SCHEMA; schema++) {
+            bench->Args({schema, 1000, 4});
+        }
+
+        for(int64_t batch_size: {40, 200, 5000}) {
+            bench->Args({MIXED_SCHEMA, batch_size, 4});
+        }
+
+        for(int64_t num_threads: {1, 2, 8}) {
+            bench->Args({MIXED_SCHEMA, 1000, num_threads});
+        }
+
+        bench->Unit(benchmark::kMillisecond);
+    }
+}
+
+// imports all the documents into a new collection, `batch` lines to a call of `add_many()` as the batched
+// indexer would, including the writes to the store
+static void BM_IndexingAddMany(benchmark::State& state) {
+    const int64_t schema = state.range(0);
+    const size_t batch_size = state.range(1);
+    const std::vector<field>& fields = schema_fields(schema);
+    const std::vector<std::string>& docs = documents(fields, NUM_DOCS);
+
+    collection_env_t env(BENCH_STATE_DIR, state.range(2));
+    Collection* collection = nullptr;
+
+    for(auto _: state) {
+        state.PauseTiming();
+        collection = env.create_collection(fields);
+
+        std::vector<std::vector<std::string>> batches;
+        for(size_t start = 0; start < docs.size(); start += batch_size) {
+            batches.emplace_back(docs.begin() + start, docs.begin() + std::min(start + batch_size, docs.size()));
+        }
+
+        state.ResumeTiming();
+
+        for(auto& batch: batches) {
+            nlohmann::json document;
+            nlohmann::json summary = collection->add_many(batch, document, UPSERT);
+
+            if(!summary["success"].get<bool>()) {
+                state.SkipWithError("Could not import the documents.");
+                break;
+            }
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * docs.size());
+    state.SetLabel(SCHEMA_NAMES[schema]);
+    set_memory_counters(state, collection);
+}
+
+BENCHMARK(BM_IndexingAddMany)->Apply(add_indexing_args);
+
+// times the parsing, the preprocessing (tokenization) and the indexing of the batches in memory, apart
+static void BM_IndexingStages(benchmark::State& state) {
+    typedef std::chrono::steady_clock clock;
+
+    const int64_t schema = state.range(0);
+    const size_t batch_size = state.range(1);
+    const std::vector<field>& fields = schema_fields(schema);
+    const std::vector<std::string>& docs = documents(fields, NUM_DOCS);
+
+    collection_env_t env(BENCH_STATE_DIR, state.range(2));
+    Collection* collection = nullptr;
+
+    double parse_s = 0, preprocess_s = 0, index_s = 0;
+
+    auto seconds_since = [](clock::time_point& begin) {
+        const clock::time_point end = clock::now();
+        const double seconds = std::chrono::duration<double>(end - begin).count();
+        begin = end;
+        return seconds;
+    };
+
+    for(auto _: state) {
+        state.PauseTiming();
+        collection = env.create_collection(fields);
+        state.ResumeTiming();
+
+        for(size_t start = 0; start < docs.size(); start += batch_size) {
+            const size_t end = std::min(start + batch_size, docs.size());
+            clock::time_point begin = clock::now();
+
+            std::vector<index_record> index_records;
+            index_records.reserve(end - start);
+
+            for(size_t i = start; i < end; i++) {
+                nlohmann::json document;
+                auto doc_seq_id_op = collection->to_doc(docs[i], document, CREATE, DIRTY_VALUES::COERCE_OR_REJECT);
+                index_records.emplace_back(i - start, doc_seq_id_op.get().seq_id, std::move(document), CREATE,
+                                           DIRTY_VALUES::COERCE_OR_REJECT);
+            }
+
+            parse_s += seconds_since(begin);
+
+            collection->batch_preprocess_in_memory(index_records);
+            preprocess_s += seconds_since(begin);
+
+            collection->batch_index_preprocessed_in_memory(index_records);
+            index_s += seconds_since(begin);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * docs.size());
+    state.SetLabel(SCHEMA_NAMES[schema]);
+    state.counters["parse_s"] = benchmark::Counter(parse_s, benchmark::Counter::kAvgIterations);
+    state.counters["preprocess_s"] = benchmark::Counter(preprocess_s, benchmark::Counter::kAvgIterations);
+    state.counters["index_s"] = benchmark::Counter(index_s, benchmark::Counter::kAvgIterations);
+    set_memory_counters(state, collection);
+}
+
+BENCHMARK(BM_IndexingStages)->Apply(add_indexing_args);
@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include "system_metrics.h"
+#include "bench_collection.h"
+
+/*
+    Memory held by the index for each document of the standard datasets, per structure, as estimated by
+    `Collection::get_memory_stats()`: `<structure>_bytes_per_doc` for each structure that holds any, along with
+    `total_bytes_per_doc`, and `allocated_bytes_per_doc` for what the allocator handed out while the documents were
+    loaded (the memtables of the store included) to keep the estimates honest. The tokens of a field and their
+    posting lists are both held by its `search_index`.
+
+    For tracking regressions from one release to another, the counters can be had as JSON with:
+
+        typesense-bench --benchmark_filter=BM_IndexMemoryFootprint --benchmark_format=json
+*/
+
+using namespace bench_collection;
+
+namespace {
+    const std::string BENCH_STATE_DIR = "/tmp/typesense_bench/memory";
+    const size_t NUM_DOCS = 100000;
+    const size_t BATCH_SIZE = 1000;
+}
+
+static void BM_IndexMemoryFootprint(benchmark::State& state) {
+    const int64_t schema = state.range(0);
+    const std::vector<field>& fields = schema_fields(schema);
+    const std::vector<std::string>& docs = documents(fields, NUM_DOCS);
+
+    collection_env_t env(BENCH_STATE_DIR, 4);
+    nlohmann::json memory_stats;
+    uint64_t allocated_bytes = 0;
+
+    for(auto _: state) {
+        Collection* collection = env.create_collection(fields);
+
+        uint64_t allocated_before, allocated_after, active, resident;
+        SystemMetrics::get_allocator_bytes(allocated_before, active, resident);
+
+        for(size_t start = 0; start < docs.size(); start += BATCH_SIZE) {
+            std::vector<std::string> batch(docs.begin() + start,
+                                           docs.begin() + std::min(start + BATCH_SIZE, docs.size()));
+            nlohmann::json document;
+            collection->add_many(batch, document, UPSERT);
+        }
+
+        SystemMetrics::get_allocator_bytes(allocated_after, active, resident);
+        allocated_bytes = (allocated_after > allocated_before) ? (allocated_after - allocated_before) : 0;
+
+        memory_stats = collection->get_memory_stats();
+    }
+
+    const size_t num_docs = docs.size();
+
+    for(const auto& structure: memory_stats["structures"].items()) {
+        state.counters[structure.key() + "_bytes_per_doc"] = double(structure.value().get<size_t>()) / num_docs;
+    }
+
+    state.counters["total_bytes_per_doc"] = double(memory_stats["total_bytes"].get<size_t>()) / num_docs;
+    state.counters["allocated_bytes_per_doc"] = double(allocated_bytes) / num_docs;
+    state.counters["num_docs"] = num_docs;
+    state.SetLabel(SCHEMA_NAMES[schema]);
+}
+
+BENCHMARK(BM_IndexMemoryFootprint)->ArgName("schema")->DenseRange(TEXT_SCHEMA, MIXED_SCHEMA)
+                                  ->Iterations(1)->Unit(benchmark::kMillisecond);
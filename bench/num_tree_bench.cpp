@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+#include "num_tree.h"
+#include "bench_data.h"
+
+// ranges that span `range(0)` per mille of the values
+static void BM_NumTreeRangeSearch(benchmark::State& state) {
+    const size_t num_docs = 1000000;
+    const int64_t max_value = 1000000;
+
+    static num_tree_t* tree = nullptr;
+    if(tree == nullptr) {
+        tree = new num_tree_t();
+        const std::vector<int64_t>& values = bench_data::values(num_docs, 0, max_value);
+        for(size_t seq_id = 0; seq_id < values.size(); seq_id++) {
+            tree->insert(values[seq_id], seq_id);
+        }
+    }
+
+    const int64_t range_width = max_value * state.range(0) / 1000;
+    const std::vector<int64_t>& starts = bench_data::values(100, 0, max_value - range_width);
+    size_t start_index = 0;
+    size_t num_results = 0;
+
+    for(auto _: state) {
+        const int64_t start = starts[start_index++ % starts.size()];
+        uint32_t* ids = nullptr;
+        size_t ids_len = 0;
+        tree->range_inclusive_search(start, start + range_width, &ids, ids_len);
+        num_results += ids_len;
+        delete [] ids;
+    }
+
+    state.SetItemsProcessed(num_results);
+}
+
+BENCHMARK(BM_NumTreeRangeSearch)->Arg(1)->Arg(10)->Arg(100);
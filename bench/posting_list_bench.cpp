@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+#include "posting_list.h"
+#include "bench_data.h"
+
+static void fill(posting_list_t& list, const std::vector<uint32_t>& ids) {
+    for(uint32_t id: ids) {
+        list.upsert(id, {0, 3});
+    }
+}
+
+static void BM_PostingListUpsert(benchmark::State& state) {
+    const std::vector<uint32_t>& ids = bench_data::sorted_ids(state.range(0), state.range(0) * 4);
+
+    for(auto _: state) {
+        posting_list_t list(256);
+        fill(list, ids);
+        benchmark::DoNotOptimize(list.num_ids());
+    }
+
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+BENCHMARK(BM_PostingListUpsert)->Arg(1000)->Arg(100000);
+
+static void BM_PostingListIterate(benchmark::State& state) {
+    const std::vector<uint32_t>& ids = bench_data::sorted_ids(state.range(0), state.range(0) * 4);
+    posting_list_t list(256);
+    fill(list, ids);
+
+    for(auto _: state) {
+        uint64_t sum = 0;
+        for(auto it = list.new_iterator(); it.valid(); it.next()) {
+            sum += it.id();
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+BENCHMARK(BM_PostingListIterate)->Arg(1000)->Arg(100000)->Arg(1000000);
+
+// a short list against a long one, and two long ones
+static void BM_PostingListIntersect(benchmark::State& state) {
+    const uint32_t universe = 1000000;
+    posting_list_t list1(256);
+    posting_list_t list2(256);
+    fill(list1, bench_data::sorted_ids(state.range(0), universe, bench_data::SEED));
+    fill(list2, bench_data::sorted_ids(state.range(1), universe, bench_data::SEED + 1));
+
+    std::vector<posting_list_t*> lists = {&list1, &list2};
+    std::vector<uint32_t> result_ids;
+
+    for(auto _: state) {
+        result_ids.clear();
+        posting_list_t::intersect(lists, result_ids);
+        benchmark::DoNotOptimize(result_ids.data());
+    }
+
+    state.counters["results"] = result_ids.size();
+}
+
+BENCHMARK(BM_PostingListIntersect)->Args({1000, 500000})->Args({100000, 500000})->Args({500000, 500000});
@@ -0,0 +1,42 @@
+#include <benchmark/benchmark.h>
+#include "sorted_array.h"
+#include "bench_data.h"
+
+static void BM_SortedArrayDecode(benchmark::State& state) {
+    const std::vector<uint32_t>& ids = bench_data::sorted_ids(state.range(0), state.range(0) * 8);
+    sorted_array arr;
+    arr.load(ids.data(), ids.size());
+
+    for(auto _: state) {
+        uint32_t* values = arr.uncompress();
+        benchmark::DoNotOptimize(values);
+        delete [] values;
+    }
+
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+BENCHMARK(BM_SortedArrayDecode)->Arg(256)->Arg(10000)->Arg(1000000);
+
+// looks up 1 in 10 of the values
+static void BM_SortedArrayIndexOf(benchmark::State& state) {
+    const std::vector<uint32_t>& ids = bench_data::sorted_ids(state.range(0), state.range(0) * 8);
+    sorted_array arr;
+    arr.load(ids.data(), ids.size());
+
+    std::vector<uint32_t> lookups;
+    for(size_t i = 0; i < ids.size(); i += 10) {
+        lookups.push_back(ids[i]);
+    }
+
+    std::vector<uint32_t> indices(lookups.size());
+
+    for(auto _: state) {
+        arr.indexOf(lookups.data(), lookups.size(), indices.data());
+        benchmark::DoNotOptimize(indices.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+
+BENCHMARK(BM_SortedArrayIndexOf)->Arg(10000)->Arg(1000000);
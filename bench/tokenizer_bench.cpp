@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+#include "tokenizer.h"
+#include "bench_data.h"
+
+static void BM_TokenizerThroughput(benchmark::State& state) {
+    const bool normalize = state.range(0);
+    const std::string& text = bench_data::text(bench_data::words(10000), 10000);
+    std::vector<std::string> tokens;
+
+    for(auto _: state) {
+        tokens.clear();
+        Tokenizer(text, normalize, false).tokenize(tokens);
+        benchmark::DoNotOptimize(tokens.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+BENCHMARK(BM_TokenizerThroughput)->ArgName("normalize")->Arg(0)->Arg(1);
+
+// a locale other than the default goes through the ICU word break iterator
+static void BM_TokenizerLocaleThroughput(benchmark::State& state) {
+    const std::string& text = bench_data::text(bench_data::words(10000), 10000);
+    std::vector<std::string> tokens;
+
+    for(auto _: state) {
+        tokens.clear();
+        Tokenizer(text, true, false, "fr").tokenize(tokens);
+        benchmark::DoNotOptimize(tokens.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+BENCHMARK(BM_TokenizerLocaleThroughput);
@@ -0,0 +1,28 @@
+#include <benchmark/benchmark.h>
+#include "topster.h"
+#include "bench_data.h"
+
+// adds 100K candidates with random scores, of which the keys repeat at a rate of 1 in 10
+static void BM_TopsterAdd(benchmark::State& state) {
+    const size_t capacity = state.range(0);
+    const size_t num_kvs = 100000;
+    const std::vector<int64_t>& scores = bench_data::values(num_kvs, 0, 1000000);
+    const std::vector<int64_t>& keys = bench_data::values(num_kvs, 0, num_kvs * 9 / 10);
+
+    for(auto _: state) {
+        Topster topster(capacity);
+
+        for(size_t i = 0; i < num_kvs; i++) {
+            int64_t kv_scores[3] = {scores[i], int64_t(i), 0};
+            KV kv(0, 0, 0, keys[i], keys[i], 0, kv_scores);
+            topster.add(&kv);
+        }
+
+        topster.sort();
+        benchmark::DoNotOptimize(topster.size);
+    }
+
+    state.SetItemsProcessed(state.iterations() * num_kvs);
+}
+
+BENCHMARK(BM_TopsterAdd)->Arg(10)->Arg(250)->Arg(1000);
@@ -1,5 +1,8 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
 #include "sparsepp.h"
 
 struct adi_node_t;
@@ -11,6 +14,12 @@ private:
     spp::sparse_hash_map<uint32_t, std::string> id_keys;
     adi_node_t* root = nullptr;
 
+    // id => rank, laid out by id (0 for ids without a key), so that a rank is a single load instead of a walk
+    // down the tree. Materialized lazily by `materialize_ranks()` and stale again after any write.
+    std::vector<uint32_t> ranks;
+    std::atomic<bool> ranks_fresh{false};
+    std::mutex ranks_mutex;
+
     static void add_node(adi_node_t* node, const std::string& key, size_t key_index);
 
     static bool rank_aggregate(adi_node_t* node, const std::string& key, size_t key_index, size_t& rank);
@@ -20,6 +29,9 @@ private:
 
     void remove_node(adi_node_t* node, const std::string& key, const size_t key_index);
 
+    // the order of keys in the tree: chars compare as `char`, with the end of a key sorting as '\0'
+    static bool key_less(const std::string& a, const std::string& b);
+
 public:
     static constexpr size_t NOT_FOUND = INT64_MAX;
 
@@ -31,7 +43,19 @@ public:
 
     size_t rank(uint32_t id);
 
+    // Builds the rank array when it is stale and a sort is about to look up at least 1/RANKS_REBUILD_RATIO of the
+    // keys (a rebuild sorts all of them). Materialized ranks equal the ranks computed from the tree, so searches
+    // running alongside a rebuild see the same values either way.
+    void materialize_ranks(size_t num_lookups);
+
+    [[nodiscard]] bool has_materialized_ranks() const;
+
+    static constexpr size_t RANKS_REBUILD_RATIO = 8;
+
     void remove(uint32_t id);
 
     const adi_node_t* get_root();
+
+    // heap memory held by the keys, the tree and the materialized ranks
+    size_t memory_bytes();
 };
@@ -4,7 +4,11 @@
 #include "json.hpp"
 #include "logger.h"
 #include "config.h"
+#include "latency_histogram.h"
+#include "openmetrics.h"
 #include <string>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <fstream>
 
@@ -20,6 +24,30 @@ private:
     spp::sparse_hash_map<std::string, uint64_t>* current_counts;
     spp::sparse_hash_map<std::string, uint64_t>* current_durations;
 
+    // since startup, unlike the windows
+    struct latency_totals_t {
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+    };
+
+    // Latencies of the current window are recorded by each thread into a shard of its own, whose mutex is
+    // contended only by the window reset, which merges the shards into the histograms of the last window, and by
+    // scrapes of the totals.
+    struct latency_shard_t {
+        std::mutex mutex;
+        spp::sparse_hash_map<std::string, latency_histogram_t> histograms;
+        spp::sparse_hash_map<std::string, latency_totals_t> totals;
+    };
+
+    mutable std::mutex latency_shards_mutex;
+    std::vector<std::shared_ptr<latency_shard_t>> latency_shards;
+
+    // totals of the shards of threads that have exited
+    spp::sparse_hash_map<std::string, latency_totals_t> retired_latency_totals;
+
+    // stores last complete window
+    spp::sparse_hash_map<std::string, latency_histogram_t>* latency_histograms;
+
     std::string access_log_path;
     std::ofstream access_log;
 
@@ -30,6 +58,8 @@ private:
         current_durations = new spp::sparse_hash_map<std::string, uint64_t>();
         durations = new spp::sparse_hash_map<std::string, uint64_t>();
 
+        latency_histograms = new spp::sparse_hash_map<std::string, latency_histogram_t>();
+
         access_log_path = Config::get_instance().get_access_log_path();
         if(Config::get_instance().get_enable_access_logging() && !access_log_path.empty()) {
             access_log.open(access_log_path, std::ofstream::out | std::ofstream::app);
@@ -42,13 +72,18 @@ private:
 
         delete current_durations;
         delete durations;
+
+        delete latency_histograms;
     }
 
+    latency_shard_t* get_latency_shard();
+
 public:
     static inline const std::string SEARCH_LABEL = "search";
     static inline const std::string DOC_WRITE_LABEL = "write";
     static inline const std::string IMPORT_LABEL = "import";
     static inline const std::string DOC_DELETE_LABEL = "delete";
+    static inline const std::string SEARCH_SHED_LABEL = "search_shed";
 
     static const uint64_t METRICS_REFRESH_INTERVAL_MS = 10 * 1000;
 
@@ -72,6 +107,9 @@ public:
 
     void increment_write_metrics(uint64_t route_hash, uint64_t duration);
 
+    // `identifier` is a route, or a label such as `SEARCH_LABEL`; `duration_us` is in microseconds
+    void record_latency(const std::string& identifier, uint64_t duration_us);
+
     void write_access_log(const uint64_t epoch_millis, const char* remote_ip, const std::string& path);
 
     void flush_access_log();
@@ -79,4 +117,7 @@ public:
     void window_reset();
 
     void get(const std::string& rps_key, const std::string& latency_key, nlohmann::json &result) const;
+
+    // request counts and latencies by route, and search latencies by collection
+    void get_openmetrics(openmetrics_writer_t& writer) const;
 };
\ No newline at end of file
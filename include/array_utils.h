@@ -16,4 +16,13 @@ public:
 
   static size_t exclude_scalar(const uint32_t *src, const size_t lenSrc, const uint32_t *filter, const size_t lenFilter,
                               uint32_t **out);
+
+  // Intersects two sorted, duplicate-free arrays and writes the *positions* of the common elements in A and B
+  // into `posA` and `posB` (each must hold at least min(lenA, lenB) elements). Returns the number of common elements.
+  // Picks an AVX2 / SSE2 (NEON via sse2neon) kernel at runtime and falls back to a scalar loop otherwise.
+  static size_t and_positions(const uint32_t *A, const size_t lenA, const uint32_t *B, const size_t lenB,
+                              uint32_t *posA, uint32_t *posB);
+
+  static size_t and_positions_scalar(const uint32_t *A, const size_t lenA, const uint32_t *B, const size_t lenB,
+                                     uint32_t *posA, uint32_t *posB);
 };
\ No newline at end of file
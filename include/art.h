@@ -96,14 +96,17 @@ typedef struct {
 /**
  * Represents a leaf. These are
  * of arbitrary size, as they include the key.
+ * The key immediately follows `key_len`, without the padding that `sizeof(art_leaf)` would add.
  */
 typedef struct {
-    uint32_t key_len;
     int64_t max_score;
     void* values;
+    uint32_t key_len;
     unsigned char key[];
 } art_leaf;
 
+typedef int(*art_leaf_callback)(void *data, const art_leaf *leaf);
+
 struct token_leaf {
     art_leaf* leaf;
     bool is_prefix;
@@ -122,8 +125,20 @@ struct token_leaf {
 typedef struct {
     art_node *root;
     uint64_t size;
+    // incremented on every write to the tree, so that cached lookups can be invalidated
+    uint64_t version;
 } art_tree;
 
+/**
+ * Memory held by the nodes and leaves of a tree (excluding the posting lists of the leaves).
+ */
+typedef struct {
+    uint64_t num_nodes;
+    uint64_t num_leaves;
+    uint64_t node_bytes;
+    uint64_t leaf_bytes;
+} art_tree_stats;
+
 /*
  * Represents a document to be indexed.
  * `offsets` refer to the index locations where a token appeared in the document
@@ -131,10 +146,10 @@ typedef struct {
 struct art_document {
     const uint32_t id;
     const int64_t score;
-    const std::vector<uint32_t> offsets;
+    std::vector<uint32_t> offsets;
 
-    art_document(const uint32_t id, const int64_t score, const std::vector<uint32_t>& offsets):
-            id(id), score(score), offsets(offsets) {
+    art_document(const uint32_t id, const int64_t score, std::vector<uint32_t> offsets):
+            id(id), score(score), offsets(std::move(offsets)) {
 
     }
 };
@@ -194,6 +209,13 @@ inline uint64_t art_size(art_tree *t) {
 }
 #endif
 
+/**
+ * Walks the tree to collect the number and size of its nodes and leaves.
+ * @arg t The tree
+ * @arg stats Counts of the tree are added to these
+ */
+void art_tree_get_stats(const art_tree *t, art_tree_stats *stats);
+
 /**
  * Inserts a new value into the ART tree
  * @arg t The tree
@@ -253,6 +275,11 @@ art_leaf* art_maximum(art_tree *t);
  */
 int art_iter(art_tree *t, art_callback cb, void *data);
 
+/**
+ * Same as `art_iter()`, but the callback gets the leaf itself, in key order.
+ */
+int art_iter_leaves(art_tree *t, art_leaf_callback cb, void *data);
+
 /**
  * Iterates through the entries pairs in the map,
  * invoking a callback for each that matches a given prefix.
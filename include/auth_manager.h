@@ -7,6 +7,7 @@
 #include <shared_mutex>
 #include <tsl/htrie_map.h>
 #include "json.hpp"
+#include "lru/lru.hpp"
 #include "option.h"
 #include "store.h"
 
@@ -87,12 +88,23 @@ struct collection_key_t {
     }
 };
 
+// an authentication that was granted, and the embedded params of the scoped key that it was granted to
+struct auth_cache_entry_t {
+    nlohmann::json embedded_params;
+    uint64_t expires_at = api_key_t::FAR_FUTURE_TIMESTAMP;
+};
+
 class AuthManager {
 
 private:
 
     mutable std::shared_mutex mutex;
 
+    // (action, collection, key) => granted authentication, since almost every request presents one of a few keys,
+    // whose checks (HMAC of a scoped key, regexes of collections) would otherwise be repeated on each of them
+    mutable std::mutex auth_cache_mutex;
+    mutable LRU::Cache<std::string, auth_cache_entry_t> auth_cache;
+
     tsl::htrie_map<char, api_key_t> api_keys;  // stores key_value => key mapping
     Store *store;
 
@@ -112,7 +124,7 @@ private:
     static std::string fmt_error(std::string&& error, const std::string& key);
 
     Option<bool> authenticate_parse_params(const collection_key_t& scoped_api_key, const std::string& action,
-                                           nlohmann::json& embedded_params) const ;
+                                           nlohmann::json& embedded_params, uint64_t& expires_at) const ;
 
     bool auth_against_key(const std::string& req_collection, const std::string& action,
                           const api_key_t &api_key, const bool search_only) const;
@@ -124,7 +136,11 @@ public:
     static const size_t GENERATED_KEY_LEN = 32;
     static const size_t HMAC_BASE64_LEN = 44;
 
-    AuthManager() = default;
+    static constexpr size_t AUTH_CACHE_CAPACITY = 4096;
+
+    AuthManager(): auth_cache(AUTH_CACHE_CAPACITY) {
+
+    }
 
     Option<bool> init(Store* store, const std::string& bootstrap_auth_key);
 
@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <deque>
+#include <map>
 #include "store.h"
 #include "http_data.h"
 #include "threadpool.h"
@@ -37,6 +38,27 @@ private:
         std::condition_variable cv;
     };
 
+    struct queued_req_t {
+        uint64_t req_id;
+        std::string coll_name;
+        uint64_t epoch;
+
+        // set for single document adds, which are applied along with adds of the same key queued right behind them
+        std::string add_batch_key;
+
+        uint64_t queued_ns;     // since the epoch, for the trace of the request
+    };
+
+    // Writes to a collection keep their log order through epochs. A write that can touch any document of the
+    // collection gets an epoch of its own, while consecutive writes to single document ids share one: they go to
+    // queues picked by their id and run concurrently. A write starts only once every write of an earlier epoch of
+    // its collection is done.
+    struct coll_epochs_t {
+        uint64_t last_epoch = 0;
+        bool last_is_collection_write = false;
+        std::map<uint64_t, size_t> num_pending;     // epoch => queued writes that are not done yet
+    };
+
     HttpServer* server;
     Store* store;
     Store* meta_store;
@@ -44,7 +66,11 @@ private:
     const size_t num_threads;
 
     await_t* qmutuxes;
-    std::vector<std::deque<uint64_t>> queues;
+    std::vector<std::deque<queued_req_t>> queues;
+
+    std::mutex epochs_mutex;
+    std::condition_variable epochs_cv;
+    std::unordered_map<std::string, coll_epochs_t> coll_epochs;
 
     /* Variables to be serialized on snapshot                  /
     --------------------------------------------------------- */
@@ -67,11 +93,34 @@ private:
     rocksdb::Iterator* skip_index_iter = nullptr;
     static constexpr const char* SKIP_INDICES_PREFIX = "$XP";
 
+    // most single document adds applied as one batch
+    static const size_t MAX_COALESCED_ADDS = 100;
+
     static const size_t GC_INTERVAL_SECONDS = 60;
     static const size_t GC_PRUNE_MAX_SECONDS = 3600;
 
     static std::string get_req_prefix_key(uint64_t req_id);
 
+    // id of the only document that the request writes to, or empty when it can write to any of its collection
+    std::string get_doc_id(const std::shared_ptr<http_req>& req);
+
+    // collection and parameters of a single document add made of one chunk, or empty for other requests
+    std::string get_add_batch_key(const std::shared_ptr<http_req>& req, bool is_single_chunk);
+
+    void queue_req(uint64_t req_id, const std::string& coll_name, const std::string& doc_id,
+                   const std::string& add_batch_key);
+
+    // applies queued single document adds, which are consecutive writes to their collection, as one batch
+    void index_coalesced_adds(const std::vector<queued_req_t>& queued_reqs);
+
+    // blocks until all writes of earlier epochs of the request's collection are done, or the indexer quits
+    bool await_epoch(const queued_req_t& queued_req);
+
+    void finish_epoch(const queued_req_t& queued_req);
+
+    // records the time that a traced request waited in the queue as a span of its trace
+    static void trace_queue_wait(const queued_req_t& queued_req, const http_req& req);
+
 public:
 
     static const constexpr char* RAFT_REQ_LOG_PREFIX = "$RL_";
@@ -84,6 +133,11 @@ public:
 
     int64_t get_queued_writes();
 
+    // requests queued for indexing (or being indexed), by collection
+    void get_queued_writes_by_collection(std::map<std::string, size_t>& coll_queued_writes);
+
+    Store* get_meta_store() const;
+
     void run();
 
     void stop();
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ *  Bloom filter of the pairs of tokens that follow one another in the values of a string field, so that splitting a
+ *  query token into two adjacent tokens of the field (see `Index::resolve_space_as_typos`) can be ruled out without
+ *  intersecting their postings.
+ *
+ *  The number of pairs of a field is not known up front, so the filter is a series of filters, each twice the size
+ *  of the one before it, that are added to as the last one fills up. A pair sets a few bits within a single word, so
+ *  that looking it up touches one cache line per filter.
+ *
+ *  Pairs are never removed: the pairs of deleted documents only cost a needless intersection.
+ */
+class bigram_filter_t {
+private:
+    static constexpr size_t FIRST_CAPACITY = 4096;
+    static constexpr size_t BITS_PER_PAIR = 16;
+    static constexpr size_t NUM_PROBES = 6;
+
+    struct filter_t {
+        std::vector<uint64_t> words;
+        size_t capacity;
+        size_t num_pairs = 0;
+
+        explicit filter_t(size_t capacity): words(capacity * BITS_PER_PAIR / 64, 0), capacity(capacity) {
+
+        }
+    };
+
+    std::vector<filter_t> filters;
+
+    static uint64_t word_mask(uint64_t pair_hash);
+
+public:
+    static uint64_t pair_hash(const std::string& first, const std::string& second);
+
+    void add(uint64_t pair_hash);
+
+    // false when the pair was never added, true when it most likely was
+    [[nodiscard]] bool may_contain(uint64_t pair_hash) const;
+
+    [[nodiscard]] size_t num_pairs() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+};
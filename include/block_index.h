@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+typedef uint32_t last_id_t;
+
+/*
+    Flat index over the *last* ID of each block of a chain of blocks, used for partial random access
+    e.g. 0..[9], 10..[19], 20..[29]
+
+    Last IDs are stored contiguously (and apart from the block pointers) so that a lookup only touches a few
+    cache lines. Since blocks never overlap, changing the last ID of a block never changes its position in the index.
+*/
+template<class block_t>
+class block_index_t {
+private:
+    std::vector<last_id_t> last_ids;
+    std::vector<block_t*> blocks;
+
+public:
+    [[nodiscard]] size_t size() const {
+        return last_ids.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return last_ids.empty();
+    }
+
+    [[nodiscard]] last_id_t last_id_at(size_t pos) const {
+        return last_ids[pos];
+    }
+
+    [[nodiscard]] block_t* block_at(size_t pos) const {
+        return blocks[pos];
+    }
+
+    [[nodiscard]] block_t* last_block() const {
+        return blocks.back();
+    }
+
+    // position of the first block whose last ID is >= `id`, or `size()` when there is no such block
+    [[nodiscard]] size_t lower_bound(last_id_t id) const {
+        return std::lower_bound(last_ids.begin(), last_ids.end(), id) - last_ids.begin();
+    }
+
+    // same as `lower_bound()`, but gallops forward from `from` which is a hint for where the answer could be
+    size_t lower_bound(last_id_t id, size_t from) const {
+        const size_t n = last_ids.size();
+
+        if(from >= n || (from != 0 && last_ids[from - 1] >= id)) {
+            return lower_bound(id);
+        }
+
+        size_t lo = from;
+        size_t hi = from;
+        size_t step = 1;
+
+        while(hi < n && last_ids[hi] < id) {
+            lo = hi + 1;
+            hi = from + step;
+            step *= 2;
+        }
+
+        hi = std::min(hi, n);
+        return std::lower_bound(last_ids.begin() + lo, last_ids.begin() + hi, id) - last_ids.begin();
+    }
+
+    void insert(last_id_t last_id, block_t* block) {
+        size_t pos = lower_bound(last_id);
+        last_ids.insert(last_ids.begin() + pos, last_id);
+        blocks.insert(blocks.begin() + pos, block);
+    }
+
+    void erase(last_id_t last_id) {
+        size_t pos = lower_bound(last_id);
+        if(pos != last_ids.size() && last_ids[pos] == last_id) {
+            last_ids.erase(last_ids.begin() + pos);
+            blocks.erase(blocks.begin() + pos);
+        }
+    }
+
+    void clear() {
+        last_ids.clear();
+        blocks.clear();
+    }
+
+    [[nodiscard]] size_t memory_bytes() const {
+        return last_ids.capacity() * sizeof(last_id_t) + blocks.capacity() * sizeof(block_t*);
+    }
+
+    // the block must remain between its neighbours after its last ID changes (always true for a chain of blocks)
+    void update(last_id_t before_last_id, last_id_t after_last_id) {
+        size_t pos = lower_bound(before_last_id);
+        if(pos != last_ids.size() && last_ids[pos] == before_last_id) {
+            last_ids[pos] = after_last_id;
+        }
+    }
+};
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <functional>
 #include <condition_variable>
 #include <shared_mutex>
 #include <art.h>
@@ -20,6 +21,8 @@
 #include <tsl/htrie_map.h>
 #include "tokenizer.h"
 #include "synonym_index.h"
+#include "override_index.h"
+#include "document_codec.h"
 
 struct doc_seq_id_t {
     uint32_t seq_id;
@@ -38,6 +41,14 @@ struct highlight_field_t {
     }
 };
 
+// filters parsed off a `filter_by`: filters on `id` hold the seq_ids that the ids were looked up as, which later
+// writes can change, and so are only valid while the collection remains at `write_generation`
+struct parsed_filter_t {
+    std::vector<filter> filters;
+    bool has_id_filter = false;
+    uint64_t write_generation = 0;
+};
+
 class Collection {
 private:
 
@@ -47,6 +58,12 @@ private:
 
     const size_t DEFAULT_TOPSTER_SIZE = 250;
 
+    // parsed documents cached for building hits: larger documents are never cached
+    static const size_t DOCUMENT_CACHE_CAPACITY = 1024;
+    static const size_t DOCUMENT_CACHE_MAX_DOC_SIZE = 16 * 1024;
+
+    static const size_t PARSED_FILTER_CACHE_CAPACITY = 1024;
+
     struct highlight_t {
         size_t field_index;
         std::string field;
@@ -65,6 +82,12 @@ private:
         }
     };
 
+    // an import line parsed ahead of the batch it goes into
+    struct parsed_line_t {
+        nlohmann::json document;
+        std::string parse_error;
+    };
+
     const std::string name;
 
     const std::atomic<uint32_t> collection_id;
@@ -84,6 +107,15 @@ private:
 
     std::map<std::string, override_t> overrides;
 
+    // rule queries of the overrides without a `filter_by`, which curate the hits
+    override_index_t curation_override_index;
+
+    // rule queries of the overrides with a static `filter_by`
+    override_index_t filter_override_index;
+
+    // overrides whose rule has `{field}` placeholders, which only the index can match against a query
+    std::set<std::string> dynamic_filter_override_ids;
+
     std::string default_sorting_field;
 
     const float max_memory_ratio;
@@ -96,15 +128,99 @@ private:
 
     std::vector<char> token_separators;
 
+    const posting_codec_t posting_codec;
+
+    // int64 field holding the unix time (in seconds) at which a document expires, or empty when they never do
+    const std::string ttl_field;
+
+    // encoding of the stored documents, with the dictionary of their keys when compact
+    document_codec_t document_codec;
+
+    // top level fields that are also stored, along with the id, in a small record of their own per document: hits
+    // that return only these fields are built off that record instead of the whole document
+    const std::vector<std::string> summary_fields;
+
+    // a search is split into this many ranges of seq_ids, which are searched in parallel
+    const size_t num_memory_shards;
+
     Index* index;
 
     SynonymIndex* synonym_index;
 
+    // alters run one at a time, each building the indexes of its fields off a snapshot of the store while searches
+    // and writes go on against the current schema
+    std::mutex alter_mutex;
+
+    // held shared by a write of documents from its indexing up to its write to the store, so that an alter takes its
+    // snapshot of the store with none of them halfway through
+    std::shared_mutex pending_write_mutex;
+
+    // seq_id => document as written to the index (null when removed), for the writes made while an alter builds its
+    // indexes, which are replayed onto them before they are swapped in
+    bool alter_tracking_writes = false;
+    std::map<uint32_t, nlohmann::json> alter_written_docs;
+
+    // a hibernated collection holds an empty index in place of its own until it is used again, when the documents
+    // are indexed off the store again, with the search trees restored off the snapshot taken as it was hibernated
+    std::mutex hibernation_mutex;
+    std::atomic<bool> hibernated{false};
+    std::string hibernation_snapshot_path;
+    uint64_t hibernation_generation = 0;
+
+    // seconds since the epoch
+    std::atomic<uint64_t> last_used_s{0};
+
+    // bytes of index the collection may hold, or 0 when it has no quota of its own: writes are shed more and more
+    // often as its estimate nears the quota, and all of them once it is reached
+    const uint64_t memory_quota_bytes;
+
+    // the index is walked for its size (see `get_memory_stats()`) each time its number of documents grows by a tenth,
+    // its bytes per document standing for the collection in between
+    std::atomic<uint64_t> memory_bytes_per_doc{0};
+    std::atomic<size_t> memory_estimate_num_docs{0};
+
+    // seq_id => parsed document, for the documents of recent hits
+    mutable LRU::Cache<uint32_t, std::shared_ptr<const nlohmann::json>> document_cache;
+    mutable std::mutex document_cache_mutex;
+
+    // bumped on every write of a document to the store, so that a document read before the write is not cached
+    uint64_t document_cache_generation = 0;
+
+    // `filter_by` => parsed filters, since the searches of an application repeat the same few filters; cleared when
+    // the schema is altered
+    mutable LRU::Cache<std::string, parsed_filter_t> parsed_filter_cache;
+    mutable std::mutex parsed_filter_cache_mutex;
+
+    // taken off a process wide counter after every write that can change search results, so that a response cached
+    // for one collection cannot pass for another of the same name that was created after it
+    static std::atomic<uint64_t> next_write_generation;
+    std::atomic<uint64_t> write_generation{0};
+
     // methods
 
-    std::string get_doc_id_key(const std::string & doc_id) const;
+    void bump_write_generation();
 
-    std::string get_seq_id_key(uint32_t seq_id) const;
+    // requires a lock on `mutex`
+    Option<bool> write_index_snapshot(const std::string& file_path, uint64_t store_seq_number) const;
+
+    // `filter::parse_filter_query` against the schema, served from `parsed_filter_cache`
+    Option<bool> parse_filter_query(const std::string& simple_filter_query, std::vector<filter>& filters) const;
+
+    // caches `document` unless a document was written since `generation` was read
+    void cache_document(uint32_t seq_id, size_t stored_size, const nlohmann::json& document,
+                        uint64_t generation) const;
+
+    // to be called after every write of the document of `seq_id` to the store
+    void invalidate_cached_document(uint32_t seq_id);
+
+    static std::vector<parsed_line_t> parse_lines(const std::vector<std::string>& json_lines,
+                                                  size_t start, size_t end);
+
+    // checks the `id` of a parsed document and resolves its seq_id, as the last part of `to_doc()`
+    Option<doc_seq_id_t> get_doc_seq_id(nlohmann::json& document, const index_operation_t& operation,
+                                        const std::string& id);
+
+    std::string get_doc_id_key(const std::string & doc_id) const;
 
     void highlight_result(const std::string& raw_query,
                           const field &search_field,
@@ -128,10 +244,18 @@ private:
                         const std::map<size_t, std::vector<std::string>>& pinned_hits,
                         const std::vector<std::string>& hidden_hits,
                         std::vector<std::pair<uint32_t, uint32_t>>& included_ids,
-                        std::vector<uint32_t>& excluded_ids, std::vector<const override_t*>& filter_overrides,
+                        std::vector<uint32_t>& excluded_ids,
                         bool& filter_curated_hits,
                         std::string& curated_sort_by) const;
 
+    // overrides with a `filter_by` that may match `query_tokens`, in the order of their ids
+    void get_filter_overrides(const std::vector<std::string>& query_tokens,
+                              std::vector<const override_t*>& filter_overrides) const;
+
+    void index_override(const override_t& override);
+
+    void unindex_override(const override_t& override);
+
     static Option<bool> detect_new_fields(nlohmann::json& document,
                                           const DIRTY_VALUES& dirty_values,
                                           const std::unordered_map<std::string, field>& schema,
@@ -167,11 +291,36 @@ private:
 
     Option<bool> persist_collection_meta();
 
-    Option<bool> batch_alter_data(const std::unordered_map<std::string, field>& schema_additions,
-                                  const std::unordered_map<std::string, field>& new_dynamic_fields,
-                                  const std::vector<field>& del_fields,
-                                  const std::string& this_fallback_field_type,
-                                  const bool do_validation);
+    // indexes the (seq_id, document) pairs onto the indexes of an alter: the added fields as they are, and the
+    // reindexed ones after coercing their values to the new types; fails with the first document that is rejected
+    Option<bool> alter_index_batch(Index* alter_index, std::vector<std::pair<uint32_t, nlohmann::json>>& docs,
+                                   const std::unordered_map<std::string, field>& schema_additions,
+                                   const std::unordered_map<std::string, field>& schema_reindex,
+                                   const std::string& this_fallback_field_type);
+
+    // builds the indexes of the added and reindexed fields off the documents of the snapshot that `snapshot_iter`
+    // reads, without holding the collection lock
+    Option<bool> build_alter_index(Index* alter_index, rocksdb::Iterator* snapshot_iter,
+                                   const std::unordered_map<std::string, field>& schema_additions,
+                                   const std::unordered_map<std::string, field>& schema_reindex,
+                                   const std::string& this_fallback_field_type);
+
+    // to be called with the collection lock held: replays the writes made since the snapshot onto the indexes of the
+    // alter, and swaps them in for the fields that they replace
+    Option<bool> apply_alter(Index* alter_index, rocksdb::Iterator* snapshot_iter,
+                             const std::unordered_map<std::string, field>& schema_additions,
+                             const std::unordered_map<std::string, field>& schema_reindex,
+                             const std::unordered_map<std::string, field>& addition_dynamic_fields,
+                             const std::unordered_map<std::string, field>& reindex_dynamic_fields,
+                             const std::vector<field>& del_fields,
+                             const std::string& this_fallback_field_type);
+
+    // `alter()` once a snapshot of the store has been taken and the writes made after it are tracked
+    Option<bool> alter_off_snapshot(nlohmann::json& alter_payload, rocksdb::Iterator* snapshot_iter);
+
+    // to be called with the collection lock held by every write of a document to the index: `document` is null
+    // when the document is removed
+    void track_alter_write(uint32_t seq_id, const nlohmann::json& document);
 
     Option<bool> validate_alter_payload(nlohmann::json& schema_changes,
                                         std::unordered_map<std::string, field>& schema_additions,
@@ -185,7 +334,10 @@ public:
 
     enum {MAX_ARRAY_MATCHES = 5};
 
-    const size_t PER_PAGE_MAX = 250;
+    static constexpr size_t PER_PAGE_MAX = 250;
+
+    static constexpr size_t DEFAULT_NUM_MEMORY_SHARDS = 4;
+    static constexpr size_t MAX_NUM_MEMORY_SHARDS = 64;
 
     const size_t GROUP_LIMIT_MAX = 99;
 
@@ -195,6 +347,8 @@ public:
     static constexpr const char* COLLECTION_OVERRIDE_PREFIX = "$CO";
     static constexpr const char* SEQ_ID_PREFIX = "$SI";
     static constexpr const char* DOC_ID_PREFIX = "$DI";
+    static constexpr const char* DOC_KEYS_PREFIX = "$DK";
+    static constexpr const char* SUMMARY_PREFIX = "$SS";
 
     static constexpr const char* COLLECTION_NAME_KEY = "name";
     static constexpr const char* COLLECTION_ID_KEY = "id";
@@ -206,6 +360,14 @@ public:
 
     static constexpr const char* COLLECTION_SYMBOLS_TO_INDEX = "symbols_to_index";
     static constexpr const char* COLLECTION_SEPARATORS = "token_separators";
+    static constexpr const char* COLLECTION_POSTING_CODEC = "posting_codec";
+    static constexpr const char* COLLECTION_TTL_FIELD = "ttl_field";
+    static constexpr const char* COLLECTION_DOCUMENT_ENCODING = "document_encoding";
+    static constexpr const char* COLLECTION_SUMMARY_FIELDS = "summary_fields";
+    static constexpr const char* COLLECTION_MEMORY_QUOTA_BYTES = "memory_quota_bytes";
+
+    // share of its memory quota beyond which the writes to a collection start being shed
+    static constexpr float MEMORY_QUOTA_THROTTLE_RATIO = 0.8;
 
     // methods
 
@@ -215,7 +377,12 @@ public:
                const uint32_t next_seq_id, Store *store, const std::vector<field>& fields,
                const std::string& default_sorting_field,
                const float max_memory_ratio, const std::string& fallback_field_type,
-               const std::vector<std::string>& symbols_to_index, const std::vector<std::string>& token_separators);
+               const std::vector<std::string>& symbols_to_index, const std::vector<std::string>& token_separators,
+               const posting_codec_t posting_codec = FOR_CODEC, const std::string& ttl_field = "",
+               const document_encoding_t document_encoding = JSON_ENCODING,
+               const std::vector<std::string>& summary_fields = {},
+               const size_t num_memory_shards = DEFAULT_NUM_MEMORY_SHARDS,
+               const uint64_t memory_quota_bytes = 0);
 
     ~Collection();
 
@@ -227,16 +394,50 @@ public:
 
     std::string get_seq_id_collection_prefix() const;
 
+    std::string get_seq_id_key(uint32_t seq_id) const;
+
+    // key of the record of `summary_fields` of a document
+    std::string get_summary_key(uint32_t seq_id) const;
+
+    // the id and `summary_fields` of `document`
+    nlohmann::json get_document_summary(const nlohmann::json& document) const;
+
+    // whether hits can be built off the summary records: only summary fields are included or highlighted
+    bool is_summary_enough(const spp::sparse_hash_set<std::string>& include_fields,
+                           const std::vector<highlight_field_t>& highlight_items) const;
+
+    // key of the dictionary of a compact encoding's document keys
+    std::string get_document_keys_key() const;
+
+    // serializes `document` for the store in the collection's encoding: false when a new key of it could not be
+    // persisted in the dictionary
+    bool encode_document(const nlohmann::json& document, std::string& value);
+
+    // parses a stored document of either encoding: `document` is discarded when it could not be parsed
+    bool decode_document(const char* data, size_t size, nlohmann::json& document) const;
+
+    bool decode_document(const std::string& value, nlohmann::json& document) const;
+
     std::string get_name() const;
 
     uint64_t get_created_at() const;
 
     uint32_t get_collection_id() const;
 
+    // node of the workers that the searches and writes of the collection run on (see `numa_node_scope_t`), or -1
+    int get_numa_node() const;
+
     uint32_t get_next_seq_id();
 
+    // the seq_id the next document will get, without taking it
+    uint32_t peek_next_seq_id() const;
+
     Option<uint32_t> doc_id_to_seq_id(const std::string & doc_id) const;
 
+    // seq_ids of those of `doc_ids` that exist, looked up in a single batch
+    void doc_ids_to_seq_ids(const std::vector<std::string>& doc_ids,
+                            std::unordered_map<std::string, uint32_t>& seq_ids) const;
+
     std::vector<std::string> get_facet_fields();
 
     std::vector<field> get_sort_fields();
@@ -256,10 +457,17 @@ public:
 
     static uint32_t get_seq_id_from_key(const std::string & key);
 
+    // top level fields of `new_doc` that differ from `old_doc`, with null for the fields it no longer has
+    static nlohmann::json get_doc_patch(const nlohmann::json& old_doc, const nlohmann::json& new_doc);
+
     Option<bool> get_document_from_store(const std::string & seq_id_key, nlohmann::json & document) const;
 
     Option<bool> get_document_from_store(const uint32_t& seq_id, nlohmann::json & document) const;
 
+    // documents of `seq_ids` read in a single batch: one that is missing or cannot be parsed is left discarded
+    void get_documents_from_store(const uint32_t* seq_ids, size_t num_seq_ids,
+                                  std::vector<nlohmann::json>& documents) const;
+
     Option<uint32_t> index_in_memory(nlohmann::json & document, uint32_t seq_id,
                                      const index_operation_t op, const DIRTY_VALUES& dirty_values);
 
@@ -271,9 +479,22 @@ public:
     bool facet_value_to_string(const facet &a_facet, const facet_count_t &facet_count, const nlohmann::json &document,
                                std::string &value) const;
 
+    // adds the range facet of `facet_str`, e.g. `price(..50, 50..100, 100..)`, whose ranges include their lower
+    // bounds and exclude their upper bounds
+    Option<bool> parse_range_facet(const std::string& facet_str, std::vector<facet>& facets) const;
+
     static void populate_result_kvs(Topster *topster, std::vector<std::vector<KV *>> &result_kvs);
 
-    void batch_index(std::vector<index_record>& index_records, std::vector<std::string>& json_out, size_t &num_indexed, const bool& write_docs, const bool& write_id);
+    // a `search_after` cursor is the sort tuple of the last hit of a page: "<score 0>,<score 1>,<score 2>,<seq_id>"
+    static Option<bool> parse_search_after(const std::string& search_after_str, KV& search_after);
+
+    static std::string get_search_after(const KV* kv);
+
+    // "<field>:([<value>, ...], k: <k>, alpha: <alpha>)", where `k` and `alpha` are optional
+    static Option<bool> parse_vector_query(const std::string& vector_query_str, vector_query_t& vector_query);
+
+    void batch_index(std::vector<index_record>& index_records, std::vector<std::string>& json_out, size_t &num_indexed, const bool& write_docs, const bool& write_id,
+                     const bool& bulk_load = false);
 
     bool is_exceeding_memory_threshold() const;
 
@@ -288,6 +509,51 @@ public:
 
     size_t batch_index_in_memory(std::vector<index_record>& index_records);
 
+    // the two phases of `batch_index_in_memory()`: preprocessing only needs a shared lock on the collection, so that
+    // batches can be preprocessed concurrently and then indexed one after another
+    void batch_preprocess_in_memory(std::vector<index_record>& index_records);
+
+    size_t batch_index_preprocessed_in_memory(std::vector<index_record>& index_records);
+
+    // dumps the search trees of the index to `file_path`, as of the given sequence number of the store
+    Option<bool> save_index_snapshot(const std::string& file_path, uint64_t store_seq_number) const;
+
+    // restores the search trees off a snapshot taken of the collection as it is now in the store, before its
+    // documents are loaded: false when there is no such snapshot
+    bool load_index_snapshot(const std::string& file_path, uint64_t store_seq_number);
+
+    // restores the search trees off the index snapshot of a dump (see `collection_dump_t`), before the dumped
+    // documents are loaded: false when the snapshot does not fit the schema or the documents of the collection
+    bool load_dumped_index(std::istream& in);
+
+    // to be called once the documents are loaded, so that later writes are tokenized in full
+    void clear_restored_fields();
+
+    // writes a dump of the collection (see `collection_dump_t`) to `dump_path`, as of the writes done so far
+    Option<bool> dump(const std::string& dump_path);
+
+    // Before its documents are loaded, gives the stored documents new sequence IDs (above the current ones) in the
+    // descending order of the default sorting field, so that the posting lists hold the best ranked documents first.
+    // Returns the number of documents renumbered: none when they are already in that order.
+    Option<size_t> renumber_by_default_sorting_field(size_t batch_size);
+
+    void mark_used(uint64_t now_s);
+
+    uint64_t get_last_used_s() const;
+
+    bool is_hibernated() const;
+
+    // dumps the search trees of the index to `file_path` ahead of `hibernate()`, which it returns the write
+    // generation for
+    Option<uint64_t> save_hibernation_snapshot(const std::string& file_path) const;
+
+    // swaps the index for an empty one and hands it back to be freed, unless the collection was written to since
+    // `save_hibernation_snapshot()` returned `generation` (or is being altered), in which case nullptr is returned
+    Index* hibernate(uint64_t generation, const std::string& snapshot_path);
+
+    // gets a hibernated collection its index back: `index_documents` is to index the documents of the store
+    Option<bool> wake(const std::function<Option<bool>(Collection*)>& index_documents);
+
     Option<nlohmann::json> add(const std::string & json_str,
                                const index_operation_t& operation=CREATE, const std::string& id="",
                                const DIRTY_VALUES& dirty_values=DIRTY_VALUES::COERCE_OR_REJECT);
@@ -295,7 +561,8 @@ public:
     nlohmann::json add_many(std::vector<std::string>& json_lines, nlohmann::json& document,
                             const index_operation_t& operation=CREATE, const std::string& id="",
                             const DIRTY_VALUES& dirty_values=DIRTY_VALUES::COERCE_OR_REJECT,
-                            const bool& write_docs=false, const bool& write_id=false);
+                            const bool& write_docs=false, const bool& write_id=false,
+                            const bool& bulk_load=false);
 
     Option<nlohmann::json> search(const std::string & query, const std::vector<std::string> & search_fields,
                                   const std::string & simple_filter_query, const std::vector<std::string> & facet_fields,
@@ -334,7 +601,17 @@ public:
                                   const size_t max_extra_suffix = INT16_MAX,
                                   const size_t facet_query_num_typos = 2,
                                   const size_t filter_curated_hits_option = 2,
-                                  const bool prioritize_token_position = false) const;
+                                  const bool prioritize_token_position = false,
+                                  const bool enable_top_k_pruning = false,
+                                  const bool explain = false,
+                                  const std::atomic<bool>* req_disposed = nullptr,
+                                  const std::string& search_after_str = "",
+                                  const size_t facet_sample_percent = 100,
+                                  const size_t facet_sample_threshold = 0,
+                                  const std::string& vector_query_str = "",
+                                  const bool profile = false,
+                                  const bool exhaustive_found = true,
+                                  const size_t latency_budget_ms = 0) const;
 
     Option<bool> get_filter_ids(const std::string & simple_filter_query,
                                 std::vector<std::pair<size_t, uint32_t*>>& index_ids);
@@ -345,14 +622,47 @@ public:
 
     Option<bool> remove_if_found(uint32_t seq_id, bool remove_from_store = true);
 
+    // removes the documents of the given sorted seq_ids that exist, reading and deleting them in one store request
+    // each, and returns the number removed
+    Option<size_t> remove_if_found(const uint32_t* seq_ids, size_t num_seq_ids, bool remove_from_store = true);
+
     size_t get_num_documents() const;
 
+    // changes after every write that can change search results: documents, overrides, synonyms and the schema
+    uint64_t get_write_generation() const;
+
     DIRTY_VALUES parse_dirty_values_option(std::string& dirty_values) const;
 
     std::vector<char> get_symbols_to_index();
 
     std::vector<char> get_token_separators();
 
+    posting_codec_t get_posting_codec() const;
+
+    const std::string& get_ttl_field() const;
+
+    document_encoding_t get_document_encoding() const;
+
+    const std::vector<std::string>& get_summary_fields() const;
+
+    nlohmann::json get_posting_stats() const;
+
+    nlohmann::json get_tree_stats() const;
+
+    // estimated heap bytes held by the in-memory index, in total, per structure and per field
+    nlohmann::json get_memory_stats() const;
+
+    // repacks up to `max_lists` of the lists that deletes and updates left fragmented (see `Index::compact_postings()`)
+    size_t compact_postings(size_t max_lists);
+
+    uint64_t get_memory_quota_bytes() const;
+
+    // estimated bytes of index over the memory quota, or 0 when the collection has no quota
+    float get_memory_quota_usage() const;
+
+    // walks the index for its size again when a tenth more documents were added since it last was
+    void update_memory_estimate();
+
     std::string get_fallback_field_type();
 
     // Override operations
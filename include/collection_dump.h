@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+/*
+ *  Binary dump of a collection, for moving it to another node (or under another name) without going through the
+ *  JSON of its documents: the stored key-value pairs are ingested as they are, as sorted table files, and the search
+ *  trees of its plain string fields are loaded off the index snapshot at the end of the dump.
+ *
+ *  Format: the header (meta, next seq_id, overrides and synonyms as they are stored), followed by the key-value
+ *  pairs of the collection in key order per column family, with the "<collection id>_" prefix of the keys stripped
+ *  and an empty key for the end, followed by an index snapshot (see `index_snapshot_t`) taken as of the pairs.
+ */
+struct collection_dump_t {
+    static constexpr uint32_t MAGIC = 0x44435354;  // "TSCD"
+    static constexpr uint32_t VERSION = 1;
+
+    std::string meta_json;
+    uint32_t next_seq_id = 0;
+    std::vector<std::string> override_jsons;
+    std::vector<std::string> synonym_jsons;
+
+    void write_header(std::ostream& out) const;
+
+    // false when the stream does not hold the header of a dump of this version
+    bool read_header(std::istream& in);
+
+    static void write_kv(std::ostream& out, const std::string& key, const std::string& value);
+
+    static void write_kvs_end(std::ostream& out);
+
+    // leaves `key` empty at the end of the pairs: false when the stream ends short of it
+    static bool read_kv(std::istream& in, std::string& key, std::string& value);
+};
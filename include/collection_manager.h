@@ -2,10 +2,13 @@
 
 #include <iostream>
 #include <string>
+#include <deque>
+#include <condition_variable>
 #include <sparsepp.h>
 #include "store.h"
 #include "field.h"
 #include "collection.h"
+#include "hot_query_log.h"
 #include "auth_manager.h"
 #include "threadpool.h"
 #include "batched_indexer.h"
@@ -78,6 +81,53 @@ private:
 
     BatchedIndexer* batch_indexer;
 
+    // progress of `load()`, for as long as it runs
+    std::atomic<bool> loading;
+    std::atomic<size_t> num_collections_to_load;
+    std::atomic<size_t> num_collections_loaded;
+    std::atomic<size_t> num_documents_loaded;
+
+    // index snapshots that `load()` restores the search trees of collections off, when they match the store
+    std::string index_snapshot_dir;
+    uint64_t index_snapshot_seq_number = 0;
+
+    // whether `load()` renumbers the documents of collections in the order of their default sorting field
+    bool static_rank_seq_ids = false;
+
+    // collections dropped off the namespace, along with the key prefix of their documents in the store (empty
+    // when the store is left alone): their memory is released on the thread pool, one collection at a time, so that
+    // a drop does not wait for it
+    std::mutex reclaim_mutex;
+    std::condition_variable reclaim_cv;
+    std::deque<std::pair<Collection*, std::string>> collections_to_reclaim;
+    bool reclaiming = false;
+
+    void reclaim_collection(Collection* collection, const std::string& del_key_prefix);
+
+    void run_reclaimer();
+
+    // collections that are not used for `hibernation_idle_s` seconds are hibernated, with the snapshots of their
+    // search trees kept in `hibernation_dir`
+    uint32_t hibernation_idle_s = 0;
+    std::string hibernation_dir;
+    std::atomic<bool> hibernating{false};
+
+    void hibernate_idle_collections_now(uint64_t now_s);
+
+    // lists that deletes and updates left fragmented are repacked at up to this many per `compact_postings()` call
+    size_t posting_compaction_rate = 0;
+    std::atomic<bool> compacting{false};
+
+    void compact_postings_now(size_t max_lists);
+
+    // progress of `warm_up()`, for as long as it runs
+    std::atomic<bool> warming{false};
+    std::atomic<size_t> num_queries_to_warm{0};
+    std::atomic<size_t> num_queries_warmed{0};
+
+    // marks the collection as used, waking it first when it is hibernated
+    void use_collection(Collection* collection) const;
+
     CollectionManager();
 
     ~CollectionManager() = default;
@@ -93,13 +143,22 @@ private:
     }
 
 public:
-    static constexpr const size_t DEFAULT_NUM_MEMORY_SHARDS = 4;
+    static constexpr const size_t DEFAULT_NUM_MEMORY_SHARDS = Collection::DEFAULT_NUM_MEMORY_SHARDS;
 
     static constexpr const char* NEXT_COLLECTION_ID_KEY = "$CI";
     static constexpr const char* SYMLINK_PREFIX = "$SL";
     static constexpr const char* PRESET_PREFIX = "$PS";
     static constexpr const char* BATCHED_INDEXER_STATE_KEY = "$BI";
 
+    // documents indexed at a time when a hibernated collection is woken
+    static constexpr const size_t WAKE_BATCH_SIZE = 1000;
+
+    // bytes of the dumped pairs ingested at a time by `restore_collection()`, as one table file per column family
+    static constexpr const size_t RESTORE_INGEST_BYTES = 64 * 1024 * 1024;
+
+    // lists repacked by a collection before its index lets searches in again
+    static constexpr const size_t POSTING_COMPACTION_SLICE = 64;
+
     static CollectionManager & get_instance() {
         static CollectionManager instance;
         return instance;
@@ -113,10 +172,19 @@ public:
                                        Store* store,
                                        float max_memory_ratio);
 
+    // documents are read and preprocessed on `num_load_threads` threads
     static Option<bool> load_collection(const nlohmann::json& collection_meta,
                                         const size_t batch_size,
                                         const StoreStatus& next_coll_id_status,
-                                        const std::atomic<bool>& quit);
+                                        const std::atomic<bool>& quit,
+                                        const size_t num_load_threads = 1);
+
+    // indexes the documents of the collection in the store, `batch_size` at a time, adding their count to
+    // `num_documents_loaded` when it is given
+    static Option<bool> index_stored_documents(Collection* collection, const uint32_t collection_next_seq_id,
+                                               const size_t batch_size, const size_t num_load_threads,
+                                               const std::atomic<bool>& quit,
+                                               std::atomic<size_t>* num_documents_loaded);
 
     void add_to_collections(Collection* collection);
 
@@ -134,6 +202,40 @@ public:
 
     Option<bool> load(const size_t collection_batch_size, const size_t document_batch_size);
 
+    // number of collections and documents loaded so far while `load()` runs (and of searches replayed while
+    // `warm_up()` runs), or an empty object otherwise
+    nlohmann::json get_load_progress() const;
+
+    // replays the searches on the thread pool, one after another at background priority, to warm the caches of the
+    // collections: the node does not report itself as alive until they are done
+    void warm_up(std::vector<hot_query_t>&& hot_queries);
+
+    bool is_warming() const;
+
+    static std::string get_index_snapshot_path(const std::string& dir_path, uint32_t collection_id);
+
+    // dumps the search trees of all collections into `dir_path` (which must exist), one file per collection
+    Option<bool> save_index_snapshots(const std::string& dir_path, uint64_t store_seq_number) const;
+
+    // directory of the index snapshots taken along with the store that the next `load()` runs off
+    void set_index_snapshot_dir(const std::string& dir_path);
+
+    void set_static_rank_seq_ids(bool enabled);
+
+    // hibernates collections once they are not used for `idle_s` seconds, keeping their snapshots in `dir_path`
+    Option<bool> set_hibernation(uint32_t idle_s, const std::string& dir_path);
+
+    // frees the index of every collection that was last used before `now_s - idle_s`, on the thread pool: a
+    // hibernated collection is woken by the next `get_collection()` of it
+    void hibernate_idle_collections(uint64_t now_s);
+
+    // repacks up to `lists_per_call` fragmented posting and id lists on each `compact_postings()` (0 turns it off)
+    void set_posting_compaction_rate(size_t lists_per_call);
+
+    // repacks the lists that deletes and updates left fragmented, on the thread pool, a few lists at a time so that
+    // searches get in between
+    void compact_postings();
+
     // frees in-memory data structures when server is shutdown - helps us run a memory leak detector properly
     void dispose();
 
@@ -150,16 +252,41 @@ public:
                                           const uint64_t created_at = static_cast<uint64_t>(std::time(nullptr)),
                                           const std::string& fallback_field_type = "",
                                           const std::vector<std::string>& symbols_to_index = {},
-                                          const std::vector<std::string>& token_separators = {});
+                                          const std::vector<std::string>& token_separators = {},
+                                          const posting_codec_t posting_codec = FOR_CODEC,
+                                          const std::string& ttl_field = "",
+                                          const document_encoding_t document_encoding = JSON_ENCODING,
+                                          const std::vector<std::string>& summary_fields = {},
+                                          const uint64_t memory_quota_bytes = 0);
 
     locked_resource_view_t<Collection> get_collection(const std::string & collection_name) const;
 
+    // see `Collection::get_memory_quota_usage()`: 0 when there is no such collection, which is not woken either
+    float get_memory_quota_usage(const std::string& collection_name) const;
+
     locked_resource_view_t<Collection> get_collection_with_id(uint32_t collection_id) const;
 
     nlohmann::json get_collection_summaries() const;
 
+    // paths of the requests that delete, in batches of `batch_size`, the documents of every collection with a
+    // `ttl_field` that have expired by `now_s`: the cut-off is part of the filter, so that every node deletes the
+    // same documents when the request gets replicated
+    std::vector<std::string> get_expiry_paths(uint64_t now_s, size_t batch_size) const;
+
     Option<nlohmann::json> drop_collection(const std::string& collection_name, const bool remove_from_store = true);
 
+    // blocks until the collections dropped so far have been released
+    void wait_for_reclaims();
+
+    // writes a dump of the collection to `dump_path` (waking it first, when hibernated)
+    Option<bool> dump_collection(const std::string& collection_name, const std::string& dump_path);
+
+    // creates the collection `collection_name` off a dump of `dump_collection()`: its pairs are ingested into the
+    // store under a new collection id, and its documents are indexed `batch_size` at a time, off the search trees of
+    // the dump where they fit. Only the store of this node is written to: the dump is not replicated.
+    Option<Collection*> restore_collection(const std::string& collection_name, const std::string& dump_path,
+                                           size_t batch_size = WAKE_BATCH_SIZE);
+
     uint32_t get_next_collection_id() const;
 
     static std::string get_symlink_key(const std::string & symlink_name);
@@ -168,13 +295,28 @@ public:
 
     Store* get_store();
 
+    // null until initialized with a batch indexer
+    Store* get_meta_store() const;
+
     ThreadPool* get_thread_pool() const;
 
     AuthManager& getAuthManager();
 
     static Option<bool> do_search(std::map<std::string, std::string>& req_params,
                                   nlohmann::json& embedded_params,
-                                  std::string& results_json_str);
+                                  std::string& results_json_str,
+                                  const std::atomic<bool>* req_disposed = nullptr);
+
+    // number of facet values asked of every shard of a union search, over those that are returned
+    static constexpr size_t UNION_FACET_OVER_FETCH = 10;
+
+    // Searches the collections of `searches_params` as the shards of one collection: every shard is asked for its
+    // top `page * per_page` hits, which are merged by their common `sort_by` before the page is cut, while `found`
+    // and the facet counts are summed over the shards.
+    static Option<bool> do_union(std::vector<std::map<std::string, std::string>>& searches_params,
+                                 std::vector<nlohmann::json>& embedded_params_vec,
+                                 std::string& results_json_str,
+                                 const std::atomic<bool>* req_disposed = nullptr);
 
     static bool parse_sort_by_str(std::string sort_by_str, std::vector<sort_by>& sort_fields);
 
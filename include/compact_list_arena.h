@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <string>
+
+/*
+    Size class slab allocator for the small compact posting and ID lists, as well as the small ART nodes and leaves.
+
+    Most tokens and numerical values have only a handful of postings, so these lists are both tiny and plentiful:
+    packing them into large slabs avoids the per-allocation overhead of the general purpose allocator. Each size class
+    keeps an intrusive free list of released slots that is reused before a slab is carved further.
+
+    Slabs can also be carved out of a memory-mapped file (see `map_slabs()`): its pages are then backed by the file
+    instead of anonymous memory, so that the kernel can write back and evict the cold ones under memory pressure
+    rather than the process running out of memory.
+*/
+class CompactListArena {
+public:
+    // slot sizes are multiples of this and a freed slot must be able to hold the free list pointer
+    static constexpr size_t SIZE_CLASS_BYTES = 16;
+
+    // a compact list holds at most 64 integers along with a 4 byte header: larger requests (including `art_node48`
+    // and `art_node256`) go to `malloc()`
+    static constexpr size_t MAX_SLOT_BYTES = 272;
+    static constexpr size_t NUM_SIZE_CLASSES = MAX_SLOT_BYTES / SIZE_CLASS_BYTES;
+
+    static constexpr size_t SLAB_BYTES = 64 * 1024;
+
+    // the mapped file grows by this many bytes at a time, each step being mapped on its own
+    static constexpr size_t MAPPED_EXTENT_BYTES = 64 * 1024 * 1024;
+
+private:
+    struct size_class_t {
+        std::mutex mutex;
+        void* free_list = nullptr;
+
+        // unused tail of the most recent slab
+        char* slab_tail = nullptr;
+        size_t slab_tail_bytes = 0;
+
+        std::vector<char*> slabs;
+        size_t num_allocated = 0;
+    };
+
+    size_class_t size_classes[NUM_SIZE_CLASSES];
+
+    std::atomic<size_t> num_large_allocations{0};
+    std::atomic<size_t> large_allocated_bytes{0};
+
+    std::mutex extent_mutex;
+    int mapped_fd = -1;
+    size_t mapped_file_bytes = 0;
+
+    // unused tail of the most recent extent of the mapped file
+    char* extent_tail = nullptr;
+    size_t extent_tail_bytes = 0;
+
+    char* new_slab();
+
+    // slabs are never returned to the system, since lists of static objects could outlive the arena on exit
+    CompactListArena() = default;
+
+    static size_t size_class_of(size_t num_bytes) {
+        return (num_bytes + SIZE_CLASS_BYTES - 1) / SIZE_CLASS_BYTES - 1;
+    }
+
+public:
+    static CompactListArena& get_instance() {
+        static CompactListArena instance;
+        return instance;
+    }
+
+    CompactListArena(CompactListArena const&) = delete;
+    void operator=(CompactListArena const&) = delete;
+
+    void* allocate(size_t num_bytes);
+
+    // returns `ptr` itself when both sizes fall in the same size class
+    void* reallocate(void* ptr, size_t old_num_bytes, size_t new_num_bytes);
+
+    // `num_bytes` must be the size that `ptr` was (re)allocated with
+    void release(void* ptr, size_t num_bytes);
+
+    // bytes held in slabs (used or free) plus bytes of allocations that bypassed the slabs
+    size_t reserved_bytes();
+
+    // bytes of the slots and large allocations that are currently handed out
+    size_t allocated_bytes();
+
+    size_t num_allocations();
+
+    // carves the slabs created from now on out of a file in `dir_path`, which is unlinked as soon as it is created so
+    // that it goes away with the process: false when the file cannot be created
+    bool map_slabs(const std::string& dir_path);
+
+    // bytes of the file that slabs are carved out of
+    size_t mapped_bytes();
+};
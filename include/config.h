@@ -37,6 +37,27 @@ private:
     float max_memory_ratio;
     int snapshot_interval_seconds;
     int snapshot_max_byte_count_per_rpc;
+    size_t snapshot_max_mb_per_sec;
+
+    size_t write_batch_delay_ms;
+    size_t write_batch_max_bytes;
+
+    size_t max_pending_searches;
+    size_t max_search_queue_ms;
+
+    size_t search_threads;
+    bool pin_search_threads;
+
+    // workers of the thread pools are pinned to the cpus of the numa nodes in turn, and the searches and writes of a
+    // collection run on the workers of one node
+    bool numa_pinning;
+
+    size_t response_cache_max_bytes;
+
+    size_t compression_min_bytes;
+    int gzip_level;
+    int brotli_level;
+    size_t http2_stream_window_size;
 
     std::atomic<size_t> healthy_read_lag;
     std::atomic<size_t> healthy_write_lag;
@@ -46,15 +67,55 @@ private:
 
     std::atomic<int> log_slow_requests_time_ms;
 
+    // searches that take at least this long, along with a sample of this ratio of the rest, go to the slow query log
+    int log_slow_searches_time_ms;
+    float slow_searches_sample_ratio;
+
+    // collector that the spans of traced requests are posted to, in the OTLP/HTTP JSON encoding, when not empty
+    std::string trace_export_url;
+    float trace_sample_ratio;
+
     uint32_t num_collections_parallel_load;
     uint32_t num_documents_parallel_load;
 
     uint32_t thread_pool_size;
 
+    // number of threads that a write batch is preprocessed and indexed on
+    uint32_t indexing_concurrency;
+
+    // collections that are not used for this long have their index freed until they are used again (0 disables)
+    uint32_t collection_hibernation_idle_s;
+
+    // posting and id lists left fragmented by deletes and updates that are repacked in the background every second
+    // (0 disables)
+    uint32_t posting_compaction_rate;
+
+    // documents are renumbered on start up in the descending order of the default sorting field of their collection
+    bool static_rank_seq_ids;
+
+    // typo and prefix expansion of a query token runs once over a collection wide dictionary of the tokens of its
+    // string fields, instead of once for every searched field
+    bool shared_vocabulary;
+
+    // most frequent searches that are kept track of, and replayed on start up to warm the caches (0 disables)
+    uint32_t num_hot_queries;
+
     bool enable_access_logging;
 
     int disk_used_max_percentage;
 
+    // when set, the small posting lists and tree nodes are kept in a memory-mapped file in this directory
+    std::string index_mmap_dir;
+
+    // RocksDB tuning: a block cache size of 0 keeps RocksDB's default cache per table factory
+    uint32_t db_block_cache_size_mb;
+    bool db_share_block_cache;
+    std::string db_compression;
+    std::string db_bottommost_compression;
+    uint32_t db_bloom_bits_per_key;
+    uint32_t db_compaction_rate_limit_mb;
+    bool db_compaction_direct_io;
+
 protected:
 
     Config() {
@@ -65,15 +126,43 @@ protected:
         this->max_memory_ratio = 1.0f;
         this->snapshot_interval_seconds = 3600;
         this->snapshot_max_byte_count_per_rpc = 4194304;
+        this->snapshot_max_mb_per_sec = 0;
+        this->write_batch_delay_ms = 0;
+        this->write_batch_max_bytes = 1024 * 1024;
+        this->max_pending_searches = 0;
+        this->max_search_queue_ms = 0;
+        this->search_threads = 0;
+        this->pin_search_threads = false;
+        this->numa_pinning = false;
+        this->response_cache_max_bytes = 64 * 1024 * 1024;
+        this->compression_min_bytes = 256;
+        this->gzip_level = 1;
+        this->brotli_level = 0;
+        this->http2_stream_window_size = 196605;
         this->healthy_read_lag = 1000;
         this->healthy_write_lag = 500;
         this->log_slow_requests_time_ms = -1;
+        this->log_slow_searches_time_ms = -1;
+        this->slow_searches_sample_ratio = 0;
+        this->trace_sample_ratio = 0;
         this->num_collections_parallel_load = 0;  // will be set dynamically if not overridden
         this->num_documents_parallel_load = 1000;
         this->thread_pool_size = 0; // will be set dynamically if not overridden
+        this->indexing_concurrency = 4;
+        this->collection_hibernation_idle_s = 0;
+        this->posting_compaction_rate = 1024;
+        this->static_rank_seq_ids = false;
+        this->shared_vocabulary = false;
+        this->num_hot_queries = 100;
         this->ssl_refresh_interval_seconds = 8 * 60 * 60;
         this->enable_access_logging = false;
         this->disk_used_max_percentage = 100;
+        this->db_block_cache_size_mb = 0;
+        this->db_share_block_cache = false;
+        this->db_compression = "snappy";
+        this->db_bloom_bits_per_key = 0;
+        this->db_compaction_rate_limit_mb = 0;
+        this->db_compaction_direct_io = false;
     }
 
     Config(Config const&) {
@@ -132,6 +221,10 @@ public:
         this->enable_cors = enable_cors;
     }
 
+    void set_shared_vocabulary(bool shared_vocabulary) {
+        this->shared_vocabulary = shared_vocabulary;
+    }
+
     void set_log_slow_requests_time_ms(int log_slow_requests_time_ms) {
         this->log_slow_requests_time_ms = log_slow_requests_time_ms;
     }
@@ -223,6 +316,58 @@ public:
         return this->snapshot_max_byte_count_per_rpc;
     }
 
+    size_t get_snapshot_max_mb_per_sec() const {
+        return this->snapshot_max_mb_per_sec;
+    }
+
+    size_t get_write_batch_delay_ms() const {
+        return this->write_batch_delay_ms;
+    }
+
+    size_t get_write_batch_max_bytes() const {
+        return this->write_batch_max_bytes;
+    }
+
+    size_t get_max_pending_searches() const {
+        return this->max_pending_searches;
+    }
+
+    size_t get_max_search_queue_ms() const {
+        return this->max_search_queue_ms;
+    }
+
+    size_t get_search_threads() const {
+        return this->search_threads;
+    }
+
+    bool get_pin_search_threads() const {
+        return this->pin_search_threads;
+    }
+
+    bool get_numa_pinning() const {
+        return this->numa_pinning;
+    }
+
+    size_t get_response_cache_max_bytes() const {
+        return this->response_cache_max_bytes;
+    }
+
+    size_t get_compression_min_bytes() const {
+        return this->compression_min_bytes;
+    }
+
+    int get_gzip_level() const {
+        return this->gzip_level;
+    }
+
+    int get_brotli_level() const {
+        return this->brotli_level;
+    }
+
+    size_t get_http2_stream_window_size() const {
+        return this->http2_stream_window_size;
+    }
+
     size_t get_healthy_read_lag() const {
         return this->healthy_read_lag;
     }
@@ -235,6 +380,22 @@ public:
         return this->log_slow_requests_time_ms;
     }
 
+    int get_log_slow_searches_time_ms() const {
+        return this->log_slow_searches_time_ms;
+    }
+
+    float get_slow_searches_sample_ratio() const {
+        return this->slow_searches_sample_ratio;
+    }
+
+    std::string get_trace_export_url() const {
+        return this->trace_export_url;
+    }
+
+    float get_trace_sample_ratio() const {
+        return this->trace_sample_ratio;
+    }
+
     size_t get_num_collections_parallel_load() const {
         return this->num_collections_parallel_load;
     }
@@ -247,6 +408,30 @@ public:
         return this->thread_pool_size;
     }
 
+    size_t get_indexing_concurrency() const {
+        return this->indexing_concurrency;
+    }
+
+    uint32_t get_collection_hibernation_idle_s() const {
+        return this->collection_hibernation_idle_s;
+    }
+
+    uint32_t get_posting_compaction_rate() const {
+        return this->posting_compaction_rate;
+    }
+
+    bool get_static_rank_seq_ids() const {
+        return this->static_rank_seq_ids;
+    }
+
+    bool get_shared_vocabulary() const {
+        return this->shared_vocabulary;
+    }
+
+    uint32_t get_num_hot_queries() const {
+        return this->num_hot_queries;
+    }
+
     size_t get_ssl_refresh_interval_seconds() const {
         return this->ssl_refresh_interval_seconds;
     }
@@ -259,6 +444,38 @@ public:
         return this->disk_used_max_percentage;
     }
 
+    std::string get_index_mmap_dir() const {
+        return this->index_mmap_dir;
+    }
+
+    uint32_t get_db_block_cache_size_mb() const {
+        return this->db_block_cache_size_mb;
+    }
+
+    bool get_db_share_block_cache() const {
+        return this->db_share_block_cache;
+    }
+
+    std::string get_db_compression() const {
+        return this->db_compression;
+    }
+
+    std::string get_db_bottommost_compression() const {
+        return this->db_bottommost_compression;
+    }
+
+    uint32_t get_db_bloom_bits_per_key() const {
+        return this->db_bloom_bits_per_key;
+    }
+
+    uint32_t get_db_compaction_rate_limit_mb() const {
+        return this->db_compaction_rate_limit_mb;
+    }
+
+    bool get_db_compaction_direct_io() const {
+        return this->db_compaction_direct_io;
+    }
+
     std::string get_access_log_path() const {
         if(this->log_dir.empty()) {
             return "";
@@ -267,6 +484,14 @@ public:
         return this->log_dir + "/typesense-access.log";
     }
 
+    std::string get_slow_searches_log_path() const {
+        if(this->log_dir.empty()) {
+            return "";
+        }
+
+        return this->log_dir + "/typesense-slow-searches.log";
+    }
+
     // loaders
 
     std::string get_env(const char *name) {
@@ -280,6 +505,7 @@ public:
     void load_config_env() {
         this->data_dir = get_env("TYPESENSE_DATA_DIR");
         this->log_dir = get_env("TYPESENSE_LOG_DIR");
+        this->index_mmap_dir = get_env("TYPESENSE_INDEX_MMAP_DIR");
         this->api_key = get_env("TYPESENSE_API_KEY");
 
         // @deprecated
@@ -346,6 +572,20 @@ public:
             this->log_slow_requests_time_ms = std::stoi(get_env("TYPESENSE_LOG_SLOW_REQUESTS_TIME_MS"));
         }
 
+        if(!get_env("TYPESENSE_LOG_SLOW_SEARCHES_TIME_MS").empty()) {
+            this->log_slow_searches_time_ms = std::stoi(get_env("TYPESENSE_LOG_SLOW_SEARCHES_TIME_MS"));
+        }
+
+        if(!get_env("TYPESENSE_SLOW_SEARCHES_SAMPLE_RATIO").empty()) {
+            this->slow_searches_sample_ratio = std::stof(get_env("TYPESENSE_SLOW_SEARCHES_SAMPLE_RATIO"));
+        }
+
+        this->trace_export_url = get_env("TYPESENSE_TRACE_EXPORT_URL");
+
+        if(!get_env("TYPESENSE_TRACE_SAMPLE_RATIO").empty()) {
+            this->trace_sample_ratio = std::stof(get_env("TYPESENSE_TRACE_SAMPLE_RATIO"));
+        }
+
         if(!get_env("TYPESENSE_NUM_COLLECTIONS_PARALLEL_LOAD").empty()) {
             this->num_collections_parallel_load = std::stoi(get_env("TYPESENSE_NUM_COLLECTIONS_PARALLEL_LOAD"));
         }
@@ -358,6 +598,25 @@ public:
             this->thread_pool_size = std::stoi(get_env("TYPESENSE_THREAD_POOL_SIZE"));
         }
 
+        if(!get_env("TYPESENSE_INDEXING_CONCURRENCY").empty()) {
+            this->indexing_concurrency = std::stoi(get_env("TYPESENSE_INDEXING_CONCURRENCY"));
+        }
+
+        if(!get_env("TYPESENSE_COLLECTION_HIBERNATION_IDLE_S").empty()) {
+            this->collection_hibernation_idle_s = std::stoi(get_env("TYPESENSE_COLLECTION_HIBERNATION_IDLE_S"));
+        }
+
+        if(!get_env("TYPESENSE_POSTING_COMPACTION_RATE").empty()) {
+            this->posting_compaction_rate = std::stoi(get_env("TYPESENSE_POSTING_COMPACTION_RATE"));
+        }
+
+        this->static_rank_seq_ids = ("TRUE" == get_env("TYPESENSE_STATIC_RANK_SEQ_IDS"));
+        this->shared_vocabulary = ("TRUE" == get_env("TYPESENSE_SHARED_VOCABULARY"));
+
+        if(!get_env("TYPESENSE_HOT_QUERIES").empty()) {
+            this->num_hot_queries = std::stoi(get_env("TYPESENSE_HOT_QUERIES"));
+        }
+
         if(!get_env("TYPESENSE_SSL_REFRESH_INTERVAL_SECONDS").empty()) {
             this->ssl_refresh_interval_seconds = std::stoi(get_env("TYPESENSE_SSL_REFRESH_INTERVAL_SECONDS"));
         }
@@ -366,11 +625,80 @@ public:
             this->snapshot_max_byte_count_per_rpc = std::stoi(get_env("TYPESENSE_SNAPSHOT_MAX_BYTE_COUNT_PER_RPC"));
         }
 
+        if(!get_env("TYPESENSE_SNAPSHOT_MAX_MB_PER_SEC").empty()) {
+            this->snapshot_max_mb_per_sec = std::stoul(get_env("TYPESENSE_SNAPSHOT_MAX_MB_PER_SEC"));
+        }
+
+        if(!get_env("TYPESENSE_WRITE_BATCH_DELAY_MS").empty()) {
+            this->write_batch_delay_ms = std::stoul(get_env("TYPESENSE_WRITE_BATCH_DELAY_MS"));
+        }
+
+        if(!get_env("TYPESENSE_WRITE_BATCH_MAX_BYTES").empty()) {
+            this->write_batch_max_bytes = std::stoul(get_env("TYPESENSE_WRITE_BATCH_MAX_BYTES"));
+        }
+
+        if(!get_env("TYPESENSE_MAX_PENDING_SEARCHES").empty()) {
+            this->max_pending_searches = std::stoul(get_env("TYPESENSE_MAX_PENDING_SEARCHES"));
+        }
+
+        if(!get_env("TYPESENSE_MAX_SEARCH_QUEUE_MS").empty()) {
+            this->max_search_queue_ms = std::stoul(get_env("TYPESENSE_MAX_SEARCH_QUEUE_MS"));
+        }
+
+        if(!get_env("TYPESENSE_SEARCH_THREADS").empty()) {
+            this->search_threads = std::stoul(get_env("TYPESENSE_SEARCH_THREADS"));
+        }
+
+        this->pin_search_threads = ("TRUE" == get_env("TYPESENSE_PIN_SEARCH_THREADS"));
+        this->numa_pinning = ("TRUE" == get_env("TYPESENSE_NUMA_PINNING"));
+
+        if(!get_env("TYPESENSE_RESPONSE_CACHE_MAX_BYTES").empty()) {
+            this->response_cache_max_bytes = std::stoul(get_env("TYPESENSE_RESPONSE_CACHE_MAX_BYTES"));
+        }
+
+        if(!get_env("TYPESENSE_COMPRESSION_MIN_BYTES").empty()) {
+            this->compression_min_bytes = std::stoul(get_env("TYPESENSE_COMPRESSION_MIN_BYTES"));
+        }
+
+        if(!get_env("TYPESENSE_GZIP_LEVEL").empty()) {
+            this->gzip_level = std::stoi(get_env("TYPESENSE_GZIP_LEVEL"));
+        }
+
+        if(!get_env("TYPESENSE_BROTLI_LEVEL").empty()) {
+            this->brotli_level = std::stoi(get_env("TYPESENSE_BROTLI_LEVEL"));
+        }
+
+        if(!get_env("TYPESENSE_HTTP2_STREAM_WINDOW_SIZE").empty()) {
+            this->http2_stream_window_size = std::stoul(get_env("TYPESENSE_HTTP2_STREAM_WINDOW_SIZE"));
+        }
+
         this->enable_access_logging = ("TRUE" == get_env("TYPESENSE_ENABLE_ACCESS_LOGGING"));
 
         if(!get_env("TYPESENSE_DISK_USED_MAX_PERCENTAGE").empty()) {
             this->disk_used_max_percentage = std::stoi(get_env("TYPESENSE_DISK_USED_MAX_PERCENTAGE"));
         }
+
+        if(!get_env("TYPESENSE_DB_BLOCK_CACHE_SIZE_MB").empty()) {
+            this->db_block_cache_size_mb = std::stoi(get_env("TYPESENSE_DB_BLOCK_CACHE_SIZE_MB"));
+        }
+
+        this->db_share_block_cache = ("TRUE" == get_env("TYPESENSE_DB_SHARE_BLOCK_CACHE"));
+
+        if(!get_env("TYPESENSE_DB_COMPRESSION").empty()) {
+            this->db_compression = get_env("TYPESENSE_DB_COMPRESSION");
+        }
+
+        this->db_bottommost_compression = get_env("TYPESENSE_DB_BOTTOMMOST_COMPRESSION");
+
+        if(!get_env("TYPESENSE_DB_BLOOM_BITS_PER_KEY").empty()) {
+            this->db_bloom_bits_per_key = std::stoi(get_env("TYPESENSE_DB_BLOOM_BITS_PER_KEY"));
+        }
+
+        if(!get_env("TYPESENSE_DB_COMPACTION_RATE_LIMIT_MB").empty()) {
+            this->db_compaction_rate_limit_mb = std::stoi(get_env("TYPESENSE_DB_COMPACTION_RATE_LIMIT_MB"));
+        }
+
+        this->db_compaction_direct_io = ("TRUE" == get_env("TYPESENSE_DB_COMPACTION_DIRECT_IO"));
     }
 
     void load_config_file(cmdline::parser & options) {
@@ -401,6 +729,10 @@ public:
             this->log_dir = reader.Get("server", "log-dir", "");
         }
 
+        if(reader.Exists("server", "index-mmap-dir")) {
+            this->index_mmap_dir = reader.Get("server", "index-mmap-dir", "");
+        }
+
         if(reader.Exists("server", "api-key")) {
             this->api_key = reader.Get("server", "api-key", "");
         }
@@ -477,6 +809,61 @@ public:
             this->snapshot_max_byte_count_per_rpc = (int) reader.GetInteger("server", "snapshot-max-byte-count-per-rpc", 4194304);
         }
 
+        if(reader.Exists("server", "snapshot-max-mb-per-sec")) {
+            this->snapshot_max_mb_per_sec = (size_t) reader.GetInteger("server", "snapshot-max-mb-per-sec", 0);
+        }
+
+        if(reader.Exists("server", "write-batch-delay-ms")) {
+            this->write_batch_delay_ms = (size_t) reader.GetInteger("server", "write-batch-delay-ms", 0);
+        }
+
+        if(reader.Exists("server", "write-batch-max-bytes")) {
+            this->write_batch_max_bytes = (size_t) reader.GetInteger("server", "write-batch-max-bytes", 1024 * 1024);
+        }
+
+        if(reader.Exists("server", "max-pending-searches")) {
+            this->max_pending_searches = (size_t) reader.GetInteger("server", "max-pending-searches", 0);
+        }
+
+        if(reader.Exists("server", "max-search-queue-ms")) {
+            this->max_search_queue_ms = (size_t) reader.GetInteger("server", "max-search-queue-ms", 0);
+        }
+
+        if(reader.Exists("server", "search-threads")) {
+            this->search_threads = (size_t) reader.GetInteger("server", "search-threads", 0);
+        }
+
+        if(reader.Exists("server", "pin-search-threads")) {
+            auto pin_search_threads_str = reader.Get("server", "pin-search-threads", "false");
+            this->pin_search_threads = (pin_search_threads_str == "true");
+        }
+
+        if(reader.Exists("server", "numa-pinning")) {
+            auto numa_pinning_str = reader.Get("server", "numa-pinning", "false");
+            this->numa_pinning = (numa_pinning_str == "true");
+        }
+
+        if(reader.Exists("server", "response-cache-max-bytes")) {
+            this->response_cache_max_bytes = (size_t) reader.GetInteger("server", "response-cache-max-bytes",
+                                                                        64 * 1024 * 1024);
+        }
+
+        if(reader.Exists("server", "compression-min-bytes")) {
+            this->compression_min_bytes = (size_t) reader.GetInteger("server", "compression-min-bytes", 256);
+        }
+
+        if(reader.Exists("server", "gzip-level")) {
+            this->gzip_level = (int) reader.GetInteger("server", "gzip-level", 1);
+        }
+
+        if(reader.Exists("server", "brotli-level")) {
+            this->brotli_level = (int) reader.GetInteger("server", "brotli-level", 0);
+        }
+
+        if(reader.Exists("server", "http2-stream-window-size")) {
+            this->http2_stream_window_size = (size_t) reader.GetInteger("server", "http2-stream-window-size", 196605);
+        }
+
         if(reader.Exists("server", "healthy-read-lag")) {
             this->healthy_read_lag = (size_t) reader.GetInteger("server", "healthy-read-lag", 1000);
         }
@@ -489,6 +876,22 @@ public:
             this->log_slow_requests_time_ms = (int) reader.GetInteger("server", "log-slow-requests-time-ms", -1);
         }
 
+        if(reader.Exists("server", "log-slow-searches-time-ms")) {
+            this->log_slow_searches_time_ms = (int) reader.GetInteger("server", "log-slow-searches-time-ms", -1);
+        }
+
+        if(reader.Exists("server", "slow-searches-sample-ratio")) {
+            this->slow_searches_sample_ratio = (float) reader.GetReal("server", "slow-searches-sample-ratio", 0.0f);
+        }
+
+        if(reader.Exists("server", "trace-export-url")) {
+            this->trace_export_url = reader.Get("server", "trace-export-url", "");
+        }
+
+        if(reader.Exists("server", "trace-sample-ratio")) {
+            this->trace_sample_ratio = (float) reader.GetReal("server", "trace-sample-ratio", 0.0f);
+        }
+
         if(reader.Exists("server", "num-collections-parallel-load")) {
             this->num_collections_parallel_load = (int) reader.GetInteger("server", "num-collections-parallel-load", 0);
         }
@@ -501,6 +904,32 @@ public:
             this->thread_pool_size = (int) reader.GetInteger("server", "thread-pool-size", 0);
         }
 
+        if(reader.Exists("server", "indexing-concurrency")) {
+            this->indexing_concurrency = (int) reader.GetInteger("server", "indexing-concurrency", 4);
+        }
+
+        if(reader.Exists("server", "collection-hibernation-idle-s")) {
+            this->collection_hibernation_idle_s = (int) reader.GetInteger("server", "collection-hibernation-idle-s", 0);
+        }
+
+        if(reader.Exists("server", "posting-compaction-rate")) {
+            this->posting_compaction_rate = (int) reader.GetInteger("server", "posting-compaction-rate", 1024);
+        }
+
+        if(reader.Exists("server", "static-rank-seq-ids")) {
+            auto static_rank_seq_ids_str = reader.Get("server", "static-rank-seq-ids", "false");
+            this->static_rank_seq_ids = (static_rank_seq_ids_str == "true");
+        }
+
+        if(reader.Exists("server", "shared-vocabulary")) {
+            auto shared_vocabulary_str = reader.Get("server", "shared-vocabulary", "false");
+            this->shared_vocabulary = (shared_vocabulary_str == "true");
+        }
+
+        if(reader.Exists("server", "hot-queries")) {
+            this->num_hot_queries = (int) reader.GetInteger("server", "hot-queries", 100);
+        }
+
         if(reader.Exists("server", "ssl-refresh-interval-seconds")) {
             this->ssl_refresh_interval_seconds = (int) reader.GetInteger("server", "ssl-refresh-interval-seconds", 8 * 60 * 60);
         }
@@ -513,6 +942,36 @@ public:
         if(reader.Exists("server", "disk-used-max-percentage")) {
             this->disk_used_max_percentage = (int) reader.GetInteger("server", "disk-used-max-percentage", 100);
         }
+
+        if(reader.Exists("server", "db-block-cache-size-mb")) {
+            this->db_block_cache_size_mb = (int) reader.GetInteger("server", "db-block-cache-size-mb", 0);
+        }
+
+        if(reader.Exists("server", "db-share-block-cache")) {
+            auto db_share_block_cache_str = reader.Get("server", "db-share-block-cache", "false");
+            this->db_share_block_cache = (db_share_block_cache_str == "true");
+        }
+
+        if(reader.Exists("server", "db-compression")) {
+            this->db_compression = reader.Get("server", "db-compression", "snappy");
+        }
+
+        if(reader.Exists("server", "db-bottommost-compression")) {
+            this->db_bottommost_compression = reader.Get("server", "db-bottommost-compression", "");
+        }
+
+        if(reader.Exists("server", "db-bloom-bits-per-key")) {
+            this->db_bloom_bits_per_key = (int) reader.GetInteger("server", "db-bloom-bits-per-key", 0);
+        }
+
+        if(reader.Exists("server", "db-compaction-rate-limit-mb")) {
+            this->db_compaction_rate_limit_mb = (int) reader.GetInteger("server", "db-compaction-rate-limit-mb", 0);
+        }
+
+        if(reader.Exists("server", "db-compaction-direct-io")) {
+            auto db_compaction_direct_io_str = reader.Get("server", "db-compaction-direct-io", "false");
+            this->db_compaction_direct_io = (db_compaction_direct_io_str == "true");
+        }
     }
 
     void load_config_cmd_args(cmdline::parser & options) {
@@ -524,6 +983,10 @@ public:
             this->log_dir = options.get<std::string>("log-dir");
         }
 
+        if(options.exist("index-mmap-dir")) {
+            this->index_mmap_dir = options.get<std::string>("index-mmap-dir");
+        }
+
         if(options.exist("api-key")) {
             this->api_key = options.get<std::string>("api-key");
         }
@@ -598,6 +1061,58 @@ public:
             this->snapshot_max_byte_count_per_rpc = options.get<int>("snapshot-max-byte-count-per-rpc");
         }
 
+        if(options.exist("snapshot-max-mb-per-sec")) {
+            this->snapshot_max_mb_per_sec = options.get<size_t>("snapshot-max-mb-per-sec");
+        }
+
+        if(options.exist("write-batch-delay-ms")) {
+            this->write_batch_delay_ms = options.get<size_t>("write-batch-delay-ms");
+        }
+
+        if(options.exist("write-batch-max-bytes")) {
+            this->write_batch_max_bytes = options.get<size_t>("write-batch-max-bytes");
+        }
+
+        if(options.exist("max-pending-searches")) {
+            this->max_pending_searches = options.get<size_t>("max-pending-searches");
+        }
+
+        if(options.exist("max-search-queue-ms")) {
+            this->max_search_queue_ms = options.get<size_t>("max-search-queue-ms");
+        }
+
+        if(options.exist("search-threads")) {
+            this->search_threads = options.get<size_t>("search-threads");
+        }
+
+        if(options.exist("pin-search-threads")) {
+            this->pin_search_threads = options.get<bool>("pin-search-threads");
+        }
+
+        if(options.exist("numa-pinning")) {
+            this->numa_pinning = options.get<bool>("numa-pinning");
+        }
+
+        if(options.exist("response-cache-max-bytes")) {
+            this->response_cache_max_bytes = options.get<size_t>("response-cache-max-bytes");
+        }
+
+        if(options.exist("compression-min-bytes")) {
+            this->compression_min_bytes = options.get<size_t>("compression-min-bytes");
+        }
+
+        if(options.exist("gzip-level")) {
+            this->gzip_level = options.get<int>("gzip-level");
+        }
+
+        if(options.exist("brotli-level")) {
+            this->brotli_level = options.get<int>("brotli-level");
+        }
+
+        if(options.exist("http2-stream-window-size")) {
+            this->http2_stream_window_size = options.get<size_t>("http2-stream-window-size");
+        }
+
         if(options.exist("healthy-read-lag")) {
             this->healthy_read_lag = options.get<size_t>("healthy-read-lag");
         }
@@ -610,6 +1125,22 @@ public:
             this->log_slow_requests_time_ms = options.get<int>("log-slow-requests-time-ms");
         }
 
+        if(options.exist("log-slow-searches-time-ms")) {
+            this->log_slow_searches_time_ms = options.get<int>("log-slow-searches-time-ms");
+        }
+
+        if(options.exist("slow-searches-sample-ratio")) {
+            this->slow_searches_sample_ratio = options.get<float>("slow-searches-sample-ratio");
+        }
+
+        if(options.exist("trace-export-url")) {
+            this->trace_export_url = options.get<std::string>("trace-export-url");
+        }
+
+        if(options.exist("trace-sample-ratio")) {
+            this->trace_sample_ratio = options.get<float>("trace-sample-ratio");
+        }
+
         if(options.exist("num-collections-parallel-load")) {
             this->num_collections_parallel_load = options.get<uint32_t>("num-collections-parallel-load");
         }
@@ -622,6 +1153,30 @@ public:
             this->thread_pool_size = options.get<uint32_t>("thread-pool-size");
         }
 
+        if(options.exist("indexing-concurrency")) {
+            this->indexing_concurrency = options.get<uint32_t>("indexing-concurrency");
+        }
+
+        if(options.exist("collection-hibernation-idle-s")) {
+            this->collection_hibernation_idle_s = options.get<uint32_t>("collection-hibernation-idle-s");
+        }
+
+        if(options.exist("posting-compaction-rate")) {
+            this->posting_compaction_rate = options.get<uint32_t>("posting-compaction-rate");
+        }
+
+        if(options.exist("static-rank-seq-ids")) {
+            this->static_rank_seq_ids = options.get<bool>("static-rank-seq-ids");
+        }
+
+        if(options.exist("shared-vocabulary")) {
+            this->shared_vocabulary = options.get<bool>("shared-vocabulary");
+        }
+
+        if(options.exist("hot-queries")) {
+            this->num_hot_queries = options.get<uint32_t>("hot-queries");
+        }
+
         if(options.exist("ssl-refresh-interval-seconds")) {
             this->ssl_refresh_interval_seconds = options.get<uint32_t>("ssl-refresh-interval-seconds");
         }
@@ -633,6 +1188,34 @@ public:
         if(options.exist("disk-used-max-percentage")) {
             this->disk_used_max_percentage = options.get<int>("disk-used-max-percentage");
         }
+
+        if(options.exist("db-block-cache-size-mb")) {
+            this->db_block_cache_size_mb = options.get<uint32_t>("db-block-cache-size-mb");
+        }
+
+        if(options.exist("db-share-block-cache")) {
+            this->db_share_block_cache = options.get<bool>("db-share-block-cache");
+        }
+
+        if(options.exist("db-compression")) {
+            this->db_compression = options.get<std::string>("db-compression");
+        }
+
+        if(options.exist("db-bottommost-compression")) {
+            this->db_bottommost_compression = options.get<std::string>("db-bottommost-compression");
+        }
+
+        if(options.exist("db-bloom-bits-per-key")) {
+            this->db_bloom_bits_per_key = options.get<uint32_t>("db-bloom-bits-per-key");
+        }
+
+        if(options.exist("db-compaction-rate-limit-mb")) {
+            this->db_compaction_rate_limit_mb = options.get<uint32_t>("db-compaction-rate-limit-mb");
+        }
+
+        if(options.exist("db-compaction-direct-io")) {
+            this->db_compaction_direct_io = options.get<bool>("db-compaction-direct-io");
+        }
     }
 
     void set_cors_domains(std::string& cors_domains_value) {
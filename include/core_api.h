@@ -30,6 +30,10 @@ bool get_export_documents(const std::shared_ptr<http_req>& req, const std::share
 
 bool post_add_document(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
 
+// applies `post_add_document()` requests to the same collection with the same parameters as a single batch
+void post_add_documents(const std::vector<std::shared_ptr<http_req>>& reqs,
+                        const std::vector<std::shared_ptr<http_res>>& ress);
+
 bool patch_update_document(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
 
 bool post_import_documents(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
@@ -102,6 +106,8 @@ bool get_metrics_json(const std::shared_ptr<http_req>& req, const std::shared_pt
 
 bool get_stats_json(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
 
+bool get_metrics_text(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
+
 bool get_status(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
 
 // operations
@@ -114,6 +120,10 @@ bool post_config(const std::shared_ptr<http_req>& req, const std::shared_ptr<htt
 
 bool post_clear_cache(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
 
+bool post_dump_collection(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
+
+bool post_restore_collection(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res);
+
 // Misc helpers
 
 void get_collections_for_auth(std::map<std::string, std::string>& req_params, const std::string& body,
@@ -2,7 +2,11 @@
 
 #include <cstdlib>
 #include <vector>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 #include "collection.h"
+#include "http_data.h"
 
 struct deletion_state_t {
     Collection* collection;
@@ -17,7 +21,21 @@ struct deletion_state_t {
     }
 };
 
+// a range of the documents of a collection, read off an iterator of its own
+struct export_range_t {
+    rocksdb::Iterator* it = nullptr;
+
+    // the range ends before this seq_id key, or with the collection's keys when empty
+    std::string end_key;
+
+    // the documents read off the range for the current batch
+    std::string body;
+};
+
 struct export_state_t {
+    // ranges read at once by an unfiltered export
+    static constexpr size_t MAX_PARALLELISM = 16;
+
     Collection* collection;
     std::vector<std::pair<size_t, uint32_t*>> index_ids;
     std::vector<size_t> offsets;
@@ -27,16 +45,56 @@ struct export_state_t {
 
     bool filtered_export = false;
 
-    rocksdb::Iterator* it = nullptr;
+    // documents go out as a stream of MessagePack maps, instead of as lines of JSON
+    bool is_msgpack = false;
+
+    // documents per streamed chunk
+    size_t batch_size = 100;
+
+    // an unfiltered export reads the seq_id keys of the collection range by range: with more than one range, the
+    // ranges are read in parallel and the documents come out of order
+    std::vector<export_range_t> ranges;
+    std::string seq_id_prefix;
 
     ~export_state_t() {
         for(auto& kv: index_ids) {
             delete [] kv.second;
         }
 
-        delete it;
+        for(auto& range: ranges) {
+            delete range.it;
+        }
     }
 };
 
+// Lets identical searches that arrive while one of them runs share its response, instead of all running at once. The
+// first search of a hash runs, and those that arrive meanwhile wait for it in `join()`: its response is handed over
+// when its flight goes out of scope, however the search ends.
+class search_flight_t {
+private:
+    static std::mutex flights_mutex;
+    static std::unordered_map<uint64_t, std::shared_future<cached_res_t>> flights;
+
+    const uint64_t req_hash;
+    const std::shared_ptr<http_res>& res;
+    bool is_leader = false;
+
+    std::promise<cached_res_t> promise;
+    std::shared_future<cached_res_t> future;
+
+public:
+    search_flight_t(uint64_t req_hash, const std::shared_ptr<http_res>& res);
+
+    ~search_flight_t();
+
+    // false when this is the first search of the hash, which must run, and true once the response of the running
+    // search has been copied into `res`
+    bool join();
+};
+
 Option<bool> stateful_remove_docs(deletion_state_t* deletion_state, size_t batch_size, bool& done);
-Option<bool> stateful_export_docs(export_state_t* export_state, size_t batch_size, bool& done);
\ No newline at end of file
+Option<bool> stateful_export_docs(export_state_t* export_state, size_t batch_size, bool& done);
+
+// splits the seq_ids of the collection into `num_ranges` ranges of as many ids, each with an iterator that does not
+// fill the block cache, since an export reads every document once
+void init_export_ranges(export_state_t* export_state, Store* store, size_t num_ranges);
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <functional>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "json.hpp"
+
+enum document_encoding_t {
+    JSON_ENCODING,
+    COMPACT_ENCODING
+};
+
+/*
+ *  Encoding of the documents of a collection on disk.
+ *
+ *  - JSON:     the document's JSON text
+ *  - Compact:  a marker byte followed by the MessagePack of an array of (key id, value) pairs, one pair per top level
+ *              key of the document. Key ids index a dictionary of the collection's top level keys, which only grows
+ *              and is persisted next to the documents (`Collection::get_document_keys_key()`). Nested objects keep
+ *              their keys as they are.
+ *
+ *  Decoding tells the two apart by the first byte, since a JSON document always starts with '{'.
+ */
+class document_codec_t {
+private:
+    static constexpr char COMPACT_MARKER = 0x01;
+
+    const document_encoding_t encoding;
+
+    mutable std::shared_mutex mutex;
+    std::vector<std::string> keys;
+    std::unordered_map<std::string, uint32_t> key_ids;
+
+public:
+    static constexpr const char* JSON_NAME = "json";
+    static constexpr const char* COMPACT_NAME = "compact";
+
+    static bool parse(const std::string& name, document_encoding_t& encoding);
+
+    static std::string name(document_encoding_t encoding);
+
+    explicit document_codec_t(document_encoding_t encoding = JSON_ENCODING);
+
+    document_encoding_t get_encoding() const;
+
+    // dictionary of keys as persisted
+    std::string serialize_keys() const;
+
+    bool load_keys(const std::string& serialized_keys);
+
+    // keys of `document` that are not in the dictionary yet are added to it, and `persist_keys` is called with the
+    // serialized dictionary before any document can be encoded with them: false when persisting failed
+    bool encode(const nlohmann::json& document, std::string& out,
+                const std::function<bool(const std::string&)>& persist_keys);
+
+    // `document` is discarded when the value could not be decoded
+    bool decode(const char* data, size_t size, nlohmann::json& document) const;
+
+    bool decode(const std::string& value, nlohmann::json& document) const {
+        return decode(value.data(), value.size(), document);
+    }
+};
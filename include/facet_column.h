@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "sparsepp.h"
+
+/*
+ *  Values of a single valued facet field, dictionary encoded and laid out by seq_id: each distinct facet hash gets
+ *  an ordinal, and a document holds the ordinal of its value. Counting the values over a result set is then an
+ *  array load and an increment of a dense array per id, instead of a hash lookup to find the values of the document
+ *  and another to find their count.
+ *
+ *  Ordinals are never reclaimed: a value that no document holds anymore just counts to zero.
+ */
+class facet_column_t {
+private:
+    // ordinal => facet hash
+    std::vector<uint64_t> ordinal_hashes;
+    spp::sparse_hash_map<uint64_t, uint32_t> hash_ordinals;
+
+    // seq_id => ordinal + 1, or 0 for no value
+    std::vector<uint32_t> doc_ordinals;
+
+    size_t num_docs = 0;
+
+public:
+    // replaces an existing value of `seq_id`
+    void set(uint32_t seq_id, uint64_t facet_hash);
+
+    void erase(uint32_t seq_id);
+
+    // number of ordinals handed out
+    [[nodiscard]] size_t num_values() const;
+
+    // number of documents with a value
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+
+    [[nodiscard]] uint64_t get_hash(uint32_t ordinal) const;
+
+    // Adds the number of `ids` holding each ordinal to `counts` and records the last of them in `last_ids`. Both
+    // must have room for `num_values()` entries.
+    void count(const uint32_t* ids, size_t num_ids, uint32_t* counts, uint32_t* last_ids) const;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "sparsepp.h"
+#include "tsl/htrie_map.h"
+
+/*
+ *  Distinct values of a facet field keyed by their facet hash, along with a trie over the tokens of the values. The
+ *  values let facet counts be returned without reading a document, while the trie answers a facet query (a search
+ *  within the facet values) from the values alone, instead of searching the field and intersecting the matched
+ *  documents with the result ids.
+ *
+ *  A value is dropped along with the last (document, value) pair that has its hash.
+ */
+class facet_value_index_t {
+private:
+    struct value_t {
+        // the value as last indexed, since differently formatted values can share a facet hash
+        std::string value;
+
+        // distinct tokens, which determine the hash
+        std::vector<std::string> tokens;
+
+        uint32_t num_occurrences = 0;
+    };
+
+    spp::sparse_hash_map<uint64_t, value_t> values;
+
+    // token => hashes of the values having it
+    tsl::htrie_map<char, std::vector<uint64_t>> token_hashes;
+
+public:
+    [[nodiscard]] bool contains(uint64_t facet_hash) const;
+
+    // `tokens` are only looked at when the hash is new
+    void insert(uint64_t facet_hash, const std::string& value, const std::vector<std::string>& tokens);
+
+    void remove(uint64_t facet_hash);
+
+    [[nodiscard]] bool get_value(uint64_t facet_hash, std::string& value) const;
+
+    // number of distinct values
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+
+    // adds the hashes of the values having all of `query_tokens`, the last one as a prefix, to `hash_tokens` along
+    // with the tokens they were matched on (the full token for the prefix)
+    void search(const std::vector<std::string>& query_tokens,
+                std::unordered_map<uint64_t, std::vector<std::string>>& hash_tokens) const;
+};
@@ -8,6 +8,7 @@
 #include "logger.h"
 #include <sparsepp.h>
 #include "json.hpp"
+#include "vector_index.h"
 
 namespace field_types {
     // first field value indexed will determine the type
@@ -40,6 +41,9 @@ namespace fields {
     static const std::string sort = "sort";
     static const std::string infix = "infix";
     static const std::string locale = "locale";
+    static const std::string num_dim = "num_dim";
+    static const std::string vec_dist = "vec_dist";
+    static const std::string vec_quantization = "vec_quantization";
 }
 
 struct field {
@@ -52,6 +56,11 @@ struct field {
     bool sort;
     bool infix;
 
+    // a `float[]` field of `num_dim` values is a vector, indexed for nearest neighbour lookups
+    size_t num_dim = 0;
+    vector_distance_type_t vec_dist = vector_distance_type_t::cosine;
+    bool vec_int8 = false;
+
     field() {}
 
     field(const std::string &name, const std::string &type, const bool facet, const bool optional = false,
@@ -124,6 +133,10 @@ struct field {
         return facet;
     }
 
+    bool is_vector() const {
+        return num_dim != 0;
+    }
+
     bool is_array() const {
         return (type == field_types::STRING_ARRAY || type == field_types::INT32_ARRAY ||
                 type == field_types::FLOAT_ARRAY ||
@@ -252,6 +265,14 @@ struct field {
 
             field_val[fields::locale] = field.locale;
 
+            if(field.is_vector()) {
+                field_val[fields::num_dim] = field.num_dim;
+                field_val[fields::vec_dist] = vector_index_t::get_distance_type_name(field.vec_dist);
+                if(field.vec_int8) {
+                    field_val[fields::vec_quantization] = "int8";
+                }
+            }
+
             fields_json.push_back(field_val);
 
             if(!field.has_valid_type()) {
@@ -522,6 +543,15 @@ public:
         double dist = EARTH_RADIUS * rdist;
         return dist * METER_CONVERT;
     }
+
+    // angle between two points that `distance()` reports to be `meters` apart, before rounding
+    static double meters_to_radians(double meters) {
+        return meters / (EARTH_RADIUS * METER_CONVERT);
+    }
+
+    // `distance()` of each of the packed points from `reference`, computed in blocks: the points are unpacked for
+    // the whole block before the haversine terms are worked out, so that both loops are free of calls into S2
+    static void distances(const int64_t* lat_lngs, size_t num_lat_lngs, const S2LatLng& reference, int64_t* out);
 };
 
 struct facet_count_t {
@@ -538,10 +568,21 @@ struct facet_stats_t {
             fvsum = 0;
 };
 
+// bucket of a range facet, over the values of the numerical column of its field within [min, max]
+struct facet_range_t {
+    std::string label;
+    int64_t min = INT64_MIN + 1;
+    int64_t max = INT64_MAX;
+    uint32_t count = 0;
+};
+
 struct facet {
     const std::string field_name;
     spp::sparse_hash_map<uint64_t, facet_count_t> result_map;
 
+    // a range facet (`facet_by=price(0..50,50..)`) is counted into its buckets instead of `result_map`
+    std::vector<facet_range_t> ranges;
+
     // used for facet value query
     spp::sparse_hash_map<uint64_t, std::vector<std::string>> hash_tokens;
 
@@ -550,6 +591,9 @@ struct facet {
 
     facet_stats_t stats;
 
+    // counts (and stats) are estimated from a sample of the result ids
+    bool is_sampled = false;
+
     explicit facet(const std::string& field_name): field_name(field_name) {
 
     }
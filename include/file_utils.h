@@ -15,4 +15,7 @@ bool rename_path(const std::string& from_path, const std::string& to_path);
 
 bool delete_path(const std::string& path, bool recursive = true);
 
-bool dir_enum_count(const std::string & path);
\ No newline at end of file
+bool dir_enum_count(const std::string & path);
+
+// "<crc32c>_<size>" of the contents of the file
+bool file_checksum(const std::string& file_path, std::string& checksum);
\ No newline at end of file
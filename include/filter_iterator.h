@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "id_bitmap.h"
+
+/*
+ *  Lazily evaluated tree of filter results: leaves hold the ids matched by a single clause (as a sorted array or
+ *  as an id bitmap), while AND, OR and NOT nodes combine their children one id at a time with `skip_to()`, so that
+ *  the combined result is never materialized unless `to_ids()` is called.
+ */
+class filter_iterator_t {
+public:
+    enum node_type_t {
+        IDS,
+        BITMAP,
+        AND,
+        OR,
+        NOT
+    };
+
+private:
+    node_type_t type;
+
+    // IDS
+    const uint32_t* ids = nullptr;
+    size_t ids_length = 0;
+    size_t ids_index = 0;
+    bool owns_ids = false;
+
+    // BITMAP
+    std::shared_ptr<const id_bitmap_t> bitmap;
+
+    // AND, OR and NOT (which has a single child)
+    std::vector<filter_iterator_t> children;
+
+    // NOT yields the ids in [0, end_id) that its child does not
+    uint32_t end_id = 0;
+
+    uint32_t curr_id = 0;
+    bool is_valid = false;
+
+    explicit filter_iterator_t(node_type_t type);
+
+    // moves an AND node forward until all of its children agree on an id that is >= `id`
+    void and_align(uint32_t id);
+
+    void or_update();
+
+    void not_align(uint32_t id);
+
+public:
+    filter_iterator_t(filter_iterator_t&& rhs) noexcept;
+    filter_iterator_t& operator=(filter_iterator_t&& rhs) noexcept;
+    ~filter_iterator_t() noexcept;
+
+    filter_iterator_t(const filter_iterator_t&) = delete;
+    filter_iterator_t& operator=(const filter_iterator_t&) = delete;
+
+    // `ids` must be sorted; with `take_ownership`, they are freed along with the iterator
+    static filter_iterator_t new_ids_iterator(const uint32_t* ids, size_t ids_length, bool take_ownership);
+
+    static filter_iterator_t new_bitmap_iterator(std::shared_ptr<const id_bitmap_t> bitmap);
+
+    // an AND or an OR of a single iterator is that iterator itself
+    static filter_iterator_t new_and_iterator(std::vector<filter_iterator_t>&& children);
+
+    static filter_iterator_t new_or_iterator(std::vector<filter_iterator_t>&& children);
+
+    static filter_iterator_t new_not_iterator(filter_iterator_t&& child, uint32_t end_id);
+
+    [[nodiscard]] node_type_t get_type() const;
+
+    [[nodiscard]] bool valid() const;
+
+    [[nodiscard]] uint32_t id() const;
+
+    void next();
+
+    // moves to the first id that is >= `id`, never backwards
+    void skip_to(uint32_t id);
+
+    // for probing with ascending ids only: moves the iterator up to `id`
+    bool contains(uint32_t id);
+
+    // upper bound on the number of ids that the iterator yields
+    [[nodiscard]] size_t estimate_size() const;
+
+    // allocates `out` with the ids that are left, which exhausts the iterator
+    size_t to_ids(uint32_t** out);
+
+    // copy of the iterator at its current position that borrows the ids of this one, so that it can be moved on its
+    // own (e.g. on another thread) for as long as this iterator is alive
+    [[nodiscard]] filter_iterator_t clone() const;
+
+    // skips to `range_start` and appends the ids up to `range_end` (inclusive) to `out`
+    void range_ids(uint32_t range_start, uint32_t range_end, std::vector<uint32_t>& out);
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <s2/s2latlng.h>
+#include <s2/s2region.h>
+#include <s2/s2cell_union.h>
+
+/*
+ *  Points of a geopoint field packed into an array ordered by their leaf S2 cell id, so that the points within a
+ *  cell make up a contiguous range of the array. A region is then looked up as the ranges of the cells covering it,
+ *  and the nearest points to a location are found by growing a cap around it until enough points fall inside.
+ *
+ *  Inserted points are buffered and merged into the array by the first lookup that follows, so that indexing a batch
+ *  of documents does not shift the array once per point.
+ */
+class geo_point_index_t {
+private:
+    struct entry_t {
+        uint64_t cell_id;
+        uint32_t seq_id;
+        int64_t lat_lng;  // as packed by `GeoPoint::pack_lat_lng()`
+
+        bool operator<(const entry_t& other) const {
+            return (cell_id != other.cell_id) ? (cell_id < other.cell_id) : (seq_id < other.seq_id);
+        }
+    };
+
+    mutable std::vector<entry_t> entries;
+
+    mutable std::vector<entry_t> pending;
+    mutable std::atomic<bool> has_pending;
+    mutable std::mutex pending_mutex;
+
+    // bumped on every insert and remove
+    uint64_t version = 0;
+
+    // lookups run concurrently with each other but never with a write
+    void merge_pending() const;
+
+    template<class T>
+    void scan_region(const S2CellUnion& covering, T&& on_entry) const;
+
+public:
+    geo_point_index_t();
+
+    // an id holds one point per value (array fields hold many)
+    void insert(uint32_t seq_id, int64_t lat_lng);
+
+    void remove(uint32_t seq_id, int64_t lat_lng);
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+
+    [[nodiscard]] uint64_t get_version() const;
+
+    // cells looked up for `region`, which depend on the region alone
+    static S2CellUnion get_covering(const S2Region& region);
+
+    // sorted ids having a point in the cells that cover `region`: a superset of the ids with a point inside it
+    void region_ids(const S2Region& region, std::vector<uint32_t>& ids) const;
+
+    // same as above for the covering of a region
+    void region_ids(const S2CellUnion& covering, std::vector<uint32_t>& ids) const;
+
+    // number of points in the cells of `covering`, which bounds the number of ids `region_ids()` finds in them
+    [[nodiscard]] size_t num_points(const S2CellUnion& covering) const;
+
+    // sorted ids of the `k` points among `filter_ids` (sorted) that are closest to `center` as measured by
+    // `GeoPoint::distance()`, along with any id at the same distance as the farthest of them; fewer when not enough
+    // of the ids have a point
+    void nearest(const S2LatLng& center, size_t k, const uint32_t* filter_ids, size_t filter_ids_length,
+                 std::vector<uint32_t>& ids) const;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ *  Points of a geopoint array field laid out contiguously: each id holds a run of `points` made of its number of
+ *  points followed by the points themselves (packed by `GeoPoint::pack_lat_lng()`), which an offset indexed by
+ *  seq_id leads to.
+ *
+ *  Replacing or erasing the points of an id leaves its old run behind as dead, and dead runs are compacted away once
+ *  they make up half of the column.
+ */
+class geo_points_column_t {
+private:
+    std::vector<int64_t> points;
+
+    // seq_id => offset of its run + 1, or 0 for no points
+    std::vector<uint32_t> offsets;
+
+    size_t num_ids = 0;
+    size_t num_dead = 0;
+
+    void compact();
+
+public:
+    // replaces the existing points of `seq_id`
+    void set(uint32_t seq_id, const int64_t* lat_lngs, size_t num_lat_lngs);
+
+    void erase(uint32_t seq_id);
+
+    // run of `seq_id`, starting with its number of points, or nullptr; valid until the column is modified
+    [[nodiscard]] const int64_t* get(uint32_t seq_id) const;
+
+    // number of ids having points
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+};
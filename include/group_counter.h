@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "sparsepp.h"
+
+/*
+ *  Number of distinct groups (distinct keys) of a `group_by` search, which stands for its `found`.
+ *
+ *  The keys are kept until there are `EXACT_MAX_GROUPS` of them, for an exact count. Past that, they are folded into
+ *  a HyperLogLog sketch of `NUM_REGISTERS` registers, so that a search matching many groups neither keeps every key
+ *  nor merges the keys of its threads one by one: the count is then an estimate, off by about 1% either way.
+ */
+class group_counter_t {
+private:
+    static constexpr size_t PRECISION = 14;
+    static constexpr size_t NUM_REGISTERS = size_t(1) << PRECISION;
+
+    spp::sparse_hash_set<uint64_t> keys;
+
+    // empty while the keys are counted exactly
+    std::vector<uint8_t> registers;
+
+    void add_to_registers(uint64_t key);
+
+    void to_registers();
+
+public:
+    static constexpr size_t EXACT_MAX_GROUPS = 4096;
+
+    void emplace(uint64_t key);
+
+    void merge(const group_counter_t& other);
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] bool is_exact() const {
+        return registers.empty();
+    }
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "option.h"
+
+struct hot_query_t {
+    std::map<std::string, std::string> params;
+    uint64_t count = 0;
+};
+
+/*
+    The most frequent searches of the node, saved to a file every now and then so that they can be replayed once the
+    collections are loaded on start up: the caches of the collections (and the page cache, for the documents of their
+    hits) are then warm by the time the node takes traffic.
+
+    Searches are counted with the space saving algorithm: a search that is not counted yet takes the place of the
+    least counted one when the log is full, starting off from its count. `TRACKED_PER_KEPT` times as many searches are
+    counted as are kept, so that the kept ones are rarely off. A search that finds the log locked is not counted,
+    rather than waiting for it.
+*/
+class HotQueryLog {
+private:
+    std::mutex mutex;
+    std::unordered_map<uint64_t, hot_query_t> queries;
+
+    std::atomic<size_t> max_queries{0};
+    std::string path;
+
+public:
+    static constexpr size_t TRACKED_PER_KEPT = 4;
+    static constexpr uint64_t SAVE_INTERVAL_S = 60;
+
+    static HotQueryLog& get_instance() {
+        static HotQueryLog instance;
+        return instance;
+    }
+
+    HotQueryLog() = default;
+
+    HotQueryLog(HotQueryLog const&) = delete;
+    void operator=(HotQueryLog const&) = delete;
+
+    // keeps the `max_queries` most frequent searches, saving them to `path` (0 disables the log)
+    void init(const std::string& path, size_t max_queries);
+
+    bool is_enabled() const {
+        return max_queries != 0;
+    }
+
+    const std::string& get_path() const {
+        return path;
+    }
+
+    // counts a search by its parameters, leaving out `secret_param` (the API key)
+    void record(const std::map<std::string, std::string>& req_params, const std::string& secret_param);
+
+    // the kept searches, the most frequent first
+    std::vector<hot_query_t> get_hot_queries();
+
+    // writes the kept searches to the path of the log, one JSON object per line as in the slow query log
+    Option<bool> save();
+
+    static Option<bool> read(const std::string& path, std::vector<hot_query_t>& hot_queries);
+
+    void clear();
+};
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <map>
+#include <mutex>
 #include <curl/curl.h>
 #include "http_data.h"
 #include "http_server.h"
@@ -14,6 +15,17 @@ private:
     static std::string api_key;
     static std::string ca_cert_path;
 
+    // Connections and DNS lookups shared by the handles of all threads, so that requests forwarded to the leader
+    // reuse kept-alive connections instead of connecting afresh every time.
+    static CURLSH* share;
+    static std::mutex share_mutexes[CURL_LOCK_DATA_LAST];
+
+    static void share_lock(CURL* curl, curl_lock_data data, curl_lock_access access, void* userptr);
+
+    static void share_unlock(CURL* curl, curl_lock_data data, void* userptr);
+
+    static void set_shared_options(CURL* curl);
+
     HttpClient() = default;
 
     ~HttpClient() = default;
@@ -22,7 +34,8 @@ private:
 
     static size_t curl_write_async(char *buffer, size_t size, size_t nmemb, void* context);
 
-    static size_t curl_write_async_done(void* context, curl_socket_t item);
+    // sends the end of a forwarded response, once its transfer is done
+    static void curl_write_async_done(deferred_req_res_t* req_res);
 
     static CURL* init_curl(const std::string& url, std::string& response);
 
@@ -52,6 +65,11 @@ public:
     static long post_response(const std::string & url, const std::string & body, std::string & response,
                               std::map<std::string, std::string>& res_headers, long timeout_ms=4000);
 
+    // posts to a service outside of the cluster: without the api key and without forcing HTTP/2
+    static long post_external_response(const std::string& url, const std::string& body,
+                                       const std::string& content_type, std::string& response,
+                                       long timeout_ms=4000);
+
     static long post_response_async(const std::string &url, const std::shared_ptr<http_req> request,
                                     const std::shared_ptr<http_res> response,
                                     HttpServer* server);
@@ -12,6 +12,7 @@
 #include "logger.h"
 #include "app_metrics.h"
 #include "config.h"
+#include "tracer.h"
 
 #define H2O_USE_LIBUV 0
 extern "C" {
@@ -176,6 +177,9 @@ struct cached_res_t {
     uint32_t ttl;
     uint64_t hash;
 
+    // (collection name, write generation) of every collection searched, as of before the search ran
+    std::vector<std::pair<std::string, uint64_t>> write_generations;
+
     bool operator == (const cached_res_t& res) const {
         return hash == res.hash;
     }
@@ -203,6 +207,18 @@ struct ip_addr_str_t {
 struct http_req {
     static constexpr const char* AUTH_HEADER = "x-typesense-api-key";
     static constexpr const char* AGENT_HEADER = "user-agent";
+    static constexpr const char* ACCEPT_HEADER = "accept";
+
+    // results of searches and exports are encoded as MessagePack instead of as JSON when the request asks for it,
+    // either with `response_format=msgpack` or with an `Accept` header naming the MessagePack content type
+    static constexpr const char* RESPONSE_FORMAT = "response_format";
+    static constexpr const char* MSGPACK_FORMAT = "msgpack";
+    static constexpr const char* MSGPACK_CONTENT_TYPE = "application/msgpack";
+
+    static bool is_msgpack_format(const std::map<std::string, std::string>& params) {
+        const auto format_it = params.find(RESPONSE_FORMAT);
+        return format_it != params.end() && format_it->second == MSGPACK_FORMAT;
+    }
 
     h2o_req_t* _req;
     std::string http_method;
@@ -233,6 +249,9 @@ struct http_req {
 
     int64_t log_index;
 
+    // of this request on this node, which its spans are children of (see `Tracer`)
+    trace_context_t trace_context;
+
     std::atomic<bool> is_http_v1;
     std::atomic<bool> is_diposed;
     std::string client_ip = "0.0.0.0";
@@ -276,8 +295,22 @@ struct http_req {
 
             std::string metric_identifier = http_method + " " + path_without_query;
             AppMetrics::get_instance().increment_duration(metric_identifier, ms_since_start);
+            AppMetrics::get_instance().record_latency(metric_identifier, now - start_ts);
             AppMetrics::get_instance().increment_write_metrics(route_hash, ms_since_start);
 
+            if(trace_context.sampled) {
+                span_record_t span;
+                span.trace_id_high = trace_context.trace_id_high;
+                span.trace_id_low = trace_context.trace_id_low;
+                span.span_id = trace_context.span_id;
+                span.parent_span_id = trace_context.parent_span_id;
+                span.name = metric_identifier;
+                span.start_ns = start_ts * 1000;
+                span.end_ns = now * 1000;
+                span.is_server = true;
+                Tracer::get_instance().record(std::move(span));
+            }
+
             if(config.get_log_slow_requests_time_ms() >= 0 && int(ms_since_start) >= config.get_log_slow_requests_time_ms()) {
                 // log slow request if logging is enabled
                 std::string query_string = "?";
@@ -315,11 +348,14 @@ struct http_req {
         nlohmann::json content = nlohmann::json::parse(serialized_content);
         route_hash = content["route_hash"];
 
-        if(start_ts == 0) {
-            // Serialized request from an older version (v0.21 and below) which serializes import data differently.
-            body = content["body"];
+        std::string& content_body = content["body"].get_ref<std::string&>();
+
+        if(start_ts == 0 || body.empty()) {
+            // A serialized request from an older version (v0.21 and below) carries the whole body. Otherwise, the
+            // chunk is moved in unless it continues a partial record left over from the previous chunk.
+            body = std::move(content_body);
         } else {
-            body += content["body"];
+            body += content_body;
         }
 
         for (nlohmann::json::iterator it = content["params"].begin(); it != content["params"].end(); ++it) {
@@ -331,6 +367,10 @@ struct http_req {
         last_chunk_aggregate = content.count("last_chunk_aggregate") != 0 ? content["last_chunk_aggregate"].get<bool>() : false;
         start_ts = content.count("start_ts") != 0 ? content["start_ts"].get<uint64_t>() : 0;
         log_index = content.count("log_index") != 0 ? content["log_index"].get<int64_t>() : 0;
+
+        if(content.count("traceparent") != 0) {
+            trace_context_t::parse_traceparent(content["traceparent"].get<std::string>(), trace_context);
+        }
     }
 
     std::string to_json() const {
@@ -344,6 +384,10 @@ struct http_req {
         content["start_ts"] = start_ts;
         content["log_index"] = log_index;
 
+        if(trace_context.sampled) {
+            content["traceparent"] = trace_context.to_traceparent();
+        }
+
         return content.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
     }
 
@@ -166,6 +166,7 @@ private:
     h2o_socket_t* listener_socket;
 
     static const size_t ACTIVE_STREAM_WINDOW_SIZE = 196605;
+    const size_t http2_stream_window_size;
     static const size_t REQ_TIMEOUT_MS = 60000;
 
     const uint64_t SSL_REFRESH_INTERVAL_MS;
@@ -203,6 +204,12 @@ private:
 
     ThreadPool* meta_thread_pool;
 
+    // searches run on this pool when it is set, and on `thread_pool` otherwise
+    ThreadPool* search_thread_pool;
+
+    // searches queued or running on `thread_pool`, which new searches are turned away beyond
+    std::atomic<size_t> num_pending_searches;
+
     bool (*auth_handler)(std::map<std::string, std::string>& params,
                          std::vector<nlohmann::json>& embedded_params_vec,
                          const std::string& body, const route_path& rpath,
@@ -246,7 +253,9 @@ public:
                const std::string & ssl_cert_key_path,
                const uint64_t ssl_refresh_interval_ms,
                bool cors_enabled, const std::set<std::string>& cors_domains,
-               ThreadPool* thread_pool);
+               ThreadPool* thread_pool, size_t compression_min_bytes = 256,
+               int gzip_level = 1, int brotli_level = 0,
+               size_t http2_stream_window_size = ACTIVE_STREAM_WINDOW_SIZE);
 
     ~HttpServer();
 
@@ -309,6 +318,11 @@ public:
 
     ThreadPool* get_meta_thread_pool() const;
 
+    void set_search_thread_pool(ThreadPool* search_thread_pool);
+
+    // null unless searches have a pool of their own
+    ThreadPool* get_search_thread_pool() const;
+
     static constexpr const char* STOP_SERVER_MESSAGE = "STOP_SERVER";
     static constexpr const char* STREAM_RESPONSE_MESSAGE = "STREAM_RESPONSE";
     static constexpr const char* REQUEST_PROCEED_MESSAGE = "REQUEST_PROCEED";
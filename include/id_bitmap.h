@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ *  Immutable set of sorted ids, held either as a sorted array or as a bitmap, whichever takes less memory.
+ *  Dense sets (e.g. the result of `in_stock: true`) become bitmaps, which are also cheaper to intersect with.
+ */
+class id_bitmap_t {
+private:
+    size_t num_ids = 0;
+
+    // exactly one of these is populated for a non-empty set
+    std::vector<uint32_t> ids;
+    std::vector<uint64_t> words;
+
+public:
+    id_bitmap_t() = default;
+
+    id_bitmap_t(const uint32_t* sorted_ids, size_t length);
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] bool is_bitmap() const;
+
+    [[nodiscard]] bool contains(uint32_t id) const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+
+    // finds the smallest id of the set that is >= `id`
+    bool next_id(uint32_t id, uint32_t& found_id) const;
+
+    // allocates `out` and fills it with all the ids of the set
+    size_t to_ids(uint32_t** out) const;
+
+    // allocates `out` and fills it with the ids of sorted `ids_in` that are also in the set
+    size_t and_ids(const uint32_t* ids_in, size_t length, uint32_t** out) const;
+};
@@ -2,10 +2,9 @@
 
 #include <map>
 #include <unordered_map>
+#include "block_index.h"
 #include "sorted_array.h"
 
-typedef uint32_t last_id_t;
-
 /*
     Compressed chain of blocks that store the document IDs and offsets of a given token.
     Offsets of singular and multi-valued fields are encoded differently.
@@ -82,8 +81,7 @@ private:
 
     // keeps track of the *last* ID in each block and is used for partial random access
     // e.g. 0..[9], 10..[19], 20..[29]
-    // MUST be ordered
-    std::map<last_id_t, block_t*> id_block_map;
+    block_index_t<block_t> id_block_map;
 
     static bool at_end(const std::vector<id_list_t::iterator_t>& its);
     static bool at_end2(const std::vector<id_list_t::iterator_t>& its);
@@ -120,8 +118,19 @@ public:
 
     size_t num_ids() const;
 
+    // merges partially filled blocks into full ones, returns the number of blocks freed
+    size_t compact();
+
+    // whether erasures left a quarter more blocks than the IDs need
+    [[nodiscard]] bool is_fragmented() const;
+
+    // heap memory held by the list and its blocks
+    size_t memory_bytes() const;
+
     uint32_t first_id();
 
+    uint32_t last_id();
+
     block_t* block_of(uint32_t id);
 
     bool contains(uint32_t id);
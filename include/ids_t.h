@@ -4,6 +4,7 @@
 #include <vector>
 #include "id_list.h"
 #include "threadpool.h"
+#include "compact_list_arena.h"
 
 #define IS_COMPACT_IDS(x) (((uintptr_t)(x) & 1))
 #define SET_COMPACT_IDS(x) ((void*)((uintptr_t)(x) | 1))
@@ -18,10 +19,17 @@ struct compact_id_list_t {
     // format: id1, id2,...
     uint32_t ids[];
 
+    static size_t size_bytes(size_t capacity) {
+        return sizeof(compact_id_list_t) + (capacity * sizeof(uint32_t));
+    }
+
+    // lists are allocated from `CompactListArena`, so they must only be released through `destroy()`
     static compact_id_list_t* create(uint32_t num_ids, const std::vector<uint32_t>& ids);
 
     static compact_id_list_t* create(uint32_t num_ids, const uint32_t* ids);
 
+    static void destroy(compact_id_list_t* list);
+
     [[nodiscard]] id_list_t* to_full_ids_list() const;
 
     bool contains(uint32_t id);
@@ -89,8 +97,16 @@ public:
 
     static void destroy_list(void*& obj);
 
+    // compact lists are always packed
+    static bool is_fragmented(const void* obj);
+
+    // repacks a fragmented `id_list_t`, returns the number of blocks freed
+    static size_t compact(void* obj);
+
     static uint32_t num_ids(const void* obj);
 
+    static size_t memory_bytes(const void* obj);
+
     static uint32_t first_id(const void* obj);
 
     static bool contains(const void* obj, uint32_t id);
@@ -145,7 +161,8 @@ bool ids_t::block_intersector_t::intersect(T func, size_t concurrency) {
 
         num_non_empty++;
 
-        thread_pool->enqueue([this, i, &func, &partial_its, &num_processed, &m_process, &cv_process]() {
+        thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::SEARCH,
+                                  [this, i, &func, &partial_its, &num_processed, &m_process, &cv_process]() {
             auto iter_state_copy = iter_state;
             iter_state_copy.index = i;
             id_list_t::block_intersect<T>(partial_its, iter_state_copy, func);
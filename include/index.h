@@ -6,6 +6,8 @@
 #include <mutex>
 #include <shared_mutex>
 #include <condition_variable>
+#include <atomic>
+#include <memory>
 #include <art.h>
 #include <number.h>
 #include <sparsepp.h>
@@ -15,24 +17,43 @@
 #include <field.h>
 #include <option.h>
 #include <set>
+#include <unordered_set>
+#include <istream>
+#include <ostream>
 #include "string_utils.h"
 #include "num_tree.h"
 #include "magic_enum.hpp"
 #include "match_score.h"
 #include "posting_list.h"
+#include "posting_codec.h"
+#include "query_plan.h"
+#include "search_profile.h"
 #include "threadpool.h"
 #include "adi_tree.h"
-#include "tsl/htrie_set.h"
+#include "bigram_filter.h"
+#include "group_counter.h"
 #include <tsl/htrie_map.h>
 #include "id_list.h"
 #include "synonym_index.h"
+#include "lru/lru.hpp"
+#include "thread_local_vars.h"
+#include "search_arena.h"
+#include "id_bitmap.h"
+#include "filter_iterator.h"
+#include "str_value_index.h"
+#include "facet_column.h"
+#include "facet_value_index.h"
+#include "geo_point_index.h"
+#include "geo_points_column.h"
+#include "infix_index.h"
+#include "sort_column.h"
+#include "vector_index.h"
+#include "index_snapshot.h"
 
 static constexpr size_t ARRAY_FACET_DIM = 4;
 using facet_map_t = spp::sparse_hash_map<uint32_t, facet_hash_values_t>;
 using array_mapped_facet_t = std::array<facet_map_t*, ARRAY_FACET_DIM>;
 
-static constexpr size_t ARRAY_INFIX_DIM = 4;
-using array_mapped_infix_t = std::vector<tsl::htrie_set<char>*>;
 
 struct token_t {
     size_t position;
@@ -64,6 +85,9 @@ struct tok_candidates {
     size_t cost;
     bool prefix_search;
     std::vector<std::string> candidates;
+
+    // hash of each candidate, which stands for it in the hashes of the queries made from the candidates
+    std::vector<uint64_t> candidate_hashes;
 };
 
 struct search_field_t {
@@ -333,6 +357,10 @@ struct search_args {
     bool prioritize_exact_match;
     bool prioritize_token_position;
     size_t all_result_ids_len;
+
+    // estimated number of matches that were skipped by top-k pruning, and so are not in `all_result_ids_len`
+    size_t num_pruned_ids = 0;
+
     bool exhaustive_search;
     size_t concurrency;
     size_t search_cutoff_ms;
@@ -345,15 +373,35 @@ struct search_args {
     const size_t facet_query_num_typos;
     const bool filter_curated_hits;
     const enable_t split_join_tokens;
+    const bool enable_top_k_pruning;
+    const bool explain;
+    const size_t facet_sample_percent;
+    const size_t facet_sample_threshold;
     tsl::htrie_map<char, token_leaf> qtoken_set;
 
-    spp::sparse_hash_set<uint64_t> groups_processed;
+    group_counter_t groups_processed;
     std::vector<std::vector<art_leaf*>> searched_queries;
+
+    // temporaries of the search, held until the results are built off the topsters
+    search_arena_t arena;
+
     Topster* topster;
     Topster* curated_topster;
     std::vector<std::vector<KV*>> raw_result_kvs;
     std::vector<std::vector<KV*>> override_result_kvs;
 
+    // filled only when `explain` is enabled
+    query_plan_t query_plan;
+
+    // empty field name when the search has no vector query
+    vector_query_t vector_query;
+
+    // filled only when `profile` is enabled
+    search_profile_t profile;
+
+    // lets the search be abandoned once it has run past `search_cutoff_ms` or its client has disconnected
+    search_cancel_token_t cancel_token;
+
     search_args(std::vector<query_tokens_t> field_query_tokens, std::vector<search_field_t> search_fields,
                 std::vector<filter> filters, std::vector<facet>& facets,
                 std::vector<std::pair<uint32_t, uint32_t>>& included_ids, std::vector<uint32_t> excluded_ids,
@@ -366,7 +414,9 @@ struct search_args {
                 size_t concurrency, size_t search_cutoff_ms,
                 size_t min_len_1typo, size_t min_len_2typo, size_t max_candidates, const std::vector<enable_t>& infixes,
                 const size_t max_extra_prefix, const size_t max_extra_suffix, const size_t facet_query_num_typos,
-                const bool filter_curated_hits, const enable_t split_join_tokens) :
+                const bool filter_curated_hits, const enable_t split_join_tokens,
+                const bool enable_top_k_pruning, const bool explain,
+                const size_t facet_sample_percent = 100, const size_t facet_sample_threshold = 0) :
             field_query_tokens(field_query_tokens),
             search_fields(search_fields), filters(filters), facets(facets),
             included_ids(included_ids), excluded_ids(excluded_ids), sort_fields_std(sort_fields_std),
@@ -380,11 +430,16 @@ struct search_args {
             min_len_1typo(min_len_1typo), min_len_2typo(min_len_2typo), max_candidates(max_candidates),
             infixes(infixes), max_extra_prefix(max_extra_prefix), max_extra_suffix(max_extra_suffix),
             facet_query_num_typos(facet_query_num_typos), filter_curated_hits(filter_curated_hits),
-            split_join_tokens(split_join_tokens) {
+            split_join_tokens(split_join_tokens), enable_top_k_pruning(enable_top_k_pruning),
+            explain(explain), facet_sample_percent(facet_sample_percent),
+            facet_sample_threshold(facet_sample_threshold) {
 
         const size_t topster_size = std::max((size_t)1, max_hits);  // needs to be atleast 1 since scoring is mandatory
-        topster = new Topster(topster_size, group_limit);
-        curated_topster = new Topster(topster_size, group_limit);
+        topster = new Topster(topster_size, group_limit, &arena);
+        curated_topster = new Topster(topster_size, group_limit, &arena);
+
+        // the groups beyond the hits asked for never make it to the response (curated hits are all kept)
+        topster->groups.set_max_groups(topster_size);
     }
 
     ~search_args() {
@@ -408,9 +463,40 @@ enum class DIRTY_VALUES {
     COERCE_OR_DROP = 4,
 };
 
+// distinct tokens of a field value, in the order of their first occurrence
 struct offsets_facet_hashes_t {
-    std::unordered_map<std::string, std::vector<uint32_t>> offsets;
+    std::vector<std::string> tokens;
+    std::vector<std::vector<uint32_t>> offsets;     // offsets of the token at the same index
     std::vector<uint64_t> facet_hashes;
+
+    // hashes of the pairs of tokens that follow one another, for the bigram filter of a singular string field
+    std::vector<uint64_t> bigram_hashes;
+
+    // position of the last token of a singular field, i.e. the number of tokens that a query must have to match it
+    // exactly
+    uint32_t num_tokens = 0;
+};
+
+// Interns the tokens of all the field values tokenized by a preprocessing thread, so that the tokens of a value are
+// deduplicated without building a map for every single value.
+struct token_offsets_builder_t {
+private:
+    // token => id
+    std::unordered_map<std::string, uint32_t> token_ids;
+
+    // for each id, the value it was last found in and its index among the tokens of that value
+    std::vector<size_t> id_values;
+    std::vector<uint32_t> id_slots;
+
+    size_t value_stamp = 0;
+    offsets_facet_hashes_t* value_offsets = nullptr;
+
+public:
+    // tokens that follow are collected into `offsets`
+    void reset(offsets_facet_hashes_t& offsets);
+
+    // index of `token` among the tokens of the current value, which it is added to on its first occurrence
+    uint32_t get_slot(const std::string& token);
 };
 
 struct index_record {
@@ -440,6 +526,13 @@ struct index_record {
 
     }
 
+    index_record(size_t record_pos, uint32_t seq_id, nlohmann::json&& doc, index_operation_t operation,
+                 const DIRTY_VALUES& dirty_values):
+            position(record_pos), seq_id(seq_id), doc(std::move(doc)), operation(operation), is_update(false),
+            indexed(false), dirty_values(dirty_values) {
+
+    }
+
     index_record(index_record&& rhs) = default;
 
     index_record& operator=(index_record&& mE) = default;
@@ -453,6 +546,68 @@ struct index_record {
     }
 };
 
+// Leaves of an unfiltered `art_fuzzy_search`, valid for as long as the tree remains at `tree_version`
+struct token_leaves_t {
+    uint64_t tree_version = 0;
+
+    // leaves were not truncated by the lookup's `max_words`, so excluded leaves can be filtered out afterwards
+    bool complete = false;
+
+    std::vector<art_leaf*> leaves;
+};
+
+// Intersections of tokens that a search comes back to: every candidate (and typo correction) of the last token of a
+// query is intersected with the same tokens before it, and a round that drops the last token of the query intersects
+// what earlier rounds had before it. Such an intersection is done once, on its second use, after which the
+// combinations that hold it are intersected off its ids alone. Only valid for the filter and exclusions of one search.
+struct intersection_memo_t {
+    // ids of all the memoized intersections together
+    static constexpr size_t MAX_NUM_IDS = 1000000;
+
+    struct entry_t {
+        size_t num_uses = 0;
+        bool computed = false;
+        std::vector<uint32_t> ids;
+    };
+
+    // tokens along with the fields whose posting lists they were intersected in => entry
+    std::unordered_map<std::string, entry_t> entries;
+    size_t num_ids = 0;
+};
+
+// Ids matched by a single filter clause, valid for as long as the index remains at `write_generation`
+struct filter_result_t {
+    uint64_t write_generation = 0;
+    std::shared_ptr<const id_bitmap_t> ids;
+};
+
+struct facet_result_t {
+    uint64_t write_generation = 0;
+    std::shared_ptr<const std::vector<facet>> facets;
+};
+
+// A dynamic filter override resolved against the tokens of a query, valid for as long as the index remains at
+// `write_generation`: the filters that its placeholders were bound to and the query tokens they took up
+struct override_resolution_t {
+    uint64_t write_generation = 0;
+    bool resolved = false;
+    bool filters_parsed = false;
+    std::vector<filter> filters;
+    std::set<std::string> absorbed_tokens;
+};
+
+class S2Loop;
+class S2Cap;
+
+// A geo polygon filter value parsed into its loop and covering, along with the ids having a point inside the loop
+// while the geopoint field remains at `version` (null until they are computed)
+struct geo_polygon_t {
+    std::shared_ptr<const S2Loop> loop;
+    std::shared_ptr<const S2CellUnion> covering;
+    uint64_t version = 0;
+    std::shared_ptr<const id_bitmap_t> ids;
+};
+
 class Index {
 private:
     mutable std::shared_mutex mutex;
@@ -469,28 +624,70 @@ private:
 
     size_t num_documents;
 
+    // arena of the allocator that the structures of the index are allocated off once it holds
+    // `DEDICATED_ARENA_MIN_DOCUMENTS` documents, so that their pages are not shared with other indices and are
+    // returned to the OS as soon as the index is freed
+    unsigned arena;
+
     std::unordered_map<std::string, field> search_schema;
 
     spp::sparse_hash_map<std::string, art_tree*> search_index;
 
     spp::sparse_hash_map<std::string, num_tree_t*> numerical_index;
 
-    spp::sparse_hash_map<std::string, spp::sparse_hash_map<std::string, std::vector<uint32_t>>*> geopoint_index;
+    spp::sparse_hash_map<std::string, geo_point_index_t*> geopoint_index;
+
+    spp::sparse_hash_map<std::string, vector_index_t*> vector_index;
 
     // geo_array_field => (seq_id => values) used for exact filtering of geo array records
-    spp::sparse_hash_map<std::string, spp::sparse_hash_map<uint32_t, int64_t*>*> geo_array_index;
+    spp::sparse_hash_map<std::string, geo_points_column_t*> geo_array_index;
 
     // facet_field => (seq_id => values)
     spp::sparse_hash_map<std::string, array_mapped_facet_t> facet_index_v3;
 
     // sort_field => (seq_id => value)
-    spp::sparse_hash_map<std::string, spp::sparse_hash_map<uint32_t, int64_t>*> sort_index;
+    spp::sparse_hash_map<std::string, sort_column_t*> sort_index;
 
     // str_sort_field => adi_tree_t
     spp::sparse_hash_map<std::string, adi_tree_t*> str_sort_index;
 
+    // string facet field => exact values, for equality filters
+    spp::sparse_hash_map<std::string, str_value_index_t*> str_value_index;
+
+    // facet field => (seq_id => combined hash of the field's facet values), for grouping
+    spp::sparse_hash_map<std::string, sort_column_t*> group_hash_index;
+
+    // singular string field => (seq_id => number of tokens), so that exact matches are told apart before looking at
+    // the offsets of the tokens
+    spp::sparse_hash_map<std::string, sort_column_t*> token_count_index;
+
+    // single valued facet field => dictionary encoded values, for counting facets over large result sets
+    spp::sparse_hash_map<std::string, facet_column_t*> facet_columns;
+
+    // facet field => distinct values, so that facet values can be returned and searched without reading documents
+    spp::sparse_hash_map<std::string, facet_value_index_t*> facet_value_indices;
+
     // infix field => value
-    spp::sparse_hash_map<std::string, array_mapped_infix_t> infix_index;
+    spp::sparse_hash_map<std::string, infix_index_t*> infix_index;
+
+    // singular string field => pairs of adjacent tokens, for ruling out splits of query tokens without reading postings
+    spp::sparse_hash_map<std::string, bigram_filter_t*> bigram_filters;
+
+    // token => ids of the string fields that have it (see `vocabulary_field_ids`), when `shared-vocabulary` is on
+    art_tree* vocabulary = nullptr;
+
+    // string field => id within `vocabulary`, never handed out again within the index
+    spp::sparse_hash_map<std::string, uint32_t> vocabulary_field_ids;
+    uint32_t next_vocabulary_field_id = 0;
+
+    // the fields of a batch are indexed on many threads, all of which add their tokens to `vocabulary`
+    std::mutex vocabulary_mutex;
+
+    // string field => tokens whose posting lists were left fragmented by removals, for `compact_postings()`
+    spp::sparse_hash_map<std::string, std::unordered_set<std::string>> tokens_to_compact;
+
+    // fields whose trees were restored off an index snapshot, which are therefore skipped by tokenization
+    std::unordered_set<std::string> restored_fields;
 
     // this is used for wildcard queries
     id_list_t* seq_ids;
@@ -501,15 +698,50 @@ private:
 
     StringUtils string_utils;
 
+    // (field, token, typo cost, prefix) => leaves of recent tree lookups, since autocomplete repeats the same prefixes
+    mutable std::mutex token_leaves_cache_mutex;
+    mutable LRU::Cache<std::string, token_leaves_t> token_leaves_cache;
+
+    // bumped on every write, so that cached filter results computed before it are ignored
+    std::atomic<uint64_t> write_generation;
+
+    // filter clause => matched ids, since most requests of an application repeat the same few filters
+    mutable std::mutex filter_result_cache_mutex;
+    mutable LRU::Cache<std::string, filter_result_t> filter_result_cache;
+
+    // (facet spec, result ids) => computed facets, since paginating through a result set repeats its faceting
+    mutable std::mutex facet_result_cache_mutex;
+    mutable LRU::Cache<std::string, facet_result_t> facet_result_cache;
+
+    // (field, polygon) => parsed polygon and its matching ids, since a handful of polygons make up most geo filters
+    mutable std::mutex geo_polygon_cache_mutex;
+    mutable LRU::Cache<std::string, geo_polygon_t> geo_polygon_cache;
+
+    // (override, query tokens) => resolved dynamic filter override, since merchandising rules fire on most queries
+    // and resolving their placeholders searches the fields they name
+    mutable std::mutex override_resolution_cache_mutex;
+    mutable LRU::Cache<std::string, override_resolution_t> override_resolution_cache;
+
     // used as sentinels
 
-    static spp::sparse_hash_map<uint32_t, int64_t> text_match_sentinel_value;
-    static spp::sparse_hash_map<uint32_t, int64_t> seq_id_sentinel_value;
-    static spp::sparse_hash_map<uint32_t, int64_t> geo_sentinel_value;
-    static spp::sparse_hash_map<uint32_t, int64_t> str_sentinel_value;
+    static sort_column_t text_match_sentinel_value;
+    static sort_column_t seq_id_sentinel_value;
+    static sort_column_t geo_sentinel_value;
+    static sort_column_t str_sentinel_value;
+
+    // every facet shard points here until a document with a value lands in it, so that the many small collections
+    // of a node do not pay for `ARRAY_FACET_DIM` maps per facet field up front
+    static facet_map_t empty_facet_map;
 
     // Internal utility functions
 
+    static array_mapped_facet_t new_facet_array();
+
+    static void delete_facet_array(array_mapped_facet_t& facet_array);
+
+    // requires a unique lock, or none when the structures are not shared yet
+    void acquire_arena_when_large(size_t num_docs);
+
     static inline uint32_t next_suggestion2(const std::vector<tok_candidates>& token_candidates_vec,
                                             long long int n,
                                             std::vector<token_t>& query_suggestion,
@@ -530,6 +762,9 @@ private:
                    size_t group_limit, const std::vector<std::string>& group_by_fields,
                    const uint32_t* result_ids, size_t results_size) const;
 
+    // counts the result ids into the buckets of a range facet, off the sort column of its field
+    void count_facet_ranges(facet& a_facet, const uint32_t* result_ids, size_t results_size) const;
+
     bool static_filter_query_eval(const override_t* override, std::vector<std::string>& tokens,
                                   std::vector<filter>& filters) const;
 
@@ -538,6 +773,11 @@ private:
                           token_ordering token_order, std::set<std::string>& absorbed_tokens,
                           std::string& filter_by_clause) const;
 
+    // `resolve_override()` of a dynamic filter override and the filters it binds, off `override_resolution_cache`
+    override_resolution_t resolve_dynamic_override(const override_t* override,
+                                                   const std::vector<std::string>& query_tokens,
+                                                   token_ordering token_order) const;
+
     bool check_for_overrides(const token_ordering& token_order, const string& field_name, bool slide_window,
                              bool exact_rule_match, std::vector<std::string>& tokens,
                              std::set<std::string>& absorbed_tokens,
@@ -545,6 +785,32 @@ private:
 
     static void aggregate_topster(Topster* agg_topster, Topster* index_topster);
 
+    // `art_fuzzy_search` on the tree of the given field, served from `token_leaves_cache`: with a filter, off the
+    // cached leaves when all of them are cached
+    void search_token_leaves(const std::string& field_name, const std::string& token, const size_t token_len,
+                             const int cost, const size_t max_words, const token_ordering token_order,
+                             const bool prefix_search, const uint32_t* filter_ids, const size_t filter_ids_length,
+                             std::vector<art_leaf*>& leaves, const std::set<std::string>& exclude_leaves) const;
+
+    // the leaves of the searched fields for `token` at `cost`, off a single `art_fuzzy_search` of `vocabulary` (one
+    // for each way of prefix searching the token that the fields ask for), in the order that each field would have
+    // found them in
+    void search_vocabulary_leaves(const std::vector<search_field_t>& the_fields, const size_t num_search_fields,
+                                  const token_t& token, const int cost, const std::vector<uint32_t>& num_typos,
+                                  const std::vector<bool>& prefixes, const size_t max_words,
+                                  const token_ordering token_order,
+                                  const uint32_t* filter_ids, const size_t filter_ids_length,
+                                  std::vector<art_leaf*>& leaves, const std::set<std::string>& exclude_leaves) const;
+
+    void add_to_vocabulary(const std::string& field_name, const unsigned char* key, int key_len, int64_t score);
+
+    void remove_from_vocabulary(const std::string& field_name, const unsigned char* key, int key_len);
+
+    // adds (or removes) all the tokens of the field's tree, for a tree that was not built token by token
+    void add_tree_to_vocabulary(const std::string& field_name, art_tree* t);
+
+    void remove_tree_from_vocabulary(const std::string& field_name, art_tree* t);
+
     void search_field(const uint8_t & field_id,
                       const std::vector<token_t>& query_tokens,
                       const uint32_t* exclude_token_ids,
@@ -557,7 +823,7 @@ private:
                       int last_typo,
                       int max_typos,
                       std::vector<std::vector<art_leaf*>> & searched_queries,
-                      Topster* topster, spp::sparse_hash_set<uint64_t>& groups_processed,
+                      Topster* topster, group_counter_t& groups_processed,
                       uint32_t** all_result_ids, size_t & all_result_ids_len,
                       size_t& field_num_results,
                       size_t group_limit,
@@ -583,7 +849,7 @@ private:
                                std::vector<std::vector<art_leaf*>>& searched_queries,
                                tsl::htrie_map<char, token_leaf>& qtoken_set,
                                Topster* topster,
-                               spp::sparse_hash_set<uint64_t>& groups_processed,
+                               group_counter_t& groups_processed,
                                uint32_t*& all_result_ids, size_t& all_result_ids_len,
                                const size_t typo_tokens_threshold,
                                const size_t group_limit,
@@ -597,10 +863,14 @@ private:
                                const size_t max_candidates,
                                int syn_orig_num_tokens,
                                const int* sort_order,
-                               std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
+                               std::array<sort_column_t*, 3>& field_values,
                                const std::vector<size_t>& geopoint_indices,
                                std::set<uint64>& query_hashes,
-                               std::vector<uint32_t>& id_buff) const;
+                               intersection_memo_t* intersection_memo,
+                               std::vector<uint32_t>& id_buff,
+                               const size_t concurrency,
+                               const bool enable_top_k_pruning,
+                               query_plan_t* query_plan) const;
 
     void search_candidates(const uint8_t & field_id,
                            bool field_is_array,
@@ -609,7 +879,7 @@ private:
                            const std::vector<uint32_t>& curated_ids,
                            const std::vector<sort_by> & sort_fields, std::vector<token_candidates> & token_to_candidates,
                            std::vector<std::vector<art_leaf*>> & searched_queries,
-                           Topster* topster, spp::sparse_hash_set<uint64_t>& groups_processed,
+                           Topster* topster, group_counter_t& groups_processed,
                            uint32_t** all_result_ids,
                            size_t & all_result_ids_len,
                            size_t& field_num_results,
@@ -623,8 +893,46 @@ private:
                            std::set<uint64>& query_hashes,
                            std::vector<uint32_t>& id_buff) const;
 
+    // upper bound on the number of documents matched by a filter clause, used to order the clauses
+    size_t estimate_filter_num_ids(const filter& a_filter) const;
+
+    // region of a geo radius filter value, split into x, y, radius and unit
+    static S2Cap get_geo_filter_cap(const std::vector<std::string>& filter_value_parts);
+
+    // loop and covering of a geo polygon filter value (split into its coordinates) from `geo_polygon_cache`, which
+    // they are parsed into on a miss; false for an invalid polygon
+    bool get_geo_polygon(const std::string& field_name, const std::string& filter_value,
+                         const std::vector<std::string>& filter_value_parts, geo_polygon_t& polygon) const;
+
+    // combined filters expected to yield at least these many ids are collected range by range on `thread_pool`
+    static constexpr size_t PARALLEL_FILTER_MIN_IDS = 1 << 18;
+
+    // number of ids of a wildcard query that are scored together
+    static constexpr size_t SORT_BATCH_SIZE = 256;
+
+    // facets are counted from a facet column unless it has more than these many distinct values per result id
+    static constexpr size_t FACET_COLUMN_MAX_VALUES_PER_ID = 4;
+
+    // the pages of a smaller index are better shared with others, since an arena holds partial pages of its own
+    static constexpr size_t DEDICATED_ARENA_MIN_DOCUMENTS = 10000;
+
+    // shares of the latency budget of a search (see `search_budget_ms`) after which its stages give up on their
+    // costliest options, with what they fall back to
+    static constexpr double BUDGET_MAX_CANDIDATES_SHARE = 0.25;
+    static constexpr size_t BUDGET_MAX_CANDIDATES = 2;
+    static constexpr double BUDGET_TYPOS_SHARE = 0.5;
+    static constexpr double BUDGET_INFIX_SHARE = 0.5;
+    static constexpr double BUDGET_FACETS_SHARE = 0.6;
+    static constexpr size_t BUDGET_FACET_SAMPLE_PERCENT = 10;
+    static constexpr size_t BUDGET_FACET_SAMPLE_THRESHOLD = 10000;
+
+    // Collects the ids of `filter_it` into `filter_ids`. Large results are split into `concurrency` ranges of
+    // seq_ids of equal width, each of which is collected from a clone of the iterator on `thread_pool`.
+    void collect_filter_ids(filter_iterator_t& filter_it, const size_t concurrency,
+                            uint32_t*& filter_ids, uint32_t& filter_ids_length) const;
+
     void do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length, const std::vector<filter>& filters,
-                      const bool enable_short_circuit) const;
+                      const bool enable_short_circuit, const size_t concurrency = 1) const;
 
     void insert_doc(const int64_t score, art_tree *t, uint32_t seq_id,
                     const std::unordered_map<std::string, std::vector<uint32_t>> &token_to_offsets) const;
@@ -632,15 +940,15 @@ private:
     static void tokenize_string_with_facets(const std::string& text, bool is_facet, const field& a_field,
                                             const std::vector<char>& symbols_to_index,
                                             const std::vector<char>& token_separators,
-                                            std::unordered_map<std::string, std::vector<uint32_t>>& token_to_offsets,
-                                            std::vector<uint64_t>& facet_hashes);
+                                            token_offsets_builder_t& token_offsets_builder,
+                                            offsets_facet_hashes_t& offset_facet_hashes);
 
     static void tokenize_string_array_with_facets(const std::vector<std::string>& strings, bool is_facet,
                                            const field& a_field,
                                            const std::vector<char>& symbols_to_index,
                                            const std::vector<char>& token_separators,
-                                           std::unordered_map<std::string, std::vector<uint32_t>>& token_to_offsets,
-                                           std::vector<uint64_t>& facet_hashes);
+                                           token_offsets_builder_t& token_offsets_builder,
+                                           offsets_facet_hashes_t& offset_facet_hashes);
 
     void collate_included_ids(const std::vector<token_t>& q_included_tokens,
                               const std::map<size_t, std::map<size_t, uint32_t>> & included_ids_map,
@@ -648,7 +956,21 @@ private:
 
     static uint64_t facet_token_hash(const field & a_field, const std::string &token);
 
-    static void compute_facet_stats(facet &a_facet, uint64_t raw_value, const std::string & field_type);
+    // facet hash of an entire string value, as computed when the value is indexed
+    static uint64_t string_facet_hash(const field& a_field, const std::string& text,
+                                      const std::vector<char>& symbols_to_index,
+                                      const std::vector<char>& token_separators);
+
+    // text of a single value of a facet field (an element of an array field), as tokenized for its facet hash
+    static std::string facet_token_text(const field& a_field, const nlohmann::json& value);
+
+    // `facet_hashes` are those computed for `field_value` when the document was indexed
+    void index_facet_values(const field& afield, const nlohmann::json& field_value,
+                            const std::vector<uint64_t>& facet_hashes,
+                            facet_value_index_t* facet_value_index) const;
+
+    static void compute_facet_stats(facet &a_facet, uint64_t raw_value, const std::string & field_type,
+                                    size_t num_occurrences = 1);
 
     static void get_doc_changes(const index_operation_t op, nlohmann::json &update_doc,
                                 const nlohmann::json &old_doc, nlohmann::json &new_doc, nlohmann::json &del_doc);
@@ -682,6 +1004,13 @@ private:
 
     bool common_results_exist(std::vector<art_leaf*>& leaves, bool must_match_phrase) const;
 
+    // token count column of the field, or null when it has none (e.g. for arrays)
+    const sort_column_t* get_token_counts(const std::string& field_name) const;
+
+    // drops the ids whose field is known to have other than `num_tokens` tokens, as they cannot match it exactly
+    static void filter_by_token_count(const sort_column_t* token_counts, const size_t num_tokens,
+                                      uint32_t* ids, size_t& num_ids);
+
 public:
     // for limiting number of results on multiple candidates / query rewrites
     enum {TYPO_TOKENS_THRESHOLD = 1};
@@ -693,6 +1022,38 @@ public:
     enum {COMBINATION_MIN_LIMIT = 10};
     enum {MAX_CANDIDATES_DEFAULT = 4};
 
+    // estimated (candidate ids x query_by fields) beyond which candidates are scored on multiple threads
+    enum {PARALLEL_FIELDS_SEARCH_MIN_WORK = 1 << 16};
+
+    enum {TOKEN_LEAVES_CACHE_CAPACITY = 1000};
+
+    // larger lookups are rarely repeated and would make the cache too heavy
+    enum {TOKEN_LEAVES_CACHE_MAX_LEAVES = 1000};
+
+    enum {FILTER_RESULT_CACHE_CAPACITY = 128};
+
+    enum {FACET_RESULT_CACHE_CAPACITY = 128};
+
+    enum {GEO_POLYGON_CACHE_CAPACITY = 64};
+
+    enum {OVERRIDE_RESOLUTION_CACHE_CAPACITY = 256};
+
+    // a polygon's ids are computed for caching unless they are this many times more than the preceding results
+    enum {GEO_POLYGON_MAX_CANDIDATES_RATIO = 4};
+
+    // the nearest ids are looked up for a geo sort only when they are a small part of the ids to be ranked
+    enum {GEO_NEAREST_MIN_RATIO = 8};
+
+    // likewise for the ids with the top values of a numerical sort field
+    enum {SORTED_TOP_IDS_MIN_RATIO = 8};
+
+    // filters that leave at most this many ids are searched for nearest vectors exhaustively, as a graph
+    // lookup would have to visit most of the graph to find enough of them
+    enum {VECTOR_EXACT_SEARCH_MAX_IDS = 2048};
+
+    // vector similarities and fused ranks are fractions, scaled up to be held as text match scores
+    static constexpr double VECTOR_SCORE_SCALE = 1e9;
+
     // If the number of results found is less than this threshold, Typesense will attempt to drop the tokens
     // in the query that have the least individual hits one by one until enough results are found.
     static const int DROP_TOKENS_THRESHOLD = 1;
@@ -721,14 +1082,15 @@ public:
                            const bool prioritize_token_position,
                            size_t num_query_tokens,
                            int syn_orig_num_tokens,
-                           const std::vector<posting_list_t::iterator_t>& posting_lists) const;
+                           const std::vector<posting_list_t::iterator_t>& posting_lists,
+                           const sort_column_t* token_counts = nullptr) const;
 
     void score_results(const std::vector<sort_by> &sort_fields, const uint16_t &query_index, const uint8_t &field_id,
                        bool field_is_array, const uint32_t total_cost,
                        Topster *topster, const std::vector<art_leaf *> &query_suggestion,
-                       spp::sparse_hash_set<uint64_t> &groups_processed,
+                       group_counter_t& groups_processed,
                        const uint32_t seq_id, const int sort_order[3],
-                       std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3> field_values,
+                       std::array<sort_column_t*, 3> field_values,
                        const std::vector<size_t>& geopoint_indices,
                        const size_t group_limit,
                        const std::vector<std::string> &group_by_fields, uint32_t token_bits,
@@ -743,7 +1105,7 @@ public:
 
     const spp::sparse_hash_map<std::string, num_tree_t*>& _get_numerical_index() const;
 
-    const spp::sparse_hash_map<std::string, array_mapped_infix_t>& _get_infix_index() const;
+    const spp::sparse_hash_map<std::string, infix_index_t*>& _get_infix_index() const;
 
     static int get_bounded_typo_cost(const size_t max_cost, const size_t token_len,
                                      size_t min_len_1typo, size_t min_len_2typo);
@@ -752,10 +1114,17 @@ public:
 
     uint64_t get_distinct_id(const std::vector<std::string>& group_by_fields, const uint32_t seq_id) const;
 
+    // group hash columns of the given fields, for resolving them once per search instead of once per document
+    std::vector<const sort_column_t*> get_group_columns(const std::vector<std::string>& group_by_fields) const;
+
+    static uint64_t get_distinct_id(const std::vector<const sort_column_t*>& group_columns, const uint32_t seq_id);
+
     static void compute_token_offsets_facets(index_record& record,
                                              const std::unordered_map<std::string, field>& search_schema,
                                              const std::vector<char>& local_token_separators,
-                                             const std::vector<char>& local_symbols_to_index);
+                                             const std::vector<char>& local_symbols_to_index,
+                                             token_offsets_builder_t& token_offsets_builder,
+                                             const std::unordered_set<std::string>& skip_fields);
 
     static void scrub_reindex_doc(const std::unordered_map<std::string, field>& search_schema,
                                   nlohmann::json& update_doc, nlohmann::json& del_doc, const nlohmann::json& old_doc);
@@ -778,7 +1147,7 @@ public:
                 const size_t per_page,
                 const size_t page, const token_ordering token_order, const std::vector<bool>& prefixes,
                 const size_t drop_tokens_threshold, size_t& all_result_ids_len,
-                spp::sparse_hash_set<uint64_t>& groups_processed,
+                group_counter_t& groups_processed,
                 std::vector<std::vector<art_leaf*>>& searched_queries,
                 tsl::htrie_map<char, token_leaf>& qtoken_set,
                 std::vector<std::vector<KV*>>& raw_result_kvs, std::vector<std::vector<KV*>>& override_result_kvs,
@@ -789,13 +1158,26 @@ public:
                 size_t concurrency, size_t search_cutoff_ms, size_t min_len_1typo, size_t min_len_2typo,
                 size_t max_candidates, const std::vector<enable_t>& infixes, const size_t max_extra_prefix,
                 const size_t max_extra_suffix, const size_t facet_query_num_typos,
-                const bool filter_curated_hits, enable_t split_join_tokens) const;
+                const bool filter_curated_hits, enable_t split_join_tokens,
+                const bool enable_top_k_pruning, query_plan_t* query_plan,
+                const size_t facet_sample_percent = 100, const size_t facet_sample_threshold = 0,
+                const vector_query_t& vector_query = vector_query_t()) const;
 
-    void remove_field(uint32_t seq_id, const nlohmann::json& document, const std::string& field_name);
+    // when `token_seq_ids` is given, the tokens of a string field are collected into it (token => seq_ids) instead
+    // of being erased, so that they can be erased for many documents at once by `erase_token_ids()`
+    void remove_field(uint32_t seq_id, const nlohmann::json& document, const std::string& field_name,
+                      std::unordered_map<std::string, std::vector<uint32_t>>* token_seq_ids = nullptr);
+
+    // erases the sorted `seq_ids` from the posting list of `token`, and the token itself once no id is left
+    void erase_token_ids(const field& search_field, const std::string& token,
+                         const std::vector<uint32_t>& seq_ids);
 
     Option<uint32_t> remove(const uint32_t seq_id, const nlohmann::json & document,
                             const std::vector<field>& del_fields, const bool is_update);
 
+    // removes many documents at once: each posting list they share gets a single erase of all their ids
+    void remove(const std::vector<uint32_t>& doc_seq_ids, const std::vector<nlohmann::json>& documents);
+
     static void validate_and_preprocess(Index *index, std::vector<index_record>& iter_batch,
                                           const size_t batch_start_index, const size_t batch_size,
                                           const std::string & default_sorting_field,
@@ -814,6 +1196,21 @@ public:
                                      const std::vector<char>& symbols_to_index,
                                      const bool do_validation);
 
+    // Validation and tokenization of a batch only read the index, so they can run alongside searches:
+    // only `batch_memory_index_preprocessed()` needs exclusive access.
+    static void batch_preprocess(Index *index,
+                                 std::vector<index_record>& iter_batch,
+                                 const std::string& default_sorting_field,
+                                 const std::unordered_map<std::string, field>& search_schema,
+                                 const std::string& fallback_field_type,
+                                 const std::vector<char>& token_separators,
+                                 const std::vector<char>& symbols_to_index,
+                                 const bool do_validation);
+
+    static size_t batch_memory_index_preprocessed(Index *index,
+                                                  std::vector<index_record>& iter_batch,
+                                                  const std::unordered_map<std::string, field>& search_schema);
+
     void index_field_in_memory(const field& afield, std::vector<index_record>& iter_batch);
 
     template<class T>
@@ -832,6 +1229,10 @@ public:
 
     void refresh_schemas(const std::vector<field>& new_fields, const std::vector<field>& del_fields);
 
+    // moves the structures of the given fields over from `other`, which holds the same documents indexed under
+    // them, in place of building them here: the fields must not be part of this index yet
+    void adopt_fields(Index* other, const std::vector<field>& fields);
+
     // the following methods are not synchronized because their parent calls are synchronized or they are const/static
 
     static Option<uint32_t> validate_index_in_memory(nlohmann::json &document, uint32_t seq_id,
@@ -844,7 +1245,7 @@ public:
     void search_wildcard(const std::vector<filter>& filters,
                          const std::map<size_t, std::map<size_t, uint32_t>>& included_ids_map,
                          const std::vector<sort_by>& sort_fields, Topster* topster, Topster* curated_topster,
-                         spp::sparse_hash_set<uint64_t>& groups_processed,
+                         group_counter_t& groups_processed,
                          std::vector<std::vector<art_leaf*>>& searched_queries, const size_t group_limit,
                          const std::vector<std::string>& group_by_fields, const std::set<uint32_t>& curated_ids,
                          const std::vector<uint32_t>& curated_ids_sorted, const uint32_t* exclude_token_ids,
@@ -852,9 +1253,26 @@ public:
                          uint32_t*& all_result_ids, size_t& all_result_ids_len, const uint32_t* filter_ids,
                          uint32_t filter_ids_length, const size_t concurrency,
                          const int* sort_order,
-                         std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
+                         std::array<sort_column_t*, 3>& field_values,
                          const std::vector<size_t>& geopoint_indices) const;
 
+    // (distance, seq_id) of the nearest vectors to the query, closest first, among the filtered ids (when
+    // `is_filtered`) that are not excluded
+    void search_vector(const vector_query_t& vector_query, const uint32_t* filter_ids, uint32_t filter_ids_length,
+                       bool is_filtered, const uint32_t* excluded_ids, size_t excluded_ids_size,
+                       std::vector<std::pair<float, uint32_t>>& dist_ids) const;
+
+    // The nearest vectors are added to the topster as hits scored by their similarity in place of a text match
+    // score. With `fuse_text_hits`, the hits of the text query already in the topster are scored along with them
+    // by fusing the rank of each hit in both lists instead.
+    void add_vector_hits(const vector_query_t& vector_query,
+                         const std::vector<std::pair<float, uint32_t>>& dist_ids, bool fuse_text_hits,
+                         const std::vector<sort_by>& sort_fields, const int* sort_order,
+                         const std::array<sort_column_t*, 3>& field_values,
+                         const std::vector<size_t>& geopoint_indices, Topster* topster,
+                         std::vector<std::vector<art_leaf*>>& searched_queries,
+                         uint32_t*& all_result_ids, size_t& all_result_ids_len) const;
+
     void search_infix(const std::string& query, const std::string& field_name, std::vector<uint32_t>& ids,
                       size_t max_extra_prefix, size_t max_extra_suffix) const;
 
@@ -864,7 +1282,7 @@ public:
 
     void populate_sort_mapping(int* sort_order, std::vector<size_t>& geopoint_indices,
                                const std::vector<sort_by>& sort_fields_std,
-                               std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values) const;
+                               std::array<sort_column_t*, 3>& field_values) const;
 
     static void remove_matched_tokens(std::vector<std::string>& tokens, const std::set<std::string>& rule_token_set) ;
 
@@ -875,11 +1293,64 @@ public:
                              size_t max_candidates,
                              std::vector<facet_info_t>& facet_infos) const;
 
+    // the result ids stand in for the query and filters that produced them, so that equivalent requests share an entry
+    static std::string get_facet_cache_key(const std::vector<facet>& facets, const facet_query_t& facet_query,
+                                           const size_t facet_query_num_typos, const size_t max_candidates,
+                                           const size_t group_limit, const std::vector<std::string>& group_by_fields,
+                                           const size_t facet_sample_percent, const size_t facet_sample_threshold,
+                                           const uint32_t* all_result_ids, const size_t all_result_ids_len,
+                                           const std::vector<uint32_t>& included_ids_vec);
+
     void resolve_space_as_typos(std::vector<std::string>& qtokens, const std::string& field_name,
                                 std::vector<std::vector<std::string>>& resolved_queries) const;
 
     size_t num_seq_ids() const;
 
+    // repacks up to `max_lists` of the posting and id lists that removals fragmented (see `tokens_to_compact` and
+    // `num_tree_t::compact()`), returns the number of lists looked at, which is less than `max_lists` once none are
+    // left: searches wait for it, so it is meant to be called with a small `max_lists` many times over
+    size_t compact_postings(size_t max_lists);
+
+    // false when the value behind the hash is not known, in which case it must be read from a document
+    bool get_facet_value_string(const std::string& field_name, uint64_t facet_hash, std::string& value) const;
+
+    // false when the document has no vector in the field of the query
+    bool get_vector_distance(const vector_query_t& vector_query, uint32_t seq_id, float& distance) const;
+
+    // facet value as returned in the response, given a single value of the field (an element of an array field)
+    static std::string facet_value_to_string(const field& a_field, const nlohmann::json& value);
+
+    // number of postings (token, document pairs) of all searchable fields along with the bytes needed to store
+    // their document IDs with each of `PostingCodec::codecs()`
+    void get_posting_codec_stats(size_t& num_postings, std::vector<size_t>& codec_bytes) const;
+
+    // nodes and leaves of the token trees of all searchable fields
+    void get_search_index_stats(art_tree_stats& stats) const;
+
+    // field => structure => estimated heap bytes held in memory for the field by each structure (named after its
+    // member), with the ids of all documents held under the empty field name
+    void get_memory_stats(std::map<std::string, std::map<std::string, size_t>>& field_structure_bytes) const;
+
+    // bytes in use of the arena of the index (0 until it has one), as reported by the allocator rather than estimated
+    uint64_t get_arena_active_bytes() const;
+
+    // plain string fields, whose tokens are held by their trees alone and can thus be restored off a snapshot
+    static bool is_snapshot_field(const field& a_field);
+
+    // dumps the trees of the snapshot fields, as of the collection's `next_seq_id` and the `store_seq_number` of the
+    // store they were indexed off
+    void save_snapshot(std::ostream& out, uint32_t next_seq_id, uint64_t store_seq_number) const;
+
+    // restores the trees of a snapshot taken at the same `next_seq_id` and `store_seq_number`, before any document is
+    // indexed: the restored fields are then skipped while indexing the documents until `clear_restored_fields()`
+    bool load_snapshot(std::istream& in, uint32_t next_seq_id, uint64_t store_seq_number);
+
+    // `load_snapshot()` of a snapshot whose header was read off `in` already, which can be of another collection
+    // (see `collection_dump_t`): only its fields are checked against the index
+    bool load_snapshot_trees(std::istream& in, const index_snapshot_t& snapshot);
+
+    void clear_restored_fields();
+
     void handle_exclusion(const size_t num_search_fields, std::vector<query_tokens_t>& field_query_tokens,
                           const std::vector<search_field_t>& search_fields, uint32_t*& exclude_token_ids,
                           size_t& exclude_token_ids_size) const;
@@ -892,11 +1363,11 @@ public:
                          const size_t max_extra_suffix, const std::vector<token_t>& query_tokens, Topster* actual_topster,
                          const uint32_t *filter_ids, size_t filter_ids_length,
                          const int sort_order[3],
-                         std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3> field_values,
+                         std::array<sort_column_t*, 3> field_values,
                          const std::vector<size_t>& geopoint_indices,
                          const std::vector<uint32_t>& curated_ids_sorted,
                          uint32_t*& all_result_ids, size_t& all_result_ids_len,
-                         spp::sparse_hash_set<uint64_t>& groups_processed) const;
+                         group_counter_t& groups_processed) const;
 
     void do_synonym_search(const std::vector<search_field_t>& the_fields,
                            const std::vector<filter>& filters,
@@ -915,15 +1386,18 @@ public:
                            Topster* actual_topster,
                            std::vector<std::vector<token_t>>& q_pos_synonyms,
                            int syn_orig_num_tokens,
-                           spp::sparse_hash_set<uint64_t>& groups_processed,
+                           group_counter_t& groups_processed,
                            std::vector<std::vector<art_leaf*>>& searched_queries,
                            uint32_t*& all_result_ids, size_t& all_result_ids_len,
                            const uint32_t* filter_ids, uint32_t filter_ids_length, 
                            std::set<uint64>& query_hashes,
+                           intersection_memo_t* intersection_memo,
                            const int* sort_order,
-                           std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
+                           std::array<sort_column_t*, 3>& field_values,
                            const std::vector<size_t>& geopoint_indices,
-                           tsl::htrie_map<char, token_leaf>& qtoken_set) const;
+                           tsl::htrie_map<char, token_leaf>& qtoken_set,
+                           const bool enable_top_k_pruning,
+                           query_plan_t* query_plan) const;
 
     void do_phrase_search(const size_t num_search_fields, const std::vector<search_field_t>& search_fields,
                           std::vector<query_tokens_t>& field_query_tokens,
@@ -939,12 +1413,13 @@ public:
                              const std::vector<uint32_t>& num_typos,
                              std::vector<std::vector<art_leaf*>>& searched_queries,
                              tsl::htrie_map<char, token_leaf>& qtoken_set,
-                             Topster* topster, spp::sparse_hash_set<uint64_t>& groups_processed,
+                             Topster* topster, group_counter_t& groups_processed,
                              uint32_t*& all_result_ids, size_t& all_result_ids_len,
                              const size_t group_limit, const std::vector<std::string>& group_by_fields,
                              bool prioritize_exact_match,
                              const bool prioritize_token_position,
                              std::set<uint64>& query_hashes,
+                             intersection_memo_t* intersection_memo,
                              const token_ordering token_order,
                              const std::vector<bool>& prefixes,
                              const size_t typo_tokens_threshold,
@@ -954,8 +1429,11 @@ public:
                              size_t min_len_2typo,
                              int syn_orig_num_tokens,
                              const int* sort_order,
-                             std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
-                             const std::vector<size_t>& geopoint_indices) const;
+                             std::array<sort_column_t*, 3>& field_values,
+                             const std::vector<size_t>& geopoint_indices,
+                             const size_t concurrency,
+                             const bool enable_top_k_pruning,
+                             query_plan_t* query_plan) const;
 
     void find_across_fields(const std::vector<token_t>& query_tokens,
                               const size_t num_query_tokens,
@@ -968,6 +1446,13 @@ public:
                               size_t exclude_token_ids_size,
                               std::vector<uint32_t>& id_buff) const;
 
+    // ids in all of the posting lists of the first `num_tokens` tokens (each in any of its fields), within the filter
+    static void intersect_token_plists(const std::vector<std::vector<std::pair<posting_list_t*, uint32_t>>>& token_plists,
+                                       const std::vector<uint32_t>& token_num_ids, const size_t num_tokens,
+                                       const uint32_t* filter_ids, const uint32_t filter_ids_length,
+                                       const uint32_t* exclude_token_ids, const size_t exclude_token_ids_size,
+                                       std::vector<uint32_t>& ids);
+
     void search_across_fields(const std::vector<token_t>& query_tokens,
                               const std::vector<uint32_t>& num_typos,
                               const std::vector<bool>& prefixes,
@@ -975,7 +1460,7 @@ public:
                               const size_t num_search_fields,
                               const std::vector<sort_by>& sort_fields,
                               Topster* topster,
-                              spp::sparse_hash_set<uint64_t>& groups_processed,
+                              group_counter_t& groups_processed,
                               std::vector<std::vector<art_leaf*>>& searched_queries,
                               tsl::htrie_map<char, token_leaf>& qtoken_set,
                               const size_t group_limit,
@@ -988,11 +1473,15 @@ public:
                               const uint32_t* exclude_token_ids,
                               size_t exclude_token_ids_size,
                               const int* sort_order,
-                              std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
+                              std::array<sort_column_t*, 3>& field_values,
                               const std::vector<size_t>& geopoint_indices,
                               std::vector<uint32_t>& id_buff,
+                              intersection_memo_t* intersection_memo,
                               uint32_t*& all_result_ids,
-                              size_t& all_result_ids_len) const;
+                              size_t& all_result_ids_len,
+                              const size_t concurrency,
+                              const bool enable_top_k_pruning,
+                              query_plan_t* query_plan) const;
 
     void
     search_fields(const std::vector<filter>& filters,
@@ -1001,7 +1490,7 @@ public:
                   const size_t min_typo, const std::vector<uint32_t>& num_typos,
                   Topster* topster, Topster* curated_topster, const token_ordering& token_order,
                   const std::vector<bool>& prefixes, const size_t drop_tokens_threshold,
-                  spp::sparse_hash_set<uint64_t>& groups_processed,
+                  group_counter_t& groups_processed,
                   std::vector<std::vector<art_leaf*>>& searched_queries,
                   const size_t typo_tokens_threshold, const size_t group_limit,
                   const std::vector<std::string>& group_by_fields, bool prioritize_exact_match,
@@ -1022,11 +1511,26 @@ public:
                                   std::vector<filter>& filters) const;
 
     void compute_sort_scores(const std::vector<sort_by>& sort_fields, const int* sort_order,
-                             std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3> field_values,
+                             std::array<sort_column_t*, 3> field_values,
                              const std::vector<size_t>& geopoint_indices, uint32_t seq_id,
                              int64_t max_field_match_score,
                              int64_t* scores, int64_t& match_score_index) const;
 
+    // Same as `compute_sort_scores()` for a block of ids: `field_scores[i][j]` is the score of `seq_ids[j]` on the
+    // i-th sort field. The values of each field are gathered for the whole block at once, so the dispatch on the type
+    // of the field happens once per block instead of once per id.
+    void compute_sort_scores_batch(const std::vector<sort_by>& sort_fields, const int* sort_order,
+                                   const std::array<sort_column_t*, 3>& field_values,
+                                   const std::vector<size_t>& geopoint_indices,
+                                   const uint32_t* seq_ids, size_t num_ids, int64_t max_field_match_score,
+                                   std::array<std::vector<int64_t>, 3>& field_scores,
+                                   int64_t& match_score_index) const;
+
+    // distances of `seq_ids` from the reference point of a geo sort field, with its exclude radius and precision
+    // applied; `geopoints` is null for a geopoint array field
+    void compute_geo_distances_batch(const sort_by& sort_field, const sort_column_t* geopoints,
+                                     const uint32_t* seq_ids, size_t num_ids, int64_t* distances) const;
+
     void
     process_curated_ids(const std::vector<std::pair<uint32_t, uint32_t>>& included_ids,
                         const std::vector<uint32_t>& excluded_ids,
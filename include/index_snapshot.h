@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include "art.h"
+
+/*
+ *  Binary dump of the search trees of a collection's plain string fields, written along with every raft snapshot so
+ *  that loading the collection off that snapshot can restore the trees as they were, instead of tokenizing every
+ *  document again. Only the documents written after the snapshot (the raft log tail) are tokenized from scratch.
+ *
+ *  Format: the header, followed by one tree per field in the order of `fields`. A tree is its number of leaves
+ *  followed by the leaves in key order, each as: key_len, key, max_score, num_ids, num_offsets, ids, offset_index
+ *  and offsets, laid out as in `compact_posting_list_t::create()`.
+ *
+ *  A dump is tied to the store it was taken along with by the store's sequence number, and to the documents of the
+ *  collection by its next seq_id, so that it is ignored once either of them has moved on.
+ */
+struct index_snapshot_t {
+    static constexpr uint32_t MAGIC = 0x58495354;  // "TSIX"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t collection_id = 0;
+    uint32_t next_seq_id = 0;
+    uint64_t store_seq_number = 0;
+
+    // (name, type) of the fields whose trees follow the header
+    std::vector<std::pair<std::string, std::string>> fields;
+
+    void write_header(std::ostream& out) const;
+
+    // false when the stream does not hold the header of a snapshot of this version
+    bool read_header(std::istream& in);
+
+    static void write_tree(art_tree* t, std::ostream& out);
+
+    // inserts the leaves of a dumped tree into `t`, which must be empty
+    static bool read_tree(std::istream& in, art_tree* t);
+};
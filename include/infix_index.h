@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "sparsepp.h"
+
+/*
+ *  Substring index over the distinct tokens of an infix field: every token is listed under each of the trigrams
+ *  (3 byte substrings) it contains. The tokens containing a query are then among those listed under all of the
+ *  query's trigrams, so only the intersection of a few lists is checked instead of every token of the field.
+ *
+ *  Queries shorter than a trigram have no lists to intersect and fall back to checking every token.
+ */
+class infix_index_t {
+private:
+    static constexpr size_t GRAM_LEN = 3;
+
+    // token id => token, or empty once erased; ids only grow, which keeps the lists below sorted on insert
+    std::vector<std::string> tokens;
+
+    spp::sparse_hash_map<std::string, uint32_t> token_ids;
+
+    // trigram => ids of the tokens containing it, ascending
+    spp::sparse_hash_map<uint32_t, std::vector<uint32_t>> gram_token_ids;
+
+    size_t num_erased = 0;
+
+    // distinct trigrams of `token`, ascending
+    static void get_grams(const std::string& token, std::vector<uint32_t>& grams);
+
+    static bool is_match(const std::string& token, const std::string& query,
+                         size_t max_extra_prefix, size_t max_extra_suffix);
+
+    // renumbers the tokens once erased ones make up half of the ids
+    void compact();
+
+public:
+    void insert(const std::string& token);
+
+    void erase(const std::string& token);
+
+    // number of distinct tokens
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+
+    // tokens whose first occurrence of `query` has at most `max_extra_prefix` bytes before it and
+    // `max_extra_suffix` bytes after it
+    void search(const std::string& query, size_t max_extra_prefix, size_t max_extra_suffix,
+                std::vector<std::string>& matched_tokens) const;
+};
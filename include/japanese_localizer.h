@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <mutex>
 
 class JapaneseLocalizer {
 private:
@@ -8,6 +9,8 @@ private:
 
     ~JapaneseLocalizer() = default;
 
+    std::mutex mutex;
+
     static void write_data_file(const std::string& base64_data, const std::string& file_name);
 
 public:
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+    Log-linear histogram of latencies in the manner of HDR histograms: each power of two range of values is split
+    into `SUB_BUCKETS` buckets of equal width, so that a recorded value is known to within 1 / `SUB_BUCKETS` of
+    itself (about 3%) regardless of its magnitude. Values past `MAX_VALUE` are recorded as `MAX_VALUE`.
+*/
+struct latency_histogram_t {
+    static constexpr size_t SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+
+    static constexpr size_t MAX_VALUE_BITS = 36;
+    static constexpr uint64_t MAX_VALUE = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+
+    static constexpr size_t NUM_BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // allocated on the first record, since a histogram is kept for each route on each thread
+    std::vector<uint32_t> buckets;
+    uint64_t num_values = 0;
+    uint64_t max_value = 0;
+
+    void record(uint64_t value);
+
+    void merge(const latency_histogram_t& other);
+
+    // value that `percentile` percent of the recorded values are at most, to within the width of its bucket;
+    // 0 when empty
+    [[nodiscard]] uint64_t value_at_percentile(double percentile) const;
+
+    static size_t bucket_index(uint64_t value);
+
+    // largest value that falls into the bucket
+    static uint64_t bucket_max_value(size_t index);
+};
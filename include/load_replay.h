@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "latency_histogram.h"
+#include "option.h"
+
+/*
+    Replays a recorded query log against a running node, to measure its throughput and latency percentiles under a
+    given load.
+
+    In the open loop, search `i` is due `i / rate` seconds after the start whether or not the searches before it have
+    been answered, and its latency is measured from when it was due: a node that stalls shows up in the percentiles
+    instead of only slowing the arrivals down. That needs enough `concurrency` for the rate, since a search waits for
+    a free worker. In the closed loop (a rate of 0), each worker sends its next search as soon as its last one is
+    answered.
+
+    Imports of batches of documents can be sent alongside the searches, at a rate of their own, so that the
+    latencies of searches under writes can be compared with those of a run without them.
+*/
+
+struct replay_request_t {
+    enum kind_t {
+        SEARCH,
+        IMPORT
+    };
+
+    kind_t kind = SEARCH;
+    std::string path;   // along with the query string
+    std::string body;   // sent with a POST when not empty, and otherwise a GET
+};
+
+struct replay_stats_t {
+    uint64_t num_requests = 0;
+    uint64_t num_errors = 0;            // not answered with a 2xx status
+    latency_histogram_t latencies;      // microseconds
+
+    void merge(const replay_stats_t& other);
+
+    nlohmann::json to_json(double duration_s) const;
+};
+
+struct load_replay_config_t {
+    size_t concurrency = 1;
+    double rate = 0;                    // searches per second, or 0 for a closed loop
+    uint64_t duration_ms = 0;           // 0 to stop once the query log has been replayed `num_loops` times
+    size_t num_loops = 1;
+    double import_rate = 0;             // import batches per second
+};
+
+// sends a request and returns the HTTP status code of its response
+typedef std::function<long(const replay_request_t&)> replay_send_fn_t;
+
+class LoadReplayer {
+private:
+    const load_replay_config_t config;
+    const replay_send_fn_t send_fn;
+
+    replay_stats_t search_stats;
+    replay_stats_t import_stats;
+    double duration_s = 0;
+
+public:
+    static constexpr size_t DEFAULT_IMPORT_BATCH_SIZE = 100;
+
+    LoadReplayer(const load_replay_config_t& config, const replay_send_fn_t& send_fn):
+                 config(config), send_fn(send_fn) {}
+
+    // a line of the slow query log (`{"collection": ..., "params": {...}}`), an object with the `path` (and `body`)
+    // of a request, or just a request path
+    static Option<replay_request_t> parse_log_line(const std::string& line);
+
+    static Option<bool> load_query_log(const std::string& path, std::vector<replay_request_t>& requests);
+
+    // batches of `batch_size` documents of a JSONL file, as upserts into `collection`
+    static Option<bool> load_import_batches(const std::string& path, const std::string& collection,
+                                            size_t batch_size, std::vector<replay_request_t>& requests);
+
+    // replays the searches, cycling over them, alongside imports of the batches (again cycling) while the searches
+    // last; blocks until done
+    void run(const std::vector<replay_request_t>& searches, const std::vector<replay_request_t>& imports);
+
+    const replay_stats_t& get_search_stats() const {
+        return search_stats;
+    }
+
+    const replay_stats_t& get_import_stats() const {
+        return import_stats;
+    }
+
+    nlohmann::json get_report() const;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+    Estimates of the heap memory held by standard containers, for reporting the memory used by the index structures.
+    They count the allocated capacity and the usual per-node overheads of the standard library implementations, so
+    they are close to (but not exactly) what the allocator hands out.
+*/
+namespace memory_usage {
+    // heap bytes of a string, which are 0 while it fits in the string itself
+    inline size_t string_bytes(const std::string& str) {
+        return (str.capacity() > std::string().capacity()) ? (str.capacity() + 1) : 0;
+    }
+
+    template<class T>
+    size_t vector_bytes(const std::vector<T>& vec) {
+        return vec.capacity() * sizeof(T);
+    }
+
+    // nodes of a red-black tree carry a color and 3 pointers
+    template<class K, class V>
+    size_t map_bytes(const std::map<K, V>& map) {
+        return map.size() * (sizeof(typename std::map<K, V>::value_type) + 4 * sizeof(void*));
+    }
+
+    // std::unordered_map: a node (with its next pointer and cached hash) per entry, and a pointer per bucket
+    template<class M>
+    size_t unordered_map_bytes(const M& map) {
+        return map.size() * (sizeof(typename M::value_type) + 2 * sizeof(void*)) +
+               map.bucket_count() * sizeof(void*);
+    }
+
+    // spp::sparse_hash_map: the entries are packed into groups, with a bitmap over the buckets of each group
+    template<class M>
+    size_t sparse_map_bytes(const M& map) {
+        return map.size() * sizeof(typename M::value_type) + map.bucket_count() / 4;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+/*
+    Bounded lock-free queue of many producers and a single consumer, as a ring of cells that each carry a sequence
+    number (after Dmitry Vyukov's bounded queue). A producer claims the next position with a CAS and publishes its
+    value by advancing the sequence of the cell, so producers never wait on each other or on the consumer. When the
+    ring is full, `push()` fails instead of blocking.
+*/
+template <class T>
+class mpsc_ring_t {
+private:
+    struct cell_t {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask;
+    std::unique_ptr<cell_t[]> cells;
+
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) size_t dequeue_pos = 0;
+
+public:
+    // `capacity` must be a power of two
+    explicit mpsc_ring_t(size_t capacity): mask(capacity - 1), cells(new cell_t[capacity]) {
+        for(size_t i = 0; i < capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_ring_t(const mpsc_ring_t&) = delete;
+    mpsc_ring_t& operator=(const mpsc_ring_t&) = delete;
+
+    // false when the ring is full
+    bool push(T&& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+        while(true) {
+            cell_t& cell = cells[pos & mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+
+            if(diff == 0) {
+                if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(diff < 0) {
+                // the cell still holds a value that the consumer has not taken
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // to be called only by the consumer; false when the ring is empty
+    bool pop(T& value) {
+        cell_t& cell = cells[dequeue_pos & mask];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+        if(intptr_t(sequence) - intptr_t(dequeue_pos + 1) < 0) {
+            return false;
+        }
+
+        value = std::move(cell.value);
+        cell.sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+        dequeue_pos++;
+        return true;
+    }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ *  Numerical values of a field laid out densely in seq_id order, so that a range filter can be answered by a
+ *  sequential scan that compares several values at a time instead of merging the id lists of every distinct value
+ *  in the range. An id holds one slot per value (array fields hold many).
+ *
+ *  Removed values are only marked as dead, so that an update (a remove followed by an insert of the same id) can
+ *  reuse the slot in place. Dead slots are compacted away once they make up half of the column.
+ */
+class num_column_t {
+private:
+    std::vector<uint32_t> ids;
+    std::vector<int64_t> values;
+
+    // one bit per slot
+    std::vector<uint64_t> dead_words;
+    size_t num_dead = 0;
+
+    void compact();
+
+public:
+    void insert(uint32_t id, int64_t value);
+
+    void remove(uint32_t id, int64_t value);
+
+    // number of live values
+    [[nodiscard]] size_t size() const;
+
+    // number of slots a scan goes over
+    [[nodiscard]] size_t num_slots() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+
+    // appends the ids having a value within [start, end] to `out` in ascending order, without duplicates
+    void range_inclusive_scan(int64_t start, int64_t end, std::vector<uint32_t>& out) const;
+
+    static void range_inclusive_scan_scalar(const int64_t* values, size_t n, int64_t start, int64_t end,
+                                            uint64_t* match_words);
+};
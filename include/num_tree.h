@@ -1,18 +1,40 @@
 #pragma once
 
 #include <map>
+#include <unordered_set>
 #include "sparsepp.h"
 #include "sorted_array.h"
 #include "array_utils.h"
 #include "art.h"
 #include "ids_t.h"
+#include "num_column.h"
 
 class num_tree_t {
 private:
     std::map<int64_t, void*> int64map;
 
+    // the same values in seq_id order, scanned instead of the tree when a range matches a large fraction of them
+    num_column_t column;
+    bool has_column;
+
+    // values whose id lists were left fragmented by removals, for `compact()`
+    std::unordered_set<int64_t> values_to_compact;
+
+    bool prefer_column_scan(std::map<int64_t, void*>::const_iterator it,
+                            std::map<int64_t, void*>::const_iterator end_it) const;
+
+    void column_range_search(int64_t start, int64_t end, uint32_t** ids, size_t& ids_len) const;
+
 public:
 
+    // scanning is cheaper than merging the id lists of the matching values once they cover 1/N of the column
+    static constexpr size_t COLUMN_SCAN_SELECTIVITY = 16;
+
+    // below this many values, the tree is always cheap enough
+    static constexpr size_t COLUMN_SCAN_MIN_VALUES = 1024;
+
+    explicit num_tree_t(bool has_column = true);
+
     ~num_tree_t();
 
     void insert(int64_t value, uint32_t id);
@@ -25,5 +47,27 @@ public:
 
     void remove(uint64_t value, uint32_t id);
 
+    // repacks the id lists of up to `max_lists` of the values that removals fragmented, returns the number of lists
+    // looked at, which is less than `max_lists` once none are left
+    size_t compact(size_t max_lists);
+
+    [[nodiscard]] size_t num_values_to_compact() const {
+        return values_to_compact.size();
+    }
+
+    // exact for EQUALS, otherwise interpolated from the smallest and the largest value, assuming an even spread
+    size_t approx_num_ids(NUM_COMPARATOR comparator, int64_t value) const;
+
+    size_t approx_range_num_ids(int64_t start, int64_t end) const;
+
+    // Ids of `filter_ids` (or any ids, when there are none) with the largest values (the smallest when `ascending`),
+    // taking values in order until at least `num_ids` ids are had, so that the ids tied on the last value are all in.
+    // Gives up (returning false) once more than `max_scanned_ids` ids of the tree were looked at.
+    bool top_ids(bool ascending, size_t num_ids, const uint32_t* filter_ids, size_t filter_ids_length,
+                 size_t max_scanned_ids, std::vector<uint32_t>& ids) const;
+
     size_t size();
+
+    // heap memory held by the tree, its id lists and its column
+    size_t memory_bytes() const;
 };
\ No newline at end of file
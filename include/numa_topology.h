@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+    CPUs of the NUMA nodes of the machine, as listed by the kernel under /sys/devices/system/node, so that worker
+    threads can be pinned to the CPUs of a node (see `ThreadPool::pin_workers_to_nodes()`) without linking libnuma.
+    A machine (or a kernel) that lists no nodes passes for a single node of all of its CPUs.
+*/
+struct numa_topology_t {
+    // CPUs of every node, in the order of the node numbers
+    std::vector<std::vector<size_t>> node_cpus;
+
+    static numa_topology_t detect(const std::string& node_dir_path = "/sys/devices/system/node");
+
+    // parses a kernel CPU list such as "0-3,8-11,16": false when it is malformed
+    static bool parse_cpu_list(const std::string& cpu_list, std::vector<size_t>& cpus);
+
+    size_t num_nodes() const {
+        return node_cpus.size();
+    }
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+    Writes metrics in the OpenMetrics text format (the format scraped by Prometheus). Each metric family is declared
+    with `family()` and followed by its samples, whose names are the family name with a suffix such as `_total` for
+    counters, or `_sum` and `_count` for summaries.
+*/
+class openmetrics_writer_t {
+private:
+    std::string out;
+
+    static void append_value(std::string& out, double value);
+
+public:
+    typedef std::vector<std::pair<std::string, std::string>> labels_t;
+
+    static inline const std::string CONTENT_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+    // `type` is one of `counter`, `gauge`, `summary` or `histogram`
+    void family(const std::string& name, const std::string& type, const std::string& help);
+
+    void sample(const std::string& name, const labels_t& labels, double value);
+
+    void sample(const std::string& name, double value) {
+        sample(name, {}, value);
+    }
+
+    // samples of a histogram from the (upper bound, number of values) of each of its buckets, ascending, along with
+    // the number of values past the last bound
+    void histogram(const std::string& name, const labels_t& labels,
+                   const std::vector<std::pair<double, uint64_t>>& buckets, uint64_t num_past_buckets, double sum);
+
+    // the metrics written, terminated by the `# EOF` marker
+    std::string finish();
+
+    static std::string escape_label_value(const std::string& value);
+};
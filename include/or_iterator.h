@@ -11,9 +11,30 @@ private:
     std::vector<posting_list_t::iterator_t> its;
     int curr_index = 0;
 
+    // Loser tree over `its` (used only when there are many lists): `losers[node]` is the index of the iterator that
+    // lost the match at that internal node, while the overall winner is `curr_index`. Leaf `i` sits at node
+    // `its.size() + i` and the parent of node `n` is `n / 2`.
+    std::vector<uint32_t> losers;
+
     void advance_smallest();
 
+    [[nodiscard]] uint32_t tree_key(uint32_t index) const;
+
+    void build_loser_tree();
+
+    void replay_loser_tree(uint32_t index);
+
 public:
+    // a linear scan for the smallest id is cheaper than maintaining a loser tree for a few lists
+    static constexpr size_t LOSER_TREE_MIN_LISTS = 8;
+
+    // default for `intersect()`: never skips any block
+    struct no_block_pruner_t {
+        constexpr bool operator()(std::vector<or_iterator_t>& its) const {
+            return false;
+        }
+    };
+
     explicit or_iterator_t(std::vector<posting_list_t::iterator_t>& its);
 
     or_iterator_t(or_iterator_t&& rhs) noexcept;
@@ -34,6 +55,11 @@ public:
     static void advance_non_largest(std::vector<or_iterator_t>& its);
     static void advance_non_largest2(std::vector<or_iterator_t>& its);
 
+    // range of ids [start, end] within which none of the underlying iterators can move past its current block
+    static bool current_blocks_range(const std::vector<or_iterator_t>& its, uint32_t& start, uint32_t& end);
+
+    static void skip_all_to(std::vector<or_iterator_t>& its, uint32_t id);
+
     // actual iterator operations
 
     [[nodiscard]] bool valid() const;
@@ -46,14 +72,20 @@ public:
 
     [[nodiscard]] const std::vector<posting_list_t::iterator_t>& get_its() const;
 
+    // appends the union of the ids of `its` that are <= `max_id` to `result_ids`
+    static void merge(std::vector<posting_list_t::iterator_t>& its, std::vector<uint32_t>& result_ids,
+                      uint32_t max_id = UINT32_MAX);
+
     static bool take_id(result_iter_state_t& istate, uint32_t id, bool& is_excluded);
 
-    template<class T>
-    static bool intersect(std::vector<or_iterator_t>& its, result_iter_state_t& istate, T func);
+    // `prune` is invoked before every step and returns true when it has moved the iterators past blocks whose
+    // documents need not be considered
+    template<class T, class P = no_block_pruner_t>
+    static bool intersect(std::vector<or_iterator_t>& its, result_iter_state_t& istate, T func, P prune = P());
 };
 
-template<class T>
-bool or_iterator_t::intersect(std::vector<or_iterator_t>& its, result_iter_state_t& istate, T func) {
+template<class T, class P>
+bool or_iterator_t::intersect(std::vector<or_iterator_t>& its, result_iter_state_t& istate, T func, P prune) {
     size_t it_size = its.size();
     bool is_excluded;
 
@@ -66,6 +98,10 @@ bool or_iterator_t::intersect(std::vector<or_iterator_t>& its, result_iter_state
             }
 
             while(its.size() == it_size && its[0].valid()) {
+                if(prune(its)) {
+                    continue;
+                }
+
                 auto id = its[0].id();
                 if(take_id(istate, id, is_excluded)) {
                     func(id, its);
@@ -90,6 +126,10 @@ bool or_iterator_t::intersect(std::vector<or_iterator_t>& its, result_iter_state
             }
 
             while(its.size() == it_size && !at_end2(its)) {
+                if(prune(its)) {
+                    continue;
+                }
+
                 if(equals2(its)) {
                     auto id = its[0].id();
                     if(take_id(istate, id, is_excluded)) {
@@ -120,6 +160,10 @@ bool or_iterator_t::intersect(std::vector<or_iterator_t>& its, result_iter_state
             }
 
             while(its.size() == it_size && !at_end(its)) {
+                if(prune(its)) {
+                    continue;
+                }
+
                 if(equals(its)) {
                     auto id = its[0].id();
                     if(take_id(istate, id, is_excluded)) {
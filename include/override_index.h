@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sparsepp.h"
+
+/*
+ *  Rule queries of overrides, looked up by the query of a search: exact rules by the whole query, and contains rules
+ *  through a trie over the words of their queries, which is walked from every word of the search query. Finding the
+ *  matching rules then depends on the number of words in the query rather than on the number of rules.
+ *
+ *  Words are split on every space (keeping empty words), so that a rule query found as a run of whole words of the
+ *  search query is exactly one that occurs in it delimited by spaces.
+ */
+class override_index_t {
+private:
+    struct node_t {
+        spp::sparse_hash_map<std::string, uint32_t> children;
+
+        // contains rules whose query ends at this node
+        std::vector<std::string> ids;
+    };
+
+    // rule query => exact rules
+    spp::sparse_hash_map<std::string, std::vector<std::string>> exact_ids;
+
+    // root at 0
+    std::vector<node_t> nodes;
+
+    static void split_words(const std::string& text, std::vector<std::string>& words);
+
+public:
+    override_index_t(): nodes(1) {
+
+    }
+
+    void insert(const std::string& id, const std::string& rule_query, bool exact);
+
+    void remove(const std::string& id, const std::string& rule_query, bool exact);
+
+    // sorted ids of the exact rules equal to `query` and of the contains rules that `StringUtils::contains_word()`
+    // finds in it
+    void match(const std::string& query, std::vector<std::string>& ids) const;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "option.h"
+
+/*
+    Comparison of the results of a Google Benchmark run (its `--benchmark_format=json` output) against a checked-in
+    baseline of CPU times, for catching slowdowns of the hot paths between versions:
+
+        {
+          "tolerance": 0.25,
+          "benchmarks": {
+            "BM_PostingListIntersect/1000/500000": {"cpu_time_ns": 7692851},
+            "BM_ArtFuzzySearch/cost:2/prefix:1": {"cpu_time_ns": 2595778, "tolerance": 0.4}
+          }
+        }
+
+    A benchmark regresses when its CPU time is more than `1 + tolerance` times its baseline, the tolerance of the
+    benchmark taking the place of the default one when given. The median of repeated runs is used when the results
+    have one. A benchmark of the baseline that is missing from the results fails the comparison too, so that the
+    baseline is kept up to date when benchmarks are renamed.
+*/
+
+struct perf_comparison_t {
+    enum status_t {
+        OK,
+        IMPROVED,
+        REGRESSED,
+        MISSING
+    };
+
+    std::string name;
+    status_t status = OK;
+    double baseline_ns = 0;
+    double result_ns = 0;
+    double tolerance = 0;
+
+    // result over baseline
+    double ratio() const {
+        return (baseline_ns > 0) ? (result_ns / baseline_ns) : 0;
+    }
+};
+
+class PerfBaseline {
+public:
+    static constexpr double DEFAULT_TOLERANCE = 0.25;
+
+    // benchmark name => CPU time in nanoseconds, from the median of repetitions when there is one
+    static Option<bool> parse_results(const nlohmann::json& results_json, std::map<std::string, double>& cpu_times);
+
+    static Option<bool> compare(const nlohmann::json& baseline_json, const std::map<std::string, double>& cpu_times,
+                                std::vector<perf_comparison_t>& comparisons);
+
+    // the baseline with the CPU times of the results in place of its own, keeping its tolerances, and with the
+    // benchmarks of the results that it does not have yet
+    static nlohmann::json update(const nlohmann::json& baseline_json, const std::map<std::string, double>& cpu_times);
+
+    static bool has_failed(const std::vector<perf_comparison_t>& comparisons);
+
+    static const char* status_name(perf_comparison_t::status_t status);
+};
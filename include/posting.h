@@ -3,7 +3,9 @@
 #include <cstdint>
 #include <vector>
 #include "posting_list.h"
+#include "posting_codec.h"
 #include "threadpool.h"
+#include "compact_list_arena.h"
 
 #define IS_COMPACT_POSTING(x) (((uintptr_t)(x) & 1))
 #define SET_COMPACT_POSTING(x) ((void*)((uintptr_t)(x) | 1))
@@ -19,9 +21,16 @@ struct compact_posting_list_t {
     // format: num_offsets, offset1,..,offsetn, id1 | num_offsets, offset1,..,offsetn, id2
     uint32_t id_offsets[];
 
+    static size_t size_bytes(size_t capacity) {
+        return sizeof(compact_posting_list_t) + (capacity * sizeof(uint32_t));
+    }
+
+    // lists are allocated from `CompactListArena`, so they must only be released through `destroy()`
     static compact_posting_list_t* create(uint32_t num_ids, const uint32_t* ids, const uint32_t* offset_index,
                                           uint32_t num_offsets, const uint32_t* offsets);
 
+    static void destroy(compact_posting_list_t* list);
+
     [[nodiscard]] posting_list_t* to_full_posting_list() const;
 
     bool contains(uint32_t id);
@@ -31,6 +40,9 @@ struct compact_posting_list_t {
 
     void erase(uint32_t id);
 
+    // erases the given sorted IDs in a single pass over the list
+    void erase_sorted(uint32_t num_ids, const uint32_t* ids);
+
     uint32_t first_id();
     uint32_t last_id();
 
@@ -44,6 +56,9 @@ public:
     static constexpr size_t COMPACT_LIST_THRESHOLD_LENGTH = 64;
     static constexpr size_t MAX_BLOCK_ELEMENTS = 256;
 
+    // total number of IDs across the lists below which a parallel merge is not worth the hand-off to the thread pool
+    static constexpr size_t PARALLEL_MERGE_MIN_IDS = 1 << 16;
+
     struct block_intersector_t {
         std::vector<posting_list_t*> plists;
         std::vector<posting_list_t*> expanded_plists;
@@ -80,12 +95,30 @@ public:
 
     static void upsert(void*& obj, uint32_t id, const std::vector<uint32_t>& offsets);
 
+    // Upserts many IDs at once, in the same layout as `compact_posting_list_t::create()`. IDs must be sorted and
+    // unique. IDs beyond the current last ID of the list are appended in bulk, while the rest are upserted one by one.
+    static void upsert_sorted(void*& obj, uint32_t num_ids, const uint32_t* ids, const uint32_t* offset_index,
+                              uint32_t num_offsets, const uint32_t* offsets);
+
     static void erase(void*& obj, uint32_t id);
 
+    // erases many IDs at once: IDs must be sorted, and the list is resized or converted at most once
+    static void erase_sorted(void*& obj, uint32_t num_ids, const uint32_t* ids);
+
     static void destroy_list(void*& obj);
 
+    // repacks a fragmented `posting_list_t` (compact lists are always packed), returns the number of blocks freed
+    static size_t compact(void* obj);
+
+    static bool is_fragmented(const void* obj);
+
     static uint32_t num_ids(const void* obj);
 
+    static size_t memory_bytes(const void* obj);
+
+    // adds the bytes needed to encode the IDs of the list (block by block) with each of `PostingCodec::codecs()`
+    static void add_codec_sizes(const void* obj, std::vector<size_t>& codec_bytes);
+
     static uint32_t first_id(const void* obj);
 
     static bool contains(const void* obj, uint32_t id);
@@ -94,6 +127,12 @@ public:
 
     static void merge(const std::vector<void*>& posting_lists, std::vector<uint32_t>& result_ids);
 
+    // Splits the ID space into `concurrency` ranges along the blocks of the list with the most blocks (like
+    // `ids_t::block_intersector_t::split_lists()`) and merges each range on `thread_pool`. Small inputs are merged
+    // serially.
+    static void merge(const std::vector<void*>& posting_lists, std::vector<uint32_t>& result_ids,
+                      ThreadPool* thread_pool, size_t concurrency = 4);
+
     static void intersect(const std::vector<void*>& posting_lists, std::vector<uint32_t>& result_ids);
 
     static void get_array_token_positions(
@@ -110,6 +149,10 @@ public:
                                    const uint32_t* ids, uint32_t num_ids,
                                    uint32_t*& phrase_ids, size_t& num_phrase_ids);
 
+    // ids of the documents in which the tokens of the lists follow each other in the order of the lists
+    static void phrase_intersect(const std::vector<void*>& raw_posting_lists, bool field_is_array,
+                                 std::vector<uint32_t>& phrase_ids);
+
     static void get_matching_array_indices(const std::vector<void*>& raw_posting_lists,
                                            uint32_t id, std::vector<size_t>& indices);
 };
@@ -123,6 +166,20 @@ bool posting_t::block_intersector_t::intersect(T func, size_t concurrency) {
     std::vector<posting_list_t::iterator_t> its;
     its.reserve(plists.size());
 
+    if(posting_list_t::is_skewed(plists)) {
+        // rare + common token: cost should be proportional to the shorter list
+        std::sort(plists.begin(), plists.end(), [](posting_list_t* a, posting_list_t* b) {
+            return a->num_ids() < b->num_ids();
+        });
+
+        for(const auto& posting_list: plists) {
+            its.push_back(posting_list->new_iterator());
+        }
+
+        posting_list_t::block_intersect_skewed<T>(its, iter_state, func);
+        return true;
+    }
+
     for(const auto& posting_list: plists) {
         its.push_back(posting_list->new_iterator());
     }
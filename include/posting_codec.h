@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum posting_codec_t {
+    FOR_CODEC,
+    STREAM_VBYTE_CODEC,
+    ROARING_CODEC
+};
+
+/*
+    Codecs for sorted sequences of document IDs.
+
+    - FOR:          frame of reference bit packing (libfor), used by `sorted_array`
+    - Stream VByte: byte aligned deltas with separate control bytes, decoded 4 integers at a time with a shuffle
+    - Roaring:      IDs partitioned by their upper 16 bits into array (sparse) or bitmap (dense) containers
+*/
+class PostingCodec {
+private:
+    static size_t for_encode(const uint32_t* sorted_ids, size_t n, std::vector<uint8_t>& out);
+
+    static size_t for_decode(const uint8_t* in, size_t n, uint32_t* out);
+
+public:
+    static constexpr const char* FOR_NAME = "for";
+    static constexpr const char* STREAM_VBYTE_NAME = "stream_vbyte";
+    static constexpr const char* ROARING_NAME = "roaring";
+
+    // an array container is converted into a bitmap container beyond this many IDs
+    static constexpr size_t ROARING_MAX_ARRAY_CONTAINER_SIZE = 4096;
+
+    static const std::vector<posting_codec_t>& codecs();
+
+    static bool parse(const std::string& name, posting_codec_t& codec);
+
+    static std::string name(posting_codec_t codec);
+
+    // appends encoded form of `n` sorted IDs to `out` and returns the number of bytes written
+    static size_t encode(posting_codec_t codec, const uint32_t* sorted_ids, size_t n, std::vector<uint8_t>& out);
+
+    // decodes `n` IDs from `in` and returns the number of bytes consumed
+    static size_t decode(posting_codec_t codec, const uint8_t* in, size_t n, uint32_t* out);
+
+    static size_t stream_vbyte_encode(const uint32_t* sorted_ids, size_t n, std::vector<uint8_t>& out);
+
+    static size_t stream_vbyte_decode(const uint8_t* in, size_t n, uint32_t* out);
+
+    static size_t stream_vbyte_decode_scalar(const uint8_t* in, size_t n, uint32_t* out);
+
+    static size_t roaring_encode(const uint32_t* sorted_ids, size_t n, std::vector<uint8_t>& out);
+
+    static size_t roaring_decode(const uint8_t* in, size_t n, uint32_t* out);
+};
@@ -2,11 +2,13 @@
 
 #include <map>
 #include <unordered_map>
+#include <algorithm>
+#include "block_index.h"
 #include "sorted_array.h"
 #include "array.h"
 #include "match_score.h"
-
-typedef uint32_t last_id_t;
+#include "array_utils.h"
+#include "filter_iterator.h"
 
 struct result_iter_state_t {
     const uint32_t* excluded_result_ids = nullptr;
@@ -15,6 +17,9 @@ struct result_iter_state_t {
     const uint32_t* filter_ids = nullptr;
     const size_t filter_ids_length = 0;
 
+    // when set, ids are probed against it in ascending order instead of being looked up in `filter_ids`
+    filter_iterator_t* filter_it = nullptr;
+
     size_t excluded_result_ids_index = 0;
     size_t filter_ids_index = 0;
     size_t index = 0;
@@ -25,6 +30,26 @@ struct result_iter_state_t {
                         const uint32_t* filter_ids, const size_t filter_ids_length) : excluded_result_ids(excluded_result_ids),
                                                                                       excluded_result_ids_size(excluded_result_ids_size),
                                                                                       filter_ids(filter_ids), filter_ids_length(filter_ids_length) {}
+
+    // AND NOT stage of the intersection: the excluded ids are walked along with the ascending result ids, so the
+    // probes cost in proportion to the excluded ids and not to the results
+    bool is_excluded(uint32_t id) {
+        if(excluded_result_ids_size == 0) {
+            return false;
+        }
+
+        if(excluded_result_ids_index != 0 && excluded_result_ids[excluded_result_ids_index - 1] >= id) {
+            // the ids went backwards (e.g. a fresh intersection reusing the state), so we start over
+            excluded_result_ids_index = 0;
+        }
+
+        excluded_result_ids_index = std::lower_bound(excluded_result_ids + excluded_result_ids_index,
+                                                     excluded_result_ids + excluded_result_ids_size, id) -
+                                    excluded_result_ids;
+
+        return excluded_result_ids_index < excluded_result_ids_size &&
+               excluded_result_ids[excluded_result_ids_index] == id;
+    }
 };
 
 /*
@@ -45,14 +70,26 @@ public:
         // link to next block
         block_t* next = nullptr;
 
+        // Upper bounds on the position dependent parts of the text match score of any document in the block.
+        // They are only raised on upsert (never lowered on erase), so they always remain valid bounds.
+        uint8_t max_offset_score = 0;
+        bool has_first_position = false;
+
         bool contains(uint32_t id);
 
+        void update_score_bounds(const uint32_t* positions, size_t num_positions);
+
         void remove_and_shift_offset_index(const uint32_t* indices_sorted, uint32_t num_indices);
 
         void insert_and_shift_offset_index(const uint32_t index, const uint32_t num_offsets);
 
         uint32_t upsert(uint32_t id, const std::vector<uint32_t>& offsets);
 
+        // appends IDs that are all larger than the current last ID, re-encoding the block only once
+        // `new_offset_index` points into `new_offsets`, i.e. `new_offset_index[0]` is usually 0
+        void append_sorted(const uint32_t* new_ids, uint32_t num_new_ids, const uint32_t* new_offset_index,
+                           const uint32_t* new_offsets, uint32_t num_new_offsets);
+
         uint32_t erase(uint32_t id);
 
         uint32_t size() {
@@ -62,21 +99,30 @@ public:
 
     class iterator_t {
     private:
-        const std::map<last_id_t, block_t*>* id_block_map;
+        const block_index_t<block_t>* id_block_map;
         block_t* curr_block;
         uint32_t curr_index;
         block_t* end_block;
 
+        // approximate position of `curr_block` in `id_block_map`, used as the starting point of lookups
+        size_t block_pos = 0;
+
         bool auto_destroy;
         uint32_t field_id;
 
+        // Offsets of the current block are decompressed only on first access, since wildcard, filter-only and
+        // most single token queries never look at token positions.
+        mutable uint32_t* offset_index = nullptr;
+        mutable uint32_t* offsets = nullptr;
+
+        void decompress_offsets() const;
+        void release_block();
+
     public:
         // uncompressed data structures for performance
         uint32_t* ids = nullptr;
-        uint32_t* offset_index = nullptr;
-        uint32_t* offsets = nullptr;
 
-        explicit iterator_t(const std::map<last_id_t, block_t*>* id_block_map,
+        explicit iterator_t(const block_index_t<block_t>* id_block_map,
                             block_t* start, block_t* end, bool auto_destroy = true, uint32_t field_id = 0);
         ~iterator_t();
 
@@ -87,18 +133,27 @@ public:
         [[nodiscard]] bool valid() const;
         void next();
         void skip_to(uint32_t id);
+        bool skip_to_exact(uint32_t id);
         void set_index(uint32_t index);
         [[nodiscard]] uint32_t id() const;
         [[nodiscard]] uint32_t last_block_id() const;
-        [[nodiscard]] inline uint32_t index() const;
-        [[nodiscard]] inline block_t* block() const;
+        [[nodiscard]] uint32_t index() const;
+        [[nodiscard]] block_t* block() const;
         [[nodiscard]] uint32_t get_field_id() const;
 
+        // uncompressed offset index and offsets of the current block
+        [[nodiscard]] const uint32_t* get_offset_index() const;
+        [[nodiscard]] const uint32_t* get_offsets() const;
+
         posting_list_t::iterator_t clone() const;
     };
 
 public:
 
+    // when the second shortest list is this many times longer than the shortest one, we probe the longer lists
+    // for each id of the shortest list instead of walking all of them
+    static constexpr size_t SKEWED_INTERSECTION_RATIO = 32;
+
     // maximum number of IDs (and associated offsets) to store in each block before another block is created
     const uint16_t BLOCK_MAX_ELEMENTS;
     uint32_t ids_length = 0;
@@ -107,8 +162,7 @@ public:
 
     // keeps track of the *last* ID in each block and is used for partial random access
     // e.g. 0..[9], 10..[19], 20..[29]
-    // MUST be ordered
-    std::map<last_id_t, block_t*> id_block_map;
+    block_index_t<block_t> id_block_map;
 
     static bool at_end(const std::vector<posting_list_t::iterator_t>& its);
     static bool at_end2(const std::vector<posting_list_t::iterator_t>& its);
@@ -140,8 +194,20 @@ public:
 
     void upsert(uint32_t id, const std::vector<uint32_t>& offsets);
 
+    // bulk version of `upsert()` for sorted IDs that are all larger than `last_id()`: blocks are filled up to
+    // `BLOCK_MAX_ELEMENTS` and encoded once, instead of once per ID
+    void append_sorted(const uint32_t* ids, uint32_t num_ids, const uint32_t* offset_index,
+                       const uint32_t* offsets, uint32_t num_offsets);
+
     void erase(uint32_t id);
 
+    // Repacks the IDs into as few blocks as possible: mid-list upserts split full blocks in half, so a list that
+    // sees many updates drifts towards half-empty blocks. Returns the number of blocks that were freed.
+    size_t compact();
+
+    // has at least 25% more blocks than needed: repacking only on this condition amortizes to O(1) per upsert
+    [[nodiscard]] bool is_fragmented() const;
+
     void dump();
 
     block_t* get_root();
@@ -150,8 +216,13 @@ public:
 
     size_t num_ids() const;
 
+    // heap memory held by the list and its blocks
+    size_t memory_bytes() const;
+
     uint32_t first_id();
 
+    uint32_t last_id();
+
     block_t* block_of(uint32_t id);
 
     bool contains(uint32_t id);
@@ -171,6 +242,26 @@ public:
         T func
     );
 
+    // intersects the uncompressed id buffers of the current blocks of 2 iterators in a single vectorized pass
+    template<class T>
+    static void block_intersect2(
+        std::vector<posting_list_t::iterator_t>& its,
+        result_iter_state_t& istate,
+        T func
+    );
+
+    static void skip_past_overlapping_blocks2(std::vector<posting_list_t::iterator_t>& its);
+
+    // drives the intersection by the ids of the first (shortest) iterator and probes the other lists for them
+    template<class T>
+    static void block_intersect_skewed(
+        std::vector<posting_list_t::iterator_t>& its,
+        result_iter_state_t& istate,
+        T func
+    );
+
+    static bool is_skewed(const std::vector<posting_list_t*>& posting_lists);
+
     static bool take_id(result_iter_state_t& istate, uint32_t id);
 
     static bool get_offsets(
@@ -188,6 +279,17 @@ public:
                                    const uint32_t* ids, const uint32_t num_ids,
                                    uint32_t*& phrase_ids, size_t& num_phrase_ids);
 
+    // whether the tokens of the iterators (all positioned on the same id) follow each other in the order of the
+    // iterators, within the field or (for arrays) within one of its elements
+    static bool is_phrase_match(const std::vector<iterator_t>& its, bool field_is_array);
+
+    static bool is_phrase_match(const iterator_t* const* token_its, size_t num_tokens, bool field_is_array);
+
+    // Positional intersection: the ids of the lists are intersected block by block and the offsets of only those
+    // blocks that have ids in common are looked at, to keep the ids in which the tokens of the lists form a phrase.
+    static void phrase_intersect(const std::vector<posting_list_t*>& posting_lists, bool field_is_array,
+                                 result_iter_state_t& istate, std::vector<uint32_t>& phrase_ids);
+
     static void get_matching_array_indices(uint32_t id, std::vector<iterator_t>& its,
                                            std::vector<size_t>& indices);
 
@@ -211,17 +313,7 @@ bool posting_list_t::block_intersect(std::vector<posting_list_t::iterator_t>& it
             }
             break;
         case 2:
-            while(!at_end2(its)) {
-                if(equals2(its)) {
-                    if(posting_list_t::take_id(istate, its[0].id())) {
-                        func(its[0].id(), its, istate.index);
-                    }
-
-                    advance_all2(its);
-                } else {
-                    advance_non_largest2(its);
-                }
-            }
+            block_intersect2(its, istate, func);
             break;
         default:
             while(!at_end(its)) {
@@ -240,3 +332,65 @@ bool posting_list_t::block_intersect(std::vector<posting_list_t::iterator_t>& it
 
     return false;
 }
+
+
+template<class T>
+void posting_list_t::block_intersect2(std::vector<posting_list_t::iterator_t>& its, result_iter_state_t& istate,
+                                      T func) {
+    std::vector<uint32_t> positions0;
+    std::vector<uint32_t> positions1;
+
+    while(!at_end2(its)) {
+        const uint32_t start_index0 = its[0].index();
+        const uint32_t start_index1 = its[1].index();
+        const uint32_t len0 = its[0].block()->size() - start_index0;
+        const uint32_t len1 = its[1].block()->size() - start_index1;
+
+        if(positions0.size() < std::min(len0, len1)) {
+            positions0.resize(std::min(len0, len1));
+            positions1.resize(std::min(len0, len1));
+        }
+
+        size_t num_matches = ArrayUtils::and_positions(its[0].ids + start_index0, len0,
+                                                       its[1].ids + start_index1, len1,
+                                                       positions0.data(), positions1.data());
+
+        for(size_t i = 0; i < num_matches; i++) {
+            its[0].set_index(start_index0 + positions0[i]);
+            its[1].set_index(start_index1 + positions1[i]);
+
+            if(posting_list_t::take_id(istate, its[0].id())) {
+                func(its[0].id(), its, istate.index);
+            }
+        }
+
+        skip_past_overlapping_blocks2(its);
+    }
+}
+
+template<class T>
+void posting_list_t::block_intersect_skewed(std::vector<posting_list_t::iterator_t>& its, result_iter_state_t& istate,
+                                            T func) {
+    while(its[0].valid()) {
+        const uint32_t id = its[0].id();
+        bool found = true;
+
+        for(size_t i = 1; i < its.size(); i++) {
+            if(!its[i].skip_to_exact(id)) {
+                found = false;
+                break;
+            }
+        }
+
+        if(found) {
+            if(posting_list_t::take_id(istate, id)) {
+                func(id, its, istate.index);
+            }
+        } else if(at_end(its)) {
+            // one of the longer lists has no more ids beyond `id`
+            break;
+        }
+
+        its[0].next();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <json.hpp>
+
+// How a single query suggestion (one candidate token for each query token) was evaluated
+struct query_plan_step_t {
+    std::vector<std::string> tokens;
+
+    // documents containing each token in any of the searched fields (sum across the fields, so an upper bound)
+    std::vector<uint32_t> token_num_ids;
+
+    // positions in `tokens` in the order in which the token iterators are intersected
+    std::vector<uint32_t> intersection_order;
+
+    uint32_t typo_cost = 0;
+
+    // a suggestion cannot match more documents than its rarest token, or the filter
+    uint32_t estimated_num_ids = 0;
+
+    size_t num_found = 0;
+};
+
+/*
+    Cost model for intersecting the posting lists of a query suggestion.
+
+    The lengths of the posting lists are known up front (`posting_t::num_ids`), so the intersection is driven by the
+    rarest token: the other token iterators only ever skip to IDs found in the rarer lists. When `explain` is enabled,
+    a plan step is recorded for each evaluated suggestion.
+*/
+struct query_plan_t {
+    // bounds the size of the explain output, since an exhaustive search can evaluate many suggestions
+    static constexpr size_t MAX_EXPLAIN_STEPS = 100;
+
+    size_t num_suggestions = 0;
+    std::vector<query_plan_step_t> steps;
+
+    // ascending order of `token_num_ids` (stable, so ties retain the query order)
+    static void intersection_order(const std::vector<uint32_t>& token_num_ids, std::vector<uint32_t>& order);
+
+    static uint32_t estimate_num_ids(const std::vector<uint32_t>& token_num_ids, uint32_t filter_ids_length);
+
+    void add_step(query_plan_step_t&& step);
+
+    nlohmann::json to_json() const;
+};
@@ -6,7 +6,9 @@
 #include <braft/storage.h>               // braft::SnapshotWriter
 #include <braft/util.h>                  // braft::AsyncClosureGuard
 #include <braft/protobuf_file.h>         // braft::ProtoBufFile
+#include <braft/snapshot_throttle.h>     // braft::ThroughputSnapshotThrottle
 #include <rocksdb/db.h>
+#include <chrono>
 #include <future>
 #include <sys/statvfs.h>
 
@@ -19,13 +21,21 @@ class Store;
 class ReplicationState;
 
 // Implements the callback for the state machine
+// Closure of a log entry, which holds either one request or a batch of small ones
 class ReplicationClosure : public braft::Closure {
 private:
-    const std::shared_ptr<http_req> request;
-    const std::shared_ptr<http_res> response;
+    const std::vector<std::shared_ptr<http_req>> requests;
+    const std::vector<std::shared_ptr<http_res>> responses;
 
 public:
-    ReplicationClosure(const std::shared_ptr<http_req>& request, const std::shared_ptr<http_res>& response): request(request), response(response) {
+    ReplicationClosure(const std::shared_ptr<http_req>& request, const std::shared_ptr<http_res>& response):
+                       requests({request}), responses({response}) {
+
+    }
+
+    ReplicationClosure(std::vector<std::shared_ptr<http_req>>&& requests,
+                       std::vector<std::shared_ptr<http_res>>&& responses):
+                       requests(std::move(requests)), responses(std::move(responses)) {
 
     }
 
@@ -33,12 +43,12 @@ public:
         //LOG(INFO) << "~ReplicationClosure req use count " << request.use_count();
     }
 
-    const std::shared_ptr<http_req>& get_request() const {
-        return request;
+    const std::vector<std::shared_ptr<http_req>>& get_requests() const {
+        return requests;
     }
 
-    const std::shared_ptr<http_res>& get_response() const {
-        return response;
+    const std::vector<std::shared_ptr<http_res>>& get_responses() const {
+        return responses;
     }
 
     void Run();
@@ -118,12 +128,35 @@ struct cached_disk_stat_t {
     }
 };
 
+struct replication_stats_t {
+    bool is_leader = false;
+    int64_t committed_index = 0;
+    int64_t applied_index = 0;
+    int64_t indexed_index = 0;
+
+    // on a follower, as found in the leader's status by the last catch-up check that reached it
+    int64_t leader_committed_index = 0;
+
+    // log entries (and their bytes) applied since the start
+    uint64_t num_applied_entries = 0;
+    uint64_t num_applied_bytes = 0;
+
+    uint64_t num_snapshots = 0;
+    uint64_t last_snapshot_duration_ms = 0;
+    uint64_t last_snapshot_bytes = 0;
+
+    // collection => requests queued for indexing
+    std::map<std::string, size_t> queued_writes;
+};
 
 // Implements braft::StateMachine.
 class ReplicationState : public braft::StateMachine {
 private:
     static constexpr const char* db_snapshot_name = "db_snapshot";
 
+    // search trees of the collections as of the db snapshot, see `index_snapshot_t`
+    static constexpr const char* index_snapshot_name = "index_snapshot";
+
     mutable std::shared_mutex node_mutex;
 
     braft::Node* volatile node;
@@ -147,10 +180,33 @@ private:
     std::atomic<bool> read_caught_up;
     std::atomic<bool> write_caught_up;
 
+    // see `get_indexed_index()`
+    std::atomic<int64_t> indexed_index{0};
+
+    // when this follower was last seen holding every write committed by the leader
+    std::atomic<uint64_t> last_caught_up_ms{0};
+
+    // see `replication_stats_t`
+    std::atomic<int64_t> leader_committed_index{0};
+    std::atomic<uint64_t> num_applied_entries{0};
+    std::atomic<uint64_t> num_applied_bytes{0};
+    std::atomic<uint64_t> num_snapshots{0};
+    std::atomic<uint64_t> last_snapshot_duration_ms{0};
+    std::atomic<uint64_t> last_snapshot_bytes{0};
+
     std::string raft_dir_path;
 
     std::string ext_snapshot_path;
 
+    // caps the bytes per second of snapshot files copied to other nodes, when configured
+    scoped_refptr<braft::SnapshotThrottle> snapshot_throttle;
+
+    // small writes waiting to be proposed together as one log entry (see `write_batch_delay_ms`)
+    std::mutex write_batch_mutex;
+    std::vector<std::shared_ptr<http_req>> batched_requests;
+    std::vector<std::shared_ptr<http_res>> batched_responses;
+    std::string batched_entry;
+
     int election_timeout_interval_ms;
 
     std::mutex mcv;
@@ -165,12 +221,18 @@ private:
     const uint64_t snapshot_interval_s;     // frequency of actual snapshotting
     uint64_t last_snapshot_ts;              // when last snapshot ran
 
+    std::atomic<bool> expiring_documents;
+
 public:
 
     static constexpr const char* log_dir_name = "log";
     static constexpr const char* meta_dir_name = "meta";
     static constexpr const char* snapshot_dir_name = "snapshot";
 
+    // expired documents are swept this often, and deleted this many at a time
+    static constexpr uint64_t DOC_EXPIRY_INTERVAL_S = 60;
+    static constexpr size_t DOC_EXPIRY_BATCH_SIZE = 1000;
+
     ReplicationState(HttpServer* server, BatchedIndexer* batched_indexer, Store* store,
                      ThreadPool* thread_pool, http_message_dispatcher* message_dispatcher,
                      bool api_uses_ssl, const Config* config,
@@ -207,6 +269,13 @@ public:
         return write_caught_up;
     }
 
+    // highest log index up to which every write is searchable on this node
+    int64_t get_indexed_index();
+
+    // ms since this node last held every write committed by the leader (as of the periodic catch-up check),
+    // 0 on the leader
+    uint64_t get_staleness_ms();
+
     bool is_alive() const;
 
     uint64_t node_state() const;
@@ -233,6 +302,10 @@ public:
 
     void persist_applying_index();
 
+    // on the leader, deletes the expired documents of the collections with a `ttl_field` through the regular
+    // (replicated) delete by filter end-point, one collection after another and in the background
+    void expire_documents();
+
     http_message_dispatcher* get_message_dispatcher() const;
 
     void wait() {
@@ -255,10 +328,28 @@ public:
 
     nlohmann::json get_status();
 
+    void get_replication_stats(replication_stats_t& stats);
+
 private:
 
     friend class ReplicationClosure;
 
+    // a log entry of batched requests starts with this byte, which no serialized request (a JSON object) does,
+    // and is followed by each request as a big-endian uint32 length and the serialized request
+    static constexpr char BATCH_ENTRY_MARKER = 0x01;
+
+    static void append_batch_entry(const std::string& serialized_request, std::string& entry);
+
+    static bool parse_batch_entry(const std::string& entry, std::vector<std::string>& serialized_requests);
+
+    // proposes `data` as one log entry: the node lock must be held
+    void propose(butil::IOBuf& data, ReplicationClosure* closure);
+
+    // proposes the batched writes, if any, as one log entry
+    void flush_write_batch();
+
+    static void on_write_batch_timer(void* arg);
+
     // actual application of writes onto the WAL
     void on_apply(braft::Iterator& iter);
 
@@ -267,7 +358,14 @@ private:
         braft::SnapshotWriter* writer;
         std::string state_dir_path;
         std::string db_snapshot_path;
+        std::string index_snapshot_path;
         std::string ext_snapshot_path;
+
+        // of the table files in the db snapshot, so that nodes copying the snapshot skip the ones they hold
+        std::map<std::string, std::string> db_file_checksums;
+
+        std::chrono::steady_clock::time_point start_time;
+
         braft::Closure* done;
     };
 
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "http_data.h"
+
+/*
+    Cache of search responses by request hash, split into stripes that are each locked on their own, so that
+    searches of different requests do not contend on one lock.
+
+    Each stripe holds at most its share of the cache's byte budget, and evicts its least recently used responses to
+    make room. A response larger than a fraction of a stripe's share is not admitted at all, so that one huge response
+    cannot evict a great many small ones.
+*/
+class ResponseCache {
+public:
+    static constexpr size_t NUM_STRIPES = 16;
+
+    // a response can take up at most 1 / MAX_ENTRY_FRACTION of a stripe
+    static constexpr size_t MAX_ENTRY_FRACTION = 8;
+
+    static constexpr size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+private:
+    struct entry_t {
+        uint64_t hash;
+        cached_res_t res;
+        size_t bytes;
+    };
+
+    struct stripe_t {
+        std::mutex mutex;
+
+        // most recently used first
+        std::list<entry_t> entries;
+        std::unordered_map<uint64_t, std::list<entry_t>::iterator> entry_its;
+        size_t bytes = 0;
+    };
+
+    stripe_t stripes[NUM_STRIPES];
+
+    std::atomic<size_t> max_stripe_bytes;
+
+    std::atomic<uint64_t> num_hits{0};
+    std::atomic<uint64_t> num_misses{0};
+    std::atomic<uint64_t> num_evictions{0};
+    std::atomic<uint64_t> num_rejections{0};
+
+    static size_t get_bytes(const cached_res_t& res);
+
+    stripe_t& get_stripe(uint64_t hash);
+
+    // evicts the least recently used entries of the stripe until it holds at most `max_bytes`
+    void evict(stripe_t& stripe, size_t max_bytes);
+
+public:
+    explicit ResponseCache(size_t max_bytes = DEFAULT_MAX_BYTES);
+
+    static ResponseCache& get_instance() {
+        static ResponseCache instance;
+        return instance;
+    }
+
+    ResponseCache(ResponseCache const&) = delete;
+    void operator=(ResponseCache const&) = delete;
+
+    void set_max_bytes(size_t max_bytes);
+
+    // copies the cached response of `hash` into `res`, unless it is missing or older than its ttl
+    bool get(uint64_t hash, cached_res_t& res);
+
+    void insert(uint64_t hash, const cached_res_t& res);
+
+    void clear();
+
+    size_t size();
+
+    size_t bytes();
+
+    uint64_t get_num_hits() const;
+
+    uint64_t get_num_misses() const;
+
+    uint64_t get_num_evictions() const;
+
+    uint64_t get_num_rejections() const;
+};
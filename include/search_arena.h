@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/*
+    Bump allocator for the temporaries of a single search: the storage of its topsters (including the per-thread and
+    per-candidate ones) and its scratch id buffers, so that a query asks the general purpose allocator for a handful
+    of blocks instead of thousands of small arrays.
+
+    Nothing is freed on its own. Temporaries that come and go many times within a search (e.g. for every candidate
+    combination) are taken within a `search_arena_scope_t`, which hands the memory taken since it was opened back to
+    the arena as it closes, so that the next ones reuse the same blocks. The blocks go away with the arena.
+
+    An arena is not thread safe: only the thread of the search takes from it (see `search_arena`), while the threads
+    it forks off may still read and write the memory it hands to them.
+*/
+class search_arena_t {
+public:
+    static constexpr size_t FIRST_BLOCK_BYTES = 64 * 1024;
+
+    // where the arena is at, for going back to it
+    struct mark_t {
+        size_t block_index = 0;
+        size_t offset = 0;
+    };
+
+private:
+    struct block_t {
+        char* data;
+        size_t num_bytes;
+    };
+
+    std::vector<block_t> blocks;
+    size_t block_index = 0;
+    size_t offset = 0;
+
+public:
+    search_arena_t() = default;
+
+    search_arena_t(const search_arena_t&) = delete;
+    search_arena_t& operator=(const search_arena_t&) = delete;
+
+    ~search_arena_t();
+
+    void* allocate(size_t num_bytes, size_t alignment = alignof(std::max_align_t));
+
+    // default initialized array, since it is never destroyed
+    template<typename T>
+    T* allocate_array(size_t num_elements) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena arrays are never destroyed");
+
+        T* elements = static_cast<T*>(allocate(num_elements * sizeof(T), alignof(T)));
+        for(size_t i = 0; i < num_elements; i++) {
+            new (&elements[i]) T;
+        }
+
+        return elements;
+    }
+
+    [[nodiscard]] mark_t mark() const {
+        return mark_t{block_index, offset};
+    }
+
+    // hands back everything taken since `mark` was had, keeping the blocks for what is taken next
+    void rewind(const mark_t& mark) {
+        block_index = mark.block_index;
+        offset = mark.offset;
+    }
+
+    [[nodiscard]] size_t reserved_bytes() const;
+
+    [[nodiscard]] size_t num_blocks() const {
+        return blocks.size();
+    }
+};
+
+// arena of the search running on this thread, or null (when the heap is used instead)
+extern thread_local search_arena_t* search_arena;
+
+// Rewinds the arena of the search running on this thread (if any) to where it was as the scope was opened.
+struct search_arena_scope_t {
+    search_arena_t* const arena;
+    const search_arena_t::mark_t mark;
+
+    search_arena_scope_t(): arena(search_arena),
+                            mark(arena != nullptr ? arena->mark() : search_arena_t::mark_t{}) {
+    }
+
+    search_arena_scope_t(const search_arena_scope_t&) = delete;
+    search_arena_scope_t& operator=(const search_arena_scope_t&) = delete;
+
+    ~search_arena_scope_t() {
+        if(arena != nullptr) {
+            arena->rewind(mark);
+        }
+    }
+};
+
+// Scratch array taken off the arena of the search running on this thread, or off the heap when there is none.
+template<typename T>
+struct search_scratch_t {
+    search_arena_scope_t scope;
+    T* const data;
+
+    explicit search_scratch_t(size_t num_elements):
+            data(scope.arena != nullptr ? scope.arena->allocate_array<T>(num_elements) : new T[num_elements]) {
+    }
+
+    search_scratch_t(const search_scratch_t&) = delete;
+    search_scratch_t& operator=(const search_scratch_t&) = delete;
+
+    ~search_scratch_t() {
+        if(scope.arena == nullptr) {
+            delete [] data;
+        }
+    }
+};
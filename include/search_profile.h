@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <json.hpp>
+#include "thread_local_vars.h"
+#include "tracer.h"
+
+/*
+    Timings and counters of the stages of a single search, returned as `profile` in the search response when the
+    `profile` parameter is enabled.
+
+    The threads that work on a search add to the same profile through the `search_profile` thread local, which is
+    null unless profiling is enabled, so that the timers and counters compiled into the hot paths only cost a
+    branch otherwise. Since the threads of a stage run in parallel, its time is the sum across the threads, and
+    can exceed the time taken by the search.
+*/
+struct search_profile_t {
+    enum stage_t {
+        FILTER,
+        CANDIDATES,
+        INTERSECTION,
+        FACETS,
+        HIGHLIGHT,
+        HYDRATION,
+        NUM_STAGES
+    };
+
+    enum counter_t {
+        CANDIDATES_GENERATED,
+        IDS_INTERSECTED,
+        BLOCKS_DECOMPRESSED,
+        STORE_READS,
+        NUM_COUNTERS
+    };
+
+    std::atomic<uint64_t> stage_nanos[NUM_STAGES]{};
+    std::atomic<uint64_t> counters[NUM_COUNTERS]{};
+
+    void add_time(stage_t stage, uint64_t nanos) {
+        stage_nanos[stage].fetch_add(nanos, std::memory_order_relaxed);
+    }
+
+    void add(counter_t counter, uint64_t value) {
+        counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    nlohmann::json to_json() const;
+
+    static const char* get_stage_name(stage_t stage);
+
+    static const char* get_counter_name(counter_t counter);
+};
+
+// Adds the time from its construction to its destruction to a stage of the profile of the current search, if any,
+// and to the trace of the search as a span, when it is traced
+class search_stage_timer_t {
+    search_profile_t* const profile;
+    const search_profile_t::stage_t stage;
+    std::chrono::steady_clock::time_point begin;
+    trace_span_t span;
+
+    static const char* get_span_name(search_profile_t::stage_t stage) {
+        static constexpr const char* span_names[search_profile_t::NUM_STAGES] = {
+            "search.filter", "search.candidates", "search.intersection", "search.facets", "search.highlight",
+            "search.hydration"
+        };
+
+        return span_names[stage];
+    }
+
+public:
+    explicit search_stage_timer_t(search_profile_t::stage_t stage): profile(search_profile), stage(stage),
+                                                                     span(get_span_name(stage)) {
+        if(profile != nullptr) {
+            begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~search_stage_timer_t() {
+        if(profile != nullptr) {
+            profile->add_time(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count());
+        }
+    }
+
+    search_stage_timer_t(const search_stage_timer_t&) = delete;
+    search_stage_timer_t& operator=(const search_stage_timer_t&) = delete;
+};
+
+inline void search_profile_add(search_profile_t::counter_t counter, uint64_t value = 1) {
+    if(search_profile != nullptr) {
+        search_profile->add(counter, value);
+    }
+}
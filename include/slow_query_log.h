@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "mpsc_ring.h"
+
+/*
+    Log of the searches that took at least `time_threshold_ms`, along with a random sample of `sample_ratio` of the
+    rest, as one JSON object per line.
+
+    Searches only push their entries into a lock-free ring, which a writer thread drains into the file, so that a
+    search never waits on the disk. Entries that find the ring full are dropped and counted.
+*/
+class SlowQueryLog {
+private:
+    mpsc_ring_t<std::string> entries;
+
+    std::atomic<bool> enabled{false};
+    std::atomic<int> time_threshold_ms{-1};
+    std::atomic<float> sample_ratio{0};
+
+    std::ofstream out;
+    std::thread writer;
+    std::atomic<bool> quit{false};
+
+    std::atomic<uint64_t> num_dropped{0};
+
+    void run_writer();
+
+public:
+    static constexpr size_t CAPACITY = 4096;
+    static constexpr uint64_t WRITER_INTERVAL_MS = 100;
+
+    SlowQueryLog(): entries(CAPACITY) {}
+
+    ~SlowQueryLog() {
+        dispose();
+    }
+
+    static SlowQueryLog& get_instance() {
+        static SlowQueryLog instance;
+        return instance;
+    }
+
+    SlowQueryLog(SlowQueryLog const&) = delete;
+    void operator=(SlowQueryLog const&) = delete;
+
+    // opens the log at `path` for appending and starts the writer, unless both the threshold is negative and the
+    // sample ratio is 0
+    bool init(const std::string& path, int time_threshold_ms, float sample_ratio);
+
+    // writes the entries left and stops the writer
+    void dispose();
+
+    bool is_enabled() const {
+        return enabled;
+    }
+
+    // whether a search that took `time_ms` is to be logged; `is_slow` is set when it took at least the threshold
+    bool should_log(uint64_t time_ms, bool& is_slow) const;
+
+    // does not block: the entry is dropped when the ring is full
+    void log(std::string&& entry);
+
+    // writes the entries in the ring to the log, from the writer thread (or a test, when it has not been started)
+    void drain();
+
+    uint64_t get_num_dropped() const {
+        return num_dropped;
+    }
+};
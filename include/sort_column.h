@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ *  Values of a numerical (or geopoint) sort field laid out by seq_id, so that looking up the sort value of a
+ *  candidate document is a single array load instead of a hash lookup. A bit per seq_id tells apart the documents
+ *  that have no value for the field (e.g. optional fields).
+ *
+ *  Since seq_ids are handed out in ascending order, the column stays dense except for the slots of deleted
+ *  documents.
+ */
+class sort_column_t {
+private:
+    std::vector<int64_t> values;
+
+    // one bit per seq_id, set when the document has a value
+    std::vector<uint64_t> present_words;
+
+    size_t num_values = 0;
+
+public:
+    // like a map's emplace: an existing value of `id` is left as it is
+    bool emplace(uint32_t id, int64_t value);
+
+    void erase(uint32_t id);
+
+    [[nodiscard]] bool contains(uint32_t id) const {
+        return id < values.size() && (present_words[id / 64] & (uint64_t(1) << (id % 64))) != 0;
+    }
+
+    // the hot path of sorting, hence defined here
+    bool get(uint32_t id, int64_t& value) const {
+        if(!contains(id)) {
+            return false;
+        }
+
+        value = values[id];
+        return true;
+    }
+
+    // writes the value of each of `ids` to `out`, or `missing_value` for the ids without one
+    void get_batch(const uint32_t* ids, size_t num_ids, int64_t missing_value, int64_t* out) const;
+
+    // adds to `counts[r]` the number of `ids` whose value is within [`range_mins[r]`, `range_maxs[r]`]: the ranges
+    // may overlap, and must start above INT64_MIN, which stands for the ids without a value
+    void count_ranges(const uint32_t* ids, size_t num_ids, const int64_t* range_mins, const int64_t* range_maxs,
+                      size_t num_ranges, uint32_t* counts) const;
+
+    // throws std::out_of_range when `id` has no value
+    [[nodiscard]] int64_t at(uint32_t id) const;
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+};
@@ -2,37 +2,93 @@
 
 #include <stdint.h>
 #include <cstdlib>
+#include <cstdio>
 #include <string>
 #include <sstream>
 #include <memory>
 #include <thread>
+#include <atomic>
+#include <algorithm>
 #include <shared_mutex>
 #include <option.h>
 #include <rocksdb/db.h>
 #include <rocksdb/write_batch.h>
 #include <rocksdb/options.h>
+#include <rocksdb/table.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/cache.h>
+#include <rocksdb/rate_limiter.h>
+#include <rocksdb/sst_file_writer.h>
+#include <rocksdb/file_checksum.h>
 #include <rocksdb/merge_operator.h>
 #include <rocksdb/transaction_log.h>
+#include <rocksdb/statistics.h>
+#include <rocksdb/perf_context.h>
+#include <rocksdb/perf_level.h>
 #include <butil/file_util.h>
 #include <rocksdb/utilities/checkpoint.h>
 #include "string_utils.h"
 #include "logger.h"
 #include "file_utils.h"
+#include "json.hpp"
+#include "tracer.h"
 
-class UInt64AddOperator : public rocksdb::AssociativeMergeOperator {
+/*
+ *  Merges the operands of a key either as increments of a counter (`Store::increment()`) or as patches of a JSON
+ *  document (`Store::merge_patch()`), told apart by their first byte: a patch is a JSON object, while an increment
+ *  is a big-endian uint32 that could only start with '{' if it were above 2 billion.
+ */
+class StoreMergeOperator : public rocksdb::MergeOperator {
 public:
-    virtual bool Merge(const rocksdb::Slice& key, const rocksdb::Slice* existing_value, const rocksdb::Slice& value,
-                       std::string* new_value, rocksdb::Logger* logger) const override {
-        uint64_t existing = 0;
-        if (existing_value) {
-            existing = StringUtils::deserialize_uint32_t(existing_value->ToString());
+    bool FullMergeV2(const MergeOperationInput& merge_in, MergeOperationOutput* merge_out) const override {
+        const auto& operands = merge_in.operand_list;
+
+        if(operands.empty() || operands[0].empty() || operands[0][0] != '{') {
+            uint32_t sum = 0;
+            if(merge_in.existing_value) {
+                sum = StringUtils::deserialize_uint32_t(merge_in.existing_value->ToString());
+            }
+
+            for(const auto& operand: operands) {
+                sum += StringUtils::deserialize_uint32_t(operand.ToString());
+            }
+
+            merge_out->new_value = StringUtils::serialize_uint32_t(sum);
+            return true;
         }
-        *new_value = StringUtils::serialize_uint32_t(existing + StringUtils::deserialize_uint32_t(value.ToString()));
+
+        nlohmann::json document = nlohmann::json::object();
+
+        if(merge_in.existing_value) {
+            const rocksdb::Slice& existing = *merge_in.existing_value;
+            document = nlohmann::json::parse(existing.data(), existing.data() + existing.size(), nullptr, false);
+            if(!document.is_object()) {
+                return false;
+            }
+        }
+
+        for(const auto& operand: operands) {
+            nlohmann::json patch = nlohmann::json::parse(operand.data(), operand.data() + operand.size(),
+                                                         nullptr, false);
+            if(!patch.is_object()) {
+                return false;
+            }
+
+            for(auto it = patch.begin(); it != patch.end(); ++it) {
+                if(it.value().is_null()) {
+                    document.erase(it.key());
+                } else {
+                    document[it.key()] = std::move(it.value());
+                }
+            }
+        }
+
+        merge_out->new_value = document.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
         return true;
     }
 
-    virtual const char* Name() const override {
-        return "UInt64AddOperator";
+    const char* Name() const override {
+        return "StoreMergeOperator";
     }
 };
 
@@ -42,25 +98,346 @@ enum StoreStatus {
     ERROR
 };
 
+/*
+ *  Tuning of the RocksDB instance behind a `Store`. The block cache and the rate limiter are shared pointers so that
+ *  several stores of the process can be handed the same ones.
+ */
+struct store_options_t {
+    // nullptr: every table factory gets the default 8 MB cache of its own
+    std::shared_ptr<rocksdb::Cache> block_cache;
+
+    rocksdb::CompressionType compression = rocksdb::CompressionType::kSnappyCompression;
+
+    // when not empty, overrides `compression` level by level
+    std::vector<rocksdb::CompressionType> compression_per_level;
+
+    // kDisableCompressionOption: the last level is compressed like the others
+    rocksdb::CompressionType bottommost_compression = rocksdb::CompressionType::kDisableCompressionOption;
+
+    // bloom filter on the keys of every column family, 0 for none (doc id mappings always get one)
+    uint32_t bloom_bits_per_key = 0;
+
+    // caps the bytes per second written by flushes and compactions
+    std::shared_ptr<rocksdb::RateLimiter> rate_limiter;
+
+    // compaction reads and writes bypass the page cache, leaving it to the files being searched
+    bool use_direct_io_for_compaction = false;
+
+    // parses one of: none, snappy, zlib, lz4, lz4hc, zstd
+    static bool parse_compression(const std::string& name, rocksdb::CompressionType& compression) {
+        static const std::map<std::string, rocksdb::CompressionType> compressions = {
+            {"none", rocksdb::CompressionType::kNoCompression},
+            {"snappy", rocksdb::CompressionType::kSnappyCompression},
+            {"zlib", rocksdb::CompressionType::kZlibCompression},
+            {"lz4", rocksdb::CompressionType::kLZ4Compression},
+            {"lz4hc", rocksdb::CompressionType::kLZ4HCCompression},
+            {"zstd", rocksdb::CompressionType::kZSTD},
+        };
+
+        auto compression_it = compressions.find(name);
+        if(compression_it == compressions.end()) {
+            return false;
+        }
+
+        compression = compression_it->second;
+        return true;
+    }
+
+    // `names` is either a single compression for all the levels or a comma separated list of one per level
+    Option<bool> set_compression(const std::string& names) {
+        std::vector<std::string> level_names;
+        StringUtils::split(names, level_names, ",");
+
+        if(level_names.empty()) {
+            return Option<bool>(400, "Compression is empty.");
+        }
+
+        std::vector<rocksdb::CompressionType> level_compressions(level_names.size());
+        for(size_t i = 0; i < level_names.size(); i++) {
+            if(!parse_compression(level_names[i], level_compressions[i])) {
+                return Option<bool>(400, "Unknown compression `" + level_names[i] + "`.");
+            }
+        }
+
+        compression = level_compressions[0];
+        compression_per_level.clear();
+
+        if(level_compressions.size() > 1) {
+            compression_per_level = std::move(level_compressions);
+        }
+
+        return Option<bool>(true);
+    }
+};
+
+/*
+ *  RocksDB's own statistics of a store, along with where the time of a sample of its reads went, as taken off the
+ *  perf context of the reading thread.
+ */
+struct store_stats_t {
+    // (name, count) of the events counted by RocksDB, such as block cache hits and bytes compacted
+    std::vector<std::pair<std::string, uint64_t>> tickers;
+
+    // (operation, distribution of its durations in microseconds)
+    std::vector<std::pair<std::string, rocksdb::HistogramData>> histograms;
+
+    uint64_t num_sampled_reads = 0;
+
+    // (stage, nanoseconds spent in it across the sampled reads)
+    std::vector<std::pair<std::string, uint64_t>> sampled_read_nanos;
+};
+
 /*
  *  Abstraction for underlying KV store (RocksDB)
+ *
+ *  Keys are routed to column families by their prefix (see `get_column_family()`), so that documents, doc id
+ *  mappings and raft request logs do not share compaction, block sizes and write buffers with each other or with
+ *  the meta keys. Callers deal in keys alone: write batches built against the default column family are routed
+ *  key by key when written.
  */
 class Store {
+public:
+    enum column_family_t {
+        DEFAULT_CF = 0,
+
+        // "<collection id>_$SI_<seq id>" => document, and "<collection id>_$SS_<seq id>" => its summary
+        DOCUMENTS_CF,
+
+        // "<collection id>_$DI_<doc id>" => seq id
+        DOC_IDS_CF,
+
+        // "$RL_<request id>_<chunk>" => raft request chunk, kept only until it is indexed
+        REQUEST_LOG_CF,
+
+        NUM_COLUMN_FAMILIES
+    };
+
+    // the first is `rocksdb::kDefaultColumnFamilyName`
+    static constexpr const char* COLUMN_FAMILY_NAMES[NUM_COLUMN_FAMILIES] = {
+        "default", "documents", "doc_ids", "request_log"
+    };
+
+    // column family of `key`, or of the keys starting with `key` when it is a prefix of at least
+    // "<collection id>_$SI" or "$RL_"
+    static column_family_t get_column_family(const rocksdb::Slice& key) {
+        if(key.starts_with("$RL_")) {
+            return REQUEST_LOG_CF;
+        }
+
+        size_t i = 0;
+        while(i < key.size() && key[i] >= '0' && key[i] <= '9') {
+            i++;
+        }
+
+        if(i == 0 || key.size() < i + 4 || key[i] != '_' || key[i+1] != '$') {
+            return DEFAULT_CF;
+        }
+
+        if(key[i+2] == 'S' && (key[i+3] == 'I' || key[i+3] == 'S')) {
+            return DOCUMENTS_CF;
+        }
+
+        if(key[i+2] == 'D' && key[i+3] == 'I') {
+            return DOC_IDS_CF;
+        }
+
+        return DEFAULT_CF;
+    }
+
 private:
 
     const std::string state_dir_path;
     rocksdb::DB *db;
     rocksdb::Options options;
     rocksdb::WriteOptions write_options;
+    const store_options_t store_options;
+
+    rocksdb::ColumnFamilyOptions cf_options[NUM_COLUMN_FAMILIES];
+    std::vector<rocksdb::ColumnFamilyHandle*> cf_handles;
 
     // Used to protect assignment to DB handle, which is otherwise thread safe
     // So we use unique lock only for assignment, but shared locks for all other operations on DB
     mutable std::shared_mutex mutex;
 
+    // names the table files built for ingestion apart
+    std::atomic<uint64_t> ingest_file_counter{0};
+
+    enum read_stage_t {
+        MEMTABLE_STAGE = 0,
+        TABLE_FILES_STAGE,
+        BLOCK_READ_STAGE,
+        BLOCK_DECOMPRESS_STAGE,
+        BLOCK_CHECKSUM_STAGE,
+        NUM_READ_STAGES
+    };
+
+    static constexpr const char* READ_STAGE_NAMES[NUM_READ_STAGES] = {
+        "memtable", "table_files", "block_read", "block_decompress", "block_checksum"
+    };
+
+    mutable std::atomic<uint64_t> num_sampled_reads{0};
+    mutable std::atomic<uint64_t> sampled_read_nanos[NUM_READ_STAGES] = {};
+
+    // turns on timing in the perf context of the calling thread for one in `READ_SAMPLE_INTERVAL` of its reads,
+    // since timing every read costs a couple of clock reads per stage
+    static bool start_read_sample() {
+        thread_local uint32_t num_reads = 0;
+        if(++num_reads % READ_SAMPLE_INTERVAL != 0) {
+            return false;
+        }
+
+        rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableTimeExceptForMutex);
+        rocksdb::get_perf_context()->Reset();
+        return true;
+    }
+
+    void end_read_sample() const {
+        const rocksdb::PerfContext* perf_context = rocksdb::get_perf_context();
+
+        sampled_read_nanos[MEMTABLE_STAGE] += perf_context->get_from_memtable_time;
+        sampled_read_nanos[TABLE_FILES_STAGE] += perf_context->get_from_output_files_time;
+        sampled_read_nanos[BLOCK_READ_STAGE] += perf_context->block_read_time;
+        sampled_read_nanos[BLOCK_DECOMPRESS_STAGE] += perf_context->block_decompress_time;
+        sampled_read_nanos[BLOCK_CHECKSUM_STAGE] += perf_context->block_checksum_time;
+        num_sampled_reads++;
+
+        rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
+    }
+
+    // re-issues the operations of a batch built against the default column family on the families of their keys
+    class column_family_router_t : public rocksdb::WriteBatch::Handler {
+    private:
+        const std::vector<rocksdb::ColumnFamilyHandle*>& cf_handles;
+
+        rocksdb::ColumnFamilyHandle* handle_of(const rocksdb::Slice& key) const {
+            return cf_handles[get_column_family(key)];
+        }
+
+    public:
+        rocksdb::WriteBatch routed_batch;
+
+        explicit column_family_router_t(const std::vector<rocksdb::ColumnFamilyHandle*>& cf_handles):
+                                        cf_handles(cf_handles) {
+
+        }
+
+        rocksdb::Status PutCF(uint32_t, const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+            return routed_batch.Put(handle_of(key), key, value);
+        }
+
+        rocksdb::Status DeleteCF(uint32_t, const rocksdb::Slice& key) override {
+            return routed_batch.Delete(handle_of(key), key);
+        }
+
+        rocksdb::Status SingleDeleteCF(uint32_t, const rocksdb::Slice& key) override {
+            return routed_batch.SingleDelete(handle_of(key), key);
+        }
+
+        rocksdb::Status DeleteRangeCF(uint32_t, const rocksdb::Slice& begin_key,
+                                      const rocksdb::Slice& end_key) override {
+            return routed_batch.DeleteRange(handle_of(begin_key), begin_key, end_key);
+        }
+
+        rocksdb::Status MergeCF(uint32_t, const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+            return routed_batch.Merge(handle_of(key), key, value);
+        }
+
+        void LogData(const rocksdb::Slice& blob) override {
+            routed_batch.PutLogData(blob);
+        }
+    };
+
+    rocksdb::ColumnFamilyHandle* handle_of(const rocksdb::Slice& key) const {
+        return cf_handles[get_column_family(key)];
+    }
+
+    void init_column_family_options() {
+        rocksdb::BlockBasedTableOptions table_options;
+        table_options.block_cache = store_options.block_cache;
+        if(store_options.bloom_bits_per_key != 0) {
+            table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(store_options.bloom_bits_per_key));
+        }
+
+        for(size_t i = 0; i < NUM_COLUMN_FAMILIES; i++) {
+            cf_options[i] = rocksdb::ColumnFamilyOptions(options);
+            cf_options[i].table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+        }
+
+        // documents are read whole and mostly in ranges (load, export): larger blocks compress better
+        rocksdb::BlockBasedTableOptions documents_table_options = table_options;
+        documents_table_options.block_size = 32 * 1024;
+        cf_options[DOCUMENTS_CF].table_factory.reset(rocksdb::NewBlockBasedTableFactory(documents_table_options));
+
+        // id mappings are looked up one key at a time, often for ids that do not exist
+        rocksdb::BlockBasedTableOptions doc_ids_table_options = table_options;
+        doc_ids_table_options.block_size = 4 * 1024;
+        if(store_options.bloom_bits_per_key == 0) {
+            doc_ids_table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10));
+        }
+        cf_options[DOC_IDS_CF].table_factory.reset(rocksdb::NewBlockBasedTableFactory(doc_ids_table_options));
+
+        // request chunks are written once, read once soon after and then deleted as a range
+        cf_options[REQUEST_LOG_CF].compression = rocksdb::CompressionType::kNoCompression;
+        cf_options[REQUEST_LOG_CF].compression_per_level.clear();
+        cf_options[REQUEST_LOG_CF].bottommost_compression = rocksdb::CompressionType::kDisableCompressionOption;
+        cf_options[REQUEST_LOG_CF].write_buffer_size = 16*1048576;
+    }
+
+    // keys written to the default column family before the store had the other families are moved to theirs
+    rocksdb::Status migrate_default_column_family() {
+        std::unique_ptr<rocksdb::Iterator> iter(db->NewIterator(rocksdb::ReadOptions(), cf_handles[DEFAULT_CF]));
+        rocksdb::WriteBatch batch;
+        size_t num_moved = 0;
+
+        for(iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            const column_family_t column_family = get_column_family(iter->key());
+            if(column_family == DEFAULT_CF) {
+                continue;
+            }
+
+            batch.Put(cf_handles[column_family], iter->key(), iter->value());
+            batch.Delete(cf_handles[DEFAULT_CF], iter->key());
+            num_moved++;
+
+            if(batch.Count() >= 2000) {
+                rocksdb::Status status = db->Write(rocksdb::WriteOptions(), &batch);
+                if(!status.ok()) {
+                    return status;
+                }
+
+                batch.Clear();
+            }
+        }
+
+        LOG(INFO) << "Moved " << num_moved << " keys out of the default column family.";
+        return db->Write(rocksdb::WriteOptions(), &batch);
+    }
+
+    void destroy_column_family_handles() {
+        for(auto cf_handle: cf_handles) {
+            db->DestroyColumnFamilyHandle(cf_handle);
+        }
+
+        cf_handles.clear();
+    }
+
     rocksdb::Status init_db() {
         LOG(INFO) << "Initializing DB by opening state dir: " << state_dir_path;
 
-        rocksdb::Status s = rocksdb::DB::Open(options, state_dir_path, &db);
+        std::vector<std::string> existing_cf_names;
+        const bool is_existing_db = rocksdb::DB::ListColumnFamilies(options, state_dir_path, &existing_cf_names).ok();
+        const bool has_column_families = (existing_cf_names.size() == NUM_COLUMN_FAMILIES);
+
+        std::vector<rocksdb::ColumnFamilyDescriptor> cf_descriptors;
+        for(size_t i = 0; i < NUM_COLUMN_FAMILIES; i++) {
+            cf_descriptors.emplace_back(COLUMN_FAMILY_NAMES[i], cf_options[i]);
+        }
+
+        rocksdb::Status s = rocksdb::DB::Open(options, state_dir_path, cf_descriptors, &cf_handles, &db);
+        if(s.ok() && is_existing_db && !has_column_families) {
+            s = migrate_default_column_family();
+        }
+
         if(!s.ok()) {
             LOG(ERROR) << "Error while initializing store: " << s.ToString();
             if(s.code() == rocksdb::Status::Code::kIOError) {
@@ -77,21 +454,43 @@ private:
 
 public:
 
+    static constexpr uint32_t READ_SAMPLE_INTERVAL = 64;
+
     Store() = delete;
 
     Store(const std::string & state_dir_path,
           const size_t wal_ttl_secs = 24*60*60,
-          const size_t wal_size_mb = 1024, bool disable_wal = true): state_dir_path(state_dir_path) {
+          const size_t wal_size_mb = 1024, bool disable_wal = true,
+          const store_options_t& store_options = store_options_t()):
+          state_dir_path(state_dir_path), store_options(store_options) {
         // Optimize RocksDB
         options.IncreaseParallelism();
         options.OptimizeLevelStyleCompaction();
         // create the DB if it's not already present
         options.create_if_missing = true;
+        options.create_missing_column_families = true;
         options.write_buffer_size = 4*1048576;
         options.max_write_buffer_number = 2;
-        options.merge_operator.reset(new UInt64AddOperator);
-        options.compression = rocksdb::CompressionType::kSnappyCompression;
-        //options.bottommost_compression = rocksdb::CompressionType::kSnappyCompression;
+        options.merge_operator.reset(new StoreMergeOperator);
+
+        // counting costs about as much as an atomic increment per event, and times the operations but not mutexes
+        options.statistics = rocksdb::CreateDBStatistics();
+
+        // every table file gets a checksum as it is written, so that snapshots can tell unchanged files apart
+        options.file_checksum_gen_factory = rocksdb::GetFileChecksumGenCrc32cFactory();
+        options.compression = store_options.compression;
+        options.bottommost_compression = store_options.bottommost_compression;
+
+        // `OptimizeLevelStyleCompaction()` leaves the first levels uncompressed unless told otherwise
+        if(!store_options.compression_per_level.empty()) {
+            options.compression_per_level = store_options.compression_per_level;
+        }
+
+        options.rate_limiter = store_options.rate_limiter;
+        if(store_options.use_direct_io_for_compaction) {
+            options.use_direct_io_for_flush_and_compaction = true;
+            options.compaction_readahead_size = 2*1048576;
+        }
 
         // these need to be high for replication scenarios
         options.WAL_ttl_seconds = wal_ttl_secs;
@@ -101,6 +500,8 @@ public:
         // The replica uses native WAL, though.
         write_options.disableWAL = disable_wal;
 
+        init_column_family_options();
+
         // open DB
         init_db();
     }
@@ -110,23 +511,121 @@ public:
     }
 
     bool insert(const std::string& key, const std::string& value) {
+        trace_span_t span("store.insert");
         std::shared_lock lock(mutex);
-        rocksdb::Status status = db->Put(write_options, key, value);
+        rocksdb::Status status = db->Put(write_options, handle_of(key), key, value);
         return status.ok();
     }
 
     bool batch_write(rocksdb::WriteBatch& batch) {
+        trace_span_t span("store.batch_write");
+        span.set_attribute("writes", int64_t(batch.Count()));
         std::shared_lock lock(mutex);
-        rocksdb::Status status = db->Write(write_options, &batch);
+        column_family_router_t router(cf_handles);
+        rocksdb::Status status = batch.Iterate(&router);
+        if(!status.ok()) {
+            return false;
+        }
+
+        status = db->Write(write_options, &router.routed_batch);
         return status.ok();
     }
 
+    // Writes `kvs` into sorted table files, one per column family, and ingests them, bypassing the memtables and
+    // the WAL: meant for bulk loads of keys that do not exist yet. A table whose keys do not overlap the ones
+    // already stored goes straight to the last level, without being compacted on its way down. Of the pairs with
+    // the same key, the last one wins. The pairs are sorted in place.
+    bool ingest(std::vector<std::pair<std::string, std::string>>& kvs) {
+        std::shared_lock lock(mutex);
+
+        std::stable_sort(kvs.begin(), kvs.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+
+        std::vector<std::pair<std::string, std::string>> cf_kvs[NUM_COLUMN_FAMILIES];
+        for(size_t i = 0; i < kvs.size(); i++) {
+            if(i + 1 < kvs.size() && kvs[i].first == kvs[i+1].first) {
+                continue;
+            }
+
+            cf_kvs[get_column_family(kvs[i].first)].push_back(std::move(kvs[i]));
+        }
+
+        // the tables of the column families are built at once
+        std::vector<std::string> cf_paths(NUM_COLUMN_FAMILIES);
+        std::vector<rocksdb::Status> cf_statuses(NUM_COLUMN_FAMILIES);
+        std::vector<std::thread> writer_threads;
+
+        for(size_t i = 0; i < NUM_COLUMN_FAMILIES; i++) {
+            if(cf_kvs[i].empty()) {
+                continue;
+            }
+
+            cf_paths[i] = state_dir_path + "/ingest_" + std::to_string(ingest_file_counter++) + ".sst";
+
+            writer_threads.emplace_back([this, i, &cf_kvs, &cf_paths, &cf_statuses]() {
+                const rocksdb::Options table_options(options, cf_options[i]);
+                rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), table_options, cf_handles[i]);
+                rocksdb::Status status = writer.Open(cf_paths[i]);
+
+                for(size_t j = 0; status.ok() && j < cf_kvs[i].size(); j++) {
+                    status = writer.Put(cf_kvs[i][j].first, cf_kvs[i][j].second);
+                }
+
+                cf_statuses[i] = status.ok() ? writer.Finish() : status;
+            });
+        }
+
+        for(auto& writer_thread: writer_threads) {
+            writer_thread.join();
+        }
+
+        // the documents and their id mappings are ingested together or not at all
+        std::vector<rocksdb::IngestExternalFileArg> ingest_args;
+        rocksdb::Status status;
+
+        for(size_t i = 0; i < NUM_COLUMN_FAMILIES; i++) {
+            if(cf_paths[i].empty()) {
+                continue;
+            }
+
+            if(!cf_statuses[i].ok()) {
+                status = cf_statuses[i];
+            }
+
+            rocksdb::IngestExternalFileArg ingest_arg;
+            ingest_arg.column_family = cf_handles[i];
+            ingest_arg.external_files = {cf_paths[i]};
+            ingest_arg.options.move_files = true;
+            ingest_args.push_back(std::move(ingest_arg));
+        }
+
+        if(status.ok() && !ingest_args.empty()) {
+            status = db->IngestExternalFiles(ingest_args);
+        }
+
+        const bool ingested = status.ok();
+        if(!ingested) {
+            LOG(ERROR) << "Error while ingesting " << kvs.size() << " keys: " << status.ToString();
+        }
+
+        for(const auto& cf_path: cf_paths) {
+            if(!cf_path.empty()) {
+                // left behind when not moved into the store
+                std::remove(cf_path.c_str());
+            }
+        }
+
+        return ingested;
+    }
+
     bool contains(const std::string& key) const {
         std::shared_lock lock(mutex);
 
         std::string value;
         bool value_found;
-        bool key_may_exist = db->KeyMayExist(rocksdb::ReadOptions(), key, &value, &value_found);
+        bool key_may_exist = db->KeyMayExist(rocksdb::ReadOptions(), handle_of(key), key, &value,
+                                             &value_found);
 
         // returns false when key definitely does not exist
         if(!key_may_exist) {
@@ -138,13 +637,18 @@ public:
         }
 
         // otherwise, we have try getting the value
-        rocksdb::Status status = db->Get(rocksdb::ReadOptions(), key, &value);
+        rocksdb::Status status = db->Get(rocksdb::ReadOptions(), handle_of(key), key, &value);
         return status.ok() && !status.IsNotFound();
     }
 
     StoreStatus get(const std::string& key, std::string& value) const {
+        trace_span_t span("store.get");
         std::shared_lock lock(mutex);
-        rocksdb::Status status = db->Get(rocksdb::ReadOptions(), key, &value);
+        const bool sampled = start_read_sample();
+        rocksdb::Status status = db->Get(rocksdb::ReadOptions(), handle_of(key), key, &value);
+        if(sampled) {
+            end_read_sample();
+        }
 
         if(status.ok()) {
             return StoreStatus::FOUND;
@@ -158,28 +662,77 @@ public:
         return StoreStatus::ERROR;
     }
 
+    // values of `keys` fetched in a single batch: `values[i]` holds the value of `keys[i]` when its status is FOUND
+    //
+    // The batched flavour of `MultiGet()` looks the keys up level by level, sorted, so that the blocks that the keys
+    // of a table file need are read off the disk together (in parallel with io_uring, when RocksDB is built along
+    // with liburing) rather than one key after another.
+    void multi_get(const std::vector<std::string>& keys, std::vector<std::string>& values,
+                   std::vector<StoreStatus>& statuses) const {
+        trace_span_t span("store.multi_get");
+        span.set_attribute("keys", int64_t(keys.size()));
+        std::shared_lock lock(mutex);
+        const std::vector<rocksdb::Slice> key_slices(keys.begin(), keys.end());
+        std::vector<rocksdb::ColumnFamilyHandle*> key_cf_handles;
+        for(const auto& key: key_slices) {
+            key_cf_handles.push_back(handle_of(key));
+        }
+
+        std::vector<rocksdb::PinnableSlice> pinned_values(keys.size());
+        std::vector<rocksdb::Status> key_statuses(keys.size());
+
+        const bool sampled = start_read_sample();
+        db->MultiGet(rocksdb::ReadOptions(), keys.size(), key_cf_handles.data(), key_slices.data(),
+                     pinned_values.data(), key_statuses.data());
+        if(sampled) {
+            end_read_sample();
+        }
+
+        values.resize(keys.size());
+        statuses.resize(keys.size());
+
+        for(size_t i = 0; i < keys.size(); i++) {
+            if(key_statuses[i].ok()) {
+                values[i].assign(pinned_values[i].data(), pinned_values[i].size());
+                statuses[i] = StoreStatus::FOUND;
+            } else if(key_statuses[i].IsNotFound()) {
+                statuses[i] = StoreStatus::NOT_FOUND;
+            } else {
+                LOG(ERROR) << "Error while fetching the key: " << keys[i] << " - status is: "
+                           << key_statuses[i].ToString();
+                statuses[i] = StoreStatus::ERROR;
+            }
+        }
+    }
+
     bool remove(const std::string& key) {
+        trace_span_t span("store.remove");
         std::shared_lock lock(mutex);
-        rocksdb::Status status = db->Delete(write_options, key);
+        rocksdb::Status status = db->Delete(write_options, handle_of(key), key);
         return status.ok();
     }
 
+    // iterates over the column family of `prefix`: keys past the prefix may belong to other families and are not seen
     rocksdb::Iterator* scan(const std::string & prefix) {
+        return scan(prefix, rocksdb::ReadOptions());
+    }
+
+    rocksdb::Iterator* scan(const std::string & prefix, const rocksdb::ReadOptions& read_options) {
         std::shared_lock lock(mutex);
-        rocksdb::Iterator *iter = db->NewIterator(rocksdb::ReadOptions());
+        rocksdb::Iterator *iter = db->NewIterator(read_options, handle_of(prefix));
         iter->Seek(prefix);
         return iter;
     }
 
-    rocksdb::Iterator* get_iterator() {
+    rocksdb::Iterator* get_iterator(column_family_t column_family = DEFAULT_CF) {
         std::shared_lock lock(mutex);
-        rocksdb::Iterator* it = db->NewIterator(rocksdb::ReadOptions());
+        rocksdb::Iterator* it = db->NewIterator(rocksdb::ReadOptions(), cf_handles[column_family]);
         return it;
     };
 
     void scan_fill(const std::string & prefix, std::vector<std::string> & values) {
         std::shared_lock lock(mutex);
-        rocksdb::Iterator *iter = db->NewIterator(rocksdb::ReadOptions());
+        rocksdb::Iterator *iter = db->NewIterator(rocksdb::ReadOptions(), handle_of(prefix));
         for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
             values.push_back(iter->value().ToString());
         }
@@ -189,7 +742,15 @@ public:
 
     void increment(const std::string & key, uint32_t value) {
         std::shared_lock lock(mutex);
-        db->Merge(write_options, key, StringUtils::serialize_uint32_t(value));
+        db->Merge(write_options, handle_of(key), key, StringUtils::serialize_uint32_t(value));
+    }
+
+    // `patch` is a JSON object of the top level fields to set on the stored JSON object, with null for the fields
+    // to remove: it is applied when the value gets read or compacted, so that only the patch is written now
+    bool merge_patch(const std::string& key, const std::string& patch) {
+        std::shared_lock lock(mutex);
+        rocksdb::Status status = db->Merge(write_options, handle_of(key), key, patch);
+        return status.ok();
     }
 
     uint64_t get_latest_seq_number() const {
@@ -263,6 +824,10 @@ public:
 
     void close() {
         std::unique_lock lock(mutex);
+        if(db != nullptr) {
+            destroy_column_family_handles();
+        }
+
         delete db;
         db = nullptr;
     }
@@ -271,6 +836,10 @@ public:
         std::unique_lock lock(mutex);
 
         // we don't use close() to avoid nested lock and because lock is required until db is re-initialized
+        if(db != nullptr) {
+            destroy_column_family_handles();
+        }
+
         delete db;
         db = nullptr;
 
@@ -312,7 +881,29 @@ public:
     void flush() {
         std::shared_lock lock(mutex);
         rocksdb::FlushOptions options;
-        db->Flush(options);
+        db->Flush(options, cf_handles);
+    }
+
+    // name => "<checksum>_<size>" of the live table files, for the ones written with a checksum
+    std::map<std::string, std::string> get_table_file_checksums() const {
+        std::shared_lock lock(mutex);
+        std::vector<rocksdb::LiveFileMetaData> files_metadata;
+        db->GetLiveFilesMetaData(&files_metadata);
+
+        std::map<std::string, std::string> file_checksums;
+
+        for(const auto& file_metadata: files_metadata) {
+            if(file_metadata.file_checksum.empty()) {
+                continue;
+            }
+
+            // names start with a slash
+            const std::string& file_name = file_metadata.name.substr(file_metadata.name.find_last_of('/') + 1);
+            file_checksums[file_name] = StringUtils::str2hex(file_metadata.file_checksum) + "_" +
+                                        std::to_string(file_metadata.size);
+        }
+
+        return file_checksums;
     }
 
     rocksdb::Status create_check_point(rocksdb::Checkpoint** checkpoint_ptr, const std::string& db_snapshot_path) {
@@ -335,7 +926,43 @@ public:
 
     rocksdb::Status delete_range(const std::string& begin_key, const std::string& end_key) {
         std::shared_lock lock(mutex);
-        return db->DeleteRange(rocksdb::WriteOptions(), db->DefaultColumnFamily(), begin_key, end_key);
+        return db->DeleteRange(rocksdb::WriteOptions(), handle_of(begin_key), begin_key, end_key);
+    }
+
+    // deletes the keys starting with `prefix` from every column family, e.g. all the keys of a collection
+    rocksdb::Status delete_prefix(const std::string& prefix) {
+        std::shared_lock lock(mutex);
+
+        std::string end_key = prefix;
+        end_key.back()++;
+
+        rocksdb::WriteBatch batch;
+        for(auto cf_handle: cf_handles) {
+            batch.DeleteRange(cf_handle, prefix, end_key);
+        }
+
+        return db->Write(write_options, &batch);
+    }
+
+    // compacts away the keys under the prefix that `delete_prefix()` left range tombstones over, so that reads no
+    // longer skip over them and their disk space is released
+    rocksdb::Status compact_prefix(const std::string& prefix) {
+        std::shared_lock lock(mutex);
+
+        std::string end_key = prefix;
+        end_key.back()++;
+
+        const rocksdb::Slice begin(prefix), end(end_key);
+        rocksdb::CompactRangeOptions compact_options;
+
+        for(auto cf_handle: cf_handles) {
+            rocksdb::Status status = db->CompactRange(compact_options, cf_handle, &begin, &end);
+            if(!status.ok()) {
+                return status;
+            }
+        }
+
+        return rocksdb::Status::OK();
     }
 
     // Only for internal tests
@@ -351,6 +978,56 @@ public:
         return options;
     }
 
+    // sum of an integer property, such as `rocksdb.cur-size-all-mem-tables`, across the column families
+    bool get_int_property(const std::string& property, uint64_t& value) const {
+        std::shared_lock lock(mutex);
+        return db->GetAggregatedIntProperty(property, &value);
+    }
+
+    void get_stats(store_stats_t& stats) const {
+        static const std::vector<std::pair<std::string, rocksdb::Tickers>> tickers = {
+            {"block_cache_hit", rocksdb::BLOCK_CACHE_HIT},
+            {"block_cache_miss", rocksdb::BLOCK_CACHE_MISS},
+            {"memtable_hit", rocksdb::MEMTABLE_HIT},
+            {"memtable_miss", rocksdb::MEMTABLE_MISS},
+            {"bloom_filter_useful", rocksdb::BLOOM_FILTER_USEFUL},
+            {"keys_read", rocksdb::NUMBER_KEYS_READ},
+            {"keys_written", rocksdb::NUMBER_KEYS_WRITTEN},
+            {"bytes_read", rocksdb::BYTES_READ},
+            {"bytes_written", rocksdb::BYTES_WRITTEN},
+            {"flush_write_bytes", rocksdb::FLUSH_WRITE_BYTES},
+            {"compact_read_bytes", rocksdb::COMPACT_READ_BYTES},
+            {"compact_write_bytes", rocksdb::COMPACT_WRITE_BYTES},
+            {"stall_micros", rocksdb::STALL_MICROS},
+        };
+
+        static const std::vector<std::pair<std::string, rocksdb::Histograms>> histograms = {
+            {"get", rocksdb::DB_GET},
+            {"multi_get", rocksdb::DB_MULTIGET},
+            {"write", rocksdb::DB_WRITE},
+            {"seek", rocksdb::DB_SEEK},
+            {"flush", rocksdb::FLUSH_TIME},
+            {"compaction", rocksdb::COMPACTION_TIME},
+        };
+
+        stats = store_stats_t();
+
+        for(const auto& ticker: tickers) {
+            stats.tickers.emplace_back(ticker.first, options.statistics->getTickerCount(ticker.second));
+        }
+
+        for(const auto& histogram: histograms) {
+            rocksdb::HistogramData data;
+            options.statistics->histogramData(histogram.second, &data);
+            stats.histograms.emplace_back(histogram.first, data);
+        }
+
+        stats.num_sampled_reads = num_sampled_reads;
+        for(size_t i = 0; i < NUM_READ_STAGES; i++) {
+            stats.sampled_read_nanos.emplace_back(READ_STAGE_NAMES[i], sampled_read_nanos[i]);
+        }
+    }
+
     void print_memory_usage() {
         std::string index_usage;
         db->GetProperty("rocksdb.estimate-table-readers-mem", &index_usage);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "sparsepp.h"
+#include "ids_t.h"
+
+/*
+ *  Exact string values of a low cardinality facet field (keyed by their facet hash), each mapped to the ids of
+ *  the documents holding it. Answers `field:= [a, b]` and `field:!= [a, b]` filters with a union of id lists,
+ *  without going through the token postings and checking their offsets for an exact match.
+ *
+ *  Once the field has more than `MAX_VALUES` distinct values, the index is dropped for good and filters fall back
+ *  to the postings.
+ */
+class str_value_index_t {
+private:
+    spp::sparse_hash_map<uint64_t, void*> value_ids;
+    bool overflowed = false;
+
+    void destroy();
+
+public:
+    static constexpr size_t MAX_VALUES = 4096;
+
+    ~str_value_index_t();
+
+    void insert(uint64_t value_hash, uint32_t id);
+
+    void remove(uint64_t value_hash, uint32_t id);
+
+    [[nodiscard]] bool is_usable() const;
+
+    [[nodiscard]] size_t num_ids(uint64_t value_hash) const;
+
+    // allocates `ids` with the sorted union of the ids of the given values
+    void search(const std::vector<uint64_t>& value_hashes, uint32_t** ids, size_t& ids_len) const;
+
+    [[nodiscard]] size_t size() const;
+
+    // heap memory held by the map and its id lists
+    [[nodiscard]] size_t memory_bytes() const;
+};
@@ -39,7 +39,7 @@ struct StringUtils {
             temp = trim(temp);
 
             if (keep_empty || !temp.empty()) {
-                result.push_back(temp);
+                result.push_back(std::move(temp));
             }
 
             if(result.size() == max_values) {
@@ -69,6 +69,9 @@ struct StringUtils {
 
     static void split_to_values(const std::string& vals_str, std::vector<std::string>& filter_values);
 
+    // splits `facet_by` on the commas that are not within the parentheses of a range facet, e.g. `price(0..50,50..)`
+    static void split_facet(const std::string& facet_by, std::vector<std::string>& facet_fields);
+
     // Adapted from: http://stackoverflow.com/a/36000453/131050
     static std::string & trim(std::string & str) {
         // right trim
@@ -93,6 +96,24 @@ struct StringUtils {
     // Convert string of chars to its representative string of hex numbers
     static std::string str2hex(const std::string& str, bool capital = false);
 
+    // percent-encodes all but the unreserved characters of RFC 3986
+    static std::string url_encode(const std::string& text) {
+        static const char* hex_chars = "0123456789ABCDEF";
+        std::string encoded;
+
+        for(unsigned char c: text) {
+            if(isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+                encoded += c;
+            } else {
+                encoded += '%';
+                encoded += hex_chars[c >> 4];
+                encoded += hex_chars[c & 15];
+            }
+        }
+
+        return encoded;
+    }
+
     static std::string url_decode(const std::string& text) {
         char h;
         std::ostringstream escaped;
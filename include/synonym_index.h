@@ -107,11 +107,27 @@ struct synonym_t {
 class SynonymIndex {
 private:
 
+    // node of a trie over the tokens of the indexed phrases (roots, or the synonyms of root-less definitions)
+    struct phrase_node_t {
+        spp::sparse_hash_map<std::string, uint32_t> children;
+
+        // number of indexed phrases ending at this node
+        uint32_t num_phrases = 0;
+    };
+
     mutable std::shared_mutex mutex;
     Store* store;
     spp::sparse_hash_map<std::string, synonym_t> synonym_definitions;
     spp::sparse_hash_map<uint64_t, std::vector<std::string>> synonym_index;
 
+    // root at 0: the windows of a query that spell out a phrase are found by walking the trie from each token,
+    // instead of hashing every window and looking it up
+    std::vector<phrase_node_t> phrase_nodes;
+
+    void add_phrase(const std::vector<std::string>& phrase);
+
+    void remove_phrase(const std::vector<std::string>& phrase);
+
     void synonym_reduction_internal(const std::vector<std::string>& tokens,
                                     size_t start_window_size,
                                     size_t start_index_pos,
@@ -122,7 +138,7 @@ public:
 
     static constexpr const char* COLLECTION_SYNONYM_PREFIX = "$CY";
 
-    SynonymIndex(Store* store): store(store) { }
+    SynonymIndex(Store* store): store(store), phrase_nodes(1) { }
 
     static std::string get_synonym_key(const std::string & collection_name, const std::string & synonym_id);
 
@@ -1,4 +1,7 @@
+#pragma once
+
 #include <string>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <thread>
@@ -31,6 +34,15 @@ struct cpu_stat_t {
     std::string idle;
 };
 
+// the allocations of the current thread are served off `arena` (unless it is NO_ARENA) for as long as it lives
+struct allocator_arena_scope_t {
+    unsigned prev_arena;
+
+    explicit allocator_arena_scope_t(unsigned arena);
+
+    ~allocator_arena_scope_t();
+};
+
 class SystemMetrics {
 private:
 
@@ -158,6 +170,25 @@ public:
 
     static float used_memory_ratio();
 
+    // bytes allocated by the allocator, held active in its pages and resident in its mapped pages, without the
+    // `/proc` reads of `get()`
+    static void get_allocator_bytes(uint64_t& allocated, uint64_t& active, uint64_t& resident);
+
+    // returns the free pages of all arenas of the allocator to the OS, e.g. once a large structure is released
+    static void release_free_memory();
+
+    static constexpr unsigned NO_ARENA = UINT32_MAX;
+
+    // an arena of the allocator of its own, for the structures of an index that are not to share pages with those
+    // of other indices: one released before is reused. NO_ARENA when none can be created.
+    static unsigned acquire_arena();
+
+    // returns the free pages of the arena to the OS, and keeps the arena for the next `acquire_arena()`
+    static void release_arena(unsigned arena);
+
+    // bytes of the pages of the arena that are in use
+    static uint64_t get_arena_active_bytes(unsigned arena);
+
     std::vector<cpu_stat_t> get_cpu_stats() {
         // snapshot 1
         std::vector<cpu_data_t> cpu_data_prev;
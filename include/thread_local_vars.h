@@ -1,9 +1,59 @@
+#pragma once
+
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 
 extern thread_local int64_t write_log_index;
 
+struct search_profile_t;
+struct trace_context_t;
+
+// Shared by all the threads that work on a single search request, so that they can all stop early
+struct search_cancel_token_t {
+    // points to the disposal flag of the http request, which is set when the client connection goes away
+    const std::atomic<bool>* req_disposed = nullptr;
+    std::atomic<bool> cancelled{false};
+
+    bool is_cancelled() const {
+        return cancelled || (req_disposed != nullptr && *req_disposed);
+    }
+};
+
 // These are used for circuit breaking search requests
 // NOTE: if you fork off main search thread, care must be taken to initialize these from parent thread values
 extern thread_local std::chrono::high_resolution_clock::time_point search_begin;
 extern thread_local int64_t search_stop_ms;
-extern thread_local bool search_cutoff;
\ No newline at end of file
+extern thread_local bool search_cutoff;
+extern thread_local search_cancel_token_t* search_cancel_token;
+
+// Options that a search with a latency budget gave up on as the budget ran out, so that its remaining stages finish
+// within the budget with cheaper results instead of being cut off
+enum search_degradation_t: uint32_t {
+    DEGRADED_TYPOS = 1 << 0,            // typo combinations beyond the ones already tried
+    DEGRADED_MAX_CANDIDATES = 1 << 1,   // candidates of a token combination capped
+    DEGRADED_INFIX = 1 << 2,            // infix fallback skipped
+    DEGRADED_FACETS = 1 << 3,           // facets counted over a sample of the results
+};
+
+// latency budget of the search in milliseconds, 0 when it has none
+extern thread_local int64_t search_budget_ms;
+
+// `search_degradation_t` flags of the degradations applied so far
+extern thread_local uint32_t search_degradations;
+
+// set only when the search is profiled
+extern thread_local search_profile_t* search_profile;
+
+// estimated number of matches within the posting list blocks that top-k pruning skipped, which `found` leaves out
+extern thread_local size_t search_num_pruned_ids;
+
+// context of the innermost span open on this thread, set only while a sampled request is traced (see `Tracer`)
+extern thread_local const trace_context_t* active_trace;
+
+// Returns true once the search on this thread has run past `search_stop_ms` or has been cancelled.
+// Running past the deadline cancels the token, so that the other threads of the search stop at their next check.
+bool search_cutoff_reached();
+
+// Returns true when the search on this thread has a latency budget and has used more than `share` of it.
+bool search_budget_spent(double share);
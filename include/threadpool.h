@@ -2,67 +2,332 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
-#include <queue>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+enum class task_priority_t {
+    INTERACTIVE = 0,        // requests and the sub-tasks they fan out to
+    BACKGROUND = 1,         // indexing and other work that can wait behind interactive tasks
+};
+
+// what a task does, so that the time spent waiting and running can be told apart for each kind of work
+enum class task_kind_t {
+    OTHER = 0,
+    REQUEST = 1,            // an API request handler
+    SEARCH = 2,             // a range of the candidates of a search, or of its filters and hits
+    FACETS = 3,             // a batch of the ids of a search to be faceted
+    INDEXING = 4,           // writes: parsing and indexing batches of documents
+};
+
+struct thread_pool_stats_t {
+    size_t queue_depth = 0;
+    uint64_t num_dequeued = 0;
+    uint64_t total_wait_us = 0;
+};
+
+struct thread_pool_task_stats_t {
+    // bucket `i` counts the durations of fewer than 2^i microseconds (and at least 2^(i-1)); the last bucket
+    // counts the rest
+    static constexpr size_t NUM_DURATION_BUCKETS = 24;
+
+    size_t queue_depth = 0;
+    size_t num_active = 0;
+    uint64_t num_started = 0;
+    uint64_t num_finished = 0;
+    uint64_t total_wait_us = 0;
+    uint64_t total_run_us = 0;
+    uint64_t wait_buckets[NUM_DURATION_BUCKETS] = {};
+    uint64_t run_buckets[NUM_DURATION_BUCKETS] = {};
+
+    static size_t duration_bucket(uint64_t duration_us) {
+        const size_t bucket = (duration_us == 0) ? 0 : (64 - __builtin_clzll(duration_us));
+        return std::min(bucket, NUM_DURATION_BUCKETS - 1);
+    }
+};
 
 class ThreadPool {
 public:
+    static constexpr size_t NUM_PRIORITIES = 2;
+    static constexpr size_t NUM_TASK_KINDS = 5;
+
     explicit ThreadPool(size_t);
     template<class F, class... Args>
     decltype(auto) enqueue(F&& f, Args&&... args);
+    template<class F, class... Args>
+    decltype(auto) enqueue_priority(task_priority_t priority, F&& f, Args&&... args);
+    template<class F, class... Args>
+    decltype(auto) enqueue_task(task_priority_t priority, task_kind_t kind, F&& f, Args&&... args);
+    thread_pool_stats_t get_stats(task_priority_t priority) const;
+    thread_pool_task_stats_t get_task_stats(task_kind_t kind) const;
+    // workers running a task
+    size_t num_active() const;
+    static const char* task_kind_name(task_kind_t kind);
+    size_t size() const;
+    // pins worker `i` to cpu `(first_cpu + i) % num_cpus`, which is a no-op off linux
+    bool pin_workers(size_t first_cpu, size_t num_cpus);
+    // deals the workers out to the numa nodes in turn, pinning each to the cpus of its node (`node_cpus[node]`):
+    // tasks enqueued within a `numa_node_scope_t` then go to the workers of its node, and workers steal the tasks of
+    // the workers of their own node first. To be called once, before any task is enqueued.
+    bool pin_workers_to_nodes(const std::vector<std::vector<size_t>>& node_cpus);
+    // node whose workers run the tasks of `key` (e.g. a collection id), or -1 when the workers are not on nodes
+    int get_node(uint64_t key) const;
+    size_t num_nodes() const;
+    // tasks enqueued from this thread go to the workers of this node (when not negative)
+    static inline thread_local int numa_node_hint = -1;
     void shutdown();
 private:
+    struct queued_task_t {
+        std::packaged_task<void()> task;
+        std::chrono::steady_clock::time_point enqueue_time;
+        task_kind_t kind = task_kind_t::OTHER;
+    };
+
+    struct task_counters_t {
+        std::atomic<size_t> queue_depth{0};
+        std::atomic<size_t> num_active{0};
+        std::atomic<uint64_t> num_started{0};
+        std::atomic<uint64_t> num_finished{0};
+        std::atomic<uint64_t> total_wait_us{0};
+        std::atomic<uint64_t> total_run_us{0};
+        std::atomic<uint64_t> wait_buckets[thread_pool_task_stats_t::NUM_DURATION_BUCKETS] = {};
+        std::atomic<uint64_t> run_buckets[thread_pool_task_stats_t::NUM_DURATION_BUCKETS] = {};
+    };
+
+    // every worker owns a queue per priority: it takes tasks from its own queues first and steals from the
+    // queues of the other workers only when its own are empty
+    struct worker_queue_t {
+        std::mutex mutex;
+        std::deque<queued_task_t> tasks[NUM_PRIORITIES];
+    };
+
     // need to keep track of threads so we can join them
     std::vector< std::thread > workers;
-    // the task queue
-    std::queue< std::packaged_task<void()> > tasks;
+    // the task queues, one per worker
+    std::vector< std::unique_ptr<worker_queue_t> > queues;
+    std::atomic<size_t> next_queue;
+
+    std::atomic<size_t> queue_depths[NUM_PRIORITIES];
+    std::atomic<uint64_t> num_dequeued[NUM_PRIORITIES];
+    std::atomic<uint64_t> total_wait_us[NUM_PRIORITIES];
+
+    task_counters_t task_counters[NUM_TASK_KINDS];
 
     // synchronization
     std::mutex queue_mutex;
     std::condition_variable condition;
     std::condition_variable condition_producers;
+    size_t num_pending;     // tasks not yet taken by a worker, guarded by `queue_mutex`
     bool stop;
+
+    // lets an enqueue from a worker thread of this pool land on that worker's own queue
+    static inline thread_local const ThreadPool* current_pool = nullptr;
+    static inline thread_local size_t current_worker = 0;
+
+    // node of every worker and workers of every node, once `pin_workers_to_nodes()` publishes them by setting
+    // `num_worker_nodes`: they are not changed after that
+    std::vector<size_t> worker_nodes;
+    std::vector<size_t> worker_node_positions;
+    std::vector<std::vector<size_t>> node_workers;
+    std::atomic<size_t> num_worker_nodes{0};
+
+    bool take_task(size_t worker_index, queued_task_t& queued_task);
+
+    bool take_task_from(size_t queue_index, size_t priority, queued_task_t& queued_task);
+
+    size_t get_enqueue_index();
+
+    void run_task(queued_task_t& queued_task);
+};
+
+// Sends the tasks enqueued from the calling thread to the workers of `node` (see `ThreadPool::get_node()`) for as long
+// as it is open, so that the searches and writes of a collection run on the node that its memory was first touched
+// on. A negative node leaves the tasks to go anywhere.
+struct numa_node_scope_t {
+    const int prev_node_hint;
+
+    explicit numa_node_scope_t(int node): prev_node_hint(ThreadPool::numa_node_hint) {
+        ThreadPool::numa_node_hint = node;
+    }
+
+    numa_node_scope_t(const numa_node_scope_t&) = delete;
+    numa_node_scope_t& operator=(const numa_node_scope_t&) = delete;
+
+    ~numa_node_scope_t() {
+        ThreadPool::numa_node_hint = prev_node_hint;
+    }
 };
 
 // the constructor just launches some amount of workers
 inline ThreadPool::ThreadPool(size_t threads)
-        :   stop(false)
+        :   next_queue(0), num_pending(0), stop(false)
 {
+    for(size_t p = 0; p < NUM_PRIORITIES; p++) {
+        queue_depths[p] = 0;
+        num_dequeued[p] = 0;
+        total_wait_us[p] = 0;
+    }
+
+    for(size_t i = 0; i < std::max<size_t>(threads, 1); i++) {
+        queues.emplace_back(new worker_queue_t());
+    }
+
     for(size_t i = 0;i<threads;++i)
         workers.emplace_back(
-                [this]
+                [this, i]
                 {
+                    current_pool = this;
+                    current_worker = i;
+
                     for(;;)
                     {
-                        std::packaged_task<void()> task;
-                        {
+                        queued_task_t queued_task;
+
+                        if(!take_task(i, queued_task)) {
                             std::unique_lock<std::mutex> lock(this->queue_mutex);
                             this->condition.wait(lock,
-                                                 [this]{ return this->stop || !this->tasks.empty(); });
+                                                 [this]{ return this->stop || this->num_pending != 0; });
                             if(this->stop) {
                                 return;
                             }
 
-                            if(this->tasks.empty()) {
-                                continue;
-                            }
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
-                            if (tasks.empty()) {
-                                condition_producers.notify_one(); // notify the destructor that the queue is empty
-                            }
+                            continue;
                         }
 
-                        task();
+                        run_task(queued_task);
                     }
                 }
         );
 }
 
+inline bool ThreadPool::take_task(size_t worker_index, queued_task_t& queued_task) {
+    const size_t num_queues = queues.size();
+    const size_t num_nodes = num_worker_nodes.load(std::memory_order_acquire);
+
+    for(size_t p = 0; p < NUM_PRIORITIES; p++) {
+        if(num_nodes == 0) {
+            for(size_t k = 0; k < num_queues; k++) {
+                if(take_task_from((worker_index + k) % num_queues, p, queued_task)) {
+                    return true;
+                }
+            }
+
+            continue;
+        }
+
+        // the workers of the worker's own node first, starting with itself, and then those of the other nodes
+        const size_t worker_node = worker_nodes[worker_index];
+
+        for(size_t n = 0; n < num_nodes; n++) {
+            const std::vector<size_t>& workers_of_node = node_workers[(worker_node + n) % num_nodes];
+            const size_t first_position = (n == 0) ? worker_node_positions[worker_index] : 0;
+
+            for(size_t k = 0; k < workers_of_node.size(); k++) {
+                const size_t queue_index = workers_of_node[(first_position + k) % workers_of_node.size()];
+                if(take_task_from(queue_index, p, queued_task)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+inline bool ThreadPool::take_task_from(size_t queue_index, size_t p, queued_task_t& queued_task) {
+    worker_queue_t& queue = *queues[queue_index];
+    std::unique_lock<std::mutex> queue_lock(queue.mutex);
+
+    if(queue.tasks[p].empty()) {
+        return false;
+    }
+
+    queued_task = std::move(queue.tasks[p].front());
+    queue.tasks[p].pop_front();
+    queue_lock.unlock();
+
+    auto wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - queued_task.enqueue_time).count();
+
+    queue_depths[p]--;
+    num_dequeued[p]++;
+    total_wait_us[p] += wait_us;
+
+    task_counters_t& counters = task_counters[static_cast<size_t>(queued_task.kind)];
+    counters.queue_depth--;
+    counters.num_started++;
+    counters.total_wait_us += wait_us;
+    counters.wait_buckets[thread_pool_task_stats_t::duration_bucket(wait_us)]++;
+
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    num_pending--;
+    if(num_pending == 0) {
+        condition_producers.notify_one(); // notify the destructor that the queue is empty
+    }
+
+    return true;
+}
+
+inline size_t ThreadPool::get_enqueue_index() {
+    const size_t num_nodes = num_worker_nodes.load(std::memory_order_acquire);
+    const int node_hint = numa_node_hint;
+
+    if(num_nodes == 0 || node_hint < 0) {
+        return (current_pool == this) ? current_worker : (next_queue++ % queues.size());
+    }
+
+    const size_t node = size_t(node_hint) % num_nodes;
+
+    if(current_pool == this && worker_nodes[current_worker] == node) {
+        return current_worker;
+    }
+
+    const std::vector<size_t>& workers_of_node = node_workers[node];
+    return workers_of_node[next_queue++ % workers_of_node.size()];
+}
+
+inline void ThreadPool::run_task(queued_task_t& queued_task) {
+    task_counters_t& counters = task_counters[static_cast<size_t>(queued_task.kind)];
+    counters.num_active++;
+
+    const auto start_time = std::chrono::steady_clock::now();
+    queued_task.task();
+    const uint64_t run_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+
+    counters.num_active--;
+    counters.num_finished++;
+    counters.total_run_us += run_us;
+    counters.run_buckets[thread_pool_task_stats_t::duration_bucket(run_us)]++;
+}
+
 // add new work item to the pool
 template<class F, class... Args>
 decltype(auto) ThreadPool::enqueue(F&& f, Args&&... args)
+{
+    return enqueue_priority(task_priority_t::INTERACTIVE, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+decltype(auto) ThreadPool::enqueue_priority(task_priority_t priority, F&& f, Args&&... args)
+{
+    return enqueue_task(priority, task_kind_t::OTHER, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+decltype(auto) ThreadPool::enqueue_task(task_priority_t priority, task_kind_t kind, F&& f, Args&&... args)
 {
     using return_type = std::invoke_result_t<F, Args...>;
 
@@ -71,22 +336,161 @@ decltype(auto) ThreadPool::enqueue(F&& f, Args&&... args)
     );
 
     std::future<return_type> res = task.get_future();
+
     {
         std::unique_lock<std::mutex> lock(queue_mutex);
 
         // don't allow enqueueing after stopping the pool
-        if(!stop) {
-            tasks.emplace(std::move(task));
+        if(stop) {
+            return res;
         }
+
+        num_pending++;
+    }
+
+    const size_t p = static_cast<size_t>(priority);
+    const size_t queue_index = get_enqueue_index();
+    worker_queue_t& queue = *queues[queue_index];
+
+    {
+        std::unique_lock<std::mutex> queue_lock(queue.mutex);
+        queue.tasks[p].push_back(queued_task_t{std::packaged_task<void()>(std::move(task)),
+                                               std::chrono::steady_clock::now(), kind});
+        queue_depths[p]++;
+        task_counters[static_cast<size_t>(kind)].queue_depth++;
     }
+
     condition.notify_one();
     return res;
 }
 
+inline thread_pool_stats_t ThreadPool::get_stats(task_priority_t priority) const {
+    const size_t p = static_cast<size_t>(priority);
+
+    thread_pool_stats_t stats;
+    stats.queue_depth = queue_depths[p];
+    stats.num_dequeued = num_dequeued[p];
+    stats.total_wait_us = total_wait_us[p];
+    return stats;
+}
+
+inline thread_pool_task_stats_t ThreadPool::get_task_stats(task_kind_t kind) const {
+    const task_counters_t& counters = task_counters[static_cast<size_t>(kind)];
+
+    thread_pool_task_stats_t stats;
+    stats.queue_depth = counters.queue_depth;
+    stats.num_active = counters.num_active;
+    stats.num_started = counters.num_started;
+    stats.num_finished = counters.num_finished;
+    stats.total_wait_us = counters.total_wait_us;
+    stats.total_run_us = counters.total_run_us;
+
+    for(size_t i = 0; i < thread_pool_task_stats_t::NUM_DURATION_BUCKETS; i++) {
+        stats.wait_buckets[i] = counters.wait_buckets[i];
+        stats.run_buckets[i] = counters.run_buckets[i];
+    }
+
+    return stats;
+}
+
+inline size_t ThreadPool::num_active() const {
+    size_t active = 0;
+    for(const auto& counters: task_counters) {
+        active += counters.num_active;
+    }
+
+    return active;
+}
+
+inline const char* ThreadPool::task_kind_name(task_kind_t kind) {
+    switch(kind) {
+        case task_kind_t::REQUEST:
+            return "request";
+        case task_kind_t::SEARCH:
+            return "search";
+        case task_kind_t::FACETS:
+            return "facets";
+        case task_kind_t::INDEXING:
+            return "indexing";
+        default:
+            return "other";
+    }
+}
+
+inline size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+inline bool ThreadPool::pin_workers(size_t first_cpu, size_t num_cpus) {
+#ifdef __linux__
+    if(num_cpus == 0) {
+        return false;
+    }
+
+    bool pinned = true;
+
+    for(size_t i = 0; i < workers.size(); i++) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET((first_cpu + i) % num_cpus, &cpu_set);
+        pinned = (pthread_setaffinity_np(workers[i].native_handle(), sizeof(cpu_set_t), &cpu_set) == 0) && pinned;
+    }
+
+    return pinned;
+#else
+    return true;
+#endif
+}
+
+inline bool ThreadPool::pin_workers_to_nodes(const std::vector<std::vector<size_t>>& node_cpus) {
+    if(node_cpus.empty() || workers.empty() || num_worker_nodes.load() != 0) {
+        return false;
+    }
+
+    // a node with more workers than cpus still gets all of them: the workers of a node share its cpus
+    const size_t num_nodes = std::min(node_cpus.size(), workers.size());
+    worker_nodes.resize(workers.size());
+    worker_node_positions.resize(workers.size());
+    node_workers.assign(num_nodes, {});
+
+    bool pinned = true;
+
+    for(size_t i = 0; i < workers.size(); i++) {
+        const size_t node = i % num_nodes;
+        worker_nodes[i] = node;
+        worker_node_positions[i] = node_workers[node].size();
+        node_workers[node].push_back(i);
+
+#ifdef __linux__
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for(size_t cpu: node_cpus[node]) {
+            if(cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &cpu_set);
+            }
+        }
+
+        pinned = (pthread_setaffinity_np(workers[i].native_handle(), sizeof(cpu_set_t), &cpu_set) == 0) && pinned;
+#endif
+    }
+
+    num_worker_nodes.store(num_nodes, std::memory_order_release);
+    return pinned;
+}
+
+inline int ThreadPool::get_node(uint64_t key) const {
+    const size_t num_nodes = num_worker_nodes.load(std::memory_order_acquire);
+    return (num_nodes == 0) ? -1 : int(key % num_nodes);
+}
+
+inline size_t ThreadPool::num_nodes() const {
+    return num_worker_nodes.load(std::memory_order_acquire);
+}
+
 inline void ThreadPool::shutdown() {
     {
         std::unique_lock<std::mutex> lock(queue_mutex);
-        condition_producers.wait(lock, [this] { return tasks.empty(); });
+        condition_producers.wait(lock, [this] { return num_pending == 0; });
         stop = true;
     }
     condition.notify_all();
@@ -47,20 +47,30 @@ private:
         );
     }
 
+    // end of the run of indexed ascii chars that starts at `start`
+    inline size_t get_index_run_end(size_t start) const {
+        size_t end = start;
+        while(end < text.size() && (is_ascii_alnum(text[end]) || index_symbols[uint8_t(text[end])] == 1)) {
+            end++;
+        }
+
+        return end;
+    }
+
 public:
 
+    // per thread, for values of up to `NORMALIZED_TEXT_MAX_CACHED_LEN` bytes
+    static const size_t NORMALIZED_TEXTS_CACHE_CAPACITY = 1024;
+    static const size_t NORMALIZED_TEXT_MAX_CACHED_LEN = 128;
+
     explicit Tokenizer(const std::string& input,
                        bool normalize=true, bool no_op=false,
                        const std::string& locale = "",
                        const std::vector<char>& symbols_to_index = {},
                        const std::vector<char>& separators = {});
 
-    ~Tokenizer() {
-        iconv_close(cd);
-        free(normalized_text);
-        delete bi;
-        delete transliterator;
-    }
+    // hands its iconv descriptor and ICU iterators back to the pool of the thread
+    ~Tokenizer();
 
     void init(const std::string& input);
 
@@ -77,4 +87,12 @@ public:
     static inline bool is_ascii_char(char c) {
         return (c & ~0x7f) == 0;
     }
+
+    static inline bool is_ascii_alnum(char c) {
+        return uint8_t((c | 0x20) - 'a') < 26 || uint8_t(c - '0') < 10;
+    }
+
+    static inline char ascii_tolower(char c) {
+        return (uint8_t(c - 'A') < 26) ? char(c | 0x20) : c;
+    }
 };
\ No newline at end of file
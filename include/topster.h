@@ -5,7 +5,11 @@
 #include <cstdio>
 #include <algorithm>
 #include <unordered_map>
+#include <vector>
+#include "sparsepp.h"
+#include "search_arena.h"
 
+// Trivially copyable, so that topsters can keep KVs off the arena of the search (see `search_arena_t`).
 struct KV {
     uint8_t field_id{};
     uint8_t match_score_index{};
@@ -16,9 +20,6 @@ struct KV {
     uint64_t distinct_key{};
     int64_t scores[3]{};  // match score + 2 custom attributes
 
-    // to be used only in final aggregation
-    uint64_t* query_indices = nullptr;
-
     KV(uint8_t field_id, uint16_t queryIndex, uint32_t token_bits, uint64_t key, uint64_t distinct_key,
        uint8_t match_score_index, const int64_t *scores):
             field_id(field_id), match_score_index(match_score_index),
@@ -30,68 +31,274 @@ struct KV {
     }
 
     KV() = default;
+};
+
+/*
+ * Open addressing (linear probing) map from the keys held by a topster to their KVs. It is sized up front for
+ * twice the capacity of the topster (for the merges of buffered inserts), so that it is never more than half full
+ * and never grows. Erasure shifts the entries that follow back into place instead of leaving tombstones. The slots
+ * are taken off a search arena when given one.
+ */
+class topster_key_map_t {
+private:
+    struct slot_t {
+        uint64_t key = 0;
+        KV* kv = nullptr;
+    };
+
+    slot_t* slots;
+    size_t mask;
+    bool owns_slots;
+
+    [[nodiscard]] size_t home_slot(uint64_t key) const {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key & mask;
+    }
 
-    KV(KV& kv) = default;
+public:
+    explicit topster_key_map_t(size_t capacity, search_arena_t* arena = nullptr) {
+        size_t num_slots = 4;
+        while(num_slots < capacity * 4) {
+            num_slots <<= 1;
+        }
 
-    KV(KV&& kv) noexcept : field_id(kv.field_id), match_score_index(kv.match_score_index),
-                 query_index(kv.query_index), array_index(kv.array_index), token_bits(kv.token_bits),
-                 key(kv.key), distinct_key(kv.distinct_key) {
+        owns_slots = (arena == nullptr);
+        slots = owns_slots ? new slot_t[num_slots] : arena->allocate_array<slot_t>(num_slots);
+        mask = num_slots - 1;
+    }
 
-        scores[0] = kv.scores[0];
-        scores[1] = kv.scores[1];
-        scores[2] = kv.scores[2];
+    topster_key_map_t(const topster_key_map_t&) = delete;
+    topster_key_map_t& operator=(const topster_key_map_t&) = delete;
 
-        query_indices = kv.query_indices;
-        kv.query_indices = nullptr;
+    ~topster_key_map_t() {
+        if(owns_slots) {
+            delete [] slots;
+        }
     }
 
-    KV& operator=(KV&& kv) noexcept  {
-        if (this != &kv) {
-            field_id = kv.field_id;
-            match_score_index = kv.match_score_index;
-            query_index = kv.query_index;
-            array_index = kv.array_index;
-            token_bits = kv.token_bits;
-            key = kv.key;
-            distinct_key = kv.distinct_key;
+    [[nodiscard]] KV* find(uint64_t key) const {
+        for(size_t i = home_slot(key); slots[i].kv != nullptr; i = (i + 1) & mask) {
+            if(slots[i].key == key) {
+                return slots[i].kv;
+            }
+        }
 
-            scores[0] = kv.scores[0];
-            scores[1] = kv.scores[1];
-            scores[2] = kv.scores[2];
+        return nullptr;
+    }
 
-            delete[] query_indices;
-            query_indices = kv.query_indices;
-            kv.query_indices = nullptr;
+    // replaces the KV of an existing key
+    void emplace(uint64_t key, KV* kv) {
+        size_t i = home_slot(key);
+        while(slots[i].kv != nullptr && slots[i].key != key) {
+            i = (i + 1) & mask;
         }
 
-        return *this;
+        slots[i].key = key;
+        slots[i].kv = kv;
     }
 
-    KV& operator=(KV& kv) noexcept  {
-        if (this != &kv) {
-            field_id = kv.field_id;
-            match_score_index = kv.match_score_index;
-            query_index = kv.query_index;
-            array_index = kv.array_index;
-            token_bits = kv.token_bits;
-            key = kv.key;
-            distinct_key = kv.distinct_key;
+    void erase(uint64_t key) {
+        size_t i = home_slot(key);
+        while(slots[i].kv != nullptr && slots[i].key != key) {
+            i = (i + 1) & mask;
+        }
 
-            scores[0] = kv.scores[0];
-            scores[1] = kv.scores[1];
-            scores[2] = kv.scores[2];
+        if(slots[i].kv == nullptr) {
+            return ;
+        }
 
-            delete[] query_indices;
-            query_indices = kv.query_indices;
-            kv.query_indices = nullptr;
+        for(size_t j = (i + 1) & mask; slots[j].kv != nullptr; j = (j + 1) & mask) {
+            const size_t home = home_slot(slots[j].key);
+
+            // an entry stays where it is if its home slot lies cyclically within (i, j]
+            const bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if(!stays) {
+                slots[i] = slots[j];
+                i = j;
+            }
         }
 
-        return *this;
+        slots[i].kv = nullptr;
     }
 
-    ~KV() {
-        delete [] query_indices;
-        query_indices = nullptr;
+    void clear() {
+        for(size_t i = 0; i <= mask; i++) {
+            slots[i].kv = nullptr;
+        }
+    }
+};
+
+/*
+ * Top-K KVs of every group of a `distinct` topster. The groups live side by side in a single arena of KVs, with a
+ * fixed-size block of `group_capacity` slots handed out to a group the first time its distinct key is seen, so
+ * that a query producing many groups does not allocate a topster per group. Each block is kept as a min-heap.
+ *
+ * With a single KV per group, a group stands or falls by that KV alone, so that only the groups of a page need to
+ * be kept: once there are twice as many groups as `max_groups`, the groups that are not among the top `max_groups`
+ * are let go, after which KVs that would not make it past the last group kept are turned away.
+ */
+class group_topster_t {
+private:
+    uint32_t group_capacity;
+
+    // no limit when 0
+    size_t max_groups = 0;
+
+    // the smallest KV kept by the last `prune()`
+    bool has_threshold = false;
+    KV threshold;
+
+    std::vector<KV> arena;
+    std::vector<uint32_t> group_sizes;
+    std::vector<uint64_t> group_keys;
+
+    // distinct key => index of the group's block
+    spp::sparse_hash_map<uint64_t, uint32_t> group_indices;
+
+    static bool is_greater(const KV& a, const KV& b) {
+        return std::tie(a.scores[0], a.scores[1], a.scores[2], a.key) >
+               std::tie(b.scores[0], b.scores[1], b.scores[2], b.key);
+    }
+
+    static void assign(KV& slot, const KV* kv) {
+        slot = KV(kv->field_id, kv->query_index, kv->token_bits, kv->key, kv->distinct_key,
+                  kv->match_score_index, kv->scores);
+    }
+
+    // keeps the top `max_groups` groups, for a single KV per group
+    void prune() {
+        std::nth_element(arena.begin(), arena.begin() + (max_groups - 1), arena.end(), is_greater);
+        arena.resize(max_groups);
+
+        threshold = arena[max_groups - 1];
+        has_threshold = true;
+
+        group_sizes.assign(max_groups, 1);
+        group_keys.resize(max_groups);
+        group_indices.clear();
+
+        for(uint32_t i = 0; i < max_groups; i++) {
+            group_keys[i] = arena[i].distinct_key;
+            group_indices.emplace(arena[i].distinct_key, i);
+        }
+    }
+
+public:
+    // fewer groups are not worth letting go of
+    static constexpr size_t MIN_PRUNED_GROUPS = 1024;
+
+    explicit group_topster_t(size_t group_capacity): group_capacity(group_capacity) {
+    }
+
+    // only the top `max_groups` groups are asked for (when there is a single KV per group)
+    void set_max_groups(size_t max_groups) {
+        this->max_groups = (group_capacity == 1) ? max_groups : 0;
+    }
+
+    [[nodiscard]] size_t get_max_groups() const {
+        return max_groups;
+    }
+
+    bool add(const KV* kv) {
+        if(group_capacity == 0) {
+            return false;
+        }
+
+        if(has_threshold && !is_greater(*kv, threshold)) {
+            return false;
+        }
+
+        uint32_t group_index;
+        const auto group_it = group_indices.find(kv->distinct_key);
+
+        if(group_it == group_indices.end()) {
+            if(max_groups != 0 && group_sizes.size() >= 2 * std::max(max_groups, MIN_PRUNED_GROUPS)) {
+                prune();
+
+                if(!is_greater(*kv, threshold)) {
+                    return false;
+                }
+            }
+
+            group_index = group_sizes.size();
+            group_indices.emplace(kv->distinct_key, group_index);
+            group_sizes.push_back(0);
+            group_keys.push_back(kv->distinct_key);
+            arena.resize(arena.size() + group_capacity);
+        } else {
+            group_index = group_it->second;
+        }
+
+        KV* group_kvs = &arena[size_t(group_index) * group_capacity];
+        uint32_t& group_size = group_sizes[group_index];
+
+        // the same document can be added more than once (e.g. for different typo corrections)
+        for(uint32_t i = 0; i < group_size; i++) {
+            if(group_kvs[i].key == kv->key) {
+                if(!is_greater(*kv, group_kvs[i])) {
+                    return false;
+                }
+
+                assign(group_kvs[i], kv);
+                std::make_heap(group_kvs, group_kvs + group_size, is_greater);
+                return true;
+            }
+        }
+
+        if(group_size < group_capacity) {
+            assign(group_kvs[group_size], kv);
+            group_size++;
+            std::push_heap(group_kvs, group_kvs + group_size, is_greater);
+            return true;
+        }
+
+        // group_kvs[0] is the smallest KV of the group
+        if(!is_greater(*kv, group_kvs[0])) {
+            return false;
+        }
+
+        std::pop_heap(group_kvs, group_kvs + group_size, is_greater);
+        assign(group_kvs[group_size - 1], kv);
+        std::push_heap(group_kvs, group_kvs + group_size, is_greater);
+        return true;
+    }
+
+    [[nodiscard]] size_t num_groups() const {
+        return group_sizes.size();
+    }
+
+    [[nodiscard]] uint64_t get_group_key(size_t group_index) const {
+        return group_keys[group_index];
+    }
+
+    [[nodiscard]] uint32_t get_group_size(size_t group_index) const {
+        return group_sizes[group_index];
+    }
+
+    // in heap order, unless `sort()` has been called
+    KV* get_group_kvs(size_t group_index) {
+        return &arena[group_index * group_capacity];
+    }
+
+    // returns false when there is no group for `distinct_key`
+    bool find_group(uint64_t distinct_key, size_t& group_index) const {
+        const auto group_it = group_indices.find(distinct_key);
+        if(group_it == group_indices.end()) {
+            return false;
+        }
+
+        group_index = group_it->second;
+        return true;
+    }
+
+    // orders the KVs of every group from the greatest down, after which no more KVs must be added
+    void sort() {
+        for(size_t i = 0; i < group_sizes.size(); i++) {
+            KV* group_kvs = get_group_kvs(i);
+            std::sort(group_kvs, group_kvs + group_sizes[i], is_greater);
+        }
     }
 };
 
@@ -105,19 +312,32 @@ struct Topster {
     KV *data;
     KV** kvs;
 
-    std::unordered_map<uint64_t, KV*> kv_map;
+    topster_key_map_t kv_map;
+
+    // KVs added with `add_buffered()` that are yet to be merged into the heap
+    std::vector<KV> buffer;
 
-    spp::sparse_hash_map<uint64_t, Topster*> group_kv_map;
+    // for `distinct`: the top KVs of every group
+    group_topster_t groups;
     size_t distinct;
 
+    // with a `search_after` cursor, only the KVs that sort after it are kept
+    bool has_search_after = false;
+    KV search_after;
+
+    // `data`, `kvs` and the slots of `kv_map` are taken off this arena when there is one
+    search_arena_t* const arena;
+
     explicit Topster(size_t capacity): Topster(capacity, 0) {
     }
 
-    explicit Topster(size_t capacity, size_t distinct): MAX_SIZE(capacity), size(0), distinct(distinct) {
+    explicit Topster(size_t capacity, size_t distinct, search_arena_t* arena = nullptr):
+            MAX_SIZE(capacity), size(0), kv_map(capacity, arena), groups(distinct), distinct(distinct),
+            arena(arena) {
         // we allocate data first to get a memory block whose indices are then assigned to `kvs`
         // we use separate **kvs for easier pointer swaps
-        data = new KV[capacity];
-        kvs = new KV*[capacity];
+        data = (arena == nullptr) ? new KV[capacity] : arena->allocate_array<KV>(capacity);
+        kvs = (arena == nullptr) ? new KV*[capacity] : arena->allocate_array<KV*>(capacity);
 
         for(size_t i=0; i<capacity; i++) {
             data[i].field_id = 0;
@@ -132,16 +352,13 @@ struct Topster {
     }
 
     ~Topster() {
-        delete[] data;
-        delete[] kvs;
-        for(auto& kv: group_kv_map) {
-            delete kv.second;
+        if(arena == nullptr) {
+            delete[] data;
+            delete[] kvs;
         }
 
         data = nullptr;
         kvs = nullptr;
-
-        group_kv_map.clear();
     }
 
     static inline void swapMe(KV** a, KV** b) {
@@ -155,10 +372,9 @@ struct Topster {
     }
 
     bool add(KV* kv) {
-        /*LOG(INFO) << "kv_map size: " << kv_map.size() << " -- kvs[0]: " << kvs[0]->scores[kvs[0]->match_score_index];
-        for(auto& mkv: kv_map) {
-            LOG(INFO) << "kv key: " << mkv.first << " => " << mkv.second->scores[mkv.second->match_score_index];
-        }*/
+        if(has_search_after && !is_smaller(kv, &search_after)) {
+            return false;
+        }
 
         bool less_than_min_heap = (size >= MAX_SIZE) && is_smaller(kv, kvs[0]);
         size_t heap_op_index = 0;
@@ -172,22 +388,14 @@ struct Topster {
 
         if(distinct) {
             // Grouping cannot be a streaming operation, so aggregate the KVs associated with every group.
-            auto kvs_it = group_kv_map.find(kv->distinct_key);
-            if(kvs_it != group_kv_map.end()) {
-                kvs_it->second->add(kv);
-            } else {
-                Topster* g_topster = new Topster(distinct, 0);
-                g_topster->add(kv);
-                group_kv_map.insert({kv->distinct_key, g_topster});
-            }
-            
+            groups.add(kv);
             return true;
 
         } else { // not distinct
             //LOG(INFO) << "Searching for key: " << kv->key;
 
-            const auto& found_it = kv_map.find(kv->key);
-            bool is_duplicate_key = (found_it != kv_map.end());
+            KV* existing_kv = kv_map.find(kv->key);
+            bool is_duplicate_key = (existing_kv != nullptr);
 
             /*
                is_duplicate_key: SIFT_DOWN regardless of `size`.
@@ -198,7 +406,6 @@ struct Topster {
 
             if(is_duplicate_key) {
                 // Need to check if kv is greater than existing duplicate kv.
-                KV* existing_kv = found_it->second;
                 //LOG(INFO) << "existing_kv: " << existing_kv->key << " -> " << existing_kv->match_score;
 
                 bool smaller_than_existing = is_smaller(kv, existing_kv);
@@ -238,21 +445,7 @@ struct Topster {
         // sift up/down to maintain heap property
 
         if(SIFT_DOWN) {
-            while ((2 * heap_op_index + 1) < size) {
-                uint32_t next = (2 * heap_op_index + 1);  // left child
-                if (next+1 < size && is_greater(kvs[next], kvs[next + 1])) {
-                    // for min heap we compare with the minimum of children
-                    next++;  // right child (2n + 2)
-                }
-
-                if (is_greater(kvs[heap_op_index], kvs[next])) {
-                    swapMe(&kvs[heap_op_index], &kvs[next]);
-                } else {
-                    break;
-                }
-
-                heap_op_index = next;
-            }
+            sift_down(heap_op_index);
         } else {
             // SIFT UP
             while(heap_op_index > 0) {
@@ -269,6 +462,130 @@ struct Topster {
         return true;
     }
 
+    void sift_down(size_t heap_op_index) {
+        while ((2 * heap_op_index + 1) < size) {
+            uint32_t next = (2 * heap_op_index + 1);  // left child
+            if (next+1 < size && is_greater(kvs[next], kvs[next + 1])) {
+                // for min heap we compare with the minimum of children
+                next++;  // right child (2n + 2)
+            }
+
+            if (is_greater(kvs[heap_op_index], kvs[next])) {
+                swapMe(&kvs[heap_op_index], &kvs[next]);
+            } else {
+                break;
+            }
+
+            heap_op_index = next;
+        }
+    }
+
+    // Only the scores and key of `kv` matter: they are those of the last hit of the previous page. Does nothing
+    // when `kv` is null, so that the cursor of a topster can be handed down as is.
+    void set_search_after(const KV* kv) {
+        if(kv == nullptr) {
+            return ;
+        }
+
+        has_search_after = true;
+        search_after.key = kv->key;
+        search_after.scores[0] = kv->scores[0];
+        search_after.scores[1] = kv->scores[1];
+        search_after.scores[2] = kv->scores[2];
+    }
+
+    [[nodiscard]] const KV* get_search_after() const {
+        return has_search_after ? &search_after : nullptr;
+    }
+
+    // Smallest KV held once the topster is full: a KV that is not greater than it can't get in, so callers can
+    // skip building such KVs. Null while there is still room (and always for `distinct`, which keeps every group).
+    [[nodiscard]] const KV* get_threshold() const {
+        return (!distinct && MAX_SIZE != 0 && size >= MAX_SIZE) ? kvs[0] : nullptr;
+    }
+
+    // For adding many KVs when not `distinct`: instead of keeping up the heap on every add, KVs are appended to
+    // a buffer that is merged with the heap once it holds MAX_SIZE KVs, by picking the top MAX_SIZE of both with
+    // `std::nth_element()`. The threshold only moves at these merges. `flush()` merges what is left.
+    bool add_buffered(const KV* kv) {
+        if(has_search_after && !is_smaller(kv, &search_after)) {
+            return false;
+        }
+
+        const KV* threshold = get_threshold();
+        if(threshold != nullptr && is_smaller(kv, threshold)) {
+            return false;
+        }
+
+        buffer.emplace_back(kv->field_id, kv->query_index, kv->token_bits, kv->key, kv->distinct_key,
+                            kv->match_score_index, kv->scores);
+
+        if(buffer.size() >= MAX_SIZE) {
+            flush();
+        }
+
+        return true;
+    }
+
+    void flush() {
+        if(buffer.empty()) {
+            return ;
+        }
+
+        std::vector<KV*> candidates;
+        candidates.reserve(size + buffer.size());
+        kv_map.clear();
+
+        // of the KVs sharing a key, only the greatest is a candidate
+        for(size_t i = 0; i < size + buffer.size(); i++) {
+            KV* candidate = (i < size) ? kvs[i] : &buffer[i - size];
+            KV* existing = kv_map.find(candidate->key);
+
+            if(existing == nullptr || is_greater(candidate, existing)) {
+                kv_map.emplace(candidate->key, candidate);
+            }
+        }
+
+        for(size_t i = 0; i < size + buffer.size(); i++) {
+            KV* candidate = (i < size) ? kvs[i] : &buffer[i - size];
+            if(kv_map.find(candidate->key) == candidate) {
+                candidates.push_back(candidate);
+            }
+        }
+
+        if(candidates.size() > MAX_SIZE) {
+            std::nth_element(candidates.begin(), candidates.begin() + MAX_SIZE, candidates.end(), is_greater);
+            candidates.resize(MAX_SIZE);
+        }
+
+        // the candidates point into both `data` and `buffer`, so they are moved out before `data` is overwritten
+        std::vector<KV> top_kvs;
+        top_kvs.reserve(candidates.size());
+        for(KV* candidate: candidates) {
+            top_kvs.emplace_back(std::move(*candidate));
+        }
+
+        buffer.clear();
+        kv_map.clear();
+        size = top_kvs.size();
+
+        for(size_t i = 0; i < size; i++) {
+            data[i] = std::move(top_kvs[i]);
+            data[i].array_index = i;
+            kvs[i] = &data[i];
+            kv_map.emplace(data[i].key, &data[i]);
+        }
+
+        for(size_t i = size; i < MAX_SIZE; i++) {
+            data[i].array_index = i;
+            kvs[i] = &data[i];
+        }
+
+        for(size_t i = size / 2; i > 0; i--) {
+            sift_down(i - 1);
+        }
+    }
+
     static bool is_greater(const struct KV* i, const struct KV* j) {
         return std::tie(i->scores[0], i->scores[1], i->scores[2], i->key) >
                std::tie(j->scores[0], j->scores[1], j->scores[2], j->key);
@@ -286,13 +603,19 @@ struct Topster {
 
     // topster must be sorted before iterated upon to remove dead array entries
     void sort() {
+        flush();
+
         if(!distinct) {
             std::stable_sort(kvs, kvs + size, is_greater);
+        } else {
+            groups.sort();
         }
     }
 
     void clear(){
         size = 0;
+        buffer.clear();
+        kv_map.clear();
     }
 
     uint64_t getKeyAt(uint32_t index) {
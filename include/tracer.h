@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "mpsc_ring.h"
+#include "thread_local_vars.h"
+
+/*
+    Sampled tracing of requests through raft, the batched indexer, searches and the store, exported in the OTLP/HTTP
+    JSON encoding.
+
+    A request continues the trace of a sampled W3C `traceparent` header, or starts a trace of its own with a
+    probability of `sample_ratio`. The request carries its context (to the followers too, along with the log entry),
+    and the span open on a thread is pointed to by the `active_trace` thread local, under which spans nest. A thread
+    buffers the spans that end on it until its outermost span ends, and then pushes them into a lock-free ring that
+    the exporter thread takes them off, so that a request never waits on the network. Spans that find the ring full
+    are dropped and counted. Unless the request on a thread is sampled, a span costs a branch.
+*/
+
+struct trace_context_t {
+    uint64_t trace_id_high = 0;
+    uint64_t trace_id_low = 0;
+    uint64_t span_id = 0;
+    uint64_t parent_span_id = 0;
+    bool sampled = false;
+
+    bool is_valid() const {
+        return (trace_id_high != 0 || trace_id_low != 0) && span_id != 0;
+    }
+
+    // `00-<32 hex digits of trace id>-<16 hex digits of parent span id>-<2 hex digits of flags>`
+    static bool parse_traceparent(const std::string& traceparent, trace_context_t& context);
+
+    std::string to_traceparent() const;
+};
+
+struct span_record_t {
+    uint64_t trace_id_high = 0;
+    uint64_t trace_id_low = 0;
+    uint64_t span_id = 0;
+    uint64_t parent_span_id = 0;    // 0 for the root of a trace
+    std::string name;
+    uint64_t start_ns = 0;          // since the epoch
+    uint64_t end_ns = 0;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    bool is_server = false;         // the span of a request that this node received
+};
+
+class Tracer {
+private:
+    mpsc_ring_t<span_record_t> spans;
+
+    std::atomic<bool> enabled{false};
+    std::atomic<float> sample_ratio{0};
+
+    // posts an OTLP JSON body to the collector, returning false on failure
+    std::function<bool(const std::string&)> export_fn;
+
+    std::thread exporter;
+    std::atomic<bool> quit{false};
+
+    std::atomic<uint64_t> num_dropped{0};
+    std::atomic<uint64_t> num_exported{0};
+    std::atomic<uint64_t> num_export_failures{0};
+
+    void run_exporter();
+
+public:
+    static constexpr const char* TRACEPARENT_HEADER = "traceparent";
+
+    static constexpr size_t CAPACITY = 8192;
+    static constexpr uint64_t EXPORT_INTERVAL_MS = 1000;
+    static constexpr size_t MAX_EXPORT_BATCH = 512;
+
+    // a thread records at most this many spans of a trace between the start and the end of its outermost span,
+    // so that e.g. the store reads of a large import do not flood the trace
+    static constexpr size_t MAX_THREAD_SPANS = 256;
+
+    Tracer(): spans(CAPACITY) {}
+
+    ~Tracer() {
+        dispose();
+    }
+
+    static Tracer& get_instance() {
+        static Tracer instance;
+        return instance;
+    }
+
+    Tracer(Tracer const&) = delete;
+    void operator=(Tracer const&) = delete;
+
+    // starts the exporter, which hands batches of spans to `export_fn`
+    void init(float sample_ratio, const std::function<bool(const std::string&)>& export_fn);
+
+    // exports the spans left and stops the exporter
+    void dispose();
+
+    bool is_enabled() const {
+        return enabled;
+    }
+
+    // context of a request on this node: a child of the `traceparent` header when it is valid, sampled only when
+    // the header is, and otherwise the root of a new trace that is sampled with a probability of `sample_ratio`
+    trace_context_t start_trace(const std::string& traceparent) const;
+
+    // for a span that does not start and end in the same scope: does not block, and drops the span when the ring
+    // is full
+    void record(span_record_t&& span);
+
+    // takes up to `max_spans` spans off the ring, from the exporter thread (or a test, when it has not been started)
+    size_t drain(std::vector<span_record_t>& records, size_t max_spans);
+
+    void export_spans();
+
+    static std::string to_otlp_json(const std::vector<span_record_t>& records);
+
+    static uint64_t now_ns();
+
+    // random and non-zero
+    static uint64_t new_id();
+
+    uint64_t get_num_dropped() const {
+        return num_dropped;
+    }
+
+    uint64_t get_num_exported() const {
+        return num_exported;
+    }
+
+    uint64_t get_num_export_failures() const {
+        return num_export_failures;
+    }
+};
+
+// Span from its construction to its destruction, active on this thread in between
+class trace_span_t {
+private:
+    const trace_context_t* const prev_active_trace;
+    std::unique_ptr<span_record_t> record;
+    trace_context_t context;
+
+    void start(const char* name, const trace_context_t& parent);
+
+    void end();
+
+public:
+    // a child of the span active on this thread, if any
+    explicit trace_span_t(const char* name): prev_active_trace(active_trace) {
+        if(active_trace != nullptr) {
+            start(name, *active_trace);
+        }
+    }
+
+    // a child of `parent`, e.g. the context of a request, if it is sampled
+    trace_span_t(const char* name, const trace_context_t& parent): prev_active_trace(active_trace) {
+        if(parent.sampled) {
+            start(name, parent);
+        }
+    }
+
+    ~trace_span_t() {
+        if(record != nullptr) {
+            end();
+        }
+    }
+
+    trace_span_t(const trace_span_t&) = delete;
+    trace_span_t& operator=(const trace_span_t&) = delete;
+
+    bool is_recording() const {
+        return record != nullptr;
+    }
+
+    void set_attribute(const char* key, const std::string& value) {
+        if(record != nullptr) {
+            record->attributes.emplace_back(key, value);
+        }
+    }
+
+    void set_attribute(const char* key, int64_t value) {
+        if(record != nullptr) {
+            record->attributes.emplace_back(key, std::to_string(value));
+        }
+    }
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <random>
+#include <functional>
+#include <unordered_map>
+
+enum class vector_distance_type_t {
+    cosine,
+    ip
+};
+
+// nearest neighbours asked for by the `vector_query` of a search
+struct vector_query_t {
+    std::string field_name;
+    std::vector<float> values;
+    size_t k = 0;
+
+    // weight of the vector ranks against the text ranks when a text query is given too
+    float alpha = 0.3;
+};
+
+/*
+ *  Approximate nearest neighbour index of the vectors of a field, as a hierarchical navigable small world (HNSW)
+ *  graph: every vector is a node that is linked to its closest nodes on level 0 and on each of a random number of
+ *  levels above, which hold exponentially fewer nodes. A lookup descends greedily from the entry node on the top
+ *  level down to level 1, and then runs a best-first search on level 0 that keeps the `ef` closest nodes found.
+ *
+ *  The distance of two vectors is `1 - their dot product`, over unit vectors for cosine. An int8 quantized index
+ *  holds a vector as one byte per dimension along with a scale, a quarter of its size as floats, at the cost of
+ *  approximate distances.
+ *
+ *  A removed vector stays in the graph to route lookups through until half of the nodes are removed, at which
+ *  point the graph is rebuilt off the vectors left.
+ */
+class vector_index_t {
+private:
+    struct node_t {
+        uint32_t seq_id;
+        bool deleted;
+
+        // linked nodes on each level of the node, level 0 first
+        std::vector<std::vector<uint32_t>> links;
+    };
+
+    // (distance, node)
+    typedef std::pair<float, uint32_t> dist_node_t;
+
+    const size_t num_dim;
+    const vector_distance_type_t distance_type;
+    const bool quantize;
+
+    std::vector<node_t> nodes;
+
+    // `num_dim` values per node, or codes and a scale per node when quantized
+    std::vector<float> values;
+    std::vector<int8_t> codes;
+    std::vector<float> scales;
+
+    std::unordered_map<uint32_t, uint32_t> seq_id_nodes;
+
+    uint32_t entry_node = 0;
+    int max_level = -1;
+    size_t num_deleted = 0;
+
+    std::mt19937 level_gen;
+
+    float node_distance(const float* query, uint32_t node) const;
+
+    void get_values(uint32_t node, float* out) const;
+
+    // normalized for cosine
+    void prepare(const float* raw_values, std::vector<float>& out) const;
+
+    uint32_t descend(const float* query, int to_level) const;
+
+    // closest nodes to `query` found on `level` from `entry`, closest first: only the nodes that are not deleted
+    // and whose seq_id passes `is_allowed` (when given) are kept when `is_lookup` is set, and every node otherwise
+    void search_level(const float* query, uint32_t entry, size_t ef, int level, bool is_lookup,
+                      const std::function<bool(uint32_t)>* is_allowed, std::vector<dist_node_t>& found) const;
+
+    // keeps up to `max_links` of the candidates (sorted by distance) that are closer to the node than to any
+    // candidate kept before them, so that the links of a node spread out in all directions
+    void select_links(const std::vector<dist_node_t>& candidates, size_t max_links,
+                      std::vector<uint32_t>& links) const;
+
+    void add_node(uint32_t seq_id, const float* node_values);
+
+    void rebuild();
+
+public:
+    // links of a node on each level above 0, and twice that on level 0
+    static constexpr size_t M = 16;
+    static constexpr size_t EF_CONSTRUCTION = 128;
+    static constexpr size_t EF_SEARCH = 64;
+
+    // a graph of fewer nodes is not rebuilt on removals
+    static constexpr size_t REBUILD_MIN_NODES = 1024;
+
+    vector_index_t(size_t num_dim, vector_distance_type_t distance_type, bool quantize = false);
+
+    // `raw_values` holds `num_dim` floats, which replace the vector held by `seq_id`, if any
+    void insert(uint32_t seq_id, const float* raw_values);
+
+    void remove(uint32_t seq_id);
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] size_t get_num_dim() const;
+
+    // heap memory held by the vectors and the graph
+    [[nodiscard]] size_t memory_bytes() const;
+
+    // up to `k` (distance, seq_id) of the vectors that are closest to `query`, closest first, among the seq_ids for
+    // which `is_allowed` (when it is set) returns true
+    void search(const float* query, size_t k, const std::function<bool(uint32_t)>& is_allowed,
+                std::vector<std::pair<float, uint32_t>>& results) const;
+
+    // (distance, seq_id) of every one of the `seq_ids` that has a vector, in the order given
+    void distances(const float* query, const uint32_t* seq_ids, size_t num_seq_ids,
+                   std::vector<std::pair<float, uint32_t>>& results) const;
+
+    // false when `seq_id` has no vector
+    bool distance(const float* query, uint32_t seq_id, float& out) const;
+
+    static float dot_product(const float* a, const float* b, size_t n);
+
+    static float dot_product_int8(const float* a, const int8_t* b, size_t n);
+
+    static float dot_product_scalar(const float* a, const float* b, size_t n);
+
+    static float dot_product_int8_scalar(const float* a, const int8_t* b, size_t n);
+
+    static const char* get_distance_type_name(vector_distance_type_t distance_type);
+
+    static bool parse_distance_type(const std::string& name, vector_distance_type_t& distance_type);
+};
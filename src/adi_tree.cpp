@@ -2,7 +2,9 @@
 #include <vector>
 #include "adi_tree.h"
 #include "logger.h"
+#include "memory_usage.h"
 #include <set>
+#include <algorithm>
 
 //std::set<adi_node_t*> nodes;
 
@@ -114,6 +116,7 @@ void adi_tree_t::index(const uint32_t id, const std::string& key) {
 
     add_node(root, key, 0);
     id_keys.emplace(id, key);
+    ranks_fresh = false;
 }
 
 bool adi_tree_t::rank_aggregate(adi_node_t* node, const std::string& key, const size_t key_index, size_t& rank) {
@@ -138,6 +141,10 @@ bool adi_tree_t::rank_aggregate(adi_node_t* node, const std::string& key, const
 }
 
 size_t adi_tree_t::rank(uint32_t id) {
+    if(ranks_fresh.load(std::memory_order_acquire)) {
+        return (id < ranks.size() && ranks[id] != 0) ? ranks[id] : NOT_FOUND;
+    }
+
     const auto& id_keys_it = id_keys.find(id);
 
     if(id_keys_it == id_keys.end()) {
@@ -154,11 +161,13 @@ size_t adi_tree_t::rank(uint32_t id) {
 adi_node_t* adi_tree_t::get_node(adi_node_t* node, const std::string& key, const size_t key_index,
                                  std::vector<adi_node_t*>& path) {
     if(key_index == key.size()) {
-        // still push the null node
-        if(node->num_children >= 1 && node->chars[0] == '\0') {
-            path.push_back(node);
-            path.push_back(node->children[0]);
-            return node;
+        // still push the null node, which comes first only when no child char is negative
+        for(size_t i = 0; i < node->num_children; i++) {
+            if(node->chars[i] == '\0') {
+                path.push_back(node);
+                path.push_back(node->children[i]);
+                return node;
+            }
         }
 
         return nullptr;
@@ -259,6 +268,87 @@ void adi_tree_t::remove(uint32_t id) {
     }
 
     id_keys.erase(id);
+    ranks_fresh = false;
+}
+
+bool adi_tree_t::key_less(const std::string& a, const std::string& b) {
+    const size_t common_len = std::min(a.size(), b.size());
+
+    for(size_t i = 0; i < common_len; i++) {
+        if(a[i] != b[i]) {
+            return a[i] < b[i];
+        }
+    }
+
+    if(a.size() == b.size()) {
+        return false;
+    }
+
+    return (a.size() < b.size()) ? ('\0' < b[common_len]) : (a[common_len] < '\0');
+}
+
+void adi_tree_t::materialize_ranks(size_t num_lookups) {
+    if(ranks_fresh.load(std::memory_order_acquire) || num_lookups * RANKS_REBUILD_RATIO < id_keys.size()) {
+        return ;
+    }
+
+    std::unique_lock lock(ranks_mutex);
+
+    if(ranks_fresh.load(std::memory_order_acquire)) {
+        return ;
+    }
+
+    std::vector<std::pair<const std::string*, uint32_t>> sorted_keys;
+    sorted_keys.reserve(id_keys.size());
+    uint32_t max_id = 0;
+
+    for(const auto& id_key: id_keys) {
+        sorted_keys.emplace_back(&id_key.second, id_key.first);
+        max_id = std::max(max_id, id_key.first);
+    }
+
+    std::sort(sorted_keys.begin(), sorted_keys.end(), [](const auto& a, const auto& b) {
+        return key_less(*a.first, *b.first);
+    });
+
+    ranks.assign(id_keys.empty() ? 0 : size_t(max_id) + 1, 0);
+
+    // Mirrors `rank_aggregate()`: every id of a smaller key counts, except that a key which is a prefix of the
+    // ranked key counts once however many ids share it. The keys that precede a key in sorted order and are its
+    // prefixes form a chain, kept on a stack along with their number of ids.
+    std::vector<std::pair<const std::string*, size_t>> prefixes;
+    size_t num_prefix_ids = 0;
+    size_t num_ids_before = 0;
+    size_t i = 0;
+
+    while(i < sorted_keys.size()) {
+        const std::string& key = *sorted_keys[i].first;
+        size_t j = i;
+        while(j < sorted_keys.size() && *sorted_keys[j].first == key) {
+            j++;
+        }
+
+        while(!prefixes.empty() && key.compare(0, prefixes.back().first->size(), *prefixes.back().first) != 0) {
+            num_prefix_ids -= prefixes.back().second;
+            prefixes.pop_back();
+        }
+
+        const uint32_t key_rank = 1 + (num_ids_before - num_prefix_ids) + prefixes.size();
+        for(size_t k = i; k < j; k++) {
+            ranks[sorted_keys[k].second] = key_rank;
+        }
+
+        prefixes.emplace_back(&key, j - i);
+        num_prefix_ids += (j - i);
+        num_ids_before += (j - i);
+        i = j;
+    }
+
+    ranks_fresh.store(true, std::memory_order_release);
+}
+
+bool adi_tree_t::has_materialized_ranks() const {
+    return ranks_fresh.load(std::memory_order_acquire);
 }
 
 adi_tree_t::~adi_tree_t() {
@@ -285,3 +375,30 @@ adi_tree_t::~adi_tree_t() {
 const adi_node_t* adi_tree_t::get_root() {
     return root;
 }
+
+static size_t node_memory_bytes(const adi_node_t* node) {
+    if(node == nullptr) {
+        return 0;
+    }
+
+    size_t bytes = sizeof(adi_node_t) + node->num_children * (sizeof(char) + sizeof(adi_node_t*));
+
+    for(size_t i = 0; i < node->num_children; i++) {
+        bytes += node_memory_bytes(node->children[i]);
+    }
+
+    return bytes;
+}
+
+size_t adi_tree_t::memory_bytes() {
+    size_t bytes = sizeof(adi_tree_t) + memory_usage::sparse_map_bytes(id_keys) + node_memory_bytes(root);
+
+    for(const auto& id_key: id_keys) {
+        bytes += memory_usage::string_bytes(id_key.second);
+    }
+
+    std::unique_lock lock(ranks_mutex);
+    bytes += memory_usage::vector_bytes(ranks);
+
+    return bytes;
+}
@@ -1,5 +1,7 @@
 #include "app_metrics.h"
 #include "core_api.h"
+#include <algorithm>
+#include <map>
 
 void AppMetrics::increment_write_metrics(uint64_t route_hash, uint64_t duration) {
     if(is_doc_import_route(route_hash)) {
@@ -18,6 +20,28 @@ void AppMetrics::increment_write_metrics(uint64_t route_hash, uint64_t duration)
     }
 }
 
+AppMetrics::latency_shard_t* AppMetrics::get_latency_shard() {
+    thread_local std::shared_ptr<latency_shard_t> shard;
+
+    if(shard == nullptr) {
+        shard = std::make_shared<latency_shard_t>();
+        std::unique_lock lock(latency_shards_mutex);
+        latency_shards.push_back(shard);
+    }
+
+    return shard.get();
+}
+
+void AppMetrics::record_latency(const std::string& identifier, uint64_t duration_us) {
+    latency_shard_t* shard = get_latency_shard();
+    std::unique_lock lock(shard->mutex);
+    shard->histograms[identifier].record(duration_us);
+
+    latency_totals_t& totals = shard->totals[identifier];
+    totals.count++;
+    totals.sum_us += duration_us;
+}
+
 void AppMetrics::get(const std::string& rps_key, const std::string& latency_key, nlohmann::json& result) const {
     std::shared_lock lock(mutex);
 
@@ -35,6 +59,8 @@ void AppMetrics::get(const std::string& rps_key, const std::string& latency_key,
     auto DOC_DELETE_RPS_KEY = DOC_DELETE_LABEL + "_" + rps_key;
     auto DOC_DELETE_LATENCY_KEY = DOC_DELETE_LABEL + "_" + latency_key;
 
+    auto SEARCH_SHED_RPS_KEY = SEARCH_SHED_LABEL + "_" + rps_key;
+
     result[rps_key] = nlohmann::json::object();
     for(const auto& kv: *counts) {
         if(kv.first == SEARCH_LABEL) {
@@ -53,6 +79,11 @@ void AppMetrics::get(const std::string& rps_key, const std::string& latency_key,
             result[DOC_DELETE_RPS_KEY] = double(kv.second) / (METRICS_REFRESH_INTERVAL_MS / 1000);
         }
 
+        else if(kv.first == SEARCH_SHED_LABEL) {
+            // shed searches are not served, so they are left out of the total
+            result[SEARCH_SHED_RPS_KEY] = double(kv.second) / (METRICS_REFRESH_INTERVAL_MS / 1000);
+        }
+
         else {
             result[rps_key][kv.first] = (double(kv.second) / (METRICS_REFRESH_INTERVAL_MS / 1000));
             total_counts += kv.second;
@@ -88,8 +119,20 @@ void AppMetrics::get(const std::string& rps_key, const std::string& latency_key,
         }
     }
 
+    const std::string percentiles_key = latency_key + "_percentiles";
+    result[percentiles_key] = nlohmann::json::object();
+
+    for(const auto& kv: *latency_histograms) {
+        nlohmann::json& percentiles = result[percentiles_key][kv.first];
+        percentiles["count"] = kv.second.num_values;
+        percentiles["p50"] = kv.second.value_at_percentile(50) / 1000.0;
+        percentiles["p95"] = kv.second.value_at_percentile(95) / 1000.0;
+        percentiles["p99"] = kv.second.value_at_percentile(99) / 1000.0;
+        percentiles["p999"] = kv.second.value_at_percentile(99.9) / 1000.0;
+    }
+
     std::vector<std::string> keys_to_check = {
-        SEARCH_RPS_KEY, IMPORT_RPS_KEY, DOC_WRITE_RPS_KEY, DOC_DELETE_RPS_KEY,
+        SEARCH_RPS_KEY, IMPORT_RPS_KEY, DOC_WRITE_RPS_KEY, DOC_DELETE_RPS_KEY, SEARCH_SHED_RPS_KEY,
         SEARCH_LATENCY_KEY, IMPORT_LATENCY_KEY, DOC_WRITE_LATENCY_KEY, DOC_DELETE_LATENCY_KEY
     };
 
@@ -101,8 +144,46 @@ void AppMetrics::get(const std::string& rps_key, const std::string& latency_key,
 }
 
 void AppMetrics::window_reset() {
+    auto window_latency_histograms = new spp::sparse_hash_map<std::string, latency_histogram_t>();
+
+    {
+        std::unique_lock shards_lock(latency_shards_mutex);
+
+        for(auto& shard: latency_shards) {
+            spp::sparse_hash_map<std::string, latency_histogram_t> shard_histograms;
+
+            {
+                std::unique_lock shard_lock(shard->mutex);
+                shard_histograms.swap(shard->histograms);
+            }
+
+            for(const auto& kv: shard_histograms) {
+                (*window_latency_histograms)[kv.first].merge(kv.second);
+            }
+        }
+
+        // the shards of threads that have exited are held only here
+        for(const auto& shard: latency_shards) {
+            if(shard.use_count() == 1) {
+                for(const auto& kv: shard->totals) {
+                    latency_totals_t& totals = retired_latency_totals[kv.first];
+                    totals.count += kv.second.count;
+                    totals.sum_us += kv.second.sum_us;
+                }
+            }
+        }
+
+        latency_shards.erase(std::remove_if(latency_shards.begin(), latency_shards.end(),
+                                            [](const std::shared_ptr<latency_shard_t>& shard) {
+                                                return shard.use_count() == 1;
+                                            }), latency_shards.end());
+    }
+
     std::unique_lock lock(mutex);
 
+    delete latency_histograms;
+    latency_histograms = window_latency_histograms;
+
     delete counts;
     counts = current_counts;
     current_counts = new spp::sparse_hash_map<std::string, uint64_t>();
@@ -112,6 +193,75 @@ void AppMetrics::window_reset() {
     current_durations = new spp::sparse_hash_map<std::string, uint64_t>();
 }
 
+void AppMetrics::get_openmetrics(openmetrics_writer_t& writer) const {
+    std::map<std::string, latency_totals_t> totals;
+
+    {
+        std::unique_lock shards_lock(latency_shards_mutex);
+
+        for(const auto& kv: retired_latency_totals) {
+            totals[kv.first] = kv.second;
+        }
+
+        for(const auto& shard: latency_shards) {
+            std::unique_lock shard_lock(shard->mutex);
+            for(const auto& kv: shard->totals) {
+                latency_totals_t& identifier_totals = totals[kv.first];
+                identifier_totals.count += kv.second.count;
+                identifier_totals.sum_us += kv.second.sum_us;
+            }
+        }
+    }
+
+    // identifiers are either `<method> <path>` of a route or `search <collection>`, besides the search label
+    const std::string collection_search_prefix = SEARCH_LABEL + " ";
+
+    std::vector<std::pair<openmetrics_writer_t::labels_t, const std::string*>> route_labels, collection_labels;
+
+    for(const auto& kv: totals) {
+        if(kv.first.rfind(collection_search_prefix, 0) == 0) {
+            collection_labels.push_back({{{"collection", kv.first.substr(collection_search_prefix.size())}},
+                                         &kv.first});
+        } else if(kv.first != SEARCH_LABEL) {
+            const size_t method_end = kv.first.find(' ');
+            if(method_end != std::string::npos) {
+                route_labels.push_back({{{"method", kv.first.substr(0, method_end)},
+                                         {"path", kv.first.substr(method_end + 1)}}, &kv.first});
+            }
+        }
+    }
+
+    std::shared_lock lock(mutex);
+
+    auto write_summary = [&](const std::string& name, const std::string& help,
+                             const std::vector<std::pair<openmetrics_writer_t::labels_t, const std::string*>>& labels) {
+        writer.family(name, "summary", help);
+
+        for(const auto& labels_identifier: labels) {
+            const latency_totals_t& identifier_totals = totals.at(*labels_identifier.second);
+            const auto histogram_it = latency_histograms->find(*labels_identifier.second);
+
+            if(histogram_it != latency_histograms->end()) {
+                for(const char* quantile: {"0.5", "0.95", "0.99", "0.999"}) {
+                    openmetrics_writer_t::labels_t quantile_labels = labels_identifier.first;
+                    quantile_labels.emplace_back("quantile", quantile);
+                    writer.sample(name, quantile_labels,
+                                  histogram_it->second.value_at_percentile(std::stod(quantile) * 100) / 1e6);
+                }
+            }
+
+            writer.sample(name + "_sum", labels_identifier.first, identifier_totals.sum_us / 1e6);
+            writer.sample(name + "_count", labels_identifier.first, identifier_totals.count);
+        }
+    };
+
+    write_summary("typesense_http_request_duration_seconds",
+                  "Latency of the requests to a route, with quantiles over the last metrics window.", route_labels);
+    write_summary("typesense_search_duration_seconds",
+                  "Latency of the searches of a collection, with quantiles over the last metrics window.",
+                  collection_labels);
+}
+
 void AppMetrics::write_access_log(const uint64_t epoch_millis, const char* remote_ip, const std::string& path) {
     if(!access_log_path.empty()) {
         access_log << epoch_millis << "\t" << remote_ip << "\t" << path << "\n";
@@ -7,7 +7,7 @@ uint32_t* array_base::uncompress(uint32_t len) const {
     return out;
 }
 
-uint32_t array_base::getSizeInBytes() {
+uint32_t array_base::getSizeInBytes() const {
     return size_bytes;
 }
 
@@ -1,6 +1,12 @@
 #include "array_utils.h"
 #include <memory.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <sse2neon.h>
+#endif
+
 size_t ArrayUtils::and_scalar(const uint32_t *A, const size_t lenA,
                               const uint32_t *B, const size_t lenB, uint32_t **results) {
   if (lenA == 0 || lenB == 0) {
@@ -149,4 +155,155 @@ size_t ArrayUtils::exclude_scalar(const uint32_t *A, const size_t lenA,
   delete[] results;
 
   return res_index;
-}
\ No newline at end of file
+}
+static size_t and_positions_tail(const uint32_t *A, size_t indexA, const size_t lenA,
+                                 const uint32_t *B, size_t indexB, const size_t lenB,
+                                 uint32_t *posA, uint32_t *posB, size_t count) {
+  while(indexA < lenA && indexB < lenB) {
+    if(A[indexA] < B[indexB]) {
+      indexA++;
+    } else if(A[indexA] > B[indexB]) {
+      indexB++;
+    } else {
+      posA[count] = indexA++;
+      posB[count] = indexB++;
+      count++;
+    }
+  }
+
+  return count;
+}
+
+size_t ArrayUtils::and_positions_scalar(const uint32_t *A, const size_t lenA, const uint32_t *B, const size_t lenB,
+                                        uint32_t *posA, uint32_t *posB) {
+  return and_positions_tail(A, 0, lenA, B, 0, lenB, posA, posB, 0);
+}
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+// Compares a block of 4 elements of A against all 4 rotations of a block of B (Schlegel et al.)
+static size_t and_positions_sse(const uint32_t *A, const size_t lenA, const uint32_t *B, const size_t lenB,
+                                uint32_t *posA, uint32_t *posB) {
+  size_t indexA = 0, indexB = 0, count = 0;
+  const size_t stA = (lenA / 4) * 4;
+  const size_t stB = (lenB / 4) * 4;
+
+  while(indexA < stA && indexB < stB) {
+    const __m128i va = _mm_loadu_si128((const __m128i*)(A + indexA));
+    const __m128i vb = _mm_loadu_si128((const __m128i*)(B + indexB));
+
+    const __m128i cmp0 = _mm_cmpeq_epi32(va, vb);
+    const __m128i cmp1 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)));
+    const __m128i cmp2 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+    const __m128i cmp3 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)));
+    const __m128i cmp = _mm_or_si128(_mm_or_si128(cmp0, cmp1), _mm_or_si128(cmp2, cmp3));
+
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(cmp));
+
+    while(mask != 0) {
+      const int k = __builtin_ctz(mask);
+      mask &= (mask - 1);
+
+      // locate the matching element within the current window of B
+      size_t m = indexB;
+      while(B[m] != A[indexA + k]) {
+        m++;
+      }
+
+      posA[count] = indexA + k;
+      posB[count] = m;
+      count++;
+    }
+
+    const uint32_t maxA = A[indexA + 3];
+    const uint32_t maxB = B[indexB + 3];
+
+    if(maxA <= maxB) {
+      indexA += 4;
+    }
+
+    if(maxB <= maxA) {
+      indexB += 4;
+    }
+  }
+
+  return and_positions_tail(A, indexA, lenA, B, indexB, lenB, posA, posB, count);
+}
+
+#endif
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2")))
+static size_t and_positions_avx2(const uint32_t *A, const size_t lenA, const uint32_t *B, const size_t lenB,
+                                 uint32_t *posA, uint32_t *posB) {
+  size_t indexA = 0, indexB = 0, count = 0;
+  const size_t stA = (lenA / 8) * 8;
+  const size_t stB = (lenB / 8) * 8;
+
+  const __m256i rot1 = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+
+  while(indexA < stA && indexB < stB) {
+    const __m256i va = _mm256_loadu_si256((const __m256i*)(A + indexA));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(B + indexB));
+
+    __m256i cmp = _mm256_cmpeq_epi32(va, vb);
+    for(size_t r = 1; r < 8; r++) {
+      vb = _mm256_permutevar8x32_epi32(vb, rot1);
+      cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi32(va, vb));
+    }
+
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
+
+    while(mask != 0) {
+      const int k = __builtin_ctz(mask);
+      mask &= (mask - 1);
+
+      size_t m = indexB;
+      while(B[m] != A[indexA + k]) {
+        m++;
+      }
+
+      posA[count] = indexA + k;
+      posB[count] = m;
+      count++;
+    }
+
+    const uint32_t maxA = A[indexA + 7];
+    const uint32_t maxB = B[indexB + 7];
+
+    if(maxA <= maxB) {
+      indexA += 8;
+    }
+
+    if(maxB <= maxA) {
+      indexB += 8;
+    }
+  }
+
+  return and_positions_tail(A, indexA, lenA, B, indexB, lenB, posA, posB, count);
+}
+
+#endif
+
+typedef size_t (*and_positions_fn_t)(const uint32_t*, size_t, const uint32_t*, size_t, uint32_t*, uint32_t*);
+
+static and_positions_fn_t resolve_and_positions() {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) {
+    return and_positions_avx2;
+  }
+  return and_positions_sse;
+#elif defined(__aarch64__)
+  return and_positions_sse;
+#else
+  return ArrayUtils::and_positions_scalar;
+#endif
+}
+
+size_t ArrayUtils::and_positions(const uint32_t *A, const size_t lenA, const uint32_t *B, const size_t lenB,
+                                 uint32_t *posA, uint32_t *posB) {
+  static const and_positions_fn_t and_positions_fn = resolve_and_positions();
+  return and_positions_fn(A, lenA, B, lenB, posA, posB);
+}
@@ -19,6 +19,8 @@
 #include <list>
 #include <stdint.h>
 #include <posting.h>
+#include <stddef.h>
+#include "compact_list_arena.h"
 #include "art.h"
 #include "logger.h"
 
@@ -41,9 +43,10 @@
 
 enum recurse_progress { RECURSE, ABORT, ITERATE };
 
-static void art_fuzzy_recurse(unsigned char p, unsigned char c, const art_node *n, int depth, const unsigned char *term,
-                              const int term_len, const int* irow, const int* jrow, const int min_cost,
-                              const int max_cost, const bool prefix, std::vector<const art_node *> &results);
+template<class M>
+static void art_fuzzy_recurse(const M& matrix, unsigned char p, unsigned char c, const art_node *n, int depth,
+                              const typename M::row_t& parent_row, const int min_cost, const int max_cost,
+                              const bool prefix, std::vector<const art_node *> &results);
 
 void art_int_fuzzy_recurse(art_node *n, int depth, const unsigned char* int_str, int int_str_len,
                            NUM_COMPARATOR comparator, std::vector<const art_leaf *> &results);
@@ -56,17 +59,22 @@ bool compare_art_leaf_score(const art_leaf *a, const art_leaf *b) {
     return a->max_score > b->max_score;
 }
 
+// for a node, `max_score` is an upper bound of the frequencies of the leaves underneath it
 bool compare_art_node_frequency(const art_node *a, const art_node *b) {
-    uint32_t a_value = 0, b_value = 0;
+    int64_t a_value = 0, b_value = 0;
 
     if(IS_LEAF(a)) {
         art_leaf* al = (art_leaf *) LEAF_RAW(a);
         a_value = posting_t::num_ids(al->values);
+    } else {
+        a_value = a->max_score;
     }
 
     if(IS_LEAF(b)) {
         art_leaf* bl = (art_leaf *) LEAF_RAW(b);
         b_value = posting_t::num_ids(bl->values);
+    } else {
+        b_value = b->max_score;
     }
 
     return a_value > b_value;
@@ -93,40 +101,54 @@ bool compare_art_node_score(const art_node* a, const art_node* b) {
 }
 
 bool compare_art_node_frequency_pq(const art_node *a, const art_node *b) {
-    return !compare_art_node_frequency(a, b);
+    return compare_art_node_frequency(b, a);
 }
 
 bool compare_art_node_score_pq(const art_node* a, const art_node* b) {
-    return !compare_art_node_score(a, b);
+    return compare_art_node_score(b, a);
 }
 
 /**
  * Allocates a node of the given type,
  * initializes to zero and sets the type.
  */
-static art_node* alloc_node(uint8_t type) {
-    art_node* n;
+static size_t node_size(uint8_t type) {
     switch (type) {
         case NODE4:
-            n = (art_node *) calloc(1, sizeof(art_node4));
-            break;
+            return sizeof(art_node4);
         case NODE16:
-            n = (art_node *) calloc(1, sizeof(art_node16));
-            break;
+            return sizeof(art_node16);
         case NODE48:
-            n = (art_node *) calloc(1, sizeof(art_node48));
-            break;
+            return sizeof(art_node48);
         case NODE256:
-            n = (art_node *) calloc(1, sizeof(art_node256));
-            break;
+            return sizeof(art_node256);
         default:
             abort();
     }
+}
+
+static size_t leaf_size(uint32_t key_len) {
+    return offsetof(art_leaf, key) + key_len;
+}
+
+// Most nodes are NODE4 / NODE16 and most leaves hold short keys: they are packed into the slabs of the arena.
+static art_node* alloc_node(uint8_t type) {
+    const size_t num_bytes = node_size(type);
+    art_node* n = (art_node *) CompactListArena::get_instance().allocate(num_bytes);
+    memset(n, 0, num_bytes);
     n->type = type;
     n->max_score = 0;
     return n;
 }
 
+static void free_node(art_node* n) {
+    CompactListArena::get_instance().release(n, node_size(n->type));
+}
+
+static void free_leaf(art_leaf* l) {
+    CompactListArena::get_instance().release(l, leaf_size(l->key_len));
+}
+
 /**
  * Initializes an ART tree
  * @return 0 on success.
@@ -134,9 +156,58 @@ static art_node* alloc_node(uint8_t type) {
 int art_tree_init(art_tree *t) {
     t->root = NULL;
     t->size = 0;
+    t->version = 0;
     return 0;
 }
 
+static void node_stats(const art_node *n, art_tree_stats *stats) {
+    if (!n) return;
+
+    if (IS_LEAF(n)) {
+        const art_leaf *leaf = (const art_leaf *) LEAF_RAW(n);
+        stats->num_leaves++;
+        stats->leaf_bytes += leaf_size(leaf->key_len);
+        return;
+    }
+
+    stats->num_nodes++;
+    stats->node_bytes += node_size(n->type);
+
+    int i;
+    switch (n->type) {
+        case NODE4:
+            for (i=0;i<n->num_children;i++) {
+                node_stats(((const art_node4*)n)->children[i], stats);
+            }
+            break;
+
+        case NODE16:
+            for (i=0;i<n->num_children;i++) {
+                node_stats(((const art_node16*)n)->children[i], stats);
+            }
+            break;
+
+        case NODE48:
+            for (i=0;i<48;i++) {
+                node_stats(((const art_node48*)n)->children[i], stats);
+            }
+            break;
+
+        case NODE256:
+            for (i=0;i<256;i++) {
+                node_stats(((const art_node256*)n)->children[i], stats);
+            }
+            break;
+
+        default:
+            abort();
+    }
+}
+
+void art_tree_get_stats(const art_tree *t, art_tree_stats *stats) {
+    node_stats(t->root, stats);
+}
+
 // Recursively destroys the tree
 static void destroy_node(art_node *n) {
     // Break if null
@@ -146,7 +217,7 @@ static void destroy_node(art_node *n) {
     if (IS_LEAF(n)) {
         art_leaf *leaf = (art_leaf *) LEAF_RAW(n);
         posting_t::destroy_list(leaf->values);
-        free(leaf);
+        free_leaf(leaf);
         return;
     }
 
@@ -193,7 +264,7 @@ static void destroy_node(art_node *n) {
     }
 
     // Free ourself on the way up
-    free(n);
+    free_node(n);
 }
 
 /**
@@ -429,8 +500,52 @@ static void add_document_to_leaf(art_document *document, art_leaf *leaf) {
     }
 }
 
+static void add_documents_to_leaf(std::vector<art_document>& documents, size_t start, art_leaf *leaf) {
+    if(documents.size() - start <= 1) {
+        for(size_t i = start; i < documents.size(); i++) {
+            add_document_to_leaf(&documents[i], leaf);
+        }
+        return;
+    }
+
+    // sort by ID (a batch of updates need not be ordered) and keep only the last version of a repeated ID
+    std::vector<size_t> doc_indices;
+    for(size_t i = start; i < documents.size(); i++) {
+        doc_indices.push_back(i);
+    }
+
+    std::stable_sort(doc_indices.begin(), doc_indices.end(), [&documents](size_t a, size_t b) {
+        return documents[a].id < documents[b].id;
+    });
+
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> offset_index;
+    std::vector<uint32_t> offsets;
+    bool use_frequency_score = false;
+
+    for(size_t i = 0; i < doc_indices.size(); i++) {
+        const art_document& document = documents[doc_indices[i]];
+        if(i+1 < doc_indices.size() && documents[doc_indices[i+1]].id == document.id) {
+            continue;
+        }
+
+        ids.push_back(document.id);
+        offset_index.push_back(offsets.size());
+        offsets.insert(offsets.end(), document.offsets.begin(), document.offsets.end());
+
+        leaf->max_score = MAX(leaf->max_score, document.score);
+        use_frequency_score = use_frequency_score || (document.score == USE_FREQUENCY_SCORE);
+    }
+
+    posting_t::upsert_sorted(leaf->values, ids.size(), ids.data(), offset_index.data(), offsets.size(), offsets.data());
+
+    if(use_frequency_score) {
+        leaf->max_score = posting_t::num_ids(leaf->values);
+    }
+}
+
 static art_leaf* make_leaf(const unsigned char *key, uint32_t key_len, art_document *document) {
-    art_leaf *l = (art_leaf *) malloc(sizeof(art_leaf) + key_len);
+    art_leaf *l = (art_leaf *) CompactListArena::get_instance().allocate(leaf_size(key_len));
     l->key_len = key_len;
     l->max_score = document->score;
 
@@ -462,6 +577,15 @@ static uint32_t longest_common_prefix(art_leaf *l1, art_leaf *l2, int depth) {
     return idx;
 }
 
+// the child of a node can either be a leaf or another node
+static int64_t child_max_score(const void *child) {
+    if(IS_LEAF(child)) {
+        return ((art_leaf *) LEAF_RAW(child))->max_score;
+    }
+
+    return ((const art_node *) child)->max_score;
+}
+
 static void copy_header(art_node *dest, art_node *src) {
     dest->num_children = src->num_children;
     dest->partial_len = src->partial_len;
@@ -473,7 +597,7 @@ static void add_child256(art_node256 *n, art_node **ref, unsigned char c, void *
     (void)ref;
     n->n.num_children++;
     n->children[c] = (art_node *) child;
-    n->n.max_score = MAX(n->n.max_score, ((art_leaf *) LEAF_RAW(child))->max_score);
+    n->n.max_score = MAX(n->n.max_score, child_max_score(child));
 }
 
 static void add_child48(art_node48 *n, art_node **ref, unsigned char c, void *child) {
@@ -483,7 +607,7 @@ static void add_child48(art_node48 *n, art_node **ref, unsigned char c, void *ch
         n->children[pos] = (art_node *) child;
         n->keys[c] = pos + 1;
         n->n.num_children++;
-        n->n.max_score = MAX(n->n.max_score, ((art_leaf *) LEAF_RAW(child))->max_score);
+        n->n.max_score = MAX(n->n.max_score, child_max_score(child));
     } else {
         art_node256 *new_n = (art_node256*)alloc_node(NODE256);
         for (int i=0;i<256;i++) {
@@ -493,7 +617,7 @@ static void add_child48(art_node48 *n, art_node **ref, unsigned char c, void *ch
         }
         copy_header((art_node*)new_n, (art_node*)n);
         *ref = (art_node*)new_n;
-        free(n);
+        free_node((art_node*) n);
         add_child256(new_n, ref, c, child);
     }
 }
@@ -524,7 +648,7 @@ static void add_child16(art_node16 *n, art_node **ref, unsigned char c, void *ch
         n->keys[idx] = c;
         n->children[idx] = (art_node *) child;
         n->n.num_children++;
-        n->n.max_score = MAX(n->n.max_score, ((art_leaf *) LEAF_RAW(child))->max_score);
+        n->n.max_score = MAX(n->n.max_score, child_max_score(child));
 
     } else {
         art_node48 *new_n = (art_node48*)alloc_node(NODE48);
@@ -537,7 +661,7 @@ static void add_child16(art_node16 *n, art_node **ref, unsigned char c, void *ch
         }
         copy_header((art_node*)new_n, (art_node*)n);
         *ref = (art_node*)new_n;
-        free(n);
+        free_node((art_node*) n);
         add_child48(new_n, ref, c, child);
     }
 }
@@ -557,7 +681,7 @@ static void add_child4(art_node4 *n, art_node **ref, unsigned char c, void *chil
         n->keys[idx] = c;
         n->children[idx] = (art_node *) child;
         n->n.num_children++;
-        n->n.max_score = MAX(n->n.max_score, ((art_leaf *) LEAF_RAW(child))->max_score);
+        n->n.max_score = MAX(n->n.max_score, child_max_score(child));
 
     } else {
         art_node16 *new_n = (art_node16*)alloc_node(NODE16);
@@ -569,7 +693,7 @@ static void add_child4(art_node4 *n, art_node **ref, unsigned char c, void *chil
                 sizeof(unsigned char)*n->n.num_children);
         copy_header((art_node*)new_n, (art_node*)n);
         *ref = (art_node*)new_n;
-        free(n);
+        free_node((art_node*) n);
         add_child16(new_n, ref, c, child);
     }
 }
@@ -615,13 +739,11 @@ static int prefix_mismatch(const art_node *n, const unsigned char *key, int key_
 
 static void* recursive_insert(art_node* n, art_node** ref, const unsigned char* key, uint32_t key_len,
                               const int64_t docs_max_score, std::vector<art_document>& documents, int depth,
-                              std::list<art_node*>& path, int* old) {
+                              int* old) {
     // If we are at a NULL node, inject a leaf
     if (!n) {
         art_leaf* new_leaf = make_leaf(key, key_len, &documents[0]);
-        for(size_t i = 1; i < documents.size(); i++) {
-            add_document_to_leaf(&documents[i], new_leaf);
-        }
+        add_documents_to_leaf(documents, 1, new_leaf);
 
         *ref = (art_node*)SET_LEAF(new_leaf);
         return NULL;
@@ -634,9 +756,7 @@ static void* recursive_insert(art_node* n, art_node** ref, const unsigned char*
         // Check if we are updating an existing value
         if (!leaf_matches(l, key, key_len, depth)) {
             *old = 1;
-            for(size_t i = 0; i < documents.size(); i++) {
-                add_document_to_leaf(&documents[i], l);
-            }
+            add_documents_to_leaf(documents, 0, l);
             return l->values;
         }
 
@@ -650,9 +770,7 @@ static void* recursive_insert(art_node* n, art_node** ref, const unsigned char*
         new_n->n.partial_len = longest_prefix;
         memcpy(new_n->n.partial, key+depth, min(MAX_PREFIX_LEN, longest_prefix));
 
-        for(size_t i = 1; i < documents.size(); i++) {
-            add_document_to_leaf(&documents[i], l2);
-        }
+        add_documents_to_leaf(documents, 1, l2);
 
         // Add the leafs to the new node4
         *ref = (art_node*)new_n;
@@ -696,12 +814,9 @@ static void* recursive_insert(art_node* n, art_node** ref, const unsigned char*
 
         // Insert the new leaf
         art_leaf *l = make_leaf(key, key_len, &documents[0]);
-        for(size_t i = 1; i < documents.size(); i++) {
-            add_document_to_leaf(&documents[i], l);
-        }
+        add_documents_to_leaf(documents, 1, l);
 
         add_child4(new_n, ref, key[depth+prefix_diff], SET_LEAF(l));
-        path.push_back(*ref);
         return NULL;
     }
 
@@ -710,17 +825,21 @@ static void* recursive_insert(art_node* n, art_node** ref, const unsigned char*
     // Find a child to recurse to
     art_node **child = find_child(n, key[depth]);
     if (child) {
-        return recursive_insert(*child, child, key, key_len, docs_max_score, documents, depth + 1, path, old);
+        void* old_value = recursive_insert(*child, child, key, key_len, docs_max_score, documents, depth + 1, old);
+
+        if(docs_max_score == USE_FREQUENCY_SCORE) {
+            // frequency of the leaf is known only after the insert, so propagate it upwards from the child
+            n->max_score = MAX(n->max_score, child_max_score(*child));
+        }
+
+        return old_value;
     }
 
     // No child, node goes within us
     art_leaf *l = make_leaf(key, key_len, &documents[0]);
-    for(size_t i = 1; i < documents.size(); i++) {
-        add_document_to_leaf(&documents[i], l);
-    }
+    add_documents_to_leaf(documents, 1, l);
 
     add_child(n, ref, key[depth], SET_LEAF(l));
-    path.push_back(*ref);
     return NULL;
 }
 
@@ -742,16 +861,9 @@ void* art_inserts(art_tree *t, const unsigned char *key, int key_len, const int6
                   std::vector<art_document>& documents) {
     int old_val = 0;
 
-    std::list<art_node*> path;
-    bool frequency_based_ordering = (docs_max_score == USE_FREQUENCY_SCORE);
-    void *old = recursive_insert(t->root, &t->root, key, key_len, docs_max_score, documents, 0, path, &old_val);
+    void *old = recursive_insert(t->root, &t->root, key, key_len, docs_max_score, documents, 0, &old_val);
     if (!old_val) t->size++;
-
-    if(frequency_based_ordering) {
-        for(art_node* n: path) {
-            n->max_score = MAX(n->max_score, docs_max_score);
-        }
-    }
+    t->version++;
 
     return old;
 }
@@ -775,7 +887,7 @@ static void remove_child256(art_node256 *n, art_node **ref, unsigned char c) {
                 pos++;
             }
         }
-        free(n);
+        free_node((art_node*) n);
     }
 }
 
@@ -799,7 +911,7 @@ static void remove_child48(art_node48 *n, art_node **ref, unsigned char c) {
                 child++;
             }
         }
-        free(n);
+        free_node((art_node*) n);
     }
 }
 
@@ -815,7 +927,7 @@ static void remove_child16(art_node16 *n, art_node **ref, art_node **l) {
         copy_header((art_node*)new_n, (art_node*)n);
         memcpy(new_n->keys, n->keys, 4);
         memcpy(new_n->children, n->children, 4*sizeof(void*));
-        free(n);
+        free_node((art_node*) n);
     }
 }
 
@@ -846,7 +958,7 @@ static void remove_child4(art_node4 *n, art_node **ref, art_node **l) {
             child->partial_len += n->n.partial_len + 1;
         }
         *ref = child;
-        free(n);
+        free_node((art_node*) n);
     }
 }
 
@@ -924,8 +1036,9 @@ void* art_delete(art_tree *t, const unsigned char *key, int key_len) {
     art_leaf *l = recursive_delete(t->root, &t->root, key, key_len, 0);
     if (l) {
         t->size--;
+        t->version++;
         void *old = l->values;
-        free(l);
+        free_leaf(l);
         return old;
     }
     return NULL;
@@ -940,13 +1053,15 @@ void* art_delete(art_tree *t, const unsigned char *key, int key_len) {
     return child->max_token_count;
 }*/
 
-int art_topk_iter(const art_node *root, token_ordering token_order, size_t max_results,
+/*
+ * Best-first traversal of the subtrees rooted at `nodes`. Since the `max_score` of a node bounds the ranking value of
+ * every leaf underneath it, leaves are popped in their final order and we can stop after `max_results` of them.
+ */
+int art_topk_iter(const std::vector<const art_node*>& nodes, token_ordering token_order, size_t max_results,
                   const uint32_t* filter_ids, size_t filter_ids_length,
                   const std::set<std::string>& exclude_leaves, const art_leaf* exact_leaf,
                   std::vector<art_leaf *>& results) {
 
-    printf("INSIDE art_topk_iter: root->type: %d\n", root->type);
-
     std::priority_queue<const art_node *, std::vector<const art_node *>,
             decltype(&compare_art_node_score_pq)> q(compare_art_node_score_pq);
 
@@ -955,74 +1070,61 @@ int art_topk_iter(const art_node *root, token_ordering token_order, size_t max_r
                 decltype(&compare_art_node_frequency_pq)>(compare_art_node_frequency_pq);
     }
 
-    q.push(root);
+    for(const art_node* node: nodes) {
+        if(node) {
+            q.push(node);
+        }
+    }
 
-    while(!q.empty() && results.size() < max_results*4) {
+    while(!q.empty() && results.size() < max_results) {
         art_node *n = (art_node *) q.top();
         q.pop();
 
-        /*if (IS_LEAF(n)) {
-            art_leaf *l = (art_leaf *) LEAF_RAW(n);
-            LOG(INFO) << "Top node (leaf) score: " << l->max_score;
-        } else {
-            LOG(INFO) << "Top node score: " << n->max_score;
-        }*/
-
         if (!n) continue;
         if (IS_LEAF(n)) {
             art_leaf *l = (art_leaf *) LEAF_RAW(n);
-            //LOG(INFO) << "END LEAF SCORE: " << l->max_score;
 
-            if(filter_ids_length == 0) {
-                std::string tok(reinterpret_cast<char*>(l->key), l->key_len - 1);
-                if(exclude_leaves.count(tok) != 0 || l == exact_leaf) {
-                    continue;
-                }
-                results.push_back(l);
-            } else {
-                // we will push leaf only if filter matches with leaf IDs
-                bool found_atleast_one = posting_t::contains_atleast_one(l->values, filter_ids, filter_ids_length);
-                if(found_atleast_one) {
-                    std::string tok(reinterpret_cast<char*>(l->key), l->key_len - 1);
-                    if(exclude_leaves.count(tok) != 0 || l == exact_leaf) {
-                        continue;
-                    }
-                    results.push_back(l);
-                }
+            if(l == exact_leaf) {
+                continue;
+            }
+
+            // we will push leaf only if filter matches with leaf IDs
+            if(filter_ids_length != 0 && !posting_t::contains_atleast_one(l->values, filter_ids, filter_ids_length)) {
+                continue;
+            }
+
+            std::string tok(reinterpret_cast<char*>(l->key), l->key_len - 1);
+            if(exclude_leaves.count(tok) != 0) {
+                continue;
             }
 
+            results.push_back(l);
             continue;
         }
 
         int idx;
         switch (n->type) {
             case NODE4:
-                //LOG(INFO)  << "NODE4, SCORE: " << n->max_score;
                 for (int i=0; i < n->num_children; i++) {
-                    art_node* child = ((art_node4*)n)->children[i];
-                    q.push(child);
+                    q.push(((art_node4*)n)->children[i]);
                 }
                 break;
 
             case NODE16:
-                //LOG(INFO)  << "NODE16, SCORE: " << n->max_score;
                 for (int i=0; i < n->num_children; i++) {
                     q.push(((art_node16*)n)->children[i]);
                 }
                 break;
 
             case NODE48:
-                //LOG(INFO)  << "NODE48, SCORE: " << n->max_score;
                 for (int i=0; i < 256; i++) {
                     idx = ((art_node48*)n)->keys[i];
                     if (!idx) continue;
-                    art_node *child = ((art_node48*)n)->children[idx - 1];
-                    q.push(child);
+                    q.push(((art_node48*)n)->children[idx - 1]);
                 }
                 break;
 
             case NODE256:
-                //LOG(INFO)  << "NODE256, SCORE: " << n->max_score;
                 for (int i=0; i < 256; i++) {
                     if (!((art_node256*)n)->children[i]) continue;
                     q.push(((art_node256*)n)->children[i]);
@@ -1035,22 +1137,18 @@ int art_topk_iter(const art_node *root, token_ordering token_order, size_t max_r
         }
     }
 
-    /*LOG(INFO) << "leaf results.size: " << results.size()
-              << ", filter_ids_length: " << filter_ids_length
-              << ", num_large_lists: " << num_large_lists;*/
-
-    printf("OUTSIDE art_topk_iter: results size: %d\n", results.size());
     return 0;
 }
 
 // Recursively iterates over the tree
-static int recursive_iter(art_node *n, art_callback cb, void *data) {
+template<class T>
+static int recursive_iter_leaves(art_node *n, T&& on_leaf) {
     // Handle base cases
     if (!n) return 0;
     if (IS_LEAF(n)) {
         art_leaf *l = (art_leaf *) LEAF_RAW(n);
         //printf("REC LEAF len: %d, key: %s\n", l->key_len, l->key);
-        return cb(data, (const unsigned char*)l->key, l->key_len, l->values);
+        return on_leaf(l);
     }
 
     //printf("INTERNAL LEAF children: %d, partial_len: %d, partial: %s\n", n->num_children, n->partial_len, n->partial);
@@ -1060,14 +1158,14 @@ static int recursive_iter(art_node *n, art_callback cb, void *data) {
         case NODE4:
             for (int i=0; i < n->num_children; i++) {
                 //printf("INTERNAL LEAF key[i]: %c\n", ((art_node4*)n)->keys[i]);
-                res = recursive_iter(((art_node4*)n)->children[i], cb, data);
+                res = recursive_iter_leaves(((art_node4*)n)->children[i], on_leaf);
                 if (res) return res;
             }
             break;
 
         case NODE16:
             for (int i=0; i < n->num_children; i++) {
-                res = recursive_iter(((art_node16*)n)->children[i], cb, data);
+                res = recursive_iter_leaves(((art_node16*)n)->children[i], on_leaf);
                 if (res) return res;
             }
             break;
@@ -1077,7 +1175,7 @@ static int recursive_iter(art_node *n, art_callback cb, void *data) {
                 idx = ((art_node48*)n)->keys[i];
                 if (!idx) continue;
 
-                res = recursive_iter(((art_node48*)n)->children[idx-1], cb, data);
+                res = recursive_iter_leaves(((art_node48*)n)->children[idx-1], on_leaf);
                 if (res) return res;
             }
             break;
@@ -1085,7 +1183,7 @@ static int recursive_iter(art_node *n, art_callback cb, void *data) {
         case NODE256:
             for (int i=0; i < 256; i++) {
                 if (!((art_node256*)n)->children[i]) continue;
-                res = recursive_iter(((art_node256*)n)->children[i], cb, data);
+                res = recursive_iter_leaves(((art_node256*)n)->children[i], on_leaf);
                 if (res) return res;
             }
             break;
@@ -1096,6 +1194,12 @@ static int recursive_iter(art_node *n, art_callback cb, void *data) {
     return 0;
 }
 
+static int recursive_iter(art_node *n, art_callback cb, void *data) {
+    return recursive_iter_leaves(n, [cb, data](const art_leaf* l) {
+        return cb(data, (const unsigned char*)l->key, l->key_len, l->values);
+    });
+}
+
 /**
  * Iterates through the entries pairs in the map,
  * invoking a callback for each. The call back gets a
@@ -1110,6 +1214,12 @@ int art_iter(art_tree *t, art_callback cb, void *data) {
     return recursive_iter(t->root, cb, data);
 }
 
+int art_iter_leaves(art_tree *t, art_leaf_callback cb, void *data) {
+    return recursive_iter_leaves(t->root, [cb, data](const art_leaf* l) {
+        return cb(data, l);
+    });
+}
+
 /**
  * Checks if a leaf prefix matches
  * @return 0 on success.
@@ -1209,10 +1319,11 @@ void print_row(const int* row, const int row_len) {
     printf("\n");
 }
 
-static inline void copyIntArray2(const int *src, int *dest, const int len) {
-    for(int t=0; t<len; t++) {
-        dest[t] = src[t];
-    }
+static inline void rotate(int &i, int &j, int &k) {
+    int old_i = i;
+    i = j;
+    j = k;
+    k = old_i;
 }
 
 static inline void levenshtein_dist(const int depth, const unsigned char p, const unsigned char c,
@@ -1238,8 +1349,109 @@ static inline void levenshtein_dist(const int depth, const unsigned char p, cons
     }
 }
 
-static inline void art_fuzzy_children(unsigned char p, const art_node *n, int depth, const unsigned char *term, const int term_len,
-                                      const int* irow, const int* jrow, const int min_cost, const int max_cost,
+/*
+    Both matrices below hold the optimal string alignment distances between the key characters visited so far (rows)
+    and the prefixes of the search term (columns), advancing by one row per key character. Only the last rows are
+    kept in a `row_t`, which is copied to each child node during the traversal.
+*/
+
+// Used for terms that are longer than the bit-parallel version supports.
+struct levenshtein_rows_t {
+    const unsigned char* term;
+    const int term_len;
+
+    struct row_t {
+        // the rows of the 2 most recent key characters, followed by a scratch row
+        std::vector<int> cells;
+        int i = 0, j = 1, k = 2;
+    };
+
+    levenshtein_rows_t(const unsigned char* term, const int term_len): term(term), term_len(term_len) {
+
+    }
+
+    row_t first_row() const {
+        row_t row;
+        row.cells.resize(3 * (term_len + 1));
+
+        for(int column = 0; column <= term_len; column++) {
+            row.cells[row.i * (term_len + 1) + column] = column;
+            row.cells[row.j * (term_len + 1) + column] = column;
+        }
+
+        return row;
+    }
+
+    void next(row_t& row, const int depth, const unsigned char p, const unsigned char c) const {
+        int* cells = row.cells.data();
+        levenshtein_dist(depth, p, c, term, term_len, cells + row.i * (term_len + 1), cells + row.j * (term_len + 1),
+                         cells + row.k * (term_len + 1));
+        rotate(row.i, row.j, row.k);
+    }
+
+    int cost(const row_t& row, const int column) const {
+        return row.cells[row.j * (term_len + 1) + column];
+    }
+};
+
+// Bit-parallel form of `levenshtein_rows_t` (Hyyrö, 2003) that advances a whole row with a few word operations.
+struct levenshtein_bits_t {
+    static constexpr int MAX_TERM_LEN = 64;
+
+    const unsigned char* term;
+    const int term_len;
+
+    // bit `column - 1` is set when the term has the given character at `column`
+    uint64_t char_masks[256] = {0};
+
+    struct row_t {
+        // bit `column - 1` is set when the cost at `column` is one more (`vp`) or one less (`vn`) than at `column - 1`
+        uint64_t vp = ~uint64_t(0);
+        uint64_t vn = 0;
+
+        // bit `column - 1` is set when the cost at `column` equals the cost of the preceding row at `column - 1`
+        uint64_t d0 = 0;
+
+        // cost at column 0, i.e. the number of key characters
+        int cost0 = 0;
+    };
+
+    levenshtein_bits_t(const unsigned char* term, const int term_len): term(term), term_len(term_len) {
+        for(int column = 1; column <= term_len; column++) {
+            char_masks[term[column - 1]] |= (uint64_t(1) << (column - 1));
+        }
+    }
+
+    row_t first_row() const {
+        return row_t();
+    }
+
+    void next(row_t& row, const int depth, const unsigned char p, const unsigned char c) const {
+        const uint64_t pm = char_masks[c];
+
+        // transpositions are considered only from the third key character onwards, as in `levenshtein_dist()`
+        const uint64_t tr = (depth > 1) ? ((((~row.d0) & pm) << 1) & char_masks[p]) : 0;
+        const uint64_t d0 = ((((pm & row.vp) + row.vp) ^ row.vp) | pm | row.vn) | tr;
+
+        // horizontal deltas, shifted in with the +1 of column 0
+        const uint64_t hp = ((row.vn | ~(d0 | row.vp)) << 1) | 1;
+        const uint64_t hn = (d0 & row.vp) << 1;
+
+        row.vp = hn | ~(d0 | hp);
+        row.vn = hp & d0;
+        row.d0 = d0;
+        row.cost0++;
+    }
+
+    int cost(const row_t& row, const int column) const {
+        const uint64_t mask = (column >= MAX_TERM_LEN) ? ~uint64_t(0) : ((uint64_t(1) << column) - 1);
+        return row.cost0 + __builtin_popcountll(row.vp & mask) - __builtin_popcountll(row.vn & mask);
+    }
+};
+
+template<class M>
+static inline void art_fuzzy_children(const M& matrix, unsigned char p, const art_node *n, int depth,
+                                      const typename M::row_t& row, const int min_cost, const int max_cost,
                                       const bool prefix, std::vector<const art_node *> &results) {
     char child_char;
     art_node* child;
@@ -1251,7 +1463,7 @@ static inline void art_fuzzy_children(unsigned char p, const art_node *n, int de
                 child_char = ((art_node4*)n)->keys[i];
                 printf("4!child_char: %c, %d, depth: %d\n", child_char, child_char, depth);
                 child = ((art_node4*)n)->children[i];
-                art_fuzzy_recurse(p, child_char, child, depth, term, term_len, irow, jrow, min_cost, max_cost, prefix, results);
+                art_fuzzy_recurse(matrix, p, child_char, child, depth, row, min_cost, max_cost, prefix, results);
             }
             break;
         case NODE16:
@@ -1260,7 +1472,7 @@ static inline void art_fuzzy_children(unsigned char p, const art_node *n, int de
                 child_char = ((art_node16*)n)->keys[i];
                 printf("16!child_char: %c, depth: %d\n", child_char, depth);
                 child = ((art_node16*)n)->children[i];
-                art_fuzzy_recurse(p, child_char, child, depth, term, term_len, irow, jrow, min_cost, max_cost, prefix, results);
+                art_fuzzy_recurse(matrix, p, child_char, child, depth, row, min_cost, max_cost, prefix, results);
             }
             break;
         case NODE48:
@@ -1271,7 +1483,7 @@ static inline void art_fuzzy_children(unsigned char p, const art_node *n, int de
                 child = ((art_node48*)n)->children[ix - 1];
                 child_char = (char)i;
                 printf("48!child_char: %c, depth: %d, ix: %d\n", child_char, depth, ix);
-                art_fuzzy_recurse(p, child_char, child, depth, term, term_len, irow, jrow, min_cost, max_cost, prefix, results);
+                art_fuzzy_recurse(matrix, p, child_char, child, depth, row, min_cost, max_cost, prefix, results);
             }
             break;
         case NODE256:
@@ -1281,7 +1493,7 @@ static inline void art_fuzzy_children(unsigned char p, const art_node *n, int de
                 child_char = (char) i;
                 printf("256!child_char: %c, depth: %d\n", child_char, depth);
                 child = ((art_node256*)n)->children[i];
-                art_fuzzy_recurse(p, child_char, child, depth, term, term_len, irow, jrow, min_cost, max_cost, prefix, results);
+                art_fuzzy_recurse(matrix, p, child_char, child, depth, row, min_cost, max_cost, prefix, results);
             }
             break;
         default:
@@ -1289,16 +1501,10 @@ static inline void art_fuzzy_children(unsigned char p, const art_node *n, int de
     }
 }
 
-static inline void rotate(int &i, int &j, int &k) {
-    int old_i = i;
-    i = j;
-    j = k;
-    k = old_i;
-}
-
 // -1: return without adding, 0 : continue iteration, 1: return after adding
-static inline int fuzzy_search_state(const bool prefix, int key_index, bool last_key_char,
-                                     int term_len, const int* cost_row, int min_cost, int max_cost) {
+template<class M>
+static inline int fuzzy_search_state(const bool prefix, int key_index, bool last_key_char, int term_len,
+                                     const M& matrix, const typename M::row_t& row, int min_cost, int max_cost) {
 
     // a) iter_len < term_len: "pltninum" (term) on "pst" (key)
     // b) term_len < iter_len: "pst" (term) on "pltninum" (key)
@@ -1308,13 +1514,13 @@ static inline int fuzzy_search_state(const bool prefix, int key_index, bool last
     // a) because key's null character will appear first
     if(last_key_char) {
         int key_len = key_index;
-        cost = cost_row[term_len];
+        cost = matrix.cost(row, term_len);
 
         if(cost >= min_cost && cost <= max_cost) {
             return 1;
         }
 
-        cost = cost_row[key_len];
+        cost = matrix.cost(row, key_len);
 
         // used to match q=strawberries on key=strawberry, but limit to larger keys to prevent eager matches
         if(key_len > 5 && term_len > key_len && (term_len - key_len) <= max_cost &&
@@ -1329,34 +1535,29 @@ static inline int fuzzy_search_state(const bool prefix, int key_index, bool last
 
     // b) we might iterate past term_len to catch trailing typos
     if(key_len >= term_len && prefix) {
-        cost = cost_row[term_len];
+        cost = matrix.cost(row, term_len);
         if(cost >= min_cost && cost <= max_cost) {
             return 1;
         }
     } else {
-        // `key_len` can't exceed `term_len` since length of `cost_row` is `term_len + 1`
-        cost = cost_row[std::min(key_len, term_len)];
+        // `key_len` can't exceed `term_len` since the matrix has `term_len + 1` columns
+        cost = matrix.cost(row, std::min(key_len, term_len));
     }
 
     int bounded_cost = (max_cost == 0) ? max_cost : (max_cost + 1);
     return (cost > bounded_cost) ? -1 : 0;
 }
 
-static void art_fuzzy_recurse(unsigned char p, unsigned char c, const art_node *n, int depth, const unsigned char *term,
-                              const int term_len, const int* irow, const int* jrow, const int min_cost,
-                              const int max_cost, const bool prefix, std::vector<const art_node *> &results) {
+template<class M>
+static void art_fuzzy_recurse(const M& matrix, unsigned char p, unsigned char c, const art_node *n, int depth,
+                              const typename M::row_t& parent_row, const int min_cost, const int max_cost,
+                              const bool prefix, std::vector<const art_node *> &results) {
 
     if (!n) return ;
 
-    const int columns = term_len+1;
-    int i=0, j=1, k=2;
-    int row0[columns];
-    int row1[columns];
-    int row2[columns];
-    int* rows[3] = {row0, row1, row2};
-
-    copyIntArray2(irow, rows[i], columns);
-    copyIntArray2(jrow, rows[j], columns);
+    const unsigned char* term = matrix.term;
+    const int term_len = matrix.term_len;
+    typename M::row_t row = parent_row;
 
     if(depth == -1) {
         // root node
@@ -1366,12 +1567,11 @@ static void art_fuzzy_recurse(unsigned char p, unsigned char c, const art_node *
         bool last_key_char = (c == '\0');
 
         if(!prefix || !last_key_char) {
-            levenshtein_dist(depth, p, c, term, term_len, rows[i], rows[j], rows[k]);
-            rotate(i, j, k);
+            matrix.next(row, depth, p, c);
             p = c;
         }
 
-        int action = fuzzy_search_state(prefix, depth, last_key_char, term_len, rows[j], min_cost, max_cost);
+        int action = fuzzy_search_state(prefix, depth, last_key_char, term_len, matrix, row, min_cost, max_cost);
         if(1 == action) {
             results.push_back(n);
             return;
@@ -1399,7 +1599,7 @@ static void art_fuzzy_recurse(unsigned char p, unsigned char c, const art_node *
 
         if(depth >= iter_len) {
             // when a preceding partial node completely contains the whole leaf (e.g. "[raspberr]y" on "raspberries")
-            int action = fuzzy_search_state(prefix, depth, true, term_len, rows[j], min_cost, max_cost);
+            int action = fuzzy_search_state(prefix, depth, true, term_len, matrix, row, min_cost, max_cost);
             if(action == 1) {
                 results.push_back(n);
             }
@@ -1413,16 +1613,15 @@ static void art_fuzzy_recurse(unsigned char p, unsigned char c, const art_node *
             bool last_key_char = (c == '\0');
 
             if(!prefix || !last_key_char) {
-                levenshtein_dist(depth, p, c, term, term_len, rows[i], rows[j], rows[k]);
+                matrix.next(row, depth, p, c);
 
                 printf("leaf char: %c\n", l->key[depth]);
                 printf("cost: %d, depth: %d, term_len: %d\n", temp_cost, depth, term_len);
 
-                rotate(i, j, k);
                 p = c;
             }
 
-            int action = fuzzy_search_state(prefix, depth, last_key_char, term_len, rows[j], min_cost, max_cost);
+            int action = fuzzy_search_state(prefix, depth, last_key_char, term_len, matrix, row, min_cost, max_cost);
             if(action == 1) {
                 results.push_back(n);
                 return;
@@ -1446,11 +1645,10 @@ static void art_fuzzy_recurse(unsigned char p, unsigned char c, const art_node *
     for (int idx = 0; idx < partial_len; idx++) {
         c = n->partial[idx];
 
-        levenshtein_dist(depth, p, c, term, term_len, rows[i], rows[j], rows[k]);
-        rotate(i, j, k);
+        matrix.next(row, depth, p, c);
         p = c;
 
-        int action = fuzzy_search_state(prefix, depth, false, term_len, rows[j], min_cost, max_cost);
+        int action = fuzzy_search_state(prefix, depth, false, term_len, matrix, row, min_cost, max_cost);
         if(action == 1) {
             results.push_back(n);
             return;
@@ -1466,11 +1664,10 @@ static void art_fuzzy_recurse(unsigned char p, unsigned char c, const art_node *
     // Some intermediate path may have been left out if partial_len is truncated: progress the levenshtein matrix
     while(partial_len < n->partial_len && depth < term_len) {
         c = term[depth];
-        levenshtein_dist(depth, p, c, term, term_len, rows[i], rows[j], rows[k]);
-        rotate(i, j, k);
+        matrix.next(row, depth, p, c);
         p = c;
 
-        int action = fuzzy_search_state(prefix, depth, false, term_len, rows[j], min_cost, max_cost);
+        int action = fuzzy_search_state(prefix, depth, false, term_len, matrix, row, min_cost, max_cost);
         if(action == 1) {
             results.push_back(n);
             return;
@@ -1484,7 +1681,21 @@ static void art_fuzzy_recurse(unsigned char p, unsigned char c, const art_node *
         partial_len++;
     }
 
-    art_fuzzy_children(c, n, depth, term, term_len, rows[i], rows[j], min_cost, max_cost, prefix, results);
+    art_fuzzy_children(matrix, c, n, depth, row, min_cost, max_cost, prefix, results);
+}
+
+template<class M>
+static void art_fuzzy_search_nodes(const art_tree *t, const M& matrix, const int min_cost, const int max_cost,
+                                   const bool prefix, std::vector<const art_node*>& nodes) {
+    const typename M::row_t row = matrix.first_row();
+
+    if(IS_LEAF(t->root)) {
+        art_leaf *l = (art_leaf *) LEAF_RAW(t->root);
+        art_fuzzy_recurse(matrix, 0, l->key[0], t->root, 0, row, min_cost, max_cost, prefix, nodes);
+    } else {
+        // send depth as -1 to indicate that this is a root node
+        art_fuzzy_recurse(matrix, 0, 0, t->root, -1, row, min_cost, max_cost, prefix, nodes);
+    }
 }
 
 /**
@@ -1496,24 +1707,19 @@ int art_fuzzy_search(art_tree *t, const unsigned char *term, const int term_len,
                      std::vector<art_leaf *> &results, const std::set<std::string>& exclude_leaves) {
 
     std::vector<const art_node*> nodes;
-    int irow[term_len + 1];
-    int jrow[term_len + 1];
-    for (int i = 0; i <= term_len; i++){
-        irow[i] = jrow[i] = i;
-    }
 
     //auto begin = std::chrono::high_resolution_clock::now();
 
-    if(IS_LEAF(t->root)) {
-        art_leaf *l = (art_leaf *) LEAF_RAW(t->root);
-        art_fuzzy_recurse(0, l->key[0], t->root, 0, term, term_len, irow, jrow, min_cost, max_cost, prefix, nodes);
-    } else {
-        if(t->root == nullptr) {
-            return 0;
-        }
+    if(t->root == nullptr) {
+        return 0;
+    }
 
-        // send depth as -1 to indicate that this is a root node
-        art_fuzzy_recurse(0, 0, t->root, -1, term, term_len, irow, jrow, min_cost, max_cost, prefix, nodes);
+    if(term_len <= levenshtein_bits_t::MAX_TERM_LEN) {
+        const levenshtein_bits_t matrix(term, term_len);
+        art_fuzzy_search_nodes(t, matrix, min_cost, max_cost, prefix, nodes);
+    } else {
+        const levenshtein_rows_t matrix(term, term_len);
+        art_fuzzy_search_nodes(t, matrix, min_cost, max_cost, prefix, nodes);
     }
 
     //long long int time_micro = microseconds(std::chrono::high_resolution_clock::now() - begin).count();
@@ -1525,15 +1731,8 @@ int art_fuzzy_search(art_tree *t, const unsigned char *term, const int term_len,
     art_leaf* exact_leaf = (art_leaf *) art_search(t, term, key_len);
     //LOG(INFO) << "exact_leaf: " << exact_leaf << ", term: " << term << ", term_len: " << term_len;
 
-    for(auto node: nodes) {
-        art_topk_iter(node, token_order, max_words, filter_ids, filter_ids_length, exclude_leaves, exact_leaf, results);
-    }
-
-    if(token_order == FREQUENCY) {
-        std::sort(results.begin(), results.end(), compare_art_leaf_frequency);
-    } else {
-        std::sort(results.begin(), results.end(), compare_art_leaf_score);
-    }
+    // leaves are collected in their ranked order
+    art_topk_iter(nodes, token_order, max_words, filter_ids, filter_ids_length, exclude_leaves, exact_leaf, results);
 
     if(exact_leaf && min_cost == 0) {
         results.insert(results.begin(), exact_leaf);
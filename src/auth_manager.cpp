@@ -13,6 +13,11 @@ Option<bool> AuthManager::init(Store* store, const std::string& bootstrap_auth_k
     this->store = store;
     this->bootstrap_auth_key = bootstrap_auth_key;
 
+    {
+        std::unique_lock cache_lock(auth_cache_mutex);
+        auth_cache.clear();
+    }
+
     std::string next_api_key_id_str;
     StoreStatus next_api_key_id_status = store->get(API_KEY_NEXT_ID_KEY, next_api_key_id_str);
 
@@ -131,6 +136,12 @@ Option<api_key_t> AuthManager::remove_key(uint32_t id) {
     api_key_t&& key = key_op.get();
     api_keys.erase(key.value);
 
+    // scoped keys of the removed key are cached along with the key itself
+    {
+        std::unique_lock cache_lock(auth_cache_mutex);
+        auth_cache.clear();
+    }
+
     return Option<api_key_t>(key.truncate_value());
 }
 
@@ -150,20 +161,41 @@ bool AuthManager::authenticate(const std::string& action,
     size_t num_keys_matched = 0;
     for(size_t i = 0; i < collection_keys.size(); i++) {
         const auto& coll_key = collection_keys[i];
-        const auto& key_it = api_keys.find(coll_key.api_key);
+        const std::string cache_key = action + '\0' + coll_key.collection + '\0' + coll_key.api_key;
         nlohmann::json embedded_params;
-
-        if(key_it != api_keys.end()) {
-            const api_key_t& api_key = key_it.value();
-            if(!auth_against_key(coll_key.collection, action, api_key, false)) {
-                return false;
+        bool cached = false;
+
+        {
+            std::unique_lock cache_lock(auth_cache_mutex);
+            auto hit_it = auth_cache.find(cache_key);
+            if(hit_it != auth_cache.end() && uint64_t(std::time(0)) <= hit_it.value().expires_at) {
+                embedded_params = hit_it.value().embedded_params;
+                cached = true;
             }
-        } else {
-            // could be a scoped API key
-            Option<bool> auth_op = authenticate_parse_params(coll_key, action, embedded_params);
-            if(!auth_op.ok()) {
-                return false;
+        }
+
+        if(!cached) {
+            const auto& key_it = api_keys.find(coll_key.api_key);
+            uint64_t expires_at;
+
+            if(key_it != api_keys.end()) {
+                const api_key_t& api_key = key_it.value();
+                if(!auth_against_key(coll_key.collection, action, api_key, false)) {
+                    return false;
+                }
+
+                expires_at = api_key.expires_at;
+            } else {
+                // could be a scoped API key
+                Option<bool> auth_op = authenticate_parse_params(coll_key, action, embedded_params, expires_at);
+                if(!auth_op.ok()) {
+                    return false;
+                }
             }
+
+            // only granted authentications are cached, so that unknown keys cannot crowd out the known ones
+            std::unique_lock cache_lock(auth_cache_mutex);
+            auth_cache.insert(cache_key, auth_cache_entry_t{embedded_params, expires_at});
         }
 
         num_keys_matched++;
@@ -245,7 +277,7 @@ bool AuthManager::auth_against_key(const std::string& req_collection, const std:
 }
 
 Option<bool> AuthManager::authenticate_parse_params(const collection_key_t& scoped_api_key, const std::string& action,
-                                                    nlohmann::json& embedded_params) const {
+                                                    nlohmann::json& embedded_params, uint64_t& expires_at) const {
 
     // allow only searches from scoped keys
     if(action != DOCUMENTS_SEARCH_ACTION) {
@@ -294,19 +326,22 @@ Option<bool> AuthManager::authenticate_parse_params(const collection_key_t& scop
                 continue;
             }
 
+            uint64_t expiry_ts = root_api_key.expires_at;
+
             if(embedded_params.count("expires_at") != 0) {
                 if(!embedded_params["expires_at"].is_number_integer() || embedded_params["expires_at"].get<int64_t>() < 0) {
                     continue;
                 }
 
                 // if parent key's expiry timestamp is smaller, it takes precedence
-                uint64_t expiry_ts = std::min(root_api_key.expires_at, embedded_params["expires_at"].get<uint64_t>());
+                expiry_ts = std::min(root_api_key.expires_at, embedded_params["expires_at"].get<uint64_t>());
 
                 if(uint64_t(std::time(0)) > expiry_ts) {
                     continue;
                 }
             }
 
+            expires_at = expiry_ts;
             return Option<bool>(true);
         }
     }
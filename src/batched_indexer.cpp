@@ -51,7 +51,8 @@ void BatchedIndexer::enqueue(const std::shared_ptr<http_req>& req, const std::sh
 
         {
             const std::string& coll_name = get_collection_name(req);
-            uint64_t queue_id = StringUtils::hash_wy(coll_name.c_str(), coll_name.size()) % num_threads;
+            const std::string& doc_id = get_doc_id(req);
+            const std::string& add_batch_key = get_add_batch_key(req, chunk_sequence == 0);
             req->body = "";
 
             {
@@ -59,12 +60,7 @@ void BatchedIndexer::enqueue(const std::shared_ptr<http_req>& req, const std::sh
                 req_res_map[req->start_ts].is_complete = true;
             }
 
-            {
-                std::unique_lock lk1(qmutuxes[queue_id].mcv);
-                queues[queue_id].emplace_back(req->start_ts);
-            }
-
-            qmutuxes[queue_id].cv.notify_one();
+            queue_req(req->start_ts, coll_name, doc_id, add_batch_key);
         }
 
         // IMPORTANT: must not read `req` variables (except _req) henceforth to prevent data races with indexing thread
@@ -116,6 +112,114 @@ std::string BatchedIndexer::get_collection_name(const std::shared_ptr<http_req>&
     return coll_name;
 }
 
+std::string BatchedIndexer::get_doc_id(const std::shared_ptr<http_req>& req) {
+    route_path* rpath;
+    if(!server->get_route(req->route_hash, &rpath)) {
+        return "";
+    }
+
+    if(rpath->handler == patch_update_document || rpath->handler == del_remove_document) {
+        return req->params["id"];
+    }
+
+    return "";
+}
+
+std::string BatchedIndexer::get_add_batch_key(const std::shared_ptr<http_req>& req, bool is_single_chunk) {
+    route_path* rpath;
+    if(req->start_ts == 0 || !is_single_chunk || !server->get_route(req->route_hash, &rpath) ||
+       rpath->handler != post_add_document) {
+        return "";
+    }
+
+    const auto action_it = req->params.find("action");
+    const auto dirty_values_it = req->params.find("dirty_values");
+
+    return req->params["collection"] + '\0' +
+           (action_it == req->params.end() ? "" : action_it->second) + '\0' +
+           (dirty_values_it == req->params.end() ? "" : dirty_values_it->second);
+}
+
+void BatchedIndexer::queue_req(uint64_t req_id, const std::string& coll_name, const std::string& doc_id,
+                               const std::string& add_batch_key) {
+    queued_req_t queued_req{req_id, coll_name, 0, add_batch_key, Tracer::now_ns()};
+    uint64_t queue_id;
+
+    {
+        std::unique_lock lk(epochs_mutex);
+        coll_epochs_t& epochs = coll_epochs[coll_name];
+
+        if(doc_id.empty()) {
+            epochs.last_epoch++;
+            epochs.last_is_collection_write = true;
+            queue_id = StringUtils::hash_wy(coll_name.c_str(), coll_name.size()) % num_threads;
+        } else {
+            if(epochs.last_is_collection_write) {
+                epochs.last_epoch++;
+                epochs.last_is_collection_write = false;
+            }
+
+            const std::string& doc_key = coll_name + '\0' + doc_id;
+            queue_id = StringUtils::hash_wy(doc_key.c_str(), doc_key.size()) % num_threads;
+        }
+
+        queued_req.epoch = epochs.last_epoch;
+        epochs.num_pending[queued_req.epoch]++;
+    }
+
+    {
+        std::unique_lock lk(qmutuxes[queue_id].mcv);
+        queues[queue_id].emplace_back(std::move(queued_req));
+    }
+
+    qmutuxes[queue_id].cv.notify_one();
+}
+
+bool BatchedIndexer::await_epoch(const queued_req_t& queued_req) {
+    std::unique_lock lk(epochs_mutex);
+    epochs_cv.wait(lk, [&] {
+        // the write itself is pending, so no earlier write is when its epoch comes first
+        return quit || coll_epochs.at(queued_req.coll_name).num_pending.begin()->first == queued_req.epoch;
+    });
+
+    return !quit;
+}
+
+void BatchedIndexer::trace_queue_wait(const queued_req_t& queued_req, const http_req& req) {
+    if(!req.trace_context.sampled) {
+        return ;
+    }
+
+    span_record_t span;
+    span.trace_id_high = req.trace_context.trace_id_high;
+    span.trace_id_low = req.trace_context.trace_id_low;
+    span.span_id = Tracer::new_id();
+    span.parent_span_id = req.trace_context.span_id;
+    span.name = "indexer.queue";
+    span.start_ns = queued_req.queued_ns;
+    span.end_ns = Tracer::now_ns();
+    span.attributes.emplace_back("collection", queued_req.coll_name);
+    Tracer::get_instance().record(std::move(span));
+}
+
+void BatchedIndexer::finish_epoch(const queued_req_t& queued_req) {
+    {
+        std::unique_lock lk(epochs_mutex);
+        coll_epochs_t& epochs = coll_epochs[queued_req.coll_name];
+        auto num_pending_it = epochs.num_pending.find(queued_req.epoch);
+
+        if(--num_pending_it->second == 0) {
+            epochs.num_pending.erase(num_pending_it);
+
+            if(epochs.num_pending.empty()) {
+                coll_epochs.erase(queued_req.coll_name);
+            }
+        }
+    }
+
+    epochs_cv.notify_all();
+}
+
 void BatchedIndexer::run() {
     LOG(INFO) << "Starting batch indexer with " << num_threads << " threads.";
     ThreadPool* thread_pool = new ThreadPool(num_threads);
@@ -126,10 +230,11 @@ void BatchedIndexer::run() {
     LOG(INFO) << "BatchedIndexer skip_index: " << skip_index;
 
     for(size_t i = 0; i < num_threads; i++) {
-        std::deque<uint64_t>& queue = queues[i];
+        std::deque<queued_req_t>& queue = queues[i];
         await_t& queue_mutex = qmutuxes[i];
 
-        thread_pool->enqueue([&queue, &queue_mutex, this, i]() {
+        thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::INDEXING,
+                                  [&queue, &queue_mutex, this, i]() {
             while(!quit) {
                 std::unique_lock<std::mutex> qlk(queue_mutex.mcv);
                 queue_mutex.cv.wait(qlk, [&] { return quit || !queue.empty(); });
@@ -138,14 +243,48 @@ void BatchedIndexer::run() {
                     break;
                 }
 
-                uint64_t req_id = queue.front();
+                queued_req_t queued_req = std::move(queue.front());
                 queue.pop_front();
+
+                // Adds queued right behind a single document add, with the same parameters and with no other write
+                // to the collection in between, go into the same batch. Only writes already queued are taken, so
+                // that a lone write is not held back.
+                std::vector<queued_req_t> coalesced_reqs;
+
+                if(!queued_req.add_batch_key.empty()) {
+                    uint64_t last_epoch = queued_req.epoch;
+
+                    while(!queue.empty() && coalesced_reqs.size() + 1 < MAX_COALESCED_ADDS &&
+                          queue.front().add_batch_key == queued_req.add_batch_key &&
+                          queue.front().coll_name == queued_req.coll_name &&
+                          queue.front().epoch == last_epoch + 1) {
+                        last_epoch++;
+                        coalesced_reqs.push_back(std::move(queue.front()));
+                        queue.pop_front();
+                    }
+                }
+
                 qlk.unlock();
 
+                if(!await_epoch(queued_req)) {
+                    break;
+                }
+
+                if(!coalesced_reqs.empty()) {
+                    // the other adds follow in consecutive epochs, so they wait on nothing but the first one
+                    coalesced_reqs.insert(coalesced_reqs.begin(), std::move(queued_req));
+                    index_coalesced_adds(coalesced_reqs);
+                    continue;
+                }
+
+                const uint64_t req_id = queued_req.req_id;
+
                 std::unique_lock mlk(mutex);
                 auto req_res_map_it = req_res_map.find(req_id);
                 if(req_res_map_it == req_res_map.end()) {
                     LOG(ERROR) << "Req ID " << req_id << " not found in req_res_map.";
+                    mlk.unlock();
+                    finish_epoch(queued_req);
                     continue;
                 }
 
@@ -167,6 +306,8 @@ void BatchedIndexer::run() {
                 const std::shared_ptr<http_res>& orig_res = orig_req_res.res;
                 bool is_live_req = orig_res->is_alive;
 
+                trace_queue_wait(queued_req, *orig_req);
+
                 route_path* found_rpath = nullptr;
                 bool route_found = server->get_route(orig_req->route_hash, &found_rpath);
                 bool async_res = false;
@@ -189,6 +330,10 @@ void BatchedIndexer::run() {
                         //LOG(INFO) << "index req " << req_id << ", chunk index: " << orig_req_res.next_chunk_index;
 
                         if(route_found) {
+                            trace_span_t index_span("indexer.index", orig_req->trace_context);
+                            index_span.set_attribute("collection", queued_req.coll_name);
+                            index_span.set_attribute("chunk_index", int64_t(orig_req_res.next_chunk_index));
+
                             async_res = found_rpath->async_res;
                             try {
                                 found_rpath->handler(orig_req, orig_res);
@@ -231,8 +376,12 @@ void BatchedIndexer::run() {
                 // we can delete the buffered request content
                 store->delete_range(req_key_prefix, req_key_prefix + StringUtils::serialize_uint32_t(UINT32_MAX));
 
-                std::unique_lock lk(mutex);
-                req_res_map.erase(req_id);
+                {
+                    std::unique_lock lk(mutex);
+                    req_res_map.erase(req_id);
+                }
+
+                finish_epoch(queued_req);
             }
         });
     }
@@ -286,12 +435,104 @@ void BatchedIndexer::run() {
         queue_mutex.cv.notify_one();
     }
 
+    {
+        std::lock_guard<std::mutex> lk(epochs_mutex);
+        epochs_cv.notify_all();
+    }
+
 
     LOG(INFO) << "Batched indexer threadpool shutdown...";
     thread_pool->shutdown();
     delete thread_pool;
 }
 
+void BatchedIndexer::index_coalesced_adds(const std::vector<queued_req_t>& queued_reqs) {
+    std::vector<std::shared_ptr<http_req>> reqs;
+    std::vector<std::shared_ptr<http_res>> ress;
+
+    {
+        std::shared_lock slk(pause_mutex); // used for snapshot
+
+        for(const auto& queued_req: queued_reqs) {
+            std::unique_lock mlk(mutex);
+            auto req_res_map_it = req_res_map.find(queued_req.req_id);
+            if(req_res_map_it == req_res_map.end()) {
+                LOG(ERROR) << "Req ID " << queued_req.req_id << " not found in req_res_map.";
+                continue;
+            }
+
+            req_res_t& req_res = req_res_map_it->second;
+            mlk.unlock();
+
+            std::string chunk;
+            const std::string& chunk_key = get_req_prefix_key(queued_req.req_id) +
+                                           StringUtils::serialize_uint32_t(req_res.next_chunk_index);
+
+            if(store->get(chunk_key, chunk) != StoreStatus::FOUND) {
+                // already applied
+                continue;
+            }
+
+            req_res.req->body = req_res.prev_req_body;
+            req_res.req->load_from_json(chunk);
+            req_res.next_chunk_index++;
+            queued_writes--;
+
+            trace_queue_wait(queued_req, *req_res.req);
+
+            if(req_res.req->log_index == skip_index) {
+                LOG(ERROR) << "Skipping write log index " << req_res.req->log_index
+                           << " which seems to have triggered a crash previously.";
+                populate_skip_index();
+                continue;
+            }
+
+            reqs.push_back(req_res.req);
+            ress.push_back(req_res.res);
+        }
+
+        if(!reqs.empty()) {
+            // update thread local for reference during a crash
+            write_log_index = reqs[0]->log_index;
+
+            // the adds share a single span, in the trace of the first one
+            trace_span_t index_span("indexer.index", reqs[0]->trace_context);
+            index_span.set_attribute("collection", queued_reqs[0].coll_name);
+            index_span.set_attribute("coalesced_adds", int64_t(reqs.size()));
+
+            try {
+                post_add_documents(reqs, ress);
+            } catch(const std::exception& e) {
+                LOG(ERROR) << "Exception while adding a batch of " << reqs.size() << " documents.";
+                LOG(ERROR) << "Raw error: " << e.what();
+
+                for(auto& res: ress) {
+                    res->set_400("Bad request.");
+                }
+            }
+        }
+    }
+
+    for(size_t i = 0; i < reqs.size(); i++) {
+        if(ress[i]->is_alive) {
+            async_req_res_t* async_req_res = new async_req_res_t(reqs[i], ress[i], true);
+            server->get_message_dispatcher()->send_message(HttpServer::STREAM_RESPONSE_MESSAGE, async_req_res);
+        }
+    }
+
+    for(const auto& queued_req: queued_reqs) {
+        const std::string& req_key_prefix = get_req_prefix_key(queued_req.req_id);
+        store->delete_range(req_key_prefix, req_key_prefix + StringUtils::serialize_uint32_t(UINT32_MAX));
+
+        {
+            std::unique_lock lk(mutex);
+            req_res_map.erase(queued_req.req_id);
+        }
+
+        finish_epoch(queued_req);
+    }
+}
+
 std::string BatchedIndexer::get_req_prefix_key(uint64_t req_id) {
     const std::string& req_key_prefix =
             RAFT_REQ_LOG_PREFIX + StringUtils::serialize_uint64_t(req_id) + "_";
@@ -312,6 +553,23 @@ int64_t BatchedIndexer::get_queued_writes() {
     return queued_writes;
 }
 
+void BatchedIndexer::get_queued_writes_by_collection(std::map<std::string, size_t>& coll_queued_writes) {
+    std::unique_lock lk(epochs_mutex);
+
+    for(const auto& coll_epochs_it: coll_epochs) {
+        size_t num_pending = 0;
+        for(const auto& epoch_pending: coll_epochs_it.second.num_pending) {
+            num_pending += epoch_pending.second;
+        }
+
+        coll_queued_writes[coll_epochs_it.first] = num_pending;
+    }
+}
+
+Store* BatchedIndexer::get_meta_store() const {
+    return meta_store;
+}
+
 void BatchedIndexer::populate_skip_index() {
     if(skip_index_iter->Valid() && skip_index_iter->key().starts_with(SKIP_INDICES_PREFIX)) {
         const std::string& index_value = skip_index_iter->value().ToString();
@@ -362,7 +620,7 @@ void BatchedIndexer::load_state(const nlohmann::json& state) {
     queued_writes = state["queued_writes"].get<int64_t>();
 
     size_t num_reqs_restored = 0;
-    std::set<uint64_t> queue_ids;
+    std::vector<std::shared_ptr<http_req>> complete_reqs;
 
     for(auto& kv: state["req_res_map"].items()) {
         std::shared_ptr<http_req> req = std::make_shared<http_req>();
@@ -388,21 +646,21 @@ void BatchedIndexer::load_state(const nlohmann::json& state) {
             LOG(INFO) << "req_res.start_ts: " <<  req_res.start_ts
                       << ", req_res.next_chunk_index: " << req_res.next_chunk_index;
 
-            const std::string& coll_name = get_collection_name(req);
-            uint64_t queue_id = StringUtils::hash_wy(coll_name.c_str(), coll_name.size()) % num_threads;
-            queue_ids.insert(queue_id);
-            std::unique_lock qlk(qmutuxes[queue_id].mcv);
-            queues[queue_id].emplace_back(req->start_ts);
+            complete_reqs.push_back(req);
         }
 
         num_reqs_restored++;
     }
 
-    // need to sort on `start_ts` to preserve original order before notifying queues
-    for(auto queue_id: queue_ids) {
-        std::unique_lock lk(qmutuxes[queue_id].mcv);
-        std::sort(queues[queue_id].begin(), queues[queue_id].end());
-        qmutuxes[queue_id].cv.notify_one();
+    // need to queue in `start_ts` order to preserve the original order of writes
+    std::sort(complete_reqs.begin(), complete_reqs.end(),
+              [](const std::shared_ptr<http_req>& a, const std::shared_ptr<http_req>& b) {
+                  return a->start_ts < b->start_ts;
+              });
+
+    // restored requests are applied one at a time
+    for(const auto& req: complete_reqs) {
+        queue_req(req->start_ts, get_collection_name(req), get_doc_id(req), get_add_batch_key(req, false));
     }
 
     LOG(INFO) << "Restored " << num_reqs_restored << " in-flight requests from snapshot.";
@@ -0,0 +1,72 @@
+#include "bigram_filter.h"
+#include "wyhash_v5.h"
+
+uint64_t bigram_filter_t::pair_hash(const std::string& first, const std::string& second) {
+    // seeding the hash of the second token with the first keeps "ab c" apart from "a bc"
+    const uint64_t first_hash = wyhash(first.data(), first.size(), 0, _wyp);
+    return wyhash(second.data(), second.size(), first_hash, _wyp);
+}
+
+uint64_t bigram_filter_t::word_mask(uint64_t pair_hash) {
+    // the pair hash picks the word, a hash of it the bits within the word
+    const uint64_t bit_hash = wyhash64(pair_hash, pair_hash >> 32);
+    uint64_t mask = 0;
+
+    for(size_t i = 0; i < NUM_PROBES; i++) {
+        mask |= uint64_t(1) << ((bit_hash >> (i * 6)) & 63);
+    }
+
+    return mask;
+}
+
+void bigram_filter_t::add(uint64_t pair_hash) {
+    if(may_contain(pair_hash)) {
+        // not counting pairs twice keeps the filters from growing with repeated pairs
+        return;
+    }
+
+    if(filters.empty() || filters.back().num_pairs >= filters.back().capacity) {
+        const size_t capacity = filters.empty() ? FIRST_CAPACITY : filters.back().capacity * 2;
+        filters.emplace_back(capacity);
+    }
+
+    filter_t& filter = filters.back();
+    filter.words[pair_hash % filter.words.size()] |= word_mask(pair_hash);
+    filter.num_pairs++;
+}
+
+bool bigram_filter_t::may_contain(uint64_t pair_hash) const {
+    if(filters.empty()) {
+        return false;
+    }
+
+    const uint64_t mask = word_mask(pair_hash);
+
+    for(const filter_t& filter: filters) {
+        if((filter.words[pair_hash % filter.words.size()] & mask) == mask) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t bigram_filter_t::num_pairs() const {
+    size_t num_pairs = 0;
+
+    for(const filter_t& filter: filters) {
+        num_pairs += filter.num_pairs;
+    }
+
+    return num_pairs;
+}
+
+size_t bigram_filter_t::memory_bytes() const {
+    size_t bytes = sizeof(*this) + filters.capacity() * sizeof(filter_t);
+
+    for(const filter_t& filter: filters) {
+        bytes += filter.words.capacity() * sizeof(uint64_t);
+    }
+
+    return bytes;
+}
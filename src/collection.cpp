@@ -1,7 +1,9 @@
 #include "collection.h"
 
 #include <numeric>
+#include <cmath>
 #include <chrono>
+#include <cstdio>
 #include <array_utils.h>
 #include <match_score.h>
 #include <string_utils.h>
@@ -12,10 +14,15 @@
 #include <collection_manager.h>
 #include <regex>
 #include <list>
+#include <fstream>
+#include <optional>
+#include <unordered_set>
 #include <posting.h>
 #include "topster.h"
 #include "logger.h"
 #include "thread_local_vars.h"
+#include "search_profile.h"
+#include "collection_dump.h"
 
 const std::string override_t::MATCH_EXACT = "exact";
 const std::string override_t::MATCH_CONTAINS = "contains";
@@ -38,20 +45,38 @@ struct match_index_t {
     }
 };
 
+std::atomic<uint64_t> Collection::next_write_generation{0};
+
 Collection::Collection(const std::string& name, const uint32_t collection_id, const uint64_t created_at,
                        const uint32_t next_seq_id, Store *store, const std::vector<field> &fields,
                        const std::string& default_sorting_field,
                        const float max_memory_ratio, const std::string& fallback_field_type,
-                       const std::vector<std::string>& symbols_to_index, const std::vector<std::string>& token_separators):
+                       const std::vector<std::string>& symbols_to_index, const std::vector<std::string>& token_separators,
+                       const posting_codec_t posting_codec, const std::string& ttl_field,
+                       const document_encoding_t document_encoding,
+                       const std::vector<std::string>& summary_fields, const size_t num_memory_shards,
+                       const uint64_t memory_quota_bytes):
         name(name), collection_id(collection_id), created_at(created_at),
         next_seq_id(next_seq_id), store(store),
         fields(fields), default_sorting_field(default_sorting_field),
         max_memory_ratio(max_memory_ratio),
         fallback_field_type(fallback_field_type), dynamic_fields({}),
         symbols_to_index(to_char_array(symbols_to_index)), token_separators(to_char_array(token_separators)),
-        index(init_index()) {
+        posting_codec(posting_codec), ttl_field(ttl_field), document_codec(document_encoding),
+        summary_fields(summary_fields), num_memory_shards(std::min(std::max<size_t>(1, num_memory_shards), MAX_NUM_MEMORY_SHARDS)),
+        index(init_index()), memory_quota_bytes(memory_quota_bytes),
+        document_cache(DOCUMENT_CACHE_CAPACITY), parsed_filter_cache(PARSED_FILTER_CACHE_CAPACITY) {
 
     this->num_documents = 0;
+    this->last_used_s = static_cast<uint64_t>(std::time(nullptr));
+    bump_write_generation();
+
+    std::string document_keys;
+    if(document_encoding == COMPACT_ENCODING && store->get(get_document_keys_key(), document_keys) == FOUND) {
+        if(!document_codec.load_keys(document_keys)) {
+            LOG(ERROR) << "Could not parse the document keys of collection " << name;
+        }
+    }
 }
 
 Collection::~Collection() {
@@ -66,6 +91,10 @@ uint32_t Collection::get_next_seq_id() {
     return next_seq_id++;
 }
 
+uint32_t Collection::peek_next_seq_id() const {
+    return next_seq_id;
+}
+
 Option<doc_seq_id_t> Collection::to_doc(const std::string & json_str, nlohmann::json& document,
                                         const index_operation_t& operation,
                                         const DIRTY_VALUES dirty_values,
@@ -77,24 +106,47 @@ Option<doc_seq_id_t> Collection::to_doc(const std::string & json_str, nlohmann::
         return Option<doc_seq_id_t>(400, std::string("Bad JSON: ") + e.what());
     }
 
+    return get_doc_seq_id(document, operation, id);
+}
+
+std::vector<Collection::parsed_line_t> Collection::parse_lines(const std::vector<std::string>& json_lines,
+                                                               size_t start, size_t end) {
+    std::vector<parsed_line_t> parsed_lines(end - start);
+
+    for(size_t i = start; i < end; i++) {
+        try {
+            parsed_lines[i - start].document = nlohmann::json::parse(json_lines[i]);
+        } catch(const std::exception& e) {
+            LOG(ERROR) << "JSON error: " << e.what();
+            parsed_lines[i - start].parse_error = std::string("Bad JSON: ") + e.what();
+        }
+    }
+
+    return parsed_lines;
+}
+
+Option<doc_seq_id_t> Collection::get_doc_seq_id(nlohmann::json& document, const index_operation_t& operation,
+                                                const std::string& id) {
     if(!document.is_object()) {
         return Option<doc_seq_id_t>(400, "Bad JSON: not a properly formed document.");
     }
 
-    if(document.count("id") != 0 && id != "" && document["id"] != id) {
+    auto id_it = document.find("id");
+
+    if(id_it != document.end() && id != "" && *id_it != id) {
         return Option<doc_seq_id_t>(400, "The `id` of the resource does not match the `id` in the JSON body.");
     }
 
-    if(document.count("id") == 0 && !id.empty()) {
+    if(id_it == document.end() && !id.empty()) {
         // use the explicit ID (usually from a PUT request) if document body does not have it
-        document["id"] = id;
+        id_it = document.emplace("id", id).first;
     }
 
-    if(document.count("id") != 0 && document["id"] == "") {
+    if(id_it != document.end() && *id_it == "") {
         return Option<doc_seq_id_t>(400, "The `id` should not be empty.");
     }
 
-    if(document.count("id") == 0) {
+    if(id_it == document.end()) {
         if(operation == UPDATE) {
             return Option<doc_seq_id_t>(400, "For update, the `id` key must be provided.");
         }
@@ -103,11 +155,11 @@ Option<doc_seq_id_t> Collection::to_doc(const std::string & json_str, nlohmann::
         document["id"] = std::to_string(seq_id);
         return Option<doc_seq_id_t>(doc_seq_id_t{seq_id, true});
     } else {
-        if(!document["id"].is_string()) {
+        if(!id_it->is_string()) {
             return Option<doc_seq_id_t>(400, "Document's `id` field should be a string.");
         }
 
-        const std::string& doc_id = document["id"];
+        const std::string& doc_id = id_it->get_ref<const std::string&>();
 
         // try to get the corresponding sequence id from disk if present
         std::string seq_id_str;
@@ -147,6 +199,25 @@ nlohmann::json Collection::get_summary_json() const {
     json_response["name"] = name;
     json_response["num_documents"] = num_documents.load();
     json_response["created_at"] = created_at.load();
+    json_response["posting_codec"] = PostingCodec::name(posting_codec);
+    json_response[COLLECTION_NUM_MEMORY_SHARDS] = num_memory_shards;
+
+    if(!ttl_field.empty()) {
+        json_response["ttl_field"] = ttl_field;
+    }
+
+    if(document_codec.get_encoding() != JSON_ENCODING) {
+        json_response[COLLECTION_DOCUMENT_ENCODING] = document_codec_t::name(document_codec.get_encoding());
+    }
+
+    if(!summary_fields.empty()) {
+        json_response[COLLECTION_SUMMARY_FIELDS] = summary_fields;
+    }
+
+    if(memory_quota_bytes != 0) {
+        json_response[COLLECTION_MEMORY_QUOTA_BYTES] = memory_quota_bytes;
+    }
+
     json_response["token_separators"] = nlohmann::json::array();
     json_response["symbols_to_index"] = nlohmann::json::array();
 
@@ -171,6 +242,14 @@ nlohmann::json Collection::get_summary_json() const {
         field_json[fields::infix] = coll_field.infix;
         field_json[fields::locale] = coll_field.locale;
 
+        if(coll_field.is_vector()) {
+            field_json[fields::num_dim] = coll_field.num_dim;
+            field_json[fields::vec_dist] = vector_index_t::get_distance_type_name(coll_field.vec_dist);
+            if(coll_field.vec_int8) {
+                field_json[fields::vec_quantization] = "int8";
+            }
+        }
+
         fields_arr.push_back(field_json);
     }
 
@@ -204,23 +283,74 @@ Option<nlohmann::json> Collection::add(const std::string & json_str,
 
 nlohmann::json Collection::add_many(std::vector<std::string>& json_lines, nlohmann::json& document,
                                     const index_operation_t& operation, const std::string& id,
-                                    const DIRTY_VALUES& dirty_values, const bool& write_docs, const bool& write_id) {
+                                    const DIRTY_VALUES& dirty_values, const bool& write_docs, const bool& write_id,
+                                    const bool& bulk_load) {
+    trace_span_t add_span("collection.add_many");
+    add_span.set_attribute("collection", name);
+    add_span.set_attribute("lines", int64_t(json_lines.size()));
+
     //LOG(INFO) << "Memory ratio. Max = " << max_memory_ratio << ", Used = " << SystemMetrics::used_memory_ratio();
     std::vector<index_record> index_records;
 
-    const size_t index_batch_size = 1000;
+    // a bulk load ingests the new documents of each batch as table files of their own, which are better larger
+    const size_t index_batch_size = bulk_load ? 10000 : 1000;
     size_t num_indexed = 0;
     //bool exceeds_memory_limit = false;
 
     // ensures that document IDs are not repeated within the same batch
     std::set<std::string> batch_doc_ids;
 
+    // Lines are parsed a window of `index_batch_size` at a time, and the next window is parsed on the thread pool
+    // while the current one gets indexed and written. Batches are flushed in order, since a line can refer to a
+    // document written by an earlier batch.
+    ThreadPool* thread_pool = CollectionManager::get_instance().get_thread_pool();
+    const bool parse_ahead = (thread_pool != nullptr && json_lines.size() > index_batch_size);
+
+    std::vector<parsed_line_t> parsed_lines;
+    std::future<std::vector<parsed_line_t>> next_parsed_lines;
+    size_t parsed_window = 0;
+
+    auto enqueue_parse = [&](size_t window) {
+        const size_t window_start = window * index_batch_size;
+        const size_t window_end = std::min(window_start + index_batch_size, json_lines.size());
+
+        if(window_start < json_lines.size()) {
+            // lines of later windows are never written to until their own batch is indexed
+            next_parsed_lines = thread_pool->enqueue_task(task_priority_t::BACKGROUND, task_kind_t::INDEXING,
+                [&json_lines, window_start, window_end]() {
+                    return parse_lines(json_lines, window_start, window_end);
+                });
+        }
+    };
+
+    auto parsed_to_doc = [&](size_t line_index) {
+        if(line_index / index_batch_size != parsed_window) {
+            parsed_window = line_index / index_batch_size;
+            parsed_lines = next_parsed_lines.get();
+            enqueue_parse(parsed_window + 1);
+        }
+
+        parsed_line_t& parsed_line = parsed_lines[line_index % index_batch_size];
+        if(!parsed_line.parse_error.empty()) {
+            return Option<doc_seq_id_t>(400, parsed_line.parse_error);
+        }
+
+        document = std::move(parsed_line.document);
+        return get_doc_seq_id(document, operation, id);
+    };
+
+    if(parse_ahead) {
+        parsed_lines = parse_lines(json_lines, 0, index_batch_size);
+        enqueue_parse(1);
+    }
+
     for(size_t i=0; i < json_lines.size(); i++) {
         const std::string & json_line = json_lines[i];
-        Option<doc_seq_id_t> doc_seq_id_op = to_doc(json_line, document, operation, dirty_values, id);
+        Option<doc_seq_id_t> doc_seq_id_op = parse_ahead ? parsed_to_doc(i) :
+                                             to_doc(json_line, document, operation, dirty_values, id);
 
         const uint32_t seq_id = doc_seq_id_op.ok() ? doc_seq_id_op.get().seq_id : 0;
-        index_record record(i, seq_id, document, operation, dirty_values);
+        index_record record(i, seq_id, std::move(document), operation, dirty_values);
 
         // NOTE: we overwrite the input json_lines with result to avoid memory pressure
 
@@ -235,6 +365,11 @@ nlohmann::json Collection::add_many(std::vector<std::string>& json_lines, nlohma
 
             if(repeated_doc) {
                 // when a document repeats, we send the batch until this document so that we can deal with conflicts
+                if(parse_ahead) {
+                    // the line is processed again after the batch, so it gets its document back
+                    parsed_lines[i % index_batch_size].document = std::move(record.doc);
+                }
+
                 i--;
                 goto do_batched_index;
             }
@@ -281,7 +416,7 @@ nlohmann::json Collection::add_many(std::vector<std::string>& json_lines, nlohma
         do_batched_index:
 
         if((i+1) % index_batch_size == 0 || i == json_lines.size()-1 || repeated_doc) {
-            batch_index(index_records, json_lines, num_indexed, write_docs, write_id);
+            batch_index(index_records, json_lines, num_indexed, write_docs, write_id, bulk_load);
 
             // to return the document for the single doc add cases
             if(index_records.size() == 1) {
@@ -293,6 +428,8 @@ nlohmann::json Collection::add_many(std::vector<std::string>& json_lines, nlohma
         }
     }
 
+    update_memory_estimate();
+
     nlohmann::json resp_summary;
     resp_summary["num_imported"] = num_indexed;
     resp_summary["success"] = (num_indexed == json_lines.size());
@@ -305,18 +442,71 @@ bool Collection::is_exceeding_memory_threshold() const {
 }
 
 void Collection::batch_index(std::vector<index_record>& index_records, std::vector<std::string>& json_out,
-                             size_t &num_indexed, const bool& write_docs, const bool& write_id) {
+                             size_t &num_indexed, const bool& write_docs, const bool& write_id,
+                             const bool& bulk_load) {
+    trace_span_t batch_span("collection.batch_index");
+    batch_span.set_attribute("records", int64_t(index_records.size()));
+
+    std::shared_lock write_lock(pending_write_mutex);
 
     batch_index_in_memory(index_records);
 
-    // store only documents that were indexed in-memory successfully
-    for(auto& index_record: index_records) {
+    auto write_result = [&](index_record& index_record) {
         nlohmann::json res;
 
+        if(index_record.indexed.ok()) {
+            res["success"] = true;
+
+            if(write_docs) {
+                res["document"] = index_record.is_update ? index_record.new_doc : index_record.doc;
+            }
+            if(write_id) {
+                res["id"] = index_record.is_update ? index_record.new_doc["id"] : index_record.doc["id"];
+            }
+        } else {
+            res["success"] = false;
+            res["document"] = json_out[index_record.position];
+            res["error"] = index_record.indexed.error();
+            res["code"] = index_record.indexed.code();
+        }
+
+        json_out[index_record.position] = res.dump(-1, ' ', false,
+                                                   nlohmann::detail::error_handler_t::ignore);
+    };
+
+    // new documents of a bulk load, written to the store together once the batch is through
+    std::vector<std::pair<std::string, std::string>> ingest_kvs;
+    std::vector<size_t> ingest_record_indices;
+
+    // store only documents that were indexed in-memory successfully
+    for(size_t record_index = 0; record_index < index_records.size(); record_index++) {
+        auto& index_record = index_records[record_index];
+
         if(index_record.indexed.ok()) {
             if(index_record.is_update) {
-                const std::string& serialized_json = index_record.new_doc.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
-                bool write_ok = store->insert(get_seq_id_key(index_record.seq_id), serialized_json);
+                bool write_ok;
+
+                if(index_record.operation != UPSERT && index_record.old_doc.is_object() &&
+                   document_codec.get_encoding() == JSON_ENCODING) {
+                    // only the fields that changed are written, and get merged into the stored document on read
+                    const nlohmann::json& patch = get_doc_patch(index_record.old_doc, index_record.new_doc);
+                    write_ok = patch.empty() ||
+                               store->merge_patch(get_seq_id_key(index_record.seq_id),
+                                                  patch.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore));
+                } else {
+                    // compact documents cannot be patched by the store, which does not know their keys
+                    std::string serialized_doc;
+                    write_ok = encode_document(index_record.new_doc, serialized_doc) &&
+                               store->insert(get_seq_id_key(index_record.seq_id), serialized_doc);
+                }
+
+                if(write_ok && !summary_fields.empty()) {
+                    std::string serialized_summary;
+                    write_ok = encode_document(get_document_summary(index_record.new_doc), serialized_summary) &&
+                               store->insert(get_summary_key(index_record.seq_id), serialized_summary);
+                }
+
+                invalidate_cached_document(index_record.seq_id);
 
                 if(!write_ok) {
                     // we will attempt to reindex the old doc on a best-effort basis
@@ -331,13 +521,33 @@ void Collection::batch_index(std::vector<index_record>& index_records, std::vect
 
             } else {
                 const std::string& seq_id_str = std::to_string(index_record.seq_id);
-                const std::string& serialized_json = index_record.doc.dump(-1, ' ', false,
-                                                                           nlohmann::detail::error_handler_t::ignore);
+                std::string serialized_doc, serialized_summary;
+                bool write_ok = encode_document(index_record.doc, serialized_doc) &&
+                                (summary_fields.empty() ||
+                                 encode_document(get_document_summary(index_record.doc), serialized_summary));
+
+                if(write_ok && bulk_load) {
+                    ingest_kvs.emplace_back(get_doc_id_key(index_record.doc["id"]), seq_id_str);
+                    ingest_kvs.emplace_back(get_seq_id_key(index_record.seq_id), std::move(serialized_doc));
+                    if(!summary_fields.empty()) {
+                        ingest_kvs.emplace_back(get_summary_key(index_record.seq_id), std::move(serialized_summary));
+                    }
+
+                    ingest_record_indices.push_back(record_index);
+                    continue;
+                }
+
+                if(write_ok) {
+                    rocksdb::WriteBatch batch;
+                    batch.Put(get_doc_id_key(index_record.doc["id"]), seq_id_str);
+                    batch.Put(get_seq_id_key(index_record.seq_id), serialized_doc);
+                    if(!summary_fields.empty()) {
+                        batch.Put(get_summary_key(index_record.seq_id), serialized_summary);
+                    }
+                    write_ok = store->batch_write(batch);
+                }
 
-                rocksdb::WriteBatch batch;
-                batch.Put(get_doc_id_key(index_record.doc["id"]), seq_id_str);
-                batch.Put(get_seq_id_key(index_record.seq_id), serialized_json);
-                bool write_ok = store->batch_write(batch);
+                invalidate_cached_document(index_record.seq_id);
 
                 if(!write_ok) {
                     // remove from in-memory store to keep the state synced
@@ -349,28 +559,30 @@ void Collection::batch_index(std::vector<index_record>& index_records, std::vect
                     index_record.index_success();
                 }
             }
-            res["success"] = index_record.indexed.ok();
+        }
 
-            if (write_docs & index_record.indexed.ok()) {
-                res["document"] = index_record.is_update ? index_record.new_doc : index_record.doc;
-            }
-            if (write_id & index_record.indexed.ok()) {
-                res["id"] = index_record.is_update ? index_record.new_doc["id"] : index_record.doc["id"];
-            }
-            if(!index_record.indexed.ok()) {
-                res["document"] = json_out[index_record.position];
-                res["error"] = index_record.indexed.error();
-                res["code"] = index_record.indexed.code();
-            }
+        write_result(index_record);
+    }
+
+    if(ingest_record_indices.empty()) {
+        return ;
+    }
+
+    const bool ingested = store->ingest(ingest_kvs);
+
+    for(size_t record_index: ingest_record_indices) {
+        auto& index_record = index_records[record_index];
+        invalidate_cached_document(index_record.seq_id);
+
+        if(!ingested) {
+            remove_document(index_record.doc, index_record.seq_id, false);
+            index_record.index_failure(500, "Could not write to on-disk storage.");
         } else {
-            res["success"] = false;
-            res["document"] = json_out[index_record.position];
-            res["error"] = index_record.indexed.error();
-            res["code"] = index_record.indexed.code();
+            num_indexed++;
+            index_record.index_success();
         }
 
-        json_out[index_record.position] = res.dump(-1, ' ', false,
-                                                   nlohmann::detail::error_handler_t::ignore);
+        write_result(index_record);
     }
 }
 
@@ -393,16 +605,41 @@ Option<uint32_t> Collection::index_in_memory(nlohmann::json &document, uint32_t
     Index::batch_memory_index(index, index_batch, default_sorting_field, search_schema,
                               fallback_field_type, token_separators, symbols_to_index, true);
 
+    track_alter_write(seq_id, document);
     num_documents += 1;
+    bump_write_generation();
     return Option<>(200);
 }
 
 size_t Collection::batch_index_in_memory(std::vector<index_record>& index_records) {
+    // The batched indexer runs writes to distinct document ids of a collection concurrently, but a field that
+    // they add is already in the schema of the batch that holds it, so a schema that grows between the phases
+    // does not affect the batch: searches are only blocked while the preprocessed batch is applied to the index.
+    batch_preprocess_in_memory(index_records);
+    return batch_index_preprocessed_in_memory(index_records);
+}
+
+void Collection::batch_preprocess_in_memory(std::vector<index_record>& index_records) {
+    numa_node_scope_t numa_scope(get_numa_node());
+    std::shared_lock lock(mutex);
+    Index::batch_preprocess(index, index_records, default_sorting_field, search_schema, fallback_field_type,
+                            token_separators, symbols_to_index, true);
+}
+
+size_t Collection::batch_index_preprocessed_in_memory(std::vector<index_record>& index_records) {
+    // the memory of the index is first touched by the workers of the node that its searches run on
+    numa_node_scope_t numa_scope(get_numa_node());
     std::unique_lock lock(mutex);
-    size_t num_indexed = Index::batch_memory_index(index, index_records, default_sorting_field,
-                                                   search_schema, fallback_field_type,
-                                                   token_separators, symbols_to_index, true);
+    size_t num_indexed = Index::batch_memory_index_preprocessed(index, index_records, search_schema);
+
+    for(const auto& index_record: index_records) {
+        if(index_record.indexed.ok()) {
+            track_alter_write(index_record.seq_id, index_record.is_update ? index_record.new_doc : index_record.doc);
+        }
+    }
+
     num_documents += num_indexed;
+    bump_write_generation();
     return num_indexed;
 }
 
@@ -424,93 +661,117 @@ void Collection::curate_results(string& actual_query, bool enable_overrides, boo
                                 const std::vector<std::string>& hidden_hits,
                                 std::vector<std::pair<uint32_t, uint32_t>>& included_ids,
                                 std::vector<uint32_t>& excluded_ids,
-                                std::vector<const override_t*>& filter_overrides,
                                 bool& filter_curated_hits,
                                 std::string& curated_sort_by) const {
 
-    std::set<uint32_t> excluded_set;
+    std::string query = actual_query;
+    std::vector<const override_t*> matched_overrides;
 
-    // If pinned or hidden hits are provided, they take precedence over overrides
+    if(enable_overrides && !overrides.empty()) {
+        StringUtils::tolowercase(query);
 
-    // have to ensure that hidden hits take precedence over included hits
-    if(!hidden_hits.empty()) {
-        for(const auto & hit: hidden_hits) {
-            Option<uint32_t> seq_id_op = doc_id_to_seq_id(hit);
-            if(seq_id_op.ok()) {
-                excluded_ids.push_back(seq_id_op.get());
-                excluded_set.insert(seq_id_op.get());
+        // ID-based overrides are applied first as they take precedence over filter-based overrides, which are
+        // matched once the query is tokenized
+        std::vector<std::string> matched_ids;
+        curation_override_index.match(query, matched_ids);
+        size_t match_index = 0;
+
+        while(match_index < matched_ids.size()) {
+            const auto& override = overrides.at(matched_ids[match_index]);
+            matched_overrides.push_back(&override);
+            match_index++;
+
+            if(override.remove_matched_tokens) {
+                StringUtils::replace_all(query, override.rule.query, "");
+                StringUtils::trim(query);
+                if(query.empty()) {
+                    query = "*";
+                }
+
+                actual_query = query;
+
+                // the overrides that follow are matched against what remains of the query
+                curation_override_index.match(query, matched_ids);
+                match_index = std::upper_bound(matched_ids.begin(), matched_ids.end(), override.id) -
+                              matched_ids.begin();
             }
+
+            filter_curated_hits = override.filter_curated_hits;
+            curated_sort_by = override.sort_by;
         }
     }
 
-    std::string query = actual_query;
+    // all the doc ids curated are resolved in a single lookup of the store
+    std::vector<std::string> doc_ids(hidden_hits.begin(), hidden_hits.end());
 
-    if(enable_overrides && !overrides.empty()) {
-        StringUtils::tolowercase(query);
+    for(const override_t* override: matched_overrides) {
+        for(const auto& hit: override->drop_hits) {
+            doc_ids.push_back(hit.doc_id);
+        }
 
-        for(const auto& override_kv: overrides) {
-            const auto& override = override_kv.second;
+        for(const auto& hit: override->add_hits) {
+            doc_ids.push_back(hit.doc_id);
+        }
+    }
 
-            // ID-based overrides are applied first as they take precedence over filter-based overrides
-            if(!override.filter_by.empty()) {
-                filter_overrides.push_back(&override);
-                continue;
-            }
+    for(const auto& pos_ids: pinned_hits) {
+        doc_ids.insert(doc_ids.end(), pos_ids.second.begin(), pos_ids.second.end());
+    }
 
-            if ((override.rule.match == override_t::MATCH_EXACT && override.rule.query == query) ||
-                (override.rule.match == override_t::MATCH_CONTAINS &&
-                 StringUtils::contains_word(query, override.rule.query))) {
+    if(doc_ids.empty()) {
+        return ;
+    }
 
-                // have to ensure that dropped hits take precedence over added hits
-                for(const auto & hit: override.drop_hits) {
-                    Option<uint32_t> seq_id_op = doc_id_to_seq_id(hit.doc_id);
-                    if(seq_id_op.ok()) {
-                        excluded_ids.push_back(seq_id_op.get());
-                        excluded_set.insert(seq_id_op.get());
-                    }
-                }
+    std::unordered_map<std::string, uint32_t> doc_seq_ids;
+    doc_ids_to_seq_ids(doc_ids, doc_seq_ids);
 
-                for(const auto & hit: override.add_hits) {
-                    Option<uint32_t> seq_id_op = doc_id_to_seq_id(hit.doc_id);
-                    if(!seq_id_op.ok()) {
-                        continue;
-                    }
-                    uint32_t seq_id = seq_id_op.get();
-                    bool excluded = (excluded_set.count(seq_id) != 0);
-                    if(!excluded) {
-                        included_ids.emplace_back(seq_id, hit.position);
-                    }
-                }
+    std::set<uint32_t> excluded_set;
 
-                if(override.remove_matched_tokens) {
-                    StringUtils::replace_all(query, override.rule.query, "");
-                    StringUtils::trim(query);
-                    if(query.empty()) {
-                        query = "*";
-                    }
+    // If pinned or hidden hits are provided, they take precedence over overrides
 
-                    actual_query = query;
-                }
+    // have to ensure that hidden hits take precedence over included hits
+    for(const auto & hit: hidden_hits) {
+        auto seq_id_it = doc_seq_ids.find(hit);
+        if(seq_id_it != doc_seq_ids.end()) {
+            excluded_ids.push_back(seq_id_it->second);
+            excluded_set.insert(seq_id_it->second);
+        }
+    }
 
-                filter_curated_hits = override.filter_curated_hits;
-                curated_sort_by = override.sort_by;
+    for(const override_t* override: matched_overrides) {
+        // have to ensure that dropped hits take precedence over added hits
+        for(const auto & hit: override->drop_hits) {
+            auto seq_id_it = doc_seq_ids.find(hit.doc_id);
+            if(seq_id_it != doc_seq_ids.end()) {
+                excluded_ids.push_back(seq_id_it->second);
+                excluded_set.insert(seq_id_it->second);
+            }
+        }
+
+        for(const auto & hit: override->add_hits) {
+            auto seq_id_it = doc_seq_ids.find(hit.doc_id);
+            if(seq_id_it == doc_seq_ids.end()) {
+                continue;
+            }
+            uint32_t seq_id = seq_id_it->second;
+            bool excluded = (excluded_set.count(seq_id) != 0);
+            if(!excluded) {
+                included_ids.emplace_back(seq_id, hit.position);
             }
         }
     }
 
-    if(!pinned_hits.empty()) {
-        for(const auto& pos_ids: pinned_hits) {
-            size_t pos = pos_ids.first;
-            for(const std::string& id: pos_ids.second) {
-                Option<uint32_t> seq_id_op = doc_id_to_seq_id(id);
-                if(!seq_id_op.ok()) {
-                    continue;
-                }
-                uint32_t seq_id = seq_id_op.get();
-                bool excluded = (excluded_set.count(seq_id) != 0);
-                if(!excluded) {
-                    included_ids.emplace_back(seq_id, pos);
-                }
+    for(const auto& pos_ids: pinned_hits) {
+        size_t pos = pos_ids.first;
+        for(const std::string& id: pos_ids.second) {
+            auto seq_id_it = doc_seq_ids.find(id);
+            if(seq_id_it == doc_seq_ids.end()) {
+                continue;
+            }
+            uint32_t seq_id = seq_id_it->second;
+            bool excluded = (excluded_set.count(seq_id) != 0);
+            if(!excluded) {
+                included_ids.emplace_back(seq_id, pos);
             }
         }
     }
@@ -758,14 +1019,38 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
                                   const size_t max_extra_suffix,
                                   const size_t facet_query_num_typos,
                                   const size_t filter_curated_hits_option,
-                                  const bool prioritize_token_position) const {
-
+                                  const bool prioritize_token_position,
+                                  const bool enable_top_k_pruning,
+                                  const bool explain,
+                                  const std::atomic<bool>* req_disposed,
+                                  const std::string& search_after_str,
+                                  const size_t facet_sample_percent,
+                                  const size_t facet_sample_threshold,
+                                  const std::string& vector_query_str,
+                                  const bool profile,
+                                  const bool exhaustive_found,
+                                  const size_t latency_budget_ms) const {
+
+    trace_span_t search_span("collection.search");
+    search_span.set_attribute("collection", name);
+
+    numa_node_scope_t numa_scope(get_numa_node());
     std::shared_lock lock(mutex);
 
     // setup thread local vars
     search_stop_ms = search_stop_millis;
     search_begin = std::chrono::high_resolution_clock::now();
     search_cutoff = false;
+    search_budget_ms = latency_budget_ms;
+    search_degradations = 0;
+
+    if(latency_budget_ms != 0) {
+        // the stages of the search give up on their costliest options well before the end of the budget, which
+        // only cuts off a search that is still running by then
+        search_stop_ms = std::min<int64_t>(search_stop_ms, latency_budget_ms);
+    }
+    search_cancel_token = nullptr;
+    search_profile = nullptr;
 
     if(raw_query != "*" && search_fields.empty()) {
         return Option<nlohmann::json>(400, "No search fields specified for the query.");
@@ -866,16 +1151,27 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
         }
     }
 
-    const std::string doc_id_prefix = std::to_string(collection_id) + "_" + DOC_ID_PREFIX + "_";
     std::vector<filter> filters;
-    Option<bool> parse_filter_op = filter::parse_filter_query(simple_filter_query, search_schema,
-                                                              store, doc_id_prefix, filters);
+    Option<bool> parse_filter_op = parse_filter_query(simple_filter_query, filters);
     if(!parse_filter_op.ok()) {
         return Option<nlohmann::json>(parse_filter_op.code(), parse_filter_op.error());
     }
 
     // validate facet fields
     for(const std::string & field_name: facet_fields) {
+        if(field_name.find('(') != std::string::npos) {
+            if(!group_by_fields.empty()) {
+                return Option<nlohmann::json>(400, "Range facets are not supported along with `group_by`.");
+            }
+
+            auto range_facet_op = parse_range_facet(field_name, facets);
+            if(!range_facet_op.ok()) {
+                return Option<nlohmann::json>(range_facet_op.code(), range_facet_op.error());
+            }
+
+            continue;
+        }
+
         if(search_schema.count(field_name) == 0 || !search_schema.at(field_name).facet) {
             std::string error = "Could not find a facet field named `" + field_name + "` in the schema.";
             return Option<nlohmann::json>(404, error);
@@ -941,15 +1237,72 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
         return Option<nlohmann::json>(422, message);
     }
 
+    if(facet_sample_percent == 0 || facet_sample_percent > 100) {
+        return Option<nlohmann::json>(400, "Parameter `facet_sample_percent` must be between 1 and 100.");
+    }
+
+    KV search_after;
+    const bool has_search_after = !search_after_str.empty();
+
+    if(has_search_after) {
+        if(page != 1) {
+            return Option<nlohmann::json>(400, "Parameter `page` can't be used along with `search_after`.");
+        }
+
+        if(!group_by_fields.empty()) {
+            return Option<nlohmann::json>(400, "Parameter `search_after` can't be used along with `group_by`.");
+        }
+
+        const auto& search_after_op = parse_search_after(search_after_str, search_after);
+        if(!search_after_op.ok()) {
+            return Option<nlohmann::json>(search_after_op.code(), search_after_op.error());
+        }
+    }
+
     size_t max_hits = DEFAULT_TOPSTER_SIZE;
 
     // ensure that `max_hits` never exceeds number of documents in collection
-    if(search_fields.size() <= 1 || raw_query == "*") {
+    if(has_search_after) {
+        // the hits before the cursor are left out as they are scored, so a page never needs more than `per_page`
+        max_hits = std::min(per_page, get_num_documents());
+    } else if(search_fields.size() <= 1 || raw_query == "*") {
         max_hits = std::min(std::max((page * per_page), max_hits), get_num_documents());
     } else {
         max_hits = std::min(std::max((page * per_page), max_hits), get_num_documents());
     }
 
+    vector_query_t vector_query;
+
+    if(!vector_query_str.empty()) {
+        if(!group_by_fields.empty()) {
+            return Option<nlohmann::json>(400, "Parameter `vector_query` can't be used along with `group_by`.");
+        }
+
+        if(has_search_after) {
+            return Option<nlohmann::json>(400, "Parameter `vector_query` can't be used along with `search_after`.");
+        }
+
+        const auto& vector_query_op = parse_vector_query(vector_query_str, vector_query);
+        if(!vector_query_op.ok()) {
+            return Option<nlohmann::json>(vector_query_op.code(), vector_query_op.error());
+        }
+
+        const auto vector_field_it = search_schema.find(vector_query.field_name);
+        if(vector_field_it == search_schema.end() || !vector_field_it->second.is_vector()) {
+            return Option<nlohmann::json>(404, "Could not find a vector field named `" +
+                                               vector_query.field_name + "` in the schema.");
+        }
+
+        if(vector_query.values.size() != vector_field_it->second.num_dim) {
+            return Option<nlohmann::json>(400, "Query vector for field `" + vector_query.field_name + "` must have " +
+                                               std::to_string(vector_field_it->second.num_dim) + " dimensions.");
+        }
+
+        if(vector_query.k == 0) {
+            vector_query.k = max_hits;
+        }
+    }
+
     if(token_order == NOT_SET) {
         if(default_sorting_field.empty()) {
             token_order = FREQUENCY;
@@ -977,12 +1330,11 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
     std::vector<std::string> hidden_hits;
     StringUtils::split(hidden_hits_str, hidden_hits, ",");
 
-    std::vector<const override_t*> filter_overrides;
     std::string query = raw_query;
     bool filter_curated_hits = false;
     std::string curated_sort_by;
     curate_results(query, enable_overrides, pre_segmented_query, pinned_hits, hidden_hits,
-                   included_ids, excluded_ids, filter_overrides, filter_curated_hits, curated_sort_by);
+                   included_ids, excluded_ids, filter_curated_hits, curated_sort_by);
 
     if(filter_curated_hits_option == 0 || filter_curated_hits_option == 1) {
         // When query param has explicit value set, override level configuration takes lower precedence.
@@ -1041,6 +1393,12 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
             match_score_index = i;
 
             if(sort_fields_std[i].text_match_buckets > 1) {
+                if(has_search_after) {
+                    // bucketed hits are not ordered by their sort tuple, which the cursor relies on
+                    return Option<nlohmann::json>(400, "Parameter `search_after` can't be used along with "
+                                                       "text match buckets.");
+                }
+
                 // we will disable prioritize exact match because it's incompatible with bucketing
                 prioritize_exact_match = false;
             }
@@ -1074,6 +1432,11 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
                            field_locale, pre_segmented_query);
 
         // process filter overrides first, before synonyms (order is important)
+        std::vector<const override_t*> filter_overrides;
+        if(enable_overrides) {
+            get_filter_overrides(q_include_tokens, filter_overrides);
+        }
+
         index->process_filter_overrides(filter_overrides, q_include_tokens, token_order, filters);
 
         for(size_t i = 0; i < q_include_tokens.size(); i++) {
@@ -1097,6 +1460,10 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
 
     // search all indices
 
+    // Without an exact `found`, the blocks that cannot make it into the top hits are skipped, and `found` estimates
+    // the matches within them. Facet counts need every match, so they keep the search exhaustive.
+    const bool approximate_found = !exhaustive_found && facets.empty();
+
     size_t index_id = 0;
     search_args* search_params = new search_args(field_query_tokens, weighted_search_fields,
                                                  filters, facets, included_ids, excluded_ids,
@@ -1105,13 +1472,28 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
                                                  drop_tokens_threshold, typo_tokens_threshold,
                                                  group_by_fields, group_limit, default_sorting_field,
                                                  prioritize_exact_match, prioritize_token_position,
-                                                 exhaustive_search, 4,
+                                                 exhaustive_search, num_memory_shards,
                                                  search_stop_millis,
                                                  min_len_1typo, min_len_2typo, max_candidates, infixes,
                                                  max_extra_prefix, max_extra_suffix, facet_query_num_typos,
-                                                 filter_curated_hits, split_join_tokens);
+                                                 filter_curated_hits, split_join_tokens,
+                                                 enable_top_k_pruning || approximate_found,
+                                                 explain, facet_sample_percent, facet_sample_threshold);
 
-    index->run_search(search_params);
+    search_params->cancel_token.req_disposed = req_disposed;
+    search_cancel_token = &search_params->cancel_token;
+    search_profile = profile ? &search_params->profile : nullptr;
+
+    if(has_search_after) {
+        search_params->topster->set_search_after(&search_after);
+    }
+
+    search_params->vector_query = vector_query;
+
+    {
+        trace_span_t index_search_span("index.search");
+        index->run_search(search_params);
+    }
 
     // for grouping we have to re-aggregate
 
@@ -1123,7 +1505,11 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
     curated_topster.sort();
 
     populate_result_kvs(&topster, raw_result_kvs);
-    populate_result_kvs(&curated_topster, override_result_kvs);
+
+    if(!has_search_after) {
+        // curated hits are placed by their position from the top, so they only show up on pages without a cursor
+        populate_result_kvs(&curated_topster, override_result_kvs);
+    }
 
     // for grouping we have to aggregate group set sizes to a count value
     if(group_limit) {
@@ -1136,6 +1522,10 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
         total_found = search_params->groups_processed.size() + override_result_kvs.size();
     } else {
         total_found = search_params->all_result_ids_len;
+
+        if(approximate_found) {
+            total_found = std::min<size_t>(total_found + search_params->num_pruned_ids, num_documents.load());
+        }
     }
 
     if(match_score_index >= 0 && sort_fields_std[match_score_index].text_match_buckets > 1) {
@@ -1246,6 +1636,13 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
 
     result["found"] = total_found;
 
+    // beyond `group_counter_t::EXACT_MAX_GROUPS` groups, their number is estimated
+    const bool groups_estimated = group_limit && !search_params->groups_processed.is_exact();
+
+    if(approximate_found || groups_estimated) {
+        result["found_is_estimate"] = groups_estimated || (search_params->num_pruned_ids != 0);
+    }
+
     if(exclude_fields.count("out_of") == 0) {
         result["out_of"] = num_documents.load();
     }
@@ -1258,129 +1655,329 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
         index_symbols[uint8_t(c)] = 1;
     }
 
-    // construct results array
+    // the documents of the hits on the page are fetched in a single batch, and the hits are built out of them in
+    // parallel before being assembled into the result in order
+    std::vector<const KV*> page_kvs;
+
     for(long result_kvs_index = start_result_index; result_kvs_index <= end_result_index; result_kvs_index++) {
         const std::vector<KV*> & kv_group = result_group_kvs[result_kvs_index];
+        page_kvs.insert(page_kvs.end(), kv_group.begin(), kv_group.end());
+    }
 
-        nlohmann::json group_hits;
-        if(group_limit) {
-            group_hits["hits"] = nlohmann::json::array();
-        }
+    std::vector<std::shared_ptr<const nlohmann::json>> cached_docs(page_kvs.size());
+    std::vector<size_t> hit_fetch_indices(page_kvs.size(), 0);
+    std::vector<std::string> seq_id_keys;
+    uint64_t document_generation;
 
-        nlohmann::json& hits_array = group_limit ? group_hits["hits"] : result["hits"];
+    // summaries are not cached, since the cache is of whole documents
+    const bool fetch_summaries = is_summary_enough(include_fields, highlight_items);
 
-        for(const KV* field_order_kv: kv_group) {
-            const std::string& seq_id_key = get_seq_id_key((uint32_t) field_order_kv->key);
+    {
+        std::unique_lock lock(document_cache_mutex);
+        document_generation = document_cache_generation;
 
-            nlohmann::json document;
-            const Option<bool> & document_op = get_document_from_store(seq_id_key, document);
+        for(size_t hit_index = 0; hit_index < page_kvs.size(); hit_index++) {
+            const uint32_t seq_id = page_kvs[hit_index]->key;
+            auto hit_it = document_cache.find(seq_id);
 
-            if(!document_op.ok()) {
-                LOG(ERROR) << "Document fetch error. " << document_op.error();
-                continue;
+            if(hit_it != document_cache.end()) {
+                cached_docs[hit_index] = hit_it.value();
+            } else {
+                hit_fetch_indices[hit_index] = seq_id_keys.size();
+                seq_id_keys.push_back(fetch_summaries ? get_summary_key(seq_id) : get_seq_id_key(seq_id));
             }
+        }
+    }
 
-            nlohmann::json wrapper_doc;
-            wrapper_doc["highlights"] = nlohmann::json::array();
-            std::vector<highlight_t> highlights;
-            StringUtils string_utils;
+    std::vector<std::string> json_doc_strs;
+    std::vector<StoreStatus> json_doc_statuses;
 
-            for(size_t i = 0; i < highlight_items.size(); i++) {
-                auto& highlight_item = highlight_items[i];
-                const std::string& field_name = highlight_item.name;
-                if(search_schema.count(field_name) == 0) {
-                    continue;
-                }
+    {
+        search_stage_timer_t hydration_timer(search_profile_t::HYDRATION);
 
-                field search_field = search_schema.at(field_name);
+        if(!seq_id_keys.empty()) {
+            store->multi_get(seq_id_keys, json_doc_strs, json_doc_statuses);
+            search_profile_add(search_profile_t::STORE_READS, seq_id_keys.size());
+        }
 
-                if(query != "*" && (search_field.type == field_types::STRING ||
-                                    search_field.type == field_types::STRING_ARRAY)) {
+        if(fetch_summaries) {
+            // falls back to the whole documents of the hits whose summaries are missing, again in a single batch
+            std::vector<size_t> fallback_fetch_indices;
+            std::vector<std::string> fallback_keys;
 
-                    highlight_t highlight;
-                    highlight_result(raw_query, search_field, i, highlight_item.qtoken_leaves, q_tokens, field_order_kv,
-                                     document,string_utils, snippet_threshold, highlight_affix_num_tokens,
-                                     highlight_item.fully_highlighted, highlight_item.infix,
-                                     highlight_start_tag, highlight_end_tag, index_symbols, highlight);
-                    if(!highlight.snippets.empty()) {
-                        highlights.push_back(highlight);
-                    }
+            for(size_t hit_index = 0; hit_index < page_kvs.size(); hit_index++) {
+                const size_t fetch_index = hit_fetch_indices[hit_index];
+                if(!cached_docs[hit_index] && json_doc_statuses[fetch_index] == StoreStatus::NOT_FOUND) {
+                    fallback_fetch_indices.push_back(fetch_index);
+                    fallback_keys.push_back(get_seq_id_key(page_kvs[hit_index]->key));
                 }
             }
 
-            std::sort(highlights.begin(), highlights.end());
+            if(!fallback_keys.empty()) {
+                std::vector<std::string> fallback_doc_strs;
+                std::vector<StoreStatus> fallback_doc_statuses;
+                store->multi_get(fallback_keys, fallback_doc_strs, fallback_doc_statuses);
+                search_profile_add(search_profile_t::STORE_READS, fallback_keys.size());
 
-            for(const auto & highlight: highlights) {
-                nlohmann::json h_json = nlohmann::json::object();
-                h_json["field"] = highlight.field;
-
-                if(!highlight.indices.empty()) {
-                    h_json["matched_tokens"] = highlight.matched_tokens;
-                    h_json["indices"] = highlight.indices;
-                    h_json["snippets"] = highlight.snippets;
-                    if(!highlight.values.empty()) {
-                        h_json["values"] = highlight.values;
-                    }
-                } else {
-                    h_json["matched_tokens"] = highlight.matched_tokens[0];
-                    h_json["snippet"] = highlight.snippets[0];
-                    if(!highlight.values.empty() && !highlight.values[0].empty()) {
-                        h_json["value"] = highlight.values[0];
-                    }
+                for(size_t i = 0; i < fallback_keys.size(); i++) {
+                    json_doc_strs[fallback_fetch_indices[i]] = std::move(fallback_doc_strs[i]);
+                    json_doc_statuses[fallback_fetch_indices[i]] = fallback_doc_statuses[i];
                 }
-
-                wrapper_doc["highlights"].push_back(h_json);
             }
+        }
+    }
+
+    std::vector<nlohmann::json> wrapper_docs(page_kvs.size());
+    std::vector<uint8_t> hits_found(page_kvs.size(), 0);
 
-            //wrapper_doc["seq_id"] = (uint32_t) field_order_kv->key;
+    auto build_hit = [&](size_t hit_index) {
+        const KV* field_order_kv = page_kvs[hit_index];
+        nlohmann::json document;
 
-            prune_document(document, include_fields, exclude_fields);
-            wrapper_doc["document"] = document;
+        if(cached_docs[hit_index]) {
+            // copied, since the document gets pruned
+            document = *cached_docs[hit_index];
+        } else {
+            const size_t fetch_index = hit_fetch_indices[hit_index];
+            search_stage_timer_t hydration_timer(search_profile_t::HYDRATION);
 
-            if(field_order_kv->match_score_index == CURATED_RECORD_IDENTIFIER) {
-                wrapper_doc["curated"] = true;
-            } else {
-                wrapper_doc["text_match"] = field_order_kv->scores[field_order_kv->match_score_index];
+            if(json_doc_statuses[fetch_index] != StoreStatus::FOUND) {
+                LOG(ERROR) << "Document fetch error. Could not locate the JSON document for sequence ID: "
+                           << field_order_kv->key;
+                return ;
             }
 
-            nlohmann::json geo_distances;
+            if(!decode_document(json_doc_strs[fetch_index], document)) {
+                LOG(ERROR) << "Document fetch error. Error while parsing stored document with sequence ID: "
+                           << field_order_kv->key;
+                return ;
+            }
 
-            for(size_t sort_field_index = 0; sort_field_index < sort_fields_std.size(); sort_field_index++) {
-                const auto& sort_field = sort_fields_std[sort_field_index];
-                if(sort_field.geopoint != 0) {
-                    geo_distances[sort_field.name] = std::abs(field_order_kv->scores[sort_field_index]);
-                }
+            if(!fetch_summaries) {
+                cache_document(field_order_kv->key, json_doc_strs[fetch_index].size(), document,
+                               document_generation);
             }
+        }
 
-            if(!geo_distances.empty()) {
-                wrapper_doc["geo_distance_meters"] = geo_distances;
+        nlohmann::json& wrapper_doc = wrapper_docs[hit_index];
+        wrapper_doc["highlights"] = nlohmann::json::array();
+        std::vector<highlight_t> highlights;
+        StringUtils string_utils;
+
+        for(size_t i = 0; i < highlight_items.size(); i++) {
+            auto& highlight_item = highlight_items[i];
+            const std::string& field_name = highlight_item.name;
+            if(search_schema.count(field_name) == 0) {
+                continue;
             }
 
-            hits_array.push_back(wrapper_doc);
-        }
+            field search_field = search_schema.at(field_name);
 
-        if(group_limit) {
-            const auto& document = group_hits["hits"][0]["document"];
+            if(query != "*" && (search_field.type == field_types::STRING ||
+                                search_field.type == field_types::STRING_ARRAY)) {
 
-            group_hits["group_key"] = nlohmann::json::array();
-            for(const auto& field_name: group_by_fields) {
-                if(document.count(field_name) != 0) {
-                    group_hits["group_key"].push_back(document[field_name]);
+                if(search_cutoff_reached()) {
+                    // remaining hits are returned without highlights
+                    search_cutoff = true;
+                    break;
                 }
-            }
 
-            result["grouped_hits"].push_back(group_hits);
+                highlight_t highlight;
+                highlight_result(raw_query, search_field, i, highlight_item.qtoken_leaves, q_tokens, field_order_kv,
+                                 document,string_utils, snippet_threshold, highlight_affix_num_tokens,
+                                 highlight_item.fully_highlighted, highlight_item.infix,
+                                 highlight_start_tag, highlight_end_tag, index_symbols, highlight);
+                if(!highlight.snippets.empty()) {
+                    highlights.push_back(highlight);
+                }
+            }
         }
-    }
 
-    result["facet_counts"] = nlohmann::json::array();
+        std::sort(highlights.begin(), highlights.end());
 
-    // populate facets
-    for(facet & a_facet: facets) {
-        nlohmann::json facet_result = nlohmann::json::object();
+        for(auto & highlight: highlights) {
+            nlohmann::json h_json = nlohmann::json::object();
+            h_json["field"] = std::move(highlight.field);
+
+            if(!highlight.indices.empty()) {
+                h_json["matched_tokens"] = highlight.matched_tokens;
+                h_json["indices"] = highlight.indices;
+                h_json["snippets"] = highlight.snippets;
+                if(!highlight.values.empty()) {
+                    h_json["values"] = highlight.values;
+                }
+            } else {
+                h_json["matched_tokens"] = highlight.matched_tokens[0];
+                h_json["snippet"] = std::move(highlight.snippets[0]);
+                if(!highlight.values.empty() && !highlight.values[0].empty()) {
+                    h_json["value"] = std::move(highlight.values[0]);
+                }
+            }
+
+            wrapper_doc["highlights"].push_back(std::move(h_json));
+        }
+
+        //wrapper_doc["seq_id"] = (uint32_t) field_order_kv->key;
+
+        prune_document(document, include_fields, exclude_fields);
+        wrapper_doc["document"] = std::move(document);
+
+        if(field_order_kv->match_score_index == CURATED_RECORD_IDENTIFIER) {
+            wrapper_doc["curated"] = true;
+        } else {
+            wrapper_doc["text_match"] = field_order_kv->scores[field_order_kv->match_score_index];
+        }
+
+        nlohmann::json geo_distances;
+
+        for(size_t sort_field_index = 0; sort_field_index < sort_fields_std.size(); sort_field_index++) {
+            const auto& sort_field = sort_fields_std[sort_field_index];
+            if(sort_field.geopoint != 0) {
+                geo_distances[sort_field.name] = std::abs(field_order_kv->scores[sort_field_index]);
+            }
+        }
+
+        if(!geo_distances.empty()) {
+            wrapper_doc["geo_distance_meters"] = geo_distances;
+        }
+
+        float vector_distance;
+        if(!vector_query.field_name.empty() &&
+           index->get_vector_distance(vector_query, field_order_kv->key, vector_distance)) {
+            wrapper_doc["vector_distance"] = vector_distance;
+        }
+
+        hits_found[hit_index] = 1;
+    };
+
+    const size_t num_hit_threads = std::min(std::max<size_t>(1, search_params->concurrency), page_kvs.size());
+    ThreadPool* thread_pool = CollectionManager::get_instance().get_thread_pool();
+
+    if(num_hit_threads <= 1 || thread_pool == nullptr) {
+        for(size_t hit_index = 0; hit_index < page_kvs.size(); hit_index++) {
+            build_hit(hit_index);
+        }
+    } else {
+        const size_t window_size = (page_kvs.size() + num_hit_threads - 1) / num_hit_threads;  // rounds up
+
+        const auto parent_search_begin = search_begin;
+        const auto parent_search_stop_ms = search_stop_ms;
+        const bool initial_search_cutoff = search_cutoff;
+        auto parent_search_cutoff = search_cutoff;
+        auto parent_search_cancel_token = search_cancel_token;
+        auto parent_search_profile = search_profile;
+
+        size_t num_processed = 0;
+        size_t num_queued = 0;
+        std::mutex m_process;
+        std::condition_variable cv_process;
+
+        for(size_t hit_start = 0; hit_start < page_kvs.size(); hit_start += window_size) {
+            const size_t hit_end = std::min(hit_start + window_size, page_kvs.size());
+            num_queued++;
+
+            thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::SEARCH, [&, hit_start, hit_end]() {
+                search_begin = parent_search_begin;
+                search_stop_ms = parent_search_stop_ms;
+                search_cutoff = initial_search_cutoff;
+                search_cancel_token = parent_search_cancel_token;
+                search_profile = parent_search_profile;
+
+                for(size_t hit_index = hit_start; hit_index < hit_end; hit_index++) {
+                    build_hit(hit_index);
+                }
+
+                search_cancel_token = nullptr;
+                search_profile = nullptr;
+
+                std::unique_lock<std::mutex> lock(m_process);
+                num_processed++;
+                parent_search_cutoff = parent_search_cutoff || search_cutoff;
+                cv_process.notify_one();
+            });
+        }
+
+        std::unique_lock<std::mutex> lock_process(m_process);
+        cv_process.wait(lock_process, [&](){ return num_processed == num_queued; });
+        search_cutoff = parent_search_cutoff;
+    }
+
+    // construct results array
+    size_t hit_index = 0;
+
+    for(long result_kvs_index = start_result_index; result_kvs_index <= end_result_index; result_kvs_index++) {
+        const std::vector<KV*> & kv_group = result_group_kvs[result_kvs_index];
+
+        nlohmann::json group_hits;
+        if(group_limit) {
+            group_hits["hits"] = nlohmann::json::array();
+        }
+
+        nlohmann::json& hits_array = group_limit ? group_hits["hits"] : result["hits"];
+
+        for(size_t kv_index = 0; kv_index < kv_group.size(); kv_index++, hit_index++) {
+            if(hits_found[hit_index]) {
+                hits_array.push_back(std::move(wrapper_docs[hit_index]));
+            }
+        }
+
+        if(group_limit) {
+            const auto& document = group_hits["hits"][0]["document"];
+
+            group_hits["group_key"] = nlohmann::json::array();
+            for(const auto& field_name: group_by_fields) {
+                if(document.count(field_name) != 0) {
+                    group_hits["group_key"].push_back(document[field_name]);
+                }
+            }
+
+            result["grouped_hits"].push_back(std::move(group_hits));
+        }
+    }
+
+    const bool is_bucketed = (match_score_index >= 0 && sort_fields_std[match_score_index].text_match_buckets > 1);
+    const bool is_full_page = (per_page != 0 && end_result_index - start_result_index + 1 == long(per_page));
+
+    if(!group_limit && !is_bucketed && is_full_page) {
+        // the cursor for fetching the next page: the sort tuple of the last hit that was not curated
+        for(long result_kvs_index = end_result_index; result_kvs_index >= start_result_index; result_kvs_index--) {
+            const KV* kv = result_group_kvs[result_kvs_index][0];
+            if(kv->match_score_index != CURATED_RECORD_IDENTIFIER) {
+                result["search_after"] = get_search_after(kv);
+                break;
+            }
+        }
+    }
+
+    result["facet_counts"] = nlohmann::json::array();
+
+    // populate facets
+    for(facet & a_facet: facets) {
+        nlohmann::json facet_result = nlohmann::json::object();
         facet_result["field_name"] = a_facet.field_name;
         facet_result["counts"] = nlohmann::json::array();
 
+        if(!a_facet.ranges.empty()) {
+            // buckets are listed in the order that they were asked for
+            for(const auto& range: a_facet.ranges) {
+                nlohmann::json facet_value_count = nlohmann::json::object();
+                facet_value_count["value"] = range.label;
+                facet_value_count["highlighted"] = range.label;
+                facet_value_count["count"] = range.count;
+                facet_result["counts"].push_back(std::move(facet_value_count));
+            }
+
+            facet_result["stats"] = nlohmann::json::object();
+            facet_result["stats"]["total_values"] = a_facet.ranges.size();
+
+            if(a_facet.is_sampled) {
+                facet_result["sampled"] = true;
+            }
+
+            result["facet_counts"].push_back(std::move(facet_result));
+            continue;
+        }
+
         std::vector<std::pair<int64_t, facet_count_t>> facet_hash_counts;
         for (const auto & kv : a_facet.result_map) {
             facet_hash_counts.emplace_back(kv);
@@ -1395,26 +1992,45 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
 
         std::vector<facet_value_t> facet_values;
 
+        // values that the index does not hold the strings of are read off their representative documents, which
+        // are fetched in a single batch
+        std::vector<std::string> facet_value_strs(max_facets);
+        std::vector<size_t> facet_doc_indices(max_facets, SIZE_MAX);
+        std::vector<uint32_t> facet_doc_seq_ids;
+
+        for(size_t fi = 0; fi < max_facets; fi++) {
+            const auto& kv = facet_hash_counts[fi];
+            if(!index->get_facet_value_string(a_facet.field_name, kv.first, facet_value_strs[fi])) {
+                facet_doc_indices[fi] = facet_doc_seq_ids.size();
+                facet_doc_seq_ids.push_back((uint32_t) kv.second.doc_id);
+            }
+        }
+
+        std::vector<nlohmann::json> facet_docs;
+        get_documents_from_store(facet_doc_seq_ids.data(), facet_doc_seq_ids.size(), facet_docs);
+
         for(size_t fi = 0; fi < max_facets; fi++) {
             // remap facet value hash with actual string
             auto & kv = facet_hash_counts[fi];
             auto & facet_count = kv.second;
 
-            // fetch actual facet value from representative doc id
-            const std::string& seq_id_key = get_seq_id_key((uint32_t) facet_count.doc_id);
-            nlohmann::json document;
-            const Option<bool> & document_op = get_document_from_store(seq_id_key, document);
+            std::string& value = facet_value_strs[fi];
 
-            if(!document_op.ok()) {
-                LOG(ERROR) << "Facet fetch error. " << document_op.error();
-                continue;
-            }
+            if(facet_doc_indices[fi] != SIZE_MAX) {
+                // fetch actual facet value from representative doc id
+                const nlohmann::json& document = facet_docs[facet_doc_indices[fi]];
 
-            std::string value;
-            bool facet_found = facet_value_to_string(a_facet, facet_count, document, value);
+                if(document.is_discarded()) {
+                    LOG(ERROR) << "Facet fetch error. Could not read the document with sequence ID: "
+                               << facet_count.doc_id;
+                    continue;
+                }
 
-            if(!facet_found) {
-                continue;
+                bool facet_found = facet_value_to_string(a_facet, facet_count, document, value);
+
+                if(!facet_found) {
+                    continue;
+                }
             }
 
             std::unordered_map<std::string, size_t> ftoken_pos;
@@ -1503,20 +2119,20 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
                 i++;
             }
 
-            facet_value_t facet_value = {value, highlightedss.str(), facet_count.count};
-            facet_values.emplace_back(facet_value);
+            facet_value_t facet_value = {std::move(value), highlightedss.str(), facet_count.count};
+            facet_values.emplace_back(std::move(facet_value));
         }
 
         std::stable_sort(facet_values.begin(), facet_values.end(), Collection::facet_count_str_compare);
 
-        for(const auto & facet_count: facet_values) {
-            nlohmann::json facet_value_count = nlohmann::json::object();
-            const std::string & value = facet_count.value;
+        nlohmann::json& facet_counts = facet_result["counts"];
 
-            facet_value_count["value"] = value;
-            facet_value_count["highlighted"] = facet_count.highlighted;
+        for(auto & facet_count: facet_values) {
+            nlohmann::json facet_value_count = nlohmann::json::object();
+            facet_value_count["value"] = std::move(facet_count.value);
+            facet_value_count["highlighted"] = std::move(facet_count.highlighted);
             facet_value_count["count"] = facet_count.count;
-            facet_result["counts"].push_back(facet_value_count);
+            facet_counts.push_back(std::move(facet_value_count));
         }
 
         // add facet value stats
@@ -1529,14 +2145,51 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
         }
 
         facet_result["stats"]["total_values"] = facet_hash_counts.size();
-        result["facet_counts"].push_back(facet_result);
+
+        if(a_facet.is_sampled) {
+            facet_result["sampled"] = true;
+        }
+
+        result["facet_counts"].push_back(std::move(facet_result));
+    }
+
+    if(explain) {
+        result["explain"] = search_params->query_plan.to_json();
+    }
+
+    if(profile) {
+        result["profile"] = search_params->profile.to_json();
     }
 
     // free search params
+    search_cancel_token = nullptr;
+    search_profile = nullptr;
     delete search_params;
 
     result["search_cutoff"] = search_cutoff;
 
+    if(latency_budget_ms != 0) {
+        result["search_degradations"] = nlohmann::json::array();
+
+        if(search_degradations & DEGRADED_TYPOS) {
+            result["search_degradations"].push_back("num_typos");
+        }
+
+        if(search_degradations & DEGRADED_MAX_CANDIDATES) {
+            result["search_degradations"].push_back("max_candidates");
+        }
+
+        if(search_degradations & DEGRADED_INFIX) {
+            result["search_degradations"].push_back("infix");
+        }
+
+        if(search_degradations & DEGRADED_FACETS) {
+            result["search_degradations"].push_back("facet_sampling");
+        }
+
+        search_budget_ms = 0;
+    }
+
     result["request_params"] = nlohmann::json::object();;
     result["request_params"]["collection_name"] = name;
     result["request_params"]["per_page"] = per_page;
@@ -1545,7 +2198,7 @@ Option<nlohmann::json> Collection::search(const std::string & raw_query, const s
     //long long int timeMillis = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - begin).count();
     //!LOG(INFO) << "Time taken for result calc: " << timeMillis << "us";
     //!store->print_memory_usage();
-    return Option<nlohmann::json>(result);
+    return Option<nlohmann::json>(std::move(result));
 }
 
 void Collection::process_highlight_fields(const std::vector<std::string>& search_fields,
@@ -1742,10 +2395,12 @@ void Collection::populate_result_kvs(Topster *topster, std::vector<std::vector<K
         // we have to pick top-K groups
         Topster gtopster(topster->MAX_SIZE);
 
-        for(auto& group_topster: topster->group_kv_map) {
-            group_topster.second->sort();
-            if(group_topster.second->size != 0) {
-                KV* kv_head = group_topster.second->getKV(0);
+        // the KVs of each group are sorted along with the topster
+        group_topster_t& groups = topster->groups;
+
+        for(size_t group_index = 0; group_index < groups.num_groups(); group_index++) {
+            if(groups.get_group_size(group_index) != 0) {
+                KV* kv_head = groups.get_group_kvs(group_index);
                 gtopster.add(kv_head);
             }
         }
@@ -1754,11 +2409,16 @@ void Collection::populate_result_kvs(Topster *topster, std::vector<std::vector<K
 
         for(size_t i = 0; i < gtopster.size; i++) {
             KV* kv = gtopster.getKV(i);
-            const std::vector<KV*> group_kvs(
-                topster->group_kv_map[kv->distinct_key]->kvs,
-                topster->group_kv_map[kv->distinct_key]->kvs+topster->group_kv_map[kv->distinct_key]->size
-            );
-            result_kvs.emplace_back(group_kvs);
+            size_t group_index = 0;
+            groups.find_group(kv->distinct_key, group_index);
+
+            KV* group_kvs = groups.get_group_kvs(group_index);
+            std::vector<KV*> group_kv_ptrs;
+            for(uint32_t j = 0; j < groups.get_group_size(group_index); j++) {
+                group_kv_ptrs.push_back(&group_kvs[j]);
+            }
+
+            result_kvs.emplace_back(group_kv_ptrs);
         }
     } else {
         for(uint32_t t = 0; t < topster->size; t++) {
@@ -1772,10 +2432,8 @@ Option<bool> Collection::get_filter_ids(const std::string & simple_filter_query,
                                     std::vector<std::pair<size_t, uint32_t*>>& index_ids) {
     std::shared_lock lock(mutex);
 
-    const std::string doc_id_prefix = std::to_string(collection_id) + "_" + DOC_ID_PREFIX + "_";
     std::vector<filter> filters;
-    Option<bool> filter_op = filter::parse_filter_query(simple_filter_query, search_schema,
-                                                        store, doc_id_prefix, filters);
+    Option<bool> filter_op = parse_filter_query(simple_filter_query, filters);
 
     if(!filter_op.ok()) {
         return filter_op;
@@ -1789,6 +2447,100 @@ Option<bool> Collection::get_filter_ids(const std::string & simple_filter_query,
     return Option<bool>(true);
 }
 
+Option<bool> Collection::parse_range_facet(const std::string& facet_str, std::vector<facet>& facets) const {
+    const size_t open_pos = facet_str.find('(');
+    const std::string format_error = "Range facet `" + facet_str + "` must be in the `field(min..max, ...)` format.";
+
+    if(facet_str.back() != ')') {
+        return Option<bool>(400, format_error);
+    }
+
+    std::string field_name = facet_str.substr(0, open_pos);
+    StringUtils::trim(field_name);
+
+    const auto field_it = search_schema.find(field_name);
+    if(field_it == search_schema.end()) {
+        return Option<bool>(404, "Could not find a field named `" + field_name + "` in the schema.");
+    }
+
+    const field& range_field = field_it->second;
+
+    if(!range_field.is_num_sortable() || range_field.is_array() ||
+       (!range_field.is_integer() && !range_field.is_float())) {
+        return Option<bool>(400, "Range facet field `" + field_name + "` must be a numerical field that is "
+                                 "sortable.");
+    }
+
+    std::vector<std::string> range_strs;
+    StringUtils::split(facet_str.substr(open_pos + 1, facet_str.size() - open_pos - 2), range_strs, ",");
+
+    if(range_strs.empty()) {
+        return Option<bool>(400, format_error);
+    }
+
+    // values as they are laid out in the sort column of the field
+    auto parse_value = [&range_field](const std::string& value_str, int64_t& value) {
+        if(range_field.is_float()) {
+            if(!StringUtils::is_float(value_str)) {
+                return false;
+            }
+
+            value = Index::float_to_in64_t(std::strtof(value_str.c_str(), nullptr));
+            return true;
+        }
+
+        if(!StringUtils::is_int64_t(value_str)) {
+            return false;
+        }
+
+        value = std::stoll(value_str);
+        return true;
+    };
+
+    facet range_facet(field_name);
+
+    for(const std::string& range_str: range_strs) {
+        const size_t dots_pos = range_str.find("..");
+        if(dots_pos == std::string::npos) {
+            return Option<bool>(400, format_error);
+        }
+
+        std::string lower_str = range_str.substr(0, dots_pos);
+        std::string upper_str = range_str.substr(dots_pos + 2);
+        StringUtils::trim(lower_str);
+        StringUtils::trim(upper_str);
+
+        facet_range_t range;
+        range.label = range_str;
+        int64_t value;
+
+        if(!lower_str.empty()) {
+            if(!parse_value(lower_str, value)) {
+                return Option<bool>(400, format_error);
+            }
+
+            range.min = std::max(value, range.min);
+        }
+
+        if(!upper_str.empty()) {
+            if(!parse_value(upper_str, value) || value == INT64_MIN) {
+                return Option<bool>(400, format_error);
+            }
+
+            range.max = value - 1;
+        }
+
+        if(range.min > range.max) {
+            return Option<bool>(400, "Range `" + range_str + "` of range facet `" + field_name + "` is empty.");
+        }
+
+        range_facet.ranges.push_back(std::move(range));
+    }
+
+    facets.push_back(std::move(range_facet));
+    return Option<bool>(true);
+}
+
 bool Collection::facet_value_to_string(const facet &a_facet, const facet_count_t &facet_count,
                                        const nlohmann::json &document, std::string &value) const {
 
@@ -1815,39 +2567,10 @@ bool Collection::facet_value_to_string(const facet &a_facet, const facet_count_t
         }
     }
 
-    if(search_schema.at(a_facet.field_name).type == field_types::STRING) {
-        value =  document[a_facet.field_name];
-    } else if(search_schema.at(a_facet.field_name).type == field_types::STRING_ARRAY) {
-        value = document[a_facet.field_name][facet_count.array_pos];
-    } else if(search_schema.at(a_facet.field_name).type == field_types::INT32) {
-        int32_t raw_val = document[a_facet.field_name].get<int32_t>();
-        value = std::to_string(raw_val);
-    } else if(search_schema.at(a_facet.field_name).type == field_types::INT32_ARRAY) {
-        int32_t raw_val = document[a_facet.field_name][facet_count.array_pos].get<int32_t>();
-        value = std::to_string(raw_val);
-    } else if(search_schema.at(a_facet.field_name).type == field_types::INT64) {
-        int64_t raw_val = document[a_facet.field_name].get<int64_t>();
-        value = std::to_string(raw_val);
-    } else if(search_schema.at(a_facet.field_name).type == field_types::INT64_ARRAY) {
-        int64_t raw_val = document[a_facet.field_name][facet_count.array_pos].get<int64_t>();
-        value = std::to_string(raw_val);
-    } else if(search_schema.at(a_facet.field_name).type == field_types::FLOAT) {
-        float raw_val = document[a_facet.field_name].get<float>();
-        value = StringUtils::float_to_str(raw_val);
-        if(value != "0") {
-            value.erase ( value.find_last_not_of('0') + 1, std::string::npos ); // remove trailing zeros
-        }
-    } else if(search_schema.at(a_facet.field_name).type == field_types::FLOAT_ARRAY) {
-        float raw_val = document[a_facet.field_name][facet_count.array_pos].get<float>();
-        value = StringUtils::float_to_str(raw_val);
-        value.erase ( value.find_last_not_of('0') + 1, std::string::npos );  // remove trailing zeros
-    } else if(search_schema.at(a_facet.field_name).type == field_types::BOOL) {
-        value = std::to_string(document[a_facet.field_name].get<bool>());
-        value = (value == "1") ? "true" : "false";
-    } else if(search_schema.at(a_facet.field_name).type == field_types::BOOL_ARRAY) {
-        value = std::to_string(document[a_facet.field_name][facet_count.array_pos].get<bool>());
-        value = (value == "1") ? "true" : "false";
-    }
+    const field& facet_field = search_schema.at(a_facet.field_name);
+    value = Index::facet_value_to_string(facet_field, facet_field.is_array() ?
+                                                      document[a_facet.field_name][facet_count.array_pos] :
+                                                      document[a_facet.field_name]);
 
     return true;
 }
@@ -1871,6 +2594,8 @@ void Collection::highlight_result(const std::string& raw_query, const field &sea
         return;
     }
 
+    search_stage_timer_t highlight_timer(search_profile_t::HIGHLIGHT);
+
     bool is_cyrillic = Tokenizer::is_cyrillic(search_field.locale);
     bool normalise = is_cyrillic ? false : true;
 
@@ -1996,7 +2721,10 @@ void Collection::highlight_result(const std::string& raw_query, const field &sea
         Tokenizer tokenizer(text, normalise, false, search_field.locale, symbols_to_index, token_separators);
 
         // word tokenizer is a secondary tokenizer used for specific languages that requires transliteration
-        Tokenizer word_tokenizer("", true, false, search_field.locale, symbols_to_index, token_separators);
+        std::optional<Tokenizer> word_tokenizer;
+        if(is_cyrillic) {
+            word_tokenizer.emplace("", true, false, search_field.locale, symbols_to_index, token_separators);
+        }
 
         if(search_field.locale == "ko") {
             text = string_utils.unicode_nfkd(text);
@@ -2007,7 +2735,7 @@ void Collection::highlight_result(const std::string& raw_query, const field &sea
 
         int match_offset_index = 0;
         std::string raw_token;
-        std::set<std::string> token_hits;  // used to identify repeating tokens
+        std::unordered_set<std::string> token_hits;  // used to identify repeating tokens
         size_t raw_token_index = 0, tok_start = 0, tok_end = 0;
 
         // based on `highlight_affix_num_tokens`
@@ -2022,7 +2750,7 @@ void Collection::highlight_result(const std::string& raw_query, const field &sea
 
         while(tokenizer.next(raw_token, raw_token_index, tok_start, tok_end)) {
             if(is_cyrillic) {
-                bool found_token = word_tokenizer.tokenize(raw_token);
+                bool found_token = word_tokenizer->tokenize(raw_token);
                 if(!found_token) {
                     continue;
                 }
@@ -2036,7 +2764,8 @@ void Collection::highlight_result(const std::string& raw_query, const field &sea
                 snippet_start_window.push_back(tok_start);
             }
 
-            bool token_already_found = (token_hits.find(raw_token) != token_hits.end());
+            // hits are only looked up once the first match is found
+            bool token_already_found = found_first_match && (token_hits.find(raw_token) != token_hits.end());
             auto qtoken_it = qtoken_leaves.find(raw_token);
 
             // ensures that the `snippet_start_offset` is always from a matched token, and not from query suggestion
@@ -2074,14 +2803,13 @@ void Collection::highlight_result(const std::string& raw_query, const field &sea
                 found_first_match = true;
 
             } else if((highlight_fully || text.size() < snippet_threshold * 6) &&
-                      qtoken_leaves.find(raw_token) != qtoken_leaves.end()) {
+                      qtoken_it != qtoken_leaves.end()) {
 
                 // Token might not appear in the best matched window, which is limited to a size of 10.
                 // If field is marked to be highlighted fully, or field length exceeds snippet_threshold, we will
                 // locate all tokens that appear in the query / query candidates
 
-                if(qtoken_it != qtoken_leaves.end() && qtoken_it.value().is_prefix &&
-                   qtoken_it.value().root_len < raw_token.size()) {
+                if(qtoken_it.value().is_prefix && qtoken_it.value().root_len < raw_token.size()) {
                     // need to ensure that only the prefix portion is highlighted
                     size_t char_diff = (tok_end - tok_start + 1) - last_raw_q_token.size();
                     auto new_tok_end = (char_diff <= 2 && qtoken_it.value().num_typos != 0) ?
@@ -2238,9 +2966,7 @@ Option<nlohmann::json> Collection::get(const std::string & id) const {
     }
 
     nlohmann::json document;
-    try {
-        document = nlohmann::json::parse(parsed_document);
-    } catch(...) {
+    if(!decode_document(parsed_document, document)) {
         return Option<nlohmann::json>(500, "Error while parsing stored document.");
     }
 
@@ -2254,15 +2980,41 @@ void Collection::remove_document(const nlohmann::json & document, const uint32_t
         std::unique_lock lock(mutex);
 
         index->remove(seq_id, document, {}, false);
+        track_alter_write(seq_id, nullptr);
         num_documents -= 1;
+        bump_write_generation();
     }
 
     if(remove_from_store) {
         store->remove(get_doc_id_key(id));
         store->remove(get_seq_id_key(seq_id));
+        if(!summary_fields.empty()) {
+            store->remove(get_summary_key(seq_id));
+        }
+        invalidate_cached_document(seq_id);
+    }
+}
+
+void Collection::cache_document(uint32_t seq_id, size_t stored_size, const nlohmann::json& document,
+                                uint64_t generation) const {
+    if(stored_size > DOCUMENT_CACHE_MAX_DOC_SIZE) {
+        return ;
+    }
+
+    auto cached_document = std::make_shared<const nlohmann::json>(document);
+
+    std::unique_lock lock(document_cache_mutex);
+    if(generation == document_cache_generation) {
+        document_cache.insert(seq_id, cached_document);
     }
 }
 
+void Collection::invalidate_cached_document(uint32_t seq_id) {
+    std::unique_lock lock(document_cache_mutex);
+    document_cache_generation++;
+    document_cache.erase(seq_id);
+}
+
 Option<std::string> Collection::remove(const std::string & id, const bool remove_from_store) {
     std::string seq_id_str;
     StoreStatus seq_id_status = store->get(get_doc_id_key(id), seq_id_str);
@@ -2290,12 +3042,11 @@ Option<std::string> Collection::remove(const std::string & id, const bool remove
     }
 
     nlohmann::json document;
-    try {
-        document = nlohmann::json::parse(parsed_document);
-    } catch(...) {
+    if(!decode_document(parsed_document, document)) {
         return Option<std::string>(500, "Error while parsing stored document.");
     }
 
+    std::shared_lock write_lock(pending_write_mutex);
     remove_document(document, seq_id, remove_from_store);
     return Option<std::string>(id);
 }
@@ -2314,16 +3065,108 @@ Option<bool> Collection::remove_if_found(uint32_t seq_id, const bool remove_from
     }
 
     nlohmann::json document;
-    try {
-        document = nlohmann::json::parse(parsed_document);
-    } catch(...) {
+    if(!decode_document(parsed_document, document)) {
         return Option<bool>(500, "Error while parsing stored document.");
     }
 
+    std::shared_lock write_lock(pending_write_mutex);
     remove_document(document, seq_id, remove_from_store);
     return Option<bool>(true);
 }
 
+Option<size_t> Collection::remove_if_found(const uint32_t* seq_ids, const size_t num_seq_ids,
+                                           const bool remove_from_store) {
+    std::vector<std::string> seq_id_keys;
+    seq_id_keys.reserve(num_seq_ids);
+    for(size_t i = 0; i < num_seq_ids; i++) {
+        seq_id_keys.push_back(get_seq_id_key(seq_ids[i]));
+    }
+
+    std::vector<std::string> values;
+    std::vector<StoreStatus> statuses;
+    store->multi_get(seq_id_keys, values, statuses);
+
+    std::vector<uint32_t> found_seq_ids;
+    std::vector<nlohmann::json> documents;
+
+    for(size_t i = 0; i < num_seq_ids; i++) {
+        if(statuses[i] == StoreStatus::NOT_FOUND) {
+            continue;
+        }
+
+        if(statuses[i] == StoreStatus::ERROR) {
+            return Option<size_t>(500, "Error while fetching the document with seq id: " +
+                                  std::to_string(seq_ids[i]));
+        }
+
+        nlohmann::json document;
+        if(!decode_document(values[i], document)) {
+            return Option<size_t>(500, "Error while parsing stored document.");
+        }
+
+        found_seq_ids.push_back(seq_ids[i]);
+        documents.push_back(std::move(document));
+    }
+
+    if(found_seq_ids.empty()) {
+        return Option<size_t>(0);
+    }
+
+    std::shared_lock write_lock(pending_write_mutex);
+
+    {
+        std::unique_lock lock(mutex);
+        index->remove(found_seq_ids, documents);
+
+        for(const uint32_t seq_id: found_seq_ids) {
+            track_alter_write(seq_id, nullptr);
+        }
+
+        num_documents -= found_seq_ids.size();
+        bump_write_generation();
+    }
+
+    if(remove_from_store) {
+        rocksdb::WriteBatch batch;
+
+        for(const auto& document: documents) {
+            batch.Delete(get_doc_id_key(document["id"]));
+        }
+
+        // seq_id keys sort in the order of their ids, so a contiguous run is erased with a single range tombstone
+        const uint32_t first_seq_id = found_seq_ids.front(), last_seq_id = found_seq_ids.back();
+        const bool is_contiguous = (found_seq_ids.size() > 1 && last_seq_id != UINT32_MAX &&
+                                    last_seq_id - first_seq_id + 1 == found_seq_ids.size());
+
+        if(is_contiguous) {
+            batch.DeleteRange(get_seq_id_key(first_seq_id), get_seq_id_key(last_seq_id + 1));
+            if(!summary_fields.empty()) {
+                batch.DeleteRange(get_summary_key(first_seq_id), get_summary_key(last_seq_id + 1));
+            }
+        } else {
+            for(uint32_t seq_id: found_seq_ids) {
+                batch.Delete(get_seq_id_key(seq_id));
+                if(!summary_fields.empty()) {
+                    batch.Delete(get_summary_key(seq_id));
+                }
+            }
+        }
+
+        bool write_ok = store->batch_write(batch);
+
+        for(uint32_t seq_id: found_seq_ids) {
+            invalidate_cached_document(seq_id);
+        }
+
+        if(!write_ok) {
+            LOG(ERROR) << "Deletion of " << found_seq_ids.size() << " documents from disk failed.";
+            return Option<size_t>(500, "Could not delete the documents from on-disk storage.");
+        }
+    }
+
+    return Option<size_t>(found_seq_ids.size());
+}
+
 Option<uint32_t> Collection::add_override(const override_t & override) {
     bool inserted = store->insert(Collection::get_override_key(name, override.id), override.to_json().dump());
     if(!inserted) {
@@ -2331,10 +3174,60 @@ Option<uint32_t> Collection::add_override(const override_t & override) {
     }
 
     std::unique_lock lock(mutex);
+
+    auto existing_it = overrides.find(override.id);
+    if(existing_it != overrides.end()) {
+        unindex_override(existing_it->second);
+    }
+
     overrides[override.id] = override;
+    index_override(override);
+    bump_write_generation();
     return Option<uint32_t>(200);
 }
 
+void Collection::index_override(const override_t& override) {
+    const bool exact = (override.rule.match == override_t::MATCH_EXACT);
+
+    if(override.filter_by.empty()) {
+        curation_override_index.insert(override.id, override.rule.query, exact);
+    } else if(override.rule.dynamic_query) {
+        dynamic_filter_override_ids.insert(override.id);
+    } else {
+        filter_override_index.insert(override.id, override.rule.query, exact);
+    }
+}
+
+void Collection::unindex_override(const override_t& override) {
+    const bool exact = (override.rule.match == override_t::MATCH_EXACT);
+
+    if(override.filter_by.empty()) {
+        curation_override_index.remove(override.id, override.rule.query, exact);
+    } else if(override.rule.dynamic_query) {
+        dynamic_filter_override_ids.erase(override.id);
+    } else {
+        filter_override_index.remove(override.id, override.rule.query, exact);
+    }
+}
+
+void Collection::get_filter_overrides(const std::vector<std::string>& query_tokens,
+                                      std::vector<const override_t*>& filter_overrides) const {
+    if(overrides.empty()) {
+        return ;
+    }
+
+    // a static rule is matched the way `Index::static_filter_query_eval()` does
+    std::vector<std::string> matched_ids;
+    filter_override_index.match(StringUtils::join(query_tokens, " "), matched_ids);
+
+    matched_ids.insert(matched_ids.end(), dynamic_filter_override_ids.begin(), dynamic_filter_override_ids.end());
+    std::sort(matched_ids.begin(), matched_ids.end());
+
+    for(const auto& id: matched_ids) {
+        filter_overrides.push_back(&overrides.at(id));
+    }
+}
+
 Option<uint32_t> Collection::remove_override(const std::string & id) {
     if(overrides.count(id) != 0) {
         bool removed = store->remove(Collection::get_override_key(name, id));
@@ -2343,7 +3236,9 @@ Option<uint32_t> Collection::remove_override(const std::string & id) {
         }
 
         std::unique_lock lock(mutex);
+        unindex_override(overrides.at(id));
         overrides.erase(id);
+        bump_write_generation();
         return Option<uint32_t>(200);
     }
 
@@ -2371,23 +3266,472 @@ std::string Collection::get_doc_id_key(const std::string & doc_id) const {
     return std::to_string(collection_id) + "_" + DOC_ID_PREFIX + "_" + doc_id;
 }
 
-std::string Collection::get_name() const {
-    std::shared_lock lock(mutex);
-    return name;
+std::string Collection::get_summary_key(uint32_t seq_id) const {
+    return std::to_string(collection_id) + "_" + SUMMARY_PREFIX + "_" + StringUtils::serialize_uint32_t(seq_id);
 }
 
-uint64_t Collection::get_created_at() const {
-    return created_at.load();
-}
+nlohmann::json Collection::get_document_summary(const nlohmann::json& document) const {
+    nlohmann::json summary = nlohmann::json::object();
 
-size_t Collection::get_num_documents() const {
-    return num_documents.load();
+    auto id_it = document.find("id");
+    if(id_it != document.end()) {
+        summary["id"] = *id_it;
+    }
+
+    for(const auto& summary_field: summary_fields) {
+        auto field_it = document.find(summary_field);
+        if(field_it != document.end()) {
+            summary[summary_field] = *field_it;
+        }
+    }
+
+    return summary;
+}
+
+bool Collection::is_summary_enough(const spp::sparse_hash_set<std::string>& include_fields,
+                                   const std::vector<highlight_field_t>& highlight_items) const {
+    if(summary_fields.empty() || include_fields.empty()) {
+        return false;
+    }
+
+    auto is_summary_field = [this](const std::string& field_name) {
+        return field_name == "id" ||
+               std::find(summary_fields.begin(), summary_fields.end(), field_name) != summary_fields.end();
+    };
+
+    for(const auto& include_field: include_fields) {
+        if(!is_summary_field(include_field)) {
+            return false;
+        }
+    }
+
+    for(const auto& highlight_item: highlight_items) {
+        if(!is_summary_field(highlight_item.name)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string Collection::get_document_keys_key() const {
+    return std::to_string(collection_id) + "_" + DOC_KEYS_PREFIX;
+}
+
+bool Collection::encode_document(const nlohmann::json& document, std::string& value) {
+    return document_codec.encode(document, value, [this](const std::string& document_keys) {
+        return store->insert(get_document_keys_key(), document_keys);
+    });
+}
+
+bool Collection::decode_document(const char* data, size_t size, nlohmann::json& document) const {
+    return document_codec.decode(data, size, document);
+}
+
+bool Collection::decode_document(const std::string& value, nlohmann::json& document) const {
+    return document_codec.decode(value, document);
+}
+
+std::string Collection::get_name() const {
+    std::shared_lock lock(mutex);
+    return name;
+}
+
+uint64_t Collection::get_created_at() const {
+    return created_at.load();
+}
+
+size_t Collection::get_num_documents() const {
+    return num_documents.load();
+}
+
+void Collection::bump_write_generation() {
+    write_generation = ++next_write_generation;
+}
+
+Option<bool> Collection::parse_filter_query(const std::string& simple_filter_query,
+                                            std::vector<filter>& filters) const {
+    // read before the ids are looked up, so that a write made while they are is not missed
+    const uint64_t generation = write_generation.load();
+
+    {
+        std::unique_lock lock(parsed_filter_cache_mutex);
+        auto hit_it = parsed_filter_cache.find(simple_filter_query);
+        if(hit_it != parsed_filter_cache.end() &&
+           (!hit_it.value().has_id_filter || hit_it.value().write_generation == generation)) {
+            filters = hit_it.value().filters;
+            return Option<bool>(true);
+        }
+    }
+
+    const std::string doc_id_prefix = std::to_string(collection_id) + "_" + DOC_ID_PREFIX + "_";
+    Option<bool> parse_filter_op = filter::parse_filter_query(simple_filter_query, search_schema,
+                                                              store, doc_id_prefix, filters);
+    if(!parse_filter_op.ok()) {
+        return parse_filter_op;
+    }
+
+    parsed_filter_t parsed_filter;
+    parsed_filter.filters = filters;
+    parsed_filter.write_generation = generation;
+    parsed_filter.has_id_filter = std::any_of(filters.begin(), filters.end(), [](const filter& a_filter) {
+        return a_filter.field_name == "id";
+    });
+
+    std::unique_lock lock(parsed_filter_cache_mutex);
+    parsed_filter_cache.insert(simple_filter_query, parsed_filter);
+
+    return Option<bool>(true);
+}
+
+uint64_t Collection::get_write_generation() const {
+    return write_generation.load();
 }
 
 uint32_t Collection::get_collection_id() const {
     return collection_id.load();
 }
 
+int Collection::get_numa_node() const {
+    const ThreadPool* thread_pool = CollectionManager::get_instance().get_thread_pool();
+    return (thread_pool != nullptr) ? thread_pool->get_node(collection_id.load()) : -1;
+}
+
+Option<bool> Collection::save_index_snapshot(const std::string& file_path, uint64_t store_seq_number) const {
+    std::shared_lock lock(mutex);
+    return write_index_snapshot(file_path, store_seq_number);
+}
+
+Option<bool> Collection::write_index_snapshot(const std::string& file_path, uint64_t store_seq_number) const {
+    std::ofstream out(file_path, std::ios::binary | std::ios::trunc);
+    index->save_snapshot(out, next_seq_id.load(), store_seq_number);
+    out.close();
+
+    if(out.fail()) {
+        return Option<bool>(500, "Could not write the index snapshot of collection `" + name + "`.");
+    }
+
+    return Option<bool>(true);
+}
+
+bool Collection::load_index_snapshot(const std::string& file_path, uint64_t store_seq_number) {
+    std::unique_lock lock(mutex);
+
+    std::ifstream in(file_path, std::ios::binary);
+    if(!in.is_open()) {
+        return false;
+    }
+
+    return index->load_snapshot(in, next_seq_id.load(), store_seq_number);
+}
+
+bool Collection::load_dumped_index(std::istream& in) {
+    std::unique_lock lock(mutex);
+
+    // the snapshot was taken of the collection under its old id
+    index_snapshot_t snapshot;
+    if(!snapshot.read_header(in) || snapshot.next_seq_id != next_seq_id.load()) {
+        return false;
+    }
+
+    return index->load_snapshot_trees(in, snapshot);
+}
+
+void Collection::clear_restored_fields() {
+    std::unique_lock lock(mutex);
+    index->clear_restored_fields();
+}
+
+Option<bool> Collection::dump(const std::string& dump_path) {
+    const std::string collection_prefix = std::to_string(collection_id) + "_";
+    const std::string index_snapshot_path = dump_path + ".index";
+
+    // the keys of the documents and of their ids live in column families of their own, apart from the rest
+    const std::vector<std::string> prefixes = {
+        collection_prefix,
+        collection_prefix + SEQ_ID_PREFIX + "_",
+        collection_prefix + SUMMARY_PREFIX + "_",
+        collection_prefix + DOC_ID_PREFIX + "_",
+    };
+
+    collection_dump_t collection_dump;
+    std::vector<std::unique_ptr<rocksdb::Iterator>> iters;
+
+    {
+        // with no write halfway through, the iterators see the very documents that the index snapshot is of
+        std::unique_lock write_lock(pending_write_mutex);
+        std::shared_lock lock(mutex);
+
+        if(store->get(get_meta_key(name), collection_dump.meta_json) != StoreStatus::FOUND) {
+            return Option<bool>(500, "Could not read the meta of collection `" + name + "`.");
+        }
+
+        collection_dump.next_seq_id = next_seq_id.load();
+
+        for(const auto& id_override: overrides) {
+            collection_dump.override_jsons.push_back(id_override.second.to_json().dump());
+        }
+
+        store->scan_fill(SynonymIndex::get_synonym_key(name, ""), collection_dump.synonym_jsons);
+
+        Option<bool> snapshot_op = write_index_snapshot(index_snapshot_path, 0);
+        if(!snapshot_op.ok()) {
+            std::remove(index_snapshot_path.c_str());
+            return snapshot_op;
+        }
+
+        for(const std::string& prefix: prefixes) {
+            iters.emplace_back(store->scan(prefix));
+        }
+    }
+
+    std::ofstream out(dump_path, std::ios::binary | std::ios::trunc);
+    collection_dump.write_header(out);
+
+    for(size_t i = 0; i < prefixes.size(); i++) {
+        rocksdb::Iterator* iter = iters[i].get();
+
+        for(; iter->Valid() && iter->key().starts_with(prefixes[i]); iter->Next()) {
+            const rocksdb::Slice key = iter->key();
+            collection_dump_t::write_kv(out, key.ToString().substr(collection_prefix.size()),
+                                        iter->value().ToString());
+        }
+    }
+
+    collection_dump_t::write_kvs_end(out);
+    iters.clear();
+
+    {
+        std::ifstream snapshot_in(index_snapshot_path, std::ios::binary);
+        out << snapshot_in.rdbuf();
+    }
+
+    std::remove(index_snapshot_path.c_str());
+    out.close();
+
+    if(out.fail()) {
+        return Option<bool>(500, "Could not write the dump of collection `" + name + "`.");
+    }
+
+    return Option<bool>(true);
+}
+
+Option<size_t> Collection::renumber_by_default_sorting_field(const size_t batch_size) {
+    std::unique_lock lock(mutex);
+
+    const auto sort_field_it = search_schema.find(default_sorting_field);
+    if(sort_field_it == search_schema.end() || !sort_field_it->second.is_num_sortable() ||
+       sort_field_it->second.is_array()) {
+        return Option<size_t>(0);
+    }
+
+    const bool is_float = sort_field_it->second.is_float();
+
+    // documents in the order of their current ids, along with the value that they are ranked by
+    struct ranked_doc_t {
+        int64_t int_value = INT64_MIN;
+        double float_value = -std::numeric_limits<double>::infinity();
+        std::string id;
+    };
+
+    std::vector<ranked_doc_t> ranked_docs;
+    const std::string seq_id_prefix = get_seq_id_collection_prefix();
+
+    {
+        std::unique_ptr<rocksdb::Iterator> iter(store->scan(seq_id_prefix));
+
+        for(; iter->Valid() && iter->key().starts_with(seq_id_prefix); iter->Next()) {
+            nlohmann::json document;
+            if(!decode_document(iter->value().data(), iter->value().size(), document) ||
+               !document.contains("id") || !document["id"].is_string()) {
+                const uint32_t seq_id = get_seq_id_from_key(iter->key().ToString());
+                return Option<size_t>(500, "Error while parsing stored document with sequence ID: " +
+                                           std::to_string(seq_id));
+            }
+
+            ranked_docs.emplace_back();
+            ranked_doc_t& ranked_doc = ranked_docs.back();
+            ranked_doc.id = document["id"].get<std::string>();
+
+            const auto value_it = document.find(default_sorting_field);
+            if(value_it != document.end() && value_it->is_number()) {
+                if(is_float) {
+                    ranked_doc.float_value = value_it->get<double>();
+                } else {
+                    ranked_doc.int_value = value_it->get<int64_t>();
+                }
+            } else if(value_it != document.end() && value_it->is_boolean()) {
+                ranked_doc.int_value = value_it->get<bool>();
+            }
+        }
+    }
+
+    auto ranks_lower = [is_float, &ranked_docs](size_t a, size_t b) {
+        return is_float ? ranked_docs[a].float_value < ranked_docs[b].float_value :
+                          ranked_docs[a].int_value < ranked_docs[b].int_value;
+    };
+
+    bool in_order = true;
+    for(size_t i = 1; i < ranked_docs.size() && in_order; i++) {
+        in_order = !ranks_lower(i - 1, i);
+    }
+
+    if(in_order || uint64_t(next_seq_id) + ranked_docs.size() > UINT32_MAX) {
+        return Option<size_t>(0);
+    }
+
+    // ties keep the order of their current ids
+    std::vector<size_t> ranks(ranked_docs.size());
+    std::iota(ranks.begin(), ranks.end(), 0);
+    std::stable_sort(ranks.begin(), ranks.end(), [&ranks_lower](size_t a, size_t b) {
+        return ranks_lower(b, a);
+    });
+
+    std::vector<uint32_t> new_seq_ids(ranked_docs.size());
+    for(size_t rank = 0; rank < ranks.size(); rank++) {
+        new_seq_ids[ranks[rank]] = next_seq_id + rank;
+    }
+
+    // The new ids are taken above the current ones, so that every batch moves its documents without overwriting any
+    // other: a renumbering cut short leaves a store that is consistent, only partly renumbered.
+    const uint32_t renumbered_next_seq_id = next_seq_id + ranked_docs.size();
+    const std::string& next_seq_id_key = get_next_seq_id_key(name);
+
+    const size_t docs_per_batch = std::max<size_t>(batch_size, 1);
+
+    rocksdb::WriteBatch batch;
+    size_t doc_index = 0;
+
+    auto write_batch = [this, &batch, &next_seq_id_key, renumbered_next_seq_id]() {
+        batch.Put(next_seq_id_key, StringUtils::serialize_uint32_t(renumbered_next_seq_id));
+        bool write_ok = store->batch_write(batch);
+        batch.Clear();
+        return write_ok;
+    };
+
+    std::unique_ptr<rocksdb::Iterator> iter(store->scan(seq_id_prefix));
+
+    for(; iter->Valid() && iter->key().starts_with(seq_id_prefix) && doc_index < ranked_docs.size(); iter->Next()) {
+        const uint32_t seq_id = get_seq_id_from_key(iter->key().ToString());
+        const uint32_t new_seq_id = new_seq_ids[doc_index];
+
+        batch.Put(get_seq_id_key(new_seq_id), iter->value());
+        batch.Put(get_doc_id_key(ranked_docs[doc_index].id), std::to_string(new_seq_id));
+        batch.Delete(iter->key());
+
+        if(!summary_fields.empty()) {
+            std::string summary;
+            if(store->get(get_summary_key(seq_id), summary) == StoreStatus::FOUND) {
+                batch.Put(get_summary_key(new_seq_id), summary);
+                batch.Delete(get_summary_key(seq_id));
+            }
+        }
+
+        doc_index++;
+
+        if(doc_index % docs_per_batch == 0 && !write_batch()) {
+            return Option<size_t>(500, "Could not write the renumbered documents to on-disk storage.");
+        }
+    }
+
+    if(batch.Count() != 0 && !write_batch()) {
+        return Option<size_t>(500, "Could not write the renumbered documents to on-disk storage.");
+    }
+
+    next_seq_id = renumbered_next_seq_id;
+
+    return Option<size_t>(doc_index);
+}
+
+void Collection::mark_used(uint64_t now_s) {
+    last_used_s = now_s;
+}
+
+uint64_t Collection::get_last_used_s() const {
+    return last_used_s.load();
+}
+
+bool Collection::is_hibernated() const {
+    return hibernated.load();
+}
+
+Option<uint64_t> Collection::save_hibernation_snapshot(const std::string& file_path) const {
+    std::shared_lock lock(mutex);
+
+    // the generation stands in for the sequence number of the store, which the collection need not be caught up to
+    const uint64_t generation = write_generation.load();
+    Option<bool> write_op = write_index_snapshot(file_path, generation);
+
+    if(!write_op.ok()) {
+        return Option<uint64_t>(write_op.code(), write_op.error());
+    }
+
+    return Option<uint64_t>(generation);
+}
+
+Index* Collection::hibernate(uint64_t generation, const std::string& snapshot_path) {
+    std::unique_lock alter_lock(alter_mutex, std::try_to_lock);
+    if(!alter_lock.owns_lock()) {
+        return nullptr;
+    }
+
+    std::unique_lock write_lock(pending_write_mutex);
+    std::unique_lock lock(mutex);
+
+    if(hibernated || write_generation.load() != generation) {
+        return nullptr;
+    }
+
+    Index* hibernated_index = index;
+    index = new Index(name+std::to_string(0),
+                      collection_id,
+                      store,
+                      synonym_index,
+                      CollectionManager::get_instance().get_thread_pool(),
+                      search_schema,
+                      symbols_to_index, token_separators);
+
+    {
+        std::unique_lock cache_lock(document_cache_mutex);
+        document_cache.clear();
+        document_cache_generation++;
+    }
+
+    {
+        std::unique_lock filter_cache_lock(parsed_filter_cache_mutex);
+        parsed_filter_cache.clear();
+    }
+
+    hibernation_snapshot_path = snapshot_path;
+    hibernation_generation = generation;
+    hibernated = true;
+
+    return hibernated_index;
+}
+
+Option<bool> Collection::wake(const std::function<Option<bool>(Collection*)>& index_documents) {
+    std::unique_lock hibernation_lock(hibernation_mutex);
+
+    if(!hibernated) {
+        return Option<bool>(true);
+    }
+
+    // counted again as the documents are indexed
+    num_documents = 0;
+
+    const bool restored_index_snapshot = load_index_snapshot(hibernation_snapshot_path, hibernation_generation);
+    Option<bool> index_op = index_documents(this);
+
+    if(restored_index_snapshot) {
+        clear_restored_fields();
+    }
+
+    std::remove(hibernation_snapshot_path.c_str());
+    hibernated = false;
+
+    return index_op;
+}
+
 Option<uint32_t> Collection::doc_id_to_seq_id(const std::string & doc_id) const {
     std::string seq_id_str;
     StoreStatus status = store->get(get_doc_id_key(doc_id), seq_id_str);
@@ -2403,6 +3747,26 @@ Option<uint32_t> Collection::doc_id_to_seq_id(const std::string & doc_id) const
     return Option<uint32_t>(500, "Error while fetching doc_id from store.");
 }
 
+void Collection::doc_ids_to_seq_ids(const std::vector<std::string>& doc_ids,
+                                    std::unordered_map<std::string, uint32_t>& seq_ids) const {
+    std::vector<std::string> keys;
+    keys.reserve(doc_ids.size());
+
+    for(const auto& doc_id: doc_ids) {
+        keys.push_back(get_doc_id_key(doc_id));
+    }
+
+    std::vector<std::string> seq_id_strs;
+    std::vector<StoreStatus> statuses;
+    store->multi_get(keys, seq_id_strs, statuses);
+
+    for(size_t i = 0; i < doc_ids.size(); i++) {
+        if(statuses[i] == StoreStatus::FOUND) {
+            seq_ids.emplace(doc_ids[i], (uint32_t) std::stoi(seq_id_strs[i]));
+        }
+    }
+}
+
 std::vector<std::string> Collection::get_facet_fields() {
     std::shared_lock lock(mutex);
 
@@ -2469,15 +3833,63 @@ Option<bool> Collection::get_document_from_store(const uint32_t& seq_id, nlohman
         return Option<bool>(500, "Could not locate the JSON document for sequence ID: " + std::to_string(seq_id));
     }
 
-    try {
-        document = nlohmann::json::parse(json_doc_str);
-    } catch(...) {
+    if(!decode_document(json_doc_str, document)) {
         return Option<bool>(500, "Error while parsing stored document with sequence ID: " + std::to_string(seq_id));
     }
 
     return Option<bool>(true);
 }
 
+nlohmann::json Collection::get_doc_patch(const nlohmann::json& old_doc, const nlohmann::json& new_doc) {
+    nlohmann::json patch = nlohmann::json::object();
+
+    for(auto it = new_doc.begin(); it != new_doc.end(); ++it) {
+        auto old_it = old_doc.find(it.key());
+        if(old_it == old_doc.end() || *old_it != it.value()) {
+            patch[it.key()] = it.value();
+        }
+    }
+
+    for(auto it = old_doc.begin(); it != old_doc.end(); ++it) {
+        if(new_doc.count(it.key()) == 0) {
+            patch[it.key()] = nullptr;
+        }
+    }
+
+    return patch;
+}
+
+void Collection::get_documents_from_store(const uint32_t* seq_ids, const size_t num_seq_ids,
+                                          std::vector<nlohmann::json>& documents) const {
+    documents.clear();
+
+    if(num_seq_ids == 0) {
+        return ;
+    }
+
+    std::vector<std::string> seq_id_keys;
+    seq_id_keys.reserve(num_seq_ids);
+    for(size_t i = 0; i < num_seq_ids; i++) {
+        seq_id_keys.push_back(get_seq_id_key(seq_ids[i]));
+    }
+
+    std::vector<std::string> json_doc_strs;
+    std::vector<StoreStatus> json_doc_statuses;
+    store->multi_get(seq_id_keys, json_doc_strs, json_doc_statuses);
+
+    documents.reserve(num_seq_ids);
+
+    for(size_t i = 0; i < num_seq_ids; i++) {
+        if(json_doc_statuses[i] != StoreStatus::FOUND) {
+            documents.emplace_back(nlohmann::json::value_t::discarded);
+            continue;
+        }
+
+        documents.emplace_back();
+        decode_document(json_doc_strs[i], documents.back());
+    }
+}
+
 Option<bool> Collection::get_document_from_store(const std::string &seq_id_key, nlohmann::json & document) const {
     std::string json_doc_str;
     StoreStatus json_doc_status = store->get(seq_id_key, json_doc_str);
@@ -2487,9 +3899,7 @@ Option<bool> Collection::get_document_from_store(const std::string &seq_id_key,
         return Option<bool>(500, "Could not locate the JSON document for sequence ID: " + seq_id);
     }
 
-    try {
-        document = nlohmann::json::parse(json_doc_str);
-    } catch(...) {
+    if(!decode_document(json_doc_str, document)) {
         return Option<bool>(500, "Error while parsing stored document with sequence ID: " + seq_id_key);
     }
 
@@ -2500,6 +3910,107 @@ const Index* Collection::_get_index() const {
     return index;
 }
 
+Option<bool> Collection::parse_search_after(const std::string& search_after_str, KV& search_after) {
+    std::vector<std::string> search_after_parts;
+    StringUtils::split(search_after_str, search_after_parts, ",");
+
+    if(search_after_parts.size() != 4) {
+        return Option<bool>(400, "Parameter `search_after` is malformed.");
+    }
+
+    for(size_t i = 0; i < 3; i++) {
+        if(!StringUtils::is_int64_t(search_after_parts[i])) {
+            return Option<bool>(400, "Parameter `search_after` is malformed.");
+        }
+
+        search_after.scores[i] = std::stoll(search_after_parts[i]);
+    }
+
+    if(!StringUtils::is_uint32_t(search_after_parts[3])) {
+        return Option<bool>(400, "Parameter `search_after` is malformed.");
+    }
+
+    search_after.key = std::stoul(search_after_parts[3]);
+    return Option<bool>(true);
+}
+
+std::string Collection::get_search_after(const KV* kv) {
+    return std::to_string(kv->scores[0]) + "," + std::to_string(kv->scores[1]) + "," +
+           std::to_string(kv->scores[2]) + "," + std::to_string(kv->key);
+}
+
+Option<bool> Collection::parse_vector_query(const std::string& vector_query_str, vector_query_t& vector_query) {
+    const size_t field_end = vector_query_str.find(':');
+    if(field_end == std::string::npos) {
+        return Option<bool>(400, "Parameter `vector_query` is malformed.");
+    }
+
+    vector_query.field_name = vector_query_str.substr(0, field_end);
+    StringUtils::trim(vector_query.field_name);
+
+    std::string args_str = vector_query_str.substr(field_end + 1);
+    StringUtils::trim(args_str);
+
+    if(vector_query.field_name.empty() || args_str.size() < 2 || args_str.front() != '(' || args_str.back() != ')') {
+        return Option<bool>(400, "Parameter `vector_query` is malformed.");
+    }
+
+    args_str = args_str.substr(1, args_str.size() - 2);
+
+    const size_t values_start = args_str.find('[');
+    const size_t values_end = args_str.find(']');
+
+    if(values_start == std::string::npos || values_end == std::string::npos || values_end < values_start ||
+       args_str.find_first_not_of(' ') != values_start) {
+        return Option<bool>(400, "Parameter `vector_query` is malformed.");
+    }
+
+    std::vector<std::string> value_strs;
+    StringUtils::split(args_str.substr(values_start + 1, values_end - values_start - 1), value_strs, ",");
+
+    for(const auto& value_str: value_strs) {
+        char* end = nullptr;
+        const float value = std::strtof(value_str.c_str(), &end);
+
+        if(end != value_str.c_str() + value_str.size() || !std::isfinite(value)) {
+            return Option<bool>(400, "Parameter `vector_query` is malformed.");
+        }
+
+        vector_query.values.push_back(value);
+    }
+
+    std::vector<std::string> param_strs;
+    StringUtils::split(args_str.substr(values_end + 1), param_strs, ",");
+
+    for(const auto& param_str: param_strs) {
+        std::vector<std::string> param_parts;
+        StringUtils::split(param_str, param_parts, ":");
+
+        if(param_parts.size() != 2) {
+            return Option<bool>(400, "Parameter `vector_query` is malformed.");
+        }
+
+        if(param_parts[0] == "k") {
+            if(!StringUtils::is_uint32_t(param_parts[1]) || std::stoul(param_parts[1]) == 0) {
+                return Option<bool>(400, "Parameter `k` of `vector_query` must be a positive integer.");
+            }
+
+            vector_query.k = std::stoul(param_parts[1]);
+        } else if(param_parts[0] == "alpha") {
+            if(!StringUtils::is_float(param_parts[1]) || std::stof(param_parts[1]) < 0 ||
+               std::stof(param_parts[1]) > 1) {
+                return Option<bool>(400, "Parameter `alpha` of `vector_query` must be between 0 and 1.");
+            }
+
+            vector_query.alpha = std::stof(param_parts[1]);
+        } else {
+            return Option<bool>(400, "Parameter `vector_query` has an unknown parameter `" + param_parts[0] + "`.");
+        }
+    }
+
+    return Option<bool>(true);
+}
+
 Option<bool> Collection::parse_pinned_hits(const std::string& pinned_hits_str,
                                            std::map<size_t, std::vector<std::string>>& pinned_hits) {
     if(!pinned_hits_str.empty()) {
@@ -2538,7 +4049,9 @@ Option<bool> Collection::parse_pinned_hits(const std::string& pinned_hits_str,
 
 Option<bool> Collection::add_synonym(const synonym_t& synonym) {
     std::shared_lock lock(mutex);
-    return synonym_index->add_synonym(name, synonym);
+    auto add_op = synonym_index->add_synonym(name, synonym);
+    bump_write_generation();
+    return add_op;
 }
 
 bool Collection::get_synonym(const std::string& id, synonym_t& synonym) {
@@ -2548,7 +4061,9 @@ bool Collection::get_synonym(const std::string& id, synonym_t& synonym) {
 
 Option<bool> Collection::remove_synonym(const std::string &id) {
     std::shared_lock lock(mutex);
-    return synonym_index->remove_synonym(name, id);
+    auto remove_op = synonym_index->remove_synonym(name, id);
+    bump_write_generation();
+    return remove_op;
 }
 
 void Collection::synonym_reduction(const std::vector<std::string>& tokens,
@@ -2597,80 +4112,95 @@ Option<bool> Collection::persist_collection_meta() {
     return Option<bool>(true);
 }
 
-Option<bool> Collection::batch_alter_data(const std::unordered_map<std::string, field>& schema_additions,
-                                          const std::unordered_map<std::string, field>& new_dynamic_fields,
-                                          const std::vector<field>& del_fields,
-                                          const std::string& this_fallback_field_type,
-                                          const bool do_validation) {
-    // Update schema with additions (deletions can only be made later)
-    std::vector<field> new_fields;
+void Collection::track_alter_write(const uint32_t seq_id, const nlohmann::json& document) {
+    if(alter_tracking_writes) {
+        alter_written_docs[seq_id] = document;
+    }
+}
 
-    for(auto& kv: schema_additions) {
-        const auto& f = kv.second;
+Option<bool> Collection::alter_index_batch(Index* alter_index, std::vector<std::pair<uint32_t, nlohmann::json>>& docs,
+                                           const std::unordered_map<std::string, field>& schema_additions,
+                                           const std::unordered_map<std::string, field>& schema_reindex,
+                                           const std::string& this_fallback_field_type) {
+    std::vector<index_record> addition_batch;
+    std::vector<index_record> reindex_batch;
+
+    for(size_t i = 0; i < docs.size(); i++) {
+        if(!schema_additions.empty()) {
+            // the reindexed fields get a copy of their own, whose values can be coerced
+            nlohmann::json document = schema_reindex.empty() ? std::move(docs[i].second) : docs[i].second;
+            addition_batch.emplace_back(i, docs[i].first, std::move(document), index_operation_t::CREATE,
+                                        DIRTY_VALUES::REJECT);
+        }
 
-        if(f.name == ".*") {
-            fields.push_back(f);
-            continue;
+        if(!schema_reindex.empty()) {
+            reindex_batch.emplace_back(i, docs[i].first, std::move(docs[i].second), index_operation_t::CREATE,
+                                       DIRTY_VALUES::REJECT);
         }
+    }
+
+    if(!addition_batch.empty()) {
+        Index::batch_memory_index(alter_index, addition_batch, default_sorting_field, schema_additions,
+                                  this_fallback_field_type, token_separators, symbols_to_index, false);
+    }
 
-        search_schema.emplace(kv.first, f);
-        new_fields.push_back(f);
-        fields.push_back(f);
+    if(!reindex_batch.empty()) {
+        // we've to run revalidation because during schema change, some coercion might be needed
+        // e.g. "123" -> 123 (string to integer)
+        Index::batch_memory_index(alter_index, reindex_batch, default_sorting_field, schema_reindex,
+                                  this_fallback_field_type, token_separators, symbols_to_index, true);
     }
 
-    for(auto& kv: new_dynamic_fields) {
-        // regexp fields and fields with auto type are treated as dynamic fields
-        const auto& f = kv.second;
-        dynamic_fields.emplace(f.name, f);
-        fields.push_back(f);
+    for(const auto* batch: {&addition_batch, &reindex_batch}) {
+        for(const auto& record: *batch) {
+            if(!record.indexed.ok()) {
+                return Option<bool>(record.indexed.code(), "Could not alter the document with sequence ID " +
+                                    std::to_string(record.seq_id) + ": " + record.indexed.error());
+            }
+        }
     }
 
-    index->refresh_schemas(new_fields, {});
+    return Option<bool>(true);
+}
 
-    // Now, we can index existing data onto the updated schema
+Option<bool> Collection::build_alter_index(Index* alter_index, rocksdb::Iterator* snapshot_iter,
+                                           const std::unordered_map<std::string, field>& schema_additions,
+                                           const std::unordered_map<std::string, field>& schema_reindex,
+                                           const std::string& this_fallback_field_type) {
     const std::string seq_id_prefix = get_seq_id_collection_prefix();
-    rocksdb::Iterator* iter = store->scan(seq_id_prefix);
-    std::unique_ptr<rocksdb::Iterator> iter_guard(iter);
 
     size_t num_found_docs = 0;
-    std::vector<index_record> iter_batch;
+    std::vector<std::pair<uint32_t, nlohmann::json>> docs;
     const size_t index_batch_size = 1000;
 
     auto begin = std::chrono::high_resolution_clock::now();
 
-    while(iter->Valid() && iter->key().starts_with(seq_id_prefix)) {
+    while(snapshot_iter->Valid() && snapshot_iter->key().starts_with(seq_id_prefix)) {
         num_found_docs++;
-        const uint32_t seq_id = Collection::get_seq_id_from_key(iter->key().ToString());
+        const uint32_t seq_id = Collection::get_seq_id_from_key(snapshot_iter->key().ToString());
 
         nlohmann::json document;
 
-        try {
-            document = nlohmann::json::parse(iter->value().ToString());
-        } catch(const std::exception& e) {
-            return Option<bool>(false, "Bad JSON in document: " + document.dump(-1, ' ', false,
-                                                                                nlohmann::detail::error_handler_t::ignore));
+        // parsed off the iterator's slice rather than a copy of it
+        if(!decode_document(snapshot_iter->value().data(), snapshot_iter->value().size(), document)) {
+            return Option<bool>(500, "Bad JSON in document with sequence ID: " + std::to_string(seq_id));
         }
 
-        index_record record(num_found_docs, seq_id, document, index_operation_t::CREATE, DIRTY_VALUES::REJECT);
-        iter_batch.emplace_back(std::move(record));
+        docs.emplace_back(seq_id, std::move(document));
 
         // Peek and check for last record right here so that we handle batched indexing correctly
         // Without doing this, the "last batch" would have to be indexed outside the loop.
-        iter->Next();
-        bool last_record = !(iter->Valid() && iter->key().starts_with(seq_id_prefix));
+        snapshot_iter->Next();
+        bool last_record = !(snapshot_iter->Valid() && snapshot_iter->key().starts_with(seq_id_prefix));
 
         if(num_found_docs % index_batch_size == 0 || last_record) {
-            // put delete first because a field could be deleted and added in the same change set
-            if(!del_fields.empty()) {
-                for(auto& rec: iter_batch) {
-                    index->remove(seq_id, rec.doc, del_fields, true);
-                }
+            auto index_op = alter_index_batch(alter_index, docs, schema_additions, schema_reindex,
+                                              this_fallback_field_type);
+            if(!index_op.ok()) {
+                return index_op;
             }
 
-            Index::batch_memory_index(index, iter_batch, default_sorting_field, schema_additions,
-                                      fallback_field_type, token_separators, symbols_to_index, do_validation);
-
-            iter_batch.clear();
+            docs.clear();
         }
 
         if(num_found_docs % ((1 << 14)) == 0) {
@@ -2687,6 +4217,86 @@ Option<bool> Collection::batch_alter_data(const std::unordered_map<std::string,
 
     LOG(INFO) << "Finished altering " << num_found_docs << " document(s).";
 
+    return Option<bool>(true);
+}
+
+Option<bool> Collection::apply_alter(Index* alter_index, rocksdb::Iterator* snapshot_iter,
+                                     const std::unordered_map<std::string, field>& schema_additions,
+                                     const std::unordered_map<std::string, field>& schema_reindex,
+                                     const std::unordered_map<std::string, field>& addition_dynamic_fields,
+                                     const std::unordered_map<std::string, field>& reindex_dynamic_fields,
+                                     const std::vector<field>& del_fields,
+                                     const std::string& this_fallback_field_type) {
+    std::set<std::string> del_field_names;
+    for(const auto& del_field: del_fields) {
+        del_field_names.insert(del_field.name);
+    }
+
+    std::unordered_map<std::string, field> alter_schema = schema_additions;
+    alter_schema.insert(schema_reindex.begin(), schema_reindex.end());
+    alter_schema.erase(".*");
+
+    for(const auto& kv: alter_schema) {
+        if(search_schema.count(kv.first) != 0 && del_field_names.count(kv.first) == 0) {
+            // e.g. detected off a document that was written in the meantime
+            return Option<bool>(409, "Field `" + kv.first + "` was added to the schema while it was being altered.");
+        }
+    }
+
+    // catch up with the writes made since the snapshot: the version of a document that the snapshot holds, which
+    // the index of the alter was built from, makes way for its current one
+    std::vector<std::pair<uint32_t, nlohmann::json>> written_docs;
+
+    for(auto& kv: alter_written_docs) {
+        if(alter_schema.empty()) {
+            break;
+        }
+
+        const uint32_t seq_id = kv.first;
+        const std::string& seq_id_key = get_seq_id_key(seq_id);
+        snapshot_iter->Seek(seq_id_key);
+
+        if(snapshot_iter->Valid() && snapshot_iter->key() == seq_id_key) {
+            nlohmann::json snapshot_doc;
+            if(!decode_document(snapshot_iter->value().data(), snapshot_iter->value().size(), snapshot_doc)) {
+                return Option<bool>(500, "Bad JSON in document with sequence ID: " + std::to_string(seq_id));
+            }
+
+            // coerced like it was when it got indexed
+            Index::validate_index_in_memory(snapshot_doc, seq_id, default_sorting_field, schema_reindex,
+                                            index_operation_t::CREATE, this_fallback_field_type,
+                                            DIRTY_VALUES::REJECT);
+            alter_index->remove(seq_id, snapshot_doc, {}, false);
+        }
+
+        if(kv.second.is_null()) {
+            continue;
+        }
+
+        // the documents of the snapshot were validated against the altered schema, but these only against the
+        // current one
+        nlohmann::json document = kv.second;
+        auto validate_op = Index::validate_index_in_memory(document, seq_id, default_sorting_field, alter_schema,
+                                                           index_operation_t::CREATE, this_fallback_field_type,
+                                                           DIRTY_VALUES::REJECT);
+        if(!validate_op.ok()) {
+            return Option<bool>(validate_op.code(), "Schema change is incompatible with a document written while "
+                                                    "the collection was being altered: " + validate_op.error());
+        }
+
+        written_docs.emplace_back(seq_id, std::move(kv.second));
+    }
+
+    if(!written_docs.empty()) {
+        LOG(INFO) << "Catching up with " << written_docs.size() << " document(s) written during the alter.";
+        auto index_op = alter_index_batch(alter_index, written_docs, schema_additions, schema_reindex,
+                                          this_fallback_field_type);
+        if(!index_op.ok()) {
+            return index_op;
+        }
+    }
+
+    // put delete first because a field could be deleted and added in the same change set
     for(auto& del_field: del_fields) {
         search_schema.erase(del_field.name);
         auto new_end = std::remove_if(fields.begin(), fields.end(), [&del_field](const field& f) {
@@ -2710,17 +4320,72 @@ Option<bool> Collection::batch_alter_data(const std::unordered_map<std::string,
 
     index->refresh_schemas({}, del_fields);
 
-    auto persist_op = persist_collection_meta();
-    if(!persist_op.ok()) {
-        return persist_op;
+    if(schema_additions.count(".*") != 0) {
+        fallback_field_type = this_fallback_field_type;
     }
 
-    return Option<bool>(true);
+    std::vector<field> new_fields;
+    const std::vector<std::pair<const std::unordered_map<std::string, field>*,
+                                const std::unordered_map<std::string, field>*>> schema_changes = {
+        {&schema_additions, &addition_dynamic_fields},
+        {&schema_reindex, &reindex_dynamic_fields}
+    };
+
+    for(const auto& schema_change: schema_changes) {
+        for(const auto& kv: *schema_change.first) {
+            const auto& f = kv.second;
+            fields.push_back(f);
+
+            if(f.name == ".*") {
+                continue;
+            }
+
+            search_schema.emplace(kv.first, f);
+            new_fields.push_back(f);
+        }
+
+        for(const auto& kv: *schema_change.second) {
+            // regexp fields and fields with auto type are treated as dynamic fields
+            const auto& f = kv.second;
+            dynamic_fields.emplace(f.name, f);
+            fields.push_back(f);
+        }
+    }
+
+    // the structures of the new fields move over to the index, which takes over searching them from here on
+    index->adopt_fields(alter_index, new_fields);
+
+    return persist_collection_meta();
 }
 
 Option<bool> Collection::alter(nlohmann::json& alter_payload) {
-    std::unique_lock lock(mutex);
+    std::unique_lock alter_lock(alter_mutex);
+
+    // The added and reindexed fields are built onto an index of their own off a snapshot of the store, so that the
+    // collection lock is only held to take the snapshot and to swap the fields in: searches and writes go on against
+    // the current schema in the meantime, and the writes are tracked so that the index can catch up with them.
+    std::unique_ptr<rocksdb::Iterator> snapshot_iter;
+
+    {
+        std::unique_lock write_lock(pending_write_mutex);
+        std::unique_lock lock(mutex);
+        alter_written_docs.clear();
+        alter_tracking_writes = true;
+        snapshot_iter.reset(store->scan(get_seq_id_collection_prefix()));
+    }
+
+    auto alter_op = alter_off_snapshot(alter_payload, snapshot_iter.get());
 
+    {
+        std::unique_lock lock(mutex);
+        alter_tracking_writes = false;
+        alter_written_docs.clear();
+    }
+
+    return alter_op;
+}
+
+Option<bool> Collection::alter_off_snapshot(nlohmann::json& alter_payload, rocksdb::Iterator* snapshot_iter) {
     // Validate that all stored documents are compatible with the proposed schema changes.
     std::unordered_map<std::string, field> schema_additions;
     std::unordered_map<std::string, field> schema_reindex;
@@ -2729,43 +4394,57 @@ Option<bool> Collection::alter(nlohmann::json& alter_payload) {
     std::vector<field> del_fields;
     std::string this_fallback_field_type;
 
-    auto validate_op = validate_alter_payload(alter_payload, schema_additions, schema_reindex,
-                                              addition_dynamic_fields, reindex_dynamic_fields,
-                                              del_fields, this_fallback_field_type);
-    if(!validate_op.ok()) {
-        return validate_op;
-    }
+    {
+        std::shared_lock lock(mutex);
 
-    if(!this_fallback_field_type.empty() && !fallback_field_type.empty()) {
-        return Option<bool>(400, "The schema already contains a `.*` field.");
-    }
+        auto validate_op = validate_alter_payload(alter_payload, schema_additions, schema_reindex,
+                                                  addition_dynamic_fields, reindex_dynamic_fields,
+                                                  del_fields, this_fallback_field_type);
+        if(!validate_op.ok()) {
+            return validate_op;
+        }
 
-    if(!this_fallback_field_type.empty() && fallback_field_type.empty()) {
-        fallback_field_type = this_fallback_field_type;
+        if(!this_fallback_field_type.empty() && !fallback_field_type.empty()) {
+            return Option<bool>(400, "The schema already contains a `.*` field.");
+        }
+
+        if(this_fallback_field_type.empty()) {
+            this_fallback_field_type = fallback_field_type;
+        }
     }
 
     LOG(INFO) << "Alter payload validation is successful...";
-    if(!schema_reindex.empty()) {
-        LOG(INFO) << "Processing field additions and deletions first...";
-    }
 
-    auto batch_alter_op = batch_alter_data(schema_additions, addition_dynamic_fields, del_fields, fallback_field_type, false);
-    if(!batch_alter_op.ok()) {
-        return batch_alter_op;
-    }
+    std::unordered_map<std::string, field> alter_schema = schema_additions;
+    alter_schema.insert(schema_reindex.begin(), schema_reindex.end());
+    alter_schema.erase(".*");
 
-    if(!schema_reindex.empty()) {
-        LOG(INFO) << "Processing field modifications now...";
-        // we've to run revaliation because during schema change, some coercion might be needed
-        // e.g. "123" -> 123 (string to integer)
-        bool do_validation = true;
-        batch_alter_op = batch_alter_data(schema_reindex, reindex_dynamic_fields, {}, fallback_field_type, do_validation);
-        if(!batch_alter_op.ok()) {
-            return batch_alter_op;
+    std::unique_ptr<Index> alter_index(new Index(name + "_alter", collection_id, store, synonym_index,
+                                                 CollectionManager::get_instance().get_thread_pool(),
+                                                 alter_schema, symbols_to_index, token_separators));
+
+    if(!alter_schema.empty()) {
+        LOG(INFO) << "Indexing " << alter_schema.size() << " added or modified field(s) off a snapshot...";
+        auto build_op = build_alter_index(alter_index.get(), snapshot_iter, schema_additions, schema_reindex,
+                                          this_fallback_field_type);
+        if(!build_op.ok()) {
+            return build_op;
         }
     }
 
-    return Option<bool>(true);
+    std::unique_lock lock(mutex);
+
+    auto apply_op = apply_alter(alter_index.get(), snapshot_iter, schema_additions, schema_reindex,
+                                addition_dynamic_fields, reindex_dynamic_fields, del_fields,
+                                this_fallback_field_type);
+    bump_write_generation();
+
+    {
+        std::unique_lock cache_lock(parsed_filter_cache_mutex);
+        parsed_filter_cache.clear();
+    }
+
+    return apply_op;
 }
 
 Option<bool> Collection::validate_alter_payload(nlohmann::json& schema_changes,
@@ -2844,6 +4523,11 @@ Option<bool> Collection::validate_alter_payload(nlohmann::json& schema_changes,
                 return Option<bool>(400, "Field `" + field_name + "` is not part of collection schema.");
             }
 
+            if(found_field && field_name == ttl_field) {
+                return Option<bool>(400, "Field `" + field_name + "` is the `ttl_field` of the collection, "
+                                         "so it cannot be dropped.");
+            }
+
             if(found_field) {
                 del_fields.push_back(field_it->second);
                 updated_search_schema.erase(field_it->first);
@@ -2931,11 +4615,9 @@ Option<bool> Collection::validate_alter_payload(nlohmann::json& schema_changes,
         const uint32_t seq_id = Collection::get_seq_id_from_key(iter->key().ToString());
         nlohmann::json document;
 
-        try {
-            document = nlohmann::json::parse(iter->value().ToString());
-        } catch(const std::exception& e) {
-            return Option<bool>(false, "Bad JSON in document: " + document.dump(-1, ' ', false,
-                                                                                nlohmann::detail::error_handler_t::ignore));
+        // parsed off the iterator's slice rather than a copy of it
+        if(!decode_document(iter->value().data(), iter->value().size(), document)) {
+            return Option<bool>(false, "Bad JSON in document with sequence ID: " + std::to_string(seq_id));
         }
 
         if(!fallback_field_type.empty() || !addition_dynamic_fields.empty() || !reindex_dynamic_fields.empty()) {
@@ -3197,6 +4879,134 @@ std::vector<char> Collection::get_token_separators() {
     return token_separators;
 }
 
+posting_codec_t Collection::get_posting_codec() const {
+    return posting_codec;
+}
+
+const std::string& Collection::get_ttl_field() const {
+    return ttl_field;
+}
+
+document_encoding_t Collection::get_document_encoding() const {
+    return document_codec.get_encoding();
+}
+
+const std::vector<std::string>& Collection::get_summary_fields() const {
+    return summary_fields;
+}
+
+nlohmann::json Collection::get_posting_stats() const {
+    std::shared_lock lock(mutex);
+
+    size_t num_postings = 0;
+    std::vector<size_t> codec_bytes;
+    index->get_posting_codec_stats(num_postings, codec_bytes);
+
+    nlohmann::json stats;
+    stats["num_postings"] = num_postings;
+    stats["posting_codec"] = PostingCodec::name(posting_codec);
+    stats["bytes_per_posting"] = nlohmann::json::object();
+
+    const auto& codecs = PostingCodec::codecs();
+    for(size_t i = 0; i < codecs.size(); i++) {
+        stats["bytes_per_posting"][PostingCodec::name(codecs[i])] =
+                (num_postings == 0) ? 0.0 : double(codec_bytes[i]) / num_postings;
+    }
+
+    return stats;
+}
+
+nlohmann::json Collection::get_tree_stats() const {
+    std::shared_lock lock(mutex);
+
+    art_tree_stats tree_stats;
+    index->get_search_index_stats(tree_stats);
+
+    nlohmann::json stats;
+    stats["num_nodes"] = tree_stats.num_nodes;
+    stats["num_leaves"] = tree_stats.num_leaves;
+    stats["node_bytes"] = tree_stats.node_bytes;
+    stats["leaf_bytes"] = tree_stats.leaf_bytes;
+    stats["memory_bytes"] = tree_stats.node_bytes + tree_stats.leaf_bytes;
+
+    return stats;
+}
+
+size_t Collection::compact_postings(size_t max_lists) {
+    // the index takes its own lock for the writes, this one only keeps it from being swapped out by hibernation
+    std::shared_lock lock(mutex);
+    return index->compact_postings(max_lists);
+}
+
+nlohmann::json Collection::get_memory_stats() const {
+    std::shared_lock lock(mutex);
+
+    std::map<std::string, std::map<std::string, size_t>> field_structure_bytes;
+    index->get_memory_stats(field_structure_bytes);
+
+    nlohmann::json stats;
+    stats["fields"] = nlohmann::json::object();
+    stats["structures"] = nlohmann::json::object();
+
+    size_t total_bytes = 0;
+    std::map<std::string, size_t> structure_bytes;
+
+    for(const auto& field_structures: field_structure_bytes) {
+        size_t field_bytes = 0;
+
+        for(const auto& structure: field_structures.second) {
+            field_bytes += structure.second;
+            structure_bytes[structure.first] += structure.second;
+        }
+
+        total_bytes += field_bytes;
+
+        if(!field_structures.first.empty()) {
+            nlohmann::json field_stats = field_structures.second;
+            field_stats["total_bytes"] = field_bytes;
+            stats["fields"][field_structures.first] = field_stats;
+        }
+    }
+
+    for(const auto& structure: structure_bytes) {
+        stats["structures"][structure.first] = structure.second;
+    }
+
+    stats["total_bytes"] = total_bytes;
+    stats["arena_active_bytes"] = index->get_arena_active_bytes();
+
+    return stats;
+}
+
+uint64_t Collection::get_memory_quota_bytes() const {
+    return memory_quota_bytes;
+}
+
+float Collection::get_memory_quota_usage() const {
+    if(memory_quota_bytes == 0) {
+        return 0;
+    }
+
+    return float(memory_bytes_per_doc.load() * num_documents.load()) / memory_quota_bytes;
+}
+
+void Collection::update_memory_estimate() {
+    if(memory_quota_bytes == 0) {
+        return;
+    }
+
+    const size_t num_docs = num_documents.load();
+    const size_t estimate_num_docs = memory_estimate_num_docs.load();
+
+    if(num_docs == 0 || num_docs * 10 < estimate_num_docs * 11) {
+        return;
+    }
+
+    const uint64_t total_bytes = get_memory_stats()["total_bytes"].get<uint64_t>();
+    memory_bytes_per_doc = total_bytes / num_docs;
+    memory_estimate_num_docs = num_docs;
+}
+
 std::string Collection::get_fallback_field_type() {
     return fallback_field_type;
 }
@@ -0,0 +1,90 @@
+#include "collection_dump.h"
+
+template<class T>
+static void write_value(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<class T>
+static bool read_value(std::istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return in.good();
+}
+
+static void write_string(std::ostream& out, const std::string& str) {
+    write_value(out, uint32_t(str.size()));
+    out.write(str.data(), str.size());
+}
+
+static bool read_string(std::istream& in, std::string& str) {
+    uint32_t size;
+    if(!read_value(in, size)) {
+        return false;
+    }
+
+    str.resize(size);
+    in.read(&str[0], size);
+    return in.good();
+}
+
+static void write_strings(std::ostream& out, const std::vector<std::string>& strs) {
+    write_value(out, uint32_t(strs.size()));
+
+    for(const std::string& str: strs) {
+        write_string(out, str);
+    }
+}
+
+static bool read_strings(std::istream& in, std::vector<std::string>& strs) {
+    uint32_t num_strs;
+    if(!read_value(in, num_strs)) {
+        return false;
+    }
+
+    strs.resize(num_strs);
+
+    for(std::string& str: strs) {
+        if(!read_string(in, str)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void collection_dump_t::write_header(std::ostream& out) const {
+    write_value(out, MAGIC);
+    write_value(out, VERSION);
+    write_string(out, meta_json);
+    write_value(out, next_seq_id);
+    write_strings(out, override_jsons);
+    write_strings(out, synonym_jsons);
+}
+
+bool collection_dump_t::read_header(std::istream& in) {
+    uint32_t magic, version;
+
+    if(!read_value(in, magic) || magic != MAGIC || !read_value(in, version) || version != VERSION) {
+        return false;
+    }
+
+    return read_string(in, meta_json) && read_value(in, next_seq_id) &&
+           read_strings(in, override_jsons) && read_strings(in, synonym_jsons);
+}
+
+void collection_dump_t::write_kv(std::ostream& out, const std::string& key, const std::string& value) {
+    write_string(out, key);
+    write_string(out, value);
+}
+
+void collection_dump_t::write_kvs_end(std::ostream& out) {
+    write_string(out, "");
+}
+
+bool collection_dump_t::read_kv(std::istream& in, std::string& key, std::string& value) {
+    if(!read_string(in, key)) {
+        return false;
+    }
+
+    return key.empty() || read_string(in, value);
+}
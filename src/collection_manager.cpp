@@ -1,15 +1,24 @@
 #include <string>
 #include <vector>
+#include <deque>
+#include <thread>
+#include <cstdio>
+#include <fstream>
 #include <json.hpp>
 #include <app_metrics.h>
 #include "collection_manager.h"
 #include "batched_indexer.h"
 #include "logger.h"
 #include "magic_enum.hpp"
+#include "slow_query_log.h"
+#include "system_metrics.h"
+#include "file_utils.h"
+#include "collection_dump.h"
 
 constexpr const size_t CollectionManager::DEFAULT_NUM_MEMORY_SHARDS;
 
-CollectionManager::CollectionManager() {
+CollectionManager::CollectionManager(): loading(false), num_collections_to_load(0), num_collections_loaded(0),
+                                       num_documents_loaded(0) {
 
 }
 
@@ -53,6 +62,17 @@ Collection* CollectionManager::init_collection(const nlohmann::json & collection
             f.sort = field_obj[fields::sort];
         }
 
+        if(field_obj.count(fields::num_dim) != 0) {
+            f.num_dim = field_obj[fields::num_dim].get<size_t>();
+
+            if(field_obj.count(fields::vec_dist) != 0) {
+                vector_index_t::parse_distance_type(field_obj[fields::vec_dist].get<std::string>(), f.vec_dist);
+            }
+
+            f.vec_int8 = (field_obj.count(fields::vec_quantization) != 0 &&
+                          field_obj[fields::vec_quantization] == "int8");
+        }
+
         fields.push_back(f);
     }
 
@@ -80,6 +100,31 @@ Collection* CollectionManager::init_collection(const nlohmann::json & collection
         token_separators = collection_meta[Collection::COLLECTION_SEPARATORS].get<std::vector<std::string>>();
     }
 
+    posting_codec_t posting_codec = FOR_CODEC;
+
+    if(collection_meta.count(Collection::COLLECTION_POSTING_CODEC) != 0) {
+        PostingCodec::parse(collection_meta[Collection::COLLECTION_POSTING_CODEC].get<std::string>(), posting_codec);
+    }
+
+    std::string ttl_field = collection_meta.count(Collection::COLLECTION_TTL_FIELD) != 0 ?
+                            collection_meta[Collection::COLLECTION_TTL_FIELD].get<std::string>() : "";
+
+    document_encoding_t document_encoding = JSON_ENCODING;
+
+    if(collection_meta.count(Collection::COLLECTION_DOCUMENT_ENCODING) != 0) {
+        document_codec_t::parse(collection_meta[Collection::COLLECTION_DOCUMENT_ENCODING].get<std::string>(),
+                                document_encoding);
+    }
+
+    std::vector<std::string> summary_fields;
+
+    if(collection_meta.count(Collection::COLLECTION_SUMMARY_FIELDS) != 0) {
+        summary_fields = collection_meta[Collection::COLLECTION_SUMMARY_FIELDS].get<std::vector<std::string>>();
+    }
+
+    const uint64_t memory_quota_bytes = collection_meta.count(Collection::COLLECTION_MEMORY_QUOTA_BYTES) != 0 ?
+                                        collection_meta[Collection::COLLECTION_MEMORY_QUOTA_BYTES].get<uint64_t>() : 0;
+
     LOG(INFO) << "Found collection " << this_collection_name << " with " << num_memory_shards << " memory shards.";
 
     Collection* collection = new Collection(this_collection_name,
@@ -92,7 +137,13 @@ Collection* CollectionManager::init_collection(const nlohmann::json & collection
                                             max_memory_ratio,
                                             fallback_field_type,
                                             symbols_to_index,
-                                            token_separators);
+                                            token_separators,
+                                            posting_codec,
+                                            ttl_field,
+                                            document_encoding,
+                                            summary_fields,
+                                            num_memory_shards,
+                                            memory_quota_bytes);
 
     return collection;
 }
@@ -131,6 +182,9 @@ Option<bool> CollectionManager::load(const size_t collection_batch_size, const s
     // This function must be idempotent, i.e. when called multiple times, must produce the same state without leaks
     LOG(INFO) << "CollectionManager::load()";
 
+    // as of the snapshot the store was just reloaded from, before anything is written to it
+    index_snapshot_seq_number = store->get_latest_seq_number();
+
     Option<bool> auth_init_op = auth_manager.init(store, bootstrap_auth_key);
     if(!auth_init_op.ok()) {
         LOG(ERROR) << "Auth manager init failed, error=" << auth_init_op.error();
@@ -158,6 +212,16 @@ Option<bool> CollectionManager::load(const size_t collection_batch_size, const s
     const size_t num_collections = collection_meta_jsons.size();
     LOG(INFO) << "Found " << num_collections << " collection(s) on disk.";
 
+    // the threads that are not busy loading one collection each help with reading the documents of a collection
+    const size_t num_parallel_collections = std::max<size_t>(1, std::min(collection_batch_size, num_collections));
+    const size_t num_load_threads = std::max<size_t>(1, std::thread::hardware_concurrency() /
+                                                        num_parallel_collections);
+
+    num_collections_to_load = num_collections;
+    num_collections_loaded = 0;
+    num_documents_loaded = 0;
+    loading = true;
+
     ThreadPool loading_pool(collection_batch_size);
 
     size_t num_processed = 0;
@@ -175,10 +239,12 @@ Option<bool> CollectionManager::load(const size_t collection_batch_size, const s
 
         auto captured_store = store;
         loading_pool.enqueue([captured_store, num_collections, collection_meta, document_batch_size,
-                              &m_process, &cv_process, &num_processed, &next_coll_id_status, quit = quit]() {
+                              num_load_threads, &m_process, &cv_process, &num_processed, &next_coll_id_status,
+                              quit = quit, this]() {
 
             //auto begin = std::chrono::high_resolution_clock::now();
-            Option<bool> res = load_collection(collection_meta, document_batch_size, next_coll_id_status, *quit);
+            Option<bool> res = load_collection(collection_meta, document_batch_size, next_coll_id_status, *quit,
+                                               num_load_threads);
             /*long long int timeMillis =
                     std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - begin).count();
             LOG(INFO) << "Time taken for indexing: " << timeMillis << "ms";*/
@@ -192,6 +258,7 @@ Option<bool> CollectionManager::load(const size_t collection_batch_size, const s
 
             std::unique_lock<std::mutex> lock(m_process);
             num_processed++;
+            num_collections_loaded++;
             cv_process.notify_one();
 
             size_t progress_modulo = std::max<size_t>(1, (num_collections / 10));  // every 10%
@@ -236,6 +303,7 @@ Option<bool> CollectionManager::load(const size_t collection_batch_size, const s
     LOG(INFO) << "Loaded " << num_collections << " collection(s).";
 
     loading_pool.shutdown();
+    loading = false;
 
     LOG(INFO) << "Initializing batched indexer from snapshot state...";
     if(batch_indexer != nullptr) {
@@ -247,11 +315,39 @@ Option<bool> CollectionManager::load(const size_t collection_batch_size, const s
         }
     }
 
+    if(HotQueryLog::get_instance().is_enabled()) {
+        std::vector<hot_query_t> hot_queries;
+        if(HotQueryLog::read(HotQueryLog::get_instance().get_path(), hot_queries).ok() && !hot_queries.empty()) {
+            warm_up(std::move(hot_queries));
+        }
+    }
+
     return Option<bool>(true);
 }
 
 
 void CollectionManager::dispose() {
+    wait_for_reclaims();
+
+    while(hibernating) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    hibernation_idle_s = 0;
+
+    posting_compaction_rate = 0;
+
+    while(compacting) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // the searches left to replay are given up on
+    num_queries_to_warm = 0;
+
+    while(warming) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
     std::unique_lock lock(mutex);
 
     for(auto & name_collection: collections) {
@@ -291,7 +387,12 @@ Option<Collection*> CollectionManager::create_collection(const std::string& name
                                                          const uint64_t created_at,
                                                          const std::string& fallback_field_type,
                                                          const std::vector<std::string>& symbols_to_index,
-                                                         const std::vector<std::string>& token_separators) {
+                                                         const std::vector<std::string>& token_separators,
+                                                         const posting_codec_t posting_codec,
+                                                         const std::string& ttl_field,
+                                                         const document_encoding_t document_encoding,
+                                                         const std::vector<std::string>& summary_fields,
+                                                         const uint64_t memory_quota_bytes) {
 
     if(store->contains(Collection::get_meta_key(name))) {
         return Option<Collection*>(409, std::string("A collection with name `") + name + "` already exists.");
@@ -323,11 +424,30 @@ Option<Collection*> CollectionManager::create_collection(const std::string& name
     collection_meta[Collection::COLLECTION_FALLBACK_FIELD_TYPE] = fallback_field_type;
     collection_meta[Collection::COLLECTION_SYMBOLS_TO_INDEX] = symbols_to_index;
     collection_meta[Collection::COLLECTION_SEPARATORS] = token_separators;
+    collection_meta[Collection::COLLECTION_POSTING_CODEC] = PostingCodec::name(posting_codec);
+
+    if(!ttl_field.empty()) {
+        collection_meta[Collection::COLLECTION_TTL_FIELD] = ttl_field;
+    }
+
+    if(document_encoding != JSON_ENCODING) {
+        collection_meta[Collection::COLLECTION_DOCUMENT_ENCODING] = document_codec_t::name(document_encoding);
+    }
+
+    if(!summary_fields.empty()) {
+        collection_meta[Collection::COLLECTION_SUMMARY_FIELDS] = summary_fields;
+    }
+
+    if(memory_quota_bytes != 0) {
+        collection_meta[Collection::COLLECTION_MEMORY_QUOTA_BYTES] = memory_quota_bytes;
+    }
 
     Collection* new_collection = new Collection(name, next_collection_id, created_at, 0, store, fields,
                                                 default_sorting_field,
                                                 this->max_memory_ratio, fallback_field_type,
-                                                symbols_to_index, token_separators);
+                                                symbols_to_index, token_separators, posting_codec, ttl_field,
+                                                document_encoding, summary_fields, num_memory_shards,
+                                                memory_quota_bytes);
     next_collection_id++;
 
     rocksdb::WriteBatch batch;
@@ -364,9 +484,46 @@ Collection* CollectionManager::get_collection_unsafe(const std::string & collect
 locked_resource_view_t<Collection> CollectionManager::get_collection(const std::string & collection_name) const {
     std::shared_lock lock(mutex);
     Collection* coll = get_collection_unsafe(collection_name);
+
+    if(coll != nullptr) {
+        use_collection(coll);
+    }
+
     return locked_resource_view_t<Collection>(mutex, coll);
 }
 
+float CollectionManager::get_memory_quota_usage(const std::string& collection_name) const {
+    std::shared_lock lock(mutex);
+    Collection* coll = get_collection_unsafe(collection_name);
+    return (coll != nullptr) ? coll->get_memory_quota_usage() : 0;
+}
+
+void CollectionManager::use_collection(Collection* collection) const {
+    collection->mark_used(static_cast<uint64_t>(std::time(nullptr)));
+
+    if(!collection->is_hibernated()) {
+        return;
+    }
+
+    // the shared lock that the caller holds keeps the collection from being hibernated again while it wakes
+    auto begin = std::chrono::high_resolution_clock::now();
+    const size_t num_load_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    Option<bool> wake_op = collection->wake([this, num_load_threads](Collection* coll) {
+        return index_stored_documents(coll, coll->peek_next_seq_id(), WAKE_BATCH_SIZE, num_load_threads, *quit,
+                                      nullptr);
+    });
+
+    if(!wake_op.ok()) {
+        LOG(ERROR) << "Error while waking collection " << collection->get_name() << ": " << wake_op.error();
+        return;
+    }
+
+    auto time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - begin).count();
+    LOG(INFO) << "Woke collection " << collection->get_name() << " in " << time_ms << " ms.";
+}
+
 locked_resource_view_t<Collection> CollectionManager::get_collection_with_id(uint32_t collection_id) const {
     std::shared_lock lock(mutex);
 
@@ -407,20 +564,18 @@ Option<nlohmann::json> CollectionManager::drop_collection(const std::string& col
 
     nlohmann::json collection_json = collection->get_summary_json();
 
-    if(remove_from_store) {
-        const std::string& del_key_prefix = std::to_string(collection->get_collection_id()) + "_";
+    // documents and doc id mappings of the collection, across their column families
+    std::string del_key_prefix;
 
-        rocksdb::Iterator* iter = store->scan(del_key_prefix);
-        while(iter->Valid() && iter->key().starts_with(del_key_prefix)) {
-            store->remove(iter->key().ToString());
-            iter->Next();
-        }
-        delete iter;
+    if(remove_from_store) {
+        // a single range tombstone, while the keys under it are compacted away later on
+        del_key_prefix = std::to_string(collection->get_collection_id()) + "_";
+        store->delete_prefix(del_key_prefix);
 
         // delete overrides
         const std::string& del_override_prefix =
                 std::string(Collection::COLLECTION_OVERRIDE_PREFIX) + "_" + actual_coll_name + "_";
-        iter = store->scan(del_override_prefix);
+        rocksdb::Iterator* iter = store->scan(del_override_prefix);
         while(iter->Valid() && iter->key().starts_with(del_override_prefix)) {
             store->remove(iter->key().ToString());
             iter->Next();
@@ -444,11 +599,197 @@ Option<nlohmann::json> CollectionManager::drop_collection(const std::string& col
     collections.erase(actual_coll_name);
     collection_id_names.erase(collection->get_collection_id());
 
-    delete collection;
+    // no request can get hold of the collection anymore, while those that did are done with it since they held
+    // the shared lock
+    reclaim_collection(collection, del_key_prefix);
 
     return Option<nlohmann::json>(collection_json);
 }
 
+void CollectionManager::reclaim_collection(Collection* collection, const std::string& del_key_prefix) {
+    if(thread_pool == nullptr) {
+        delete collection;
+        return;
+    }
+
+    std::unique_lock lock(reclaim_mutex);
+    collections_to_reclaim.emplace_back(collection, del_key_prefix);
+
+    if(!reclaiming) {
+        reclaiming = true;
+        thread_pool->enqueue_task(task_priority_t::BACKGROUND, task_kind_t::OTHER, [this]() {
+            run_reclaimer();
+        });
+    }
+}
+
+void CollectionManager::run_reclaimer() {
+    while(true) {
+        std::pair<Collection*, std::string> collection_prefix;
+
+        {
+            std::unique_lock lock(reclaim_mutex);
+            if(collections_to_reclaim.empty()) {
+                reclaiming = false;
+                reclaim_cv.notify_all();
+                return;
+            }
+
+            collection_prefix = collections_to_reclaim.front();
+            collections_to_reclaim.pop_front();
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        delete collection_prefix.first;
+        SystemMetrics::release_free_memory();
+
+        if(!collection_prefix.second.empty()) {
+            rocksdb::Status status = store->compact_prefix(collection_prefix.second);
+            if(!status.ok()) {
+                LOG(ERROR) << "Could not compact the keys of dropped collection with prefix "
+                           << collection_prefix.second << ": " << status.ToString();
+            }
+        }
+
+        auto time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now() - begin).count();
+        LOG(INFO) << "Released a dropped collection in " << time_ms << " ms.";
+    }
+}
+
+void CollectionManager::wait_for_reclaims() {
+    std::unique_lock lock(reclaim_mutex);
+    reclaim_cv.wait(lock, [this]() { return !reclaiming; });
+}
+
+Option<bool> CollectionManager::dump_collection(const std::string& collection_name, const std::string& dump_path) {
+    auto collection = get_collection(collection_name);
+
+    if(collection == nullptr) {
+        return Option<bool>(404, "Could not find a collection with name `" + collection_name + "`.");
+    }
+
+    return collection->dump(dump_path);
+}
+
+Option<Collection*> CollectionManager::restore_collection(const std::string& collection_name,
+                                                          const std::string& dump_path, const size_t batch_size) {
+    std::ifstream in(dump_path, std::ios::binary);
+
+    if(!in.is_open()) {
+        return Option<Collection*>(400, "Could not open the dump `" + dump_path + "`.");
+    }
+
+    collection_dump_t collection_dump;
+    nlohmann::json collection_meta;
+
+    if(!collection_dump.read_header(in)) {
+        return Option<Collection*>(400, "The file `" + dump_path + "` is not a collection dump.");
+    }
+
+    try {
+        collection_meta = nlohmann::json::parse(collection_dump.meta_json);
+    } catch(const std::exception& e) {
+        return Option<Collection*>(400, "The collection dump `" + dump_path + "` has a malformed meta.");
+    }
+
+    if(store->contains(Collection::get_meta_key(collection_name))) {
+        return Option<Collection*>(409, std::string("A collection with name `") + collection_name +
+                                        "` already exists.");
+    }
+
+    const uint32_t collection_id = next_collection_id++;
+    collection_meta[Collection::COLLECTION_NAME_KEY] = collection_name;
+    collection_meta[Collection::COLLECTION_ID_KEY] = collection_id;
+
+    Collection* collection = init_collection(collection_meta, collection_dump.next_seq_id, store, max_memory_ratio);
+
+    // the pairs come in key order per column family, so that the table files of a column family do not overlap
+    const std::string collection_prefix = std::to_string(collection_id) + "_";
+    std::vector<std::pair<std::string, std::string>> kvs;
+    size_t kvs_bytes = 0;
+    std::string key, value;
+    bool ingested = true;
+
+    while(ingested) {
+        if(!collection_dump_t::read_kv(in, key, value)) {
+            ingested = false;
+            break;
+        }
+
+        if(key.empty() || kvs_bytes >= RESTORE_INGEST_BYTES) {
+            ingested = kvs.empty() || store->ingest(kvs);
+            kvs.clear();
+            kvs_bytes = 0;
+        }
+
+        if(key.empty()) {
+            break;
+        }
+
+        kvs_bytes += collection_prefix.size() + key.size() + value.size();
+        kvs.emplace_back(collection_prefix + key, std::move(value));
+    }
+
+    if(!ingested) {
+        store->delete_prefix(collection_prefix);
+        delete collection;
+        return Option<Collection*>(500, "Could not ingest the documents of the collection dump `" + dump_path + "`.");
+    }
+
+    const bool restored_index_snapshot = collection->load_dumped_index(in);
+    in.close();
+
+    const size_t num_load_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    Option<bool> load_op = index_stored_documents(collection, collection_dump.next_seq_id, batch_size,
+                                                  num_load_threads, *quit, nullptr);
+
+    if(restored_index_snapshot) {
+        collection->clear_restored_fields();
+    }
+
+    if(!load_op.ok()) {
+        store->delete_prefix(collection_prefix);
+        delete collection;
+        return Option<Collection*>(load_op.code(), load_op.error());
+    }
+
+    rocksdb::WriteBatch batch;
+    batch.Put(Collection::get_next_seq_id_key(collection_name),
+              StringUtils::serialize_uint32_t(collection_dump.next_seq_id));
+    batch.Put(Collection::get_meta_key(collection_name), collection_meta.dump());
+    batch.Put(NEXT_COLLECTION_ID_KEY, std::to_string(next_collection_id));
+
+    if(!store->batch_write(batch)) {
+        store->delete_prefix(collection_prefix);
+        delete collection;
+        return Option<Collection*>(500, "Could not write to on-disk storage.");
+    }
+
+    // overrides and synonyms are stored under the name of the collection, so that they get stored afresh
+    for(const std::string& override_json: collection_dump.override_jsons) {
+        override_t override;
+        auto parse_op = override_t::parse(nlohmann::json::parse(override_json), "", override);
+        if(parse_op.ok()) {
+            collection->add_override(override);
+        } else {
+            LOG(ERROR) << "Skipping restoring of override: " << parse_op.error();
+        }
+    }
+
+    for(const std::string& synonym_json: collection_dump.synonym_jsons) {
+        synonym_t synonym(nlohmann::json::parse(synonym_json));
+        collection->add_synonym(synonym);
+    }
+
+    add_to_collections(collection);
+
+    LOG(INFO) << "Restored collection " << collection_name << " off the dump " << dump_path
+              << (restored_index_snapshot ? ", along with its search trees." : ".");
+
+    return Option<Collection*>(collection);
+}
+
 uint32_t CollectionManager::get_next_collection_id() const {
     return next_collection_id;
 }
@@ -504,6 +845,10 @@ Store* CollectionManager::get_store() {
     return store;
 }
 
+Store* CollectionManager::get_meta_store() const {
+    return (batch_indexer == nullptr) ? nullptr : batch_indexer->get_meta_store();
+}
+
 AuthManager& CollectionManager::getAuthManager() {
     return auth_manager;
 }
@@ -581,7 +926,8 @@ Option<bool> add_unsigned_int_list_param(const std::string& param_name, const st
 
 Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& req_params,
                                           nlohmann::json& embedded_params,
-                                          std::string& results_json_str) {
+                                          std::string& results_json_str,
+                                          const std::atomic<bool>* req_disposed) {
     auto begin = std::chrono::high_resolution_clock::now();
 
     const char *NUM_TYPOS = "num_typos";
@@ -600,6 +946,8 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
     const char *FACET_BY = "facet_by";
     const char *FACET_QUERY = "facet_query";
     const char *FACET_QUERY_NUM_TYPOS = "facet_query_num_typos";
+    const char *FACET_SAMPLE_PERCENT = "facet_sample_percent";
+    const char *FACET_SAMPLE_THRESHOLD = "facet_sample_threshold";
     const char *MAX_FACET_VALUES = "max_facet_values";
 
     const char *GROUP_BY = "group_by";
@@ -608,6 +956,8 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
     const char *LIMIT_HITS = "limit_hits";
     const char *PER_PAGE = "per_page";
     const char *PAGE = "page";
+    const char *SEARCH_AFTER = "search_after";
+    const char *VECTOR_QUERY = "vector_query";
     const char *RANK_TOKENS_BY = "rank_tokens_by";
     const char *INCLUDE_FIELDS = "include_fields";
     const char *EXCLUDE_FIELDS = "exclude_fields";
@@ -641,8 +991,13 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
     const char *PRE_SEGMENTED_QUERY = "pre_segmented_query";
 
     const char *SEARCH_CUTOFF_MS = "search_cutoff_ms";
+    const char *LATENCY_BUDGET_MS = "latency_budget_ms";
     const char *EXHAUSTIVE_SEARCH = "exhaustive_search";
     const char *SPLIT_JOIN_TOKENS = "split_join_tokens";
+    const char *ENABLE_TOP_K_PRUNING = "enable_top_k_pruning";
+    const char *EXHAUSTIVE_FOUND = "exhaustive_found";
+    const char *EXPLAIN = "explain";
+    const char *PROFILE = "profile";
 
     // enrich params with values from embedded params
     for(auto& item: embedded_params.items()) {
@@ -684,6 +1039,8 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
     std::vector<sort_by> sort_fields;
     size_t per_page = 10;
     size_t page = 1;
+    std::string search_after_str;
+    std::string vector_query_str;
     token_ordering token_order = NOT_SET;
 
     std::vector<std::string> include_fields_vec;
@@ -694,6 +1051,8 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
     size_t max_facet_values = 10;
     std::string simple_facet_query;
     size_t facet_query_num_typos = 2;
+    size_t facet_sample_percent = 100;
+    size_t facet_sample_threshold = 0;
     size_t snippet_threshold = 30;
     size_t highlight_affix_num_tokens = 4;
     std::string highlight_full_fields;
@@ -712,7 +1071,12 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
     size_t filter_curated_hits_option = 2;
     std::string highlight_fields;
     bool exhaustive_search = false;
+    bool enable_top_k_pruning = false;
+    bool exhaustive_found = true;
+    bool explain = false;
+    bool profile = false;
     size_t search_cutoff_ms = 3600000;
+    size_t latency_budget_ms = 0;
     enable_t split_join_tokens = fallback;
     size_t max_candidates = 0;
     std::vector<enable_t> infixes;
@@ -732,10 +1096,13 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
         {PER_PAGE, &per_page},
         {GROUP_LIMIT, &group_limit},
         {SEARCH_CUTOFF_MS, &search_cutoff_ms},
+        {LATENCY_BUDGET_MS, &latency_budget_ms},
         {MAX_EXTRA_PREFIX, &max_extra_prefix},
         {MAX_EXTRA_SUFFIX, &max_extra_suffix},
         {MAX_CANDIDATES, &max_candidates},
         {FACET_QUERY_NUM_TYPOS, &facet_query_num_typos},
+        {FACET_SAMPLE_PERCENT, &facet_sample_percent},
+        {FACET_SAMPLE_THRESHOLD, &facet_sample_threshold},
         {FILTER_CURATED_HITS, &filter_curated_hits_option},
     };
 
@@ -748,6 +1115,8 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
         {HIGHLIGHT_END_TAG, &highlight_end_tag},
         {PINNED_HITS, &pinned_hits_str},
         {HIDDEN_HITS, &hidden_hits_str},
+        {SEARCH_AFTER, &search_after_str},
+        {VECTOR_QUERY, &vector_query_str},
     };
 
     std::unordered_map<std::string, bool*> bool_values = {
@@ -756,11 +1125,14 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
         {PRE_SEGMENTED_QUERY, &pre_segmented_query},
         {EXHAUSTIVE_SEARCH, &exhaustive_search},
         {ENABLE_OVERRIDES, &enable_overrides},
+        {ENABLE_TOP_K_PRUNING, &enable_top_k_pruning},
+        {EXHAUSTIVE_FOUND, &exhaustive_found},
+        {EXPLAIN, &explain},
+        {PROFILE, &profile},
     };
 
     std::unordered_map<std::string, std::vector<std::string>*> str_list_values = {
         {QUERY_BY, &search_fields},
-        {FACET_BY, &facet_fields},
         {GROUP_BY, &group_by_fields},
         {INCLUDE_FIELDS, &include_fields_vec},
         {EXCLUDE_FIELDS, &exclude_fields_vec},
@@ -824,6 +1196,12 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
                 continue;
             }
 
+            if(key == FACET_BY) {
+                // range facets hold commas of their own
+                StringUtils::split_facet(val, facet_fields);
+                continue;
+            }
+
             auto find_str_list_it = str_list_values.find(key);
             if(find_str_list_it != str_list_values.end()) {
                 StringUtils::split(val, *find_str_list_it->second, ",");
@@ -919,33 +1297,352 @@ Option<bool> CollectionManager::do_search(std::map<std::string, std::string>& re
                                                           max_extra_suffix,
                                                           facet_query_num_typos,
                                                           filter_curated_hits_option,
-                                                          prioritize_token_position
+                                                          prioritize_token_position,
+                                                          enable_top_k_pruning,
+                                                          explain,
+                                                          req_disposed,
+                                                          search_after_str,
+                                                          facet_sample_percent,
+                                                          facet_sample_threshold,
+                                                          vector_query_str,
+                                                          profile || SlowQueryLog::get_instance().is_enabled(),
+                                                          exhaustive_found,
+                                                          latency_budget_ms
                                                         );
 
-    uint64_t timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
+    uint64_t timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(
             std::chrono::high_resolution_clock::now() - begin).count();
+    uint64_t timeMillis = timeMicros / 1000;
 
     AppMetrics::get_instance().increment_count(AppMetrics::SEARCH_LABEL, 1);
     AppMetrics::get_instance().increment_duration(AppMetrics::SEARCH_LABEL, timeMillis);
+    AppMetrics::get_instance().record_latency(AppMetrics::SEARCH_LABEL, timeMicros);
+    AppMetrics::get_instance().record_latency(AppMetrics::SEARCH_LABEL + " " + collection->get_name(), timeMicros);
 
     if(!result_op.ok()) {
         return Option<bool>(result_op.code(), result_op.error());
     }
 
-    nlohmann::json result = result_op.get();
+    nlohmann::json result = std::move(result_op).get();
+
+    HotQueryLog::get_instance().record(req_params, http_req::AUTH_HEADER);
+
+    bool is_slow = false;
+    if(SlowQueryLog::get_instance().should_log(timeMillis, is_slow)) {
+        nlohmann::json entry;
+        entry["timestamp_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        entry["collection"] = collection->get_name();
+        entry["slow"] = is_slow;
+        entry["search_time_ms"] = timeMillis;
+        entry["found"] = result.value("found", size_t(0));
+        entry["num_hits"] = result.count("hits") != 0 ? result["hits"].size() :
+                            (result.count("grouped_hits") != 0 ? result["grouped_hits"].size() : 0);
+
+        nlohmann::json params = nlohmann::json::object();
+        for(const auto& kv: req_params) {
+            if(kv.first != http_req::AUTH_HEADER) {
+                params[kv.first] = kv.second;
+            }
+        }
+
+        entry["params"] = std::move(params);
+
+        if(result.count("profile") != 0) {
+            entry["profile"] = result["profile"];
+        }
+
+        SlowQueryLog::get_instance().log(entry.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore));
+    }
+
+    if(!profile) {
+        // profiling was only turned on for the slow query log
+        result.erase("profile");
+    }
 
     if(exclude_fields.count("search_time_ms") == 0) {
         result["search_time_ms"] = timeMillis;
     }
 
     result["page"] = page;
-    results_json_str = result.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
+
+    if(http_req::is_msgpack_format(req_params)) {
+        const std::vector<uint8_t>& result_msgpack = nlohmann::json::to_msgpack(result);
+        results_json_str.assign(result_msgpack.begin(), result_msgpack.end());
+    } else {
+        results_json_str = result.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
+    }
 
     //LOG(INFO) << "Time taken: " << timeMillis << "ms";
 
     return Option<bool>(true);
 }
 
+Option<bool> CollectionManager::do_union(std::vector<std::map<std::string, std::string>>& searches_params,
+                                         std::vector<nlohmann::json>& embedded_params_vec,
+                                         std::string& results_json_str,
+                                         const std::atomic<bool>* req_disposed) {
+    if(searches_params.empty()) {
+        return Option<bool>(400, "A union search needs at least one search.");
+    }
+
+    auto& first_params = searches_params[0];
+    size_t page = 1, per_page = 10;
+
+    if((first_params.count("page") != 0 && !StringUtils::is_uint32_t(first_params["page"])) ||
+       (first_params.count("per_page") != 0 && !StringUtils::is_uint32_t(first_params["per_page"]))) {
+        return Option<bool>(400, "Parameters `page` and `per_page` must be positive integers.");
+    }
+
+    if(first_params.count("page") != 0) {
+        page = std::max<size_t>(1, std::stoul(first_params["page"]));
+    }
+
+    if(first_params.count("per_page") != 0) {
+        per_page = std::stoul(first_params["per_page"]);
+    }
+
+    if(page * per_page > Collection::PER_PAGE_MAX) {
+        return Option<bool>(400, "A union search can only fetch upto " + std::to_string(Collection::PER_PAGE_MAX) +
+                                 " hits: `page` * `per_page` is too large.");
+    }
+
+    // the hits of the shards can only be merged when they are ranked alike
+    const std::string sort_by_str = first_params["sort_by"];
+    std::vector<sort_by> sort_fields;
+
+    if(!parse_sort_by_str(sort_by_str, sort_fields)) {
+        return Option<bool>(400, "Parameter `sort_by` is malformed.");
+    }
+
+    if(sort_fields.empty()) {
+        sort_fields.emplace_back(sort_field_const::text_match, sort_field_const::desc);
+
+        auto collection = get_instance().get_collection(first_params["collection"]);
+        if(collection != nullptr && !collection->get_default_sorting_field().empty()) {
+            sort_fields.emplace_back(collection->get_default_sorting_field(), sort_field_const::desc);
+        }
+    }
+
+    size_t max_facet_values = 10;
+
+    if(first_params.count("max_facet_values") != 0) {
+        if(!StringUtils::is_uint32_t(first_params["max_facet_values"])) {
+            return Option<bool>(400, "Parameter `max_facet_values` must be a positive integer.");
+        }
+
+        max_facet_values = std::stoul(first_params["max_facet_values"]);
+    }
+
+    // a value can miss the top values of a shard and still make the merged top values, so every shard is asked for
+    // more values than are returned, to make the merged counts of the top values more accurate
+    const size_t shard_max_facet_values = max_facet_values + max_facet_values / 2 + UNION_FACET_OVER_FETCH;
+
+    // the shards answer in JSON whatever the format of the merged results
+    const bool is_msgpack = http_req::is_msgpack_format(first_params);
+
+    for(auto& search_params: searches_params) {
+        search_params.erase(http_req::RESPONSE_FORMAT);
+
+        if(search_params["sort_by"] != sort_by_str) {
+            return Option<bool>(400, "Every search of a union search must have the same `sort_by`.");
+        }
+
+        // every shard may hold all the hits up to the asked page
+        search_params["page"] = "1";
+        search_params["per_page"] = std::to_string(page * per_page);
+        search_params["max_facet_values"] = std::to_string(shard_max_facet_values);
+    }
+
+    // the shards are searched at the same time: the searches of an index run on the thread pool, so these threads
+    // only wait on them, and must not be taken from the pool themselves
+    std::vector<std::string> shard_results_strs(searches_params.size());
+    std::vector<Option<bool>> search_ops(searches_params.size(), Option<bool>(true));
+    std::vector<std::thread> search_threads;
+
+    for(size_t i = 1; i < searches_params.size(); i++) {
+        search_threads.emplace_back([&, i]() {
+            search_ops[i] = do_search(searches_params[i], embedded_params_vec[i], shard_results_strs[i], req_disposed);
+        });
+    }
+
+    search_ops[0] = do_search(searches_params[0], embedded_params_vec[0], shard_results_strs[0], req_disposed);
+
+    for(auto& search_thread: search_threads) {
+        search_thread.join();
+    }
+
+    std::vector<nlohmann::json> results(searches_params.size());
+
+    for(size_t i = 0; i < searches_params.size(); i++) {
+        if(!search_ops[i].ok()) {
+            return Option<bool>(search_ops[i].code(), "Search " + std::to_string(i) + " failed: " +
+                                                      search_ops[i].error());
+        }
+
+        results[i] = nlohmann::json::parse(shard_results_strs[i]);
+        shard_results_strs[i].clear();
+    }
+
+    // value of a hit for a sort field, which is null when the hit does not have it
+    auto get_sort_value = [](const nlohmann::json& hit, const sort_by& sort_field) -> nlohmann::json {
+        if(sort_field.name == sort_field_const::text_match) {
+            return hit.contains("text_match") ? hit["text_match"] : nlohmann::json();
+        }
+
+        if(sort_field.geopoint != 0) {
+            return (hit.contains("geo_distance_meters") && hit["geo_distance_meters"].contains(sort_field.name)) ?
+                   hit["geo_distance_meters"][sort_field.name] : nlohmann::json();
+        }
+
+        const auto& document = hit["document"];
+        return (document.contains(sort_field.name) && document[sort_field.name].is_number()) ?
+               document[sort_field.name] : nlohmann::json();
+    };
+
+    // (search index, hit index) of every hit, with its sort values
+    std::vector<std::pair<std::pair<size_t, size_t>, std::vector<nlohmann::json>>> hit_refs;
+    nlohmann::json merged_result;
+    size_t found = 0, out_of = 0, search_time_ms = 0;
+    merged_result["union_request_params"] = nlohmann::json::array();
+
+    for(size_t i = 0; i < results.size(); i++) {
+        auto& result = results[i];
+
+        found += result.value("found", size_t(0));
+        out_of += result.value("out_of", size_t(0));
+        search_time_ms = std::max(search_time_ms, result.value("search_time_ms", size_t(0)));
+        merged_result["union_request_params"].push_back(result["request_params"]);
+
+        if(!result.contains("hits")) {
+            continue;
+        }
+
+        for(size_t j = 0; j < result["hits"].size(); j++) {
+            std::vector<nlohmann::json> sort_values;
+            for(const auto& sort_field: sort_fields) {
+                sort_values.push_back(get_sort_value(result["hits"][j], sort_field));
+            }
+
+            hit_refs.emplace_back(std::make_pair(i, j), std::move(sort_values));
+        }
+    }
+
+    // curated hits come first, and hits without a sort value come after those that have it
+    std::stable_sort(hit_refs.begin(), hit_refs.end(), [&](const auto& a, const auto& b) {
+        const bool a_curated = results[a.first.first]["hits"][a.first.second].value("curated", false);
+        const bool b_curated = results[b.first.first]["hits"][b.first.second].value("curated", false);
+
+        if(a_curated != b_curated) {
+            return a_curated;
+        }
+
+        for(size_t k = 0; k < sort_fields.size(); k++) {
+            const auto& a_value = a.second[k];
+            const auto& b_value = b.second[k];
+
+            if(a_value == b_value) {
+                continue;
+            }
+
+            if(a_value.is_null() || b_value.is_null()) {
+                return b_value.is_null();
+            }
+
+            return (sort_fields[k].order == sort_field_const::asc) ? (a_value < b_value) : (b_value < a_value);
+        }
+
+        return false;
+    });
+
+    merged_result["hits"] = nlohmann::json::array();
+
+    for(size_t k = (page - 1) * per_page; k < hit_refs.size() && k < page * per_page; k++) {
+        auto& hit = results[hit_refs[k].first.first]["hits"][hit_refs[k].first.second];
+        hit["search_index"] = hit_refs[k].first.first;
+        merged_result["hits"].push_back(std::move(hit));
+    }
+
+    // facet counts of the same field are summed over the shards, before the top values are kept
+    merged_result["facet_counts"] = nlohmann::json::array();
+    std::vector<std::string> facet_field_names;
+    std::map<std::string, nlohmann::json> facet_results;
+    std::map<std::string, std::map<std::string, nlohmann::json>> facet_value_counts;
+
+    for(auto& result: results) {
+        if(!result.contains("facet_counts")) {
+            continue;
+        }
+
+        for(auto& facet_result: result["facet_counts"]) {
+            const std::string& field_name = facet_result["field_name"];
+
+            if(facet_results.count(field_name) == 0) {
+                facet_field_names.push_back(field_name);
+                facet_results[field_name] = facet_result;
+                facet_results[field_name]["stats"] = nlohmann::json::object();
+            }
+
+            auto& merged_stats = facet_results[field_name]["stats"];
+            const auto& stats = facet_result["stats"];
+
+            if(stats.contains("min")) {
+                merged_stats["min"] = merged_stats.contains("min") ?
+                                      std::min(merged_stats["min"].get<double>(), stats["min"].get<double>()) :
+                                      stats["min"].get<double>();
+                merged_stats["max"] = merged_stats.contains("max") ?
+                                      std::max(merged_stats["max"].get<double>(), stats["max"].get<double>()) :
+                                      stats["max"].get<double>();
+                merged_stats["sum"] = merged_stats.value("sum", 0.0) + stats["sum"].get<double>();
+            }
+
+            auto& value_counts = facet_value_counts[field_name];
+
+            for(auto& facet_count: facet_result["counts"]) {
+                const std::string& value = facet_count["value"];
+                auto value_count_it = value_counts.find(value);
+
+                if(value_count_it == value_counts.end()) {
+                    value_counts.emplace(value, facet_count);
+                } else {
+                    value_count_it->second["count"] = value_count_it->second["count"].get<size_t>() +
+                                                      facet_count["count"].get<size_t>();
+                }
+            }
+        }
+    }
+
+    for(const auto& field_name: facet_field_names) {
+        std::vector<nlohmann::json> counts;
+        for(auto& value_count: facet_value_counts[field_name]) {
+            counts.push_back(std::move(value_count.second));
+        }
+
+        std::stable_sort(counts.begin(), counts.end(), [](const nlohmann::json& a, const nlohmann::json& b) {
+            return a["count"].get<size_t>() > b["count"].get<size_t>();
+        });
+
+        counts.resize(std::min(counts.size(), max_facet_values));
+
+        auto& facet_result = facet_results[field_name];
+        facet_result["counts"] = counts;
+        merged_result["facet_counts"].push_back(std::move(facet_result));
+    }
+
+    merged_result["found"] = found;
+    merged_result["out_of"] = out_of;
+    merged_result["page"] = page;
+    merged_result["search_time_ms"] = search_time_ms;
+
+    if(is_msgpack) {
+        const std::vector<uint8_t>& result_msgpack = nlohmann::json::to_msgpack(merged_result);
+        results_json_str.assign(result_msgpack.begin(), result_msgpack.end());
+    } else {
+        results_json_str = merged_result.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
+    }
+    return Option<bool>(true);
+}
+
 ThreadPool* CollectionManager::get_thread_pool() const {
     return thread_pool;
 }
@@ -964,11 +1661,266 @@ nlohmann::json CollectionManager::get_collection_summaries() const {
     return json_summaries;
 }
 
+nlohmann::json CollectionManager::get_load_progress() const {
+    nlohmann::json progress = nlohmann::json::object();
+
+    if(loading) {
+        progress["collections_loaded"] = num_collections_loaded.load();
+        progress["collections_total"] = num_collections_to_load.load();
+        progress["documents_loaded"] = num_documents_loaded.load();
+    }
+
+    if(warming) {
+        progress["queries_warmed"] = num_queries_warmed.load();
+        progress["queries_to_warm"] = num_queries_to_warm.load();
+    }
+
+    return progress;
+}
+
+void CollectionManager::warm_up(std::vector<hot_query_t>&& hot_queries) {
+    if(warming.exchange(true)) {
+        return;
+    }
+
+    num_queries_to_warm = hot_queries.size();
+    num_queries_warmed = 0;
+
+    LOG(INFO) << "Warming up the caches with " << hot_queries.size() << " hot queries.";
+
+    thread_pool->enqueue_task(task_priority_t::BACKGROUND, task_kind_t::OTHER,
+                              [this, hot_queries = std::move(hot_queries)]() mutable {
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        for(hot_query_t& hot_query: hot_queries) {
+            if(quit->load() || num_queries_warmed >= num_queries_to_warm) {
+                break;
+            }
+
+            // searches of collections dropped since are turned down like any other
+            nlohmann::json embedded_params = nlohmann::json::object();
+            std::string results_json_str;
+            do_search(hot_query.params, embedded_params, results_json_str);
+
+            num_queries_warmed++;
+        }
+
+        auto time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now() - begin).count();
+        LOG(INFO) << "Replayed " << num_queries_warmed << " hot queries in " << time_ms << " ms.";
+
+        warming = false;
+    });
+}
+
+bool CollectionManager::is_warming() const {
+    return warming;
+}
+
+std::string CollectionManager::get_index_snapshot_path(const std::string& dir_path, uint32_t collection_id) {
+    return dir_path + "/" + std::to_string(collection_id) + ".idx";
+}
+
+Option<bool> CollectionManager::save_index_snapshots(const std::string& dir_path, uint64_t store_seq_number) const {
+    std::shared_lock lock(mutex);
+
+    for(const auto& name_collection: collections) {
+        Collection* collection = name_collection.second;
+
+        // the empty index of a hibernated collection must not pass for its search trees, so it is loaded in full
+        if(collection->is_hibernated()) {
+            continue;
+        }
+
+        const std::string& snapshot_path = get_index_snapshot_path(dir_path, collection->get_collection_id());
+
+        Option<bool> save_op = collection->save_index_snapshot(snapshot_path, store_seq_number);
+        if(!save_op.ok()) {
+            return save_op;
+        }
+    }
+
+    return Option<bool>(true);
+}
+
+void CollectionManager::set_index_snapshot_dir(const std::string& dir_path) {
+    index_snapshot_dir = dir_path;
+}
+
+void CollectionManager::set_static_rank_seq_ids(bool enabled) {
+    static_rank_seq_ids = enabled;
+}
+
+Option<bool> CollectionManager::set_hibernation(uint32_t idle_s, const std::string& dir_path) {
+    // snapshots left over from a previous run are of no use, since every collection is loaded in full on start up
+    delete_path(dir_path);
+
+    if(!create_directory(dir_path)) {
+        return Option<bool>(500, "Could not create the hibernation directory " + dir_path);
+    }
+
+    hibernation_idle_s = idle_s;
+    hibernation_dir = dir_path;
+    return Option<bool>(true);
+}
+
+void CollectionManager::hibernate_idle_collections(uint64_t now_s) {
+    if(hibernation_idle_s == 0 || hibernating.exchange(true)) {
+        return;
+    }
+
+    thread_pool->enqueue_task(task_priority_t::BACKGROUND, task_kind_t::OTHER, [this, now_s]() {
+        hibernate_idle_collections_now(now_s);
+        hibernating = false;
+    });
+}
+
+void CollectionManager::hibernate_idle_collections_now(uint64_t now_s) {
+    struct idle_collection_t {
+        std::string name;
+        Collection* collection;
+        std::string snapshot_path;
+        uint64_t generation;
+    };
+
+    std::vector<idle_collection_t> idle_collections;
+
+    // the snapshots are taken while requests go on, and a collection that gets written to or used in the meantime
+    // is left alone
+    {
+        std::shared_lock lock(mutex);
+
+        for(const auto& name_collection: collections) {
+            Collection* collection = name_collection.second;
+            if(collection->is_hibernated() || collection->get_last_used_s() + hibernation_idle_s > now_s) {
+                continue;
+            }
+
+            const std::string& snapshot_path = get_index_snapshot_path(hibernation_dir,
+                                                                       collection->get_collection_id());
+            Option<uint64_t> save_op = collection->save_hibernation_snapshot(snapshot_path);
+
+            if(!save_op.ok()) {
+                LOG(ERROR) << "Could not hibernate collection " << name_collection.first << ": " << save_op.error();
+                std::remove(snapshot_path.c_str());
+                continue;
+            }
+
+            idle_collections.push_back({name_collection.first, collection, snapshot_path, save_op.get()});
+        }
+    }
+
+    if(idle_collections.empty()) {
+        return;
+    }
+
+    std::vector<Index*> hibernated_indices;
+
+    {
+        // no request holds any of the collections, so that their indices can be freed once they are swapped out
+        std::unique_lock lock(mutex);
+
+        for(const auto& idle_collection: idle_collections) {
+            const auto it = collections.find(idle_collection.name);
+            Index* hibernated_index = nullptr;
+
+            if(it != collections.end() && it->second == idle_collection.collection &&
+               idle_collection.collection->get_last_used_s() + hibernation_idle_s <= now_s) {
+                hibernated_index = idle_collection.collection->hibernate(idle_collection.generation,
+                                                                         idle_collection.snapshot_path);
+            }
+
+            if(hibernated_index == nullptr) {
+                std::remove(idle_collection.snapshot_path.c_str());
+                continue;
+            }
+
+            hibernated_indices.push_back(hibernated_index);
+            LOG(INFO) << "Hibernating collection " << idle_collection.name;
+        }
+    }
+
+    for(Index* hibernated_index: hibernated_indices) {
+        delete hibernated_index;
+    }
+
+    if(!hibernated_indices.empty()) {
+        SystemMetrics::release_free_memory();
+    }
+}
+
+void CollectionManager::set_posting_compaction_rate(size_t lists_per_call) {
+    posting_compaction_rate = lists_per_call;
+}
+
+void CollectionManager::compact_postings() {
+    if(posting_compaction_rate == 0 || compacting.exchange(true)) {
+        return;
+    }
+
+    const size_t max_lists = posting_compaction_rate;
+
+    thread_pool->enqueue_task(task_priority_t::BACKGROUND, task_kind_t::OTHER, [this, max_lists]() {
+        compact_postings_now(max_lists);
+        compacting = false;
+    });
+}
+
+void CollectionManager::compact_postings_now(size_t max_lists) {
+    std::shared_lock lock(mutex);
+    size_t num_lists = 0;
+
+    for(const auto& name_collection: collections) {
+        Collection* collection = name_collection.second;
+
+        while(num_lists < max_lists && !collection->is_hibernated()) {
+            const size_t slice = std::min(POSTING_COMPACTION_SLICE, max_lists - num_lists);
+            const size_t num_slice_lists = collection->compact_postings(slice);
+            num_lists += num_slice_lists;
+
+            if(num_slice_lists < slice) {
+                break;
+            }
+
+            // the searches that waited for the slice go before the next one
+            std::this_thread::yield();
+        }
+
+        if(num_lists >= max_lists) {
+            break;
+        }
+    }
+}
+
+std::vector<std::string> CollectionManager::get_expiry_paths(uint64_t now_s, size_t batch_size) const {
+    std::shared_lock lock(mutex);
+    std::vector<std::string> paths;
+
+    for(const auto& kv: collections) {
+        // expired documents of a hibernated collection are left for when it is used again, rather than waking it
+        const std::string& ttl_field = kv.second->get_ttl_field();
+        if(ttl_field.empty() || kv.second->is_hibernated()) {
+            continue;
+        }
+
+        const std::string& filter_by = ttl_field + ":<=" + std::to_string(now_s);
+        paths.push_back("/collections/" + StringUtils::url_encode(kv.first) + "/documents?filter_by=" +
+                        StringUtils::url_encode(filter_by) + "&batch_size=" + std::to_string(batch_size));
+    }
+
+    return paths;
+}
+
 Option<Collection*> CollectionManager::create_collection(nlohmann::json& req_json) {
     const char* NUM_MEMORY_SHARDS = "num_memory_shards";
     const char* SYMBOLS_TO_INDEX = "symbols_to_index";
     const char* TOKEN_SEPARATORS = "token_separators";
     const char* DEFAULT_SORTING_FIELD = "default_sorting_field";
+    const char* POSTING_CODEC = "posting_codec";
+    const char* TTL_FIELD = "ttl_field";
+    const char* DOCUMENT_ENCODING = "document_encoding";
+    const char* SUMMARY_FIELDS = "summary_fields";
+    const char* MEMORY_QUOTA_BYTES = "memory_quota_bytes";
 
     // validate presence of mandatory fields
 
@@ -1034,6 +1986,61 @@ Option<Collection*> CollectionManager::create_collection(nlohmann::json& req_jso
         return Option<Collection*>(400, std::string("`") + NUM_MEMORY_SHARDS + "` should be a positive integer.");
     }
 
+    if(num_memory_shards > Collection::MAX_NUM_MEMORY_SHARDS) {
+        return Option<Collection*>(400, std::string("`") + NUM_MEMORY_SHARDS + "` can be at most " +
+                                        std::to_string(Collection::MAX_NUM_MEMORY_SHARDS) + ".");
+    }
+
+    posting_codec_t posting_codec = FOR_CODEC;
+
+    if(req_json.count(POSTING_CODEC) != 0) {
+        if(!req_json[POSTING_CODEC].is_string() ||
+           !PostingCodec::parse(req_json[POSTING_CODEC].get<std::string>(), posting_codec)) {
+            return Option<Collection*>(400, std::string("`") + POSTING_CODEC + "` should be one of `" +
+                                            PostingCodec::FOR_NAME + "`, `" + PostingCodec::STREAM_VBYTE_NAME +
+                                            "` or `" + PostingCodec::ROARING_NAME + "`.");
+        }
+    }
+
+    document_encoding_t document_encoding = JSON_ENCODING;
+
+    if(req_json.count(DOCUMENT_ENCODING) != 0) {
+        if(!req_json[DOCUMENT_ENCODING].is_string() ||
+           !document_codec_t::parse(req_json[DOCUMENT_ENCODING].get<std::string>(), document_encoding)) {
+            return Option<Collection*>(400, std::string("`") + DOCUMENT_ENCODING + "` should be either `" +
+                                            document_codec_t::JSON_NAME + "` or `" +
+                                            document_codec_t::COMPACT_NAME + "`.");
+        }
+    }
+
+    std::vector<std::string> summary_fields;
+
+    if(req_json.count(SUMMARY_FIELDS) != 0) {
+        const auto& summary_fields_json = req_json[SUMMARY_FIELDS];
+        bool is_valid = summary_fields_json.is_array();
+
+        for(size_t i = 0; is_valid && i < summary_fields_json.size(); i++) {
+            is_valid = summary_fields_json[i].is_string() && !summary_fields_json[i].get<std::string>().empty();
+        }
+
+        if(!is_valid) {
+            return Option<Collection*>(400, std::string("`") + SUMMARY_FIELDS + "` should be an array of "
+                                            "field names.");
+        }
+
+        summary_fields = summary_fields_json.get<std::vector<std::string>>();
+    }
+
+    uint64_t memory_quota_bytes = 0;
+
+    if(req_json.count(MEMORY_QUOTA_BYTES) != 0) {
+        if(!req_json[MEMORY_QUOTA_BYTES].is_number_unsigned() || req_json[MEMORY_QUOTA_BYTES].get<uint64_t>() == 0) {
+            return Option<Collection*>(400, std::string("`") + MEMORY_QUOTA_BYTES + "` should be a positive integer.");
+        }
+
+        memory_quota_bytes = req_json[MEMORY_QUOTA_BYTES].get<uint64_t>();
+    }
+
     // field specific validation
 
     if(!req_json["fields"].is_array() || req_json["fields"].empty()) {
@@ -1051,19 +2058,41 @@ Option<Collection*> CollectionManager::create_collection(nlohmann::json& req_jso
         return Option<Collection*>(parse_op.code(), parse_op.error());
     }
 
+    std::string ttl_field;
+
+    if(req_json.count(TTL_FIELD) != 0) {
+        if(!req_json[TTL_FIELD].is_string()) {
+            return Option<Collection*>(400, std::string("`") + TTL_FIELD + "` should be the name of a field.");
+        }
+
+        ttl_field = req_json[TTL_FIELD].get<std::string>();
+
+        auto ttl_field_it = std::find_if(fields.begin(), fields.end(), [&ttl_field](const field& f) {
+            return f.name == ttl_field;
+        });
+
+        if(ttl_field_it == fields.end() || ttl_field_it->type != field_types::INT64 || !ttl_field_it->index) {
+            return Option<Collection*>(400, std::string("`") + TTL_FIELD + "` should be the name of an indexed "
+                                            "field of type `int64`.");
+        }
+    }
+
     const auto created_at = static_cast<uint64_t>(std::time(nullptr));
 
     return CollectionManager::get_instance().create_collection(req_json["name"], num_memory_shards,
                                                                 fields, default_sorting_field, created_at,
                                                                 fallback_field_type,
                                                                 req_json[SYMBOLS_TO_INDEX],
-                                                                req_json[TOKEN_SEPARATORS]);
+                                                                req_json[TOKEN_SEPARATORS],
+                                                                posting_codec, ttl_field, document_encoding,
+                                                                summary_fields, memory_quota_bytes);
 }
 
 Option<bool> CollectionManager::load_collection(const nlohmann::json &collection_meta,
                                                 const size_t batch_size,
                                                 const StoreStatus& next_coll_id_status,
-                                                const std::atomic<bool>& quit) {
+                                                const std::atomic<bool>& quit,
+                                                const size_t num_load_threads) {
 
     auto& cm = CollectionManager::get_instance();
 
@@ -1138,61 +2167,149 @@ Option<bool> CollectionManager::load_collection(const nlohmann::json &collection
         collection->add_synonym(synonym);
     }
 
-    // Fetch records from the store and re-create memory index
+    // a renumbered collection no longer matches the snapshot of its index
+    bool renumbered = false;
+
+    if(cm.static_rank_seq_ids && !collection->get_default_sorting_field().empty()) {
+        auto renumber_op = collection->renumber_by_default_sorting_field(batch_size);
+
+        if(!renumber_op.ok()) {
+            return Option<bool>(renumber_op.code(), renumber_op.error());
+        }
+
+        if(renumber_op.get() != 0) {
+            renumbered = true;
+            collection_next_seq_id = collection->peek_next_seq_id();
+            LOG(INFO) << "Renumbered " << renumber_op.get() << " documents of collection " << this_collection_name
+                      << " by " << collection->get_default_sorting_field() << ".";
+        }
+    }
+
+    // tokens of the plain string fields need not be indexed again when their trees can be restored
+    bool restored_index_snapshot = false;
+
+    if(!cm.index_snapshot_dir.empty() && !renumbered) {
+        const std::string& snapshot_path = get_index_snapshot_path(cm.index_snapshot_dir,
+                                                                   collection->get_collection_id());
+        restored_index_snapshot = collection->load_index_snapshot(snapshot_path, cm.index_snapshot_seq_number);
+
+        if(restored_index_snapshot) {
+            LOG(INFO) << "Restored the search index of collection " << this_collection_name << " off its snapshot.";
+        }
+    }
+
+    Option<bool> load_op = index_stored_documents(collection, collection_next_seq_id, batch_size, num_load_threads,
+                                                  quit, &cm.num_documents_loaded);
+
+    if(restored_index_snapshot) {
+        collection->clear_restored_fields();
+    }
+
+    if(!load_op.ok()) {
+        return load_op;
+    }
+
+    cm.add_to_collections(collection);
+
+    return Option<bool>(true);
+}
+
+Option<bool> CollectionManager::index_stored_documents(Collection* collection, const uint32_t collection_next_seq_id,
+                                                       const size_t batch_size, const size_t num_load_threads,
+                                                       const std::atomic<bool>& quit,
+                                                       std::atomic<size_t>* num_documents_loaded) {
+    auto& cm = CollectionManager::get_instance();
+
+    // Fetch records from the store and re-create memory index: the seq_id space is cut into chunks of `batch_size`
+    // ids, which are read, parsed and preprocessed ahead on `num_load_threads` threads, each with its own iterator.
+    // Chunks are indexed in order, so that ids keep being appended to the posting lists.
     const std::string seq_id_prefix = collection->get_seq_id_collection_prefix();
 
-    rocksdb::Iterator* iter = cm.store->scan(seq_id_prefix);
-    std::unique_ptr<rocksdb::Iterator> iter_guard(iter);
+    // the last chunk runs to the end of the collection's keys
+    const size_t num_chunks = (collection_next_seq_id / batch_size) + 1;
 
-    std::vector<index_record> index_records;
+    struct loaded_chunk_t {
+        std::vector<index_record> index_records;
+        size_t num_found_docs = 0;
+        bool bad_json = false;
+    };
 
-    size_t num_found_docs = 0;
-    size_t num_valid_docs = 0;
-    size_t num_indexed_docs = 0;
+    auto load_chunk = [&cm, collection, &seq_id_prefix, batch_size, num_chunks](size_t chunk) {
+        loaded_chunk_t loaded_chunk;
 
-    auto begin = std::chrono::high_resolution_clock::now();
+        const bool is_last_chunk = (chunk == num_chunks - 1);
+        const std::string& end_key = is_last_chunk ? "" : collection->get_seq_id_key((chunk + 1) * batch_size);
 
-    while(iter->Valid() && iter->key().starts_with(seq_id_prefix)) {
-        num_found_docs++;
-        const uint32_t seq_id = Collection::get_seq_id_from_key(iter->key().ToString());
+        std::unique_ptr<rocksdb::Iterator> iter(cm.store->scan(collection->get_seq_id_key(chunk * batch_size)));
 
-        nlohmann::json document;
+        while(iter->Valid() && iter->key().starts_with(seq_id_prefix) &&
+              (is_last_chunk || iter->key().compare(end_key) < 0)) {
+            loaded_chunk.num_found_docs++;
+            const uint32_t seq_id = Collection::get_seq_id_from_key(iter->key().ToString());
 
-        try {
-            document = nlohmann::json::parse(iter->value().ToString());
-        } catch(const std::exception& e) {
-            LOG(ERROR) << "JSON error: " << e.what();
-            return Option<bool>(false, "Bad JSON.");
+            // parsed off the iterator's slice rather than a copy of it
+            nlohmann::json document;
+            if(!collection->decode_document(iter->value().data(), iter->value().size(), document)) {
+                LOG(ERROR) << "JSON error while loading document with seq_id " << seq_id;
+                loaded_chunk.bad_json = true;
+                return loaded_chunk;
+            }
+
+            auto dirty_values = DIRTY_VALUES::DROP;
+            loaded_chunk.index_records.emplace_back(index_record(0, seq_id, std::move(document), CREATE, dirty_values));
+            iter->Next();
         }
 
-        auto dirty_values = DIRTY_VALUES::DROP;
+        collection->batch_preprocess_in_memory(loaded_chunk.index_records);
+        return loaded_chunk;
+    };
 
-        num_valid_docs++;
+    ThreadPool load_pool(num_load_threads);
+    std::deque<std::future<loaded_chunk_t>> chunk_futures;
+    size_t next_chunk = 0;
 
-        index_records.emplace_back(index_record(0, seq_id, document, CREATE, dirty_values));
+    Option<bool> load_op(true);
 
-        // Peek and check for last record right here so that we handle batched indexing correctly
-        // Without doing this, the "last batch" would have to be indexed outside the loop.
-        iter->Next();
-        bool last_record = !(iter->Valid() && iter->key().starts_with(seq_id_prefix));
+    size_t num_found_docs = 0;
+    size_t num_indexed_docs = 0;
 
-        // batch must match atleast the number of shards
-        if((num_valid_docs % batch_size == 0) || last_record) {
-            size_t num_records = index_records.size();
-            size_t num_indexed = collection->batch_index_in_memory(index_records);
+    auto begin = std::chrono::high_resolution_clock::now();
 
-            if(num_indexed != num_records) {
-                const Option<std::string> & index_error_op = get_first_index_error(index_records);
-                if(!index_error_op.ok()) {
-                    return Option<bool>(false, index_error_op.get());
-                }
+    for(size_t chunk = 0; chunk < num_chunks; chunk++) {
+        // keep a couple of chunks per thread in flight
+        while(next_chunk < num_chunks && next_chunk < chunk + (2 * num_load_threads)) {
+            chunk_futures.push_back(load_pool.enqueue(load_chunk, next_chunk));
+            next_chunk++;
+        }
+
+        loaded_chunk_t loaded_chunk = chunk_futures.front().get();
+        chunk_futures.pop_front();
+
+        if(loaded_chunk.bad_json) {
+            load_op = Option<bool>(false, "Bad JSON.");
+            break;
+        }
+
+        num_found_docs += loaded_chunk.num_found_docs;
+
+        std::vector<index_record>& index_records = loaded_chunk.index_records;
+        size_t num_records = index_records.size();
+        size_t num_indexed = collection->batch_index_preprocessed_in_memory(index_records);
+
+        if(num_indexed != num_records) {
+            const Option<std::string> & index_error_op = get_first_index_error(index_records);
+            if(!index_error_op.ok()) {
+                load_op = Option<bool>(false, index_error_op.get());
+                break;
             }
+        }
 
-            index_records.clear();
-            num_indexed_docs += num_indexed;
+        num_indexed_docs += num_indexed;
+        if(num_documents_loaded != nullptr) {
+            *num_documents_loaded += num_indexed;
         }
 
-        if(num_found_docs % ((1 << 14)) == 0) {
+        if(chunk % 16 == 0) {
             // having a cheaper higher layer check to prevent checking clock too often
             auto time_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
                     std::chrono::high_resolution_clock::now() - begin).count();
@@ -1208,7 +2325,12 @@ Option<bool> CollectionManager::load_collection(const nlohmann::json &collection
         }
     }
 
-    cm.add_to_collections(collection);
+    // chunks still in flight must be done before the pool goes away
+    load_pool.shutdown();
+
+    if(!load_op.ok()) {
+        return load_op;
+    }
 
     LOG(INFO) << "Indexed " << num_indexed_docs << "/" << num_found_docs
               << " documents into collection " << collection->get_name();
@@ -0,0 +1,180 @@
+#include "compact_list_arena.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+char* CompactListArena::new_slab() {
+    std::unique_lock lock(extent_mutex);
+
+    if(mapped_fd == -1) {
+        return (char*) malloc(SLAB_BYTES);
+    }
+
+    if(extent_tail_bytes < SLAB_BYTES) {
+        if(ftruncate(mapped_fd, mapped_file_bytes + MAPPED_EXTENT_BYTES) != 0) {
+            return nullptr;
+        }
+
+        void* extent = mmap(nullptr, MAPPED_EXTENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, mapped_fd,
+                            mapped_file_bytes);
+        if(extent == MAP_FAILED) {
+            return nullptr;
+        }
+
+        mapped_file_bytes += MAPPED_EXTENT_BYTES;
+        extent_tail = (char*) extent;
+        extent_tail_bytes = MAPPED_EXTENT_BYTES;
+    }
+
+    char* slab = extent_tail;
+    extent_tail += SLAB_BYTES;
+    extent_tail_bytes -= SLAB_BYTES;
+
+    return slab;
+}
+
+void* CompactListArena::allocate(size_t num_bytes) {
+    if(num_bytes > MAX_SLOT_BYTES) {
+        void* ptr = malloc(num_bytes);
+        if(ptr == nullptr) {
+            abort();
+        }
+
+        num_large_allocations++;
+        large_allocated_bytes += num_bytes;
+        return ptr;
+    }
+
+    const size_t class_index = size_class_of(std::max<size_t>(num_bytes, 1));
+    const size_t slot_bytes = (class_index + 1) * SIZE_CLASS_BYTES;
+    size_class_t& size_class = size_classes[class_index];
+
+    std::unique_lock lock(size_class.mutex);
+    size_class.num_allocated++;
+
+    if(size_class.free_list != nullptr) {
+        void* ptr = size_class.free_list;
+        size_class.free_list = *(void**)(ptr);
+        return ptr;
+    }
+
+    if(size_class.slab_tail_bytes < slot_bytes) {
+        char* slab = new_slab();
+        if(slab == nullptr) {
+            abort();
+        }
+
+        size_class.slabs.push_back(slab);
+        size_class.slab_tail = slab;
+        size_class.slab_tail_bytes = SLAB_BYTES - (SLAB_BYTES % slot_bytes);
+    }
+
+    void* ptr = size_class.slab_tail;
+    size_class.slab_tail += slot_bytes;
+    size_class.slab_tail_bytes -= slot_bytes;
+
+    return ptr;
+}
+
+void* CompactListArena::reallocate(void* ptr, size_t old_num_bytes, size_t new_num_bytes) {
+    if(ptr == nullptr) {
+        return allocate(new_num_bytes);
+    }
+
+    if(old_num_bytes <= MAX_SLOT_BYTES && new_num_bytes <= MAX_SLOT_BYTES &&
+       size_class_of(std::max<size_t>(old_num_bytes, 1)) == size_class_of(std::max<size_t>(new_num_bytes, 1))) {
+        return ptr;
+    }
+
+    void* new_ptr = allocate(new_num_bytes);
+    memcpy(new_ptr, ptr, std::min(old_num_bytes, new_num_bytes));
+    release(ptr, old_num_bytes);
+
+    return new_ptr;
+}
+
+void CompactListArena::release(void* ptr, size_t num_bytes) {
+    if(ptr == nullptr) {
+        return;
+    }
+
+    if(num_bytes > MAX_SLOT_BYTES) {
+        num_large_allocations--;
+        large_allocated_bytes -= num_bytes;
+        free(ptr);
+        return;
+    }
+
+    size_class_t& size_class = size_classes[size_class_of(std::max<size_t>(num_bytes, 1))];
+
+    std::unique_lock lock(size_class.mutex);
+    *(void**)(ptr) = size_class.free_list;
+    size_class.free_list = ptr;
+    size_class.num_allocated--;
+}
+
+size_t CompactListArena::reserved_bytes() {
+    size_t num_bytes = large_allocated_bytes;
+
+    for(auto& size_class: size_classes) {
+        std::unique_lock lock(size_class.mutex);
+        num_bytes += size_class.slabs.size() * SLAB_BYTES;
+    }
+
+    return num_bytes;
+}
+
+size_t CompactListArena::allocated_bytes() {
+    size_t num_bytes = large_allocated_bytes;
+
+    for(size_t i = 0; i < NUM_SIZE_CLASSES; i++) {
+        std::unique_lock lock(size_classes[i].mutex);
+        num_bytes += size_classes[i].num_allocated * (i + 1) * SIZE_CLASS_BYTES;
+    }
+
+    return num_bytes;
+}
+
+size_t CompactListArena::num_allocations() {
+    size_t count = num_large_allocations;
+
+    for(auto& size_class: size_classes) {
+        std::unique_lock lock(size_class.mutex);
+        count += size_class.num_allocated;
+    }
+
+    return count;
+}
+
+bool CompactListArena::map_slabs(const std::string& dir_path) {
+    std::string file_path = dir_path + "/typesense-arena-XXXXXX";
+
+    int fd = mkstemp(&file_path[0]);
+    if(fd == -1) {
+        return false;
+    }
+
+    unlink(file_path.c_str());
+
+    std::unique_lock lock(extent_mutex);
+
+    if(mapped_fd != -1) {
+        // extents mapped so far stay mapped after their file is closed
+        close(mapped_fd);
+    }
+
+    mapped_fd = fd;
+    mapped_file_bytes = 0;
+    extent_tail = nullptr;
+    extent_tail_bytes = 0;
+
+    return true;
+}
+
+size_t CompactListArena::mapped_bytes() {
+    std::unique_lock lock(extent_mutex);
+    return mapped_file_bytes;
+}
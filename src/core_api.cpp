@@ -7,15 +7,16 @@
 #include "collection.h"
 #include "collection_manager.h"
 #include "system_metrics.h"
+#include "compact_list_arena.h"
 #include "logger.h"
 #include "core_api_utils.h"
-#include "lru/lru.hpp"
+#include "response_cache.h"
+#include "openmetrics.h"
+#include "slow_query_log.h"
+#include "raft_server.h"
 
 using namespace std::chrono_literals;
 
-std::shared_mutex mutex;
-LRU::Cache<uint64_t, cached_res_t> res_cache;
-
 bool handle_authentication(std::map<std::string, std::string>& req_params,
                            std::vector<nlohmann::json>& embedded_params_vec,
                            const std::string& body,
@@ -240,6 +241,11 @@ bool get_health(const std::shared_ptr<http_req>& req, const std::shared_ptr<http
     if(alive) {
         res->set_body(200, result.dump());
     } else {
+        const nlohmann::json& load_progress = CollectionManager::get_instance().get_load_progress();
+        if(!load_progress.empty()) {
+            result["load_progress"] = load_progress;
+        }
+
         res->set_body(503, result.dump());
     }
 
@@ -273,21 +279,400 @@ bool get_metrics_json(const std::shared_ptr<http_req>& req, const std::shared_pt
     return true;
 }
 
+// the pool that requests (and indexing) run on, along with the pool of searches when they have their own
+static std::vector<std::pair<std::string, ThreadPool*>> get_thread_pools() {
+    std::vector<std::pair<std::string, ThreadPool*>> thread_pools = {
+        {"app", CollectionManager::get_instance().get_thread_pool()}
+    };
+
+    if(server->get_search_thread_pool() != nullptr) {
+        thread_pools.emplace_back("search", server->get_search_thread_pool());
+    }
+
+    return thread_pools;
+}
+
+static const std::vector<task_kind_t> task_kinds = {
+    task_kind_t::REQUEST, task_kind_t::SEARCH, task_kind_t::FACETS, task_kind_t::INDEXING, task_kind_t::OTHER
+};
+
+static std::vector<std::pair<double, uint64_t>> get_duration_buckets(const uint64_t* bucket_counts) {
+    std::vector<std::pair<double, uint64_t>> buckets;
+
+    for(size_t i = 0; i + 1 < thread_pool_task_stats_t::NUM_DURATION_BUCKETS; i++) {
+        buckets.emplace_back(double(uint64_t(1) << i) / 1e6, bucket_counts[i]);
+    }
+
+    return buckets;
+}
+
 bool get_stats_json(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
     nlohmann::json result;
     AppMetrics::get_instance().get("requests_per_second", "latency_ms", result);
     result["pending_write_batches"] = server->get_num_queued_writes();
 
+    CompactListArena& list_arena = CompactListArena::get_instance();
+    result["compact_list_arena_reserved_bytes"] = list_arena.reserved_bytes();
+    result["compact_list_arena_allocated_bytes"] = list_arena.allocated_bytes();
+    result["compact_list_arena_allocations"] = list_arena.num_allocations();
+
+    ResponseCache& response_cache = ResponseCache::get_instance();
+    result["response_cache_entries"] = response_cache.size();
+    result["response_cache_bytes"] = response_cache.bytes();
+    result["response_cache_hits"] = response_cache.get_num_hits();
+    result["response_cache_misses"] = response_cache.get_num_misses();
+    result["response_cache_evictions"] = response_cache.get_num_evictions();
+    result["response_cache_rejections"] = response_cache.get_num_rejections();
+
+    result["slow_query_log_dropped"] = SlowQueryLog::get_instance().get_num_dropped();
+
+    result["trace_spans_exported"] = Tracer::get_instance().get_num_exported();
+    result["trace_spans_dropped"] = Tracer::get_instance().get_num_dropped();
+    result["trace_export_failures"] = Tracer::get_instance().get_num_export_failures();
+
+    const std::vector<std::pair<std::string, task_priority_t>> task_classes = {
+        {"interactive", task_priority_t::INTERACTIVE}, {"background", task_priority_t::BACKGROUND}
+    };
+
+    for(const auto& task_class: task_classes) {
+        const thread_pool_stats_t& pool_stats =
+                CollectionManager::get_instance().get_thread_pool()->get_stats(task_class.second);
+        result["thread_pool_" + task_class.first + "_queue_depth"] = pool_stats.queue_depth;
+        result["thread_pool_" + task_class.first + "_avg_wait_ms"] = (pool_stats.num_dequeued == 0) ? 0.0 :
+                (double(pool_stats.total_wait_us) / pool_stats.num_dequeued) / 1000;
+    }
+
+    for(const auto& thread_pool: get_thread_pools()) {
+        nlohmann::json pool_json;
+        pool_json["workers"] = thread_pool.second->size();
+        pool_json["active_workers"] = thread_pool.second->num_active();
+
+        for(task_kind_t kind: task_kinds) {
+            const thread_pool_task_stats_t& task_stats = thread_pool.second->get_task_stats(kind);
+            nlohmann::json& kind_json = pool_json["tasks"][ThreadPool::task_kind_name(kind)];
+            kind_json["queue_depth"] = task_stats.queue_depth;
+            kind_json["active"] = task_stats.num_active;
+            kind_json["started"] = task_stats.num_started;
+            kind_json["avg_wait_ms"] = (task_stats.num_started == 0) ? 0.0 :
+                    (double(task_stats.total_wait_us) / task_stats.num_started) / 1000;
+            kind_json["avg_run_ms"] = (task_stats.num_finished == 0) ? 0.0 :
+                    (double(task_stats.total_run_us) / task_stats.num_finished) / 1000;
+        }
+
+        result["thread_pools"][thread_pool.first] = pool_json;
+    }
+
+    replication_stats_t replication_stats;
+    server->get_replication_state()->get_replication_stats(replication_stats);
+
+    nlohmann::json& replication_json = result["replication"];
+    replication_json["committed_index"] = replication_stats.committed_index;
+    replication_json["applied_index"] = replication_stats.applied_index;
+    replication_json["indexed_index"] = replication_stats.indexed_index;
+    replication_json["leader_committed_index"] = replication_stats.leader_committed_index;
+    replication_json["applied_entries"] = replication_stats.num_applied_entries;
+    replication_json["applied_bytes"] = replication_stats.num_applied_bytes;
+    replication_json["snapshots"] = replication_stats.num_snapshots;
+    replication_json["last_snapshot_duration_ms"] = replication_stats.last_snapshot_duration_ms;
+    replication_json["last_snapshot_bytes"] = replication_stats.last_snapshot_bytes;
+    replication_json["queued_writes"] = replication_stats.queued_writes;
+
     res->set_body(200, result.dump(2));
     return true;
 }
 
+bool get_metrics_text(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
+    openmetrics_writer_t writer;
+    AppMetrics::get_instance().get_openmetrics(writer);
+
+    writer.family("typesense_pending_write_batches", "gauge", "Write batches queued for indexing.");
+    writer.sample("typesense_pending_write_batches", server->get_num_queued_writes());
+
+    writer.family("typesense_slow_query_log_dropped", "counter",
+                  "Slow query log entries dropped because the writer fell behind.");
+    writer.sample("typesense_slow_query_log_dropped_total", SlowQueryLog::get_instance().get_num_dropped());
+
+    writer.family("typesense_trace_spans", "counter", "Spans of traced requests, by whether they were exported.");
+    writer.sample("typesense_trace_spans_total", {{"outcome", "exported"}}, Tracer::get_instance().get_num_exported());
+    writer.sample("typesense_trace_spans_total", {{"outcome", "dropped"}}, Tracer::get_instance().get_num_dropped());
+
+    writer.family("typesense_trace_export_failures", "counter", "Batches of spans that the collector did not take.");
+    writer.sample("typesense_trace_export_failures_total", Tracer::get_instance().get_num_export_failures());
+
+    const std::vector<std::pair<std::string, task_priority_t>> task_classes = {
+        {"interactive", task_priority_t::INTERACTIVE}, {"background", task_priority_t::BACKGROUND}
+    };
+
+    std::vector<thread_pool_stats_t> task_class_stats;
+    for(const auto& task_class: task_classes) {
+        task_class_stats.push_back(CollectionManager::get_instance().get_thread_pool()->get_stats(task_class.second));
+    }
+
+    writer.family("typesense_thread_pool_queue_depth", "gauge", "Tasks waiting in the thread pool.");
+    for(size_t i = 0; i < task_classes.size(); i++) {
+        writer.sample("typesense_thread_pool_queue_depth", {{"class", task_classes[i].first}},
+                      task_class_stats[i].queue_depth);
+    }
+
+    writer.family("typesense_thread_pool_wait_seconds", "summary", "Time that tasks waited in the thread pool.");
+    for(size_t i = 0; i < task_classes.size(); i++) {
+        writer.sample("typesense_thread_pool_wait_seconds_sum", {{"class", task_classes[i].first}},
+                      task_class_stats[i].total_wait_us / 1e6);
+        writer.sample("typesense_thread_pool_wait_seconds_count", {{"class", task_classes[i].first}},
+                      task_class_stats[i].num_dequeued);
+    }
+
+    const auto& thread_pools = get_thread_pools();
+
+    // (pool, kind) => stats
+    std::vector<std::vector<thread_pool_task_stats_t>> pool_task_stats;
+    for(const auto& thread_pool: thread_pools) {
+        pool_task_stats.emplace_back();
+        for(task_kind_t kind: task_kinds) {
+            pool_task_stats.back().push_back(thread_pool.second->get_task_stats(kind));
+        }
+    }
+
+    writer.family("typesense_thread_pool_workers", "gauge", "Worker threads of the thread pool.");
+    for(const auto& thread_pool: thread_pools) {
+        writer.sample("typesense_thread_pool_workers", {{"pool", thread_pool.first}}, thread_pool.second->size());
+    }
+
+    writer.family("typesense_thread_pool_active_workers", "gauge", "Worker threads running a task.");
+    for(const auto& thread_pool: thread_pools) {
+        writer.sample("typesense_thread_pool_active_workers", {{"pool", thread_pool.first}},
+                      thread_pool.second->num_active());
+    }
+
+    writer.family("typesense_thread_pool_tasks_queued", "gauge", "Tasks waiting in the thread pool, by kind.");
+    for(size_t i = 0; i < thread_pools.size(); i++) {
+        for(size_t k = 0; k < task_kinds.size(); k++) {
+            writer.sample("typesense_thread_pool_tasks_queued",
+                          {{"pool", thread_pools[i].first}, {"kind", ThreadPool::task_kind_name(task_kinds[k])}},
+                          pool_task_stats[i][k].queue_depth);
+        }
+    }
+
+    writer.family("typesense_thread_pool_task_wait_seconds", "histogram",
+                  "Time from the enqueue of a task to the start of its run.");
+    for(size_t i = 0; i < thread_pools.size(); i++) {
+        for(size_t k = 0; k < task_kinds.size(); k++) {
+            const thread_pool_task_stats_t& task_stats = pool_task_stats[i][k];
+            writer.histogram("typesense_thread_pool_task_wait_seconds",
+                             {{"pool", thread_pools[i].first}, {"kind", ThreadPool::task_kind_name(task_kinds[k])}},
+                             get_duration_buckets(task_stats.wait_buckets),
+                             task_stats.wait_buckets[thread_pool_task_stats_t::NUM_DURATION_BUCKETS - 1],
+                             task_stats.total_wait_us / 1e6);
+        }
+    }
+
+    writer.family("typesense_thread_pool_task_run_seconds", "histogram", "Time taken to run a task.");
+    for(size_t i = 0; i < thread_pools.size(); i++) {
+        for(size_t k = 0; k < task_kinds.size(); k++) {
+            const thread_pool_task_stats_t& task_stats = pool_task_stats[i][k];
+            writer.histogram("typesense_thread_pool_task_run_seconds",
+                             {{"pool", thread_pools[i].first}, {"kind", ThreadPool::task_kind_name(task_kinds[k])}},
+                             get_duration_buckets(task_stats.run_buckets),
+                             task_stats.run_buckets[thread_pool_task_stats_t::NUM_DURATION_BUCKETS - 1],
+                             task_stats.total_run_us / 1e6);
+        }
+    }
+
+    writer.family("typesense_raft_state", "gauge", "State of the raft node (1 is leader, 4 is follower).");
+    writer.sample("typesense_raft_state", server->node_state());
+
+    writer.family("typesense_raft_leader", "gauge", "Whether the raft node is the leader.");
+    writer.sample("typesense_raft_leader", server->is_leader() ? 1 : 0);
+
+    replication_stats_t replication_stats;
+    server->get_replication_state()->get_replication_stats(replication_stats);
+
+    writer.family("typesense_raft_index", "gauge", "Log index up to which the node has got to, by stage.");
+    writer.sample("typesense_raft_index", {{"stage", "committed"}}, replication_stats.committed_index);
+    writer.sample("typesense_raft_index", {{"stage", "applied"}}, replication_stats.applied_index);
+    writer.sample("typesense_raft_index", {{"stage", "indexed"}}, replication_stats.indexed_index);
+
+    writer.family("typesense_raft_leader_committed_index", "gauge",
+                  "Log index committed by the leader, as last seen by the node.");
+    writer.sample("typesense_raft_leader_committed_index", replication_stats.leader_committed_index);
+
+    writer.family("typesense_raft_apply_lag", "gauge",
+                  "Log entries committed by the leader that the node has yet to apply.");
+    writer.sample("typesense_raft_apply_lag",
+                  std::max<int64_t>(0, replication_stats.leader_committed_index - replication_stats.applied_index));
+
+    writer.family("typesense_raft_applied_entries", "counter", "Log entries applied by the node.");
+    writer.sample("typesense_raft_applied_entries_total", replication_stats.num_applied_entries);
+
+    writer.family("typesense_raft_applied_bytes", "counter", "Bytes of the log entries applied by the node.");
+    writer.sample("typesense_raft_applied_bytes_total", replication_stats.num_applied_bytes);
+
+    writer.family("typesense_collection_queued_writes", "gauge", "Writes to the collection queued for indexing.");
+    for(const auto& coll_queued_writes: replication_stats.queued_writes) {
+        writer.sample("typesense_collection_queued_writes", {{"collection", coll_queued_writes.first}},
+                      coll_queued_writes.second);
+    }
+
+    writer.family("typesense_raft_snapshots", "counter", "Snapshots saved by the node.");
+    writer.sample("typesense_raft_snapshots_total", replication_stats.num_snapshots);
+
+    writer.family("typesense_raft_last_snapshot_seconds", "gauge", "Time taken to save the last snapshot.");
+    writer.sample("typesense_raft_last_snapshot_seconds", replication_stats.last_snapshot_duration_ms / 1e3);
+
+    writer.family("typesense_raft_last_snapshot_bytes", "gauge", "Size of the files of the last snapshot.");
+    writer.sample("typesense_raft_last_snapshot_bytes", replication_stats.last_snapshot_bytes);
+
+    uint64_t allocated_bytes, active_bytes, resident_bytes;
+    SystemMetrics::get_allocator_bytes(allocated_bytes, active_bytes, resident_bytes);
+
+    writer.family("typesense_memory_bytes", "gauge", "Memory of the process by allocator state.");
+    writer.sample("typesense_memory_bytes", {{"state", "allocated"}}, allocated_bytes);
+    writer.sample("typesense_memory_bytes", {{"state", "active"}}, active_bytes);
+    writer.sample("typesense_memory_bytes", {{"state", "resident"}}, resident_bytes);
+
+    CompactListArena& list_arena = CompactListArena::get_instance();
+    ResponseCache& response_cache = ResponseCache::get_instance();
+
+    writer.family("typesense_structure_memory_bytes", "gauge", "Memory held by a structure.");
+    writer.sample("typesense_structure_memory_bytes", {{"structure", "compact_list_arena"}},
+                  list_arena.reserved_bytes());
+    writer.sample("typesense_structure_memory_bytes", {{"structure", "response_cache"}}, response_cache.bytes());
+
+    const std::vector<std::pair<std::string, std::string>> store_properties = {
+        {"memtables", "rocksdb.cur-size-all-mem-tables"},
+        {"table_readers", "rocksdb.estimate-table-readers-mem"},
+        {"block_cache", "rocksdb.block-cache-usage"},
+    };
+
+    Store* store = CollectionManager::get_instance().get_store();
+
+    for(const auto& name_property: store_properties) {
+        uint64_t value;
+        if(store->get_int_property(name_property.second, value)) {
+            writer.sample("typesense_structure_memory_bytes", {{"structure", "rocksdb_" + name_property.first}}, value);
+        }
+    }
+
+    uint64_t store_value;
+
+    writer.family("typesense_rocksdb_keys", "gauge", "Estimated number of keys in the store.");
+    if(store->get_int_property("rocksdb.estimate-num-keys", store_value)) {
+        writer.sample("typesense_rocksdb_keys", store_value);
+    }
+
+    writer.family("typesense_rocksdb_sst_files_bytes", "gauge", "Size of the SST files of the store.");
+    if(store->get_int_property("rocksdb.total-sst-files-size", store_value)) {
+        writer.sample("typesense_rocksdb_sst_files_bytes", store_value);
+    }
+
+    writer.family("typesense_rocksdb_pending_compaction_bytes", "gauge",
+                  "Estimated bytes that compactions of the store have to rewrite.");
+    if(store->get_int_property("rocksdb.estimate-pending-compaction-bytes", store_value)) {
+        writer.sample("typesense_rocksdb_pending_compaction_bytes", store_value);
+    }
+
+    std::vector<std::pair<std::string, store_stats_t>> named_store_stats = {{"main", {}}};
+    store->get_stats(named_store_stats.back().second);
+
+    Store* meta_store = CollectionManager::get_instance().get_meta_store();
+    if(meta_store != nullptr) {
+        named_store_stats.emplace_back("meta", store_stats_t());
+        meta_store->get_stats(named_store_stats.back().second);
+    }
+
+    writer.family("typesense_store_events", "counter", "Events counted by RocksDB.");
+    for(const auto& store_stats: named_store_stats) {
+        for(const auto& ticker: store_stats.second.tickers) {
+            writer.sample("typesense_store_events_total", {{"store", store_stats.first}, {"event", ticker.first}},
+                          ticker.second);
+        }
+    }
+
+    writer.family("typesense_store_operation_seconds", "summary", "Time taken by RocksDB operations.");
+    for(const auto& store_stats: named_store_stats) {
+        for(const auto& histogram: store_stats.second.histograms) {
+            const openmetrics_writer_t::labels_t labels = {{"store", store_stats.first},
+                                                           {"operation", histogram.first}};
+            const std::vector<std::pair<std::string, double>> quantiles = {
+                {"0.5", histogram.second.median}, {"0.95", histogram.second.percentile95},
+                {"0.99", histogram.second.percentile99}
+            };
+
+            for(const auto& quantile: quantiles) {
+                openmetrics_writer_t::labels_t quantile_labels = labels;
+                quantile_labels.emplace_back("quantile", quantile.first);
+                writer.sample("typesense_store_operation_seconds", quantile_labels, quantile.second / 1e6);
+            }
+
+            writer.sample("typesense_store_operation_seconds_sum", labels, histogram.second.sum / 1e6);
+            writer.sample("typesense_store_operation_seconds_count", labels, histogram.second.count);
+        }
+    }
+
+    writer.family("typesense_store_sampled_reads", "counter",
+                  "Reads of the store whose stages were timed, one in " +
+                  std::to_string(Store::READ_SAMPLE_INTERVAL) + " of the reads of each thread.");
+    for(const auto& store_stats: named_store_stats) {
+        writer.sample("typesense_store_sampled_reads_total", {{"store", store_stats.first}},
+                      store_stats.second.num_sampled_reads);
+    }
+
+    writer.family("typesense_store_sampled_read_seconds", "counter", "Time that the sampled reads spent in each stage.");
+    for(const auto& store_stats: named_store_stats) {
+        for(const auto& stage: store_stats.second.sampled_read_nanos) {
+            writer.sample("typesense_store_sampled_read_seconds_total",
+                          {{"store", store_stats.first}, {"stage", stage.first}}, stage.second / 1e9);
+        }
+    }
+
+    res->set_content(200, openmetrics_writer_t::CONTENT_TYPE, writer.finish(), true);
+    return true;
+}
+
 bool get_status(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
     nlohmann::json status = server->node_status();
     res->set_body(200, status.dump());
     return true;
 }
 
+// write generation of a searched collection, taken before the search runs, so that a write made while it runs
+// outdates its response
+static void add_write_generation(const std::string& collection_name,
+                                 std::vector<std::pair<std::string, uint64_t>>& write_generations) {
+    auto collection = CollectionManager::get_instance().get_collection(collection_name);
+    if(collection != nullptr) {
+        write_generations.emplace_back(collection_name, collection->get_write_generation());
+    }
+}
+
+// a cached response is served while none of the collections it searched was written to, and after a write only if
+// it is younger than the `cache_max_stale` seconds that the request allows
+static bool is_cached_res_current(const cached_res_t& cached_res, std::map<std::string, std::string>& req_params) {
+    const char* CACHE_MAX_STALE = "cache_max_stale";
+    bool outdated = false;
+
+    for(const auto& name_generation: cached_res.write_generations) {
+        auto collection = CollectionManager::get_instance().get_collection(name_generation.first);
+        if(collection == nullptr || collection->get_write_generation() != name_generation.second) {
+            outdated = true;
+            break;
+        }
+    }
+
+    if(!outdated) {
+        return true;
+    }
+
+    if(req_params.count(CACHE_MAX_STALE) == 0 || !StringUtils::is_uint32_t(req_params[CACHE_MAX_STALE])) {
+        return false;
+    }
+
+    const uint64_t seconds_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::high_resolution_clock::now() - cached_res.created_at).count();
+
+    return seconds_elapsed < std::stoul(req_params[CACHE_MAX_STALE]);
+}
+
 uint64_t hash_request(const std::shared_ptr<http_req>& req) {
     std::stringstream ss;
     ss << req->route_hash << req->body;
@@ -302,6 +687,23 @@ uint64_t hash_request(const std::shared_ptr<http_req>& req) {
     return StringUtils::hash_wy(req_str.c_str(), req_str.size());
 }
 
+// key of a search of a multi search, which is cached on its own, so that other multi searches sharing it find it
+static uint64_t hash_multi_search(const std::map<std::string, std::string>& search_params,
+                                  const nlohmann::json& embedded_params) {
+    std::stringstream ss;
+    ss << "multi_search:" << embedded_params.dump();
+
+    // params of the multi search as a whole do not change the results of its searches
+    for(auto& kv: search_params) {
+        if(kv.first != "use_cache" && kv.first != "multi_search_concurrency" && kv.first != "limit_multi_searches") {
+            ss << kv.first << '=' << kv.second << '&';
+        }
+    }
+
+    const std::string& search_str = ss.str();
+    return StringUtils::hash_wy(search_str.c_str(), search_str.size());
+}
+
 bool get_search(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
     const auto use_cache_it = req->params.find("use_cache");
     bool use_cache = (use_cache_it != req->params.end()) && (use_cache_it->second == "1" || use_cache_it->second == "true");
@@ -313,26 +715,21 @@ bool get_search(const std::shared_ptr<http_req>& req, const std::shared_ptr<http
 
         //LOG(INFO) << "req_hash = " << req_hash;
 
-        std::shared_lock lock(mutex);
-        auto hit_it = res_cache.find(req_hash);
-        if(hit_it != res_cache.end()) {
+        cached_res_t cached_value;
+        if(ResponseCache::get_instance().get(req_hash, cached_value) &&
+           is_cached_res_current(cached_value, req->params)) {
             //LOG(INFO) << "Result found in cache.";
-            const auto& cached_value = hit_it.value();
-
-            // we still need to check that TTL has not expired
-            uint32_t ttl = cached_value.ttl;
-            uint64_t seconds_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                    std::chrono::high_resolution_clock::now() - cached_value.created_at).count();
-
-            if(seconds_elapsed < cached_value.ttl) {
-                res->set_content(cached_value.status_code, cached_value.content_type_header, cached_value.body, true);
-                return true;
-            }
-
-            //LOG(INFO) << "Result found in cache but ttl lapsed.";
+            res->set_content(cached_value.status_code, cached_value.content_type_header, cached_value.body, true);
+            return true;
         }
     }
 
+    // a cache miss of an identical search that is running waits for its response, instead of running again
+    std::unique_ptr<search_flight_t> flight(use_cache ? new search_flight_t(req_hash, res) : nullptr);
+    if(flight && flight->join()) {
+        return res->status_code == 200;
+    }
+
     const auto preset_it = req->params.find("preset");
 
     if(preset_it != req->params.end()) {
@@ -361,8 +758,14 @@ bool get_search(const std::shared_ptr<http_req>& req, const std::shared_ptr<http
         return false;
     }
 
+    std::vector<std::pair<std::string, uint64_t>> write_generations;
+    if(use_cache) {
+        add_write_generation(req->params["collection"], write_generations);
+    }
+
     std::string results_json_str;
-    Option<bool> search_op = CollectionManager::do_search(req->params, req->embedded_params_vec[0], results_json_str);
+    Option<bool> search_op = CollectionManager::do_search(req->params, req->embedded_params_vec[0], results_json_str,
+                                                          &req->is_diposed);
 
     if(!search_op.ok()) {
         res->set(search_op.code(), search_op.error());
@@ -371,6 +774,10 @@ bool get_search(const std::shared_ptr<http_req>& req, const std::shared_ptr<http
 
     res->set_200(results_json_str);
 
+    if(http_req::is_msgpack_format(req->params)) {
+        res->content_type_header = http_req::MSGPACK_CONTENT_TYPE;
+    }
+
     // we will cache only successful requests
     if(use_cache) {
         //LOG(INFO) << "Adding to cache, key = " << req_hash;
@@ -383,14 +790,29 @@ bool get_search(const std::shared_ptr<http_req>& req, const std::shared_ptr<http
 
         cached_res_t cached_res;
         cached_res.load(res->status_code, res->content_type_header, res->body, now, cache_ttl, req_hash);
+        cached_res.write_generations = std::move(write_generations);
 
-        std::unique_lock lock(mutex);
-        res_cache.insert(req_hash, cached_res);
+        ResponseCache::get_instance().insert(req_hash, cached_res);
     }
 
     return true;
 }
 
+// MessagePack of `{"results": [` for `num_results` results, which then follow it one after the other
+static void append_msgpack_results_header(size_t num_results, std::string& out) {
+    out.push_back(char(0x81));  // map of 1 entry
+    out.push_back(char(0xa7));  // string of 7 bytes
+    out.append("results");
+
+    if(num_results < 16) {
+        out.push_back(char(0x90 | num_results));
+    } else {
+        out.push_back(char(0xdc));  // array of up to 2^16 - 1 elements
+        out.push_back(char((num_results >> 8) & 0xff));
+        out.push_back(char(num_results & 0xff));
+    }
+}
+
 bool post_multi_search(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
     const auto use_cache_it = req->params.find("use_cache");
     bool use_cache = (use_cache_it != req->params.end()) && (use_cache_it->second == "1" || use_cache_it->second == "true");
@@ -402,24 +824,20 @@ bool post_multi_search(const std::shared_ptr<http_req>& req, const std::shared_p
 
         //LOG(INFO) << "req_hash = " << req_hash;
 
-        std::shared_lock lock(mutex);
-        auto hit_it = res_cache.find(req_hash);
-        if(hit_it != res_cache.end()) {
+        cached_res_t cached_value;
+        if(ResponseCache::get_instance().get(req_hash, cached_value) &&
+           is_cached_res_current(cached_value, req->params)) {
             //LOG(INFO) << "Result found in cache.";
-            const auto& cached_value = hit_it.value();
-
-            // we still need to check that TTL has not expired
-            uint32_t ttl = cached_value.ttl;
-            uint64_t seconds_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                    std::chrono::high_resolution_clock::now() - cached_value.created_at).count();
-
-            if(seconds_elapsed < cached_value.ttl) {
-                res->set_content(cached_value.status_code, cached_value.content_type_header, cached_value.body, true);
-                return true;
-            }
+            res->set_content(cached_value.status_code, cached_value.content_type_header, cached_value.body, true);
+            return true;
         }
     }
 
+    std::unique_ptr<search_flight_t> flight(use_cache ? new search_flight_t(req_hash, res) : nullptr);
+    if(flight && flight->join()) {
+        return res->status_code == 200;
+    }
+
     nlohmann::json req_json;
 
     const auto preset_it = req->params.find("preset");
@@ -451,6 +869,7 @@ bool post_multi_search(const std::shared_ptr<http_req>& req, const std::shared_p
     }
 
     auto orig_req_params = req->params;
+    const bool is_msgpack = http_req::is_msgpack_format(orig_req_params);
     const char* LIMIT_MULTI_SEARCHES = "limit_multi_searches";
     size_t limit_multi_searches = 50;
 
@@ -464,14 +883,27 @@ bool post_multi_search(const std::shared_ptr<http_req>& req, const std::shared_p
         limit_multi_searches = first_embedded_param[LIMIT_MULTI_SEARCHES].get<size_t>();
     }
 
+    // number of the searches that run at the same time
+    const char* MULTI_SEARCH_CONCURRENCY = "multi_search_concurrency";
+    size_t multi_search_concurrency = 4;
+
+    if(orig_req_params.count(MULTI_SEARCH_CONCURRENCY) != 0 &&
+        StringUtils::is_uint32_t(orig_req_params[MULTI_SEARCH_CONCURRENCY])) {
+        multi_search_concurrency = std::stoi(orig_req_params[MULTI_SEARCH_CONCURRENCY]);
+    }
+
+    if(first_embedded_param.count(MULTI_SEARCH_CONCURRENCY) != 0 &&
+       first_embedded_param[MULTI_SEARCH_CONCURRENCY].is_number_integer()) {
+        multi_search_concurrency = first_embedded_param[MULTI_SEARCH_CONCURRENCY].get<size_t>();
+    }
+
+    multi_search_concurrency = std::max<size_t>(1, multi_search_concurrency);
+
     if(req_json["searches"].size() > limit_multi_searches) {
         res->set_400(std::string("Number of multi searches exceeds `") + LIMIT_MULTI_SEARCHES + "` parameter.");
         return false;
     }
 
-    nlohmann::json response;
-    response["results"] = nlohmann::json::array();
-
     nlohmann::json& searches = req_json["searches"];
 
     if(searches.size() != req->embedded_params_vec.size()) {
@@ -482,6 +914,12 @@ bool post_multi_search(const std::shared_ptr<http_req>& req, const std::shared_p
         return false;
     }
 
+    // the searches are over shards of one collection, whose results are merged into one
+    const bool is_union = req_json.count("union") != 0 && req_json["union"].is_boolean() &&
+                          req_json["union"].get<bool>();
+    std::vector<std::map<std::string, std::string>> searches_params;
+    std::vector<std::pair<std::string, uint64_t>> write_generations;
+
     for(size_t i = 0; i < searches.size(); i++) {
         auto& search_params = searches[i];
 
@@ -506,20 +944,136 @@ bool post_multi_search(const std::shared_ptr<http_req>& req, const std::shared_p
             }
         }
 
-        std::string results_json_str;
-        Option<bool> search_op = CollectionManager::do_search(req->params, req->embedded_params_vec[i], results_json_str);
+        // every search answers in the format of the multi search, into whose response its results are spliced
+        if(!is_msgpack) {
+            req->params.erase(http_req::RESPONSE_FORMAT);
+        }
+
+        if(use_cache) {
+            add_write_generation(req->params["collection"], write_generations);
+        }
+
+        searches_params.push_back(req->params);
+    }
+
+    std::string response;
+
+    if(is_union) {
+        Option<bool> union_op = CollectionManager::do_union(searches_params, req->embedded_params_vec,
+                                                            response, &req->is_diposed);
+        if(!union_op.ok()) {
+            res->set(union_op.code(), union_op.error());
+            return false;
+        }
+    } else {
+        std::vector<std::string> results_strs(searches_params.size());
+        std::vector<Option<bool>> search_ops(searches_params.size(), Option<bool>(true));
+
+        auto run_search = [&](size_t i) {
+            auto& search_params = searches_params[i];
+            uint64_t search_hash = 0;
+            uint32_t cache_ttl = 60;
+
+            if(use_cache) {
+                search_hash = hash_multi_search(search_params, req->embedded_params_vec[i]);
+
+                cached_res_t cached_value;
+                if(ResponseCache::get_instance().get(search_hash, cached_value) &&
+                   is_cached_res_current(cached_value, search_params)) {
+                    results_strs[i] = std::move(cached_value.body);
+                    return ;
+                }
+
+                const auto cache_ttl_it = search_params.find("cache_ttl");
+                if(cache_ttl_it != search_params.end() && StringUtils::is_int32_t(cache_ttl_it->second)) {
+                    cache_ttl = std::stoul(cache_ttl_it->second);
+                }
+            }
+
+            std::vector<std::pair<std::string, uint64_t>> search_write_generations;
+            if(use_cache) {
+                add_write_generation(search_params["collection"], search_write_generations);
+            }
+
+            search_ops[i] = CollectionManager::do_search(search_params, req->embedded_params_vec[i], results_strs[i],
+                                                         &req->is_diposed);
+
+            if(use_cache && search_ops[i].ok()) {
+                cached_res_t cached_res;
+                cached_res.load(200, res->content_type_header, results_strs[i],
+                                std::chrono::high_resolution_clock::now(), cache_ttl, search_hash);
+                cached_res.write_generations = std::move(search_write_generations);
+                ResponseCache::get_instance().insert(search_hash, cached_res);
+            }
+        };
+
+        // like the shards of a union, the searches run on threads of their own, which only wait on the thread pool
+        // that the searches of an index run on, and this thread takes its share of them too
+        const size_t num_threads = std::min(multi_search_concurrency, searches_params.size());
+        std::atomic<size_t> next_search(0);
+
+        auto run_searches = [&]() {
+            size_t i;
+            while((i = next_search++) < searches_params.size()) {
+                run_search(i);
+            }
+        };
+
+        std::vector<std::thread> search_threads;
+        for(size_t i = 1; i < num_threads; i++) {
+            search_threads.emplace_back(run_searches);
+        }
+
+        run_searches();
 
-        if(search_op.ok()) {
-            response["results"].push_back(nlohmann::json::parse(results_json_str));
+        for(auto& search_thread: search_threads) {
+            search_thread.join();
+        }
+
+        // the request holds the params of its last search, embedded params rolled in, as when they ran in turn
+        if(!searches_params.empty()) {
+            req->params = searches_params.back();
+        }
+
+        // serialized results are spliced into the response as is, in the order of the searches
+        if(is_msgpack) {
+            append_msgpack_results_header(searches_params.size(), response);
         } else {
+            response = "{\"results\":[";
+        }
+
+        for(size_t i = 0; i < searches_params.size(); i++) {
+            if(!is_msgpack) {
+                response.append(i == 0 ? "" : ",");
+            }
+
+            if(search_ops[i].ok()) {
+                response.append(results_strs[i]);
+                continue;
+            }
+
             nlohmann::json err_res;
-            err_res["error"] = search_op.error();
-            err_res["code"] = search_op.code();
-            response["results"].push_back(err_res);
+            err_res["error"] = search_ops[i].error();
+            err_res["code"] = search_ops[i].code();
+
+            if(is_msgpack) {
+                const std::vector<uint8_t>& err_msgpack = nlohmann::json::to_msgpack(err_res);
+                response.append(err_msgpack.begin(), err_msgpack.end());
+            } else {
+                response.append(err_res.dump());
+            }
+        }
+
+        if(!is_msgpack) {
+            response.append("]}");
         }
     }
 
-    res->set_200(response.dump());
+    res->set_200(response);
+
+    if(is_msgpack) {
+        res->content_type_header = http_req::MSGPACK_CONTENT_TYPE;
+    }
 
     // we will cache only successful requests
     if(use_cache) {
@@ -533,9 +1087,9 @@ bool post_multi_search(const std::shared_ptr<http_req>& req, const std::shared_p
 
         cached_res_t cached_res;
         cached_res.load(res->status_code, res->content_type_header, res->body, now, cache_ttl, req_hash);
+        cached_res.write_generations = std::move(write_generations);
 
-        std::unique_lock lock(mutex);
-        res_cache.insert(req_hash, cached_res);
+        ResponseCache::get_instance().insert(req_hash, cached_res);
     }
 
     return true;
@@ -551,6 +1105,9 @@ bool get_collection_summary(const std::shared_ptr<http_req>& req, const std::sha
     }
 
     nlohmann::json json_response = collection->get_summary_json();
+    json_response["posting_stats"] = collection->get_posting_stats();
+    json_response["tree_stats"] = collection->get_tree_stats();
+    json_response["memory_stats"] = collection->get_memory_stats();
     res->set_200(json_response.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore));
 
     return true;
@@ -572,13 +1129,36 @@ bool get_export_documents(const std::shared_ptr<http_req>& req, const std::share
     const char* FILTER_BY = "filter_by";
     const char* INCLUDE_FIELDS = "include_fields";
     const char* EXCLUDE_FIELDS = "exclude_fields";
+    const char* BATCH_SIZE = "batch_size";
+    const char* PARALLELISM = "parallelism";
 
     export_state_t* export_state = nullptr;
 
-    const std::string seq_id_prefix = collection->get_seq_id_collection_prefix();
-
     if(req->data == nullptr) {
+        size_t batch_size = 100;
+        size_t parallelism = 1;
+
+        for(const char* param: {BATCH_SIZE, PARALLELISM}) {
+            if(req->params.count(param) != 0 &&
+               (!StringUtils::is_uint32_t(req->params[param]) || std::stoul(req->params[param]) == 0)) {
+                req->last_chunk_aggregate = true;
+                res->final = true;
+                res->set_400("Parameter `" + std::string(param) + "` must be a positive integer.");
+                stream_response(req, res);
+                return false;
+            }
+        }
+
+        if(req->params.count(BATCH_SIZE) != 0) {
+            batch_size = std::stoul(req->params[BATCH_SIZE]);
+        }
+
+        if(req->params.count(PARALLELISM) != 0) {
+            parallelism = std::min<size_t>(std::stoul(req->params[PARALLELISM]), export_state_t::MAX_PARALLELISM);
+        }
+
         export_state = new export_state_t();
+        export_state->batch_size = batch_size;
 
         std::string simple_filter_query;
 
@@ -598,8 +1178,12 @@ bool get_export_documents(const std::shared_ptr<http_req>& req, const std::share
             export_state->exclude_fields = std::set<std::string>(exclude_fields_vec.begin(), exclude_fields_vec.end());
         }
 
+        export_state->res_body = &res->body;
+        export_state->collection = collection.get();
+        export_state->is_msgpack = http_req::is_msgpack_format(req->params);
+
         if(simple_filter_query.empty()) {
-            export_state->it = collectionManager.get_store()->scan(seq_id_prefix);
+            init_export_ranges(export_state, collectionManager.get_store(), parallelism);
         } else {
             auto filter_ids_op = collection->get_filter_ids(simple_filter_query, export_state->index_ids);
 
@@ -615,8 +1199,6 @@ bool get_export_documents(const std::shared_ptr<http_req>& req, const std::share
             for(size_t i=0; i<export_state->index_ids.size(); i++) {
                 export_state->offsets.push_back(0);
             }
-            export_state->res_body = &res->body;
-            export_state->collection = collection.get();
         }
     } else {
         export_state = static_cast<export_state_t*>(req->data);
@@ -624,60 +1206,22 @@ bool get_export_documents(const std::shared_ptr<http_req>& req, const std::share
 
     req->data = export_state;
 
-    if(export_state->it != nullptr) {
-        rocksdb::Iterator* it = export_state->it;
-
-        if(it->Valid() && it->key().ToString().compare(0, seq_id_prefix.size(), seq_id_prefix) == 0) {
-            if(export_state->include_fields.empty() && export_state->exclude_fields.empty()) {
-                res->body = it->value().ToString();
-            } else {
-                nlohmann::json doc = nlohmann::json::parse(it->value().ToString());
-                nlohmann::json filtered_doc;
-                for(const auto& kv: doc.items()) {
-                    bool must_include = export_state->include_fields.empty() ||
-                                        (export_state->include_fields.count(kv.key()) != 0);
-
-                    bool must_exclude = !export_state->exclude_fields.empty() &&
-                                        (export_state->exclude_fields.count(kv.key()) != 0);
-
-                    if(must_include && !must_exclude) {
-                        filtered_doc[kv.key()] = kv.value();
-                    }
-                }
-
-                res->body = filtered_doc.dump();
-            }
+    // one batch goes out per invocation: the next one is read only once the client has taken this one
+    const bool export_state_is_msgpack = export_state->is_msgpack;
+    bool done;
+    stateful_export_docs(export_state, export_state->batch_size, done);
 
-            it->Next();
-
-            // append a new line character if there is going to be one more record to send
-            if(it->Valid() && it->key().ToString().compare(0, seq_id_prefix.size(), seq_id_prefix) == 0) {
-                res->body += "\n";
-                req->last_chunk_aggregate = false;
-                res->final = false;
-            } else {
-                req->last_chunk_aggregate = true;
-                res->final = true;
-                delete export_state;
-                req->data = nullptr;
-            }
-        }
+    if(!done) {
+        req->last_chunk_aggregate = false;
+        res->final = false;
     } else {
-        bool done;
-        stateful_export_docs(export_state, 100, done);
-
-        if(!done) {
-            req->last_chunk_aggregate = false;
-            res->final = false;
-        } else {
-            req->last_chunk_aggregate = true;
-            res->final = true;
-            delete export_state;
-            req->data = nullptr;
-        }
+        req->last_chunk_aggregate = true;
+        res->final = true;
+        delete export_state;
+        req->data = nullptr;
     }
 
-    res->content_type_header = "application/octet-stream";
+    res->content_type_header = export_state_is_msgpack ? http_req::MSGPACK_CONTENT_TYPE : "application/octet-stream";
     res->status_code = 200;
 
     stream_response(req, res);
@@ -693,6 +1237,7 @@ bool post_import_documents(const std::shared_ptr<http_req>& req, const std::shar
     const char *DIRTY_VALUES = "dirty_values";
     const char *RETURN_RES = "return_res";
     const char *RETURN_ID = "return_id";
+    const char *BULK_LOAD = "bulk_load";
 
     if(req->params.count(BATCH_SIZE) == 0) {
         req->params[BATCH_SIZE] = "40";
@@ -714,6 +1259,10 @@ bool post_import_documents(const std::shared_ptr<http_req>& req, const std::shar
         req->params[RETURN_ID] = "false";
     }
 
+    if(req->params.count(BULK_LOAD) == 0) {
+        req->params[BULK_LOAD] = "false";
+    }
+
     if(!StringUtils::is_uint32_t(req->params[BATCH_SIZE])) {
         res->final = true;
         res->set_400("Parameter `" + std::string(BATCH_SIZE) + "` must be a positive integer.");
@@ -743,6 +1292,13 @@ bool post_import_documents(const std::shared_ptr<http_req>& req, const std::shar
         return false;
     }
 
+    if(req->params[BULK_LOAD] != "true" && req->params[BULK_LOAD] != "false") {
+        res->final = true;
+        res->set_400("Parameter `" + std::string(BULK_LOAD) + "` must be a true|false.");
+        stream_response(req, res);
+        return false;
+    }
+
     const size_t IMPORT_BATCH_SIZE = std::stoi(req->params[BATCH_SIZE]);
 
     if(IMPORT_BATCH_SIZE == 0) {
@@ -774,41 +1330,36 @@ bool post_import_documents(const std::shared_ptr<http_req>& req, const std::shar
     //LOG(INFO) << "req body %: " << (float(req->body_index)/req->body.size())*100;
 
     std::vector<std::string> json_lines;
+    std::string partial_record;
+
+    if(!req->last_chunk_aggregate) {
+        // The text after the last newline is a partial record unless it already makes up a whole document. It is
+        // held back for the next chunk before the body is split, and it is only validated, not parsed.
+        const size_t last_newline = req->body.rfind('\n');
+        const size_t tail_start = (last_newline == std::string::npos) ? 0 : last_newline + 1;
+        const size_t tail_first_char = req->body.find_first_not_of(' ', tail_start);
+
+        const bool complete_document = (tail_first_char == std::string::npos) ||
+                                       (req->body[tail_first_char] == '{' &&
+                                        nlohmann::json::accept(req->body.begin() + tail_start, req->body.end()));
+
+        if(!complete_document) {
+            partial_record = req->body.substr(tail_start);
+            req->body.resize(tail_start);
+        }
+    }
+
     StringUtils::split(req->body, json_lines, "\n", false);
+    req->body = std::move(partial_record);
 
     //LOG(INFO) << "json_lines.size before: " << json_lines.size() << ", req->body_index: " << req->body_index;
 
-    if(req->last_chunk_aggregate) {
-        //LOG(INFO) << "req->last_chunk_aggregate is true";
-        req->body = "";
-    } else {
-        if(!json_lines.empty()) {
-            // check if req->body had complete last record
-            bool complete_document;
-
-            try {
-                nlohmann::json document = nlohmann::json::parse(json_lines.back());
-                complete_document = document.is_object();
-            } catch(const std::exception& e) {
-                complete_document = false;
-            }
-
-            if(!complete_document) {
-                // eject partial record
-                req->body = json_lines.back();
-                json_lines.pop_back();
-            } else {
-                req->body = "";
-            }
-        }
-    }
-
     //LOG(INFO) << "json_lines.size after: " << json_lines.size() << ", stream_proceed: " << stream_proceed;
     //LOG(INFO) << "json_lines.size: " << json_lines.size() << ", req->res_state: " << req->res_state;
 
     // When only one partial record arrives as a chunk, an empty body is pushed to response stream
     bool single_partial_record_body = (json_lines.empty() && !req->body.empty());
-    std::stringstream response_stream;
+    std::string response_body;
 
     //LOG(INFO) << "single_partial_record_body: " << single_partial_record_body;
 
@@ -820,26 +1371,37 @@ bool post_import_documents(const std::shared_ptr<http_req>& req, const std::shar
         const auto& dirty_values = collection->parse_dirty_values_option(req->params[DIRTY_VALUES]);
         const bool& return_res = req->params[RETURN_RES] == "true";
         const bool& return_id = req->params[RETURN_ID] == "true";
+
+        // new documents are ingested into the store as sorted tables instead of going through its memtables
+        const bool& bulk_load = req->params[BULK_LOAD] == "true";
         nlohmann::json json_res = collection->add_many(json_lines, document, operation, "",
-                                                       dirty_values, return_res, return_id);
+                                                       dirty_values, return_res, return_id, bulk_load);
         //const std::string& import_summary_json = json_res->dump();
         //response_stream << import_summary_json << "\n";
 
+        // the results of the lines, which overwrote them, are written out once, and each is freed as it goes
+        size_t response_size = 0;
+        for(const auto& json_line: json_lines) {
+            response_size += json_line.size() + 1;
+        }
+
+        response_body.reserve(response_size);
+
         for (size_t i = 0; i < json_lines.size(); i++) {
             bool res_final = req->last_chunk_aggregate && (i == json_lines.size()-1);
+            response_body.append(json_lines[i]);
+            std::string().swap(json_lines[i]);
 
-            if(res_final) {
-                // indicates last record of last batch
-                response_stream << json_lines[i];
-            } else {
-                response_stream << json_lines[i] << "\n";
+            if(!res_final) {
+                // no newline after the last record of last batch
+                response_body.append("\n");
             }
         }
     }
 
     res->content_type_header = "text/plain; charset=utf8";
     res->status_code = 200;
-    res->body = response_stream.str();
+    res->body = std::move(response_body);
 
     res->final.store(req->last_chunk_aggregate);
     stream_response(req, res);
@@ -887,6 +1449,51 @@ bool post_add_document(const std::shared_ptr<http_req>& req, const std::shared_p
     return true;
 }
 
+void post_add_documents(const std::vector<std::shared_ptr<http_req>>& reqs,
+                        const std::vector<std::shared_ptr<http_res>>& ress) {
+    const char *ACTION = "action";
+    const char *DIRTY_VALUES_PARAM = "dirty_values";
+
+    CollectionManager & collectionManager = CollectionManager::get_instance();
+    const std::shared_ptr<http_req>& first_req = reqs[0];
+    auto collection = collectionManager.get_collection(first_req->params["collection"]);
+
+    const std::string& action = (first_req->params.count(ACTION) == 0) ? "create" : first_req->params[ACTION];
+
+    if(collection == nullptr || (action != "create" && action != "update" && action != "upsert" &&
+                                 action != "emplace")) {
+        // every request fails alike
+        for(size_t i = 0; i < reqs.size(); i++) {
+            post_add_document(reqs[i], ress[i]);
+        }
+
+        return ;
+    }
+
+    const index_operation_t operation = get_index_operation(action);
+    const auto& dirty_values = collection->parse_dirty_values_option(first_req->params[DIRTY_VALUES_PARAM]);
+
+    std::vector<std::string> json_lines;
+    json_lines.reserve(reqs.size());
+
+    for(const auto& req: reqs) {
+        json_lines.push_back(req->body);
+    }
+
+    nlohmann::json document;
+    collection->add_many(json_lines, document, operation, "", dirty_values, true, false);
+
+    for(size_t i = 0; i < reqs.size(); i++) {
+        nlohmann::json line_res = nlohmann::json::parse(json_lines[i]);
+
+        if(line_res["success"].get<bool>()) {
+            ress[i]->set_201(line_res["document"].dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore));
+        } else {
+            ress[i]->set(line_res["code"].get<size_t>(), line_res["error"].get<std::string>());
+        }
+    }
+}
+
 bool patch_update_document(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
     std::string doc_id = req->params["id"];
 
@@ -1493,10 +2100,7 @@ bool post_config(const std::shared_ptr<http_req>& req, const std::shared_ptr<htt
 }
 
 bool post_clear_cache(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
-    {
-        std::unique_lock lock(mutex);
-        res_cache.clear();
-    }
+    ResponseCache::get_instance().clear();
 
     nlohmann::json response;
     response["success"] = true;
@@ -1505,6 +2109,53 @@ bool post_clear_cache(const std::shared_ptr<http_req>& req, const std::shared_pt
     return true;
 }
 
+bool post_dump_collection(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
+    const std::string COLLECTION = "collection";
+    const std::string DUMP_PATH = "dump_path";
+
+    if(req->params.count(COLLECTION) == 0 || req->params.count(DUMP_PATH) == 0) {
+        res->set_400(std::string("Parameters `") + COLLECTION + "` and `" + DUMP_PATH + "` are required.");
+        return false;
+    }
+
+    CollectionManager & collectionManager = CollectionManager::get_instance();
+    Option<bool> dump_op = collectionManager.dump_collection(req->params[COLLECTION], req->params[DUMP_PATH]);
+
+    if(!dump_op.ok()) {
+        res->set(dump_op.code(), dump_op.error());
+        return false;
+    }
+
+    nlohmann::json response;
+    response["success"] = true;
+    res->set_201(response.dump());
+
+    return true;
+}
+
+bool post_restore_collection(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
+    const std::string COLLECTION = "collection";
+    const std::string DUMP_PATH = "dump_path";
+
+    if(req->params.count(COLLECTION) == 0 || req->params.count(DUMP_PATH) == 0) {
+        res->set_400(std::string("Parameters `") + COLLECTION + "` and `" + DUMP_PATH + "` are required.");
+        return false;
+    }
+
+    CollectionManager & collectionManager = CollectionManager::get_instance();
+    Option<Collection*> restore_op = collectionManager.restore_collection(req->params[COLLECTION],
+                                                                          req->params[DUMP_PATH]);
+
+    if(!restore_op.ok()) {
+        res->set(restore_op.code(), restore_op.error());
+        return false;
+    }
+
+    res->set_201(restore_op.get()->get_summary_json().dump());
+
+    return true;
+}
+
 bool get_synonyms(const std::shared_ptr<http_req>& req, const std::shared_ptr<http_res>& res) {
     CollectionManager & collectionManager = CollectionManager::get_instance();
     auto collection = collectionManager.get_collection(req->params["collection"]);
@@ -1,4 +1,6 @@
 #include "core_api_utils.h"
+#include <future>
+#include "collection_manager.h"
 
 Option<bool> stateful_remove_docs(deletion_state_t* deletion_state, size_t batch_size, bool& done) {
     bool removed = true;
@@ -10,31 +12,29 @@ Option<bool> stateful_remove_docs(deletion_state_t* deletion_state, size_t batch
         uint32_t* ids = size_ids.second;
 
         size_t start_index = deletion_state->offsets[i];
-        size_t batched_len = std::min(ids_len, (start_index+batch_size));
+        size_t batched_len = std::min(ids_len - start_index, batch_size - batch_count);
 
-        for(size_t j=start_index; j<batched_len; j++) {
-            Option<bool> remove_op = deletion_state->collection->remove_if_found(ids[j], true);
+        if(batched_len == 0) {
+            continue;
+        }
 
-            if(!remove_op.ok()) {
-                return remove_op;
-            }
+        // the ids of each index are sorted, so the slice goes out as one batch
+        Option<size_t> remove_op = deletion_state->collection->remove_if_found(ids + start_index, batched_len, true);
 
-            removed = remove_op.get();
-            if(removed) {
-                deletion_state->num_removed++;
-            }
+        if(!remove_op.ok()) {
+            return Option<bool>(remove_op.code(), remove_op.error());
+        }
 
-            deletion_state->offsets[i]++;
-            batch_count++;
+        removed = (remove_op.get() != 0);
+        deletion_state->num_removed += remove_op.get();
+        deletion_state->offsets[i] += batched_len;
+        batch_count += batched_len;
 
-            if(batch_count == batch_size) {
-                goto END;
-            }
+        if(batch_count == batch_size) {
+            break;
         }
     }
 
-    END:
-
     done = true;
     for(size_t i=0; i<deletion_state->index_ids.size(); i++) {
         size_t current_offset = deletion_state->offsets[i];
@@ -44,45 +44,218 @@ Option<bool> stateful_remove_docs(deletion_state_t* deletion_state, size_t batch
     return Option<bool>(removed);
 }
 
+std::mutex search_flight_t::flights_mutex;
+std::unordered_map<uint64_t, std::shared_future<cached_res_t>> search_flight_t::flights;
+
+search_flight_t::search_flight_t(uint64_t req_hash, const std::shared_ptr<http_res>& res):
+                                 req_hash(req_hash), res(res) {
+    std::unique_lock lock(flights_mutex);
+    auto flight_it = flights.find(req_hash);
+
+    if(flight_it == flights.end()) {
+        future = promise.get_future().share();
+        flights.emplace(req_hash, future);
+        is_leader = true;
+    } else {
+        future = flight_it->second;
+    }
+}
+
+search_flight_t::~search_flight_t() {
+    if(!is_leader) {
+        return ;
+    }
+
+    cached_res_t flight_res;
+    flight_res.load(res->status_code, res->content_type_header, res->body,
+                    std::chrono::high_resolution_clock::now(), 0, req_hash);
+
+    {
+        // searches arriving from now on run afresh, or hit the cache
+        std::unique_lock lock(flights_mutex);
+        flights.erase(req_hash);
+    }
+
+    promise.set_value(std::move(flight_res));
+}
+
+bool search_flight_t::join() {
+    if(is_leader) {
+        return false;
+    }
+
+    const cached_res_t& flight_res = future.get();
+    res->set_content(flight_res.status_code, flight_res.content_type_header, flight_res.body, true);
+    return true;
+}
+
+static void append_export_doc(const export_state_t* export_state, const nlohmann::json& doc, std::string& body) {
+    if(export_state->is_msgpack) {
+        nlohmann::json filtered_doc;
+        const nlohmann::json* out_doc = &doc;
+
+        if(!export_state->include_fields.empty() || !export_state->exclude_fields.empty()) {
+            for(const auto& kv: doc.items()) {
+                if((export_state->include_fields.empty() || export_state->include_fields.count(kv.key()) != 0) &&
+                   export_state->exclude_fields.count(kv.key()) == 0) {
+                    filtered_doc[kv.key()] = kv.value();
+                }
+            }
+
+            out_doc = &filtered_doc;
+        }
+
+        const std::vector<uint8_t>& doc_msgpack = nlohmann::json::to_msgpack(*out_doc);
+        body.append(doc_msgpack.begin(), doc_msgpack.end());
+        return ;
+    }
+
+    if(export_state->include_fields.empty() && export_state->exclude_fields.empty()) {
+        body.append(doc.dump());
+    } else {
+        nlohmann::json filtered_doc;
+        for(const auto& kv: doc.items()) {
+            bool must_include = export_state->include_fields.empty() ||
+                                (export_state->include_fields.count(kv.key()) != 0);
+
+            bool must_exclude = !export_state->exclude_fields.empty() &&
+                                (export_state->exclude_fields.count(kv.key()) != 0);
+
+            if(must_include && !must_exclude) {
+                filtered_doc[kv.key()] = kv.value();
+            }
+        }
+
+        body.append(filtered_doc.dump());
+    }
+
+    body.append("\n");
+}
+
+static bool is_range_valid(const export_state_t* export_state, const export_range_t& range) {
+    return range.it->Valid() && range.it->key().starts_with(export_state->seq_id_prefix) &&
+           (range.end_key.empty() || range.it->key().compare(range.end_key) < 0);
+}
+
+// reads up to `batch_size` documents off the range into its body
+static void export_range_docs(const export_state_t* export_state, export_range_t& range, size_t batch_size) {
+    range.body.clear();
+
+    // stored JSON goes out as it is, unless it has to be pruned
+    const bool is_raw = (export_state->include_fields.empty() && export_state->exclude_fields.empty() &&
+                         export_state->collection->get_document_encoding() == JSON_ENCODING &&
+                         !export_state->is_msgpack);
+
+    for(size_t i = 0; i < batch_size && is_range_valid(export_state, range); i++, range.it->Next()) {
+        if(is_raw) {
+            range.body.append(range.it->value().data(), range.it->value().size());
+            range.body.append("\n");
+            continue;
+        }
+
+        nlohmann::json doc;
+        if(export_state->collection->decode_document(range.it->value().data(), range.it->value().size(), doc)) {
+            append_export_doc(export_state, doc, range.body);
+        } else {
+            LOG(ERROR) << "Error while parsing stored document with sequence ID: "
+                       << Collection::get_seq_id_from_key(range.it->key().ToString());
+        }
+    }
+}
+
+static void export_ranges_docs(export_state_t* export_state, size_t batch_size, bool& done) {
+    auto& ranges = export_state->ranges;
+    ThreadPool* thread_pool = CollectionManager::get_instance().get_thread_pool();
+
+    // the batch is shared out between the ranges that are not exhausted yet
+    size_t num_valid_ranges = 0;
+    for(const auto& range: ranges) {
+        num_valid_ranges += is_range_valid(export_state, range);
+    }
+
+    const size_t range_batch_size = (batch_size + num_valid_ranges - 1) / std::max<size_t>(1, num_valid_ranges);
+
+    if(num_valid_ranges <= 1 || thread_pool == nullptr) {
+        for(auto& range: ranges) {
+            export_range_docs(export_state, range, range_batch_size);
+        }
+    } else {
+        std::vector<std::future<void>> range_futures;
+
+        for(auto& range: ranges) {
+            range_futures.push_back(thread_pool->enqueue_priority(task_priority_t::BACKGROUND,
+                [export_state, &range, range_batch_size]() {
+                    export_range_docs(export_state, range, range_batch_size);
+                }));
+        }
+
+        for(auto& range_future: range_futures) {
+            range_future.wait();
+        }
+    }
+
+    done = true;
+
+    for(auto& range: ranges) {
+        export_state->res_body->append(range.body);
+        range.body.clear();
+        done = done && !is_range_valid(export_state, range);
+    }
+}
+
+void init_export_ranges(export_state_t* export_state, Store* store, size_t num_ranges) {
+    Collection* collection = export_state->collection;
+    export_state->seq_id_prefix = collection->get_seq_id_collection_prefix();
+
+    const uint64_t num_seq_ids = collection->peek_next_seq_id();
+    num_ranges = std::max<size_t>(1, std::min<uint64_t>(num_ranges, num_seq_ids));
+    const uint64_t range_size = (num_seq_ids + num_ranges - 1) / num_ranges;
+
+    rocksdb::ReadOptions read_options;
+    read_options.fill_cache = false;
+    read_options.readahead_size = 2 * 1024 * 1024;
+
+    for(size_t i = 0; i < num_ranges; i++) {
+        export_range_t range;
+        const std::string& start_key = (i == 0) ? export_state->seq_id_prefix :
+                                       collection->get_seq_id_key(i * range_size);
+        range.it = store->scan(start_key, read_options);
+
+        if(i != num_ranges - 1) {
+            range.end_key = collection->get_seq_id_key((i + 1) * range_size);
+        }
+
+        export_state->ranges.push_back(std::move(range));
+    }
+}
+
 Option<bool> stateful_export_docs(export_state_t* export_state, size_t batch_size, bool& done) {
     size_t batch_count = 0;
 
     export_state->res_body->clear();
 
+    if(!export_state->ranges.empty()) {
+        export_ranges_docs(export_state, batch_size, done);
+        goto TRIM;
+    }
+
     for(size_t i = 0; i < export_state->index_ids.size(); i++) {
         std::pair<size_t, uint32_t*>& size_ids = export_state->index_ids[i];
         size_t ids_len = size_ids.first;
         uint32_t* ids = size_ids.second;
 
         size_t start_index = export_state->offsets[i];
-        size_t batched_len = std::min(ids_len, (start_index+batch_size));
+        size_t batched_len = std::min(ids_len, (start_index + batch_size - batch_count));
+
+        // the documents of the batch are read in one go
+        std::vector<nlohmann::json> docs;
+        export_state->collection->get_documents_from_store(ids + start_index, batched_len - start_index, docs);
 
         for(size_t j = start_index; j < batched_len; j++) {
-            auto seq_id = ids[j];
-            nlohmann::json doc;
-            Option<bool> get_op = export_state->collection->get_document_from_store(seq_id, doc);
-
-            if(get_op.ok()) {
-                if(export_state->include_fields.empty() && export_state->exclude_fields.empty()) {
-                    export_state->res_body->append(doc.dump());
-                } else {
-                    nlohmann::json filtered_doc;
-                    for(const auto& kv: doc.items()) {
-                        bool must_include = export_state->include_fields.empty() ||
-                                            (export_state->include_fields.count(kv.key()) != 0);
-
-                        bool must_exclude = !export_state->exclude_fields.empty() &&
-                                            (export_state->exclude_fields.count(kv.key()) != 0);
-
-                        if(must_include && !must_exclude) {
-                            filtered_doc[kv.key()] = kv.value();
-                        }
-                    }
-
-                    export_state->res_body->append(filtered_doc.dump());
-                }
+            const nlohmann::json& doc = docs[j - start_index];
 
-                export_state->res_body->append("\n");
+            if(!doc.is_discarded()) {
+                append_export_doc(export_state, doc, *export_state->res_body);
             }
 
             export_state->offsets[i]++;
@@ -102,7 +275,10 @@ Option<bool> stateful_export_docs(export_state_t* export_state, size_t batch_siz
         done = done && (current_offset == export_state->index_ids[i].first);
     }
 
-    if(done && !export_state->res_body->empty()) {
+    TRIM:
+
+    // the newline after the last line of JSON
+    if(done && !export_state->res_body->empty() && !export_state->is_msgpack) {
         export_state->res_body->pop_back();
     }
 
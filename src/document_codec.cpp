@@ -0,0 +1,142 @@
+#include "document_codec.h"
+
+bool document_codec_t::parse(const std::string& name, document_encoding_t& encoding) {
+    if(name == JSON_NAME) {
+        encoding = JSON_ENCODING;
+        return true;
+    }
+
+    if(name == COMPACT_NAME) {
+        encoding = COMPACT_ENCODING;
+        return true;
+    }
+
+    return false;
+}
+
+std::string document_codec_t::name(document_encoding_t encoding) {
+    return (encoding == COMPACT_ENCODING) ? COMPACT_NAME : JSON_NAME;
+}
+
+document_codec_t::document_codec_t(document_encoding_t encoding): encoding(encoding) {
+
+}
+
+document_encoding_t document_codec_t::get_encoding() const {
+    return encoding;
+}
+
+std::string document_codec_t::serialize_keys() const {
+    std::shared_lock lock(mutex);
+    return nlohmann::json(keys).dump();
+}
+
+bool document_codec_t::load_keys(const std::string& serialized_keys) {
+    nlohmann::json keys_json = nlohmann::json::parse(serialized_keys, nullptr, false);
+    if(!keys_json.is_array()) {
+        return false;
+    }
+
+    std::unique_lock lock(mutex);
+    keys.clear();
+    key_ids.clear();
+
+    for(const auto& key: keys_json) {
+        if(!key.is_string()) {
+            return false;
+        }
+
+        key_ids.emplace(key.get<std::string>(), keys.size());
+        keys.push_back(key.get<std::string>());
+    }
+
+    return true;
+}
+
+bool document_codec_t::encode(const nlohmann::json& document, std::string& out,
+                              const std::function<bool(const std::string&)>& persist_keys) {
+    if(encoding == JSON_ENCODING || !document.is_object()) {
+        out = document.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
+        return true;
+    }
+
+    bool has_new_keys = false;
+
+    {
+        std::shared_lock lock(mutex);
+
+        for(auto it = document.begin(); it != document.end() && !has_new_keys; ++it) {
+            has_new_keys = (key_ids.count(it.key()) == 0);
+        }
+    }
+
+    if(has_new_keys) {
+        std::unique_lock lock(mutex);
+        const size_t num_keys = keys.size();
+
+        for(auto it = document.begin(); it != document.end(); ++it) {
+            // another writer could have added it in the meantime
+            if(key_ids.count(it.key()) == 0) {
+                key_ids.emplace(it.key(), keys.size());
+                keys.push_back(it.key());
+            }
+        }
+
+        if(keys.size() != num_keys && !persist_keys(nlohmann::json(keys).dump())) {
+            for(size_t i = num_keys; i < keys.size(); i++) {
+                key_ids.erase(keys[i]);
+            }
+
+            keys.resize(num_keys);
+            return false;
+        }
+    }
+
+    nlohmann::json pairs = nlohmann::json::array();
+
+    {
+        std::shared_lock lock(mutex);
+
+        for(auto it = document.begin(); it != document.end(); ++it) {
+            pairs.push_back(key_ids.at(it.key()));
+            pairs.push_back(it.value());
+        }
+    }
+
+    std::vector<uint8_t> packed;
+    nlohmann::json::to_msgpack(pairs, packed);
+
+    out.clear();
+    out.reserve(packed.size() + 1);
+    out.push_back(COMPACT_MARKER);
+    out.append(packed.begin(), packed.end());
+
+    return true;
+}
+
+bool document_codec_t::decode(const char* data, size_t size, nlohmann::json& document) const {
+    if(size == 0 || data[0] != COMPACT_MARKER) {
+        document = nlohmann::json::parse(data, data + size, nullptr, false);
+        return !document.is_discarded();
+    }
+
+    nlohmann::json pairs = nlohmann::json::from_msgpack(data + 1, data + size, true, false);
+    if(!pairs.is_array() || pairs.size() % 2 != 0) {
+        document = nlohmann::json(nlohmann::json::value_t::discarded);
+        return false;
+    }
+
+    document = nlohmann::json::object();
+    std::shared_lock lock(mutex);
+
+    for(size_t i = 0; i < pairs.size(); i += 2) {
+        if(!pairs[i].is_number_unsigned() || pairs[i].get<uint64_t>() >= keys.size()) {
+            document = nlohmann::json(nlohmann::json::value_t::discarded);
+            return false;
+        }
+
+        document[keys[pairs[i].get<uint64_t>()]] = std::move(pairs[i + 1]);
+    }
+
+    return true;
+}
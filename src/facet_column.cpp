@@ -0,0 +1,99 @@
+#include "facet_column.h"
+#include <algorithm>
+#include "memory_usage.h"
+
+void facet_column_t::set(uint32_t seq_id, uint64_t facet_hash) {
+    uint32_t ordinal;
+    const auto ordinal_it = hash_ordinals.find(facet_hash);
+
+    if(ordinal_it == hash_ordinals.end()) {
+        ordinal = ordinal_hashes.size();
+        ordinal_hashes.push_back(facet_hash);
+        hash_ordinals.emplace(facet_hash, ordinal);
+    } else {
+        ordinal = ordinal_it->second;
+    }
+
+    if(seq_id >= doc_ordinals.size()) {
+        doc_ordinals.resize(size_t(seq_id) + 1, 0);
+    }
+
+    if(doc_ordinals[seq_id] == 0) {
+        num_docs++;
+    }
+
+    doc_ordinals[seq_id] = ordinal + 1;
+}
+
+void facet_column_t::erase(uint32_t seq_id) {
+    if(seq_id >= doc_ordinals.size() || doc_ordinals[seq_id] == 0) {
+        return ;
+    }
+
+    doc_ordinals[seq_id] = 0;
+    num_docs--;
+}
+
+size_t facet_column_t::num_values() const {
+    return ordinal_hashes.size();
+}
+
+size_t facet_column_t::size() const {
+    return num_docs;
+}
+
+size_t facet_column_t::memory_bytes() const {
+    return sizeof(facet_column_t) + memory_usage::vector_bytes(ordinal_hashes) +
+           memory_usage::sparse_map_bytes(hash_ordinals) + memory_usage::vector_bytes(doc_ordinals);
+}
+
+uint64_t facet_column_t::get_hash(uint32_t ordinal) const {
+    return ordinal_hashes[ordinal];
+}
+
+void facet_column_t::count(const uint32_t* ids, size_t num_ids, uint32_t* counts, uint32_t* last_ids) const {
+    static constexpr size_t BLOCK_SIZE = 256;
+    static constexpr size_t NUM_LANES = 4;
+
+    const size_t num_ordinals = ordinal_hashes.size();
+    const size_t num_slots = doc_ordinals.size();
+
+    if(num_ordinals == 0 || num_slots == 0) {
+        return ;
+    }
+
+    // Ids that run into the same value one after the other would serialize on the increment of a single counter,
+    // so the increments are spread over one histogram per lane, which are added up at the end. Slot 0 of each
+    // histogram takes the ids without a value.
+    std::vector<uint32_t> lane_counts(NUM_LANES * (num_ordinals + 1), 0);
+    uint32_t block_ordinals[BLOCK_SIZE];
+
+    for(size_t block_start = 0; block_start < num_ids; block_start += BLOCK_SIZE) {
+        const size_t block_len = std::min(BLOCK_SIZE, num_ids - block_start);
+        const uint32_t* block_ids = ids + block_start;
+
+        // branch free gather, so that the loads of a block can be in flight together
+        for(size_t i = 0; i < block_len; i++) {
+            const uint32_t id = block_ids[i];
+            const bool in_range = id < num_slots;
+            block_ordinals[i] = in_range ? doc_ordinals[in_range ? id : 0] : 0;
+        }
+
+        for(size_t i = 0; i < block_len; i++) {
+            lane_counts[(i % NUM_LANES) * (num_ordinals + 1) + block_ordinals[i]]++;
+        }
+
+        for(size_t i = 0; i < block_len; i++) {
+            if(block_ordinals[i] != 0) {
+                last_ids[block_ordinals[i] - 1] = block_ids[i];
+            }
+        }
+    }
+
+    for(size_t lane = 0; lane < NUM_LANES; lane++) {
+        const uint32_t* histogram = lane_counts.data() + lane * (num_ordinals + 1) + 1;
+        for(size_t ordinal = 0; ordinal < num_ordinals; ordinal++) {
+            counts[ordinal] += histogram[ordinal];
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include "facet_value_index.h"
+#include <algorithm>
+#include "memory_usage.h"
+
+bool facet_value_index_t::contains(uint64_t facet_hash) const {
+    return values.count(facet_hash) != 0;
+}
+
+void facet_value_index_t::insert(uint64_t facet_hash, const std::string& value,
+                                 const std::vector<std::string>& tokens) {
+    auto value_it = values.find(facet_hash);
+
+    if(value_it != values.end()) {
+        value_it->second.value = value;
+        value_it->second.num_occurrences++;
+        return ;
+    }
+
+    value_t& new_value = values[facet_hash];
+    new_value.value = value;
+    new_value.num_occurrences = 1;
+
+    for(const auto& token: tokens) {
+        if(token.empty() ||
+           std::find(new_value.tokens.begin(), new_value.tokens.end(), token) != new_value.tokens.end()) {
+            continue;
+        }
+
+        new_value.tokens.push_back(token);
+        token_hashes[token].push_back(facet_hash);
+    }
+}
+
+void facet_value_index_t::remove(uint64_t facet_hash) {
+    auto value_it = values.find(facet_hash);
+
+    if(value_it == values.end() || --value_it->second.num_occurrences != 0) {
+        return ;
+    }
+
+    for(const auto& token: value_it->second.tokens) {
+        auto token_it = token_hashes.find(token);
+        if(token_it == token_hashes.end()) {
+            continue;
+        }
+
+        std::vector<uint64_t>& hashes = token_it.value();
+        auto hash_it = std::find(hashes.begin(), hashes.end(), facet_hash);
+        if(hash_it != hashes.end()) {
+            *hash_it = hashes.back();
+            hashes.pop_back();
+        }
+
+        if(hashes.empty()) {
+            token_hashes.erase(token_it);
+        }
+    }
+
+    values.erase(value_it);
+}
+
+bool facet_value_index_t::get_value(uint64_t facet_hash, std::string& value) const {
+    const auto value_it = values.find(facet_hash);
+    if(value_it == values.end()) {
+        return false;
+    }
+
+    value = value_it->second.value;
+    return true;
+}
+
+size_t facet_value_index_t::size() const {
+    return values.size();
+}
+
+size_t facet_value_index_t::memory_bytes() const {
+    size_t bytes = sizeof(facet_value_index_t) + memory_usage::sparse_map_bytes(values);
+
+    for(const auto& kv: values) {
+        bytes += memory_usage::string_bytes(kv.second.value) + memory_usage::vector_bytes(kv.second.tokens);
+        for(const auto& token: kv.second.tokens) {
+            bytes += memory_usage::string_bytes(token);
+        }
+    }
+
+    // the trie stores the keys of a bucket contiguously, with their values alongside
+    for(auto it = token_hashes.begin(); it != token_hashes.end(); ++it) {
+        bytes += it.key().size() + sizeof(std::vector<uint64_t>) + memory_usage::vector_bytes(it.value());
+    }
+
+    return bytes;
+}
+
+void facet_value_index_t::search(const std::vector<std::string>& query_tokens,
+                                 std::unordered_map<uint64_t, std::vector<std::string>>& hash_tokens) const {
+    if(query_tokens.empty()) {
+        return ;
+    }
+
+    // the leading tokens must match exactly, so each of them rules out whatever values lack it
+    std::vector<const std::vector<uint64_t>*> exact_hashes;
+
+    for(size_t i = 0; i + 1 < query_tokens.size(); i++) {
+        const auto token_it = token_hashes.find(query_tokens[i]);
+        if(token_it == token_hashes.end()) {
+            return ;
+        }
+
+        exact_hashes.push_back(&token_it.value());
+    }
+
+    std::vector<spp::sparse_hash_set<uint64_t>> exact_hash_sets(exact_hashes.size());
+    for(size_t i = 0; i < exact_hashes.size(); i++) {
+        exact_hash_sets[i].insert(exact_hashes[i]->begin(), exact_hashes[i]->end());
+    }
+
+    const auto prefix_range = token_hashes.equal_prefix_range(query_tokens.back());
+
+    for(auto token_it = prefix_range.first; token_it != prefix_range.second; ++token_it) {
+        const std::string prefix_token = token_it.key();
+
+        for(uint64_t facet_hash: token_it.value()) {
+            bool matched = true;
+
+            for(const auto& exact_hash_set: exact_hash_sets) {
+                if(exact_hash_set.count(facet_hash) == 0) {
+                    matched = false;
+                    break;
+                }
+            }
+
+            if(!matched || hash_tokens.count(facet_hash) != 0) {
+                continue;
+            }
+
+            std::vector<std::string> matched_tokens(query_tokens.begin(), query_tokens.end() - 1);
+            matched_tokens.push_back(prefix_token);
+            hash_tokens.emplace(facet_hash, std::move(matched_tokens));
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include <store.h>
 #include "field.h"
+#include <cmath>
+#include <algorithm>
 
 Option<bool> filter::parse_geopoint_filter_value(std::string& raw_value,
                                                  const std::string& format_err_msg,
@@ -162,6 +164,11 @@ Option<bool> filter::parse_filter_query(const string& simple_filter_query,
         }
 
         field _field = search_schema.at(field_name);
+
+        if(_field.is_vector()) {
+            return Option<bool>(400, "Cannot filter on the vector field `" + field_name + "`.");
+        }
+
         std::string&& raw_value = filter_block.substr(found_index+1, std::string::npos);
         StringUtils::trim(raw_value);
         filter f;
@@ -430,6 +437,47 @@ Option<bool> field::json_field_to_field(nlohmann::json& field_json, std::vector<
         }
     }
 
+    if(field_json.count(fields::num_dim) != 0) {
+        if(!field_json.at(fields::num_dim).is_number_unsigned() || field_json.at(fields::num_dim).get<size_t>() == 0) {
+            return Option<bool>(400, std::string("The `num_dim` property of the field `") +
+                                     field_json[fields::name].get<std::string>() + std::string("` should be a positive integer."));
+        }
+
+        if(field_json[fields::type] != field_types::FLOAT_ARRAY) {
+            return Option<bool>(400, std::string("Property `num_dim` is only allowed on a field of type `") +
+                                     field_types::FLOAT_ARRAY + std::string("`."));
+        }
+
+        if(field_json.count(fields::facet) != 0 && field_json[fields::facet] == true) {
+            return Option<bool>(400, std::string("Field `") + field_json[fields::name].get<std::string>() +
+                                     std::string("` cannot be a facet since it's a vector field."));
+        }
+    }
+
+    if(field_json.count(fields::vec_dist) != 0) {
+        vector_distance_type_t vec_dist;
+        if(!field_json.at(fields::vec_dist).is_string() ||
+           !vector_index_t::parse_distance_type(field_json[fields::vec_dist].get<std::string>(), vec_dist)) {
+            return Option<bool>(400, std::string("The `vec_dist` property of the field `") +
+                                     field_json[fields::name].get<std::string>() +
+                                     std::string("` should be either `cosine` or `ip`."));
+        }
+    }
+
+    if(field_json.count(fields::vec_quantization) != 0 &&
+       (!field_json.at(fields::vec_quantization).is_string() ||
+        (field_json[fields::vec_quantization] != "int8" && field_json[fields::vec_quantization] != "none"))) {
+        return Option<bool>(400, std::string("The `vec_quantization` property of the field `") +
+                                 field_json[fields::name].get<std::string>() +
+                                 std::string("` should be either `int8` or `none`."));
+    }
+
+    if((field_json.count(fields::vec_dist) != 0 || field_json.count(fields::vec_quantization) != 0) &&
+       field_json.count(fields::num_dim) == 0) {
+        return Option<bool>(400, std::string("Field `") + field_json[fields::name].get<std::string>() +
+                                 std::string("` must have a `num_dim` property to be a vector field."));
+    }
+
     if(field_json["name"] == ".*") {
         if(field_json.count(fields::facet) == 0) {
             field_json[fields::facet] = false;
@@ -520,5 +568,52 @@ Option<bool> field::json_field_to_field(nlohmann::json& field_json, std::vector<
                   field_json[fields::sort], field_json[fields::infix])
     );
 
+    if(field_json.count(fields::num_dim) != 0) {
+        field& vector_field = the_fields.back();
+        vector_field.num_dim = field_json[fields::num_dim].get<size_t>();
+
+        if(field_json.count(fields::vec_dist) != 0) {
+            vector_index_t::parse_distance_type(field_json[fields::vec_dist].get<std::string>(), vector_field.vec_dist);
+        }
+
+        vector_field.vec_int8 = (field_json.count(fields::vec_quantization) != 0 &&
+                                 field_json[fields::vec_quantization] == "int8");
+    }
+
     return Option<bool>(true);
 }
+
+void GeoPoint::distances(const int64_t* lat_lngs, size_t num_lat_lngs, const S2LatLng& reference, int64_t* out) {
+    constexpr size_t BLOCK_SIZE = 64;
+    // same conversion as `S1Angle::Degrees()`
+    constexpr double DEGREES_TO_RADIANS = M_PI / 180;
+
+    const double ref_lat = reference.lat().radians();
+    const double ref_lng = reference.lng().radians();
+    const double cos_ref_lat = std::cos(ref_lat);
+
+    double lats[BLOCK_SIZE];
+    double lngs[BLOCK_SIZE];
+
+    for(size_t block_start = 0; block_start < num_lat_lngs; block_start += BLOCK_SIZE) {
+        const size_t block_len = std::min(BLOCK_SIZE, num_lat_lngs - block_start);
+        const int64_t* block_lat_lngs = lat_lngs + block_start;
+
+        for(size_t i = 0; i < block_len; i++) {
+            const uint64_t packed_lat_lng = block_lat_lngs[i];
+            lats[i] = DEGREES_TO_RADIANS * (double(int32_t((packed_lat_lng >> 32) & MASK_H32_BITS)) / 1000000);
+            lngs[i] = DEGREES_TO_RADIANS * (double(int32_t(packed_lat_lng & MASK_H32_BITS)) / 1000000);
+        }
+
+        // the haversine formula of `S2LatLng::GetDistance()`, term for term, so that the distances match
+        // `distance()` exactly
+        for(size_t i = 0; i < block_len; i++) {
+            const double dlat = std::sin(0.5 * (ref_lat - lats[i]));
+            const double dlng = std::sin(0.5 * (ref_lng - lngs[i]));
+            const double x = dlat * dlat + dlng * dlng * std::cos(lats[i]) * cos_ref_lat;
+            const double rdist = 2 * std::asin(std::sqrt(std::min(1.0, x)));
+            const double dist = EARTH_RADIUS * rdist;
+            out[block_start + i] = dist * METER_CONVERT;
+        }
+    }
+}
@@ -2,6 +2,10 @@
 #include <butil/file_util.h>
 #include <butil/files/file_enumerator.h>
 #include <butil/string_printf.h>
+#include <butil/crc32c.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
 #include <file_utils.h>
 
 bool directory_exists(const std::string& dir_path) {
@@ -105,3 +109,28 @@ bool dir_enum_count(const std::string &path) {
 
     return count;
 }
+
+bool file_checksum(const std::string& file_path, std::string& checksum) {
+    std::ifstream infile(file_path, std::ios::binary);
+    if(!infile.is_open()) {
+        return false;
+    }
+
+    std::vector<char> buffer(1024 * 1024);
+    uint32_t crc = 0;
+    size_t size = 0;
+
+    while(infile.read(buffer.data(), buffer.size()) || infile.gcount() > 0) {
+        crc = butil::crc32c::Extend(crc, buffer.data(), infile.gcount());
+        size += infile.gcount();
+    }
+
+    if(infile.bad()) {
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << std::hex << crc << "_" << std::dec << size;
+    checksum = ss.str();
+    return true;
+}
@@ -0,0 +1,324 @@
+#include "filter_iterator.h"
+#include <algorithm>
+
+filter_iterator_t::filter_iterator_t(node_type_t type): type(type) {
+
+}
+
+filter_iterator_t::filter_iterator_t(filter_iterator_t&& rhs) noexcept {
+    *this = std::move(rhs);
+}
+
+filter_iterator_t& filter_iterator_t::operator=(filter_iterator_t&& rhs) noexcept {
+    if(this == &rhs) {
+        return *this;
+    }
+
+    if(owns_ids) {
+        delete [] ids;
+    }
+
+    type = rhs.type;
+    ids = rhs.ids;
+    ids_length = rhs.ids_length;
+    ids_index = rhs.ids_index;
+    owns_ids = rhs.owns_ids;
+    bitmap = std::move(rhs.bitmap);
+    children = std::move(rhs.children);
+    end_id = rhs.end_id;
+    curr_id = rhs.curr_id;
+    is_valid = rhs.is_valid;
+
+    rhs.ids = nullptr;
+    rhs.owns_ids = false;
+    rhs.is_valid = false;
+
+    return *this;
+}
+
+filter_iterator_t::~filter_iterator_t() noexcept {
+    if(owns_ids) {
+        delete [] ids;
+    }
+}
+
+filter_iterator_t filter_iterator_t::new_ids_iterator(const uint32_t* ids, size_t ids_length, bool take_ownership) {
+    filter_iterator_t it(IDS);
+    it.ids = ids;
+    it.ids_length = ids_length;
+    it.owns_ids = take_ownership;
+    it.is_valid = (ids_length != 0);
+    it.curr_id = it.is_valid ? ids[0] : 0;
+    return it;
+}
+
+filter_iterator_t filter_iterator_t::new_bitmap_iterator(std::shared_ptr<const id_bitmap_t> bitmap) {
+    filter_iterator_t it(BITMAP);
+    it.bitmap = std::move(bitmap);
+    it.is_valid = it.bitmap->next_id(0, it.curr_id);
+    return it;
+}
+
+filter_iterator_t filter_iterator_t::new_and_iterator(std::vector<filter_iterator_t>&& children) {
+    if(children.size() == 1) {
+        return std::move(children[0]);
+    }
+
+    filter_iterator_t it(AND);
+    it.children = std::move(children);
+
+    // the smallest child goes first, since it is most likely to rule out an id
+    std::sort(it.children.begin(), it.children.end(), [](const filter_iterator_t& a, const filter_iterator_t& b) {
+        return a.estimate_size() < b.estimate_size();
+    });
+
+    it.and_align(0);
+    return it;
+}
+
+filter_iterator_t filter_iterator_t::new_or_iterator(std::vector<filter_iterator_t>&& children) {
+    if(children.size() == 1) {
+        return std::move(children[0]);
+    }
+
+    filter_iterator_t it(OR);
+    it.children = std::move(children);
+    it.or_update();
+    return it;
+}
+
+filter_iterator_t filter_iterator_t::new_not_iterator(filter_iterator_t&& child, uint32_t end_id) {
+    filter_iterator_t it(NOT);
+    it.children.push_back(std::move(child));
+    it.end_id = end_id;
+    it.not_align(0);
+    return it;
+}
+
+void filter_iterator_t::and_align(uint32_t id) {
+    is_valid = false;
+
+    if(children.empty()) {
+        return ;
+    }
+
+    uint32_t target = id;
+    bool all_equal = false;
+
+    while(!all_equal) {
+        all_equal = true;
+
+        for(auto& child: children) {
+            child.skip_to(target);
+            if(!child.valid()) {
+                return ;
+            }
+
+            if(child.id() > target) {
+                // leapfrog: the other children can skip straight past ids that this one does not contain
+                target = child.id();
+                all_equal = false;
+            }
+        }
+    }
+
+    curr_id = target;
+    is_valid = true;
+}
+
+void filter_iterator_t::or_update() {
+    is_valid = false;
+
+    for(const auto& child: children) {
+        if(child.valid() && (!is_valid || child.id() < curr_id)) {
+            curr_id = child.id();
+            is_valid = true;
+        }
+    }
+}
+
+void filter_iterator_t::not_align(uint32_t id) {
+    filter_iterator_t& child = children[0];
+
+    for(uint32_t candidate = id; candidate < end_id; candidate++) {
+        child.skip_to(candidate);
+        if(!child.valid() || child.id() != candidate) {
+            curr_id = candidate;
+            is_valid = true;
+            return ;
+        }
+    }
+
+    is_valid = false;
+}
+
+filter_iterator_t::node_type_t filter_iterator_t::get_type() const {
+    return type;
+}
+
+bool filter_iterator_t::valid() const {
+    return is_valid;
+}
+
+uint32_t filter_iterator_t::id() const {
+    return curr_id;
+}
+
+void filter_iterator_t::next() {
+    if(!is_valid) {
+        return ;
+    }
+
+    if(curr_id == UINT32_MAX) {
+        is_valid = false;
+        return ;
+    }
+
+    switch(type) {
+        case IDS:
+            ids_index++;
+            is_valid = (ids_index < ids_length);
+            if(is_valid) {
+                curr_id = ids[ids_index];
+            }
+            break;
+        case BITMAP:
+            is_valid = bitmap->next_id(curr_id + 1, curr_id);
+            break;
+        case AND:
+            and_align(curr_id + 1);
+            break;
+        case OR:
+            for(auto& child: children) {
+                if(child.valid() && child.id() == curr_id) {
+                    child.next();
+                }
+            }
+            or_update();
+            break;
+        case NOT:
+            not_align(curr_id + 1);
+            break;
+    }
+}
+
+void filter_iterator_t::skip_to(uint32_t id) {
+    if(!is_valid || id <= curr_id) {
+        return ;
+    }
+
+    switch(type) {
+        case IDS:
+            ids_index = std::lower_bound(ids + ids_index, ids + ids_length, id) - ids;
+            is_valid = (ids_index < ids_length);
+            if(is_valid) {
+                curr_id = ids[ids_index];
+            }
+            break;
+        case BITMAP:
+            is_valid = bitmap->next_id(id, curr_id);
+            break;
+        case AND:
+            and_align(id);
+            break;
+        case OR:
+            for(auto& child: children) {
+                child.skip_to(id);
+            }
+            or_update();
+            break;
+        case NOT:
+            not_align(id);
+            break;
+    }
+}
+
+bool filter_iterator_t::contains(uint32_t id) {
+    skip_to(id);
+    return is_valid && curr_id == id;
+}
+
+size_t filter_iterator_t::estimate_size() const {
+    switch(type) {
+        case IDS:
+            return ids_length - ids_index;
+        case BITMAP:
+            return bitmap->size();
+        case AND: {
+            size_t smallest = children.empty() ? 0 : SIZE_MAX;
+            for(const auto& child: children) {
+                smallest = std::min(smallest, child.estimate_size());
+            }
+            return smallest;
+        }
+        case OR: {
+            size_t total = 0;
+            for(const auto& child: children) {
+                total += child.estimate_size();
+            }
+            return total;
+        }
+        case NOT:
+            return end_id;
+    }
+
+    return 0;
+}
+
+size_t filter_iterator_t::to_ids(uint32_t** out) {
+    *out = nullptr;
+
+    if(!is_valid) {
+        return 0;
+    }
+
+    if(type == IDS && owns_ids && ids_index == 0) {
+        // hands over the array as is
+        *out = const_cast<uint32_t*>(ids);
+        const size_t num_ids = ids_length;
+
+        ids = nullptr;
+        owns_ids = false;
+        is_valid = false;
+        return num_ids;
+    }
+
+    std::vector<uint32_t> result_ids;
+
+    while(is_valid) {
+        result_ids.push_back(curr_id);
+        next();
+    }
+
+    *out = new uint32_t[result_ids.size()];
+    std::copy(result_ids.begin(), result_ids.end(), *out);
+    return result_ids.size();
+}
+
+filter_iterator_t filter_iterator_t::clone() const {
+    filter_iterator_t it(type);
+    it.ids = ids;
+    it.ids_length = ids_length;
+    it.ids_index = ids_index;
+    it.owns_ids = false;
+    it.bitmap = bitmap;
+    it.end_id = end_id;
+    it.curr_id = curr_id;
+    it.is_valid = is_valid;
+
+    it.children.reserve(children.size());
+    for(const auto& child: children) {
+        it.children.push_back(child.clone());
+    }
+
+    return it;
+}
+
+void filter_iterator_t::range_ids(uint32_t range_start, uint32_t range_end, std::vector<uint32_t>& out) {
+    skip_to(range_start);
+
+    while(is_valid && curr_id <= range_end) {
+        out.push_back(curr_id);
+        next();
+    }
+}
@@ -0,0 +1,217 @@
+#include "geo_point_index.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <s2/s2cap.h>
+#include <s2/s2cell_id.h>
+#include <s2/s2cell_union.h>
+#include <s2/s2region_coverer.h>
+#include "field.h"
+#include "memory_usage.h"
+
+geo_point_index_t::geo_point_index_t(): has_pending(false) {
+
+}
+
+void geo_point_index_t::insert(uint32_t seq_id, int64_t lat_lng) {
+    S2LatLng s2_lat_lng;
+    GeoPoint::unpack_lat_lng(lat_lng, s2_lat_lng);
+
+    pending.push_back({S2CellId(s2_lat_lng).id(), seq_id, lat_lng});
+    has_pending = true;
+    version++;
+}
+
+void geo_point_index_t::remove(uint32_t seq_id, int64_t lat_lng) {
+    S2LatLng s2_lat_lng;
+    GeoPoint::unpack_lat_lng(lat_lng, s2_lat_lng);
+    const entry_t entry = {S2CellId(s2_lat_lng).id(), seq_id, lat_lng};
+    version++;
+
+    // the same point can be held more than once by an array, in which case only one of them goes
+    auto pending_it = std::find_if(pending.begin(), pending.end(), [&entry](const entry_t& pending_entry) {
+        return pending_entry.cell_id == entry.cell_id && pending_entry.seq_id == entry.seq_id;
+    });
+
+    if(pending_it != pending.end()) {
+        pending.erase(pending_it);
+        has_pending = !pending.empty();
+        return ;
+    }
+
+    auto entry_it = std::lower_bound(entries.begin(), entries.end(), entry);
+    if(entry_it != entries.end() && entry_it->cell_id == entry.cell_id && entry_it->seq_id == entry.seq_id) {
+        entries.erase(entry_it);
+    }
+}
+
+size_t geo_point_index_t::size() const {
+    return entries.size() + pending.size();
+}
+
+size_t geo_point_index_t::memory_bytes() const {
+    std::unique_lock lock(pending_mutex);
+    return sizeof(geo_point_index_t) + memory_usage::vector_bytes(entries) + memory_usage::vector_bytes(pending);
+}
+
+uint64_t geo_point_index_t::get_version() const {
+    return version;
+}
+
+S2CellUnion geo_point_index_t::get_covering(const S2Region& region) {
+    S2RegionCoverer::Options options;
+    options.set_max_cells(8);
+    S2RegionCoverer coverer(options);
+
+    return coverer.GetCovering(region);
+}
+
+void geo_point_index_t::merge_pending() const {
+    if(!has_pending) {
+        return ;
+    }
+
+    std::unique_lock lock(pending_mutex);
+
+    if(!has_pending) {
+        // merged by another lookup in the meantime
+        return ;
+    }
+
+    std::sort(pending.begin(), pending.end());
+
+    const size_t num_sorted = entries.size();
+    entries.insert(entries.end(), pending.begin(), pending.end());
+    std::inplace_merge(entries.begin(), entries.begin() + num_sorted, entries.end());
+
+    pending.clear();
+    has_pending = false;
+}
+
+template<class T>
+void geo_point_index_t::scan_region(const S2CellUnion& covering, T&& on_entry) const {
+    for(const S2CellId& cell_id: covering) {
+        const entry_t range_start = {cell_id.range_min().id(), 0, 0};
+        auto entry_it = std::lower_bound(entries.begin(), entries.end(), range_start);
+        const uint64_t range_max = cell_id.range_max().id();
+
+        for(; entry_it != entries.end() && entry_it->cell_id <= range_max; entry_it++) {
+            on_entry(*entry_it);
+        }
+    }
+}
+
+void geo_point_index_t::region_ids(const S2Region& region, std::vector<uint32_t>& ids) const {
+    region_ids(get_covering(region), ids);
+}
+
+void geo_point_index_t::region_ids(const S2CellUnion& covering, std::vector<uint32_t>& ids) const {
+    merge_pending();
+
+    scan_region(covering, [&ids](const entry_t& entry) {
+        ids.push_back(entry.seq_id);
+    });
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+size_t geo_point_index_t::num_points(const S2CellUnion& covering) const {
+    merge_pending();
+    size_t count = 0;
+
+    // only the bounds of each cell's range are looked up, not the entries within
+    for(const S2CellId& cell_id: covering) {
+        const entry_t range_start = {cell_id.range_min().id(), 0, 0};
+        auto start_it = std::lower_bound(entries.begin(), entries.end(), range_start);
+        auto end_it = std::upper_bound(start_it, entries.end(), cell_id.range_max().id(),
+                                       [](uint64_t range_max, const entry_t& entry) {
+                                           return range_max < entry.cell_id;
+                                       });
+        count += (end_it - start_it);
+    }
+
+    return count;
+}
+
+void geo_point_index_t::nearest(const S2LatLng& center, size_t k, const uint32_t* filter_ids,
+                                size_t filter_ids_length, std::vector<uint32_t>& ids) const {
+    merge_pending();
+
+    if(k == 0 || filter_ids_length == 0 || entries.empty()) {
+        return ;
+    }
+
+    // seq_id => distance of its closest point
+    std::unordered_map<uint32_t, int64_t> id_distances;
+
+    auto on_entry = [&](const entry_t& entry) {
+        if(!std::binary_search(filter_ids, filter_ids + filter_ids_length, entry.seq_id)) {
+            return ;
+        }
+
+        S2LatLng s2_lat_lng;
+        GeoPoint::unpack_lat_lng(entry.lat_lng, s2_lat_lng);
+        const int64_t distance = GeoPoint::distance(s2_lat_lng, center);
+
+        auto id_distance_it = id_distances.find(entry.seq_id);
+        if(id_distance_it == id_distances.end()) {
+            id_distances.emplace(entry.seq_id, distance);
+        } else if(distance < id_distance_it->second) {
+            id_distance_it->second = distance;
+        }
+    };
+
+    // a cap that would hold k of the ids if they were spread evenly over the globe: its area is k / n of the sphere
+    double radius_radians = 2 * std::sqrt(double(std::min(k, filter_ids_length)) / filter_ids_length);
+    std::vector<int64_t> within_distances;
+
+    while(true) {
+        id_distances.clear();
+        within_distances.clear();
+
+        // only distances up to `radius_meters` are sure to be complete: `distance()` rounds down, so a point
+        // reported at that distance can still lie just outside a cap of the same angle
+        const int64_t radius_meters = int64_t(radius_radians / GeoPoint::meters_to_radians(1)) - 1;
+        const bool full_scan = (radius_radians >= M_PI);
+
+        if(full_scan) {
+            for(const auto& entry: entries) {
+                on_entry(entry);
+            }
+        } else {
+            scan_region(get_covering(S2Cap(center.ToPoint(), S1Angle::Radians(radius_radians))), on_entry);
+        }
+
+        for(const auto& id_distance: id_distances) {
+            if(full_scan || id_distance.second <= radius_meters) {
+                within_distances.push_back(id_distance.second);
+            }
+        }
+
+        if(within_distances.size() >= k || full_scan) {
+            break;
+        }
+
+        radius_radians *= 2;
+    }
+
+    if(within_distances.empty()) {
+        return ;
+    }
+
+    int64_t max_distance = INT64_MAX;
+
+    if(within_distances.size() >= k) {
+        std::nth_element(within_distances.begin(), within_distances.begin() + (k - 1), within_distances.end());
+        max_distance = within_distances[k - 1];
+    }
+
+    for(const auto& id_distance: id_distances) {
+        if(id_distance.second <= max_distance) {
+            ids.push_back(id_distance.first);
+        }
+    }
+
+    std::sort(ids.begin(), ids.end());
+}
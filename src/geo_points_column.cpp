@@ -0,0 +1,70 @@
+#include "geo_points_column.h"
+#include "memory_usage.h"
+
+void geo_points_column_t::set(uint32_t seq_id, const int64_t* lat_lngs, size_t num_lat_lngs) {
+    if(seq_id >= offsets.size()) {
+        offsets.resize(seq_id + 1, 0);
+    }
+
+    if(offsets[seq_id] != 0) {
+        num_dead += points[offsets[seq_id] - 1] + 1;
+    } else {
+        num_ids++;
+    }
+
+    offsets[seq_id] = points.size() + 1;
+    points.push_back(num_lat_lngs);
+    points.insert(points.end(), lat_lngs, lat_lngs + num_lat_lngs);
+
+    if(num_dead * 2 > points.size()) {
+        compact();
+    }
+}
+
+void geo_points_column_t::erase(uint32_t seq_id) {
+    if(seq_id >= offsets.size() || offsets[seq_id] == 0) {
+        return ;
+    }
+
+    num_dead += points[offsets[seq_id] - 1] + 1;
+    offsets[seq_id] = 0;
+    num_ids--;
+
+    if(num_dead * 2 > points.size()) {
+        compact();
+    }
+}
+
+void geo_points_column_t::compact() {
+    std::vector<int64_t> live_points;
+    live_points.reserve(points.size() - num_dead);
+
+    for(uint32_t& offset: offsets) {
+        if(offset == 0) {
+            continue;
+        }
+
+        const int64_t* run = points.data() + offset - 1;
+        offset = live_points.size() + 1;
+        live_points.insert(live_points.end(), run, run + run[0] + 1);
+    }
+
+    points = std::move(live_points);
+    num_dead = 0;
+}
+
+const int64_t* geo_points_column_t::get(uint32_t seq_id) const {
+    if(seq_id >= offsets.size() || offsets[seq_id] == 0) {
+        return nullptr;
+    }
+
+    return points.data() + offsets[seq_id] - 1;
+}
+
+size_t geo_points_column_t::size() const {
+    return num_ids;
+}
+
+size_t geo_points_column_t::memory_bytes() const {
+    return sizeof(geo_points_column_t) + memory_usage::vector_bytes(points) + memory_usage::vector_bytes(offsets);
+}
@@ -0,0 +1,95 @@
+#include "group_counter.h"
+#include <algorithm>
+#include <cmath>
+
+static uint64_t mix_key(uint64_t key) {
+    // distinct keys of numerical fields can be the values themselves, whose bits are anything but uniform
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+void group_counter_t::add_to_registers(uint64_t key) {
+    const uint64_t hash = mix_key(key);
+    const size_t register_index = hash >> (64 - PRECISION);
+
+    // position of the first set bit of the rest of the hash, with a bit set past its end to stop at
+    const uint64_t rest = (hash << PRECISION) | (uint64_t(1) << (PRECISION - 1));
+    const uint8_t rank = __builtin_clzll(rest) + 1;
+
+    if(rank > registers[register_index]) {
+        registers[register_index] = rank;
+    }
+}
+
+void group_counter_t::to_registers() {
+    registers.assign(NUM_REGISTERS, 0);
+
+    for(uint64_t key: keys) {
+        add_to_registers(key);
+    }
+
+    spp::sparse_hash_set<uint64_t>().swap(keys);
+}
+
+void group_counter_t::emplace(uint64_t key) {
+    if(!registers.empty()) {
+        add_to_registers(key);
+        return;
+    }
+
+    keys.insert(key);
+
+    if(keys.size() > EXACT_MAX_GROUPS) {
+        to_registers();
+    }
+}
+
+void group_counter_t::merge(const group_counter_t& other) {
+    if(other.registers.empty()) {
+        for(uint64_t key: other.keys) {
+            emplace(key);
+        }
+
+        return;
+    }
+
+    if(registers.empty()) {
+        to_registers();
+    }
+
+    for(size_t i = 0; i < NUM_REGISTERS; i++) {
+        if(other.registers[i] > registers[i]) {
+            registers[i] = other.registers[i];
+        }
+    }
+}
+
+size_t group_counter_t::size() const {
+    if(registers.empty()) {
+        return keys.size();
+    }
+
+    const double m = NUM_REGISTERS;
+    double sum = 0;
+    size_t num_zeros = 0;
+
+    for(uint8_t rank: registers) {
+        sum += std::ldexp(1.0, -int(rank));
+        num_zeros += (rank == 0);
+    }
+
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    double estimate = alpha * m * m / sum;
+
+    if(estimate <= 2.5 * m && num_zeros != 0) {
+        // linear counting is the more accurate of the two while many registers are still empty
+        estimate = m * std::log(m / num_zeros);
+    }
+
+    // a count that was exact for the first keys is at least as large
+    return std::max<size_t>(EXACT_MAX_GROUPS + 1, std::llround(estimate));
+}
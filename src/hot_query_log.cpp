@@ -0,0 +1,154 @@
+#include "hot_query_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <json.hpp>
+#include "string_utils.h"
+
+void HotQueryLog::init(const std::string& path, size_t max_queries) {
+    std::unique_lock lock(mutex);
+    this->path = path;
+    this->max_queries = max_queries;
+}
+
+void HotQueryLog::record(const std::map<std::string, std::string>& req_params, const std::string& secret_param) {
+    const size_t num_kept = max_queries;
+    if(num_kept == 0) {
+        return;
+    }
+
+    uint64_t hash = 0;
+
+    for(const auto& kv: req_params) {
+        if(kv.first == secret_param) {
+            continue;
+        }
+
+        hash = StringUtils::hash_combine(hash, StringUtils::hash_wy(kv.first.data(), kv.first.size()));
+        hash = StringUtils::hash_combine(hash, StringUtils::hash_wy(kv.second.data(), kv.second.size()));
+    }
+
+    std::unique_lock lock(mutex, std::try_to_lock);
+    if(!lock.owns_lock()) {
+        return;
+    }
+
+    auto query_it = queries.find(hash);
+    if(query_it != queries.end()) {
+        query_it->second.count++;
+        return;
+    }
+
+    uint64_t count = 1;
+
+    if(queries.size() >= num_kept * TRACKED_PER_KEPT) {
+        auto least_it = std::min_element(queries.begin(), queries.end(), [](const auto& a, const auto& b) {
+            return a.second.count < b.second.count;
+        });
+
+        count = least_it->second.count + 1;
+        queries.erase(least_it);
+    }
+
+    hot_query_t& query = queries[hash];
+    query.count = count;
+
+    for(const auto& kv: req_params) {
+        if(kv.first != secret_param) {
+            query.params.emplace(kv.first, kv.second);
+        }
+    }
+}
+
+std::vector<hot_query_t> HotQueryLog::get_hot_queries() {
+    std::vector<hot_query_t> hot_queries;
+
+    {
+        std::unique_lock lock(mutex);
+        hot_queries.reserve(queries.size());
+
+        for(const auto& hash_query: queries) {
+            hot_queries.push_back(hash_query.second);
+        }
+    }
+
+    const size_t num_kept = std::min<size_t>(max_queries, hot_queries.size());
+    std::partial_sort(hot_queries.begin(), hot_queries.begin() + num_kept, hot_queries.end(),
+                      [](const hot_query_t& a, const hot_query_t& b) {
+        return a.count > b.count;
+    });
+
+    hot_queries.resize(num_kept);
+    return hot_queries;
+}
+
+Option<bool> HotQueryLog::save() {
+    if(!is_enabled()) {
+        return Option<bool>(true);
+    }
+
+    const std::vector<hot_query_t>& hot_queries = get_hot_queries();
+
+    // nothing counted since the start up leaves the searches of the last run to warm the next start up with
+    if(hot_queries.empty()) {
+        return Option<bool>(true);
+    }
+
+    // written aside and then moved over the last one, so that a crash halfway through leaves the last one as is
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::trunc);
+
+    for(const hot_query_t& hot_query: hot_queries) {
+        nlohmann::json entry;
+        auto collection_it = hot_query.params.find("collection");
+        if(collection_it != hot_query.params.end()) {
+            entry["collection"] = collection_it->second;
+        }
+
+        entry["params"] = hot_query.params;
+        entry["count"] = hot_query.count;
+        out << entry.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore) << "\n";
+    }
+
+    out.close();
+
+    if(out.fail() || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return Option<bool>(500, "Could not write the hot queries to " + path);
+    }
+
+    return Option<bool>(true);
+}
+
+Option<bool> HotQueryLog::read(const std::string& path, std::vector<hot_query_t>& hot_queries) {
+    std::ifstream in(path);
+    if(!in.is_open()) {
+        return Option<bool>(404, "Could not open the hot queries at " + path);
+    }
+
+    std::string line;
+
+    while(std::getline(in, line)) {
+        if(line.empty()) {
+            continue;
+        }
+
+        try {
+            const nlohmann::json& entry = nlohmann::json::parse(line);
+            hot_query_t hot_query;
+            hot_query.params = entry.at("params").get<std::map<std::string, std::string>>();
+            hot_query.count = entry.value("count", uint64_t(0));
+            hot_queries.push_back(std::move(hot_query));
+        } catch(const std::exception& e) {
+            // a line of a log left by another version is as good as missing
+            continue;
+        }
+    }
+
+    return Option<bool>(true);
+}
+
+void HotQueryLog::clear() {
+    std::unique_lock lock(mutex);
+    queries.clear();
+}
@@ -6,6 +6,24 @@
 
 std::string HttpClient::api_key = "";
 std::string HttpClient::ca_cert_path = "";
+CURLSH* HttpClient::share = nullptr;
+std::mutex HttpClient::share_mutexes[CURL_LOCK_DATA_LAST];
+
+void HttpClient::share_lock(CURL* curl, curl_lock_data data, curl_lock_access access, void* userptr) {
+    share_mutexes[data].lock();
+}
+
+void HttpClient::share_unlock(CURL* curl, curl_lock_data data, void* userptr) {
+    share_mutexes[data].unlock();
+}
+
+void HttpClient::set_shared_options(CURL* curl) {
+    if(share != nullptr) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+}
 
 long HttpClient::post_response(const std::string &url, const std::string &body, std::string &response,
                                std::map<std::string, std::string>& res_headers, long timeout_ms) {
@@ -18,6 +36,38 @@ long HttpClient::post_response(const std::string &url, const std::string &body,
     return perform_curl(curl, res_headers);
 }
 
+long HttpClient::post_external_response(const std::string& url, const std::string& body,
+                                        const std::string& content_type, std::string& response,
+                                        long timeout_ms) {
+    CURL *curl = init_curl(url, response);
+    if(curl == nullptr) {
+        return 500;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_NONE);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) body.size());
+
+    const std::string content_type_header = "content-type: " + content_type;
+    struct curl_slist* chunk = curl_slist_append(nullptr, content_type_header.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
+
+    long http_code = 500;
+    CURLcode res = curl_easy_perform(curl);
+
+    if(res != CURLE_OK) {
+        LOG(ERROR) << "CURL failed. URL: " << url << ", Code: " << res << ", strerror: " << curl_easy_strerror(res);
+    } else {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    }
+
+    curl_easy_cleanup(curl);
+    curl_slist_free_all(chunk);
+
+    return http_code == 0 ? 500 : http_code;
+}
+
 long HttpClient::post_response_async(const std::string &url, const std::shared_ptr<http_req> request,
                                      const std::shared_ptr<http_res> response, HttpServer* server) {
     deferred_req_res_t* req_res = new deferred_req_res_t(request, response, server, false);
@@ -30,9 +80,20 @@ long HttpClient::post_response_async(const std::string &url, const std::shared_p
     }
 
     curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    CURLcode res = curl_easy_perform(curl);
 
+    if(res != CURLE_OK && response->status_code == 0) {
+        LOG(ERROR) << "CURL failed. URL: " << url << ", Code: " << res << ", strerror: " << curl_easy_strerror(res);
+        response->set_500("Could not forward the request to the leader.");
+    } else {
+        // the last chunk of the response has been sent already
+        response->body = "";
+    }
+
+    // the connection goes back to the pool, so the end of the response is told by the transfer being done
+    curl_write_async_done(req_res);
+
+    curl_easy_cleanup(curl);
     curl_slist_free_all(chunk);
 
     return 0;
@@ -86,6 +147,15 @@ long HttpClient::get_response(const std::string &url, std::string &response,
 void HttpClient::init(const std::string &api_key) {
     HttpClient::api_key = api_key;
 
+    if(share == nullptr) {
+        share = curl_share_init();
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, HttpClient::share_lock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, HttpClient::share_unlock);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
     // try to locate ca cert file (from: https://serverfault.com/a/722646/117601)
     std::vector<std::string> locations = {
         "/etc/ssl/certs/ca-certificates.crt",                // Debian/Ubuntu/Gentoo etc.
@@ -236,16 +306,14 @@ size_t HttpClient::curl_write_async(char *buffer, size_t size, size_t nmemb, voi
     return res_size;
 }
 
-size_t HttpClient::curl_write_async_done(void *context, curl_socket_t item) {
+void HttpClient::curl_write_async_done(deferred_req_res_t* req_res) {
     //LOG(INFO) << "curl_write_async_done";
-    deferred_req_res_t* req_res = static_cast<deferred_req_res_t *>(context);
 
     if(!req_res->res->is_alive) {
         // underlying client request is dead, don't try to send anymore data
-        return 0;
+        return ;
     }
 
-    req_res->res->body = "";
     req_res->res->final = true;
 
     async_req_res_t* async_req_res = new async_req_res_t(req_res->req, req_res->res, true);
@@ -253,11 +321,6 @@ size_t HttpClient::curl_write_async_done(void *context, curl_socket_t item) {
 
     // wait until final response is flushed or response object will be destroyed by caller
     req_res->res->wait();
-
-    // Close the socket as we've overridden the close socket handler!
-    close(item);
-
-    return 0;
 }
 
 CURL *HttpClient::init_curl_async(const std::string& url, deferred_req_res_t* req_res, curl_slist*& chunk) {
@@ -303,8 +366,7 @@ CURL *HttpClient::init_curl_async(const std::string& url, deferred_req_res_t* re
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, HttpClient::curl_write_async);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, req_res);
 
-    curl_easy_setopt(curl, CURLOPT_CLOSESOCKETFUNCTION, HttpClient::curl_write_async_done);
-    curl_easy_setopt(curl, CURLOPT_CLOSESOCKETDATA, req_res);
+    set_shared_options(curl);
 
     return curl;
 }
@@ -336,6 +398,8 @@ CURL *HttpClient::init_curl(const std::string& url, std::string& response) {
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, HttpClient::curl_write);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
 
+    set_shared_options(curl);
+
     return curl;
 }
 
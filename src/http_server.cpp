@@ -14,12 +14,22 @@
 HttpServer::HttpServer(const std::string & version, const std::string & listen_address,
                        uint32_t listen_port, const std::string & ssl_cert_path, const std::string & ssl_cert_key_path,
                        const uint64_t ssl_refresh_interval_ms, bool cors_enabled,
-                       const std::set<std::string>& cors_domains, ThreadPool* thread_pool):
-        SSL_REFRESH_INTERVAL_MS(ssl_refresh_interval_ms),
-        exit_loop(false), version(version), listen_address(listen_address), listen_port(listen_port),
+                       const std::set<std::string>& cors_domains, ThreadPool* thread_pool,
+                       size_t compression_min_bytes, int gzip_level, int brotli_level,
+                       size_t http2_stream_window_size):
+        http2_stream_window_size(http2_stream_window_size), SSL_REFRESH_INTERVAL_MS(ssl_refresh_interval_ms),
+        exit_loop(false), num_pending_searches(0), version(version), listen_address(listen_address), listen_port(listen_port),
         ssl_cert_path(ssl_cert_path), ssl_cert_key_path(ssl_cert_key_path),
         cors_enabled(cors_enabled), cors_domains(cors_domains), thread_pool(thread_pool) {
     accept_ctx = new h2o_accept_ctx_t();
+
+    // the encoding of a response is negotiated by the compressor off the `Accept-Encoding` of its request, brotli
+    // being preferred when both are enabled; a level of 0 disables an encoding
+    compress_args = {};
+    compress_args.min_size = compression_min_bytes;
+    compress_args.gzip.quality = (gzip_level <= 0) ? -1 : std::min(gzip_level, 9);
+    compress_args.brotli.quality = (brotli_level <= 0) ? -1 : std::min(brotli_level, 11);
+
     h2o_config_init(&config);
     hostconf = h2o_config_register_host(&config, h2o_iovec_init(H2O_STRLIT("default")), 65535);
     register_handler(hostconf, "/", catch_all_handler);
@@ -39,6 +49,7 @@ HttpServer::HttpServer(const std::string & version, const std::string & listen_a
     metrics_refresh_timer.timer.expire_at = 0;
 
     meta_thread_pool = new ThreadPool(4);
+    search_thread_pool = nullptr;
 
     accept_ctx->ssl_ctx = nullptr;
 }
@@ -134,7 +145,7 @@ int HttpServer::create_listener() {
     }
 
     ctx.globalconf->server_name = h2o_strdup(nullptr, "", SIZE_MAX);
-    ctx.globalconf->http2.active_stream_window_size = ACTIVE_STREAM_WINDOW_SIZE;
+    ctx.globalconf->http2.active_stream_window_size = http2_stream_window_size;
     ctx.globalconf->http2.idle_timeout = REQ_TIMEOUT_MS;
     ctx.globalconf->max_request_entity_size = (size_t(10) * 1024 * 1024 * 1024); // 10 GB
 
@@ -225,9 +236,6 @@ h2o_pathconf_t* HttpServer::register_handler(h2o_hostconf_t *hostconf, const cha
     // Enable streaming request body
     handler->super.supports_request_streaming = 1;
 
-    compress_args.min_size = 256;       // don't gzip less than this size
-    compress_args.brotli.quality = -1;  // disable, not widely supported
-    compress_args.gzip.quality = 1;     // fastest
     h2o_compress_register(pathconf, &compress_args);
 
     return pathconf;
@@ -406,6 +414,19 @@ int HttpServer::catch_all_handler(h2o_handler_t *_h2o_handler, h2o_req_t *req) {
         api_auth_key_sent = query_map[http_req::AUTH_HEADER];
     }
 
+    if(query_map.count(http_req::RESPONSE_FORMAT) == 0) {
+        ssize_t accept_header_cursor = h2o_find_header_by_str(&req->headers, http_req::ACCEPT_HEADER,
+                                                              strlen(http_req::ACCEPT_HEADER), -1);
+        if(accept_header_cursor != -1) {
+            h2o_iovec_t & slot = req->headers.entries[accept_header_cursor].value;
+            const std::string accept(slot.base, slot.len);
+            if(accept.find(http_req::MSGPACK_CONTENT_TYPE) != std::string::npos ||
+               accept.find("application/x-msgpack") != std::string::npos) {
+                query_map[http_req::RESPONSE_FORMAT] = http_req::MSGPACK_FORMAT;
+            }
+        }
+    }
+
     route_path *rpath = nullptr;
     uint64_t route_hash = h2o_handler->http_server->find_route(path_parts, http_method, &rpath);
 
@@ -420,7 +441,7 @@ int HttpServer::catch_all_handler(h2o_handler_t *_h2o_handler, h2o_req_t *req) {
     bool needs_readiness_check = (root_resource == "collections") ||
          !(
              root_resource == "health" || root_resource == "debug" ||
-             root_resource == "stats.json" || root_resource == "metrics.json" ||
+             root_resource == "stats.json" || root_resource == "metrics.json" || root_resource == "metrics" ||
              root_resource == "sequence" || root_resource == "operations" ||
              root_resource == "config" || root_resource == "status"
          );
@@ -433,11 +454,55 @@ int HttpServer::catch_all_handler(h2o_handler_t *_h2o_handler, h2o_req_t *req) {
 
         std::string message = "{ \"message\": \"Not Ready or Lagging\"}";
 
-        if(read_op && !h2o_handler->http_server->get_replication_state()->is_read_caught_up()) {
+        ReplicationState* replication_state = h2o_handler->http_server->get_replication_state();
+
+        const char* MIN_APPLIED_INDEX = "min_applied_index";
+        const char* MAX_STALENESS_MS = "max_staleness_ms";
+
+        const bool bounded_read = read_op && (query_map.count(MIN_APPLIED_INDEX) != 0 ||
+                                              query_map.count(MAX_STALENESS_MS) != 0);
+
+        if(bounded_read) {
+            // the read states how far behind the leader it can be served, in place of the node wide read lag
+            const int64_t indexed_index = replication_state->get_indexed_index();
+            const std::string& indexed_index_str = std::to_string(indexed_index);
+            h2o_add_header_by_str(&req->pool, &req->res.headers, H2O_STRLIT("x-typesense-applied-index"), 0, NULL,
+                                  h2o_strdup(&req->pool, indexed_index_str.c_str(), SIZE_MAX).base,
+                                  indexed_index_str.size());
+
+            bool fresh_enough = true;
+
+            if(query_map.count(MIN_APPLIED_INDEX) != 0) {
+                if(!StringUtils::is_int64_t(query_map[MIN_APPLIED_INDEX])) {
+                    std::string bad_message = std::string("{ \"message\": \"Parameter `") + MIN_APPLIED_INDEX +
+                                              "` must be an integer.\"}";
+                    return send_response(req, 400, bad_message);
+                }
+
+                fresh_enough = (indexed_index >= std::stoll(query_map[MIN_APPLIED_INDEX]));
+            }
+
+            if(query_map.count(MAX_STALENESS_MS) != 0) {
+                if(!StringUtils::is_uint64_t(query_map[MAX_STALENESS_MS])) {
+                    std::string bad_message = std::string("{ \"message\": \"Parameter `") + MAX_STALENESS_MS +
+                                              "` must be a positive integer.\"}";
+                    return send_response(req, 400, bad_message);
+                }
+
+                fresh_enough = fresh_enough &&
+                               (replication_state->get_staleness_ms() <= std::stoull(query_map[MAX_STALENESS_MS]));
+            }
+
+            if(!fresh_enough) {
+                return send_response(req, 503, message);
+            }
+        }
+
+        else if(read_op && !replication_state->is_read_caught_up()) {
             return send_response(req, 503, message);
         }
 
-        else if(write_op && !h2o_handler->http_server->get_replication_state()->is_write_caught_up()) {
+        else if(write_op && !replication_state->is_write_caught_up()) {
             return send_response(req, 503, message);
         }
     }
@@ -470,6 +535,19 @@ int HttpServer::catch_all_handler(h2o_handler_t *_h2o_handler, h2o_req_t *req) {
                                                                    route_hash, query_map, embedded_params_vec,
                                                                    api_auth_key_sent, body, client_ip);
 
+    if(Tracer::get_instance().is_enabled()) {
+        ssize_t traceparent_cursor = h2o_find_header_by_str(&req->headers, Tracer::TRACEPARENT_HEADER,
+                                                            strlen(Tracer::TRACEPARENT_HEADER), -1);
+        std::string traceparent;
+
+        if(traceparent_cursor != -1) {
+            h2o_iovec_t & slot = req->headers.entries[traceparent_cursor].value;
+            traceparent = std::string(slot.base, slot.len);
+        }
+
+        request->trace_context = Tracer::get_instance().start_trace(traceparent);
+    }
+
     // add custom generator with a dispose function for cleaning up resources
     h2o_custom_generator_t* custom_gen = new h2o_custom_generator_t;
     std::shared_ptr<http_res> response = std::make_shared<http_res>(custom_gen);
@@ -572,9 +650,7 @@ int HttpServer::async_req_cb(void *ctx, h2o_iovec_t chunk, int is_end_stream) {
         }
     }
 
-    std::string chunk_str(chunk.base, chunk.len);
-
-    request->body += chunk_str;
+    request->body.append(chunk.base, chunk.len);
     request->chunk_len += chunk.len;
 
     /*LOG(INFO) << "entity: " << std::string(request->req->entity.base, std::min<size_t>(40, request->req->entity.len))
@@ -674,11 +750,55 @@ int HttpServer::process_request(const std::shared_ptr<http_req>& request, const
     auto thread_pool = use_meta_thread_pool ? handler->http_server->get_meta_thread_pool() :
                        handler->http_server->get_thread_pool();
 
+    // searches are shed under overload before any work is spent on them, so that the ones that are let in still
+    // finish in time, instead of every search queueing up behind the others
+    const bool is_search = (rpath->action == "documents:search") && !use_meta_thread_pool;
+
+    if(is_search && handler->http_server->search_thread_pool != nullptr) {
+        thread_pool = handler->http_server->search_thread_pool;
+    }
+
+    std::atomic<size_t>* num_pending_searches = &handler->http_server->num_pending_searches;
+    const size_t max_pending_searches = Config::get_instance().get_max_pending_searches();
+    const size_t max_search_queue_ms = Config::get_instance().get_max_search_queue_ms();
+
+    if(is_search) {
+        if(max_pending_searches != 0 && num_pending_searches->load() >= max_pending_searches) {
+            AppMetrics::get_instance().increment_count(AppMetrics::SEARCH_SHED_LABEL, 1);
+            h2o_add_header_by_str(&request->_req->pool, &request->_req->res.headers, H2O_STRLIT("retry-after"),
+                                  0, NULL, H2O_STRLIT("1"));
+            return send_response(request->_req, 503, "{\"message\": \"Too many pending searches.\"}");
+        }
+
+        (*num_pending_searches)++;
+    }
+
+    const auto enqueue_time = std::chrono::steady_clock::now();
+
     // LOG(INFO) << "Before enqueue res: " << response
-    thread_pool->enqueue([rpath, message_dispatcher, request, response]() {
-        // call the API handler
-        //LOG(INFO) << "Wait for response " << response.get() << ", action: " << rpath->_get_action();
-        (rpath->handler)(request, response);
+    thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::REQUEST,
+                              [rpath, message_dispatcher, request, response, is_search, num_pending_searches,
+                               max_search_queue_ms, enqueue_time]() {
+        const uint64_t queue_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - enqueue_time).count();
+
+        if(is_search && max_search_queue_ms != 0 && queue_ms > max_search_queue_ms) {
+            // the client has likely given up on it by now
+            AppMetrics::get_instance().increment_count(AppMetrics::SEARCH_SHED_LABEL, 1);
+            response->set_503("Search waited too long in the queue.");
+        } else {
+            trace_span_t handler_span("handler", request->trace_context);
+            handler_span.set_attribute("action", rpath->action);
+            handler_span.set_attribute("queue_ms", int64_t(queue_ms));
+
+            // call the API handler
+            //LOG(INFO) << "Wait for response " << response.get() << ", action: " << rpath->_get_action();
+            (rpath->handler)(request, response);
+        }
+
+        if(is_search) {
+            (*num_pending_searches)--;
+        }
 
         if(!rpath->async_res) {
             // lifecycle of non async res will be owned by stream responder
@@ -710,7 +830,8 @@ void HttpServer::on_deferred_process_request(h2o_timer_t *entry) {
 
     if(found_rpath) {
         // must be called on a separate thread so as not to block http thread
-        server->thread_pool->enqueue([found_rpath, request, response]() {
+        server->thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::REQUEST,
+                                          [found_rpath, request, response]() {
             //LOG(INFO) << "Sleeping for 5s req count " << deferred_req_res->req.use_count();
             //std::this_thread::sleep_for(std::chrono::seconds(5));
             //LOG(INFO) << "on_deferred_process_request, calling handler, req use count " << request.use_count();
@@ -1092,3 +1213,11 @@ bool HttpServer::is_leader() const {
 ThreadPool* HttpServer::get_meta_thread_pool() const {
     return meta_thread_pool;
 }
+
+void HttpServer::set_search_thread_pool(ThreadPool* search_thread_pool) {
+    this->search_thread_pool = search_thread_pool;
+}
+
+ThreadPool* HttpServer::get_search_thread_pool() const {
+    return search_thread_pool;
+}
@@ -0,0 +1,128 @@
+#include "id_bitmap.h"
+#include <algorithm>
+#include <array_utils.h>
+
+id_bitmap_t::id_bitmap_t(const uint32_t* sorted_ids, size_t length): num_ids(length) {
+    if(length == 0) {
+        return;
+    }
+
+    const size_t num_words = (size_t(sorted_ids[length - 1]) / 64) + 1;
+
+    if(num_words * sizeof(uint64_t) >= length * sizeof(uint32_t)) {
+        ids.assign(sorted_ids, sorted_ids + length);
+        return;
+    }
+
+    words.resize(num_words, 0);
+
+    for(size_t i = 0; i < length; i++) {
+        words[sorted_ids[i] / 64] |= (uint64_t(1) << (sorted_ids[i] % 64));
+    }
+}
+
+size_t id_bitmap_t::size() const {
+    return num_ids;
+}
+
+bool id_bitmap_t::is_bitmap() const {
+    return !words.empty();
+}
+
+bool id_bitmap_t::contains(uint32_t id) const {
+    if(!words.empty()) {
+        const size_t word_index = id / 64;
+        return word_index < words.size() && (words[word_index] & (uint64_t(1) << (id % 64))) != 0;
+    }
+
+    return std::binary_search(ids.begin(), ids.end(), id);
+}
+
+size_t id_bitmap_t::memory_bytes() const {
+    return sizeof(id_bitmap_t) + ids.capacity() * sizeof(uint32_t) + words.capacity() * sizeof(uint64_t);
+}
+
+bool id_bitmap_t::next_id(uint32_t id, uint32_t& found_id) const {
+    if(words.empty()) {
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if(it == ids.end()) {
+            return false;
+        }
+
+        found_id = *it;
+        return true;
+    }
+
+    size_t word_index = id / 64;
+    if(word_index >= words.size()) {
+        return false;
+    }
+
+    // ignore the bits below `id` in its own word
+    uint64_t word = words[word_index] & (~uint64_t(0) << (id % 64));
+
+    while(word == 0) {
+        if(++word_index == words.size()) {
+            return false;
+        }
+
+        word = words[word_index];
+    }
+
+    found_id = uint32_t(word_index * 64 + __builtin_ctzll(word));
+    return true;
+}
+
+size_t id_bitmap_t::to_ids(uint32_t** out) const {
+    if(num_ids == 0) {
+        *out = nullptr;
+        return 0;
+    }
+
+    *out = new uint32_t[num_ids];
+
+    if(words.empty()) {
+        std::copy(ids.begin(), ids.end(), *out);
+        return num_ids;
+    }
+
+    size_t num_out = 0;
+
+    for(size_t word_index = 0; word_index < words.size(); word_index++) {
+        uint64_t word = words[word_index];
+
+        while(word != 0) {
+            (*out)[num_out++] = uint32_t(word_index * 64 + __builtin_ctzll(word));
+            word &= (word - 1);
+        }
+    }
+
+    return num_out;
+}
+
+size_t id_bitmap_t::and_ids(const uint32_t* ids_in, size_t length, uint32_t** out) const {
+    if(words.empty()) {
+        return ArrayUtils::and_scalar(ids_in, length, ids.data(), ids.size(), out);
+    }
+
+    if(length == 0) {
+        return 0;
+    }
+
+    // each id is probed against the bitmap instead of merging two sorted lists
+    *out = new uint32_t[std::min(length, num_ids)];
+    size_t num_out = 0;
+
+    for(size_t i = 0; i < length; i++) {
+        const size_t word_index = ids_in[i] / 64;
+        if(word_index >= words.size()) {
+            break;
+        }
+
+        if(words[word_index] & (uint64_t(1) << (ids_in[i] % 64))) {
+            (*out)[num_out++] = ids_in[i];
+        }
+    }
+
+    return num_out;
+}
@@ -171,8 +171,8 @@ void id_list_t::upsert(const uint32_t id) {
         upsert_block = &root_block;
         before_upsert_last_id = UINT32_MAX;
     } else {
-        const auto it = id_block_map.lower_bound(id);
-        upsert_block = (it == id_block_map.end()) ? id_block_map.rbegin()->second : it->second;
+        const size_t pos = id_block_map.lower_bound(id);
+        upsert_block = (pos == id_block_map.size()) ? id_block_map.last_block() : id_block_map.block_at(pos);
         before_upsert_last_id = upsert_block->ids.last();
     }
 
@@ -182,9 +182,10 @@ void id_list_t::upsert(const uint32_t id) {
         ids_length += num_inserted;
 
         last_id_t after_upsert_last_id = upsert_block->ids.last();
-        if(before_upsert_last_id != after_upsert_last_id) {
-            id_block_map.erase(before_upsert_last_id);
-            id_block_map.emplace(after_upsert_last_id, upsert_block);
+        if(id_block_map.empty()) {
+            id_block_map.insert(after_upsert_last_id, upsert_block);
+        } else if(before_upsert_last_id != after_upsert_last_id) {
+            id_block_map.update(before_upsert_last_id, after_upsert_last_id);
         }
     } else {
         block_t* new_block = new block_t;
@@ -202,12 +203,11 @@ void id_list_t::upsert(const uint32_t id) {
             split_block(upsert_block, new_block);
 
             last_id_t after_upsert_last_id = upsert_block->ids.last();
-            id_block_map.erase(before_upsert_last_id);
-            id_block_map.emplace(after_upsert_last_id, upsert_block);
+            id_block_map.update(before_upsert_last_id, after_upsert_last_id);
         }
 
         last_id_t after_new_block_id = new_block->ids.last();
-        id_block_map.emplace(after_new_block_id, new_block);
+        id_block_map.insert(after_new_block_id, new_block);
 
         new_block->next = upsert_block->next;
         upsert_block->next = new_block;
@@ -215,14 +215,14 @@ void id_list_t::upsert(const uint32_t id) {
 }
 
 void id_list_t::erase(const uint32_t id) {
-    const auto it = id_block_map.lower_bound(id);
+    const size_t pos = id_block_map.lower_bound(id);
 
-    if(it == id_block_map.end()) {
+    if(pos == id_block_map.size()) {
         return ;
     }
 
-    block_t* erase_block = it->second;
-    last_id_t before_last_id = it->first;
+    block_t* erase_block = id_block_map.block_at(pos);
+    last_id_t before_last_id = id_block_map.last_id_at(pos);
     uint32_t num_erased = erase_block->erase(id);
     ids_length -= num_erased;
 
@@ -233,18 +233,16 @@ void id_list_t::erase(const uint32_t id) {
 
         if(erase_block != &root_block) {
             // since we will be deleting the empty node, set the previous node's next pointer to null
-            std::prev(it)->second->next = nullptr;
+            id_block_map.block_at(pos - 1)->next = nullptr;
             delete erase_block;
         } else {
             // The root block cannot be empty if there are other blocks so we will pull some contents from next block
             // This is only an issue for blocks with max size of 2
             if(root_block.next != nullptr) {
-                auto next_block_last_id = erase_block->next->ids.last();
+                // last id of the next block does not change since only its first half is moved
                 merge_adjacent_blocks(erase_block, erase_block->next, erase_block->next->size()/2);
-                id_block_map.erase(next_block_last_id);
-
-                id_block_map.emplace(erase_block->next->ids.last(), erase_block->next);
-                id_block_map.emplace(erase_block->ids.last(), erase_block);
+                id_block_map.update(before_last_id, erase_block->ids.last());
+                return;
             }
         }
 
@@ -256,8 +254,7 @@ void id_list_t::erase(const uint32_t id) {
     if(new_ids_length >= BLOCK_MAX_ELEMENTS/2 || erase_block->next == nullptr) {
         last_id_t after_last_id = erase_block->ids.last();
         if(before_last_id != after_last_id) {
-            id_block_map.erase(before_last_id);
-            id_block_map.emplace(after_last_id, erase_block);
+            id_block_map.update(before_last_id, after_last_id);
         }
 
         return ;
@@ -286,8 +283,7 @@ void id_list_t::erase(const uint32_t id) {
 
     last_id_t after_last_id = erase_block->ids.last();
     if(before_last_id != after_last_id) {
-        id_block_map.erase(before_last_id);
-        id_block_map.emplace(after_last_id, erase_block);
+        id_block_map.update(before_last_id, after_last_id);
     }
 }
 
@@ -295,10 +291,70 @@ id_list_t::block_t* id_list_t::get_root() {
     return &root_block;
 }
 
+static size_t min_num_blocks(size_t num_ids, size_t block_max_elements) {
+    return std::max<size_t>(1, (num_ids + block_max_elements - 1) / block_max_elements);
+}
+
+bool id_list_t::is_fragmented() const {
+    const size_t num_blocks_needed = min_num_blocks(ids_length, BLOCK_MAX_ELEMENTS);
+    return id_block_map.size() > 1 && id_block_map.size() >= num_blocks_needed + (num_blocks_needed + 3) / 4;
+}
+
+size_t id_list_t::compact() {
+    if(id_block_map.size() <= min_num_blocks(ids_length, BLOCK_MAX_ELEMENTS)) {
+        return 0;
+    }
+
+    size_t num_freed_blocks = 0;
+    block_t* block = &root_block;
+
+    while(block->next != nullptr) {
+        block_t* next_block = block->next;
+        const size_t num_free_slots = BLOCK_MAX_ELEMENTS - block->size();
+
+        if(num_free_slots == 0) {
+            block = next_block;
+        } else if(next_block->size() <= num_free_slots) {
+            // `block` might still have room for the IDs of the block after `next_block`
+            merge_adjacent_blocks(block, next_block, next_block->size());
+            block->next = next_block->next;
+            delete next_block;
+            num_freed_blocks++;
+        } else {
+            merge_adjacent_blocks(block, next_block, num_free_slots);
+            block = next_block;
+        }
+    }
+
+    id_block_map.clear();
+
+    for(block = &root_block; block != nullptr; block = block->next) {
+        id_block_map.insert(block->ids.last(), block);
+    }
+
+    return num_freed_blocks;
+}
+
 size_t id_list_t::num_blocks() const {
     return id_block_map.size();
 }
 
+size_t id_list_t::memory_bytes() const {
+    size_t bytes = sizeof(id_list_t) + id_block_map.memory_bytes();
+    const block_t* block = &root_block;
+
+    while(block != nullptr) {
+        if(block != &root_block) {
+            bytes += sizeof(block_t);
+        }
+
+        bytes += block->ids.getSizeInBytes();
+        block = block->next;
+    }
+
+    return bytes;
+}
+
 uint32_t id_list_t::first_id() {
     if(ids_length == 0) {
         return 0;
@@ -307,13 +363,21 @@ uint32_t id_list_t::first_id() {
     return root_block.ids.at(0);
 }
 
+uint32_t id_list_t::last_id() {
+    if(ids_length == 0) {
+        return 0;
+    }
+
+    return id_block_map.last_block()->ids.last();
+}
+
 id_list_t::block_t* id_list_t::block_of(uint32_t id) {
-    const auto it = id_block_map.lower_bound(id);
-    if(it == id_block_map.end()) {
+    const size_t pos = id_block_map.lower_bound(id);
+    if(pos == id_block_map.size()) {
         return nullptr;
     }
 
-    return it->second;
+    return id_block_map.block_at(pos);
 }
 
 void id_list_t::merge(const std::vector<id_list_t*>& id_lists, std::vector<uint32_t>& result_ids) {
@@ -534,13 +598,13 @@ size_t id_list_t::num_ids() const {
 }
 
 bool id_list_t::contains(uint32_t id) {
-    const auto it = id_block_map.lower_bound(id);
+    const size_t pos = id_block_map.lower_bound(id);
 
-    if(it == id_block_map.end()) {
+    if(pos == id_block_map.size()) {
         return false;
     }
 
-    block_t* potential_block = it->second;
+    block_t* potential_block = id_block_map.block_at(pos);
     return potential_block->contains(id);
 }
 
@@ -84,8 +84,7 @@ compact_id_list_t* compact_id_list_t::create(uint32_t num_ids, const std::vector
 compact_id_list_t* compact_id_list_t::create(uint32_t num_ids, const uint32_t* ids) {
     // format: id1, id2, id3, ...
 
-    compact_id_list_t* pl = (compact_id_list_t*) malloc(sizeof(compact_id_list_t) +
-                                                        (num_ids * sizeof(uint32_t)));
+    compact_id_list_t* pl = (compact_id_list_t*) CompactListArena::get_instance().allocate(size_bytes(num_ids));
 
     pl->length = 0;
     pl->capacity = num_ids;
@@ -97,6 +96,10 @@ compact_id_list_t* compact_id_list_t::create(uint32_t num_ids, const uint32_t* i
     return pl;
 }
 
+void compact_id_list_t::destroy(compact_id_list_t* list) {
+    CompactListArena::get_instance().release(list, size_bytes(list->capacity));
+}
+
 id_list_t* compact_id_list_t::to_full_ids_list() const {
     id_list_t* pl = new id_list_t(ids_t::MAX_BLOCK_ELEMENTS);
 
@@ -190,7 +193,7 @@ void ids_t::upsert(void*& obj, uint32_t id) {
         if((list->capacity + extra_capacity_required) > COMPACT_LIST_THRESHOLD_LENGTH) {
             // we have to convert to a full posting list
             id_list_t* full_list = list->to_full_ids_list();
-            free(list);
+            compact_id_list_t::destroy(list);
             obj = full_list;
         }
 
@@ -199,8 +202,9 @@ void ids_t::upsert(void*& obj, uint32_t id) {
             size_t new_capacity = std::min<size_t>((list->capacity + extra_capacity_required) * 1.3,
                                                    COMPACT_LIST_THRESHOLD_LENGTH);
 
-            size_t new_capacity_bytes = sizeof(compact_id_list_t) + (new_capacity * sizeof(uint32_t));
-            auto new_list = (compact_id_list_t *) realloc(list, new_capacity_bytes);
+            auto new_list = (compact_id_list_t *) CompactListArena::get_instance().reallocate(
+                list, compact_id_list_t::size_bytes(list->capacity), compact_id_list_t::size_bytes(new_capacity)
+            );
             if(new_list == nullptr) {
                 abort();
             }
@@ -229,8 +233,9 @@ void ids_t::erase(void*& obj, uint32_t id) {
         if(list->length < list->capacity/2) {
             // resize container
             size_t new_capacity = list->capacity/2;
-            size_t new_capacity_bytes = sizeof(compact_id_list_t) + (new_capacity * sizeof(uint32_t));
-            auto new_list = (compact_id_list_t *) realloc(list, new_capacity_bytes);
+            auto new_list = (compact_id_list_t *) CompactListArena::get_instance().reallocate(
+                list, compact_id_list_t::size_bytes(list->capacity), compact_id_list_t::size_bytes(new_capacity)
+            );
             if(new_list == nullptr) {
                 abort();
             }
@@ -259,6 +264,19 @@ void ids_t::erase(void*& obj, uint32_t id) {
     }
 }
 
+bool ids_t::is_fragmented(const void* obj) {
+    return !IS_COMPACT_IDS(obj) && ((const id_list_t*)(obj))->is_fragmented();
+}
+
+size_t ids_t::compact(void* obj) {
+    if(IS_COMPACT_IDS(obj)) {
+        return 0;
+    }
+
+    id_list_t* list = (id_list_t*)(obj);
+    return list->is_fragmented() ? list->compact() : 0;
+}
+
 uint32_t ids_t::num_ids(const void* obj) {
     if(IS_COMPACT_IDS(obj)) {
         compact_id_list_t* list = COMPACT_IDS_PTR(obj);
@@ -269,6 +287,16 @@ uint32_t ids_t::num_ids(const void* obj) {
     }
 }
 
+size_t ids_t::memory_bytes(const void* obj) {
+    if(IS_COMPACT_IDS(obj)) {
+        compact_id_list_t* list = COMPACT_IDS_PTR(obj);
+        return compact_id_list_t::size_bytes(list->capacity);
+    } else {
+        id_list_t* list = (id_list_t*)(obj);
+        return list->memory_bytes();
+    }
+}
+
 uint32_t ids_t::first_id(const void* obj) {
     if(IS_COMPACT_IDS(obj)) {
         compact_id_list_t* list = COMPACT_IDS_PTR(obj);
@@ -349,7 +377,7 @@ void ids_t::destroy_list(void*& obj) {
 
     if(IS_COMPACT_IDS(obj)) {
         compact_id_list_t* list = COMPACT_IDS_PTR(obj);
-        free(list); // assigned via malloc, so must be free()d
+        compact_id_list_t::destroy(list);
     } else {
         id_list_t* list = (id_list_t*)(obj);
         delete list;
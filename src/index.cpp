@@ -2,6 +2,7 @@
 
 #include <numeric>
 #include <chrono>
+#include <atomic>
 #include <set>
 #include <unordered_map>
 #include <array_utils.h>
@@ -11,10 +12,10 @@
 #include <tokenizer.h>
 #include <s2/s2point.h>
 #include <s2/s2latlng.h>
-#include <s2/s2region_term_indexer.h>
 #include <s2/s2cap.h>
 #include <s2/s2earth.h>
 #include <s2/s2loop.h>
+#include <s2/s2latlng_rect.h>
 #include <s2/s2builder.h>
 #include <posting.h>
 #include <thread_local_vars.h>
@@ -22,23 +23,27 @@
 #include <or_iterator.h>
 #include <timsort.hpp>
 #include "logger.h"
-
-#define RETURN_CIRCUIT_BREAKER if(std::chrono::duration_cast<std::chrono::milliseconds>(\
-                                std::chrono::high_resolution_clock::now() - search_begin).count() > search_stop_ms) { \
-                                    search_cutoff = true;                                                    \
+#include "index_snapshot.h"
+#include "search_profile.h"
+#include "memory_usage.h"
+#include "config.h"
+#include "system_metrics.h"
+
+#define RETURN_CIRCUIT_BREAKER if(search_cutoff_reached()) { \
+                                    search_cutoff = true;        \
                                     return ;\
                                 }
 
-#define BREAK_CIRCUIT_BREAKER if(std::chrono::duration_cast<std::chrono::milliseconds>(\
-                                std::chrono::high_resolution_clock::now() - search_begin).count() > search_stop_ms) { \
-                                    search_cutoff = true;                              \
+#define BREAK_CIRCUIT_BREAKER if(search_cutoff_reached()) { \
+                                    search_cutoff = true;       \
                                     break;\
                                 }
 
-spp::sparse_hash_map<uint32_t, int64_t> Index::text_match_sentinel_value;
-spp::sparse_hash_map<uint32_t, int64_t> Index::seq_id_sentinel_value;
-spp::sparse_hash_map<uint32_t, int64_t> Index::geo_sentinel_value;
-spp::sparse_hash_map<uint32_t, int64_t> Index::str_sentinel_value;
+sort_column_t Index::text_match_sentinel_value;
+sort_column_t Index::seq_id_sentinel_value;
+sort_column_t Index::geo_sentinel_value;
+sort_column_t Index::str_sentinel_value;
+facet_map_t Index::empty_facet_map;
 
 struct token_posting_t {
     uint32_t token_id;
@@ -56,7 +61,15 @@ Index::Index(const std::string& name, const uint32_t collection_id, const Store*
              const std::vector<char>& symbols_to_index, const std::vector<char>& token_separators):
         name(name), collection_id(collection_id), store(store), synonym_index(synonym_index), thread_pool(thread_pool),
         search_schema(search_schema),
-        seq_ids(new id_list_t(256)), symbols_to_index(symbols_to_index), token_separators(token_separators) {
+        seq_ids(new id_list_t(256)), symbols_to_index(symbols_to_index), token_separators(token_separators),
+        token_leaves_cache(TOKEN_LEAVES_CACHE_CAPACITY), write_generation(0),
+        filter_result_cache(FILTER_RESULT_CACHE_CAPACITY), facet_result_cache(FACET_RESULT_CACHE_CAPACITY),
+        geo_polygon_cache(GEO_POLYGON_CACHE_CAPACITY), override_resolution_cache(OVERRIDE_RESOLUTION_CACHE_CAPACITY) {
+
+    if(Config::get_instance().get_shared_vocabulary()) {
+        vocabulary = new art_tree;
+        art_tree_init(vocabulary);
+    }
 
     for(const auto & fname_field: search_schema) {
         if(!fname_field.second.index) {
@@ -67,16 +80,23 @@ Index::Index(const std::string& name, const uint32_t collection_id, const Store*
             art_tree *t = new art_tree;
             art_tree_init(t);
             search_index.emplace(fname_field.first, t);
+
+            if(vocabulary != nullptr) {
+                vocabulary_field_ids.emplace(fname_field.first, next_vocabulary_field_id++);
+            }
         } else if(fname_field.second.is_geopoint()) {
-            auto field_geo_index = new spp::sparse_hash_map<std::string, std::vector<uint32_t>>();
-            geopoint_index.emplace(fname_field.first, field_geo_index);
+            geopoint_index.emplace(fname_field.first, new geo_point_index_t());
 
             if(!fname_field.second.is_single_geopoint()) {
-                spp::sparse_hash_map<uint32_t, int64_t*> * doc_to_geos = new spp::sparse_hash_map<uint32_t, int64_t*>();
-                geo_array_index.emplace(fname_field.first, doc_to_geos);
+                geo_array_index.emplace(fname_field.first, new geo_points_column_t());
             }
+        } else if(fname_field.second.is_vector()) {
+            vector_index.emplace(fname_field.first, new vector_index_t(fname_field.second.num_dim,
+                                                                       fname_field.second.vec_dist,
+                                                                       fname_field.second.vec_int8));
         } else {
-            num_tree_t* num_tree = new num_tree_t;
+            // booleans are only ever filtered by equality, so they don't need a column to scan
+            num_tree_t* num_tree = new num_tree_t(!fname_field.second.is_bool());
             numerical_index.emplace(fname_field.first, num_tree);
         }
 
@@ -85,18 +105,32 @@ Index::Index(const std::string& name, const uint32_t collection_id, const Store*
                 adi_tree_t* tree = new adi_tree_t();
                 str_sort_index.emplace(fname_field.first, tree);
             } else if(fname_field.second.type != field_types::GEOPOINT_ARRAY) {
-                spp::sparse_hash_map<uint32_t, int64_t> * doc_to_score = new spp::sparse_hash_map<uint32_t, int64_t>();
+                sort_column_t * doc_to_score = new sort_column_t();
                 sort_index.emplace(fname_field.first, doc_to_score);
             }
         }
 
+        if(fname_field.second.type == field_types::STRING) {
+            token_count_index.emplace(fname_field.first, new sort_column_t());
+        }
+
+        if(fname_field.second.type == field_types::STRING) {
+            bigram_filters.emplace(fname_field.first, new bigram_filter_t());
+        }
+
         if(fname_field.second.facet) {
-            array_mapped_facet_t facet_array;
-            for(size_t i = 0; i < ARRAY_FACET_DIM; i++) {
-                facet_array[i] = new facet_map_t();
+            facet_index_v3.emplace(fname_field.first, new_facet_array());
+            group_hash_index.emplace(fname_field.first, new sort_column_t());
+
+            if(!fname_field.second.is_array()) {
+                facet_columns.emplace(fname_field.first, new facet_column_t());
             }
 
-            facet_index_v3.emplace(fname_field.first, facet_array);
+            facet_value_indices.emplace(fname_field.first, new facet_value_index_t());
+
+            if(fname_field.second.is_string()) {
+                str_value_index.emplace(fname_field.first, new str_value_index_t());
+            }
         }
 
         // initialize for non-string facet fields
@@ -107,17 +141,12 @@ Index::Index(const std::string& name, const uint32_t collection_id, const Store*
         }
 
         if(fname_field.second.infix) {
-            array_mapped_infix_t infix_sets(ARRAY_INFIX_DIM);
-
-            for(auto& infix_set: infix_sets) {
-                infix_set = new tsl::htrie_set<char>();
-            }
-
-            infix_index.emplace(fname_field.second.name, infix_sets);
+            infix_index.emplace(fname_field.second.name, new infix_index_t());
         }
     }
 
     num_documents = 0;
+    arena = SystemMetrics::NO_ARENA;
 }
 
 Index::~Index() {
@@ -131,6 +160,12 @@ Index::~Index() {
 
     search_index.clear();
 
+    if(vocabulary != nullptr) {
+        art_tree_destroy(vocabulary);
+        delete vocabulary;
+        vocabulary = nullptr;
+    }
+
     for(auto & name_index: geopoint_index) {
         delete name_index.second;
         name_index.second = nullptr;
@@ -139,16 +174,19 @@ Index::~Index() {
     geopoint_index.clear();
 
     for(auto& name_index: geo_array_index) {
-        for(auto& kv: *name_index.second) {
-            delete [] kv.second;
-        }
-
         delete name_index.second;
         name_index.second = nullptr;
     }
 
     geo_array_index.clear();
 
+    for(auto& name_index: vector_index) {
+        delete name_index.second;
+        name_index.second = nullptr;
+    }
+
+    vector_index.clear();
+
     for(auto & name_tree: numerical_index) {
         delete name_tree.second;
         name_tree.second = nullptr;
@@ -164,10 +202,8 @@ Index::~Index() {
     sort_index.clear();
 
     for(auto& kv: infix_index) {
-        for(auto& infix_set: kv.second) {
-            delete infix_set;
-            infix_set = nullptr;
-        }
+        delete kv.second;
+        kv.second = nullptr;
     }
 
     infix_index.clear();
@@ -180,15 +216,72 @@ Index::~Index() {
     str_sort_index.clear();
 
     for(auto& field_name_facet_map_array: facet_index_v3) {
-        for(auto& facet_map: field_name_facet_map_array.second) {
-            delete facet_map;
-            facet_map = nullptr;
-        }
+        delete_facet_array(field_name_facet_map_array.second);
     }
 
     facet_index_v3.clear();
 
+    for(auto& name_index: str_value_index) {
+        delete name_index.second;
+        name_index.second = nullptr;
+    }
+
+    str_value_index.clear();
+
+    for(auto& name_column: group_hash_index) {
+        delete name_column.second;
+        name_column.second = nullptr;
+    }
+
+    group_hash_index.clear();
+
+    for(auto& name_column: token_count_index) {
+        delete name_column.second;
+        name_column.second = nullptr;
+    }
+
+    token_count_index.clear();
+
+    for(auto& name_filter: bigram_filters) {
+        delete name_filter.second;
+        name_filter.second = nullptr;
+    }
+
+    bigram_filters.clear();
+
+    for(auto& name_column: facet_columns) {
+        delete name_column.second;
+        name_column.second = nullptr;
+    }
+
+    facet_columns.clear();
+
+    for(auto& name_value_index: facet_value_indices) {
+        delete name_value_index.second;
+        name_value_index.second = nullptr;
+    }
+
+    facet_value_indices.clear();
+
     delete seq_ids;
+
+    SystemMetrics::release_arena(arena);
+}
+
+array_mapped_facet_t Index::new_facet_array() {
+    array_mapped_facet_t facet_array;
+    facet_array.fill(&empty_facet_map);
+    return facet_array;
+}
+
+void Index::delete_facet_array(array_mapped_facet_t& facet_array) {
+    for(auto& facet_map: facet_array) {
+        if(facet_map != &empty_facet_map) {
+            delete facet_map;
+        }
+
+        facet_map = nullptr;
+    }
 }
 
 int64_t Index::get_points_from_doc(const nlohmann::json &document, const std::string & default_sorting_field) {
@@ -220,20 +313,48 @@ int64_t Index::float_to_in64_t(float f) {
     return i;
 }
 
+void token_offsets_builder_t::reset(offsets_facet_hashes_t& offsets) {
+    value_stamp++;
+    value_offsets = &offsets;
+}
+
+uint32_t token_offsets_builder_t::get_slot(const std::string& token) {
+    auto token_id_it = token_ids.find(token);
+    if(token_id_it == token_ids.end()) {
+        token_id_it = token_ids.emplace(token, id_values.size()).first;
+        id_values.push_back(0);
+        id_slots.push_back(0);
+    }
+
+    const uint32_t id = token_id_it->second;
+
+    if(id_values[id] != value_stamp) {
+        id_values[id] = value_stamp;
+        id_slots[id] = value_offsets->tokens.size();
+        value_offsets->tokens.push_back(token);
+        value_offsets->offsets.emplace_back();
+    }
+
+    return id_slots[id];
+}
+
 void Index::compute_token_offsets_facets(index_record& record,
                                           const std::unordered_map<std::string, field>& search_schema,
                                           const std::vector<char>& local_token_separators,
-                                          const std::vector<char>& local_symbols_to_index) {
+                                          const std::vector<char>& local_symbols_to_index,
+                                          token_offsets_builder_t& token_offsets_builder,
+                                          const std::unordered_set<std::string>& skip_fields) {
 
     const auto& document = record.doc;
 
     for(const auto& field_pair: search_schema) {
         const std::string& field_name = field_pair.first;
-        if(document.count(field_name) == 0 || !field_pair.second.index) {
+        if(document.count(field_name) == 0 || !field_pair.second.index || skip_fields.count(field_name) != 0) {
             continue;
         }
 
         offsets_facet_hashes_t offset_facet_hashes;
+        token_offsets_builder.reset(offset_facet_hashes);
 
         bool is_facet = search_schema.at(field_name).facet;
 
@@ -262,7 +383,7 @@ void Index::compute_token_offsets_facets(index_record& record,
 
                 tokenize_string_array_with_facets(strings, is_facet, field_pair.second,
                                                   local_symbols_to_index, local_token_separators,
-                                                  offset_facet_hashes.offsets, offset_facet_hashes.facet_hashes);
+                                                  token_offsets_builder, offset_facet_hashes);
             } else {
                 std::string text;
 
@@ -278,7 +399,7 @@ void Index::compute_token_offsets_facets(index_record& record,
 
                 tokenize_string_with_facets(text, is_facet, field_pair.second,
                                             local_symbols_to_index, local_token_separators,
-                                            offset_facet_hashes.offsets, offset_facet_hashes.facet_hashes);
+                                            token_offsets_builder, offset_facet_hashes);
             }
         }
 
@@ -287,15 +408,15 @@ void Index::compute_token_offsets_facets(index_record& record,
             if(field_pair.second.type == field_types::STRING) {
                 tokenize_string_with_facets(document[field_name], is_facet, field_pair.second,
                                             local_symbols_to_index, local_token_separators,
-                                            offset_facet_hashes.offsets, offset_facet_hashes.facet_hashes);
+                                            token_offsets_builder, offset_facet_hashes);
             } else {
                 tokenize_string_array_with_facets(document[field_name], is_facet, field_pair.second,
                                                   local_symbols_to_index, local_token_separators,
-                                                  offset_facet_hashes.offsets, offset_facet_hashes.facet_hashes);
+                                                  token_offsets_builder, offset_facet_hashes);
             }
         }
 
-        if(!offset_facet_hashes.offsets.empty() || !offset_facet_hashes.facet_hashes.empty()) {
+        if(!offset_facet_hashes.tokens.empty() || !offset_facet_hashes.facet_hashes.empty()) {
             record.field_index.emplace(field_name, std::move(offset_facet_hashes));
         }
     }
@@ -445,6 +566,11 @@ Option<uint32_t> Index::validate_index_in_memory(nlohmann::json& document, uint3
                     it++;
                 }
             }
+
+            if(a_field.is_vector() && document[field_name].size() != a_field.num_dim) {
+                return Option<>(400, "Field `" + field_name  + "` must have " + std::to_string(a_field.num_dim) +
+                                     " dimensions.");
+            }
         }
     }
 
@@ -462,6 +588,8 @@ void Index::validate_and_preprocess(Index *index, std::vector<index_record>& ite
 
     // runs in a partitioned thread
 
+    token_offsets_builder_t token_offsets_builder;
+
     for(size_t i = 0; i < batch_size; i++) {
         index_record& index_rec = iter_batch[batch_start_index + i];
 
@@ -496,17 +624,15 @@ void Index::validate_and_preprocess(Index *index, std::vector<index_record>& ite
                 scrub_reindex_doc(search_schema, index_rec.doc, index_rec.del_doc, index_rec.old_doc);
             }
 
-            compute_token_offsets_facets(index_rec, search_schema, token_separators, symbols_to_index);
+            compute_token_offsets_facets(index_rec, search_schema, token_separators, symbols_to_index,
+                                         token_offsets_builder, index->restored_fields);
 
             int64_t points = 0;
 
             if(index_rec.doc.count(default_sorting_field) == 0) {
                 auto default_sorting_field_it = index->sort_index.find(default_sorting_field);
                 if(default_sorting_field_it != index->sort_index.end()) {
-                    auto seq_id_it = default_sorting_field_it->second->find(index_rec.seq_id);
-                    if(seq_id_it != default_sorting_field_it->second->end()) {
-                        points = seq_id_it->second;
-                    } else {
+                    if(!default_sorting_field_it->second->get(index_rec.seq_id, points)) {
                         points = INT64_MIN;
                     }
                 } else {
@@ -533,12 +659,25 @@ size_t Index::batch_memory_index(Index *index, std::vector<index_record>& iter_b
                                  const std::vector<char>& symbols_to_index,
                                  const bool do_validation) {
 
-    const size_t concurrency = 4;
+    batch_preprocess(index, iter_batch, default_sorting_field, search_schema, fallback_field_type,
+                     token_separators, symbols_to_index, do_validation);
+
+    return batch_memory_index_preprocessed(index, iter_batch, search_schema);
+}
+
+void Index::batch_preprocess(Index *index, std::vector<index_record>& iter_batch,
+                             const std::string & default_sorting_field,
+                             const std::unordered_map<std::string, field> & search_schema,
+                             const std::string& fallback_field_type,
+                             const std::vector<char>& token_separators,
+                             const std::vector<char>& symbols_to_index,
+                             const bool do_validation) {
+
+    const size_t concurrency = std::max<size_t>(1, Config::get_instance().get_indexing_concurrency());
     const size_t num_threads = std::min(concurrency, iter_batch.size());
     const size_t window_size = (num_threads == 0) ? 0 :
                                (iter_batch.size() + num_threads - 1) / num_threads;  // rounds up
 
-    size_t num_indexed = 0;
     size_t num_processed = 0;
     std::mutex m_process;
     std::condition_variable cv_process;
@@ -555,7 +694,8 @@ size_t Index::batch_memory_index(Index *index, std::vector<index_record>& iter_b
 
         num_queued++;
 
-        index->thread_pool->enqueue([&, batch_index, batch_len]() {
+        index->thread_pool->enqueue_task(task_priority_t::BACKGROUND, task_kind_t::INDEXING,
+                                         [&, batch_index, batch_len]() {
             validate_and_preprocess(index, iter_batch, batch_index, batch_len, default_sorting_field, search_schema,
                                     fallback_field_type, token_separators, symbols_to_index, do_validation);
 
@@ -571,8 +711,19 @@ size_t Index::batch_memory_index(Index *index, std::vector<index_record>& iter_b
         std::unique_lock<std::mutex> lock_process(m_process);
         cv_process.wait(lock_process, [&](){ return num_processed == num_queued; });
     }
+}
+
+size_t Index::batch_memory_index_preprocessed(Index *index, std::vector<index_record>& iter_batch,
+                                              const std::unordered_map<std::string, field> & search_schema) {
+    size_t num_indexed = 0;
+    size_t num_processed = 0;
+    std::mutex m_process;
+    std::condition_variable cv_process;
 
-    std::unordered_set<std::string> found_fields;
+    size_t num_queued = 0;
+
+    // estimated indexing cost of each field found in the batch: one unit per document plus one per token offset
+    std::unordered_map<std::string, size_t> field_costs;
 
     for(size_t i = 0; i < iter_batch.size(); i++) {
         auto& index_rec = iter_batch[i];
@@ -589,29 +740,57 @@ size_t Index::batch_memory_index(Index *index, std::vector<index_record>& iter_b
         }
 
         for(const auto& kv: index_rec.doc.items()) {
-            found_fields.insert(kv.key());
+            size_t& cost = field_costs[kv.key()];
+            cost++;
+
+            auto field_index_it = index_rec.field_index.find(kv.key());
+            if(field_index_it != index_rec.field_index.end()) {
+                for(const auto& token_offsets: field_index_it->second.offsets) {
+                    cost += token_offsets.size();
+                }
+            }
         }
     }
 
-    num_queued = num_processed = 0;
+    std::vector<std::pair<size_t, std::string>> fields_by_cost;
 
-    for(const auto& field_name: found_fields) {
-        //LOG(INFO) << "field name: " << field_name;
+    for(const auto& field_cost: field_costs) {
+        const std::string& field_name = field_cost.first;
         if(field_name != "id" && search_schema.count(field_name) == 0) {
             continue;
         }
 
+        fields_by_cost.emplace_back(field_cost.second, field_name);
+    }
+
+    // a field's structures can be written only by a single thread, so the costliest fields are handed out first
+    // to workers that pull the next available field when they are done, keeping the slowest field off the tail
+    std::sort(fields_by_cost.begin(), fields_by_cost.end(), std::greater<>());
+
+    const size_t concurrency = std::max<size_t>(1, Config::get_instance().get_indexing_concurrency());
+    const size_t num_workers = std::min(concurrency, fields_by_cost.size());
+    std::atomic<size_t> next_field_index(0);
+
+    index->acquire_arena_when_large(index->seq_ids->num_ids() + num_indexed);
+
+    for(size_t worker_id = 0; worker_id < num_workers; worker_id++) {
         num_queued++;
 
-        index->thread_pool->enqueue([&]() {
-            const field& f = (field_name == "id") ?
-                             field("id", field_types::STRING, false) : search_schema.at(field_name);
-            try {
-                index->index_field_in_memory(f, iter_batch);
-            } catch(std::exception& e) {
-                LOG(ERROR) << "Unhandled Typesense error: " << e.what();
-                for(auto& record: iter_batch) {
-                    record.index_failure(500, "Unhandled Typesense error in index batch, check logs for details.");
+        index->thread_pool->enqueue_task(task_priority_t::BACKGROUND, task_kind_t::INDEXING, [&]() {
+            allocator_arena_scope_t arena_scope(index->arena);
+            size_t field_index;
+
+            while((field_index = next_field_index++) < fields_by_cost.size()) {
+                const std::string& field_name = fields_by_cost[field_index].second;
+                const field& f = (field_name == "id") ?
+                                 field("id", field_types::STRING, false) : search_schema.at(field_name);
+                try {
+                    index->index_field_in_memory(f, iter_batch);
+                } catch(std::exception& e) {
+                    LOG(ERROR) << "Unhandled Typesense error: " << e.what();
+                    for(auto& record: iter_batch) {
+                        record.index_failure(500, "Unhandled Typesense error in index batch, check logs for details.");
+                    }
                 }
             }
 
@@ -626,6 +805,8 @@ size_t Index::batch_memory_index(Index *index, std::vector<index_record>& iter_b
         cv_process.wait(lock_process, [&](){ return num_processed == num_queued; });
     }
 
+    index->write_generation++;
+
     return num_indexed;
 }
 
@@ -659,10 +840,11 @@ void Index::index_field_in_memory(const field& afield, std::vector<index_record>
     bool non_string_facet_field = (afield.facet && !afield.is_geopoint());
 
     if(afield.is_string() || non_string_facet_field) {
-        std::unordered_map<std::string, std::vector<art_document>> token_to_doc_offsets;
+        // tokens point into the records, whose offsets are moved into the documents
+        std::unordered_map<std::string_view, std::vector<art_document>> token_to_doc_offsets;
         int64_t max_score = INT64_MIN;
 
-        for(const auto& record: iter_batch) {
+        for(auto& record: iter_batch) {
             if(!record.indexed.ok()) {
                 // some records could have been invalidated upstream
                 continue;
@@ -689,20 +871,62 @@ void Index::index_field_in_memory(const field& afield, std::vector<index_record>
                     fhashvalues.hashes[i] = field_index_it->second.facet_hashes[i];
                 }
 
-                facet_index_v3[afield.name][seq_id % ARRAY_FACET_DIM]->emplace(seq_id, std::move(fhashvalues));
+                uint64_t group_hash = 1; // some constant initial value
+                for(auto facet_hash: field_index_it->second.facet_hashes) {
+                    group_hash = StringUtils::hash_combine(group_hash, facet_hash);
+                }
+
+                facet_map_t*& facet_map = facet_index_v3[afield.name][seq_id % ARRAY_FACET_DIM];
+                if(facet_map == &empty_facet_map) {
+                    facet_map = new facet_map_t();
+                }
+
+                facet_map->emplace(seq_id, std::move(fhashvalues));
+                group_hash_index[afield.name]->emplace(seq_id, int64_t(group_hash));
+
+                const auto facet_column_it = facet_columns.find(afield.name);
+                if(facet_column_it != facet_columns.end() && !field_index_it->second.facet_hashes.empty()) {
+                    facet_column_it->second->set(seq_id, field_index_it->second.facet_hashes[0]);
+                }
+
+                const auto facet_value_index_it = facet_value_indices.find(afield.name);
+                if(facet_value_index_it != facet_value_indices.end()) {
+                    index_facet_values(afield, document[afield.name], field_index_it->second.facet_hashes,
+                                       facet_value_index_it->second);
+                }
+
+                const auto value_index_it = str_value_index.find(afield.name);
+                if(value_index_it != str_value_index.end()) {
+                    for(auto facet_hash: field_index_it->second.facet_hashes) {
+                        value_index_it->second->insert(facet_hash, seq_id);
+                    }
+                }
             }
 
             if(record.points > max_score) {
                 max_score = record.points;
             }
 
-            for(auto &token_offsets: field_index_it->second.offsets) {
-                token_to_doc_offsets[token_offsets.first].emplace_back(seq_id, record.points, token_offsets.second);
+            auto& field_offsets = field_index_it->second;
+
+            const auto token_count_it = token_count_index.find(afield.name);
+            if(token_count_it != token_count_index.end() && field_offsets.num_tokens != 0) {
+                token_count_it->second->emplace(seq_id, field_offsets.num_tokens);
+            }
+
+            const auto bigram_filter_it = bigram_filters.find(afield.name);
+            if(bigram_filter_it != bigram_filters.end()) {
+                for(uint64_t bigram_hash: field_offsets.bigram_hashes) {
+                    bigram_filter_it->second->add(bigram_hash);
+                }
+            }
+
+            for(size_t slot = 0; slot < field_offsets.tokens.size(); slot++) {
+                const std::string& token = field_offsets.tokens[slot];
+                token_to_doc_offsets[token].emplace_back(seq_id, record.points, std::move(field_offsets.offsets[slot]));
 
                 if(afield.infix) {
-                    auto strhash = StringUtils::hash_wy(token_offsets.first.c_str(), token_offsets.first.size());
-                    const auto& infix_sets = infix_index.at(afield.name);
-                    infix_sets[strhash % 4]->insert(token_offsets.first);
+                    infix_index.at(afield.name)->insert(token);
                 }
             }
         }
@@ -715,14 +939,30 @@ void Index::index_field_in_memory(const field& afield, std::vector<index_record>
         art_tree *t = tree_it->second;
 
         for(auto& token_to_doc: token_to_doc_offsets) {
-            const std::string& token = token_to_doc.first;
+            const std::string_view& token = token_to_doc.first;
             std::vector<art_document>& documents = token_to_doc.second;
 
-            const auto *key = (const unsigned char *) token.c_str();
+            // the token is a whole string of its record, so it is followed by a \0
+            const auto *key = (const unsigned char *) token.data();
             int key_len = (int) token.length() + 1;  // for the terminating \0 char
 
             //LOG(INFO) << "key: " << key << ", art_doc.id: " << art_doc.id;
-            art_inserts(t, key, key_len, max_score, documents);
+            void* values = art_inserts(t, key, key_len, max_score, documents);
+
+            if(values != nullptr) {
+                // updates are upserted into the middle of existing lists, splitting their blocks
+                posting_t::compact(values);
+            }
+        }
+
+        if(vocabulary != nullptr && afield.is_string()) {
+            std::unique_lock vocabulary_lock(vocabulary_mutex);
+
+            for(const auto& token_to_doc: token_to_doc_offsets) {
+                const std::string_view& token = token_to_doc.first;
+                add_to_vocabulary(afield.name, (const unsigned char *) token.data(), (int) token.length() + 1,
+                                  max_score);
+            }
         }
     }
 
@@ -766,15 +1006,7 @@ void Index::index_field_in_memory(const field& afield, std::vector<index_record>
             iterate_and_index_numerical_field(iter_batch, afield, [&afield, geo_index]
                     (const index_record& record, uint32_t seq_id) {
                 const std::vector<double>& latlong = record.doc[afield.name];
-
-                S2RegionTermIndexer::Options options;
-                options.set_index_contains_points_only(true);
-                S2RegionTermIndexer indexer(options);
-                S2Point point = S2LatLng::FromDegrees(latlong[0], latlong[1]).ToPoint();
-
-                for(const auto& term: indexer.GetIndexTerms(point, "")) {
-                    (*geo_index)[term].push_back(seq_id);
-                }
+                geo_index->insert(seq_id, GeoPoint::pack_lat_lng(latlong[0], latlong[1]));
             });
         } else if(afield.type == field_types::GEOPOINT_ARRAY) {
             auto geo_index = geopoint_index.at(afield.name);
@@ -783,30 +1015,25 @@ void Index::index_field_in_memory(const field& afield, std::vector<index_record>
             [&afield, &geo_array_index=geo_array_index, geo_index](const index_record& record, uint32_t seq_id) {
 
                 const std::vector<std::vector<double>>& latlongs = record.doc[afield.name];
-                S2RegionTermIndexer::Options options;
-                options.set_index_contains_points_only(true);
-                S2RegionTermIndexer indexer(options);
-
-                int64_t* packed_latlongs = new int64_t[latlongs.size() + 1];
-                packed_latlongs[0] = latlongs.size();
-
-                for(size_t li = 0; li < latlongs.size(); li++) {
-                    auto& latlong = latlongs[li];
-                    S2Point point = S2LatLng::FromDegrees(latlong[0], latlong[1]).ToPoint();
-                    std::set<std::string> terms;
-                    for(const auto& term: indexer.GetIndexTerms(point, "")) {
-                        terms.insert(term);
-                    }
 
-                    for(const auto& term: terms) {
-                        (*geo_index)[term].push_back(seq_id);
-                    }
+                std::vector<int64_t> packed_latlongs;
+                packed_latlongs.reserve(latlongs.size());
 
+                for(auto& latlong: latlongs) {
                     int64_t packed_latlong = GeoPoint::pack_lat_lng(latlong[0], latlong[1]);
-                    packed_latlongs[li + 1] = packed_latlong;
+                    packed_latlongs.push_back(packed_latlong);
+                    geo_index->insert(seq_id, packed_latlong);
                 }
 
-                geo_array_index.at(afield.name)->emplace(seq_id, packed_latlongs);
+                geo_array_index.at(afield.name)->set(seq_id, packed_latlongs.data(), packed_latlongs.size());
+            });
+        } else if(afield.is_vector()) {
+            auto field_vector_index = vector_index.at(afield.name);
+
+            iterate_and_index_numerical_field(iter_batch, afield, [&afield, field_vector_index]
+                    (const index_record& record, uint32_t seq_id) {
+                const std::vector<float>& values = record.doc[afield.name].get<std::vector<float>>();
+                field_vector_index->insert(seq_id, values.data());
             });
         } else if(afield.is_array()) {
             // all other numerical arrays
@@ -842,7 +1069,7 @@ void Index::index_field_in_memory(const field& afield, std::vector<index_record>
 
         // add numerical values automatically into sort index if sorting is enabled
         if(afield.is_num_sortable() && afield.type != field_types::GEOPOINT_ARRAY) {
-            spp::sparse_hash_map<uint32_t, int64_t> *doc_to_score = sort_index.at(afield.name);
+            sort_column_t *doc_to_score = sort_index.at(afield.name);
 
             bool is_integer = afield.is_integer();
             bool is_float = afield.is_float();
@@ -928,25 +1155,155 @@ uint64_t Index::facet_token_hash(const field & a_field, const std::string &token
     return hash;
 }
 
+std::string Index::facet_token_text(const field& a_field, const nlohmann::json& value) {
+    if(a_field.is_string()) {
+        return value.get<std::string>();
+    } else if(a_field.type == field_types::INT32 || a_field.type == field_types::INT32_ARRAY) {
+        return std::to_string(value.get<int32_t>());
+    } else if(a_field.type == field_types::INT64 || a_field.type == field_types::INT64_ARRAY) {
+        return std::to_string(value.get<int64_t>());
+    } else if(a_field.type == field_types::FLOAT || a_field.type == field_types::FLOAT_ARRAY) {
+        return StringUtils::float_to_str(value.get<float>());
+    } else if(a_field.type == field_types::BOOL || a_field.type == field_types::BOOL_ARRAY) {
+        return std::to_string(value.get<bool>());
+    }
+
+    return "";
+}
+
+void Index::index_facet_values(const field& afield, const nlohmann::json& field_value,
+                               const std::vector<uint64_t>& facet_hashes,
+                               facet_value_index_t* facet_value_index) const {
+    const size_t num_values = afield.is_array() ? field_value.size() : 1;
+
+    // values are tokenized the same way as when their hashes were computed
+    auto tokenize = [&](size_t value_index, std::vector<std::string>& tokens) {
+        const std::string& text = facet_token_text(afield, afield.is_array() ? field_value[value_index] : field_value);
+        Tokenizer tokenizer(text, true, !afield.is_string(), afield.locale, symbols_to_index, token_separators);
+        std::string token;
+        size_t token_index = 0;
+
+        while(tokenizer.next(token, token_index)) {
+            if(!token.empty()) {
+                tokens.push_back(token);
+            }
+        }
+    };
+
+    // values without any token get no hash, so the hashes of an array can be fewer than its elements
+    std::vector<size_t> hash_value_indices;
+
+    if(num_values == facet_hashes.size()) {
+        for(size_t i = 0; i < num_values; i++) {
+            hash_value_indices.push_back(i);
+        }
+    } else {
+        for(size_t i = 0; i < num_values; i++) {
+            std::vector<std::string> tokens;
+            tokenize(i, tokens);
+            if(!tokens.empty()) {
+                hash_value_indices.push_back(i);
+            }
+        }
+
+        if(hash_value_indices.size() != facet_hashes.size()) {
+            return ;
+        }
+    }
+
+    for(size_t i = 0; i < facet_hashes.size(); i++) {
+        const size_t value_index = hash_value_indices[i];
+        const std::string& value = facet_value_to_string(afield, afield.is_array() ? field_value[value_index] :
+                                                                                    field_value);
+        std::vector<std::string> tokens;
+
+        if(!facet_value_index->contains(facet_hashes[i])) {
+            tokenize(value_index, tokens);
+        }
+
+        facet_value_index->insert(facet_hashes[i], value, tokens);
+    }
+}
+
+std::string Index::facet_value_to_string(const field& a_field, const nlohmann::json& value) {
+    std::string str_value;
+
+    if(a_field.type == field_types::STRING || a_field.type == field_types::STRING_ARRAY) {
+        str_value = value.get<std::string>();
+    } else if(a_field.type == field_types::INT32 || a_field.type == field_types::INT32_ARRAY) {
+        str_value = std::to_string(value.get<int32_t>());
+    } else if(a_field.type == field_types::INT64 || a_field.type == field_types::INT64_ARRAY) {
+        str_value = std::to_string(value.get<int64_t>());
+    } else if(a_field.type == field_types::FLOAT) {
+        str_value = StringUtils::float_to_str(value.get<float>());
+        if(str_value != "0") {
+            str_value.erase(str_value.find_last_not_of('0') + 1, std::string::npos);  // remove trailing zeros
+        }
+    } else if(a_field.type == field_types::FLOAT_ARRAY) {
+        str_value = StringUtils::float_to_str(value.get<float>());
+        str_value.erase(str_value.find_last_not_of('0') + 1, std::string::npos);  // remove trailing zeros
+    } else if(a_field.type == field_types::BOOL || a_field.type == field_types::BOOL_ARRAY) {
+        str_value = value.get<bool>() ? "true" : "false";
+    }
+
+    return str_value;
+}
+
+uint64_t Index::string_facet_hash(const field& a_field, const std::string& text,
+                                  const std::vector<char>& symbols_to_index,
+                                  const std::vector<char>& token_separators) {
+    Tokenizer tokenizer(text, true, false, a_field.locale, symbols_to_index, token_separators);
+    std::string token;
+    size_t token_index = 0;
+    uint64_t facet_hash = 1;
+
+    while(tokenizer.next(token, token_index)) {
+        if(token.empty()) {
+            continue;
+        }
+
+        uint64_t token_hash = Index::facet_token_hash(a_field, token);
+        if(token_index == 0) {
+            facet_hash = token_hash;
+        } else {
+            facet_hash = StringUtils::hash_combine(facet_hash, token_hash);
+        }
+    }
+
+    return facet_hash;
+}
+
 void Index::tokenize_string_with_facets(const std::string& text, bool is_facet, const field& a_field,
                                         const std::vector<char>& symbols_to_index,
                                         const std::vector<char>& token_separators,
-                                        std::unordered_map<std::string, std::vector<uint32_t>>& token_to_offsets,
-                                        std::vector<uint64_t>& facet_hashes) {
+                                        token_offsets_builder_t& token_offsets_builder,
+                                        offsets_facet_hashes_t& offset_facet_hashes) {
 
     Tokenizer tokenizer(text, true, !a_field.is_string(), a_field.locale, symbols_to_index, token_separators);
     std::string token;
-    std::string last_token;
+    std::string prev_token;
+    uint32_t last_slot = 0;
     size_t token_index = 0;
     uint64_t facet_hash = 1;
 
+    auto& token_to_offsets = offset_facet_hashes.offsets;
+
     while(tokenizer.next(token, token_index)) {
         if(token.empty()) {
             continue;
         }
 
-        token_to_offsets[token].push_back(token_index + 1);
-        last_token = token;
+        last_slot = token_offsets_builder.get_slot(token);
+        token_to_offsets[last_slot].push_back(token_index + 1);
+        offset_facet_hashes.num_tokens = token_index + 1;
+
+        if(a_field.type == field_types::STRING) {
+            if(!prev_token.empty()) {
+                offset_facet_hashes.bigram_hashes.push_back(bigram_filter_t::pair_hash(prev_token, token));
+            }
+
+            prev_token = token;
+        }
 
         if(is_facet) {
             uint64_t token_hash = Index::facet_token_hash(a_field, token);
@@ -960,11 +1317,11 @@ void Index::tokenize_string_with_facets(const std::string& text, bool is_facet,
 
     if(!token_to_offsets.empty()) {
         // push 0 for the last occurring token (used for exact match ranking)
-        token_to_offsets[last_token].push_back(0);
+        token_to_offsets[last_slot].push_back(0);
     }
 
     if(is_facet) {
-        facet_hashes.push_back(facet_hash);
+        offset_facet_hashes.facet_hashes.push_back(facet_hash);
     }
 }
 
@@ -972,15 +1329,22 @@ void Index::tokenize_string_array_with_facets(const std::vector<std::string>& st
                                               const field& a_field,
                                               const std::vector<char>& symbols_to_index,
                                               const std::vector<char>& token_separators,
-                                              std::unordered_map<std::string, std::vector<uint32_t>>& token_to_offsets,
-                                              std::vector<uint64_t>& facet_hashes) {
+                                              token_offsets_builder_t& token_offsets_builder,
+                                              offsets_facet_hashes_t& offset_facet_hashes) {
+
+    auto& token_to_offsets = offset_facet_hashes.offsets;
+
+    // array index each token was last found in (plus 1), required to deal with repeating tokens
+    std::vector<size_t> slot_array_indices;
+    std::vector<uint32_t> element_slots;
 
     for(size_t array_index = 0; array_index < strings.size(); array_index++) {
         const std::string& str = strings[array_index];
-        std::set<std::string> token_set;  // required to deal with repeating tokens
+        element_slots.clear();
 
         Tokenizer tokenizer(str, true, !a_field.is_string(), a_field.locale, symbols_to_index, token_separators);
-        std::string token, last_token;
+        std::string token;
+        uint32_t last_slot = 0;
         size_t token_index = 0;
         uint64_t facet_hash = 1;
 
@@ -990,9 +1354,18 @@ void Index::tokenize_string_array_with_facets(const std::vector<std::string>& st
                 continue;
             }
 
-            token_to_offsets[token].push_back(token_index + 1);
-            token_set.insert(token);
-            last_token = token;
+            const uint32_t slot = token_offsets_builder.get_slot(token);
+            token_to_offsets[slot].push_back(token_index + 1);
+            last_slot = slot;
+
+            if(slot >= slot_array_indices.size()) {
+                slot_array_indices.resize(slot + 1, 0);
+            }
+
+            if(slot_array_indices[slot] != array_index + 1) {
+                slot_array_indices[slot] = array_index + 1;
+                element_slots.push_back(slot);
+            }
 
             if(is_facet) {
                 uint64_t token_hash = Index::facet_token_hash(a_field, token);
@@ -1004,30 +1377,29 @@ void Index::tokenize_string_array_with_facets(const std::vector<std::string>& st
             }
         }
 
-        //LOG(INFO) << "Str: " << str << ", last_token: " << last_token;
-
-        if(token_set.empty()) {
+        if(element_slots.empty()) {
             continue;
         }
 
         if(is_facet) {
-            facet_hashes.push_back(facet_hash);
+            offset_facet_hashes.facet_hashes.push_back(facet_hash);
         }
 
-        for(auto& the_token: token_set) {
+        for(uint32_t slot: element_slots) {
             // repeat last element to indicate end of offsets for this array index
-            token_to_offsets[the_token].push_back(token_to_offsets[the_token].back());
+            token_to_offsets[slot].push_back(token_to_offsets[slot].back());
 
             // iterate and append this array index to all tokens
-            token_to_offsets[the_token].push_back(array_index);
+            token_to_offsets[slot].push_back(array_index);
         }
 
         // push 0 for the last occurring token (used for exact match ranking)
-        token_to_offsets[last_token].push_back(0);
+        token_to_offsets[last_slot].push_back(0);
     }
 }
 
-void Index::compute_facet_stats(facet &a_facet, uint64_t raw_value, const std::string & field_type) {
+void Index::compute_facet_stats(facet &a_facet, uint64_t raw_value, const std::string & field_type,
+                                size_t num_occurrences) {
     if(field_type == field_types::INT32 || field_type == field_types::INT32_ARRAY) {
         int32_t val = raw_value;
         if (val < a_facet.stats.fvmin) {
@@ -1036,8 +1408,8 @@ void Index::compute_facet_stats(facet &a_facet, uint64_t raw_value, const std::s
         if (val > a_facet.stats.fvmax) {
             a_facet.stats.fvmax = val;
         }
-        a_facet.stats.fvsum += val;
-        a_facet.stats.fvcount++;
+        a_facet.stats.fvsum += double(val) * num_occurrences;
+        a_facet.stats.fvcount += num_occurrences;
     } else if(field_type == field_types::INT64 || field_type == field_types::INT64_ARRAY) {
         int64_t val = raw_value;
         if(val < a_facet.stats.fvmin) {
@@ -1046,8 +1418,8 @@ void Index::compute_facet_stats(facet &a_facet, uint64_t raw_value, const std::s
         if(val > a_facet.stats.fvmax) {
             a_facet.stats.fvmax = val;
         }
-        a_facet.stats.fvsum += val;
-        a_facet.stats.fvcount++;
+        a_facet.stats.fvsum += double(val) * num_occurrences;
+        a_facet.stats.fvcount += num_occurrences;
     } else if(field_type == field_types::FLOAT || field_type == field_types::FLOAT_ARRAY) {
         float val = reinterpret_cast<float&>(raw_value);
         if(val < a_facet.stats.fvmin) {
@@ -1056,8 +1428,8 @@ void Index::compute_facet_stats(facet &a_facet, uint64_t raw_value, const std::s
         if(val > a_facet.stats.fvmax) {
             a_facet.stats.fvmax = val;
         }
-        a_facet.stats.fvsum += val;
-        a_facet.stats.fvcount++;
+        a_facet.stats.fvsum += double(val) * num_occurrences;
+        a_facet.stats.fvcount += num_occurrences;
     }
 }
 
@@ -1066,6 +1438,9 @@ void Index::do_facets(std::vector<facet> & facets, facet_query_t & facet_query,
                       const size_t group_limit, const std::vector<std::string>& group_by_fields,
                       const uint32_t* result_ids, size_t results_size) const {
 
+    search_stage_timer_t facets_timer(search_profile_t::FACETS);
+    const std::vector<const sort_column_t*> group_columns = get_group_columns(group_by_fields);
+
     // assumed that facet fields have already been validated upstream
     for(size_t findex=0; findex < facets.size(); findex++) {
         auto& a_facet = facets[findex];
@@ -1074,14 +1449,70 @@ void Index::do_facets(std::vector<facet> & facets, facet_query_t & facet_query,
         const auto& fquery_hashes = facet_infos[findex].hashes;
         const bool should_compute_stats = facet_infos[findex].should_compute_stats;
 
+        if(!a_facet.ranges.empty()) {
+            count_facet_ranges(a_facet, result_ids, results_size);
+            continue;
+        }
+
         const auto& field_facet_mapping_it = facet_index_v3.find(a_facet.field_name);
         if(field_facet_mapping_it == facet_index_v3.end()) {
             continue;
         }
 
+        const auto facet_column_it = facet_columns.find(a_facet.field_name);
+
+        // the column is counted into an array with a slot per distinct value, which pays off only when the result
+        // set is not much smaller than the number of values
+        if(!group_limit && facet_column_it != facet_columns.end() &&
+           facet_column_it->second->num_values() <= results_size * FACET_COLUMN_MAX_VALUES_PER_ID) {
+            const facet_column_t* facet_column = facet_column_it->second;
+            std::vector<uint32_t> counts(facet_column->num_values(), 0);
+            std::vector<uint32_t> last_ids(facet_column->num_values(), 0);
+
+            for(size_t i = 0; i < results_size; i += (1 << 12)) {
+                // check for search cutoff but only once every 2^12 docs to reduce overhead
+                if(i != 0) {
+                    RETURN_CIRCUIT_BREAKER
+                }
+
+                facet_column->count(result_ids + i, std::min<size_t>(1 << 12, results_size - i),
+                                    counts.data(), last_ids.data());
+            }
+
+            for(uint32_t ordinal = 0; ordinal < counts.size(); ordinal++) {
+                if(counts[ordinal] == 0) {
+                    continue;
+                }
+
+                const uint64_t fhash = facet_column->get_hash(ordinal);
+
+                if(should_compute_stats) {
+                    compute_facet_stats(a_facet, fhash, facet_field.type, counts[ordinal]);
+                }
+
+                if(!use_facet_query || fquery_hashes.find(fhash) != fquery_hashes.end()) {
+                    facet_count_t& facet_count = a_facet.result_map[fhash];
+                    facet_count.doc_id = last_ids[ordinal];
+                    facet_count.array_pos = 0;
+                    facet_count.count += counts[ordinal];
+
+                    if(use_facet_query) {
+                        a_facet.hash_tokens[fhash] = fquery_hashes.at(fhash);
+                    }
+                }
+            }
+
+            continue;
+        }
+
         const auto& field_facet_mapping = field_facet_mapping_it->second;
 
         for(size_t i = 0; i < results_size; i++) {
+            // check for search cutoff but only once every 2^12 docs to reduce overhead
+            if(((i + 1) % (1 << 12)) == 0) {
+                RETURN_CIRCUIT_BREAKER
+            }
+
             uint32_t doc_seq_id = result_ids[i];
             const auto& facet_hashes_it = field_facet_mapping[doc_seq_id % ARRAY_FACET_DIM]->find(doc_seq_id);
 
@@ -1090,7 +1521,7 @@ void Index::do_facets(std::vector<facet> & facets, facet_query_t & facet_query,
             }
 
             const auto& facet_hashes = facet_hashes_it->second;
-            const uint64_t distinct_id = group_limit ? get_distinct_id(group_by_fields, doc_seq_id) : 0;
+            const uint64_t distinct_id = group_limit ? get_distinct_id(group_columns, doc_seq_id) : 0;
 
             for(size_t j = 0; j < facet_hashes.size(); j++) {
                 auto fhash = facet_hashes.hashes[j];
@@ -1122,17 +1553,48 @@ void Index::do_facets(std::vector<facet> & facets, facet_query_t & facet_query,
     }
 }
 
+void Index::count_facet_ranges(facet& a_facet, const uint32_t* result_ids, size_t results_size) const {
+    const auto sort_column_it = sort_index.find(a_facet.field_name);
+    if(sort_column_it == sort_index.end()) {
+        return ;
+    }
+
+    std::vector<int64_t> range_mins, range_maxs;
+    std::vector<uint32_t> counts(a_facet.ranges.size(), 0);
+
+    for(const auto& range: a_facet.ranges) {
+        range_mins.push_back(range.min);
+        range_maxs.push_back(range.max);
+    }
+
+    for(size_t i = 0; i < results_size; i += (1 << 12)) {
+        // check for search cutoff but only once every 2^12 docs to reduce overhead
+        if(i != 0) {
+            BREAK_CIRCUIT_BREAKER
+        }
+
+        sort_column_it->second->count_ranges(result_ids + i, std::min<size_t>(1 << 12, results_size - i),
+                                             range_mins.data(), range_maxs.data(), range_mins.size(), counts.data());
+    }
+
+    for(size_t r = 0; r < a_facet.ranges.size(); r++) {
+        a_facet.ranges[r].count += counts[r];
+    }
+}
+
 void Index::aggregate_topster(Topster* agg_topster, Topster* index_topster) {
     if(index_topster->distinct) {
-        for(auto &group_topster_entry: index_topster->group_kv_map) {
-            Topster* group_topster = group_topster_entry.second;
-            for(const auto& map_kv: group_topster->kv_map) {
-                agg_topster->add(map_kv.second);
+        group_topster_t& groups = index_topster->groups;
+        for(size_t group_index = 0; group_index < groups.num_groups(); group_index++) {
+            KV* group_kvs = groups.get_group_kvs(group_index);
+            for(uint32_t i = 0; i < groups.get_group_size(group_index); i++) {
+                agg_topster->add(&group_kvs[i]);
             }
         }
     } else {
-        for(const auto& map_kv: index_topster->kv_map) {
-            agg_topster->add(map_kv.second);
+        index_topster->flush();
+        for(uint32_t i = 0; i < index_topster->size; i++) {
+            agg_topster->add(index_topster->getKV(i));
         }
     }
 }
@@ -1146,7 +1608,7 @@ void Index::search_all_candidates(const size_t num_search_fields,
                                   std::vector<std::vector<art_leaf*>>& searched_queries,
                                   tsl::htrie_map<char, token_leaf>& qtoken_set,
                                   Topster* topster,
-                                  spp::sparse_hash_set<uint64_t>& groups_processed,
+                                  group_counter_t& groups_processed,
                                   uint32_t*& all_result_ids, size_t& all_result_ids_len,
                                   const size_t typo_tokens_threshold,
                                   const size_t group_limit,
@@ -1160,10 +1622,14 @@ void Index::search_all_candidates(const size_t num_search_fields,
                                   const size_t max_candidates,
                                   int syn_orig_num_tokens,
                                   const int* sort_order,
-                                  std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
+                                  std::array<sort_column_t*, 3>& field_values,
                                   const std::vector<size_t>& geopoint_indices,
                                   std::set<uint64>& query_hashes,
-                                  std::vector<uint32_t>& id_buff) const {
+                                  intersection_memo_t* intersection_memo,
+                                  std::vector<uint32_t>& id_buff,
+                                  const size_t concurrency,
+                                  const bool enable_top_k_pruning,
+                                  query_plan_t* query_plan) const {
 
     /*if(!token_candidates_vec.empty()) {
         LOG(INFO) << "Prefix candidates size: " << token_candidates_vec.back().candidates.size();
@@ -1245,6 +1711,13 @@ void Index::search_all_candidates(const size_t num_search_fields,
 
         token_candidates_vec.back().candidates.clear();
         token_candidates_vec.back().candidates.assign(trimmed_candidates.begin(), trimmed_candidates.end());
+
+        auto& trimmed_hashes = token_candidates_vec.back().candidate_hashes;
+        trimmed_hashes.clear();
+
+        for(const auto& trimmed_candidate: trimmed_candidates) {
+            trimmed_hashes.push_back(StringUtils::hash_wy(trimmed_candidate.c_str(), trimmed_candidate.size()));
+        }
     }
 
     auto product = []( long long a, tok_candidates & b ) { return a*b.candidates.size(); };
@@ -1285,7 +1758,8 @@ void Index::search_all_candidates(const size_t num_search_fields,
                              filter_ids, filter_ids_length, total_cost, syn_orig_num_tokens,
                              exclude_token_ids, exclude_token_ids_size,
                              sort_order, field_values, geopoint_indices,
-                             id_buff, all_result_ids, all_result_ids_len);
+                             id_buff, intersection_memo, all_result_ids, all_result_ids_len, concurrency,
+                             enable_top_k_pruning, query_plan);
 
         query_hashes.insert(qhash);
     }
@@ -1299,7 +1773,7 @@ void Index::search_candidates(const uint8_t & field_id, bool field_is_array,
                               std::vector<token_candidates> & token_candidates_vec,
                               std::vector<std::vector<art_leaf*>> & searched_queries,
                               Topster* topster,
-                              spp::sparse_hash_set<uint64_t>& groups_processed,
+                              group_counter_t& groups_processed,
                               uint32_t** all_result_ids, size_t & all_result_ids_len,
                               size_t& field_num_results,
                               const size_t typo_tokens_threshold,
@@ -1317,7 +1791,7 @@ void Index::search_candidates(const uint8_t & field_id, bool field_is_array,
     long long int N = std::accumulate(token_candidates_vec.begin(), token_candidates_vec.end(), 1LL, product);
 
     int sort_order[3]; // 1 or -1 based on DESC or ASC respectively
-    std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3> field_values;
+    std::array<sort_column_t*, 3> field_values;
     std::vector<size_t> geopoint_indices;
 
     populate_sort_mapping(sort_order, geopoint_indices, sort_fields, field_values);
@@ -1328,6 +1802,9 @@ void Index::search_candidates(const uint8_t & field_id, bool field_is_array,
     for (long long n = 0; n < N && n < combination_limit; ++n) {
         RETURN_CIRCUIT_BREAKER
 
+        // the topsters of a combination are gone by the next one, which takes their memory over
+        search_arena_scope_t arena_scope;
+
         // every element in `query_suggestion` contains a token and its associated hits
         std::vector<art_leaf*> query_suggestion(token_candidates_vec.size());
 
@@ -1382,7 +1859,7 @@ void Index::search_candidates(const uint8_t & field_id, bool field_is_array,
 
         std::vector<uint32_t> result_id_vecs[concurrency];
         Topster* topsters[concurrency];
-        std::vector<spp::sparse_hash_set<uint64_t>> groups_processed_vec(concurrency);
+        std::vector<group_counter_t> groups_processed_vec(concurrency);
 
         if(topster == nullptr) {
             posting_t::block_intersector_t(
@@ -1393,7 +1870,9 @@ void Index::search_candidates(const uint8_t & field_id, bool field_is_array,
             }, concurrency);
         } else {
             for(size_t i = 0; i < concurrency; i++) {
-                topsters[i] = new Topster(topster->MAX_SIZE, topster->distinct);
+                topsters[i] = new Topster(topster->MAX_SIZE, topster->distinct, search_arena);
+                topsters[i]->groups.set_max_groups(topster->groups.get_max_groups());
+                topsters[i]->set_search_after(topster->get_search_after());
             }
 
             posting_t::block_intersector_t(
@@ -1432,7 +1911,7 @@ void Index::search_candidates(const uint8_t & field_id, bool field_is_array,
                 if (topster != nullptr) {
                     // topster is null when used by overrides which requires only IDs but not actual processing
                     aggregate_topster(topster, topsters[i]);
-                    groups_processed.insert(groups_processed_vec[i].begin(), groups_processed_vec[i].end());
+                    groups_processed.merge(groups_processed_vec[i]);
                 }
             }
 
@@ -1463,39 +1942,292 @@ void Index::search_candidates(const uint8_t & field_id, bool field_is_array,
     }
 }
 
-void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
-                         const std::vector<filter>& filters,
-                         const bool enable_short_circuit) const {
-    //auto begin = std::chrono::high_resolution_clock::now();
-    for(size_t i = 0; i < filters.size(); i++) {
-        const filter & a_filter = filters[i];
+size_t Index::estimate_filter_num_ids(const filter& a_filter) const {
+    if(a_filter.field_name == "id") {
+        return a_filter.values.size();
+    }
 
-        if(a_filter.field_name == "id") {
-            // we handle `ids` separately
-            std::vector<uint32> result_ids;
-            for(const auto& id_str: a_filter.values) {
-                result_ids.push_back(std::stoul(id_str));
-            }
+    const size_t num_docs = seq_ids->num_ids();
+    const auto& field_it = search_schema.find(a_filter.field_name);
 
-            std::sort(result_ids.begin(), result_ids.end());
+    if(field_it == search_schema.end()) {
+        return num_docs;
+    }
+
+    const field& f = field_it->second;
+    size_t num_ids = 0;
+
+    if(f.is_integer() || f.is_float()) {
+        const num_tree_t* num_tree = numerical_index.at(a_filter.field_name);
+
+        for(size_t fi = 0; fi < a_filter.values.size(); fi++) {
+            const std::string& filter_value = a_filter.values[fi];
+            int64_t value = f.is_integer() ? (int64_t) std::stol(filter_value) :
+                            float_to_in64_t((float) std::atof(filter_value.c_str()));
 
-            if(i == 0) {
-                filter_ids = new uint32[result_ids.size()];
-                std::copy(result_ids.begin(), result_ids.end(), filter_ids);
-                filter_ids_length = result_ids.size();
+            if(a_filter.comparators[fi] == RANGE_INCLUSIVE && fi+1 < a_filter.values.size()) {
+                const std::string& next_filter_value = a_filter.values[fi+1];
+                int64_t range_end_value = f.is_integer() ? (int64_t) std::stol(next_filter_value) :
+                                          float_to_in64_t((float) std::atof(next_filter_value.c_str()));
+                num_ids += num_tree->approx_range_num_ids(value, range_end_value);
+                fi++;
             } else {
-                uint32_t* filtered_results = nullptr;
-                filter_ids_length = ArrayUtils::and_scalar(filter_ids, filter_ids_length, &result_ids[0],
-                                                           result_ids.size(), &filtered_results);
-                delete [] filter_ids;
-                filter_ids = filtered_results;
+                num_ids += num_tree->approx_num_ids(a_filter.comparators[fi], value);
             }
+        }
+    } else if(f.is_bool()) {
+        const num_tree_t* num_tree = numerical_index.at(a_filter.field_name);
 
-            continue;
+        for(size_t fi = 0; fi < a_filter.values.size(); fi++) {
+            const size_t value_num_ids = num_tree->approx_num_ids(EQUALS, (a_filter.values[fi] == "1") ? 1 : 0);
+            num_ids += (a_filter.comparators[fi] == NOT_EQUALS) ? (num_docs - std::min(num_docs, value_num_ids)) :
+                       value_num_ids;
         }
+    } else if(f.is_string()) {
+        const art_tree* t = search_index.at(a_filter.field_name);
+        const auto value_index_it = str_value_index.find(a_filter.field_name);
+        const bool use_value_index = value_index_it != str_value_index.end() &&
+                                     value_index_it->second->is_usable() && a_filter.comparators[0] == EQUALS;
 
-        bool has_search_index = search_index.count(a_filter.field_name) != 0 ||
-                                numerical_index.count(a_filter.field_name) != 0 ||
+        for(const std::string& filter_value: a_filter.values) {
+            if(use_value_index) {
+                num_ids += value_index_it->second->num_ids(string_facet_hash(f, filter_value, symbols_to_index,
+                                                                             token_separators));
+                continue;
+            }
+
+            // a value matches at most as many documents as its rarest token
+            Tokenizer tokenizer(filter_value, true, false, f.locale, symbols_to_index, token_separators);
+            std::string str_token;
+            size_t token_index = 0;
+            size_t value_num_ids = num_docs;
+
+            while(tokenizer.next(str_token, token_index)) {
+                art_leaf* leaf = (art_leaf *) art_search(t, (const unsigned char*) str_token.c_str(),
+                                                         str_token.length()+1);
+                value_num_ids = (leaf == nullptr) ? 0 : std::min<size_t>(value_num_ids, posting_t::num_ids(leaf->values));
+            }
+
+            num_ids += value_num_ids;
+        }
+    } else {
+        // the points of the field are ordered by cell, so those in the cells covering a region are counted with a
+        // couple of binary searches per cell
+        const geo_point_index_t* geo_index = geopoint_index.at(a_filter.field_name);
+
+        for(const std::string& filter_value: a_filter.values) {
+            std::vector<std::string> filter_value_parts;
+            StringUtils::split(filter_value, filter_value_parts, ",");
+
+            if(StringUtils::is_float(filter_value_parts.back())) {
+                geo_polygon_t polygon;
+                if(get_geo_polygon(a_filter.field_name, filter_value, filter_value_parts, polygon)) {
+                    num_ids += geo_index->num_points(*polygon.covering);
+                }
+            } else {
+                num_ids += geo_index->num_points(geo_point_index_t::get_covering(
+                        get_geo_filter_cap(filter_value_parts)));
+            }
+        }
+    }
+
+    return std::min(num_ids, num_docs);
+}
+
+S2Cap Index::get_geo_filter_cap(const std::vector<std::string>& filter_value_parts) {
+    double radius = std::stof(filter_value_parts[2]);
+    const auto& unit = filter_value_parts[3];
+
+    if(unit == "km") {
+        radius *= 1000;
+    } else {
+        // assume "mi" (validated upstream)
+        radius *= 1609.34;
+    }
+
+    S1Angle query_radius = S1Angle::Radians(S2Earth::MetersToRadians(radius));
+    double query_lat = std::stod(filter_value_parts[0]);
+    double query_lng = std::stod(filter_value_parts[1]);
+    S2Point center = S2LatLng::FromDegrees(query_lat, query_lng).ToPoint();
+    return S2Cap(center, query_radius);
+}
+
+bool Index::get_geo_polygon(const std::string& field_name, const std::string& filter_value,
+                            const std::vector<std::string>& filter_value_parts, geo_polygon_t& polygon) const {
+    const std::string polygon_key = field_name + '\0' + filter_value;
+
+    {
+        std::unique_lock lock(geo_polygon_cache_mutex);
+        auto polygon_it = geo_polygon_cache.find(polygon_key);
+        if(polygon_it != geo_polygon_cache.end()) {
+            polygon = polygon_it.value();
+            return true;
+        }
+    }
+
+    const int num_verts = int(filter_value_parts.size()) / 2;
+    std::vector<S2Point> vertices;
+
+    for(size_t point_index = 0; point_index < size_t(num_verts); point_index++) {
+        double lat = std::stod(filter_value_parts[point_index * 2]);
+        double lon = std::stod(filter_value_parts[point_index * 2 + 1]);
+        S2Point vertex = S2LatLng::FromDegrees(lat, lon).ToPoint();
+        vertices.emplace_back(vertex);
+    }
+
+    auto loop = new S2Loop(vertices, S2Debug::DISABLE);
+    loop->Normalize(); // if loop is not CCW but CW, change to CCW.
+
+    S2Error error;
+    if (loop->FindValidationError(&error)) {
+        LOG(ERROR) << "Query vertex is bad, skipping. Error: " << error;
+        delete loop;
+        return false;
+    }
+
+    polygon.loop = std::shared_ptr<const S2Loop>(loop);
+    polygon.covering = std::make_shared<const S2CellUnion>(geo_point_index_t::get_covering(*loop));
+
+    std::unique_lock lock(geo_polygon_cache_mutex);
+    geo_polygon_cache.insert(polygon_key, polygon);
+    return true;
+}
+
+void Index::collect_filter_ids(filter_iterator_t& filter_it, const size_t concurrency,
+                               uint32_t*& filter_ids, uint32_t& filter_ids_length) const {
+    const uint32_t first_id = filter_it.valid() ? filter_it.id() : 0;
+    const uint32_t last_id = seq_ids->last_id();
+
+    if(thread_pool == nullptr || concurrency <= 1 || !filter_it.valid() ||
+       filter_it.estimate_size() < PARALLEL_FILTER_MIN_IDS || last_id < first_id + concurrency) {
+        filter_ids_length = filter_it.to_ids(&filter_ids);
+        return ;
+    }
+
+    // ranges: [first_id, first_id + w - 1], [first_id + w, first_id + 2w - 1], ... [first_id + (c-1)w, UINT32_MAX]
+    const uint32_t range_width = (uint64_t(last_id) - first_id + concurrency) / concurrency;  // rounds up
+    std::vector<std::vector<uint32_t>> partial_filter_ids(concurrency);
+
+    size_t num_processed = 0;
+    std::mutex m_process;
+    std::condition_variable cv_process;
+
+    for(size_t r = 0; r < concurrency; r++) {
+        const uint32_t range_start = first_id + r * range_width;
+        const uint32_t range_end = (r + 1 == concurrency) ? UINT32_MAX : range_start + range_width - 1;
+
+        // clones share the leaves of `filter_it`, which outlives all of them
+        thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::SEARCH,
+                                  [range_it = filter_it.clone(), &partial_filter_ids, &num_processed, &m_process,
+                                   &cv_process, r, range_start, range_end]() mutable {
+            range_it.range_ids(range_start, range_end, partial_filter_ids[r]);
+
+            std::unique_lock<std::mutex> lock(m_process);
+            num_processed++;
+            cv_process.notify_one();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock_process(m_process);
+    cv_process.wait(lock_process, [&](){ return num_processed == concurrency; });
+
+    size_t num_filter_ids = 0;
+    for(const auto& partial_ids: partial_filter_ids) {
+        num_filter_ids += partial_ids.size();
+    }
+
+    filter_ids = (num_filter_ids == 0) ? nullptr : new uint32_t[num_filter_ids];
+    filter_ids_length = 0;
+
+    // the ranges are in ascending order, so concatenating them keeps the ids sorted
+    for(const auto& partial_ids: partial_filter_ids) {
+        std::copy(partial_ids.begin(), partial_ids.end(), filter_ids + filter_ids_length);
+        filter_ids_length += partial_ids.size();
+    }
+}
+
+void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
+                         const std::vector<filter>& filters,
+                         const bool enable_short_circuit, const size_t concurrency) const {
+    //auto begin = std::chrono::high_resolution_clock::now();
+    const uint64_t generation = write_generation;
+
+    // results of the clauses, ANDed lazily: only the final intersection is materialized into `filter_ids`
+    std::vector<filter_iterator_t> clause_its;
+
+    // exclusions are ANDed in as NOT nodes over the excluded ids, which need some other clause to draw ids from
+    size_t num_inclusive_clauses = 0;
+
+    auto materialize_clauses = [&]() {
+        if(num_inclusive_clauses == 0) {
+            // exclusions alone are drawn from all the documents
+            clause_its.push_back(filter_iterator_t::new_ids_iterator(seq_ids->uncompress(), seq_ids->num_ids(), true));
+        }
+
+        filter_iterator_t and_it = filter_iterator_t::new_and_iterator(std::move(clause_its));
+        clause_its.clear();
+        num_inclusive_clauses = 0;
+        collect_filter_ids(and_it, concurrency, filter_ids, filter_ids_length);
+    };
+
+    auto is_exclusion = [&](const filter& a_filter) {
+        if(search_schema.count(a_filter.field_name) == 0) {
+            return false;
+        }
+
+        const field& f = search_schema.at(a_filter.field_name);
+        return (f.is_string() || f.is_bool()) && a_filter.comparators[0] == NOT_EQUALS;
+    };
+
+    auto push_clause = [&](filter_iterator_t&& clause_it, bool exclusion) {
+        if(exclusion) {
+            clause_its.push_back(filter_iterator_t::new_not_iterator(std::move(clause_it), UINT32_MAX));
+        } else {
+            clause_its.push_back(std::move(clause_it));
+            num_inclusive_clauses++;
+        }
+    };
+
+    // the most selective clauses are evaluated first (exclusions last, since they only rule out the ids of the
+    // other clauses), so that an empty intermediate result is found as early as possible
+    std::vector<std::pair<size_t, size_t>> clause_order;
+    for(size_t i = 0; i < filters.size(); i++) {
+        const size_t num_ids = (filters.size() == 1) ? 0 :
+                               is_exclusion(filters[i]) ? SIZE_MAX : estimate_filter_num_ids(filters[i]);
+        clause_order.emplace_back(num_ids, i);
+    }
+
+    std::stable_sort(clause_order.begin(), clause_order.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    for(const auto& clause: clause_order) {
+        const filter & a_filter = filters[clause.second];
+
+        if(enable_short_circuit && !clause_its.empty() && !clause_its.back().valid()) {
+            // the intersection can only be empty
+            clause_its.clear();
+            break;
+        }
+
+        if(a_filter.field_name == "id") {
+            // we handle `ids` separately
+            std::vector<uint32> result_ids;
+            for(const auto& id_str: a_filter.values) {
+                result_ids.push_back(std::stoul(id_str));
+            }
+
+            std::sort(result_ids.begin(), result_ids.end());
+
+            uint32_t* ids = new uint32_t[result_ids.size()];
+            std::copy(result_ids.begin(), result_ids.end(), ids);
+            push_clause(filter_iterator_t::new_ids_iterator(ids, result_ids.size(), true), false);
+
+            continue;
+        }
+
+        bool has_search_index = search_index.count(a_filter.field_name) != 0 ||
+                                numerical_index.count(a_filter.field_name) != 0 ||
                                 geopoint_index.count(a_filter.field_name) != 0;
 
         if(!has_search_index) {
@@ -1504,6 +2236,46 @@ void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
 
         field f = search_schema.at(a_filter.field_name);
 
+        // an exclusion caches the ids it excludes, which are also what its NOT node is built over
+        const bool exclusion = is_exclusion(a_filter);
+        bool cacheable = true;
+        std::string cache_key;
+        std::shared_ptr<const id_bitmap_t> cached_ids;
+
+        if(cacheable) {
+            cache_key = a_filter.field_name + '\0';
+            for(const auto& comparator: a_filter.comparators) {
+                cache_key += std::to_string(comparator) + ',';
+            }
+
+            for(const auto& value: a_filter.values) {
+                cache_key += '\0' + value;
+            }
+
+            std::unique_lock lock(filter_result_cache_mutex);
+            auto hit_it = filter_result_cache.find(cache_key);
+            if(hit_it != filter_result_cache.end() && hit_it.value().write_generation == generation) {
+                cached_ids = hit_it.value().ids;
+            }
+        }
+
+        if(cached_ids != nullptr) {
+            push_clause(filter_iterator_t::new_bitmap_iterator(cached_ids), exclusion);
+            continue;
+        }
+
+        if(!clause_its.empty() && f.is_geopoint()) {
+            // a geo filter only has to check the points of the preceding results exactly, so they are needed
+            // right away
+            materialize_clauses();
+            if(filter_ids_length == 0) {
+                break;
+            }
+
+            // results limited to the preceding results can't be reused by other filters
+            cacheable = false;
+        }
+
         uint32_t* result_ids = nullptr;
         size_t result_ids_len = 0;
 
@@ -1549,28 +2321,23 @@ void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
             for(const std::string & filter_value: a_filter.values) {
                 int64_t bool_int64 = (filter_value == "1") ? 1 : 0;
                 if(a_filter.comparators[value_index] == NOT_EQUALS) {
-                    uint32_t* to_exclude_ids = nullptr;
-                    size_t to_exclude_ids_len = 0;
-                    num_tree->search(EQUALS, bool_int64, &to_exclude_ids, to_exclude_ids_len);
-
-                    auto all_ids = seq_ids->uncompress();
-                    auto all_ids_size = seq_ids->num_ids();
-
-                    uint32_t* excluded_ids = nullptr;
-                    size_t excluded_ids_len = 0;
-
-                    excluded_ids_len = ArrayUtils::exclude_scalar(all_ids, all_ids_size, to_exclude_ids,
-                                                                  to_exclude_ids_len, &excluded_ids);
-
-                    delete [] all_ids;
-                    delete [] to_exclude_ids;
-
-                    uint32_t *out = nullptr;
-                    result_ids_len = ArrayUtils::or_scalar(result_ids, result_ids_len,
-                                                           excluded_ids, excluded_ids_len, &out);
-                    delete [] result_ids;
-                    result_ids = out;
-                    delete [] excluded_ids;
+                    // the union of the values' complements is the complement of their intersection, so only the
+                    // documents holding every one of the values are excluded
+                    uint32_t* value_ids = nullptr;
+                    size_t value_ids_len = 0;
+                    num_tree->search(EQUALS, bool_int64, &value_ids, value_ids_len);
+
+                    if(value_index == 0) {
+                        result_ids = value_ids;
+                        result_ids_len = value_ids_len;
+                    } else {
+                        uint32_t *out = nullptr;
+                        result_ids_len = ArrayUtils::and_scalar(result_ids, result_ids_len,
+                                                                value_ids, value_ids_len, &out);
+                        delete [] result_ids;
+                        delete [] value_ids;
+                        result_ids = out;
+                    }
                 } else {
                     num_tree->search(a_filter.comparators[value_index], bool_int64, &result_ids, result_ids_len);
                 }
@@ -1579,93 +2346,35 @@ void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
             }
 
         } else if(f.is_geopoint()) {
-            for(const std::string& filter_value: a_filter.values) {
-                std::vector<uint32_t> geo_result_ids;
-
-                std::vector<std::string> filter_value_parts;
-                StringUtils::split(filter_value, filter_value_parts, ",");  // x, y, 2, km (or) list of points
-
-                bool is_polygon = StringUtils::is_float(filter_value_parts.back());
-                S2Region* query_region;
-
-                if(is_polygon) {
-                    const int num_verts = int(filter_value_parts.size()) / 2;
-                    std::vector<S2Point> vertices;
-                    double sum = 0.0;
-
-                    for(size_t point_index = 0; point_index < size_t(num_verts); point_index++) {
-                        double lat = std::stod(filter_value_parts[point_index * 2]);
-                        double lon = std::stod(filter_value_parts[point_index * 2 + 1]);
-                        S2Point vertex = S2LatLng::FromDegrees(lat, lon).ToPoint();
-                        vertices.emplace_back(vertex);
-                    }
-
-                    auto loop = new S2Loop(vertices, S2Debug::DISABLE);
-                    loop->Normalize(); // if loop is not CCW but CW, change to CCW.
-
-                    S2Error error;
-                    if (loop->FindValidationError(&error)) {
-                        LOG(ERROR) << "Query vertex is bad, skipping. Error: " << error;
-                        delete loop;
-                        continue;
-                    } else {
-                        query_region = loop;
-                    }
-                } else {
-                    double radius = std::stof(filter_value_parts[2]);
-                    const auto& unit = filter_value_parts[3];
-
-                    if(unit == "km") {
-                        radius *= 1000;
-                    } else {
-                        // assume "mi" (validated upstream)
-                        radius *= 1609.34;
-                    }
-
-                    S1Angle query_radius = S1Angle::Radians(S2Earth::MetersToRadians(radius));
-                    double query_lat = std::stod(filter_value_parts[0]);
-                    double query_lng = std::stod(filter_value_parts[1]);
-                    S2Point center = S2LatLng::FromDegrees(query_lat, query_lng).ToPoint();
-                    query_region = new S2Cap(center, query_radius);
-                }
-
-                S2RegionTermIndexer::Options options;
-                options.set_index_contains_points_only(true);
-                S2RegionTermIndexer indexer(options);
-
-                for (const auto& term : indexer.GetQueryTerms(*query_region, "")) {
-                    auto geo_index = geopoint_index.at(a_filter.field_name);
-                    const auto& ids_it = geo_index->find(term);
-                    if(ids_it != geo_index->end()) {
-                        geo_result_ids.insert(geo_result_ids.end(), ids_it->second.begin(), ids_it->second.end());
-                    }
-                }
+            const geo_point_index_t* geo_index = geopoint_index.at(a_filter.field_name);
 
-                gfx::timsort(geo_result_ids.begin(), geo_result_ids.end());
-                geo_result_ids.erase(std::unique( geo_result_ids.begin(), geo_result_ids.end() ), geo_result_ids.end());
-
-                // `geo_result_ids` will contain all IDs that are within approximately within query radius
-                // we still need to do another round of exact filtering on them
-
-                std::vector<uint32_t> exact_geo_result_ids;
+            // ids among sorted `candidate_ids` having a point inside `query_region`
+            auto get_exact_ids = [&](const S2Region& query_region, const std::vector<uint32_t>& candidate_ids,
+                                     std::vector<uint32_t>& exact_geo_result_ids) {
+                // a point outside the lat/lng bounds of the region is rejected without converting it to an S2Point
+                // (which needs a sin and cos per coordinate) and testing the region itself
+                const S2LatLngRect query_rect = query_region.GetRectBound();
 
                 if(f.is_single_geopoint()) {
-                    spp::sparse_hash_map<uint32_t, int64_t>* sort_field_index = sort_index.at(f.name);
+                    sort_column_t* sort_field_index = sort_index.at(f.name);
 
-                    for(auto result_id: geo_result_ids) {
+                    for(auto result_id: candidate_ids) {
                         // no need to check for existence of `result_id` because of indexer based pre-filtering above
                         int64_t lat_lng = sort_field_index->at(result_id);
                         S2LatLng s2_lat_lng;
                         GeoPoint::unpack_lat_lng(lat_lng, s2_lat_lng);
-                        if (query_region->Contains(s2_lat_lng.ToPoint())) {
+                        if (query_rect.Contains(s2_lat_lng) && query_region.Contains(s2_lat_lng.ToPoint())) {
                             exact_geo_result_ids.push_back(result_id);
                         }
                     }
                 } else {
-                    spp::sparse_hash_map<uint32_t, int64_t*>* geo_field_index = geo_array_index.at(f.name);
+                    geo_points_column_t* geo_points_column = geo_array_index.at(f.name);
 
-                    for(auto result_id: geo_result_ids) {
-                        int64_t* lat_lngs = geo_field_index->at(result_id);
+                    for(auto result_id: candidate_ids) {
+                        const int64_t* lat_lngs = geo_points_column->get(result_id);
+                        if(lat_lngs == nullptr) {
+                            continue;
+                        }
 
                         bool point_found = false;
 
@@ -1674,7 +2383,7 @@ void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
                             int64_t lat_lng = lat_lngs[li + 1];
                             S2LatLng s2_lat_lng;
                             GeoPoint::unpack_lat_lng(lat_lng, s2_lat_lng);
-                            if (query_region->Contains(s2_lat_lng.ToPoint())) {
+                            if (query_rect.Contains(s2_lat_lng) && query_region.Contains(s2_lat_lng.ToPoint())) {
                                 point_found = true;
                                 break;
                             }
@@ -1685,6 +2394,79 @@ void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
                         }
                     }
                 }
+            };
+
+            for(const std::string& filter_value: a_filter.values) {
+                std::vector<uint32_t> geo_result_ids;
+
+                std::vector<std::string> filter_value_parts;
+                StringUtils::split(filter_value, filter_value_parts, ",");  // x, y, 2, km (or) list of points
+
+                bool is_polygon = StringUtils::is_float(filter_value_parts.back());
+                std::vector<uint32_t> exact_geo_result_ids;
+
+                if(is_polygon) {
+                    // the same few polygons (e.g. delivery zones) are filtered on over and over, so their loops,
+                    // coverings and, while the points of the field stay the same, matching ids are kept around
+                    geo_polygon_t polygon;
+                    if(!get_geo_polygon(a_filter.field_name, filter_value, filter_value_parts, polygon)) {
+                        continue;
+                    }
+
+                    if(polygon.ids == nullptr || polygon.version != geo_index->get_version()) {
+                        geo_index->region_ids(*polygon.covering, geo_result_ids);
+
+                        if(filter_ids != nullptr && geo_result_ids.size() > size_t(filter_ids_length) *
+                                                                            GEO_POLYGON_MAX_CANDIDATES_RATIO) {
+                            // checking all the points of the polygon would cost far more than checking those of the
+                            // preceding results, so only the latter are checked and no ids are cached
+                            uint32_t* candidate_ids = nullptr;
+                            size_t num_candidate_ids = ArrayUtils::and_scalar(geo_result_ids.data(),
+                                                                              geo_result_ids.size(),
+                                                                              filter_ids, filter_ids_length,
+                                                                              &candidate_ids);
+                            geo_result_ids.assign(candidate_ids, candidate_ids + num_candidate_ids);
+                            delete [] candidate_ids;
+                        } else {
+                            std::vector<uint32_t> polygon_ids;
+                            get_exact_ids(*polygon.loop, geo_result_ids, polygon_ids);
+                            geo_result_ids.clear();
+
+                            polygon.version = geo_index->get_version();
+                            polygon.ids = std::make_shared<const id_bitmap_t>(polygon_ids.data(), polygon_ids.size());
+                        }
+
+                        std::unique_lock lock(geo_polygon_cache_mutex);
+                        geo_polygon_cache.insert(a_filter.field_name + '\0' + filter_value, polygon);
+                    }
+
+                    if(polygon.ids != nullptr && polygon.version == geo_index->get_version()) {
+                        uint32_t* polygon_ids = nullptr;
+                        size_t num_polygon_ids = (filter_ids != nullptr) ?
+                                                 polygon.ids->and_ids(filter_ids, filter_ids_length, &polygon_ids) :
+                                                 polygon.ids->to_ids(&polygon_ids);
+                        exact_geo_result_ids.assign(polygon_ids, polygon_ids + num_polygon_ids);
+                        delete [] polygon_ids;
+                    } else {
+                        get_exact_ids(*polygon.loop, geo_result_ids, exact_geo_result_ids);
+                    }
+                } else {
+                    const S2Cap query_region = get_geo_filter_cap(filter_value_parts);
+
+                    geo_index->region_ids(query_region, geo_result_ids);
+
+                    if(filter_ids != nullptr) {
+                        uint32_t* candidate_ids = nullptr;
+                        size_t num_candidate_ids = ArrayUtils::and_scalar(geo_result_ids.data(), geo_result_ids.size(),
+                                                                          filter_ids, filter_ids_length, &candidate_ids);
+                        geo_result_ids.assign(candidate_ids, candidate_ids + num_candidate_ids);
+                        delete [] candidate_ids;
+                    }
+
+                    // `geo_result_ids` will contain all IDs that are within approximately within query radius
+                    // we still need to do another round of exact filtering on them
+                    get_exact_ids(query_region, geo_result_ids, exact_geo_result_ids);
+                }
 
                 uint32_t *out = nullptr;
                 result_ids_len = ArrayUtils::or_scalar(&exact_geo_result_ids[0], exact_geo_result_ids.size(),
@@ -1692,8 +2474,6 @@ void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
 
                 delete [] result_ids;
                 result_ids = out;
-
-                delete query_region;
             }
 
         } else if(f.is_string()) {
@@ -1706,108 +2486,100 @@ void Index::do_filtering(uint32_t*& filter_ids, uint32_t& filter_ids_length,
                 uint32_t* strt_ids = nullptr;
                 size_t strt_ids_size = 0;
 
-                std::vector<void*> posting_lists;
+                const bool is_exact_match = (a_filter.comparators[0] == EQUALS ||
+                                             a_filter.comparators[0] == NOT_EQUALS);
+                const auto value_index_it = str_value_index.find(a_filter.field_name);
 
-                // there could be multiple tokens in a filter value, which we have to treat as ANDs
-                // e.g. country: South Africa
+                if(is_exact_match && value_index_it != str_value_index.end() && value_index_it->second->is_usable()) {
+                    // the whole value is looked up, so there are no token offsets to check
+                    const uint64_t value_hash = string_facet_hash(f, filter_value, symbols_to_index, token_separators);
+                    value_index_it->second->search({value_hash}, &strt_ids, strt_ids_size);
+                } else {
+                    std::vector<void*> posting_lists;
 
-                Tokenizer tokenizer(filter_value, true, false, f.locale, symbols_to_index, token_separators);
+                    // there could be multiple tokens in a filter value, which we have to treat as ANDs
+                    // e.g. country: South Africa
 
-                std::string str_token;
-                size_t token_index = 0;
-                std::vector<std::string> str_tokens;
+                    Tokenizer tokenizer(filter_value, true, false, f.locale, symbols_to_index, token_separators);
 
-                while(tokenizer.next(str_token, token_index)) {
-                    str_tokens.push_back(str_token);
+                    std::string str_token;
+                    size_t token_index = 0;
+                    std::vector<std::string> str_tokens;
 
-                    art_leaf* leaf = (art_leaf *) art_search(t, (const unsigned char*) str_token.c_str(),
-                                                             str_token.length()+1);
-                    if(leaf == nullptr) {
-                        continue;
-                    }
+                    while(tokenizer.next(str_token, token_index)) {
+                        str_tokens.push_back(str_token);
 
-                    posting_lists.push_back(leaf->values);
-                }
-
-                // For NOT_EQUALS alone, it is okay for none of the results to match prior to negation
-                // e.g. field:!= [RANDOM_NON_EXISTING_STRING]
-                if(a_filter.comparators[0] != NOT_EQUALS && posting_lists.size() != str_tokens.size()) {
-                    continue;
-                }
-
-                std::vector<uint32_t> result_id_vec;
-                posting_t::intersect(posting_lists, result_id_vec);
-                if(!result_id_vec.empty()) {
-                    strt_ids = new uint32_t [result_id_vec.size()];
-                    std::copy(result_id_vec.begin(), result_id_vec.end(), strt_ids);
-                    strt_ids_size = result_id_vec.size();
-                }
+                        art_leaf* leaf = (art_leaf *) art_search(t, (const unsigned char*) str_token.c_str(),
+                                                                 str_token.length()+1);
+                        if(leaf == nullptr) {
+                            continue;
+                        }
 
-                if(a_filter.comparators[0] == EQUALS || a_filter.comparators[0] == NOT_EQUALS) {
-                    // need to do exact match (unlike CONTAINS)
-                    uint32_t* exact_strt_ids = new uint32_t[strt_ids_size];
-                    size_t exact_strt_size = 0;
+                        posting_lists.push_back(leaf->values);
+                    }
 
-                    posting_t::get_exact_matches(posting_lists, f.is_array(), strt_ids, strt_ids_size,
-                                                 exact_strt_ids, exact_strt_size);
+                    // a value with a token that is not indexed matches nothing (and so excludes nothing either)
+                    if(posting_lists.size() != str_tokens.size()) {
+                        continue;
+                    }
 
-                    delete[] strt_ids;
-                    strt_ids = exact_strt_ids;
-                    strt_ids_size = exact_strt_size;
-                }
+                    std::vector<uint32_t> result_id_vec;
+                    posting_t::intersect(posting_lists, result_id_vec);
+                    if(!result_id_vec.empty()) {
+                        strt_ids = new uint32_t [result_id_vec.size()];
+                        std::copy(result_id_vec.begin(), result_id_vec.end(), strt_ids);
+                        strt_ids_size = result_id_vec.size();
+                    }
 
-                if(a_filter.comparators[0] == NOT_EQUALS) {
-                    // exclude records from existing IDs (from previous filters or ALL records)
-                    // upstream will guarantee that NOT_EQUALS is placed right at the end of filters list
-                    uint32_t* excluded_strt_ids = nullptr;
-                    size_t excluded_strt_size = 0;
+                    if(a_filter.comparators[0] == EQUALS || a_filter.comparators[0] == NOT_EQUALS) {
+                        // need to do exact match (unlike CONTAINS)
+                        filter_by_token_count(get_token_counts(f.name), posting_lists.size(), strt_ids, strt_ids_size);
 
-                    if(ids == nullptr) {
-                        if(filter_ids == nullptr) {
-                            ids = seq_ids->uncompress();
-                            ids_size = seq_ids->num_ids();
-                        } else {
-                            ids = filter_ids;
-                            ids_size = filter_ids_length;
-                        }
-                    }
+                        uint32_t* exact_strt_ids = new uint32_t[strt_ids_size];
+                        size_t exact_strt_size = 0;
 
-                    excluded_strt_size = ArrayUtils::exclude_scalar(ids, ids_size, strt_ids,
-                                                                    strt_ids_size, &excluded_strt_ids);
+                        posting_t::get_exact_matches(posting_lists, f.is_array(), strt_ids, strt_ids_size,
+                                                     exact_strt_ids, exact_strt_size);
 
-                    if(filter_ids == nullptr) {
-                        // means we had to uncompress `seq_ids` so need to free that
-                        delete [] ids;
+                        delete[] strt_ids;
+                        strt_ids = exact_strt_ids;
+                        strt_ids_size = exact_strt_size;
                     }
-
-                    ids = excluded_strt_ids;
-                    ids_size = excluded_strt_size;
-                    delete[] strt_ids;
-                } else {
-                    // Otherwise, we just ensure that given record contains tokens in the filter query
-                    uint32_t* out = nullptr;
-                    ids_size = ArrayUtils::or_scalar(ids, ids_size, strt_ids, strt_ids_size, &out);
-                    delete[] strt_ids;
-                    delete[] ids;
-                    ids = out;
                 }
+
+                // a record matches (or, for NOT_EQUALS, is excluded) when it matches any of the values
+                uint32_t* out = nullptr;
+                ids_size = ArrayUtils::or_scalar(ids, ids_size, strt_ids, strt_ids_size, &out);
+                delete[] strt_ids;
+                delete[] ids;
+                ids = out;
             }
 
             result_ids = ids;
             result_ids_len = ids_size;
         }
 
-        if(i == 0) {
-            filter_ids = result_ids;
-            filter_ids_length = result_ids_len;
-        } else {
-            uint32_t* filtered_results = nullptr;
-            filter_ids_length = ArrayUtils::and_scalar(filter_ids, filter_ids_length, result_ids,
-                                                       result_ids_len, &filtered_results);
-            delete [] result_ids;
+        if(cacheable) {
+            filter_result_t filter_result;
+            filter_result.write_generation = generation;
+            filter_result.ids = std::make_shared<const id_bitmap_t>(result_ids, result_ids_len);
+
+            std::unique_lock lock(filter_result_cache_mutex);
+            filter_result_cache.insert(cache_key, filter_result);
+        }
+
+        if(filter_ids != nullptr) {
+            // a geo filter's results are drawn from the preceding results, so they replace them
             delete [] filter_ids;
-            filter_ids = filtered_results;
+            filter_ids = nullptr;
+            filter_ids_length = 0;
         }
+
+        push_clause(filter_iterator_t::new_ids_iterator(result_ids, result_ids_len, true), exclusion);
+    }
+
+    if(!clause_its.empty()) {
+        materialize_clauses();
     }
 
     if(filter_ids_length == 0) {
@@ -1829,6 +2601,9 @@ void Index::do_filtering_with_lock(uint32_t*& filter_ids, uint32_t& filter_ids_l
 }
 
 void Index::run_search(search_args* search_params) {
+    search_arena = &search_params->arena;
+    search_num_pruned_ids = 0;
+
     search(search_params->field_query_tokens,
            search_params->search_fields,
            search_params->filters, search_params->facets, search_params->facet_query,
@@ -1857,7 +2632,15 @@ void Index::run_search(search_args* search_params) {
            search_params->max_extra_suffix,
            search_params->facet_query_num_typos,
            search_params->filter_curated_hits,
-           search_params->split_join_tokens);
+           search_params->split_join_tokens,
+           search_params->enable_top_k_pruning,
+           search_params->explain ? &search_params->query_plan : nullptr,
+           search_params->facet_sample_percent,
+           search_params->facet_sample_threshold,
+           search_params->vector_query);
+
+    search_params->num_pruned_ids = search_num_pruned_ids;
+    search_arena = nullptr;
 }
 
 void Index::collate_included_ids(const std::vector<token_t>& q_included_tokens,
@@ -1895,17 +2678,18 @@ void Index::collate_included_ids(const std::vector<token_t>& q_included_tokens,
 
 void Index::concat_topster_ids(Topster* topster, spp::sparse_hash_map<uint64_t, std::vector<KV*>>& topster_ids) {
     if(topster->distinct) {
-        for(auto &group_topster_entry: topster->group_kv_map) {
-            Topster* group_topster = group_topster_entry.second;
-            for(const auto& map_kv: group_topster->kv_map) {
-                topster_ids[map_kv.first].push_back(map_kv.second);
+        group_topster_t& groups = topster->groups;
+        for(size_t group_index = 0; group_index < groups.num_groups(); group_index++) {
+            KV* group_kvs = groups.get_group_kvs(group_index);
+            for(uint32_t i = 0; i < groups.get_group_size(group_index); i++) {
+                topster_ids[group_kvs[i].key].push_back(&group_kvs[i]);
             }
         }
     } else {
-        for(const auto& map_kv: topster->kv_map) {
-            //LOG(INFO) << "map_kv.second.key: " << map_kv.second->key;
-            //LOG(INFO) << "map_kv.first: " << map_kv.first;
-            topster_ids[map_kv.first].push_back(map_kv.second);
+        topster->flush();
+        for(uint32_t i = 0; i < topster->size; i++) {
+            KV* kv = topster->getKV(i);
+            topster_ids[kv->key].push_back(kv);
         }
     }
 }
@@ -2049,27 +2833,14 @@ void Index::process_filter_overrides(const std::vector<const override_t*>& filte
             // need to extract placeholder field names from the search query, filter on them and rewrite query
             // we will cover both original query and synonyms
 
-            std::vector<std::string> rule_parts;
-            StringUtils::split(override->rule.query, rule_parts, " ");
-
-            uint32_t* field_override_ids = nullptr;
-            size_t field_override_ids_len = 0;
+            const override_resolution_t resolution = resolve_dynamic_override(override, query_tokens, token_order);
 
-            bool exact_rule_match = override->rule.match == override_t::MATCH_EXACT;
-            std::string filter_by_clause = override->filter_by;
+            if(resolution.resolved) {
+                filters.insert(filters.end(), resolution.filters.begin(), resolution.filters.end());
 
-            std::set<std::string> absorbed_tokens;
-            bool resolved_override = resolve_override(rule_parts, exact_rule_match, query_tokens,
-                                                      token_order, absorbed_tokens, filter_by_clause);
-
-            if(resolved_override) {
-                Option<bool> filter_parse_op = filter::parse_filter_query(filter_by_clause, search_schema, store, "",
-                                                                          filters);
-                if(filter_parse_op.ok()) {
-                    if(override->remove_matched_tokens) {
-                        std::vector<std::string>& tokens = query_tokens;
-                        remove_matched_tokens(tokens, absorbed_tokens);
-                    }
+                if(resolution.filters_parsed && override->remove_matched_tokens) {
+                    std::vector<std::string>& tokens = query_tokens;
+                    remove_matched_tokens(tokens, resolution.absorbed_tokens);
                 }
 
                 return ;
@@ -2078,6 +2849,52 @@ void Index::process_filter_overrides(const std::vector<const override_t*>& filte
     }
 }
 
+override_resolution_t Index::resolve_dynamic_override(const override_t* override,
+                                                      const std::vector<std::string>& query_tokens,
+                                                      token_ordering token_order) const {
+    const uint64_t generation = write_generation;
+
+    // the rule is part of the key, since an override that is upserted again keeps its id
+    std::string cache_key = override->id + '\0' + override->rule.query + '\0' + override->rule.match + '\0' +
+                            override->filter_by + '\0' + std::to_string(token_order);
+    for(const auto& token: query_tokens) {
+        cache_key += '\0' + token;
+    }
+
+    {
+        std::unique_lock lock(override_resolution_cache_mutex);
+        auto hit_it = override_resolution_cache.find(cache_key);
+        if(hit_it != override_resolution_cache.end() && hit_it.value().write_generation == generation) {
+            return hit_it.value();
+        }
+    }
+
+    std::vector<std::string> rule_parts;
+    StringUtils::split(override->rule.query, rule_parts, " ");
+
+    bool exact_rule_match = override->rule.match == override_t::MATCH_EXACT;
+    std::string filter_by_clause = override->filter_by;
+
+    override_resolution_t resolution;
+    resolution.write_generation = generation;
+
+    std::set<std::string> absorbed_tokens;
+    resolution.resolved = resolve_override(rule_parts, exact_rule_match, query_tokens, token_order, absorbed_tokens,
+                                           filter_by_clause);
+
+    if(resolution.resolved) {
+        Option<bool> filter_parse_op = filter::parse_filter_query(filter_by_clause, search_schema, store, "",
+                                                                  resolution.filters);
+        resolution.filters_parsed = filter_parse_op.ok();
+        resolution.absorbed_tokens = std::move(absorbed_tokens);
+    }
+
+    std::unique_lock lock(override_resolution_cache_mutex);
+    override_resolution_cache.insert(cache_key, resolution);
+
+    return resolution;
+}
+
 void Index::remove_matched_tokens(std::vector<std::string>& tokens, const std::set<std::string>& rule_token_set) {
     std::vector<std::string> new_tokens;
 
@@ -2112,7 +2929,7 @@ bool Index::check_for_overrides(const token_ordering& token_order, const string&
             std::vector<facet> facets;
             std::vector<std::vector<art_leaf*>> searched_queries;
             Topster* topster = nullptr;
-            spp::sparse_hash_set<uint64_t> groups_processed;
+            group_counter_t groups_processed;
             uint32_t* result_ids = nullptr;
             size_t result_ids_len = 0;
             size_t field_num_results = 0;
@@ -2146,14 +2963,18 @@ bool Index::check_for_overrides(const token_ordering& token_order, const string&
                     posting_lists.push_back(leaf->values);
                 }
 
-                uint32_t* exact_strt_ids = new uint32_t[result_ids_len];
+                if(posting_lists.size() == window_tokens.size()) {
+                    filter_by_token_count(get_token_counts(field_name), posting_lists.size(), result_ids,
+                                          result_ids_len);
+                }
+
+                search_scratch_t<uint32_t> exact_strt_ids(result_ids_len);
                 size_t exact_strt_size = 0;
 
                 posting_t::get_exact_matches(posting_lists, field_it->second.is_array(), result_ids, result_ids_len,
-                                             exact_strt_ids, exact_strt_size);
+                                             exact_strt_ids.data, exact_strt_size);
 
                 delete [] result_ids;
-                delete [] exact_strt_ids;
 
                 if(exact_strt_size != 0) {
                     // remove window_tokens from `tokens`
@@ -2185,78 +3006,27 @@ bool Index::check_for_overrides(const token_ordering& token_order, const string&
 void Index::search_infix(const std::string& query, const std::string& field_name,
                          std::vector<uint32_t>& ids, const size_t max_extra_prefix, const size_t max_extra_suffix) const {
 
-    auto infix_maps_it = infix_index.find(field_name);
+    auto infix_index_it = infix_index.find(field_name);
 
-    if(infix_maps_it == infix_index.end()) {
+    if(infix_index_it == infix_index.end()) {
         return ;
     }
 
-    auto infix_sets = infix_maps_it->second;
-    std::vector<art_leaf*> leaves;
-
-    size_t num_processed = 0;
-    std::mutex m_process;
-    std::condition_variable cv_process;
+    std::vector<std::string> tokens;
+    infix_index_it->second->search(query, max_extra_prefix, max_extra_suffix, tokens);
 
     auto search_tree = search_index.at(field_name);
+    std::vector<void*> leaf_values;
+    leaf_values.reserve(tokens.size());
 
-    const auto parent_search_begin = search_begin;
-    const auto parent_search_stop_ms = search_stop_ms;
-    auto parent_search_cutoff = search_cutoff;
-
-    for(auto infix_set: infix_sets) {
-        thread_pool->enqueue([infix_set, &leaves, search_tree, &query, max_extra_prefix, max_extra_suffix,
-                              &num_processed, &m_process, &cv_process,
-                              &parent_search_begin, &parent_search_stop_ms, &parent_search_cutoff]() {
-
-            search_begin = parent_search_begin;
-            search_cutoff = parent_search_cutoff;
-            auto op_search_stop_ms = parent_search_stop_ms/2;
-
-            std::vector<art_leaf*> this_leaves;
-            std::string key_buffer;
-            size_t num_iterated = 0;
-
-            for(auto it = infix_set->begin(); it != infix_set->end(); it++) {
-                it.key(key_buffer);
-                num_iterated++;
-
-                auto start_index = key_buffer.find(query);
-                if(start_index != std::string::npos && start_index <= max_extra_prefix &&
-                   (key_buffer.size() - (start_index + query.size())) <= max_extra_suffix) {
-                    art_leaf* l = (art_leaf *) art_search(search_tree,
-                                                          (const unsigned char *) key_buffer.c_str(),
-                                                          key_buffer.size()+1);
-                    if(l != nullptr) {
-                        this_leaves.push_back(l);
-                    }
-                }
-
-                // check for search cutoff but only once every 2^10 docs to reduce overhead
-                if(((num_iterated + 1) % (1 << 12)) == 0) {
-                    if (std::chrono::duration_cast<std::chrono::milliseconds>(
-                            std::chrono::high_resolution_clock::now() - search_begin).count() > op_search_stop_ms) {
-                        search_cutoff = true;
-                        break;
-                    }
-                }
-            }
-
-            std::unique_lock<std::mutex> lock(m_process);
-            leaves.insert(leaves.end(), this_leaves.begin(), this_leaves.end());
-            num_processed++;
-            parent_search_cutoff = parent_search_cutoff || search_cutoff;
-            cv_process.notify_one();
-        });
+    for(const auto& token: tokens) {
+        art_leaf* l = (art_leaf *) art_search(search_tree, (const unsigned char *) token.c_str(), token.size()+1);
+        if(l != nullptr) {
+            leaf_values.push_back(l->values);
+        }
     }
 
-    std::unique_lock<std::mutex> lock_process(m_process);
-    cv_process.wait(lock_process, [&](){ return num_processed == infix_sets.size(); });
-    search_cutoff = parent_search_cutoff;
-
-    for(auto leaf: leaves) {
-        posting_t::merge({leaf->values}, ids);
-    }
+    posting_t::merge(leaf_values, ids, thread_pool);
 }
 
 void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::vector<search_field_t>& the_fields,
@@ -2267,7 +3037,7 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
                    const size_t per_page,
                    const size_t page, const token_ordering token_order, const std::vector<bool>& prefixes,
                    const size_t drop_tokens_threshold, size_t& all_result_ids_len,
-                   spp::sparse_hash_set<uint64_t>& groups_processed,
+                   group_counter_t& groups_processed,
                    std::vector<std::vector<art_leaf*>>& searched_queries,
                    tsl::htrie_map<char, token_leaf>& qtoken_set,
                    std::vector<std::vector<KV*>>& raw_result_kvs, std::vector<std::vector<KV*>>& override_result_kvs,
@@ -2278,7 +3048,11 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
                    size_t concurrency, size_t search_cutoff_ms, size_t min_len_1typo, size_t min_len_2typo,
                    size_t max_candidates, const std::vector<enable_t>& infixes, const size_t max_extra_prefix,
                    const size_t max_extra_suffix, const size_t facet_query_num_typos,
-                   const bool filter_curated_hits, const enable_t split_join_tokens) const {
+                   const bool filter_curated_hits, const enable_t split_join_tokens,
+                   const bool enable_top_k_pruning,
+                   query_plan_t* query_plan,
+                   const size_t facet_sample_percent, const size_t facet_sample_threshold,
+                   const vector_query_t& vector_query) const {
 
     // process the filters
 
@@ -2287,7 +3061,10 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
 
     std::shared_lock lock(mutex);
 
-    do_filtering(filter_ids, filter_ids_length, filters, true);
+    {
+        search_stage_timer_t filter_timer(search_profile_t::FILTER);
+        do_filtering(filter_ids, filter_ids_length, filters, true, concurrency);
+    }
 
     if(!filters.empty() && filter_ids_length == 0) {
         return ;
@@ -2322,7 +3099,7 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
     handle_exclusion(num_search_fields, field_query_tokens, the_fields, exclude_token_ids, exclude_token_ids_size);
 
     int sort_order[3]; // 1 or -1 based on DESC or ASC respectively
-    std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3> field_values;
+    std::array<sort_column_t*, 3> field_values;
     std::vector<size_t> geopoint_indices;
     populate_sort_mapping(sort_order, geopoint_indices, sort_fields_std, field_values);
 
@@ -2340,15 +3117,26 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
         const uint8_t field_id = (uint8_t)(FIELD_LIMIT_NUM - 0);
         const std::string& field = the_fields[0].name;
 
-        curate_filtered_ids(filters, curated_ids, excluded_result_ids,
-                            excluded_result_ids_size, filter_ids, filter_ids_length, curated_ids_sorted);
+        if(!vector_query.field_name.empty()) {
+            // the nearest vectors are the candidates, so all the ids need not be listed
+            std::vector<std::pair<float, uint32_t>> dist_ids;
+            search_vector(vector_query, filter_ids, filter_ids_length, !filters.empty() || filter_ids_length != 0,
+                          excluded_result_ids, excluded_result_ids_size, dist_ids);
 
-        search_wildcard(filters, included_ids_map, sort_fields_std, topster,
-                        curated_topster, groups_processed, searched_queries, group_limit, group_by_fields,
-                        curated_ids, curated_ids_sorted,
-                        excluded_result_ids, excluded_result_ids_size, field_id, field,
-                        all_result_ids, all_result_ids_len, filter_ids, filter_ids_length, concurrency,
-                        sort_order, field_values, geopoint_indices);
+            add_vector_hits(vector_query, dist_ids, false, sort_fields_std, sort_order, field_values,
+                            geopoint_indices, topster, searched_queries, all_result_ids, all_result_ids_len);
+            collate_included_ids({}, included_ids_map, curated_topster, searched_queries);
+        } else {
+            curate_filtered_ids(filters, curated_ids, excluded_result_ids,
+                                excluded_result_ids_size, filter_ids, filter_ids_length, curated_ids_sorted);
+
+            search_wildcard(filters, included_ids_map, sort_fields_std, topster,
+                            curated_topster, groups_processed, searched_queries, group_limit, group_by_fields,
+                            curated_ids, curated_ids_sorted,
+                            excluded_result_ids, excluded_result_ids_size, field_id, field,
+                            all_result_ids, all_result_ids_len, filter_ids, filter_ids_length, concurrency,
+                            sort_order, field_values, geopoint_indices);
+        }
     } else {
         // Non-wildcard
         // In multi-field searches, a record can be matched across different fields, so we use this for aggregation
@@ -2356,6 +3144,7 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
 
         // FIXME: needed?
         std::set<uint64> query_hashes;
+        intersection_memo_t intersection_memo;
 
         // resolve synonyms so that we can compute `syn_orig_num_tokens`
         std::vector<std::vector<token_t>> all_queries = {field_query_tokens[0].q_include_tokens};
@@ -2391,10 +3180,10 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
                             excluded_result_ids_size, filter_ids, filter_ids_length, curated_ids_sorted,
                             sort_fields_std, num_typos, searched_queries, qtoken_set, topster, groups_processed,
                             all_result_ids, all_result_ids_len, group_limit, group_by_fields, prioritize_exact_match,
-                            prioritize_token_position, query_hashes, token_order, prefixes,
+                            prioritize_token_position, query_hashes, &intersection_memo, token_order, prefixes,
                             typo_tokens_threshold, exhaustive_search,
                             max_candidates, min_len_1typo, min_len_2typo, syn_orig_num_tokens, sort_order,
-                            field_values, geopoint_indices);
+                            field_values, geopoint_indices, concurrency, enable_top_k_pruning, query_plan);
 
         // try split/joining tokens if no results are found
         if(split_join_tokens == always || (all_result_ids_len == 0 && split_join_tokens == fallback)) {
@@ -2428,8 +3217,9 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
                                     excluded_result_ids_size, filter_ids, filter_ids_length, curated_ids_sorted,
                                     sort_fields_std, num_typos, searched_queries, qtoken_set, topster, groups_processed,
                                     all_result_ids, all_result_ids_len, group_limit, group_by_fields, prioritize_exact_match,
-                                    prioritize_token_position, query_hashes, token_order, prefixes, typo_tokens_threshold, exhaustive_search,
-                                    max_candidates, min_len_1typo, min_len_2typo, syn_orig_num_tokens, sort_order, field_values, geopoint_indices);
+                                    prioritize_token_position, query_hashes, &intersection_memo, token_order, prefixes, typo_tokens_threshold, exhaustive_search,
+                                    max_candidates, min_len_1typo, min_len_2typo, syn_orig_num_tokens, sort_order, field_values, geopoint_indices,
+                                    concurrency, enable_top_k_pruning, query_plan);
             }
         }
 
@@ -2440,9 +3230,9 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
                           min_len_1typo, min_len_2typo, max_candidates, curated_ids, curated_ids_sorted,
                           excluded_result_ids, excluded_result_ids_size, topster, q_pos_synonyms, syn_orig_num_tokens,
                           groups_processed, searched_queries, all_result_ids, all_result_ids_len,
-                          filter_ids, filter_ids_length, query_hashes,
+                          filter_ids, filter_ids_length, query_hashes, &intersection_memo,
                           sort_order, field_values, geopoint_indices,
-                          qtoken_set);
+                          qtoken_set, enable_top_k_pruning, query_plan);
 
         // gather up both original query and synonym queries and do drop tokens
 
@@ -2484,9 +3274,10 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
                                             excluded_result_ids_size, filter_ids, filter_ids_length, curated_ids_sorted,
                                             sort_fields_std, num_typos, searched_queries, qtoken_set, topster, groups_processed,
                                             all_result_ids, all_result_ids_len, group_limit, group_by_fields, prioritize_exact_match,
-                                            prioritize_token_position, query_hashes, token_order, prefixes, typo_tokens_threshold,
+                                            prioritize_token_position, query_hashes, &intersection_memo, token_order, prefixes, typo_tokens_threshold,
                                             exhaustive_search, max_candidates, min_len_1typo,
-                                            min_len_2typo, -1, sort_order, field_values, geopoint_indices);
+                                            min_len_2typo, -1, sort_order, field_values, geopoint_indices,
+                                            concurrency, enable_top_k_pruning, query_plan);
 
                     } else {
                         break;
@@ -2503,6 +3294,15 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
                         sort_order, field_values, geopoint_indices,
                         curated_ids_sorted, all_result_ids, all_result_ids_len, groups_processed);
 
+        if(!vector_query.field_name.empty()) {
+            std::vector<std::pair<float, uint32_t>> dist_ids;
+            search_vector(vector_query, filter_ids, filter_ids_length, !filters.empty() || filter_ids_length != 0,
+                          excluded_result_ids, excluded_result_ids_size, dist_ids);
+
+            add_vector_hits(vector_query, dist_ids, true, sort_fields_std, sort_order, field_values,
+                            geopoint_indices, topster, searched_queries, all_result_ids, all_result_ids_len);
+        }
+
         /*auto timeMillis0 = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::high_resolution_clock::now() - begin0).count();
 
@@ -2514,10 +3314,68 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
     delete [] exclude_token_ids;
     delete [] excluded_result_ids;
 
+    const uint64_t generation = write_generation;
+    std::string facet_cache_key;
+    bool facet_cache_hit = false;
+
+    size_t sample_percent = facet_sample_percent;
+    size_t sample_threshold = facet_sample_threshold;
+
+    if(!facets.empty() && facet_sample_percent == 100 && group_limit == 0 &&
+       all_result_ids_len >= BUDGET_FACET_SAMPLE_THRESHOLD && search_budget_spent(BUDGET_FACETS_SHARE)) {
+        sample_percent = BUDGET_FACET_SAMPLE_PERCENT;
+        sample_threshold = BUDGET_FACET_SAMPLE_THRESHOLD;
+        search_degradations |= DEGRADED_FACETS;
+    }
+
     if(!facets.empty()) {
-        const size_t num_threads = std::min(concurrency, all_result_ids_len);
+        facet_cache_key = get_facet_cache_key(facets, facet_query, facet_query_num_typos, max_candidates,
+                                              group_limit, group_by_fields, sample_percent,
+                                              sample_threshold, all_result_ids, all_result_ids_len,
+                                              included_ids_vec);
+
+        std::unique_lock cache_lock(facet_result_cache_mutex);
+        auto hit_it = facet_result_cache.find(facet_cache_key);
+        if(hit_it != facet_result_cache.end() && hit_it.value().write_generation == generation) {
+            const auto& cached_facets = *hit_it.value().facets;
+            for(size_t i = 0; i < facets.size(); i++) {
+                facets[i].result_map = cached_facets[i].result_map;
+                facets[i].hash_tokens = cached_facets[i].hash_tokens;
+                facets[i].hash_groups = cached_facets[i].hash_groups;
+                facets[i].stats = cached_facets[i].stats;
+                facets[i].ranges = cached_facets[i].ranges;
+                facets[i].is_sampled = cached_facets[i].is_sampled;
+            }
+
+            facet_cache_hit = true;
+        }
+    }
+
+    if(!facets.empty() && !facet_cache_hit) {
+        // on a large enough result set, facets can be counted over a sample of the ids and scaled back up
+        const bool use_facet_sample = (sample_percent < 100 && group_limit == 0 &&
+                                       all_result_ids_len >= sample_threshold);
+        std::vector<uint32_t> facet_sample_ids;
+
+        if(use_facet_sample) {
+            facet_sample_ids.reserve(all_result_ids_len * sample_percent / 100 + 1);
+
+            // the sample depends only on the ids, so repeating a search (e.g. for another page) gives the same counts
+            for(size_t i = 0; i < all_result_ids_len; i++) {
+                uint64_t h = all_result_ids[i] * 0x9E3779B97F4A7C15ULL;
+                h ^= (h >> 32);
+                if(h % 100 < sample_percent) {
+                    facet_sample_ids.push_back(all_result_ids[i]);
+                }
+            }
+        }
+
+        uint32_t* facet_ids = use_facet_sample ? facet_sample_ids.data() : all_result_ids;
+        const size_t facet_ids_len = use_facet_sample ? facet_sample_ids.size() : all_result_ids_len;
+
+        const size_t num_threads = std::min(concurrency, facet_ids_len);
         const size_t window_size = (num_threads == 0) ? 0 :
-                                   (all_result_ids_len + num_threads - 1) / num_threads;  // rounds up
+                                   (facet_ids_len + num_threads - 1) / num_threads;  // rounds up
         size_t num_processed = 0;
         std::mutex m_process;
         std::condition_variable cv_process;
@@ -2530,32 +3388,53 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
         for(size_t i = 0; i < num_threads; i++) {
             for(const auto& this_facet: facets) {
                 facet_batches[i].emplace_back(facet(this_facet.field_name));
+                facet_batches[i].back().ranges = this_facet.ranges;
             }
         }
 
+        const auto parent_search_begin = search_begin;
+        const auto parent_search_stop_ms = search_stop_ms;
+        auto parent_search_cutoff = search_cutoff;
+        auto parent_search_cancel_token = search_cancel_token;
+        auto parent_search_profile = search_profile;
+
         size_t num_queued = 0;
         size_t result_index = 0;
 
         //auto beginF = std::chrono::high_resolution_clock::now();
 
-        for(size_t thread_id = 0; thread_id < num_threads && result_index < all_result_ids_len; thread_id++) {
+        for(size_t thread_id = 0; thread_id < num_threads && result_index < facet_ids_len; thread_id++) {
             size_t batch_res_len = window_size;
 
-            if(result_index + window_size > all_result_ids_len) {
-                batch_res_len = all_result_ids_len - result_index;
+            if(result_index + window_size > facet_ids_len) {
+                batch_res_len = facet_ids_len - result_index;
             }
 
-            uint32_t* batch_result_ids = all_result_ids + result_index;
+            uint32_t* batch_result_ids = facet_ids + result_index;
             num_queued++;
 
-            thread_pool->enqueue([this, thread_id, &facet_batches, &facet_query, group_limit, group_by_fields,
-                                         batch_result_ids, batch_res_len, &facet_infos,
-                                         &num_processed, &m_process, &cv_process]() {
+            thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::FACETS,
+                                      [this, thread_id, &facet_batches, &facet_query, group_limit, group_by_fields,
+                                       batch_result_ids, batch_res_len, &facet_infos,
+                                       &num_processed, &m_process, &cv_process,
+                                       &parent_search_begin, &parent_search_stop_ms, &parent_search_cutoff,
+                                       parent_search_cancel_token, parent_search_profile]() {
+                search_begin = parent_search_begin;
+                search_stop_ms = parent_search_stop_ms;
+                search_cutoff = parent_search_cutoff;
+                search_cancel_token = parent_search_cancel_token;
+                search_profile = parent_search_profile;
+
                 auto fq = facet_query;
                 do_facets(facet_batches[thread_id], fq, facet_infos, group_limit, group_by_fields,
                           batch_result_ids, batch_res_len);
+
+                search_cancel_token = nullptr;
+                search_profile = nullptr;
+
                 std::unique_lock<std::mutex> lock(m_process);
                 num_processed++;
+                parent_search_cutoff = parent_search_cutoff || search_cutoff;
                 cv_process.notify_one();
             });
 
@@ -2564,6 +3443,7 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
 
         std::unique_lock<std::mutex> lock_process(m_process);
         cv_process.wait(lock_process, [&](){ return num_processed == num_queued; });
+        search_cutoff = parent_search_cutoff;
 
         for(auto& facet_batch: facet_batches) {
             for(size_t fi = 0; fi < facet_batch.size(); fi++) {
@@ -2593,6 +3473,10 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
                     acc_facet.hash_tokens[facet_kv.first] = this_facet.hash_tokens[facet_kv.first];
                 }
 
+                for(size_t r = 0; r < this_facet.ranges.size(); r++) {
+                    acc_facet.ranges[r].count += this_facet.ranges[r].count;
+                }
+
                 if(this_facet.stats.fvcount != 0) {
                     acc_facet.stats.fvcount += this_facet.stats.fvcount;
                     acc_facet.stats.fvsum += this_facet.stats.fvsum;
@@ -2602,15 +3486,47 @@ void Index::search(std::vector<query_tokens_t>& field_query_tokens, const std::v
             }
         }
 
+        if(use_facet_sample && facet_ids_len != 0) {
+            // min and max are left as seen in the sample
+            const double scale = double(all_result_ids_len) / facet_ids_len;
+
+            for(auto& acc_facet: facets) {
+                for(auto& facet_kv: acc_facet.result_map) {
+                    facet_kv.second.count = uint32_t(std::llround(facet_kv.second.count * scale));
+                }
+
+                for(auto& range: acc_facet.ranges) {
+                    range.count = uint32_t(std::llround(range.count * scale));
+                }
+
+                acc_facet.stats.fvcount = std::round(acc_facet.stats.fvcount * scale);
+                acc_facet.stats.fvsum *= scale;
+                acc_facet.is_sampled = true;
+            }
+        }
+
         /*long long int timeMillisF = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::high_resolution_clock::now() - beginF).count();
         LOG(INFO) << "Time for faceting: " << timeMillisF;*/
     }
 
-    std::vector<facet_info_t> facet_infos(facets.size());
-    compute_facet_infos(facets, facet_query, facet_query_num_typos,
-                        &included_ids_vec[0], included_ids_vec.size(), group_by_fields, max_candidates, facet_infos);
-    do_facets(facets, facet_query, facet_infos, group_limit, group_by_fields, &included_ids_vec[0], included_ids_vec.size());
+    if(!facet_cache_hit) {
+        std::vector<facet_info_t> facet_infos(facets.size());
+        compute_facet_infos(facets, facet_query, facet_query_num_typos,
+                            &included_ids_vec[0], included_ids_vec.size(), group_by_fields, max_candidates, facet_infos);
+        do_facets(facets, facet_query, facet_infos, group_limit, group_by_fields, &included_ids_vec[0],
+                  included_ids_vec.size());
+
+        // facets cut short by the search cutoff are incomplete
+        if(!facets.empty() && !search_cutoff) {
+            facet_result_t facet_result;
+            facet_result.write_generation = generation;
+            facet_result.facets = std::make_shared<const std::vector<facet>>(facets);
+
+            std::unique_lock cache_lock(facet_result_cache_mutex);
+            facet_result_cache.insert(facet_cache_key, facet_result);
+        }
+    }
 
     all_result_ids_len += curated_topster->size;
 
@@ -2711,12 +3627,13 @@ void Index::fuzzy_search_fields(const std::vector<search_field_t>& the_fields,
                                 const std::vector<uint32_t>& num_typos,
                                 std::vector<std::vector<art_leaf*>> & searched_queries,
                                 tsl::htrie_map<char, token_leaf>& qtoken_set,
-                                Topster* topster, spp::sparse_hash_set<uint64_t>& groups_processed,
+                                Topster* topster, group_counter_t& groups_processed,
                                 uint32_t*& all_result_ids, size_t & all_result_ids_len,
                                 const size_t group_limit, const std::vector<std::string>& group_by_fields,
                                 bool prioritize_exact_match,
                                 const bool prioritize_token_position,
                                 std::set<uint64>& query_hashes,
+                                intersection_memo_t* intersection_memo,
                                 const token_ordering token_order,
                                 const std::vector<bool>& prefixes,
                                 const size_t typo_tokens_threshold,
@@ -2726,8 +3643,11 @@ void Index::fuzzy_search_fields(const std::vector<search_field_t>& the_fields,
                                 size_t min_len_2typo,
                                 int syn_orig_num_tokens,
                                 const int* sort_order,
-                                std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
-                                const std::vector<size_t>& geopoint_indices) const {
+                                std::array<sort_column_t*, 3>& field_values,
+                                const std::vector<size_t>& geopoint_indices,
+                                const size_t concurrency,
+                                const bool enable_top_k_pruning,
+                                query_plan_t* query_plan) const {
 
     // NOTE: `query_tokens` preserve original tokens, while `search_tokens` could be a result of dropped tokens
 
@@ -2765,6 +3685,12 @@ void Index::fuzzy_search_fields(const std::vector<search_field_t>& the_fields,
     while(n < N && n < combination_limit) {
         RETURN_CIRCUIT_BREAKER
 
+        if(n != 0 && search_budget_spent(BUDGET_TYPOS_SHARE)) {
+            // the combinations with more typos than the ones tried so far are given up on
+            search_degradations |= DEGRADED_TYPOS;
+            return ;
+        }
+
         //LOG(INFO) << "fuzzy_search_fields, n: " << n;
 
         // Outerloop generates combinations of [cost to max_cost] for each token
@@ -2789,6 +3715,24 @@ void Index::fuzzy_search_fields(const std::vector<search_field_t>& the_fields,
 
             if(token_cost_cache.count(token_cost_hash) != 0) {
                 leaves = token_cost_cache[token_cost_hash];
+            } else if(vocabulary != nullptr) {
+                // typos and prefixes of the token are expanded once for all the fields
+                {
+                    search_stage_timer_t candidates_timer(search_profile_t::CANDIDATES);
+                    search_vocabulary_leaves(the_fields, num_search_fields, query_tokens[token_index],
+                                             costs[token_index], num_typos, prefixes, 100000, token_order,
+                                             filter_ids, filter_ids_length, leaves, unique_tokens);
+                }
+
+                search_profile_add(search_profile_t::CANDIDATES_GENERATED, leaves.size());
+
+                if(!leaves.empty()) {
+                    token_cost_cache.emplace(token_cost_hash, leaves);
+                    for(auto leaf: leaves) {
+                        std::string tok(reinterpret_cast<char*>(leaf->key), leaf->key_len - 1);
+                        unique_tokens.emplace(tok);
+                    }
+                }
             } else {
                 //auto begin = std::chrono::high_resolution_clock::now();
 
@@ -2814,9 +3758,16 @@ void Index::fuzzy_search_fields(const std::vector<search_field_t>& the_fields,
                     }
 
                     size_t max_words = 100000;
-                    art_fuzzy_search(search_index.at(the_field.name), (const unsigned char *) token.c_str(), token_len,
-                                     costs[token_index], costs[token_index], max_words, token_order, prefix_search,
-                                     filter_ids, filter_ids_length, leaves, unique_tokens);
+                    const size_t num_prev_leaves = leaves.size();
+
+                    {
+                        search_stage_timer_t candidates_timer(search_profile_t::CANDIDATES);
+                        search_token_leaves(the_field.name, token, token_len, costs[token_index], max_words,
+                                            token_order, prefix_search, filter_ids, filter_ids_length, leaves,
+                                            unique_tokens);
+                    }
+
+                    search_profile_add(search_profile_t::CANDIDATES_GENERATED, leaves.size() - num_prev_leaves);
 
                     /*auto timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
                                     std::chrono::high_resolution_clock::now() - begin).count();
@@ -2838,18 +3789,22 @@ void Index::fuzzy_search_fields(const std::vector<search_field_t>& the_fields,
             if(!leaves.empty()) {
                 //log_leaves(costs[token_index], token, leaves);
                 std::vector<std::string> leaf_tokens;
-                std::unordered_set<std::string> leaf_token_set;
+                std::vector<uint64_t> leaf_token_hashes;
+
+                // the same token found in many fields is a candidate once; keys are not copied to check that
+                std::unordered_set<std::string_view> leaf_token_set;
 
                 for(auto leaf: leaves) {
-                    std::string ltok(reinterpret_cast<char*>(leaf->key), leaf->key_len - 1);
-                    if(leaf_token_set.count(ltok) == 0) {
-                        leaf_tokens.push_back(ltok);
-                        leaf_token_set.insert(ltok);
+                    std::string_view ltok(reinterpret_cast<char*>(leaf->key), leaf->key_len - 1);
+                    if(leaf_token_set.insert(ltok).second) {
+                        leaf_tokens.emplace_back(ltok);
+                        leaf_token_hashes.push_back(StringUtils::hash_wy(ltok.data(), ltok.size()));
                     }
                 }
 
                 token_candidates_vec.push_back(tok_candidates{query_tokens[token_index], costs[token_index],
-                                                              query_tokens[token_index].is_prefix_searched, leaf_tokens});
+                                                              query_tokens[token_index].is_prefix_searched,
+                                                              std::move(leaf_tokens), std::move(leaf_token_hashes)});
             } else {
                 // No result at `cost = costs[token_index]`. Remove `cost` for token and re-do combinations
                 auto it = std::find(token_to_costs[token_index].begin(), token_to_costs[token_index].end(), costs[token_index]);
@@ -2875,6 +3830,12 @@ void Index::fuzzy_search_fields(const std::vector<search_field_t>& the_fields,
 
         if(token_candidates_vec.size() == query_tokens.size()) {
             std::vector<uint32_t> id_buff;
+            size_t combination_max_candidates = max_candidates;
+
+            if(max_candidates > BUDGET_MAX_CANDIDATES && search_budget_spent(BUDGET_MAX_CANDIDATES_SHARE)) {
+                combination_max_candidates = BUDGET_MAX_CANDIDATES;
+                search_degradations |= DEGRADED_MAX_CANDIDATES;
+            }
 
             search_all_candidates(num_search_fields, the_fields, filter_ids, filter_ids_length,
                                   exclude_token_ids, exclude_token_ids_size,
@@ -2882,9 +3843,10 @@ void Index::fuzzy_search_fields(const std::vector<search_field_t>& the_fields,
                                   groups_processed, all_result_ids, all_result_ids_len,
                                   typo_tokens_threshold, group_limit, group_by_fields, query_tokens,
                                   num_typos, prefixes, prioritize_exact_match, prioritize_token_position,
-                                  exhaustive_search, max_candidates,
+                                  exhaustive_search, combination_max_candidates,
                                   syn_orig_num_tokens, sort_order, field_values, geopoint_indices,
-                                  query_hashes, id_buff);
+                                  query_hashes, intersection_memo, id_buff, concurrency, enable_top_k_pruning,
+                                  query_plan);
 
             if(id_buff.size() > 1) {
                 gfx::timsort(id_buff.begin(), id_buff.end());
@@ -2921,6 +3883,7 @@ void Index::find_across_fields(const std::vector<token_t>& query_tokens,
 
     // one iterator for each token, each underlying iterator contains results of token across multiple fields
     std::vector<or_iterator_t> token_its;
+    std::vector<uint32_t> token_num_ids;
 
     // used to track plists that must be destructed once done
     std::vector<posting_list_t*> expanded_plists;
@@ -2937,6 +3900,7 @@ void Index::find_across_fields(const std::vector<token_t>& query_tokens,
         auto token_c_str = (const unsigned char*) token_str.c_str();
         const size_t token_len = token_str.size() + 1;
         std::vector<posting_list_t::iterator_t> its;
+        uint32_t num_ids = 0;
 
         for(size_t i = 0; i < num_search_fields; i++) {
             const std::string& field_name = the_fields[i].name;
@@ -2964,6 +3928,8 @@ void Index::find_across_fields(const std::vector<token_t>& query_tokens,
             /*LOG(INFO) << "Token: " << token_str << ", field_name: " << field_name
                       << ", num_ids: " << posting_t::num_ids(leaf->values);*/
 
+            num_ids += posting_t::num_ids(leaf->values);
+
             if(IS_COMPACT_POSTING(leaf->values)) {
                 auto compact_posting_list = COMPACT_POSTING_PTR(leaf->values);
                 posting_list_t* full_posting_list = compact_posting_list->to_full_posting_list();
@@ -2983,9 +3949,19 @@ void Index::find_across_fields(const std::vector<token_t>& query_tokens,
 
         or_iterator_t token_fields(its);
         token_its.push_back(std::move(token_fields));
+        token_num_ids.push_back(num_ids);
+    }
+
+    // rarest token first, so that the other iterators skip ahead as far as possible
+    std::vector<uint32_t> intersection_order;
+    query_plan_t::intersection_order(token_num_ids, intersection_order);
+
+    std::vector<or_iterator_t> ordered_token_its;
+    for(uint32_t ti: intersection_order) {
+        ordered_token_its.push_back(std::move(token_its[ti]));
     }
 
-    or_iterator_t::intersect(token_its, istate, [&](uint32_t seq_id, const std::vector<or_iterator_t>& its) {
+    or_iterator_t::intersect(ordered_token_its, istate, [&](uint32_t seq_id, const std::vector<or_iterator_t>& its) {
         // Convert [token -> fields] orientation to [field -> tokens] orientation
         //LOG(INFO) << "seq_id: " << seq_id;
         id_buff.push_back(seq_id);
@@ -3003,7 +3979,7 @@ void Index::search_across_fields(const std::vector<token_t>& query_tokens,
                                  const size_t num_search_fields,
                                  const std::vector<sort_by>& sort_fields,
                                  Topster* topster,
-                                 spp::sparse_hash_set<uint64_t>& groups_processed,
+                                 group_counter_t& groups_processed,
                                  std::vector<std::vector<art_leaf*>>& searched_queries,
                                  tsl::htrie_map<char, token_leaf>& qtoken_set,
                                  const size_t group_limit,
@@ -3014,21 +3990,28 @@ void Index::search_across_fields(const std::vector<token_t>& query_tokens,
                                  const uint32_t total_cost, const int syn_orig_num_tokens,
                                  const uint32_t* exclude_token_ids, size_t exclude_token_ids_size,
                                  const int* sort_order,
-                                 std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
+                                 std::array<sort_column_t*, 3>& field_values,
                                  const std::vector<size_t>& geopoint_indices,
                                  std::vector<uint32_t>& id_buff,
-                                 uint32_t*& all_result_ids, size_t& all_result_ids_len) const {
+                                 intersection_memo_t* intersection_memo,
+                                 uint32_t*& all_result_ids, size_t& all_result_ids_len,
+                                 const size_t concurrency,
+                                 const bool enable_top_k_pruning,
+                                 query_plan_t* query_plan) const {
 
+    search_stage_timer_t intersection_timer(search_profile_t::INTERSECTION);
     std::vector<art_leaf*> query_suggestion;
 
-    // one iterator for each token, each underlying iterator contains results of token across multiple fields
-    std::vector<or_iterator_t> token_its;
+    // posting lists of each token across all query_by fields, along with the index of the field they belong to
+    std::vector<std::vector<std::pair<posting_list_t*, uint32_t>>> token_plists;
+    std::vector<uint32_t> token_num_ids;
+
+    // position of the token of each of `token_plists` in `query_tokens`
+    std::vector<uint32_t> token_positions;
 
     // used to track plists that must be destructed once done
     std::vector<posting_list_t*> expanded_plists;
 
-    result_iter_state_t istate(exclude_token_ids, exclude_token_ids_size, filter_ids, filter_ids_length);
-
     // for each token, find the posting lists across all query_by fields
     for(size_t ti = 0; ti < query_tokens.size(); ti++) {
         const bool prefix_search = query_tokens[ti].is_prefix_searched;
@@ -3038,7 +4021,8 @@ void Index::search_across_fields(const std::vector<token_t>& query_tokens,
         auto& token_str = query_tokens[ti].value;
         auto token_c_str = (const unsigned char*) token_str.c_str();
         const size_t token_len = token_str.size() + 1;
-        std::vector<posting_list_t::iterator_t> its;
+        std::vector<std::pair<posting_list_t*, uint32_t>> plists;
+        uint32_t num_ids = 0;
 
         for(size_t i = 0; i < num_search_fields; i++) {
             const std::string& field_name = the_fields[i].name;
@@ -3068,114 +4052,426 @@ void Index::search_across_fields(const std::vector<token_t>& query_tokens,
             /*LOG(INFO) << "Token: " << token_str << ", field_name: " << field_name
                       << ", num_ids: " << posting_t::num_ids(leaf->values);*/
 
+            num_ids += posting_t::num_ids(leaf->values);
+
             if(IS_COMPACT_POSTING(leaf->values)) {
                 auto compact_posting_list = COMPACT_POSTING_PTR(leaf->values);
                 posting_list_t* full_posting_list = compact_posting_list->to_full_posting_list();
                 expanded_plists.push_back(full_posting_list);
-                its.push_back(full_posting_list->new_iterator(nullptr, nullptr, i)); // moved, not copied
+                plists.emplace_back(full_posting_list, i);
             } else {
                 posting_list_t* full_posting_list = (posting_list_t*)(leaf->values);
-                its.push_back(full_posting_list->new_iterator(nullptr, nullptr, i)); // moved, not copied
+                plists.emplace_back(full_posting_list, i);
             }
         }
 
-        if(its.empty()) {
+        if(plists.empty()) {
             // this token does not have any match across *any* field: probably a typo
             LOG(INFO) << "No matching field found for token: " << token_str;
             continue;
         }
 
-        or_iterator_t token_fields(its);
-        token_its.push_back(std::move(token_fields));
+        token_plists.push_back(std::move(plists));
+        token_num_ids.push_back(num_ids);
+        token_positions.push_back(ti);
+    }
+
+    // the ids of the tokens that were intersected before (all of them, or those before the last one) stand for the
+    // filter, since they are already within it
+    intersection_memo_t::entry_t* memo_entry = nullptr;
+
+    if(intersection_memo != nullptr && !token_plists.empty()) {
+        auto intersection_key = [&](size_t num_tokens) {
+            std::string key;
+            for(size_t i = 0; i < num_tokens; i++) {
+                key += query_tokens[token_positions[i]].value;
+                key += '\0';
+                for(const auto& plist_field: token_plists[i]) {
+                    key += std::to_string(plist_field.second) + ',';
+                }
+                key += '\0';
+            }
+
+            return key;
+        };
+
+        const std::vector<uint32_t>* memo_ids = nullptr;
+        auto entry_it = intersection_memo->entries.find(intersection_key(token_plists.size()));
+
+        if(entry_it != intersection_memo->entries.end()) {
+            if(entry_it->second.computed) {
+                memo_ids = &entry_it->second.ids;
+            } else {
+                // memoized off the intersection below, as it is the prefix of other combinations
+                memo_entry = &entry_it->second;
+            }
+        }
+
+        if(memo_ids == nullptr && token_plists.size() > 1) {
+            auto& prefix_entry = intersection_memo->entries[intersection_key(token_plists.size() - 1)];
+            prefix_entry.num_uses++;
+
+            if(!prefix_entry.computed && prefix_entry.num_uses > 1 &&
+               intersection_memo->num_ids < intersection_memo_t::MAX_NUM_IDS) {
+                intersect_token_plists(token_plists, token_num_ids, token_plists.size() - 1,
+                                       filter_ids, filter_ids_length, exclude_token_ids, exclude_token_ids_size,
+                                       prefix_entry.ids);
+                prefix_entry.computed = true;
+                intersection_memo->num_ids += prefix_entry.ids.size();
+            }
+
+            if(prefix_entry.computed) {
+                memo_ids = &prefix_entry.ids;
+            }
+        }
+
+        if(memo_ids != nullptr) {
+            filter_ids = memo_ids->data();
+            filter_ids_length = memo_ids->size();
+
+            if(filter_ids_length == 0) {
+                // nothing left to intersect: an empty filter would stand for no filter at all
+                token_plists.clear();
+                token_num_ids.clear();
+                token_positions.clear();
+            }
+        }
     }
 
     std::vector<uint32_t> result_ids;
 
-    or_iterator_t::intersect(token_its, istate, [&](uint32_t seq_id, const std::vector<or_iterator_t>& its) {
-        //LOG(INFO) << "seq_id: " << seq_id;
-        // Convert [token -> fields] orientation to [field -> tokens] orientation
-        std::vector<std::vector<posting_list_t::iterator_t>> field_to_tokens(num_search_fields);
+    size_t query_len = query_tokens.size();
+    if(syn_orig_num_tokens != -1) {
+        query_len = syn_orig_num_tokens;
+    }
+
+    // Once the topster is full, blocks whose best possible text match score cannot beat the weakest hit in the
+    // topster are skipped entirely. Skipped documents are not counted towards `found`, which is why this is opt-in.
+    const bool prune_blocks = enable_top_k_pruning && group_limit == 0 && !sort_fields.empty() &&
+                              field_values[0] == &text_match_sentinel_value;
+
+    size_t max_field_weight = 0;
+    for(size_t i = 0; i < num_search_fields; i++) {
+        max_field_weight = std::max(max_field_weight, the_fields[i].weight);
+    }
+
+    const uint64_t max_words = std::max<int64_t>(query_tokens.size(), syn_orig_num_tokens);
+
+    // pruner over the hits collected into `range_topster`, which considers only ids within [0, `range_end`] and
+    // counts the matches that it may skip into `range_num_pruned`
+    auto new_block_pruner = [&](Topster* range_topster, uint32_t range_end, size_t& range_num_pruned) {
+        return [&, range_topster, range_end, block_range_checked = false, block_range_end = uint32_t(0)]
+               (std::vector<or_iterator_t>& its) mutable -> bool {
+            if(its[0].id() > range_end) {
+                // no match is possible within the range anymore
+                or_iterator_t::skip_all_to(its, UINT32_MAX);
+                return true;
+            }
+
+            if(!prune_blocks || range_topster->size < range_topster->MAX_SIZE) {
+                return false;
+            }
+
+            if(block_range_checked && its[0].id() <= block_range_end) {
+                return false;
+            }
+
+            uint32_t start_id, end_id;
+            if(!or_iterator_t::current_blocks_range(its, start_id, end_id)) {
+                return false;
+            }
+
+            block_range_checked = true;
+            block_range_end = end_id;
 
-        for(size_t ti = 0; ti < its.size(); ti++) {
-            const or_iterator_t& token_fields_iters = its[ti];
-            const std::vector<posting_list_t::iterator_t>& field_iters = token_fields_iters.get_its();
+            uint8_t max_offset_score = 0;
+            bool has_first_position = false;
 
-            for(size_t fi = 0; fi < field_iters.size(); fi++) {
-                const posting_list_t::iterator_t& field_iter = field_iters[fi];
-                if(field_iter.id() == seq_id) {
-                    // not all fields might contain a given token
-                    field_to_tokens[field_iter.get_field_id()].push_back(field_iter.clone());
+            for(const auto& token_fields_iters: its) {
+                for(const auto& field_iter: token_fields_iters.get_its()) {
+                    max_offset_score = std::max(max_offset_score, field_iter.block()->max_offset_score);
+                    has_first_position = has_first_position || field_iter.block()->has_first_position;
                 }
             }
-        }
 
-        int64_t max_field_match_score = 0, max_field_match_index = 0;
+            // only a single token query has a verbatim match that depends on the token position
+            const uint64_t max_verbatim = (query_tokens.size() != 1) ||
+                                          (prioritize_exact_match && total_cost == 0 && has_first_position);
+            const uint64_t max_offset = prioritize_token_position ? max_offset_score : 0;
 
-        for(size_t fi = 0; fi < field_to_tokens.size(); fi++) {
-            const std::vector<posting_list_t::iterator_t>& token_postings = field_to_tokens[fi];
-            if(token_postings.empty()) {
-                continue;
+            const uint64_t max_field_match_score = (max_words << 40) | (max_words << 32) |
+                                                   (uint64_t(255 - total_cost) << 24) | (uint64_t(100) << 16) |
+                                                   (max_verbatim << 8) | (max_offset << 0);
+
+            const int64_t max_score = (int64_t(query_len) << 56) | (int64_t(max_field_match_score) << 8) |
+                                      int64_t(max_field_weight);
+
+            if(max_score >= range_topster->kvs[0]->scores[0] || end_id == UINT32_MAX) {
+                return false;
+            }
+
+            // the token with the fewest ids up to `end_id` bounds the number of matches that are skipped
+            size_t num_skipped_ids = SIZE_MAX;
+
+            for(const auto& token_fields_iters: its) {
+                size_t token_num_skipped_ids = 0;
+
+                for(const auto& field_iter: token_fields_iters.get_its()) {
+                    const uint32_t* block_ids_begin = field_iter.ids + field_iter.index();
+                    const uint32_t* block_ids_end = field_iter.ids + field_iter.block()->size();
+                    token_num_skipped_ids += std::upper_bound(block_ids_begin, block_ids_end, end_id) -
+                                             block_ids_begin;
+                }
+
+                num_skipped_ids = std::min(num_skipped_ids, token_num_skipped_ids);
             }
 
-            bool field_is_array = search_schema.at(the_fields[fi].name).is_array();
-            int64_t field_match_score = 0;
+            range_num_pruned += num_skipped_ids;
+
+            or_iterator_t::skip_all_to(its, end_id + 1);
+            return true;
+        };
+    };
+
+    // The iterators are intersected rarest token first, so that the other iterators skip ahead as far as possible,
+    // but the tokens are scored in the query order.
+    std::vector<uint32_t> intersection_order;
+    query_plan_t::intersection_order(token_num_ids, intersection_order);
+
+    std::vector<uint32_t> ordered_positions(intersection_order.size());
 
-            bool single_exact_query_token = false;
-            if(total_cost == 0 && query_tokens.size() == 1) {
-                // does this candidate suggestion token match query token exactly?
-                single_exact_query_token = true;
+    for(size_t i = 0; i < intersection_order.size(); i++) {
+        ordered_positions[intersection_order[i]] = i;
+    }
+
+    query_plan_step_t plan_step;
+
+    if(query_plan != nullptr) {
+        for(uint32_t ti: token_positions) {
+            plan_step.tokens.push_back(query_tokens[ti].value);
+        }
+
+        plan_step.token_num_ids = token_num_ids;
+        plan_step.intersection_order = intersection_order;
+        plan_step.typo_cost = total_cost;
+        plan_step.estimated_num_ids = query_plan_t::estimate_num_ids(token_num_ids, filter_ids_length);
+    }
+
+    const std::vector<const sort_column_t*> group_columns = get_group_columns(group_by_fields);
+
+    std::vector<const sort_column_t*> field_token_counts(num_search_fields);
+    for(size_t fi = 0; fi < num_search_fields; fi++) {
+        field_token_counts[fi] = get_token_counts(the_fields[fi].name);
+    }
+
+    // scores the documents within [`range_start`, `range_end`] that contain all the tokens
+    auto search_range = [&](uint32_t range_start, uint32_t range_end, Topster* range_topster,
+                            std::vector<uint32_t>& range_result_ids,
+                            group_counter_t& range_groups_processed, size_t& range_num_pruned) {
+
+        // one iterator for each token, each underlying iterator contains results of token across multiple fields
+        std::vector<or_iterator_t> ordered_token_its;
+
+        for(uint32_t token_index: intersection_order) {
+            std::vector<posting_list_t::iterator_t> its;
+            for(const auto& plist_field: token_plists[token_index]) {
+                its.push_back(plist_field.first->new_iterator(nullptr, nullptr, plist_field.second));
             }
 
-            score_results2(sort_fields, searched_queries.size(), fi, field_is_array,
-                          total_cost, field_match_score,
-                          seq_id, sort_order,
-                          prioritize_exact_match, single_exact_query_token, prioritize_token_position,
-                          query_tokens.size(), syn_orig_num_tokens, token_postings);
+            ordered_token_its.emplace_back(its);
+        }
 
-            if(field_match_score > max_field_match_score) {
-                max_field_match_score = field_match_score;
-                max_field_match_index = fi;
+        if(range_start != 0) {
+            or_iterator_t::skip_all_to(ordered_token_its, range_start);
+            if(ordered_token_its.size() != intersection_order.size()) {
+                // some token has no ids within the range
+                return;
             }
         }
 
-        uint64_t distinct_id = seq_id;
-        if(group_limit != 0) {
-            distinct_id = get_distinct_id(group_by_fields, seq_id);
-            groups_processed.emplace(distinct_id);
+        const uint32_t* range_filter_ids = std::lower_bound(filter_ids, filter_ids + filter_ids_length, range_start);
+        const uint32_t range_filter_ids_length = filter_ids_length - (range_filter_ids - filter_ids);
+
+        if(filter_ids_length != 0 && range_filter_ids_length == 0) {
+            return;
         }
 
-        int64_t scores[3] = {0};
-        int64_t match_score_index = -1;
+        result_iter_state_t istate(exclude_token_ids, exclude_token_ids_size,
+                                   range_filter_ids, range_filter_ids_length);
 
-        compute_sort_scores(sort_fields, sort_order, field_values, geopoint_indices, seq_id,
-                            max_field_match_score, scores, match_score_index);
+        or_iterator_t::intersect(ordered_token_its, istate,
+                                 [&](uint32_t seq_id, const std::vector<or_iterator_t>& its) {
+            //LOG(INFO) << "seq_id: " << seq_id;
+            // Convert [token -> fields] orientation to [field -> tokens] orientation
+            std::vector<std::vector<posting_list_t::iterator_t>> field_to_tokens(num_search_fields);
 
-        size_t query_len = query_tokens.size();
-        if(syn_orig_num_tokens != -1) {
-            query_len = syn_orig_num_tokens;
+            for(size_t ti = 0; ti < its.size(); ti++) {
+                const or_iterator_t& token_fields_iters = its[ordered_positions[ti]];
+                const std::vector<posting_list_t::iterator_t>& field_iters = token_fields_iters.get_its();
+
+                for(size_t fi = 0; fi < field_iters.size(); fi++) {
+                    const posting_list_t::iterator_t& field_iter = field_iters[fi];
+                    if(field_iter.id() == seq_id) {
+                        // not all fields might contain a given token
+                        field_to_tokens[field_iter.get_field_id()].push_back(field_iter.clone());
+                    }
+                }
+            }
+
+            int64_t max_field_match_score = 0, max_field_match_index = 0;
+
+            for(size_t fi = 0; fi < field_to_tokens.size(); fi++) {
+                const std::vector<posting_list_t::iterator_t>& token_postings = field_to_tokens[fi];
+                if(token_postings.empty()) {
+                    continue;
+                }
+
+                bool field_is_array = search_schema.at(the_fields[fi].name).is_array();
+                int64_t field_match_score = 0;
+
+                bool single_exact_query_token = false;
+                if(total_cost == 0 && query_tokens.size() == 1) {
+                    // does this candidate suggestion token match query token exactly?
+                    single_exact_query_token = true;
+                }
+
+                score_results2(sort_fields, searched_queries.size(), fi, field_is_array,
+                              total_cost, field_match_score,
+                              seq_id, sort_order,
+                              prioritize_exact_match, single_exact_query_token, prioritize_token_position,
+                              query_tokens.size(), syn_orig_num_tokens, token_postings, field_token_counts[fi]);
+
+                if(field_match_score > max_field_match_score) {
+                    max_field_match_score = field_match_score;
+                    max_field_match_index = fi;
+                }
+            }
+
+            uint64_t distinct_id = seq_id;
+            if(group_limit != 0) {
+                distinct_id = get_distinct_id(group_columns, seq_id);
+                range_groups_processed.emplace(distinct_id);
+            }
+
+            int64_t scores[3] = {0};
+            int64_t match_score_index = -1;
+
+            compute_sort_scores(sort_fields, sort_order, field_values, geopoint_indices, seq_id,
+                                max_field_match_score, scores, match_score_index);
+
+            // NOTE: `query_len` is total tokens matched across fields.
+            // Within a field, only a subset can match
+
+            uint64_t aggregated_score = (int64_t(query_len) << 56) |
+                                        (int64_t(max_field_match_score) << 8) |
+                                        (int64_t(the_fields[max_field_match_index].weight) << 0);
+
+            /*LOG(INFO) << "seq_id: " << seq_id << ", query_tokens.size(): " << query_tokens.size()
+                      << ", syn_orig_num_tokens: " << syn_orig_num_tokens
+                      << ", max_field_match_score: " << max_field_match_score
+                      << ", max_field_match_index: " << max_field_match_index
+                      << ", field_weight: " << the_fields[max_field_match_index].weight
+                      << ", aggregated_score: " << aggregated_score;*/
+
+            KV kv(0, searched_queries.size(), 0, seq_id, distinct_id, match_score_index, scores);
+            if(match_score_index != -1) {
+                kv.scores[match_score_index] = aggregated_score;
+            }
+            range_topster->add(&kv);
+            range_result_ids.push_back(seq_id);
+        }, new_block_pruner(range_topster, range_end, range_num_pruned));
+    };
+
+    // large candidate sets are split by seq_id range across threads, each collecting hits into its own topster
+    size_t num_threads = 1;
+    uint32_t min_id = UINT32_MAX, max_id = 0;
+
+    if(concurrency > 1 && !token_plists.empty() &&
+       size_t(query_plan_t::estimate_num_ids(token_num_ids, filter_ids_length)) * num_search_fields >=
+       PARALLEL_FIELDS_SEARCH_MIN_WORK) {
+        for(const auto& plist_field: token_plists[intersection_order[0]]) {
+            min_id = std::min(min_id, plist_field.first->first_id());
+            max_id = std::max(max_id, plist_field.first->last_id());
+        }
+
+        if(min_id < max_id) {
+            num_threads = std::min<size_t>(concurrency, max_id - min_id + 1);
         }
+    }
 
-        // NOTE: `query_len` is total tokens matched across fields.
-        // Within a field, only a subset can match
+    size_t num_pruned = 0;
 
-        uint64_t aggregated_score = (int64_t(query_len) << 56) |
-                                    (int64_t(max_field_match_score) << 8) |
-                                    (int64_t(the_fields[max_field_match_index].weight) << 0);
+    if(num_threads == 1) {
+        search_range(0, UINT32_MAX, topster, result_ids, groups_processed, num_pruned);
+    } else {
+        const uint32_t window_size = ((max_id - min_id) / num_threads) + 1;
+
+        search_arena_scope_t arena_scope;
+        std::vector<Topster*> range_topsters(num_threads);
+        std::vector<std::vector<uint32_t>> range_result_ids(num_threads);
+        std::vector<group_counter_t> range_groups_processed(num_threads);
+        std::vector<size_t> range_num_pruned(num_threads, 0);
+
+        size_t num_processed = 0;
+        std::mutex m_process;
+        std::condition_variable cv_process;
+        auto parent_search_profile = search_profile;
+
+        for(size_t thread_id = 0; thread_id < num_threads; thread_id++) {
+            const uint32_t window_start = min_id + thread_id * window_size;
+            const uint32_t range_start = (thread_id == 0) ? 0 : window_start;
+            const uint32_t range_end = (thread_id == num_threads - 1) ? UINT32_MAX : window_start + window_size - 1;
+            range_topsters[thread_id] = new Topster(topster->MAX_SIZE, topster->distinct, search_arena);
+            range_topsters[thread_id]->groups.set_max_groups(topster->groups.get_max_groups());
+            range_topsters[thread_id]->set_search_after(topster->get_search_after());
+
+            thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::SEARCH,
+                                      [&, thread_id, range_start, range_end]() {
+                search_profile = parent_search_profile;
+                search_range(range_start, range_end, range_topsters[thread_id], range_result_ids[thread_id],
+                             range_groups_processed[thread_id], range_num_pruned[thread_id]);
+                search_profile = nullptr;
+
+                std::unique_lock<std::mutex> lock(m_process);
+                num_processed++;
+                cv_process.notify_one();
+            });
+        }
 
-        /*LOG(INFO) << "seq_id: " << seq_id << ", query_tokens.size(): " << query_tokens.size()
-                  << ", syn_orig_num_tokens: " << syn_orig_num_tokens
-                  << ", max_field_match_score: " << max_field_match_score
-                  << ", max_field_match_index: " << max_field_match_index
-                  << ", field_weight: " << the_fields[max_field_match_index].weight
-                  << ", aggregated_score: " << aggregated_score;*/
+        std::unique_lock<std::mutex> lock_process(m_process);
+        cv_process.wait(lock_process, [&](){ return num_processed == num_threads; });
 
-        KV kv(0, searched_queries.size(), 0, seq_id, distinct_id, match_score_index, scores);
-        if(match_score_index != -1) {
-            kv.scores[match_score_index] = aggregated_score;
+        // ranges are in seq_id order, so the merged ids remain sorted
+        for(size_t thread_id = 0; thread_id < num_threads; thread_id++) {
+            result_ids.insert(result_ids.end(), range_result_ids[thread_id].begin(), range_result_ids[thread_id].end());
+            groups_processed.merge(range_groups_processed[thread_id]);
+            num_pruned += range_num_pruned[thread_id];
+            aggregate_topster(topster, range_topsters[thread_id]);
+            delete range_topsters[thread_id];
         }
-        topster->add(&kv);
-        result_ids.push_back(seq_id);
-    });
+    }
+
+    if(query_plan != nullptr) {
+        plan_step.num_found = result_ids.size();
+        query_plan->add_step(std::move(plan_step));
+    }
+
+    search_profile_add(search_profile_t::IDS_INTERSECTED, result_ids.size());
+
+    if(num_pruned != 0) {
+        // no more can match than the rarest token has ids
+        const size_t max_num_ids = query_plan_t::estimate_num_ids(token_num_ids, filter_ids_length);
+        search_num_pruned_ids += (max_num_ids > result_ids.size()) ?
+                                 std::min(num_pruned, max_num_ids - result_ids.size()) : 0;
+    }
+
+    // pruned blocks leave out ids that the intersection matched
+    if(memo_entry != nullptr && !prune_blocks &&
+       intersection_memo->num_ids + result_ids.size() <= intersection_memo_t::MAX_NUM_IDS) {
+        memo_entry->ids = result_ids;
+        memo_entry->computed = true;
+        intersection_memo->num_ids += result_ids.size();
+    }
 
     id_buff.insert(id_buff.end(), result_ids.begin(), result_ids.end());
 
@@ -3204,8 +4500,35 @@ void Index::search_across_fields(const std::vector<token_t>& query_tokens,
     }
 }
 
+void Index::intersect_token_plists(const std::vector<std::vector<std::pair<posting_list_t*, uint32_t>>>& token_plists,
+                                   const std::vector<uint32_t>& token_num_ids, const size_t num_tokens,
+                                   const uint32_t* filter_ids, const uint32_t filter_ids_length,
+                                   const uint32_t* exclude_token_ids, const size_t exclude_token_ids_size,
+                                   std::vector<uint32_t>& ids) {
+    std::vector<uint32_t> intersection_order;
+    query_plan_t::intersection_order(std::vector<uint32_t>(token_num_ids.begin(), token_num_ids.begin() + num_tokens),
+                                     intersection_order);
+
+    std::vector<or_iterator_t> ordered_token_its;
+
+    for(uint32_t token_index: intersection_order) {
+        std::vector<posting_list_t::iterator_t> its;
+        for(const auto& plist_field: token_plists[token_index]) {
+            its.push_back(plist_field.first->new_iterator(nullptr, nullptr, plist_field.second));
+        }
+
+        ordered_token_its.emplace_back(its);
+    }
+
+    result_iter_state_t istate(exclude_token_ids, exclude_token_ids_size, filter_ids, filter_ids_length);
+
+    or_iterator_t::intersect(ordered_token_its, istate, [&](uint32_t seq_id, const std::vector<or_iterator_t>& its) {
+        ids.push_back(seq_id);
+    });
+}
+
 void Index::compute_sort_scores(const std::vector<sort_by>& sort_fields, const int* sort_order,
-                                std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3> field_values,
+                                std::array<sort_column_t*, 3> field_values,
                                 const std::vector<size_t>& geopoint_indices,
                                 uint32_t seq_id, int64_t max_field_match_score,
                                 int64_t* scores, int64_t& match_score_index) const {
@@ -3213,28 +4536,25 @@ void Index::compute_sort_scores(const std::vector<sort_by>& sort_fields, const i
     int64_t geopoint_distances[3];
 
     for(auto& i: geopoint_indices) {
-        spp::sparse_hash_map<uint32_t, int64_t>* geopoints = field_values[i];
+        sort_column_t* geopoints = field_values[i];
         int64_t dist = INT32_MAX;
 
         S2LatLng reference_lat_lng;
         GeoPoint::unpack_lat_lng(sort_fields[i].geopoint, reference_lat_lng);
 
         if(geopoints != nullptr) {
-            auto it = geopoints->find(seq_id);
+            int64_t packed_latlng;
 
-            if(it != geopoints->end()) {
-                int64_t packed_latlng = it->second;
+            if(geopoints->get(seq_id, packed_latlng)) {
                 S2LatLng s2_lat_lng;
                 GeoPoint::unpack_lat_lng(packed_latlng, s2_lat_lng);
                 dist = GeoPoint::distance(s2_lat_lng, reference_lat_lng);
             }
         } else {
             // indicates geo point array
-            auto field_it = geo_array_index.at(sort_fields[i].name);
-            auto it = field_it->find(seq_id);
+            const int64_t* latlngs = geo_array_index.at(sort_fields[i].name)->get(seq_id);
 
-            if(it != field_it->end()) {
-                int64_t* latlngs = it->second;
+            if(latlngs != nullptr) {
                 for(size_t li = 0; li < latlngs[0]; li++) {
                     S2LatLng s2_lat_lng;
                     int64_t packed_latlng = latlngs[li + 1];
@@ -3287,8 +4607,9 @@ void Index::compute_sort_scores(const std::vector<sort_by>& sort_fields, const i
                 }
             }
         } else {
-            auto it = field_values[0]->find(seq_id);
-            scores[0] = (it == field_values[0]->end()) ? default_score : it->second;
+            if(!field_values[0]->get(seq_id, scores[0])) {
+                scores[0] = default_score;
+            }
 
             if(scores[0] == INT64_MIN && sort_fields[0].missing_values == sort_by::missing_values_t::first) {
                 // By default, missing numerical value are always going to be sorted to be at the end
@@ -3326,8 +4647,9 @@ void Index::compute_sort_scores(const std::vector<sort_by>& sort_fields, const i
                 }
             }
         } else {
-            auto it = field_values[1]->find(seq_id);
-            scores[1] = (it == field_values[1]->end()) ? default_score : it->second;
+            if(!field_values[1]->get(seq_id, scores[1])) {
+                scores[1] = default_score;
+            }
             if(scores[1] == INT64_MIN && sort_fields[1].missing_values == sort_by::missing_values_t::first) {
                 bool is_asc = (sort_order[1] == -1);
                 scores[1] = is_asc ? (INT64_MIN + 1) : INT64_MAX;
@@ -3361,8 +4683,9 @@ void Index::compute_sort_scores(const std::vector<sort_by>& sort_fields, const i
                 }
             }
         } else {
-            auto it = field_values[2]->find(seq_id);
-            scores[2] = (it == field_values[2]->end()) ? default_score : it->second;
+            if(!field_values[2]->get(seq_id, scores[2])) {
+                scores[2] = default_score;
+            }
             if(scores[2] == INT64_MIN && sort_fields[2].missing_values == sort_by::missing_values_t::first) {
                 bool is_asc = (sort_order[2] == -1);
                 scores[2] = is_asc ? (INT64_MIN + 1) : INT64_MAX;
@@ -3406,20 +4729,18 @@ void Index::do_phrase_search(const size_t num_search_fields, const std::vector<s
                 continue;
             }
 
-            std::vector<uint32_t> contains_ids;
-            posting_t::intersect(posting_lists, contains_ids);
+            std::vector<uint32_t> phrase_ids;
+            posting_t::phrase_intersect(posting_lists, is_array, phrase_ids);
 
-            uint32_t* this_phrase_ids = new uint32_t[contains_ids.size()];
-            size_t this_phrase_ids_size = 0;
-            posting_t::get_phrase_matches(posting_lists, is_array, &contains_ids[0], contains_ids.size(),
-                                          this_phrase_ids, this_phrase_ids_size);
-
-            if(this_phrase_ids_size == 0) {
+            if(phrase_ids.empty()) {
                 // no results found for this phrase, but other phrases can find results
-                delete [] this_phrase_ids;
                 continue;
             }
 
+            size_t this_phrase_ids_size = phrase_ids.size();
+            uint32_t* this_phrase_ids = new uint32_t[this_phrase_ids_size];
+            std::copy(phrase_ids.begin(), phrase_ids.end(), this_phrase_ids);
+
             // results of multiple phrases must be ANDed
 
             if(field_phrase_match_ids_size == 0) {
@@ -3492,15 +4813,18 @@ void Index::do_synonym_search(const std::vector<search_field_t>& the_fields,
                               Topster* actual_topster,
                               std::vector<std::vector<token_t>>& q_pos_synonyms,
                               int syn_orig_num_tokens,
-                              spp::sparse_hash_set<uint64_t>& groups_processed,
+                              group_counter_t& groups_processed,
                               std::vector<std::vector<art_leaf*>>& searched_queries,
                               uint32_t*& all_result_ids, size_t& all_result_ids_len,
                               const uint32_t* filter_ids, const uint32_t filter_ids_length,
                               std::set<uint64>& query_hashes,
+                              intersection_memo_t* intersection_memo,
                               const int* sort_order,
-                              std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
+                              std::array<sort_column_t*, 3>& field_values,
                               const std::vector<size_t>& geopoint_indices,
-                              tsl::htrie_map<char, token_leaf>& qtoken_set) const {
+                              tsl::htrie_map<char, token_leaf>& qtoken_set,
+                              const bool enable_top_k_pruning,
+                              query_plan_t* query_plan) const {
 
     for(const auto& syn_tokens: q_pos_synonyms) {
         query_hashes.clear();
@@ -3508,9 +4832,10 @@ void Index::do_synonym_search(const std::vector<search_field_t>& the_fields,
                             exclude_token_ids_size, filter_ids, filter_ids_length, curated_ids_sorted,
                             sort_fields_std, {0}, searched_queries, qtoken_set, actual_topster, groups_processed,
                             all_result_ids, all_result_ids_len, group_limit, group_by_fields, prioritize_exact_match,
-                            prioritize_token_position, query_hashes, token_order, prefixes, typo_tokens_threshold,
+                            prioritize_token_position, query_hashes, intersection_memo, token_order, prefixes, typo_tokens_threshold,
                             exhaustive_search, max_candidates, min_len_1typo,
-                            min_len_2typo, syn_orig_num_tokens, sort_order, field_values, geopoint_indices);
+                            min_len_2typo, syn_orig_num_tokens, sort_order, field_values, geopoint_indices,
+                            concurrency, enable_top_k_pruning, query_plan);
     }
 
     collate_included_ids({}, included_ids_map, curated_topster, searched_queries);
@@ -3525,16 +4850,23 @@ void Index::do_infix_search(const size_t num_search_fields, const std::vector<se
                             const std::vector<token_t>& query_tokens, Topster* actual_topster,
                             const uint32_t *filter_ids, size_t filter_ids_length,
                             const int sort_order[3],
-                            std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3> field_values,
+                            std::array<sort_column_t*, 3> field_values,
                             const std::vector<size_t>& geopoint_indices,
                             const std::vector<uint32_t>& curated_ids_sorted,
                             uint32_t*& all_result_ids, size_t& all_result_ids_len,
-                            spp::sparse_hash_set<uint64_t>& groups_processed) const {
+                            group_counter_t& groups_processed) const {
+
+    const std::vector<const sort_column_t*> group_columns = get_group_columns(group_by_fields);
 
     for(size_t field_id = 0; field_id < num_search_fields; field_id++) {
         auto& field_name = the_fields[field_id].name;
         enable_t field_infix = (field_id < infixes.size()) ? infixes[field_id] : infixes[0];
 
+        if(field_infix == fallback && all_result_ids_len == 0 && search_budget_spent(BUDGET_INFIX_SHARE)) {
+            search_degradations |= DEGRADED_INFIX;
+            continue;
+        }
+
         if(field_infix == always || (field_infix == fallback && all_result_ids_len == 0)) {
             std::vector<uint32_t> infix_ids;
             search_infix(query_tokens[0].value, field_name, infix_ids, max_extra_prefix, max_extra_suffix);
@@ -3583,7 +4915,7 @@ void Index::do_infix_search(const size_t num_search_fields, const std::vector<se
 
                     uint64_t distinct_id = seq_id;
                     if(group_limit != 0) {
-                        distinct_id = get_distinct_id(group_by_fields, seq_id);
+                        distinct_id = get_distinct_id(group_columns, seq_id);
                         groups_processed.emplace(distinct_id);
                     }
 
@@ -3634,33 +4966,58 @@ void Index::handle_exclusion(const size_t num_search_fields, std::vector<query_t
                 continue;
             }
 
-            std::vector<uint32_t> contains_ids;
-            posting_t::intersect(posting_lists, contains_ids);
+            // a single token is a phrase of its own
+            std::vector<uint32_t> phrase_ids;
+            posting_t::phrase_intersect(posting_lists, is_array, phrase_ids);
 
-            if(posting_lists.size() == 1) {
-                uint32_t *exclude_token_ids_merged = nullptr;
-                exclude_token_ids_size = ArrayUtils::or_scalar(exclude_token_ids, exclude_token_ids_size,
-                                                               &contains_ids[0], contains_ids.size(),
-                                                               &exclude_token_ids_merged);
-                delete [] exclude_token_ids;
-                exclude_token_ids = exclude_token_ids_merged;
-            } else {
-                uint32_t* phrase_ids = new uint32_t[contains_ids.size()];
-                size_t phrase_ids_size = 0;
+            uint32_t *exclude_token_ids_merged = nullptr;
+            exclude_token_ids_size = ArrayUtils::or_scalar(exclude_token_ids, exclude_token_ids_size,
+                                                           phrase_ids.data(), phrase_ids.size(),
+                                                           &exclude_token_ids_merged);
+            delete [] exclude_token_ids;
+            exclude_token_ids = exclude_token_ids_merged;
+        }
+    }
+}
 
-                posting_t::get_phrase_matches(posting_lists, is_array, &contains_ids[0], contains_ids.size(),
-                                              phrase_ids, phrase_ids_size);
+std::string Index::get_facet_cache_key(const std::vector<facet>& facets, const facet_query_t& facet_query,
+                                       const size_t facet_query_num_typos, const size_t max_candidates,
+                                       const size_t group_limit, const std::vector<std::string>& group_by_fields,
+                                       const size_t facet_sample_percent, const size_t facet_sample_threshold,
+                                       const uint32_t* all_result_ids, const size_t all_result_ids_len,
+                                       const std::vector<uint32_t>& included_ids_vec) {
+    std::string cache_key;
 
-                uint32_t *exclude_token_ids_merged = nullptr;
-                exclude_token_ids_size = ArrayUtils::or_scalar(exclude_token_ids, exclude_token_ids_size,
-                                                               phrase_ids, phrase_ids_size,
-                                                               &exclude_token_ids_merged);
-                delete [] phrase_ids;
-                delete [] exclude_token_ids;
-                exclude_token_ids = exclude_token_ids_merged;
-            }
+    for(const auto& a_facet: facets) {
+        cache_key += a_facet.field_name + '\0';
+
+        for(const auto& range: a_facet.ranges) {
+            cache_key += std::to_string(range.min) + ',' + std::to_string(range.max) + ',';
         }
     }
+
+    cache_key += '\0' + facet_query.field_name + '\0' + facet_query.query + '\0';
+    cache_key += std::to_string(facet_query_num_typos) + ',' + std::to_string(max_candidates) + ',' +
+                 std::to_string(group_limit) + ',' + std::to_string(facet_sample_percent) + ',' +
+                 std::to_string(facet_sample_threshold) + '\0';
+
+    for(const auto& group_by_field: group_by_fields) {
+        cache_key += group_by_field + '\0';
+    }
+
+    uint64_t ids_hash = 1;
+    for(size_t i = 0; i < all_result_ids_len; i++) {
+        ids_hash = StringUtils::hash_combine(ids_hash, all_result_ids[i]);
+    }
+
+    for(const auto& included_id: included_ids_vec) {
+        ids_hash = StringUtils::hash_combine(ids_hash, included_id);
+    }
+
+    cache_key += '\0' + std::to_string(all_result_ids_len) + ',' + std::to_string(included_ids_vec.size()) + ',' +
+                 std::to_string(ids_hash);
+
+    return cache_key;
 }
 
 void Index::compute_facet_infos(const std::vector<facet>& facets, facet_query_t& facet_query,
@@ -3709,6 +5066,16 @@ void Index::compute_facet_infos(const std::vector<facet>& facets, facet_query_t&
             Tokenizer(facet_query.query, true, !facet_field.is_string(),
                       facet_field.locale, symbols_to_index, token_separators).tokenize(query_tokens);
 
+            // the values are searched on their own first, which is all that is needed unless typos are allowed
+            const auto facet_value_index_it = facet_value_indices.find(a_facet.field_name);
+            if(facet_value_index_it != facet_value_indices.end()) {
+                facet_value_index_it->second->search(query_tokens, facet_infos[findex].hashes);
+
+                if(!facet_infos[findex].hashes.empty() || facet_query_num_typos == 0) {
+                    continue;
+                }
+            }
+
             std::vector<token_t> qtokens;
 
             for (size_t qtoken_index = 0; qtoken_index < query_tokens.size(); qtoken_index++) {
@@ -3719,7 +5086,7 @@ void Index::compute_facet_infos(const std::vector<facet>& facets, facet_query_t&
 
             std::vector<std::vector<art_leaf*>> searched_queries;
             Topster* topster = nullptr;
-            spp::sparse_hash_set<uint64_t> groups_processed;
+            group_counter_t groups_processed;
             uint32_t* field_result_ids = nullptr;
             size_t field_result_ids_len = 0;
             size_t field_num_results = 0;
@@ -3832,10 +5199,130 @@ void Index::curate_filtered_ids(const std::vector<filter>& filters, const std::s
     }
 }
 
+void Index::compute_geo_distances_batch(const sort_by& sort_field, const sort_column_t* geopoints,
+                                        const uint32_t* seq_ids, size_t num_ids, int64_t* distances) const {
+    S2LatLng reference_lat_lng;
+    GeoPoint::unpack_lat_lng(sort_field.geopoint, reference_lat_lng);
+
+    if(geopoints != nullptr) {
+        // INT64_MIN can't be a packed point: its latitude would be out of range
+        std::vector<int64_t> lat_lngs(num_ids);
+        geopoints->get_batch(seq_ids, num_ids, INT64_MIN, lat_lngs.data());
+        GeoPoint::distances(lat_lngs.data(), num_ids, reference_lat_lng, distances);
+
+        for(size_t j = 0; j < num_ids; j++) {
+            distances[j] = (lat_lngs[j] == INT64_MIN) ? INT32_MAX : distances[j];
+        }
+    } else {
+        // the points of all the ids are laid out back to back, so that their distances are computed in one go
+        const geo_points_column_t* geo_points_column = geo_array_index.at(sort_field.name);
+        std::vector<int64_t> lat_lngs;
+        std::vector<size_t> run_ends(num_ids);
+
+        for(size_t j = 0; j < num_ids; j++) {
+            const int64_t* run = geo_points_column->get(seq_ids[j]);
+            if(run != nullptr) {
+                lat_lngs.insert(lat_lngs.end(), run + 1, run + 1 + run[0]);
+            }
+            run_ends[j] = lat_lngs.size();
+        }
+
+        std::vector<int64_t> point_distances(lat_lngs.size());
+        GeoPoint::distances(lat_lngs.data(), lat_lngs.size(), reference_lat_lng, point_distances.data());
+
+        size_t run_start = 0;
+        for(size_t j = 0; j < num_ids; j++) {
+            int64_t dist = INT32_MAX;
+            for(size_t pi = run_start; pi < run_ends[j]; pi++) {
+                dist = std::min(dist, point_distances[pi]);
+            }
+
+            distances[j] = dist;
+            run_start = run_ends[j];
+        }
+    }
+
+    if(sort_field.exclude_radius > 0 || sort_field.geo_precision > 0) {
+        for(size_t j = 0; j < num_ids; j++) {
+            int64_t dist = distances[j];
+
+            if(dist < sort_field.exclude_radius) {
+                dist = 0;
+            }
+
+            if(sort_field.geo_precision > 0) {
+                dist = dist + sort_field.geo_precision - 1 -
+                       (dist + sort_field.geo_precision - 1) % sort_field.geo_precision;
+            }
+
+            distances[j] = dist;
+        }
+    }
+}
+
+void Index::compute_sort_scores_batch(const std::vector<sort_by>& sort_fields, const int* sort_order,
+                                      const std::array<sort_column_t*, 3>& field_values,
+                                      const std::vector<size_t>& geopoint_indices,
+                                      const uint32_t* seq_ids, size_t num_ids, int64_t max_field_match_score,
+                                      std::array<std::vector<int64_t>, 3>& field_scores,
+                                      int64_t& match_score_index) const {
+    for(size_t i = 0; i < 3; i++) {
+        std::vector<int64_t>& scores = field_scores[i];
+        scores.resize(num_ids);
+
+        if(i >= sort_fields.size()) {
+            std::fill(scores.begin(), scores.end(), 0);
+            continue;
+        }
+
+        const bool is_geo_field = std::find(geopoint_indices.begin(), geopoint_indices.end(), i) !=
+                                  geopoint_indices.end();
+
+        if(is_geo_field) {
+            compute_geo_distances_batch(sort_fields[i], field_values[i], seq_ids, num_ids, scores.data());
+        } else if(field_values[i] == &text_match_sentinel_value) {
+            std::fill(scores.begin(), scores.end(), max_field_match_score);
+            match_score_index = i;
+        } else if(field_values[i] == &seq_id_sentinel_value) {
+            std::copy(seq_ids, seq_ids + num_ids, scores.begin());
+        } else if(field_values[i] == &str_sentinel_value) {
+            adi_tree_t* str_tree = str_sort_index.at(sort_fields[i].name);
+            const bool negate_missing =
+                    (sort_fields[i].order == sort_field_const::asc &&
+                     sort_fields[i].missing_values == sort_by::missing_values_t::first) ||
+                    (sort_fields[i].order == sort_field_const::desc &&
+                     sort_fields[i].missing_values == sort_by::missing_values_t::last);
+
+            for(size_t j = 0; j < num_ids; j++) {
+                scores[j] = str_tree->rank(seq_ids[j]);
+                if(scores[j] == adi_tree_t::NOT_FOUND && negate_missing) {
+                    scores[j] = -scores[j];
+                }
+            }
+        } else {
+            field_values[i]->get_batch(seq_ids, num_ids, INT64_MIN, scores.data());
+
+            if(sort_fields[i].missing_values == sort_by::missing_values_t::first) {
+                const int64_t missing_score = (sort_order[i] == -1) ? (INT64_MIN + 1) : INT64_MAX;
+                for(size_t j = 0; j < num_ids; j++) {
+                    scores[j] = (scores[j] == INT64_MIN) ? missing_score : scores[j];
+                }
+            }
+        }
+
+        if(sort_order[i] == -1) {
+            // wraps INT64_MIN around to itself, like the negation in `compute_sort_scores()`
+            for(size_t j = 0; j < num_ids; j++) {
+                scores[j] = int64_t(-uint64_t(scores[j]));
+            }
+        }
+    }
+}
+
 void Index::search_wildcard(const std::vector<filter>& filters,
                             const std::map<size_t, std::map<size_t, uint32_t>>& included_ids_map,
                             const std::vector<sort_by>& sort_fields, Topster* topster, Topster* curated_topster,
-                            spp::sparse_hash_set<uint64_t>& groups_processed,
+                            group_counter_t& groups_processed,
                             std::vector<std::vector<art_leaf*>>& searched_queries, const size_t group_limit,
                             const std::vector<std::string>& group_by_fields, const std::set<uint32_t>& curated_ids,
                             const std::vector<uint32_t>& curated_ids_sorted, const uint32_t* exclude_token_ids,
@@ -3843,21 +5330,86 @@ void Index::search_wildcard(const std::vector<filter>& filters,
                             uint32_t*& all_result_ids, size_t& all_result_ids_len, const uint32_t* filter_ids,
                             uint32_t filter_ids_length, const size_t concurrency,
                             const int* sort_order,
-                            std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values,
+                            std::array<sort_column_t*, 3>& field_values,
                             const std::vector<size_t>& geopoint_indices) const {
 
-    uint32_t token_bits = 0;
-    const bool check_for_circuit_break = (filter_ids_length > 1000000);
+    uint32_t token_bits = 0;
+    const bool check_for_circuit_break = (filter_ids_length > 1000000);
+
+    // a string sort over many ids is cheaper with the ranks laid out by seq_id than with a tree walk per id
+    for(size_t i = 0; i < sort_fields.size(); i++) {
+        if(field_values[i] == &str_sentinel_value) {
+            str_sort_index.at(sort_fields[i].name)->materialize_ranks(filter_ids_length);
+        }
+    }
+
+    // when the hits are ranked by distance first, only the ids closest to the reference point can make it into the
+    // topster (ties on distance included, for the other sort fields to break), so the rest need not be scored
+    const uint32_t* score_ids = filter_ids;
+    size_t score_ids_length = filter_ids_length;
+    std::vector<uint32_t> nearest_ids;
+
+    if(!geopoint_indices.empty() && geopoint_indices[0] == 0 && sort_order[0] == -1 &&
+       sort_fields[0].exclude_radius == 0 && sort_fields[0].geo_precision == 0 &&
+       group_limit == 0 && topster->get_search_after() == nullptr &&
+       filter_ids_length > topster->MAX_SIZE * GEO_NEAREST_MIN_RATIO) {
+        const auto geo_index_it = geopoint_index.find(sort_fields[0].name);
+
+        if(geo_index_it != geopoint_index.end()) {
+            S2LatLng reference_lat_lng;
+            GeoPoint::unpack_lat_lng(sort_fields[0].geopoint, reference_lat_lng);
+            geo_index_it->second->nearest(reference_lat_lng, topster->MAX_SIZE, filter_ids, filter_ids_length,
+                                          nearest_ids);
+
+            // ids without a point sort last but still fill up the topster when there are not enough points
+            if(nearest_ids.size() >= topster->MAX_SIZE) {
+                score_ids = nearest_ids.data();
+                score_ids_length = nearest_ids.size();
+            }
+        }
+    }
+
+    // likewise, when they are ranked by a numerical field first (after the text match, which is the same for all of
+    // them), the ids with its top values are read off the tree of the field in the order of the values, stopping as
+    // soon as they fill up the topster
+    const size_t rank_index = (sort_fields.size() > 1 && field_values[0] == &text_match_sentinel_value) ? 1 : 0;
+    std::vector<uint32_t> top_value_ids;
+
+    if(score_ids == filter_ids && rank_index < sort_fields.size() && field_values[rank_index] != nullptr &&
+       field_values[rank_index] != &text_match_sentinel_value && field_values[rank_index] != &seq_id_sentinel_value &&
+       field_values[rank_index] != &str_sentinel_value &&
+       std::find(geopoint_indices.begin(), geopoint_indices.end(), rank_index) == geopoint_indices.end() &&
+       sort_fields[rank_index].missing_values == sort_by::missing_values_t::normal &&
+       group_limit == 0 && topster->get_search_after() == nullptr &&
+       filter_ids_length > topster->MAX_SIZE * SORTED_TOP_IDS_MIN_RATIO) {
+        const std::string& rank_field_name = sort_fields[rank_index].name;
+        const auto num_tree_it = numerical_index.find(rank_field_name);
+
+        if(num_tree_it != numerical_index.end() && !search_schema.at(rank_field_name).is_array()) {
+            // past half of the ids, walking the tree costs more than scoring all of them
+            const bool found = num_tree_it->second->top_ids(sort_order[rank_index] == -1, topster->MAX_SIZE,
+                                                            filter_ids, filter_ids_length, filter_ids_length / 2,
+                                                            top_value_ids);
+
+            // ids without a value sort last but still fill up the topster when there are not enough values
+            if(found && top_value_ids.size() >= topster->MAX_SIZE) {
+                gfx::timsort(top_value_ids.begin(), top_value_ids.end());
+                score_ids = top_value_ids.data();
+                score_ids_length = top_value_ids.size();
+            }
+        }
+    }
 
     //auto beginF = std::chrono::high_resolution_clock::now();
 
-    const size_t num_threads = std::min<size_t>(concurrency, filter_ids_length);
+    const size_t num_threads = std::min<size_t>(concurrency, score_ids_length);
     const size_t window_size = (num_threads == 0) ? 0 :
-                               (filter_ids_length + num_threads - 1) / num_threads;  // rounds up
+                               (score_ids_length + num_threads - 1) / num_threads;  // rounds up
 
-    spp::sparse_hash_set<uint64_t> tgroups_processed[num_threads];
+    group_counter_t tgroups_processed[num_threads];
+    search_arena_scope_t arena_scope;
     Topster* topsters[num_threads];
-    std::vector<posting_list_t::iterator_t> plists;
+    const std::vector<const sort_column_t*> group_columns = get_group_columns(group_by_fields);
 
     size_t num_processed = 0;
     std::mutex m_process;
@@ -3869,61 +5421,97 @@ void Index::search_wildcard(const std::vector<filter>& filters,
     const auto parent_search_begin = search_begin;
     const auto parent_search_stop_ms = search_stop_ms;
     auto parent_search_cutoff = search_cutoff;
+    auto parent_search_cancel_token = search_cancel_token;
+    auto parent_search_profile = search_profile;
 
-    for(size_t thread_id = 0; thread_id < num_threads && filter_index < filter_ids_length; thread_id++) {
+    for(size_t thread_id = 0; thread_id < num_threads && filter_index < score_ids_length; thread_id++) {
         size_t batch_res_len = window_size;
 
-        if(filter_index + window_size > filter_ids_length) {
-            batch_res_len = filter_ids_length - filter_index;
+        if(filter_index + window_size > score_ids_length) {
+            batch_res_len = score_ids_length - filter_index;
         }
 
-        const uint32_t* batch_result_ids = filter_ids + filter_index;
+        const uint32_t* batch_result_ids = score_ids + filter_index;
         num_queued++;
 
         searched_queries.push_back({});
 
-        topsters[thread_id] = new Topster(topster->MAX_SIZE, topster->distinct);
+        topsters[thread_id] = new Topster(topster->MAX_SIZE, topster->distinct, search_arena);
+        topsters[thread_id]->groups.set_max_groups(topster->groups.get_max_groups());
+        topsters[thread_id]->set_search_after(topster->get_search_after());
 
-        thread_pool->enqueue([this, &parent_search_begin, &parent_search_stop_ms, &parent_search_cutoff,
-                             thread_id, &sort_fields, &searched_queries, &field_id,
-                             &group_limit, &group_by_fields, &topsters, &tgroups_processed,
-                             &sort_order, field_values, &geopoint_indices, &plists,
-                             check_for_circuit_break,
-                             batch_result_ids, batch_res_len,
-                             &num_processed, &m_process, &cv_process]() {
+        thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::SEARCH,
+                                  [this, &parent_search_begin, &parent_search_stop_ms, &parent_search_cutoff,
+                                  parent_search_cancel_token, parent_search_profile, thread_id, &sort_fields,
+                                  &searched_queries, &field_id,
+                                  &group_limit, &group_columns, &topsters, &tgroups_processed,
+                                  &sort_order, field_values, &geopoint_indices,
+                                  check_for_circuit_break,
+                                  batch_result_ids, batch_res_len,
+                                  &num_processed, &m_process, &cv_process]() {
 
             search_begin = parent_search_begin;
             search_stop_ms = parent_search_stop_ms;
             search_cutoff = parent_search_cutoff;
+            search_cancel_token = parent_search_cancel_token;
+            search_profile = parent_search_profile;
+
+            Topster* thread_topster = topsters[thread_id];
 
-            for(size_t i = 0; i < batch_res_len; i++) {
-                const uint32_t seq_id = batch_result_ids[i];
-                int64_t match_score = 0;
+            std::array<std::vector<int64_t>, 3> field_scores;
+            uint32_t survivors[SORT_BATCH_SIZE];
 
-                score_results2(sort_fields, (uint16_t) searched_queries.size(), 0, false, 0,
-                               match_score, seq_id, sort_order, false, false, false, 1, -1, plists);
+            for(size_t block_start = 0; block_start < batch_res_len; block_start += SORT_BATCH_SIZE) {
+                const size_t block_len = std::min(SORT_BATCH_SIZE, batch_res_len - block_start);
+                const uint32_t* block_ids = batch_result_ids + block_start;
 
-                int64_t scores[3] = {0};
                 int64_t match_score_index = 0;
+                size_t num_survivors = 0;
 
-                compute_sort_scores(sort_fields, sort_order, field_values, geopoint_indices, seq_id,
-                                    100, scores, match_score_index);
+                compute_sort_scores_batch(sort_fields, sort_order, field_values, geopoint_indices,
+                                          block_ids, block_len, 100, field_scores, match_score_index);
 
-                uint64_t distinct_id = seq_id;
-                if(group_limit != 0) {
-                    distinct_id = get_distinct_id(group_by_fields, seq_id);
-                    tgroups_processed[thread_id].emplace(distinct_id);
+                // once the topster is full, an id that scores below its smallest entry on the first sort
+                // field can't make it in
+                const KV* threshold = thread_topster->get_threshold();
+                const int64_t min_score = (threshold != nullptr) ? threshold->scores[0] : INT64_MIN;
+                const int64_t* first_scores = field_scores[0].data();
+
+                for(size_t j = 0; j < block_len; j++) {
+                    survivors[num_survivors] = j;
+                    num_survivors += (first_scores[j] >= min_score);
                 }
 
-                KV kv(0, searched_queries.size(), 0, seq_id, distinct_id, match_score_index, scores);
-                topsters[thread_id]->add(&kv);
+                for(size_t s = 0; s < num_survivors; s++) {
+                    const size_t j = survivors[s];
+                    const uint32_t seq_id = block_ids[j];
+                    int64_t scores[3] = {field_scores[0][j], field_scores[1][j], field_scores[2][j]};
+
+                    uint64_t distinct_id = seq_id;
+                    if(group_limit != 0) {
+                        distinct_id = get_distinct_id(group_columns, seq_id);
+                        tgroups_processed[thread_id].emplace(distinct_id);
+                    }
+
+                    KV kv(0, searched_queries.size(), 0, seq_id, distinct_id, match_score_index, scores);
+                    if(thread_topster->distinct) {
+                        thread_topster->add(&kv);
+                    } else {
+                        // wildcard ids are unique, so KVs can be gathered up and merged into the heap in bulk
+                        thread_topster->add_buffered(&kv);
+                    }
+                }
 
-                if(check_for_circuit_break && ((i + 1) % (1 << 15)) == 0) {
+                if(check_for_circuit_break && ((block_start + block_len) % (1 << 15)) == 0) {
                     // check only once every 2^15 docs to reduce overhead
                     BREAK_CIRCUIT_BREAKER
                 }
             }
 
+            thread_topster->flush();
+            search_cancel_token = nullptr;
+            search_profile = nullptr;
+
             std::unique_lock<std::mutex> lock(m_process);
             num_processed++;
             parent_search_cutoff = parent_search_cutoff || search_cutoff;
@@ -3939,7 +5527,7 @@ void Index::search_wildcard(const std::vector<filter>& filters,
     search_cutoff = parent_search_cutoff;
 
     for(size_t thread_id = 0; thread_id < num_processed; thread_id++) {
-        groups_processed.insert(tgroups_processed[thread_id].begin(), tgroups_processed[thread_id].end());
+        groups_processed.merge(tgroups_processed[thread_id]);
         aggregate_topster(topster, topsters[thread_id]);
         delete topsters[thread_id];
     }
@@ -3957,9 +5545,142 @@ void Index::search_wildcard(const std::vector<filter>& filters,
     all_result_ids = new_all_result_ids;
 }
 
+void Index::search_vector(const vector_query_t& vector_query, const uint32_t* filter_ids,
+                          uint32_t filter_ids_length, bool is_filtered, const uint32_t* excluded_ids,
+                          size_t excluded_ids_size, std::vector<std::pair<float, uint32_t>>& dist_ids) const {
+    const auto vector_index_it = vector_index.find(vector_query.field_name);
+    if(vector_index_it == vector_index.end()) {
+        return ;
+    }
+
+    const vector_index_t* field_vector_index = vector_index_it->second;
+
+    if(is_filtered && filter_ids_length <= VECTOR_EXACT_SEARCH_MAX_IDS) {
+        uint32_t* allowed_ids = nullptr;
+        const size_t allowed_ids_length = ArrayUtils::exclude_scalar(filter_ids, filter_ids_length, excluded_ids,
+                                                                     excluded_ids_size, &allowed_ids);
+
+        field_vector_index->distances(vector_query.values.data(), allowed_ids, allowed_ids_length, dist_ids);
+        delete [] allowed_ids;
+
+        const size_t k = std::min(vector_query.k, dist_ids.size());
+        std::partial_sort(dist_ids.begin(), dist_ids.begin() + k, dist_ids.end());
+        dist_ids.resize(k);
+        return ;
+    }
+
+    std::function<bool(uint32_t)> is_allowed;
+
+    if(is_filtered || excluded_ids_size != 0) {
+        is_allowed = [&](uint32_t seq_id) {
+            return (!is_filtered || std::binary_search(filter_ids, filter_ids + filter_ids_length, seq_id)) &&
+                   !std::binary_search(excluded_ids, excluded_ids + excluded_ids_size, seq_id);
+        };
+    }
+
+    field_vector_index->search(vector_query.values.data(), vector_query.k, is_allowed, dist_ids);
+}
+
+void Index::add_vector_hits(const vector_query_t& vector_query,
+                            const std::vector<std::pair<float, uint32_t>>& dist_ids, bool fuse_text_hits,
+                            const std::vector<sort_by>& sort_fields, const int* sort_order,
+                            const std::array<sort_column_t*, 3>& field_values,
+                            const std::vector<size_t>& geopoint_indices, Topster* topster,
+                            std::vector<std::vector<art_leaf*>>& searched_queries,
+                            uint32_t*& all_result_ids, size_t& all_result_ids_len) const {
+    int text_match_index = -1;
+    for(size_t i = 0; i < sort_fields.size(); i++) {
+        if(field_values[i] == &text_match_sentinel_value) {
+            text_match_index = i;
+            break;
+        }
+    }
+
+    std::vector<KV> kvs;
+    std::unordered_set<uint32_t> text_hit_ids;
+
+    if(fuse_text_hits) {
+        // reciprocal rank fusion: a hit scores `(1 - alpha) / text rank + alpha / vector rank`, where a hit that is
+        // missing from a list does not score for it
+        std::unordered_map<uint32_t, size_t> vector_ranks;
+        for(size_t i = 0; i < dist_ids.size(); i++) {
+            vector_ranks.emplace(dist_ids[i].second, i + 1);
+        }
+
+        topster->sort();
+
+        for(uint32_t i = 0; i < topster->size; i++) {
+            const KV* text_kv = topster->getKV(i);
+            kvs.emplace_back(text_kv->field_id, text_kv->query_index, text_kv->token_bits, text_kv->key,
+                             text_kv->distinct_key, text_kv->match_score_index, text_kv->scores);
+            text_hit_ids.insert(text_kv->key);
+
+            if(text_match_index == -1) {
+                continue;
+            }
+
+            double fused_score = (1 - vector_query.alpha) / (i + 1);
+            const auto vector_rank_it = vector_ranks.find(text_kv->key);
+            if(vector_rank_it != vector_ranks.end()) {
+                fused_score += vector_query.alpha / vector_rank_it->second;
+            }
+
+            kvs.back().scores[text_match_index] = sort_order[text_match_index] *
+                                                  int64_t(fused_score * VECTOR_SCORE_SCALE);
+        }
+
+        topster->clear();
+    }
+
+    searched_queries.push_back({});
+    const uint16_t query_index = searched_queries.size() - 1;
+    std::vector<uint32_t> vector_ids;
+
+    for(size_t i = 0; i < dist_ids.size(); i++) {
+        const uint32_t seq_id = dist_ids[i].second;
+        vector_ids.push_back(seq_id);
+
+        if(text_hit_ids.count(seq_id) != 0) {
+            continue;
+        }
+
+        const double vector_score = fuse_text_hits ? vector_query.alpha / (i + 1) : (1 - dist_ids[i].first);
+
+        int64_t scores[3] = {0};
+        int64_t match_score_index = 0;
+        compute_sort_scores(sort_fields, sort_order, field_values, geopoint_indices, seq_id,
+                            int64_t(vector_score * VECTOR_SCORE_SCALE), scores, match_score_index);
+
+        kvs.emplace_back(0, query_index, 0, seq_id, seq_id, match_score_index, scores);
+    }
+
+    for(auto& kv: kvs) {
+        topster->add(&kv);
+    }
+
+    std::sort(vector_ids.begin(), vector_ids.end());
+
+    uint32_t* new_all_result_ids = nullptr;
+    all_result_ids_len = ArrayUtils::or_scalar(all_result_ids, all_result_ids_len, vector_ids.data(),
+                                               vector_ids.size(), &new_all_result_ids);
+    delete [] all_result_ids;
+    all_result_ids = new_all_result_ids;
+}
+
+bool Index::get_vector_distance(const vector_query_t& vector_query, uint32_t seq_id, float& distance) const {
+    std::shared_lock lock(mutex);
+
+    const auto vector_index_it = vector_index.find(vector_query.field_name);
+    if(vector_index_it == vector_index.end()) {
+        return false;
+    }
+
+    return vector_index_it->second->distance(vector_query.values.data(), seq_id, distance);
+}
+
 void Index::populate_sort_mapping(int* sort_order, std::vector<size_t>& geopoint_indices,
                                   const std::vector<sort_by>& sort_fields_std,
-                                  std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3>& field_values) const {
+                                  std::array<sort_column_t*, 3>& field_values) const {
     for (size_t i = 0; i < sort_fields_std.size(); i++) {
         sort_order[i] = 1;
         if (sort_fields_std[i].order == sort_field_const::asc) {
@@ -3996,6 +5717,283 @@ void Index::populate_sort_mapping(int* sort_order, std::vector<size_t>& geopoint
    4. Intersect the lists to find docs that match each phrase
    5. Sort the docs based on some ranking criteria
 */
+void Index::search_token_leaves(const std::string& field_name, const std::string& token, const size_t token_len,
+                                const int cost, const size_t max_words, const token_ordering token_order,
+                                const bool prefix_search, const uint32_t* filter_ids, const size_t filter_ids_length,
+                                std::vector<art_leaf*>& leaves, const std::set<std::string>& exclude_leaves) const {
+    art_tree* tree = search_index.at(field_name);
+
+    const std::string cache_key = field_name + '\0' + token + '\0' + std::to_string(cost) + '\0' +
+                                  std::to_string(prefix_search) + std::to_string(token_order) + '\0' +
+                                  std::to_string(max_words);
+
+    token_leaves_t token_leaves;
+    bool found = false;
+
+    {
+        std::unique_lock lock(token_leaves_cache_mutex);
+        auto hit_it = token_leaves_cache.find(cache_key);
+        if(hit_it != token_leaves_cache.end() && hit_it.value().tree_version == tree->version) {
+            token_leaves = hit_it.value();
+            found = true;
+        }
+    }
+
+    if(filter_ids_length != 0) {
+        if(!found || !token_leaves.complete) {
+            art_fuzzy_search(tree, (const unsigned char *) token.c_str(), token_len, cost, cost, max_words,
+                             token_order, prefix_search, filter_ids, filter_ids_length, leaves, exclude_leaves);
+            return;
+        }
+
+        // all the leaves of the token are cached, in the order that a filtered search would find them in, so the
+        // candidates of an unfiltered search of the token are shared by searches of it with any filter
+        size_t num_kept = 0;
+
+        for(size_t i = 0; i < token_leaves.leaves.size(); i++) {
+            art_leaf* leaf = token_leaves.leaves[i];
+            const bool is_exact = (i == 0 && leaf->key_len - 1 == token.size() &&
+                                   memcmp(leaf->key, token.c_str(), token.size()) == 0);
+
+            if(is_exact || posting_t::contains_atleast_one(leaf->values, filter_ids, filter_ids_length)) {
+                token_leaves.leaves[num_kept++] = leaf;
+            }
+        }
+
+        token_leaves.leaves.resize(num_kept);
+    } else if(!found) {
+        art_fuzzy_search(tree, (const unsigned char *) token.c_str(), token_len, cost, cost, max_words, token_order,
+                         prefix_search, nullptr, 0, token_leaves.leaves);
+
+        token_leaves.tree_version = tree->version;
+        token_leaves.complete = (token_leaves.leaves.size() < max_words);
+
+        if(token_leaves.leaves.size() <= TOKEN_LEAVES_CACHE_MAX_LEAVES) {
+            std::unique_lock lock(token_leaves_cache_mutex);
+            token_leaves_cache.insert(cache_key, token_leaves);
+        }
+    }
+
+    // the exact match is placed first and is never excluded
+    art_leaf* exact_leaf = nullptr;
+    size_t leaf_index = 0;
+
+    if(!token_leaves.leaves.empty()) {
+        art_leaf* first_leaf = token_leaves.leaves[0];
+        if(first_leaf->key_len - 1 == token.size() && memcmp(first_leaf->key, token.c_str(), token.size()) == 0) {
+            exact_leaf = first_leaf;
+            leaf_index = 1;
+        }
+    }
+
+    std::vector<art_leaf*> matched_leaves;
+
+    for(; leaf_index < token_leaves.leaves.size(); leaf_index++) {
+        art_leaf* leaf = token_leaves.leaves[leaf_index];
+        std::string tok(reinterpret_cast<char*>(leaf->key), leaf->key_len - 1);
+        if(exclude_leaves.count(tok) == 0) {
+            matched_leaves.push_back(leaf);
+        } else if(!token_leaves.complete) {
+            // leaves beyond the truncated ones would take the place of this excluded leaf
+            art_fuzzy_search(tree, (const unsigned char *) token.c_str(), token_len, cost, cost, max_words,
+                             token_order, prefix_search, nullptr, 0, leaves, exclude_leaves);
+            return;
+        }
+    }
+
+    // same as the leaves that `art_fuzzy_search` would have appended to `leaves`
+    const size_t num_appended = (leaves.size() < max_words) ? std::min(max_words - leaves.size(),
+                                                                       matched_leaves.size()) : 0;
+    leaves.insert(leaves.end(), matched_leaves.begin(), matched_leaves.begin() + num_appended);
+
+    if(exact_leaf != nullptr) {
+        leaves.insert(leaves.begin(), exact_leaf);
+    }
+
+    if(leaves.size() > max_words) {
+        leaves.resize(max_words);
+    }
+}
+
+void Index::search_vocabulary_leaves(const std::vector<search_field_t>& the_fields, const size_t num_search_fields,
+                                     const token_t& token, const int cost, const std::vector<uint32_t>& num_typos,
+                                     const std::vector<bool>& prefixes, const size_t max_words,
+                                     const token_ordering token_order,
+                                     const uint32_t* filter_ids, const size_t filter_ids_length,
+                                     std::vector<art_leaf*>& leaves,
+                                     const std::set<std::string>& exclude_leaves) const {
+    const std::string& token_str = token.value;
+
+    // the fields that the token is looked for in at this cost, with whether they search it as a prefix
+    std::vector<std::pair<size_t, bool>> field_prefix_searches;
+    bool searched_as[2] = {false, false};
+
+    for(size_t field_id = 0; field_id < num_search_fields; field_id++) {
+        auto& the_field = the_fields[field_id];
+        int64_t field_num_typos = (field_id < num_typos.size()) ? num_typos[field_id] : num_typos[0];
+
+        auto& locale = search_schema.at(the_field.name).locale;
+        if(locale != "" && locale != "en" && !Tokenizer::is_cyrillic(locale)) {
+            // disable fuzzy trie traversal for non-english locales
+            field_num_typos = 0;
+        }
+
+        if(cost > field_num_typos) {
+            continue;
+        }
+
+        const bool field_prefix = (field_id < prefixes.size()) ? prefixes[field_id] : prefixes[0];
+        const bool prefix_search = field_prefix && token.is_prefix_searched;
+
+        field_prefix_searches.emplace_back(field_id, prefix_search);
+        searched_as[prefix_search] = true;
+    }
+
+    std::vector<art_leaf*> vocabulary_leaves[2];
+
+    for(int prefix_search = 0; prefix_search < 2; prefix_search++) {
+        if(!searched_as[prefix_search]) {
+            continue;
+        }
+
+        const size_t token_len = prefix_search ? token_str.length() : token_str.length() + 1;
+        art_fuzzy_search(vocabulary, (const unsigned char *) token_str.c_str(), token_len, cost, cost, max_words,
+                         token_order, prefix_search, nullptr, 0, vocabulary_leaves[prefix_search], exclude_leaves);
+    }
+
+    std::vector<art_leaf*> field_leaves;
+
+    for(const auto& field_prefix_search: field_prefix_searches) {
+        const std::string& field_name = the_fields[field_prefix_search.first].name;
+        const auto vocabulary_field_it = vocabulary_field_ids.find(field_name);
+        const auto tree_it = search_index.find(field_name);
+
+        if(vocabulary_field_it == vocabulary_field_ids.end() || tree_it == search_index.end()) {
+            continue;
+        }
+
+        field_leaves.clear();
+
+        for(art_leaf* vocabulary_leaf: vocabulary_leaves[field_prefix_search.second]) {
+            if(!posting_t::contains(vocabulary_leaf->values, vocabulary_field_it->second)) {
+                continue;
+            }
+
+            art_leaf* leaf = static_cast<art_leaf*>(art_search(tree_it->second, vocabulary_leaf->key,
+                                                               vocabulary_leaf->key_len));
+            if(leaf == nullptr) {
+                continue;
+            }
+
+            // the exact match is never filtered out
+            const bool is_exact = (leaf->key_len - 1 == token_str.size() &&
+                                   memcmp(leaf->key, token_str.c_str(), token_str.size()) == 0);
+
+            if(filter_ids_length != 0 && !is_exact &&
+               !posting_t::contains_atleast_one(leaf->values, filter_ids, filter_ids_length)) {
+                continue;
+            }
+
+            field_leaves.push_back(leaf);
+        }
+
+        // the vocabulary ranks tokens over all the fields, so they are ranked again within this one, after the
+        // exact match that comes first
+        auto ranked_begin = field_leaves.begin();
+        if(!field_leaves.empty() && field_leaves[0]->key_len - 1 == token_str.size() &&
+           memcmp(field_leaves[0]->key, token_str.c_str(), token_str.size()) == 0) {
+            ranked_begin++;
+        }
+
+        if(token_order == FREQUENCY) {
+            std::stable_sort(ranked_begin, field_leaves.end(), [](const art_leaf* a, const art_leaf* b) {
+                return posting_t::num_ids(a->values) > posting_t::num_ids(b->values);
+            });
+        } else if(token_order == MAX_SCORE) {
+            std::stable_sort(ranked_begin, field_leaves.end(), [](const art_leaf* a, const art_leaf* b) {
+                return a->max_score > b->max_score;
+            });
+        }
+
+        const size_t num_appended = std::min(max_words, field_leaves.size());
+        leaves.insert(leaves.end(), field_leaves.begin(), field_leaves.begin() + num_appended);
+    }
+}
+
+void Index::add_to_vocabulary(const std::string& field_name, const unsigned char* key, int key_len, int64_t score) {
+    const auto vocabulary_field_it = vocabulary_field_ids.find(field_name);
+    if(vocabulary == nullptr || vocabulary_field_it == vocabulary_field_ids.end()) {
+        return;
+    }
+
+    const uint32_t vocabulary_field_id = vocabulary_field_it->second;
+    art_leaf* leaf = static_cast<art_leaf*>(art_search(vocabulary, key, key_len));
+
+    if(leaf != nullptr && posting_t::contains(leaf->values, vocabulary_field_id)) {
+        leaf->max_score = std::max(leaf->max_score, score);
+        return;
+    }
+
+    art_document art_doc(vocabulary_field_id, score, {1});
+    art_insert(vocabulary, key, key_len, &art_doc);
+}
+
+void Index::remove_from_vocabulary(const std::string& field_name, const unsigned char* key, int key_len) {
+    const auto vocabulary_field_it = vocabulary_field_ids.find(field_name);
+    if(vocabulary == nullptr || vocabulary_field_it == vocabulary_field_ids.end()) {
+        return;
+    }
+
+    art_leaf* leaf = static_cast<art_leaf*>(art_search(vocabulary, key, key_len));
+    if(leaf == nullptr) {
+        return;
+    }
+
+    posting_t::erase(leaf->values, vocabulary_field_it->second);
+
+    if(posting_t::num_ids(leaf->values) == 0) {
+        void* values = art_delete(vocabulary, key, key_len);
+        posting_t::destroy_list(values);
+    }
+}
+
+namespace {
+    struct vocabulary_tree_leaves_t {
+        std::vector<const art_leaf*> leaves;
+
+        static int add(void* data, const art_leaf* leaf) {
+            static_cast<vocabulary_tree_leaves_t*>(data)->leaves.push_back(leaf);
+            return 0;
+        }
+    };
+}
+
+void Index::add_tree_to_vocabulary(const std::string& field_name, art_tree* t) {
+    if(vocabulary == nullptr) {
+        return;
+    }
+
+    vocabulary_tree_leaves_t tree_leaves;
+    art_iter_leaves(t, vocabulary_tree_leaves_t::add, &tree_leaves);
+
+    for(const art_leaf* leaf: tree_leaves.leaves) {
+        add_to_vocabulary(field_name, leaf->key, leaf->key_len, leaf->max_score);
+    }
+}
+
+void Index::remove_tree_from_vocabulary(const std::string& field_name, art_tree* t) {
+    if(vocabulary == nullptr) {
+        return;
+    }
+
+    vocabulary_tree_leaves_t tree_leaves;
+    art_iter_leaves(t, vocabulary_tree_leaves_t::add, &tree_leaves);
+
+    for(const art_leaf* leaf: tree_leaves.leaves) {
+        remove_from_vocabulary(field_name, leaf->key, leaf->key_len);
+    }
+}
+
 void Index::search_field(const uint8_t & field_id,
                          const std::vector<token_t>& query_tokens,
                          const uint32_t* exclude_token_ids,
@@ -4008,7 +6006,7 @@ void Index::search_field(const uint8_t & field_id,
                          const int last_typo,
                          const int max_typos,
                          std::vector<std::vector<art_leaf*>> & searched_queries,
-                         Topster* topster, spp::sparse_hash_set<uint64_t>& groups_processed,
+                         Topster* topster, group_counter_t& groups_processed,
                          uint32_t** all_result_ids, size_t & all_result_ids_len, size_t& field_num_results,
                          const size_t group_limit, const std::vector<std::string>& group_by_fields,
                          bool prioritize_exact_match,
@@ -4108,9 +6106,8 @@ void Index::search_field(const uint8_t & field_id,
                 //auto begin = std::chrono::high_resolution_clock::now();
 
                 // need less candidates for filtered searches since we already only pick tokens with results
-                art_fuzzy_search(search_index.at(field_name), (const unsigned char *) token.c_str(), token_len,
-                                 costs[token_index], costs[token_index], max_candidates, token_order, prefix_search,
-                                 filter_ids, filter_ids_length, leaves, unique_tokens);
+                search_token_leaves(field_name, token, token_len, costs[token_index], max_candidates, token_order,
+                                    prefix_search, filter_ids, filter_ids_length, leaves, unique_tokens);
 
                 /*auto timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
                                 std::chrono::high_resolution_clock::now() - begin).count();
@@ -4207,15 +6204,22 @@ int64_t Index::score_results2(const std::vector<sort_by> & sort_fields, const ui
                           const bool prioritize_token_position,
                           size_t num_query_tokens,
                           int syn_orig_num_tokens,
-                          const std::vector<posting_list_t::iterator_t>& posting_lists) const {
+                          const std::vector<posting_list_t::iterator_t>& posting_lists,
+                          const sort_column_t* token_counts) const {
 
     //auto begin = std::chrono::high_resolution_clock::now();
     //const std::string first_token((const char*)query_suggestion[0]->key, query_suggestion[0]->key_len-1);
 
+    // number of tokens of the field in the document, when it is known
+    int64_t num_field_tokens = 0;
+    const bool has_num_field_tokens = (token_counts != nullptr && token_counts->get(seq_id, num_field_tokens));
+
     if (posting_lists.size() <= 1) {
+        // a field of a single token that the document has is matched verbatim by it
         const uint8_t is_verbatim_match = uint8_t(
             prioritize_exact_match && single_exact_query_token &&
-            posting_list_t::is_single_token_verbatim_match(posting_lists[0], field_is_array)
+            (has_num_field_tokens ? (num_field_tokens == 1) :
+                                    posting_list_t::is_single_token_verbatim_match(posting_lists[0], field_is_array))
         );
         size_t words_present = (num_query_tokens == 1 && syn_orig_num_tokens != -1) ? syn_orig_num_tokens : 1;
         size_t distance = (num_query_tokens == 1 && syn_orig_num_tokens != -1) ? syn_orig_num_tokens-1 : 0;
@@ -4250,7 +6254,11 @@ int64_t Index::score_results2(const std::vector<sort_by> & sort_fields, const ui
                 continue;
             }
 
-            const Match &match = Match(seq_id, token_positions, false, prioritize_exact_match);
+            // an exact match spans the whole field
+            const bool check_exact_match = prioritize_exact_match &&
+                                           (!has_num_field_tokens || size_t(num_field_tokens) == token_positions.size());
+
+            const Match &match = Match(seq_id, token_positions, false, check_exact_match);
             uint64_t this_match_score = match.get_match_score(total_cost, posting_lists.size());
 
             // Within a field, only a subset of query tokens can match (unique_words), but even a smaller set
@@ -4310,9 +6318,9 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const uint16
                           const uint8_t & field_id, const bool field_is_array, const uint32_t total_cost,
                           Topster* topster,
                           const std::vector<art_leaf *> &query_suggestion,
-                          spp::sparse_hash_set<uint64_t>& groups_processed,
+                          group_counter_t& groups_processed,
                           const uint32_t seq_id, const int sort_order[3],
-                          std::array<spp::sparse_hash_map<uint32_t, int64_t>*, 3> field_values,
+                          std::array<sort_column_t*, 3> field_values,
                           const std::vector<size_t>& geopoint_indices,
                           const size_t group_limit, const std::vector<std::string>& group_by_fields,
                           const uint32_t token_bits,
@@ -4324,28 +6332,25 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const uint16
     int64_t geopoint_distances[3];
 
     for(auto& i: geopoint_indices) {
-        spp::sparse_hash_map<uint32_t, int64_t>* geopoints = field_values[i];
+        sort_column_t* geopoints = field_values[i];
         int64_t dist = INT32_MAX;
 
         S2LatLng reference_lat_lng;
         GeoPoint::unpack_lat_lng(sort_fields[i].geopoint, reference_lat_lng);
 
         if(geopoints != nullptr) {
-            auto it = geopoints->find(seq_id);
+            int64_t packed_latlng;
 
-            if(it != geopoints->end()) {
-                int64_t packed_latlng = it->second;
+            if(geopoints->get(seq_id, packed_latlng)) {
                 S2LatLng s2_lat_lng;
                 GeoPoint::unpack_lat_lng(packed_latlng, s2_lat_lng);
                 dist = GeoPoint::distance(s2_lat_lng, reference_lat_lng);
             }
         } else {
             // indicates geo point array
-            auto field_it = geo_array_index.at(sort_fields[i].name);
-            auto it = field_it->find(seq_id);
+            const int64_t* latlngs = geo_array_index.at(sort_fields[i].name)->get(seq_id);
 
-            if(it != field_it->end()) {
-                int64_t* latlngs = it->second;
+            if(latlngs != nullptr) {
                 for(size_t li = 0; li < latlngs[0]; li++) {
                     S2LatLng s2_lat_lng;
                     int64_t packed_latlng = latlngs[li + 1];
@@ -4455,8 +6460,9 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const uint16
         } else if(field_values[0] == &str_sentinel_value) {
             scores[0] = str_sort_index.at(sort_fields[0].name)->rank(seq_id);
         } else {
-            auto it = field_values[0]->find(seq_id);
-            scores[0] = (it == field_values[0]->end()) ? default_score : it->second;
+            if(!field_values[0]->get(seq_id, scores[0])) {
+                scores[0] = default_score;
+            }
         }
 
         if (sort_order[0] == -1) {
@@ -4475,8 +6481,9 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const uint16
         } else if(field_values[1] == &str_sentinel_value) {
             scores[1] = str_sort_index.at(sort_fields[1].name)->rank(seq_id);
         } else {
-            auto it = field_values[1]->find(seq_id);
-            scores[1] = (it == field_values[1]->end()) ? default_score : it->second;
+            if(!field_values[1]->get(seq_id, scores[1])) {
+                scores[1] = default_score;
+            }
         }
 
         if (sort_order[1] == -1) {
@@ -4495,8 +6502,9 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const uint16
         } else if(field_values[2] == &str_sentinel_value) {
             scores[2] = str_sort_index.at(sort_fields[2].name)->rank(seq_id);
         } else {
-            auto it = field_values[2]->find(seq_id);
-            scores[2] = (it == field_values[2]->end()) ? default_score : it->second;
+            if(!field_values[2]->get(seq_id, scores[2])) {
+                scores[2] = default_score;
+            }
         }
 
         if (sort_order[2] == -1) {
@@ -4522,26 +6530,53 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const uint16
 // pre-filter group_by_fields such that we can avoid the find() check
 uint64_t Index::get_distinct_id(const std::vector<std::string>& group_by_fields,
                                 const uint32_t seq_id) const {
-    uint64_t distinct_id = 1; // some constant initial value
+    return get_distinct_id(get_group_columns(group_by_fields), seq_id);
+}
+
+std::vector<const sort_column_t*> Index::get_group_columns(const std::vector<std::string>& group_by_fields) const {
+    std::vector<const sort_column_t*> group_columns;
 
-    // calculate hash from group_by_fields
     for(const auto& field: group_by_fields) {
-        const auto& field_facet_mapping_it = facet_index_v3.find(field);
-        if(field_facet_mapping_it == facet_index_v3.end()) {
-            continue;
+        const auto group_column_it = group_hash_index.find(field);
+        if(group_column_it != group_hash_index.end()) {
+            group_columns.push_back(group_column_it->second);
         }
+    }
 
-        const auto& field_facet_mapping = field_facet_mapping_it->second;
-        const auto& facet_hashes_it = field_facet_mapping[seq_id % ARRAY_FACET_DIM]->find(seq_id);
+    return group_columns;
+}
 
-        if(facet_hashes_it == field_facet_mapping[seq_id % ARRAY_FACET_DIM]->end()) {
-            continue;
+const sort_column_t* Index::get_token_counts(const std::string& field_name) const {
+    const auto token_count_it = token_count_index.find(field_name);
+    return (token_count_it != token_count_index.end()) ? token_count_it->second : nullptr;
+}
+
+void Index::filter_by_token_count(const sort_column_t* token_counts, const size_t num_tokens,
+                                  uint32_t* ids, size_t& num_ids) {
+    if(token_counts == nullptr) {
+        return;
+    }
+
+    size_t num_kept = 0;
+
+    for(size_t i = 0; i < num_ids; i++) {
+        int64_t num_field_tokens;
+        if(!token_counts->get(ids[i], num_field_tokens) || size_t(num_field_tokens) == num_tokens) {
+            ids[num_kept++] = ids[i];
         }
+    }
+
+    num_ids = num_kept;
+}
 
-        const auto& facet_hashes = facet_hashes_it->second;
+uint64_t Index::get_distinct_id(const std::vector<const sort_column_t*>& group_columns, const uint32_t seq_id) {
+    uint64_t distinct_id = 1; // some constant initial value
 
-        for(size_t i = 0; i < facet_hashes.size(); i++) {
-            distinct_id = StringUtils::hash_combine(distinct_id, facet_hashes.hashes[i]);
+    // the facet values of each field are already hashed together at indexing time
+    for(const sort_column_t* group_column: group_columns) {
+        int64_t group_hash;
+        if(group_column->get(seq_id, group_hash)) {
+            distinct_id = StringUtils::hash_combine(distinct_id, uint64_t(group_hash));
         }
     }
 
@@ -4571,7 +6606,7 @@ inline uint32_t Index::next_suggestion2(const std::vector<tok_candidates>& token
 
         query_suggestion[i] = token_t(i, candidate, is_prefix_searched, token_size, token_candidates_vec[i].cost);
 
-        uint64_t this_hash = StringUtils::hash_wy(query_suggestion[i].value.c_str(), query_suggestion[i].value.size());
+        uint64_t this_hash = token_candidates_vec[i].candidate_hashes[q.rem];
         qhash = StringUtils::hash_combine(qhash, this_hash);
 
         /*LOG(INFO) << "suggestion key: " << actual_query_suggestion[i]->key << ", token: "
@@ -4627,7 +6662,37 @@ inline uint32_t Index::next_suggestion(const std::vector<token_candidates> &toke
     return total_cost;
 }
 
-void Index::remove_field(uint32_t seq_id, const nlohmann::json& document, const std::string& field_name) {
+void Index::erase_token_ids(const field& search_field, const std::string& token,
+                            const std::vector<uint32_t>& seq_ids) {
+    const unsigned char *key = (const unsigned char *) token.c_str();
+    int key_len = (int) (token.length() + 1);
+    art_tree* tree = search_index.at(search_field.name);
+
+    art_leaf* leaf = (art_leaf *) art_search(tree, key, key_len);
+    if(leaf == nullptr) {
+        return ;
+    }
+
+    posting_t::erase_sorted(leaf->values, seq_ids.size(), seq_ids.data());
+    tree->version++;
+
+    if(posting_t::num_ids(leaf->values) == 0) {
+        void* values = art_delete(tree, key, key_len);
+        posting_t::destroy_list(values);
+        remove_from_vocabulary(search_field.name, key, key_len);
+
+        // the token stays searchable by infix for as long as other documents have it
+        if(search_field.infix) {
+            infix_index.at(search_field.name)->erase(token);
+        }
+    } else if(posting_t::is_fragmented(leaf->values)) {
+        // repacked later, so that deleting many documents at once does not rewrite the same lists over and over
+        tokens_to_compact[search_field.name].insert(token);
+    }
+}
+
+void Index::remove_field(uint32_t seq_id, const nlohmann::json& document, const std::string& field_name,
+                         std::unordered_map<std::string, std::vector<uint32_t>>* token_seq_ids) {
     const auto& search_field_it = search_schema.find(field_name);
     if(search_field_it == search_schema.end()) {
         return;
@@ -4644,24 +6709,13 @@ void Index::remove_field(uint32_t seq_id, const nlohmann::json& document, const
         std::vector<std::string> tokens;
         tokenize_string_field(document, search_field, tokens, search_field.locale, symbols_to_index, token_separators);
 
-        for(size_t i = 0; i < tokens.size(); i++) {
-            const auto& token = tokens[i];
-            const unsigned char *key = (const unsigned char *) token.c_str();
-            int key_len = (int) (token.length() + 1);
-
-            art_leaf* leaf = (art_leaf *) art_search(search_index.at(field_name), key, key_len);
-            if(leaf != nullptr) {
-                posting_t::erase(leaf->values, seq_id);
-                if (posting_t::num_ids(leaf->values) == 0) {
-                    void* values = art_delete(search_index.at(field_name), key, key_len);
-                    posting_t::destroy_list(values);
-                }
-            }
+        const std::vector<uint32_t> seq_id_vec = {seq_id};
 
-            if(search_field.infix) {
-                auto strhash = StringUtils::hash_wy(key, token.size());
-                const auto& infix_sets = infix_index.at(search_field.name);
-                infix_sets[strhash % 4]->erase(token);
+        for(size_t i = 0; i < tokens.size(); i++) {
+            if(token_seq_ids != nullptr) {
+                (*token_seq_ids)[tokens[i]].push_back(seq_id);
+            } else {
+                erase_token_ids(search_field, tokens[i], seq_id_vec);
             }
         }
     } else if(search_field.is_int32()) {
@@ -4680,6 +6734,8 @@ void Index::remove_field(uint32_t seq_id, const nlohmann::json& document, const
             num_tree_t* num_tree = numerical_index.at(field_name);
             num_tree->remove(value, seq_id);
         }
+    } else if(search_field.is_vector()) {
+        vector_index.at(field_name)->remove(seq_id);
     } else if(search_field.is_float()) {
         const std::vector<float>& values = search_field.is_single_float() ?
                                            std::vector<float>{document[field_name].get<float>()} :
@@ -4701,36 +6757,17 @@ void Index::remove_field(uint32_t seq_id, const nlohmann::json& document, const
         }
     } else if(search_field.is_geopoint()) {
         auto geo_index = geopoint_index[field_name];
-        S2RegionTermIndexer::Options options;
-        options.set_index_contains_points_only(true);
-        S2RegionTermIndexer indexer(options);
 
         const std::vector<std::vector<double>>& latlongs = search_field.is_single_geopoint() ?
                                                            std::vector<std::vector<double>>{document[field_name].get<std::vector<double>>()} :
                                                            document[field_name].get<std::vector<std::vector<double>>>();
 
         for(const std::vector<double>& latlong: latlongs) {
-            S2Point point = S2LatLng::FromDegrees(latlong[0], latlong[1]).ToPoint();
-            for(const auto& term: indexer.GetIndexTerms(point, "")) {
-                auto term_it = geo_index->find(term);
-                if(term_it == geo_index->end()) {
-                    continue;
-                }
-                std::vector<uint32_t>& ids = term_it->second;
-                ids.erase(std::remove(ids.begin(), ids.end(), seq_id), ids.end());
-                if(ids.empty()) {
-                    geo_index->erase(term);
-                }
-            }
+            geo_index->remove(seq_id, GeoPoint::pack_lat_lng(latlong[0], latlong[1]));
         }
 
         if(!search_field.is_single_geopoint()) {
-            spp::sparse_hash_map<uint32_t, int64_t*>*& field_geo_array_map = geo_array_index.at(field_name);
-            auto geo_array_it = field_geo_array_map->find(seq_id);
-            if(geo_array_it != field_geo_array_map->end()) {
-                delete [] geo_array_it->second;
-                field_geo_array_map->erase(seq_id);
-            }
+            geo_array_index.at(field_name)->erase(seq_id);
         }
     }
 
@@ -4740,8 +6777,37 @@ void Index::remove_field(uint32_t seq_id, const nlohmann::json& document, const
     if(field_facets_it != facet_index_v3.end()) {
         const auto& fvalues_it = field_facets_it->second[seq_id % ARRAY_FACET_DIM]->find(seq_id);
         if(fvalues_it != field_facets_it->second[seq_id % ARRAY_FACET_DIM]->end()) {
+            const auto value_index_it = str_value_index.find(field_name);
+            if(value_index_it != str_value_index.end()) {
+                for(size_t i = 0; i < fvalues_it->second.size(); i++) {
+                    value_index_it->second->remove(fvalues_it->second.hashes[i], seq_id);
+                }
+            }
+
+            const auto facet_value_index_it = facet_value_indices.find(field_name);
+            if(facet_value_index_it != facet_value_indices.end()) {
+                for(size_t i = 0; i < fvalues_it->second.size(); i++) {
+                    facet_value_index_it->second->remove(fvalues_it->second.hashes[i]);
+                }
+            }
+
             field_facets_it->second[seq_id % ARRAY_FACET_DIM]->erase(fvalues_it);
         }
+
+        const auto group_column_it = group_hash_index.find(field_name);
+        if(group_column_it != group_hash_index.end()) {
+            group_column_it->second->erase(seq_id);
+        }
+
+        const auto facet_column_it = facet_columns.find(field_name);
+        if(facet_column_it != facet_columns.end()) {
+            facet_column_it->second->erase(seq_id);
+        }
+    }
+
+    const auto token_count_it = token_count_index.find(field_name);
+    if(token_count_it != token_count_index.end()) {
+        token_count_it->second->erase(seq_id);
     }
 
     // remove sort field
@@ -4777,9 +6843,45 @@ Option<uint32_t> Index::remove(const uint32_t seq_id, const nlohmann::json & doc
         seq_ids->erase(seq_id);
     }
 
+    write_generation++;
+
     return Option<uint32_t>(seq_id);
 }
 
+void Index::remove(const std::vector<uint32_t>& doc_seq_ids, const std::vector<nlohmann::json>& documents) {
+    std::unique_lock lock(mutex);
+
+    // field => token => seq_ids
+    std::unordered_map<std::string, std::unordered_map<std::string, std::vector<uint32_t>>> field_token_seq_ids;
+
+    for(size_t i = 0; i < doc_seq_ids.size(); i++) {
+        const nlohmann::json& document = documents[i];
+
+        for(auto it = document.begin(); it != document.end(); ++it) {
+            const std::string& field_name = it.key();
+            remove_field(doc_seq_ids[i], document, field_name, &field_token_seq_ids[field_name]);
+        }
+
+        seq_ids->erase(doc_seq_ids[i]);
+    }
+
+    for(auto& field_tokens: field_token_seq_ids) {
+        const auto& search_field_it = search_schema.find(field_tokens.first);
+        if(search_field_it == search_schema.end()) {
+            continue;
+        }
+
+        for(auto& token_seq_ids: field_tokens.second) {
+            std::vector<uint32_t>& token_ids = token_seq_ids.second;
+            std::sort(token_ids.begin(), token_ids.end());
+            token_ids.erase(std::unique(token_ids.begin(), token_ids.end()), token_ids.end());
+            erase_token_ids(search_field_it->second, token_seq_ids.first, token_ids);
+        }
+    }
+
+    write_generation++;
+}
+
 void Index::tokenize_string_field(const nlohmann::json& document, const field& search_field,
                                   std::vector<std::string>& tokens, const std::string& locale,
                                   const std::vector<char>& symbols_to_index,
@@ -4812,13 +6914,89 @@ const spp::sparse_hash_map<std::string, num_tree_t*>& Index::_get_numerical_inde
     return numerical_index;
 }
 
-const spp::sparse_hash_map<std::string, array_mapped_infix_t>& Index::_get_infix_index() const {
+const spp::sparse_hash_map<std::string, infix_index_t*>& Index::_get_infix_index() const {
     return infix_index;
 };
 
+namespace {
+    template<class T>
+    void move_field_structure(spp::sparse_hash_map<std::string, T>& from, spp::sparse_hash_map<std::string, T>& to,
+                              const std::string& field_name) {
+        auto it = from.find(field_name);
+        if(it == from.end()) {
+            return;
+        }
+
+        to.emplace(field_name, it->second);
+        from.erase(it);
+    }
+}
+
+void Index::adopt_fields(Index* other, const std::vector<field>& fields) {
+    std::unique_lock lock(mutex);
+    std::unique_lock other_lock(other->mutex);
+
+    write_generation++;
+
+    {
+        // the versions of the adopted trees and geopoint fields were never seen here
+        std::unique_lock cache_lock(token_leaves_cache_mutex);
+        token_leaves_cache.clear();
+
+        std::unique_lock polygon_cache_lock(geo_polygon_cache_mutex);
+        geo_polygon_cache.clear();
+    }
+
+    for(const auto& the_field: fields) {
+        if(the_field.is_dynamic() || !the_field.index) {
+            continue;
+        }
+
+        const std::string& field_name = the_field.name;
+        search_schema.emplace(field_name, the_field);
+
+        move_field_structure(other->search_index, search_index, field_name);
+        move_field_structure(other->search_index, search_index, the_field.faceted_name());
+        move_field_structure(other->numerical_index, numerical_index, field_name);
+        move_field_structure(other->geopoint_index, geopoint_index, field_name);
+        move_field_structure(other->geo_array_index, geo_array_index, field_name);
+        move_field_structure(other->vector_index, vector_index, field_name);
+        move_field_structure(other->facet_index_v3, facet_index_v3, field_name);
+        move_field_structure(other->sort_index, sort_index, field_name);
+        move_field_structure(other->str_sort_index, str_sort_index, field_name);
+        move_field_structure(other->str_value_index, str_value_index, field_name);
+        move_field_structure(other->group_hash_index, group_hash_index, field_name);
+        move_field_structure(other->token_count_index, token_count_index, field_name);
+        move_field_structure(other->bigram_filters, bigram_filters, field_name);
+        move_field_structure(other->facet_columns, facet_columns, field_name);
+        move_field_structure(other->facet_value_indices, facet_value_indices, field_name);
+        move_field_structure(other->infix_index, infix_index, field_name);
+
+        // the tokens of the adopted tree are in the vocabulary of the other index
+        if(vocabulary != nullptr && the_field.is_string() && search_index.count(field_name) != 0) {
+            vocabulary_field_ids.emplace(field_name, next_vocabulary_field_id++);
+            add_tree_to_vocabulary(field_name, search_index.at(field_name));
+        }
+
+        other->search_schema.erase(field_name);
+    }
+}
+
 void Index::refresh_schemas(const std::vector<field>& new_fields, const std::vector<field>& del_fields) {
     std::unique_lock lock(mutex);
 
+    write_generation++;
+
+    if(!del_fields.empty()) {
+        // a re-created field gets a new tree, whose versions would collide with those of the cached lookups
+        std::unique_lock cache_lock(token_leaves_cache_mutex);
+        token_leaves_cache.clear();
+
+        // likewise for the versions of a re-created geopoint field
+        std::unique_lock polygon_cache_lock(geo_polygon_cache_mutex);
+        geo_polygon_cache.clear();
+    }
+
     for(const auto & new_field: new_fields) {
         if(new_field.is_dynamic() || !new_field.index) {
             continue;
@@ -4828,7 +7006,7 @@ void Index::refresh_schemas(const std::vector<field>& new_fields, const std::vec
 
         if(new_field.is_sortable()) {
             if(new_field.is_num_sortable()) {
-                spp::sparse_hash_map<uint32_t, int64_t> * doc_to_score = new spp::sparse_hash_map<uint32_t, int64_t>();
+                sort_column_t * doc_to_score = new sort_column_t();
                 sort_index.emplace(new_field.name, doc_to_score);
             } else if(new_field.is_str_sortable()) {
                 str_sort_index.emplace(new_field.name, new adi_tree_t);
@@ -4840,26 +7018,45 @@ void Index::refresh_schemas(const std::vector<field>& new_fields, const std::vec
                 art_tree *t = new art_tree;
                 art_tree_init(t);
                 search_index.emplace(new_field.name, t);
+
+                if(vocabulary != nullptr) {
+                    vocabulary_field_ids.emplace(new_field.name, next_vocabulary_field_id++);
+                }
             } else if(new_field.is_geopoint()) {
-                auto field_geo_index = new spp::sparse_hash_map<std::string, std::vector<uint32_t>>();
-                geopoint_index.emplace(new_field.name, field_geo_index);
+                geopoint_index.emplace(new_field.name, new geo_point_index_t());
                 if(!new_field.is_single_geopoint()) {
-                    auto geo_array_map = new spp::sparse_hash_map<uint32_t, int64_t*>();
-                    geo_array_index.emplace(new_field.name, geo_array_map);
+                    geo_array_index.emplace(new_field.name, new geo_points_column_t());
                 }
+            } else if(new_field.is_vector()) {
+                vector_index.emplace(new_field.name, new vector_index_t(new_field.num_dim, new_field.vec_dist,
+                                                                        new_field.vec_int8));
             } else {
-                num_tree_t* num_tree = new num_tree_t;
+                num_tree_t* num_tree = new num_tree_t(!new_field.is_bool());
                 numerical_index.emplace(new_field.name, num_tree);
             }
         }
 
+        if(new_field.type == field_types::STRING && token_count_index.count(new_field.name) == 0) {
+            token_count_index.emplace(new_field.name, new sort_column_t());
+        }
+
+        if(new_field.type == field_types::STRING && bigram_filters.count(new_field.name) == 0) {
+            bigram_filters.emplace(new_field.name, new bigram_filter_t());
+        }
+
         if(new_field.is_facet()) {
-            array_mapped_facet_t facet_array;
-            for(size_t i = 0; i < ARRAY_FACET_DIM; i++) {
-                facet_array[i] = new facet_map_t();
+            facet_index_v3.emplace(new_field.name, new_facet_array());
+            group_hash_index.emplace(new_field.name, new sort_column_t());
+
+            if(!new_field.is_array()) {
+                facet_columns.emplace(new_field.name, new facet_column_t());
             }
 
-            facet_index_v3.emplace(new_field.name, facet_array);
+            facet_value_indices.emplace(new_field.name, new facet_value_index_t());
+
+            if(new_field.is_string()) {
+                str_value_index.emplace(new_field.name, new str_value_index_t());
+            }
 
             // initialize for non-string facet fields
             if(!new_field.is_string()) {
@@ -4870,12 +7067,7 @@ void Index::refresh_schemas(const std::vector<field>& new_fields, const std::vec
         }
 
         if(new_field.infix) {
-            array_mapped_infix_t infix_sets(ARRAY_INFIX_DIM);
-            for(auto& infix_set: infix_sets) {
-                infix_set = new tsl::htrie_set<char>();
-            }
-
-            infix_index.emplace(new_field.name, infix_sets);
+            infix_index.emplace(new_field.name, new infix_index_t());
         }
     }
 
@@ -4888,6 +7080,10 @@ void Index::refresh_schemas(const std::vector<field>& new_fields, const std::vec
         search_schema.erase(del_field.name);
 
         if(del_field.is_string() || field_types::is_string_or_array(del_field.type)) {
+            remove_tree_from_vocabulary(del_field.name, search_index[del_field.name]);
+            vocabulary_field_ids.erase(del_field.name);
+            tokens_to_compact.erase(del_field.name);
+
             art_tree_destroy(search_index[del_field.name]);
             delete search_index[del_field.name];
             search_index.erase(del_field.name);
@@ -4896,13 +7092,12 @@ void Index::refresh_schemas(const std::vector<field>& new_fields, const std::vec
             geopoint_index.erase(del_field.name);
 
             if(!del_field.is_single_geopoint()) {
-                spp::sparse_hash_map<uint32_t, int64_t*>* geo_array_map = geo_array_index[del_field.name];
-                for(auto& kv: *geo_array_map) {
-                    delete kv.second;
-                }
-                delete geo_array_map;
+                delete geo_array_index[del_field.name];
                 geo_array_index.erase(del_field.name);
             }
+        } else if(vector_index.count(del_field.name) != 0) {
+            delete vector_index[del_field.name];
+            vector_index.erase(del_field.name);
         } else {
             delete numerical_index[del_field.name];
             numerical_index.erase(del_field.name);
@@ -4918,13 +7113,37 @@ void Index::refresh_schemas(const std::vector<field>& new_fields, const std::vec
             }
         }
 
+        if(token_count_index.count(del_field.name) != 0) {
+            delete token_count_index[del_field.name];
+            token_count_index.erase(del_field.name);
+        }
+
+        if(bigram_filters.count(del_field.name) != 0) {
+            delete bigram_filters[del_field.name];
+            bigram_filters.erase(del_field.name);
+        }
+
         if(del_field.is_facet()) {
-            auto& arr = facet_index_v3[del_field.name];
-            for(size_t i = 0; i < ARRAY_FACET_DIM; i++) {
-                delete arr[i];
+            delete_facet_array(facet_index_v3[del_field.name]);
+            facet_index_v3.erase(del_field.name);
+
+            delete group_hash_index[del_field.name];
+            group_hash_index.erase(del_field.name);
+
+            if(facet_columns.count(del_field.name) != 0) {
+                delete facet_columns[del_field.name];
+                facet_columns.erase(del_field.name);
             }
 
-            facet_index_v3.erase(del_field.name);
+            if(facet_value_indices.count(del_field.name) != 0) {
+                delete facet_value_indices[del_field.name];
+                facet_value_indices.erase(del_field.name);
+            }
+
+            if(str_value_index.count(del_field.name) != 0) {
+                delete str_value_index[del_field.name];
+                str_value_index.erase(del_field.name);
+            }
 
             if(!del_field.is_string()) {
                 art_tree_destroy(search_index[del_field.faceted_name()]);
@@ -4934,11 +7153,7 @@ void Index::refresh_schemas(const std::vector<field>& new_fields, const std::vec
         }
 
         if(del_field.infix) {
-            auto& infix_set = infix_index[del_field.name];
-            for(size_t i = 0; i < infix_set.size(); i++) {
-                delete infix_set[i];
-            }
-
+            delete infix_index[del_field.name];
             infix_index.erase(del_field.name);
         }
     }
@@ -5389,6 +7604,293 @@ size_t Index::num_seq_ids() const {
     return seq_ids->num_ids();
 }
 
+size_t Index::compact_postings(size_t max_lists) {
+    std::unique_lock lock(mutex);
+    size_t num_lists = 0;
+
+    for(auto field_it = tokens_to_compact.begin(); field_it != tokens_to_compact.end() && num_lists < max_lists;) {
+        const auto tree_it = search_index.find(field_it->first);
+        auto& tokens = field_it->second;
+
+        while(num_lists < max_lists && !tokens.empty()) {
+            const auto token_it = tokens.begin();
+            num_lists++;
+
+            // the token might have been deleted, or the field dropped, since it was queued
+            if(tree_it != search_index.end()) {
+                const unsigned char* key = (const unsigned char*) token_it->c_str();
+                art_leaf* leaf = (art_leaf*) art_search(tree_it->second, key, (int) (token_it->length() + 1));
+
+                if(leaf != nullptr) {
+                    posting_t::compact(leaf->values);
+                }
+            }
+
+            tokens.erase(token_it);
+        }
+
+        if(tokens.empty()) {
+            field_it = tokens_to_compact.erase(field_it);
+        } else {
+            ++field_it;
+        }
+    }
+
+    for(auto& field_num_tree: numerical_index) {
+        if(num_lists >= max_lists) {
+            break;
+        }
+
+        num_lists += field_num_tree.second->compact(max_lists - num_lists);
+    }
+
+    if(num_lists < max_lists && seq_ids->is_fragmented()) {
+        seq_ids->compact();
+        num_lists++;
+    }
+
+    return num_lists;
+}
+
+bool Index::get_facet_value_string(const std::string& field_name, uint64_t facet_hash, std::string& value) const {
+    std::shared_lock lock(mutex);
+
+    const auto facet_value_index_it = facet_value_indices.find(field_name);
+    if(facet_value_index_it == facet_value_indices.end()) {
+        return false;
+    }
+
+    return facet_value_index_it->second->get_value(facet_hash, value);
+}
+
+void Index::get_posting_codec_stats(size_t& num_postings, std::vector<size_t>& codec_bytes) const {
+    std::shared_lock lock(mutex);
+
+    num_postings = 0;
+    codec_bytes.assign(PostingCodec::codecs().size(), 0);
+
+    std::pair<size_t*, std::vector<size_t>*> stats = {&num_postings, &codec_bytes};
+
+    for(const auto& field_tree: search_index) {
+        art_iter(field_tree.second, [](void* data, const unsigned char* key, uint32_t key_len, void* value) -> int {
+            auto stats = static_cast<std::pair<size_t*, std::vector<size_t>*>*>(data);
+            *stats->first += posting_t::num_ids(value);
+            posting_t::add_codec_sizes(value, *stats->second);
+            return 0;
+        }, &stats);
+    }
+}
+
+void Index::get_search_index_stats(art_tree_stats& stats) const {
+    std::shared_lock lock(mutex);
+
+    stats = art_tree_stats{};
+
+    for(const auto& field_tree: search_index) {
+        art_tree_get_stats(field_tree.second, &stats);
+    }
+
+    if(vocabulary != nullptr) {
+        art_tree_get_stats(vocabulary, &stats);
+    }
+}
+
+void Index::get_memory_stats(std::map<std::string, std::map<std::string, size_t>>& field_structure_bytes) const {
+    std::shared_lock lock(mutex);
+
+    field_structure_bytes.clear();
+
+    for(const auto& field_tree: search_index) {
+        art_tree_stats tree_stats{};
+        art_tree_get_stats(field_tree.second, &tree_stats);
+
+        size_t bytes = sizeof(art_tree) + tree_stats.node_bytes + tree_stats.leaf_bytes;
+        art_iter(field_tree.second, [](void* data, const unsigned char* key, uint32_t key_len, void* value) -> int {
+            *static_cast<size_t*>(data) += posting_t::memory_bytes(value);
+            return 0;
+        }, &bytes);
+
+        field_structure_bytes[field_tree.first]["search_index"] = bytes;
+    }
+
+    for(const auto& field_tree: numerical_index) {
+        field_structure_bytes[field_tree.first]["numerical_index"] = field_tree.second->memory_bytes();
+    }
+
+    for(const auto& field_facet_maps: facet_index_v3) {
+        size_t bytes = 0;
+        for(const facet_map_t* facet_map: field_facet_maps.second) {
+            if(facet_map == &empty_facet_map) {
+                continue;
+            }
+
+            bytes += sizeof(facet_map_t) + memory_usage::sparse_map_bytes(*facet_map);
+            for(const auto& id_hashes: *facet_map) {
+                bytes += id_hashes.second.length * sizeof(uint64_t);
+            }
+        }
+
+        field_structure_bytes[field_facet_maps.first]["facet_index_v3"] = bytes;
+    }
+
+    for(const auto& field_column: sort_index) {
+        field_structure_bytes[field_column.first]["sort_index"] = field_column.second->memory_bytes();
+    }
+
+    for(const auto& field_tree: str_sort_index) {
+        field_structure_bytes[field_tree.first]["str_sort_index"] = field_tree.second->memory_bytes();
+    }
+
+    for(const auto& field_index: str_value_index) {
+        field_structure_bytes[field_index.first]["str_value_index"] = field_index.second->memory_bytes();
+    }
+
+    for(const auto& field_column: group_hash_index) {
+        field_structure_bytes[field_column.first]["group_hash_index"] = field_column.second->memory_bytes();
+    }
+
+    for(const auto& field_column: token_count_index) {
+        field_structure_bytes[field_column.first]["token_count_index"] = field_column.second->memory_bytes();
+    }
+
+    for(const auto& field_filter: bigram_filters) {
+        field_structure_bytes[field_filter.first]["bigram_filters"] = field_filter.second->memory_bytes();
+    }
+
+    for(const auto& field_column: facet_columns) {
+        field_structure_bytes[field_column.first]["facet_columns"] = field_column.second->memory_bytes();
+    }
+
+    for(const auto& field_values: facet_value_indices) {
+        field_structure_bytes[field_values.first]["facet_value_indices"] = field_values.second->memory_bytes();
+    }
+
+    for(const auto& field_index: infix_index) {
+        field_structure_bytes[field_index.first]["infix_index"] = field_index.second->memory_bytes();
+    }
+
+    for(const auto& field_index: geopoint_index) {
+        field_structure_bytes[field_index.first]["geopoint_index"] = field_index.second->memory_bytes();
+    }
+
+    for(const auto& field_column: geo_array_index) {
+        field_structure_bytes[field_column.first]["geo_array_index"] = field_column.second->memory_bytes();
+    }
+
+    for(const auto& field_index: vector_index) {
+        field_structure_bytes[field_index.first]["vector_index"] = field_index.second->memory_bytes();
+    }
+
+    field_structure_bytes[""]["seq_ids"] = seq_ids->memory_bytes();
+}
+
+void Index::acquire_arena_when_large(size_t num_docs) {
+    if(arena == SystemMetrics::NO_ARENA && num_docs >= DEDICATED_ARENA_MIN_DOCUMENTS) {
+        arena = SystemMetrics::acquire_arena();
+    }
+}
+
+uint64_t Index::get_arena_active_bytes() const {
+    return SystemMetrics::get_arena_active_bytes(arena);
+}
+
+bool Index::is_snapshot_field(const field& a_field) {
+    // facet and infix fields are also fed by the tokens of their documents
+    return a_field.is_string() && a_field.index && !a_field.facet && !a_field.infix;
+}
+
+static std::vector<std::pair<std::string, std::string>> get_snapshot_fields(
+                                                    const std::unordered_map<std::string, field>& search_schema) {
+    std::vector<std::pair<std::string, std::string>> fields;
+
+    for(const auto& field_pair: search_schema) {
+        if(Index::is_snapshot_field(field_pair.second)) {
+            fields.emplace_back(field_pair.first, field_pair.second.type);
+        }
+    }
+
+    std::sort(fields.begin(), fields.end());
+    return fields;
+}
+
+void Index::save_snapshot(std::ostream& out, uint32_t next_seq_id, uint64_t store_seq_number) const {
+    std::shared_lock lock(mutex);
+
+    index_snapshot_t snapshot;
+    snapshot.collection_id = collection_id;
+    snapshot.next_seq_id = next_seq_id;
+    snapshot.store_seq_number = store_seq_number;
+    snapshot.fields = get_snapshot_fields(search_schema);
+    snapshot.write_header(out);
+
+    for(const auto& name_type: snapshot.fields) {
+        index_snapshot_t::write_tree(search_index.at(name_type.first), out);
+    }
+}
+
+bool Index::load_snapshot(std::istream& in, uint32_t next_seq_id, uint64_t store_seq_number) {
+    index_snapshot_t snapshot;
+
+    if(!snapshot.read_header(in) || snapshot.collection_id != collection_id || snapshot.next_seq_id != next_seq_id ||
+       snapshot.store_seq_number != store_seq_number) {
+        return false;
+    }
+
+    return load_snapshot_trees(in, snapshot);
+}
+
+bool Index::load_snapshot_trees(std::istream& in, const index_snapshot_t& snapshot) {
+    std::unique_lock lock(mutex);
+
+    if(snapshot.fields != get_snapshot_fields(search_schema)) {
+        return false;
+    }
+
+    for(const auto& name_type: snapshot.fields) {
+        if(art_size(search_index.at(name_type.first)) != 0) {
+            return false;
+        }
+    }
+
+    acquire_arena_when_large(snapshot.next_seq_id);
+    allocator_arena_scope_t arena_scope(arena);
+
+    for(const auto& name_type: snapshot.fields) {
+        if(!index_snapshot_t::read_tree(in, search_index.at(name_type.first))) {
+            // trees restored so far are dropped along with the partial one, so that all of them are indexed afresh
+            for(const auto& restored_name_type: snapshot.fields) {
+                art_tree* restored_t = search_index.at(restored_name_type.first);
+                art_tree_destroy(restored_t);
+                art_tree_init(restored_t);
+            }
+
+            restored_fields.clear();
+            return false;
+        }
+
+        restored_fields.insert(name_type.first);
+    }
+
+    // the restored trees were not built token by token, so their tokens go into the vocabulary all at once, while
+    // the pairs of tokens of their documents are not known at all, so their fields go without a bigram filter
+    for(const auto& name_type: snapshot.fields) {
+        add_tree_to_vocabulary(name_type.first, search_index.at(name_type.first));
+
+        auto bigram_filter_it = bigram_filters.find(name_type.first);
+        if(bigram_filter_it != bigram_filters.end()) {
+            delete bigram_filter_it->second;
+            bigram_filters.erase(bigram_filter_it);
+        }
+    }
+
+    return true;
+}
+
+void Index::clear_restored_fields() {
+    std::unique_lock lock(mutex);
+    restored_fields.clear();
+}
+
 void Index::resolve_space_as_typos(std::vector<std::string>& qtokens, const string& field_name,
                                    std::vector<std::vector<std::string>>& resolved_queries) const {
 
@@ -5398,21 +7900,24 @@ void Index::resolve_space_as_typos(std::vector<std::string>& qtokens, const stri
         return ;
     }
 
-    // we will try to find a verbatim match first
-
     art_tree* t = tree_it->second;
-    std::vector<art_leaf*> leaves;
 
-    for(const std::string& token: qtokens) {
-        art_leaf* leaf = (art_leaf *) art_search(t, (const unsigned char*) token.c_str(),
-                                                 token.length()+1);
-        if(leaf == nullptr) {
-            break;
-        }
+    // null for arrays, since their splits are checked without telling their elements apart, and for a field whose
+    // tree was restored off a snapshot, since it has not seen the pairs of those documents
+    const auto bigram_filter_it = bigram_filters.find(field_name);
+    const bigram_filter_t* bigram_filter = (bigram_filter_it != bigram_filters.end()) ?
+                                           bigram_filter_it->second : nullptr;
+
+    // the leaves of the query tokens are looked up once, for all the candidates that keep them as they are
+    std::vector<art_leaf*> token_leaves(qtokens.size(), nullptr);
 
-        leaves.push_back(leaf);
+    for(size_t i = 0; i < qtokens.size(); i++) {
+        const std::string& token = qtokens[i];
+        token_leaves[i] = (art_leaf *) art_search(t, (const unsigned char*) token.c_str(), token.length()+1);
     }
 
+    std::vector<art_leaf*> leaves;
+
     // When we cannot find verbatim match, we can try concatting and splitting query tokens for alternatives.
 
     // Concatenation:
@@ -5429,33 +7934,42 @@ void Index::resolve_space_as_typos(std::vector<std::string>& qtokens, const stri
 
         // b) join 2 adjacent tokens in a sliding window (provided they are atleast 2 tokens in size)
 
+        // number of query tokens that are not in the tree, a candidate must join all of them away
+        size_t num_missing_tokens = 0;
+        for(art_leaf* leaf: token_leaves) {
+            num_missing_tokens += (leaf == nullptr);
+        }
+
         for(size_t i = 0; i < qtokens_size-1 && qtokens_size > 2; i++) {
+            const size_t num_joined_missing = (token_leaves[i] == nullptr) + (token_leaves[i+1] == nullptr);
+            if(num_missing_tokens != num_joined_missing) {
+                continue;
+            }
+
+            std::string joined_tokens = qtokens[i] + qtokens[i+1];
+            art_leaf* joined_leaf = static_cast<art_leaf*>(art_search(t, (const unsigned char*) joined_tokens.c_str(),
+                                                                      joined_tokens.length() + 1));
+            if(joined_leaf == nullptr) {
+                continue;
+            }
+
             std::vector<std::string> candidate_tokens;
+            leaves.clear();
 
             for(size_t j = 0; j < i; j++) {
                 candidate_tokens.push_back(qtokens[j]);
+                leaves.push_back(token_leaves[j]);
             }
 
-            std::string joined_tokens = qtokens[i] + qtokens[i+1];
             candidate_tokens.push_back(joined_tokens);
+            leaves.push_back(joined_leaf);
 
             for(size_t j = i+2; j < qtokens.size(); j++) {
                 candidate_tokens.push_back(qtokens[j]);
+                leaves.push_back(token_leaves[j]);
             }
 
-            leaves.clear();
-
-            for(auto& token: candidate_tokens) {
-                art_leaf* leaf = static_cast<art_leaf*>(art_search(t, (const unsigned char*) token.c_str(),
-                                                                   token.length() + 1));
-                if(leaf == nullptr) {
-                    break;
-                }
-
-                leaves.push_back(leaf);
-            }
-
-            if(candidate_tokens.size() == leaves.size() && common_results_exist(leaves, false)) {
+            if(common_results_exist(leaves, false)) {
                 resolved_queries.push_back(candidate_tokens);
                 return;
             }
@@ -5472,17 +7986,26 @@ void Index::resolve_space_as_typos(std::vector<std::string>& qtokens, const stri
 
         const std::string& token = qtokens[i];
         bool found_split = false;
+        art_leaf* first_leaf = nullptr;
+        art_leaf* second_leaf = nullptr;
 
         for(size_t ci = 1; ci < token.size(); ci++) {
             std::string first_part = token.substr(0, token.size()-ci);
-            art_leaf* first_leaf = static_cast<art_leaf*>(art_search(t, (const unsigned char*) first_part.c_str(),
-                                                                     first_part.length() + 1));
+            std::string second_part = token.substr(token.size()-ci, ci);
+
+            // the parts must follow one another in a value of the field
+            if(bigram_filter != nullptr &&
+               !bigram_filter->may_contain(bigram_filter_t::pair_hash(first_part, second_part))) {
+                continue;
+            }
+
+            first_leaf = static_cast<art_leaf*>(art_search(t, (const unsigned char*) first_part.c_str(),
+                                                           first_part.length() + 1));
 
             if(first_leaf != nullptr) {
                 // check if rest of the string is also a valid token
-                std::string second_part = token.substr(token.size()-ci, ci);
-                art_leaf* second_leaf = static_cast<art_leaf*>(art_search(t, (const unsigned char*) second_part.c_str(),
-                                                                          second_part.length() + 1));
+                second_leaf = static_cast<art_leaf*>(art_search(t, (const unsigned char*) second_part.c_str(),
+                                                                second_part.length() + 1));
 
                 std::vector<art_leaf*> part_leaves = {first_leaf, second_leaf};
                 if(second_leaf != nullptr && common_results_exist(part_leaves, true)) {
@@ -5502,11 +8025,17 @@ void Index::resolve_space_as_typos(std::vector<std::string>& qtokens, const stri
             candidate_tokens.push_back(qtokens[j]);
         }
 
+        // leaves of the candidate tokens up to the first one that is not in the tree
         leaves.clear();
 
-        for(auto& candidate_token: candidate_tokens) {
-            art_leaf* leaf = static_cast<art_leaf*>(art_search(t, (const unsigned char*) candidate_token.c_str(),
-                                                               candidate_token.length() + 1));
+        for(size_t j = 0; j < qtokens.size(); j++) {
+            art_leaf* leaf = token_leaves[j];
+
+            if(j == i) {
+                leaves.push_back(first_leaf);
+                leaf = second_leaf;
+            }
+
             if(leaf == nullptr) {
                 break;
             }
@@ -5529,24 +8058,13 @@ bool Index::common_results_exist(std::vector<art_leaf*>& leaves, bool must_match
         leaf_vals.push_back(leaf->values);
     }
 
-    posting_t::intersect(leaf_vals, result_ids);
-
-    if(result_ids.empty()) {
-        return false;
-    }
-
-    if(!must_match_phrase) {
-        return !result_ids.empty();
+    if(must_match_phrase) {
+        posting_t::phrase_intersect(leaf_vals, false, result_ids);
+    } else {
+        posting_t::intersect(leaf_vals, result_ids);
     }
 
-    uint32_t* phrase_ids = new uint32_t[result_ids.size()];
-    size_t num_phrase_ids;
-
-    posting_t::get_phrase_matches(leaf_vals, false, &result_ids[0], result_ids.size(),
-                                  phrase_ids, num_phrase_ids);
-    bool phrase_exists = (num_phrase_ids != 0);
-    delete [] phrase_ids;
-    return phrase_exists;
+    return !result_ids.empty();
 }
 
 /*
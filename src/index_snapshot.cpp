@@ -0,0 +1,202 @@
+#include "index_snapshot.h"
+#include "posting.h"
+
+template<class T>
+static void write_value(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<class T>
+static bool read_value(std::istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return in.good();
+}
+
+static void write_string(std::ostream& out, const std::string& str) {
+    write_value(out, uint32_t(str.size()));
+    out.write(str.data(), str.size());
+}
+
+static bool read_string(std::istream& in, std::string& str) {
+    uint32_t size;
+    if(!read_value(in, size)) {
+        return false;
+    }
+
+    str.resize(size);
+    in.read(&str[0], size);
+    return in.good();
+}
+
+static void write_uint32s(std::ostream& out, const std::vector<uint32_t>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(uint32_t));
+}
+
+static bool read_uint32s(std::istream& in, size_t num_values, std::vector<uint32_t>& values) {
+    values.resize(num_values);
+    in.read(reinterpret_cast<char*>(values.data()), num_values * sizeof(uint32_t));
+    return in.good();
+}
+
+void index_snapshot_t::write_header(std::ostream& out) const {
+    write_value(out, MAGIC);
+    write_value(out, VERSION);
+    write_value(out, collection_id);
+    write_value(out, next_seq_id);
+    write_value(out, store_seq_number);
+
+    write_value(out, uint32_t(fields.size()));
+
+    for(const auto& name_type: fields) {
+        write_string(out, name_type.first);
+        write_string(out, name_type.second);
+    }
+}
+
+bool index_snapshot_t::read_header(std::istream& in) {
+    uint32_t magic, version, num_fields;
+
+    if(!read_value(in, magic) || magic != MAGIC || !read_value(in, version) || version != VERSION) {
+        return false;
+    }
+
+    if(!read_value(in, collection_id) || !read_value(in, next_seq_id) || !read_value(in, store_seq_number) ||
+       !read_value(in, num_fields)) {
+        return false;
+    }
+
+    fields.clear();
+
+    for(uint32_t i = 0; i < num_fields; i++) {
+        std::string name, type;
+        if(!read_string(in, name) || !read_string(in, type)) {
+            return false;
+        }
+
+        fields.emplace_back(std::move(name), std::move(type));
+    }
+
+    return true;
+}
+
+// flattens the posting list of a leaf into the layout of `compact_posting_list_t::create()`
+static void get_ids_offsets(const void* obj, std::vector<uint32_t>& ids, std::vector<uint32_t>& offset_index,
+                            std::vector<uint32_t>& offsets) {
+    if(IS_COMPACT_POSTING(obj)) {
+        // format: num_offsets, offset1,..,offsetn, id1 | num_offsets, offset1,..,offsetn, id2
+        const compact_posting_list_t* list = COMPACT_POSTING_PTR(obj);
+        size_t i = 0;
+
+        while(i < list->length) {
+            const uint32_t num_id_offsets = list->id_offsets[i];
+            offset_index.push_back(offsets.size());
+            offsets.insert(offsets.end(), list->id_offsets + i + 1, list->id_offsets + i + 1 + num_id_offsets);
+            ids.push_back(list->id_offsets[i + num_id_offsets + 1]);
+            i += num_id_offsets + 2;
+        }
+
+        return ;
+    }
+
+    const posting_list_t::block_t* block = &((const posting_list_t*)(obj))->root_block;
+
+    while(block != nullptr) {
+        const uint32_t num_block_ids = block->ids.getLength();
+
+        if(num_block_ids != 0) {
+            uint32_t* block_ids = block->ids.uncompress();
+            uint32_t* block_offset_index = block->offset_index.uncompress();
+            uint32_t* block_offsets = block->offsets.uncompress();
+
+            const uint32_t base_offset = offsets.size();
+            ids.insert(ids.end(), block_ids, block_ids + num_block_ids);
+
+            for(uint32_t i = 0; i < num_block_ids; i++) {
+                offset_index.push_back(base_offset + block_offset_index[i]);
+            }
+
+            offsets.insert(offsets.end(), block_offsets, block_offsets + block->offsets.getLength());
+
+            delete [] block_ids;
+            delete [] block_offset_index;
+            delete [] block_offsets;
+        }
+
+        block = block->next;
+    }
+}
+
+static int write_leaf(void* data, const art_leaf* leaf) {
+    std::ostream& out = *static_cast<std::ostream*>(data);
+
+    std::vector<uint32_t> ids, offset_index, offsets;
+    get_ids_offsets(leaf->values, ids, offset_index, offsets);
+
+    write_value(out, leaf->key_len);
+    out.write(reinterpret_cast<const char*>(leaf->key), leaf->key_len);
+    write_value(out, leaf->max_score);
+    write_value(out, uint32_t(ids.size()));
+    write_value(out, uint32_t(offsets.size()));
+
+    write_uint32s(out, ids);
+    write_uint32s(out, offset_index);
+    write_uint32s(out, offsets);
+
+    return 0;
+}
+
+void index_snapshot_t::write_tree(art_tree* t, std::ostream& out) {
+    write_value(out, uint64_t(t->size));
+    art_iter_leaves(t, write_leaf, &out);
+}
+
+bool index_snapshot_t::read_tree(std::istream& in, art_tree* t) {
+    uint64_t num_leaves;
+    if(!read_value(in, num_leaves)) {
+        return false;
+    }
+
+    std::vector<unsigned char> key;
+    std::vector<uint32_t> ids, offset_index, offsets;
+
+    for(uint64_t i = 0; i < num_leaves; i++) {
+        uint32_t key_len, num_ids, num_offsets;
+        int64_t max_score;
+
+        if(!read_value(in, key_len) || key_len == 0) {
+            return false;
+        }
+
+        key.resize(key_len);
+        in.read(reinterpret_cast<char*>(key.data()), key_len);
+
+        if(!read_value(in, max_score) || !read_value(in, num_ids) || num_ids == 0 ||
+           !read_value(in, num_offsets)) {
+            return false;
+        }
+
+        if(!read_uint32s(in, num_ids, ids) || !read_uint32s(in, num_ids, offset_index) ||
+           !read_uint32s(in, num_offsets, offsets)) {
+            return false;
+        }
+
+        // the leaf is made off its first id, and the rest are appended to its posting list in bulk
+        const uint32_t first_end_offset = (num_ids == 1) ? num_offsets : offset_index[1];
+        std::vector<art_document> documents;
+        documents.emplace_back(ids[0], max_score,
+                               std::vector<uint32_t>(offsets.begin(), offsets.begin() + first_end_offset));
+
+        art_inserts(t, key.data(), key_len, max_score, documents);
+
+        art_leaf* leaf = (art_leaf*) art_search(t, key.data(), key_len);
+        if(leaf == nullptr) {
+            return false;
+        }
+
+        posting_t::upsert_sorted(leaf->values, num_ids - 1, ids.data() + 1, offset_index.data() + 1,
+                                 num_offsets, offsets.data());
+        leaf->max_score = max_score;
+    }
+
+    return true;
+}
@@ -0,0 +1,170 @@
+#include "infix_index.h"
+#include <algorithm>
+#include <iterator>
+#include "memory_usage.h"
+
+void infix_index_t::get_grams(const std::string& token, std::vector<uint32_t>& grams) {
+    grams.clear();
+
+    for(size_t i = 0; i + GRAM_LEN <= token.size(); i++) {
+        const uint32_t gram = (uint32_t(uint8_t(token[i])) << 16) | (uint32_t(uint8_t(token[i + 1])) << 8) |
+                              uint32_t(uint8_t(token[i + 2]));
+        grams.push_back(gram);
+    }
+
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+bool infix_index_t::is_match(const std::string& token, const std::string& query,
+                             size_t max_extra_prefix, size_t max_extra_suffix) {
+    const size_t start_index = token.find(query);
+    return start_index != std::string::npos && start_index <= max_extra_prefix &&
+           (token.size() - (start_index + query.size())) <= max_extra_suffix;
+}
+
+void infix_index_t::insert(const std::string& token) {
+    if(token.empty() || token_ids.count(token) != 0) {
+        return ;
+    }
+
+    const uint32_t token_id = tokens.size();
+    tokens.push_back(token);
+    token_ids.emplace(token, token_id);
+
+    std::vector<uint32_t> grams;
+    get_grams(token, grams);
+
+    for(uint32_t gram: grams) {
+        gram_token_ids[gram].push_back(token_id);
+    }
+}
+
+void infix_index_t::erase(const std::string& token) {
+    auto token_id_it = token_ids.find(token);
+    if(token_id_it == token_ids.end()) {
+        return ;
+    }
+
+    const uint32_t token_id = token_id_it->second;
+    token_ids.erase(token_id_it);
+
+    std::vector<uint32_t> grams;
+    get_grams(token, grams);
+
+    for(uint32_t gram: grams) {
+        auto gram_it = gram_token_ids.find(gram);
+        if(gram_it == gram_token_ids.end()) {
+            continue;
+        }
+
+        std::vector<uint32_t>& ids = gram_it->second;
+        auto id_it = std::lower_bound(ids.begin(), ids.end(), token_id);
+        if(id_it != ids.end() && *id_it == token_id) {
+            ids.erase(id_it);
+        }
+
+        if(ids.empty()) {
+            gram_token_ids.erase(gram_it);
+        }
+    }
+
+    tokens[token_id].clear();
+    tokens[token_id].shrink_to_fit();
+    num_erased++;
+
+    if(num_erased * 2 > tokens.size()) {
+        compact();
+    }
+}
+
+void infix_index_t::compact() {
+    std::vector<std::string> live_tokens;
+    live_tokens.reserve(tokens.size() - num_erased);
+
+    for(auto& token: tokens) {
+        if(!token.empty()) {
+            live_tokens.push_back(std::move(token));
+        }
+    }
+
+    tokens.clear();
+    token_ids.clear();
+    gram_token_ids.clear();
+    num_erased = 0;
+
+    for(const auto& token: live_tokens) {
+        insert(token);
+    }
+}
+
+size_t infix_index_t::size() const {
+    return token_ids.size();
+}
+
+size_t infix_index_t::memory_bytes() const {
+    size_t bytes = sizeof(infix_index_t) + memory_usage::vector_bytes(tokens) +
+                   memory_usage::sparse_map_bytes(token_ids) + memory_usage::sparse_map_bytes(gram_token_ids);
+
+    // each token is held both by `tokens` and as a key of `token_ids`
+    for(const auto& token: tokens) {
+        bytes += 2 * memory_usage::string_bytes(token);
+    }
+
+    for(const auto& gram_ids: gram_token_ids) {
+        bytes += memory_usage::vector_bytes(gram_ids.second);
+    }
+
+    return bytes;
+}
+
+void infix_index_t::search(const std::string& query, size_t max_extra_prefix, size_t max_extra_suffix,
+                           std::vector<std::string>& matched_tokens) const {
+    if(query.size() < GRAM_LEN) {
+        for(const auto& token: tokens) {
+            if(!token.empty() && is_match(token, query, max_extra_prefix, max_extra_suffix)) {
+                matched_tokens.push_back(token);
+            }
+        }
+
+        return ;
+    }
+
+    std::vector<uint32_t> grams;
+    get_grams(query, grams);
+
+    std::vector<const std::vector<uint32_t>*> gram_lists;
+    for(uint32_t gram: grams) {
+        auto gram_it = gram_token_ids.find(gram);
+        if(gram_it == gram_token_ids.end()) {
+            // no token contains this part of the query
+            return ;
+        }
+
+        gram_lists.push_back(&gram_it->second);
+    }
+
+    // intersected from the shortest list up
+    std::sort(gram_lists.begin(), gram_lists.end(), [](const auto* a, const auto* b) {
+        return a->size() < b->size();
+    });
+
+    std::vector<uint32_t> candidate_ids = *gram_lists[0];
+    std::vector<uint32_t> next_candidate_ids;
+
+    for(size_t i = 1; i < gram_lists.size() && !candidate_ids.empty(); i++) {
+        next_candidate_ids.clear();
+        std::set_intersection(candidate_ids.begin(), candidate_ids.end(),
+                              gram_lists[i]->begin(), gram_lists[i]->end(),
+                              std::back_inserter(next_candidate_ids));
+        candidate_ids.swap(next_candidate_ids);
+    }
+
+    // sharing the trigrams of the query doesn't mean containing it, e.g. "abcab" for "bcabc"
+    for(uint32_t token_id: candidate_ids) {
+        const std::string& token = tokens[token_id];
+        if(is_match(token, query, max_extra_prefix, max_extra_suffix)) {
+            matched_tokens.push_back(token);
+        }
+    }
+}
@@ -43,6 +43,8 @@ bool JapaneseLocalizer::init() {
 }
 
 char* JapaneseLocalizer::normalize(const std::string& text) {
+    // kakasi keeps its state in globals
+    std::unique_lock lock(mutex);
     return kakasi_do((char *)text.c_str());
 }
 
@@ -0,0 +1,72 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+size_t latency_histogram_t::bucket_index(uint64_t value) {
+    value = std::min(value, MAX_VALUE);
+
+    if(value < SUB_BUCKETS) {
+        return value;
+    }
+
+    // the top `SUB_BUCKET_BITS + 1` bits of the value pick the bucket within the range of its leading bit
+    const size_t shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+}
+
+uint64_t latency_histogram_t::bucket_max_value(size_t index) {
+    if(index < SUB_BUCKETS) {
+        return index;
+    }
+
+    const size_t shift = (index / SUB_BUCKETS) - 1;
+    const uint64_t min_value = uint64_t(SUB_BUCKETS + (index % SUB_BUCKETS)) << shift;
+    return min_value + (uint64_t(1) << shift) - 1;
+}
+
+void latency_histogram_t::record(uint64_t value) {
+    if(buckets.empty()) {
+        buckets.resize(NUM_BUCKETS, 0);
+    }
+
+    buckets[bucket_index(value)]++;
+    num_values++;
+    max_value = std::max(max_value, std::min(value, MAX_VALUE));
+}
+
+void latency_histogram_t::merge(const latency_histogram_t& other) {
+    if(other.num_values == 0) {
+        return ;
+    }
+
+    if(buckets.empty()) {
+        buckets.resize(NUM_BUCKETS, 0);
+    }
+
+    for(size_t i = 0; i < NUM_BUCKETS; i++) {
+        buckets[i] += other.buckets[i];
+    }
+
+    num_values += other.num_values;
+    max_value = std::max(max_value, other.max_value);
+}
+
+uint64_t latency_histogram_t::value_at_percentile(double percentile) const {
+    if(num_values == 0) {
+        return 0;
+    }
+
+    const double clamped_percentile = std::min(std::max(percentile, 0.0), 100.0);
+    const uint64_t rank = std::max<uint64_t>(1, std::ceil(clamped_percentile / 100 * num_values));
+
+    uint64_t num_seen = 0;
+
+    for(size_t i = 0; i < NUM_BUCKETS; i++) {
+        num_seen += buckets[i];
+        if(num_seen >= rank) {
+            return std::min(bucket_max_value(i), max_value);
+        }
+    }
+
+    return max_value;
+}
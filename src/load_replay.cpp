@@ -0,0 +1,297 @@
+#include "load_replay.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include "string_utils.h"
+
+void replay_stats_t::merge(const replay_stats_t& other) {
+    num_requests += other.num_requests;
+    num_errors += other.num_errors;
+    latencies.merge(other.latencies);
+}
+
+nlohmann::json replay_stats_t::to_json(double duration_s) const {
+    nlohmann::json stats_json;
+    stats_json["num_requests"] = num_requests;
+    stats_json["num_errors"] = num_errors;
+    stats_json["requests_per_second"] = (duration_s > 0) ? (num_requests / duration_s) : 0;
+
+    nlohmann::json& latency_json = stats_json["latency_us"];
+    latency_json["p50"] = latencies.value_at_percentile(50);
+    latency_json["p90"] = latencies.value_at_percentile(90);
+    latency_json["p99"] = latencies.value_at_percentile(99);
+    latency_json["p999"] = latencies.value_at_percentile(99.9);
+    latency_json["max"] = latencies.max_value;
+
+    return stats_json;
+}
+
+Option<replay_request_t> LoadReplayer::parse_log_line(const std::string& line) {
+    replay_request_t request;
+
+    if(line.empty()) {
+        return Option<replay_request_t>(400, "Line is empty.");
+    }
+
+    if(line[0] == '/') {
+        request.path = line;
+        return Option<replay_request_t>(request);
+    }
+
+    nlohmann::json entry;
+
+    try {
+        entry = nlohmann::json::parse(line);
+    } catch(const std::exception& e) {
+        return Option<replay_request_t>(400, "Line is not a request path or a JSON object.");
+    }
+
+    if(!entry.is_object()) {
+        return Option<replay_request_t>(400, "Line is not a request path or a JSON object.");
+    }
+
+    if(entry.count("path") != 0 && entry["path"].is_string()) {
+        request.path = entry["path"].get<std::string>();
+
+        if(entry.count("body") != 0 && entry["body"].is_string()) {
+            request.body = entry["body"].get<std::string>();
+        }
+
+        if(request.path.find("/documents/import") != std::string::npos) {
+            request.kind = replay_request_t::IMPORT;
+        }
+
+        return Option<replay_request_t>(request);
+    }
+
+    if(entry.count("collection") == 0 || !entry["collection"].is_string() ||
+       entry.count("params") == 0 || !entry["params"].is_object()) {
+        return Option<replay_request_t>(400, "Object has neither a `path` nor a `collection` and its `params`.");
+    }
+
+    request.path = "/collections/" + StringUtils::url_encode(entry["collection"].get<std::string>()) +
+                   "/documents/search";
+
+    char separator = '?';
+
+    for(const auto& param: entry["params"].items()) {
+        const std::string value = param.value().is_string() ? param.value().get<std::string>() :
+                                  param.value().dump();
+
+        request.path += separator;
+        request.path += StringUtils::url_encode(param.key()) + "=" + StringUtils::url_encode(value);
+        separator = '&';
+    }
+
+    return Option<replay_request_t>(request);
+}
+
+Option<bool> LoadReplayer::load_query_log(const std::string& path, std::vector<replay_request_t>& requests) {
+    std::ifstream infile(path);
+    if(!infile.is_open()) {
+        return Option<bool>(404, "Could not open the query log at " + path);
+    }
+
+    std::string line;
+    size_t line_num = 0;
+
+    while(std::getline(infile, line)) {
+        line_num++;
+
+        if(line.empty()) {
+            continue;
+        }
+
+        auto request_op = parse_log_line(line);
+        if(!request_op.ok()) {
+            return Option<bool>(400, "Line " + std::to_string(line_num) + " of the query log: " + request_op.error());
+        }
+
+        requests.push_back(std::move(request_op).get());
+    }
+
+    if(requests.empty()) {
+        return Option<bool>(400, "The query log has no requests.");
+    }
+
+    return Option<bool>(true);
+}
+
+Option<bool> LoadReplayer::load_import_batches(const std::string& path, const std::string& collection,
+                                               size_t batch_size, std::vector<replay_request_t>& requests) {
+    std::ifstream infile(path);
+    if(!infile.is_open()) {
+        return Option<bool>(404, "Could not open the documents at " + path);
+    }
+
+    replay_request_t batch;
+    batch.kind = replay_request_t::IMPORT;
+    batch.path = "/collections/" + StringUtils::url_encode(collection) + "/documents/import?action=upsert";
+
+    std::string body;
+    size_t num_docs = 0;
+    std::string line;
+
+    while(std::getline(infile, line)) {
+        if(line.empty()) {
+            continue;
+        }
+
+        if(num_docs != 0) {
+            body += '\n';
+        }
+
+        body += line;
+
+        if(++num_docs == batch_size) {
+            batch.body = std::move(body);
+            requests.push_back(batch);
+            body.clear();
+            num_docs = 0;
+        }
+    }
+
+    if(num_docs != 0) {
+        batch.body = std::move(body);
+        requests.push_back(batch);
+    }
+
+    if(requests.empty()) {
+        return Option<bool>(400, "There are no documents to import.");
+    }
+
+    return Option<bool>(true);
+}
+
+void LoadReplayer::run(const std::vector<replay_request_t>& searches, const std::vector<replay_request_t>& imports) {
+    typedef std::chrono::steady_clock clock;
+
+    if(searches.empty()) {
+        return ;
+    }
+
+    const clock::time_point start = clock::now();
+    const clock::time_point deadline = start + std::chrono::milliseconds(config.duration_ms);
+    const uint64_t num_searches = (config.duration_ms == 0) ? searches.size() * config.num_loops :
+                                  std::numeric_limits<uint64_t>::max();
+
+    auto due_time = [start](uint64_t index, double rate) {
+        return start + std::chrono::microseconds(uint64_t(index * 1000000.0 / rate));
+    };
+
+    auto is_past_deadline = [this, deadline](clock::time_point time) {
+        return config.duration_ms != 0 && time >= deadline;
+    };
+
+    auto send = [this](const replay_request_t& request, clock::time_point sent_at, replay_stats_t& stats) {
+        const long status_code = send_fn(request);
+        const uint64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                clock::now() - sent_at).count();
+
+        stats.num_requests++;
+
+        if(status_code < 200 || status_code >= 300) {
+            stats.num_errors++;
+        }
+
+        stats.latencies.record(latency_us);
+    };
+
+    std::atomic<uint64_t> next_search{0};
+    std::atomic<bool> searches_done{false};
+    std::mutex stats_mutex;
+
+    std::vector<std::thread> workers;
+
+    for(size_t w = 0; w < std::max<size_t>(config.concurrency, 1); w++) {
+        workers.emplace_back([&]() {
+            replay_stats_t stats;
+
+            while(true) {
+                const uint64_t index = next_search++;
+                if(index >= num_searches) {
+                    break;
+                }
+
+                clock::time_point sent_at = clock::now();
+
+                if(config.rate > 0) {
+                    // measured from when it was due, so that the time spent waiting for a worker counts
+                    sent_at = due_time(index, config.rate);
+                    if(is_past_deadline(sent_at)) {
+                        break;
+                    }
+
+                    std::this_thread::sleep_until(sent_at);
+                } else if(is_past_deadline(sent_at)) {
+                    break;
+                }
+
+                send(searches[index % searches.size()], sent_at, stats);
+            }
+
+            std::unique_lock lock(stats_mutex);
+            search_stats.merge(stats);
+        });
+    }
+
+    std::thread importer;
+
+    if(config.import_rate > 0 && !imports.empty()) {
+        importer = std::thread([&]() {
+            replay_stats_t stats;
+
+            for(uint64_t index = 0; !searches_done; index++) {
+                const clock::time_point due = due_time(index, config.import_rate);
+                if(is_past_deadline(due)) {
+                    break;
+                }
+
+                // waits in short steps, so as to stop along with the searches
+                while(!searches_done && clock::now() < due) {
+                    std::this_thread::sleep_for(std::min<clock::duration>(due - clock::now(),
+                                                                          std::chrono::milliseconds(10)));
+                }
+
+                if(searches_done) {
+                    break;
+                }
+
+                send(imports[index % imports.size()], due, stats);
+            }
+
+            std::unique_lock lock(stats_mutex);
+            import_stats.merge(stats);
+        });
+    }
+
+    for(auto& worker: workers) {
+        worker.join();
+    }
+
+    searches_done = true;
+
+    if(importer.joinable()) {
+        importer.join();
+    }
+
+    duration_s = std::chrono::duration<double>(clock::now() - start).count();
+}
+
+nlohmann::json LoadReplayer::get_report() const {
+    nlohmann::json report;
+    report["duration_seconds"] = duration_s;
+    report["concurrency"] = config.concurrency;
+    report["rate"] = config.rate;
+    report["searches"] = search_stats.to_json(duration_s);
+
+    if(import_stats.num_requests != 0) {
+        report["import_rate"] = config.import_rate;
+        report["imports"] = import_stats.to_json(duration_s);
+    }
+
+    return report;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <map>
+#include <curl/curl.h>
+#include <cmdline.h>
+#include "http_client.h"
+#include "load_replay.h"
+
+/*
+    Replays a query log (e.g. the slow query log, recorded with a sample ratio of 1) against a running node, along
+    with imports of documents when given, and prints the throughput and latency percentiles as JSON.
+*/
+
+int main(int argc, char* argv[]) {
+    cmdline::parser options;
+    options.set_program_name("./typesense-loadgen");
+
+    options.add<std::string>("url", '\0', "Base URL of the node.", false, "http://localhost:8108");
+    options.add<std::string>("api-key", 'a', "API key to send the requests with.", true);
+    options.add<std::string>("query-log", 'q', "Query log to replay: one JSON object or request path a line.", true);
+
+    options.add<uint32_t>("concurrency", 'c', "Number of searches in flight at most.", false, 8);
+    options.add<float>("rate", 'r', "Searches per second, sent whether or not the earlier ones have been "
+                                    "answered. 0 sends each search as soon as a worker is free.", false, 0.0f);
+    options.add<uint32_t>("duration", 'd', "Seconds to run for. 0 replays the query log `loops` times.", false, 0);
+    options.add<uint32_t>("loops", '\0', "Number of times to replay the query log, when no duration is given.",
+                          false, 1);
+
+    options.add<std::string>("import-file", '\0', "JSONL documents to import while searching.", false, "");
+    options.add<std::string>("import-collection", '\0', "Collection to import the documents into.", false, "");
+    options.add<uint32_t>("import-batch-size", '\0', "Number of documents in each import.", false,
+                          LoadReplayer::DEFAULT_IMPORT_BATCH_SIZE);
+    options.add<float>("import-rate", '\0', "Imports per second.", false, 1.0f);
+
+    options.parse_check(argc, argv);
+
+    std::vector<replay_request_t> searches;
+    auto load_op = LoadReplayer::load_query_log(options.get<std::string>("query-log"), searches);
+    if(!load_op.ok()) {
+        std::cerr << load_op.error() << std::endl;
+        return 1;
+    }
+
+    std::vector<replay_request_t> imports;
+    const std::string& import_file = options.get<std::string>("import-file");
+
+    if(!import_file.empty()) {
+        if(options.get<std::string>("import-collection").empty()) {
+            std::cerr << "An `import-collection` is needed to import documents." << std::endl;
+            return 1;
+        }
+
+        load_op = LoadReplayer::load_import_batches(import_file, options.get<std::string>("import-collection"),
+                                                    options.get<uint32_t>("import-batch-size"), imports);
+        if(!load_op.ok()) {
+            std::cerr << load_op.error() << std::endl;
+            return 1;
+        }
+    }
+
+    load_replay_config_t config;
+    config.concurrency = options.get<uint32_t>("concurrency");
+    config.rate = options.get<float>("rate");
+    config.duration_ms = uint64_t(options.get<uint32_t>("duration")) * 1000;
+    config.num_loops = options.get<uint32_t>("loops");
+    config.import_rate = imports.empty() ? 0 : options.get<float>("import-rate");
+
+    curl_global_init(CURL_GLOBAL_SSL);
+    HttpClient::get_instance().init(options.get<std::string>("api-key"));
+
+    const std::string base_url = options.get<std::string>("url");
+
+    LoadReplayer replayer(config, [&base_url](const replay_request_t& request) {
+        std::string response;
+        std::map<std::string, std::string> res_headers;
+
+        if(request.body.empty()) {
+            return HttpClient::get_response(base_url + request.path, response, res_headers);
+        }
+
+        return HttpClient::post_response(base_url + request.path, request.body, response, res_headers);
+    });
+
+    replayer.run(searches, imports);
+
+    std::cout << replayer.get_report().dump(2) << std::endl;
+
+    curl_global_cleanup();
+    return 0;
+}
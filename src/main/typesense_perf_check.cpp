@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <cmdline.h>
+#include "perf_baseline.h"
+
+/*
+    Compares the JSON results of `typesense-bench` against the baseline, printing a line for each benchmark of the
+    baseline, and exits with 1 when any of them regressed or is missing. With `--update`, writes the times of the
+    results into the baseline instead (adding the benchmarks that it does not have yet), for when a change is known to
+    alter them or the reference machine changes.
+*/
+
+static Option<nlohmann::json> read_json(const std::string& path) {
+    std::ifstream infile(path);
+    if(!infile.is_open()) {
+        return Option<nlohmann::json>(404, "Could not open " + path);
+    }
+
+    try {
+        return Option<nlohmann::json>(nlohmann::json::parse(infile));
+    } catch(const std::exception& e) {
+        return Option<nlohmann::json>(400, "Could not parse " + path + ": " + e.what());
+    }
+}
+
+int main(int argc, char* argv[]) {
+    cmdline::parser options;
+    options.set_program_name("./typesense-perf-check");
+
+    options.add<std::string>("results", 'r', "JSON output of typesense-bench.", true);
+    options.add<std::string>("baseline", 'b', "Baseline to compare against.", true);
+    options.add("update", '\0', "Write the times of the results into the baseline.");
+
+    options.parse_check(argc, argv);
+
+    auto results_op = read_json(options.get<std::string>("results"));
+    auto baseline_op = read_json(options.get<std::string>("baseline"));
+
+    if(!results_op.ok() || !baseline_op.ok()) {
+        std::cerr << (results_op.ok() ? baseline_op.error() : results_op.error()) << std::endl;
+        return 2;
+    }
+
+    std::map<std::string, double> cpu_times;
+    auto parse_op = PerfBaseline::parse_results(results_op.get(), cpu_times);
+    if(!parse_op.ok()) {
+        std::cerr << parse_op.error() << std::endl;
+        return 2;
+    }
+
+    if(options.exist("update")) {
+        std::ofstream outfile(options.get<std::string>("baseline"));
+        outfile << PerfBaseline::update(baseline_op.get(), cpu_times).dump(2) << std::endl;
+        return 0;
+    }
+
+    std::vector<perf_comparison_t> comparisons;
+    auto compare_op = PerfBaseline::compare(baseline_op.get(), cpu_times, comparisons);
+    if(!compare_op.ok()) {
+        std::cerr << compare_op.error() << std::endl;
+        return 2;
+    }
+
+    for(const auto& comparison: comparisons) {
+        printf("%-10s %-60s baseline %14.0f ns, now %14.0f ns (x%.2f, tolerance %.0f%%)\n",
+               PerfBaseline::status_name(comparison.status), comparison.name.c_str(), comparison.baseline_ns,
+               comparison.result_ns, comparison.ratio(), comparison.tolerance * 100);
+    }
+
+    return PerfBaseline::has_failed(comparisons) ? 1 : 0;
+}
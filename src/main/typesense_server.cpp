@@ -67,6 +67,7 @@ void master_server_routes() {
     // meta
     server->get("/metrics.json", get_metrics_json);
     server->get("/stats.json", get_stats_json);
+    server->get("/metrics", get_metrics_text);
     server->get("/debug", get_debug);
     server->get("/health", get_health);
     server->post("/health", post_health);
@@ -75,6 +76,8 @@ void master_server_routes() {
     server->post("/operations/snapshot", post_snapshot, false, true);
     server->post("/operations/vote", post_vote, false, false);
     server->post("/operations/cache/clear", post_clear_cache, false, false);
+    server->post("/operations/dump", post_dump_collection, false, false);
+    server->post("/operations/restore", post_restore_collection, false, false);
 
     server->post("/config", post_config, false, false);
 }
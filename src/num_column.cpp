@@ -0,0 +1,192 @@
+#include "num_column.h"
+#include <algorithm>
+#include "memory_usage.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <sse2neon.h>
+#endif
+
+void num_column_t::insert(uint32_t id, int64_t value) {
+    if(ids.empty() || id >= ids.back()) {
+        if(ids.size() % 64 == 0) {
+            dead_words.push_back(0);
+        }
+
+        ids.push_back(id);
+        values.push_back(value);
+        return ;
+    }
+
+    const auto id_begin = std::lower_bound(ids.begin(), ids.end(), id);
+    const auto id_end = std::upper_bound(id_begin, ids.end(), id);
+
+    for(auto it = id_begin; it != id_end; it++) {
+        const size_t slot = it - ids.begin();
+        uint64_t& dead_word = dead_words[slot / 64];
+        const uint64_t bit = uint64_t(1) << (slot % 64);
+
+        if(dead_word & bit) {
+            dead_word &= ~bit;
+            values[slot] = value;
+            num_dead--;
+            return ;
+        }
+    }
+
+    // no slot to reuse: inserting shifts the slots that follow along with their dead bits, so we drop them first
+    compact();
+
+    const size_t slot = std::upper_bound(ids.begin(), ids.end(), id) - ids.begin();
+    ids.insert(ids.begin() + slot, id);
+    values.insert(values.begin() + slot, value);
+    dead_words.assign((ids.size() + 63) / 64, 0);
+}
+
+void num_column_t::remove(uint32_t id, int64_t value) {
+    const auto id_begin = std::lower_bound(ids.begin(), ids.end(), id);
+
+    for(auto it = id_begin; it != ids.end() && *it == id; it++) {
+        const size_t slot = it - ids.begin();
+        uint64_t& dead_word = dead_words[slot / 64];
+        const uint64_t bit = uint64_t(1) << (slot % 64);
+
+        if(values[slot] == value && !(dead_word & bit)) {
+            dead_word |= bit;
+            num_dead++;
+            break;
+        }
+    }
+
+    if(num_dead * 2 > ids.size()) {
+        compact();
+    }
+}
+
+void num_column_t::compact() {
+    if(num_dead == 0) {
+        return ;
+    }
+
+    size_t num_live = 0;
+
+    for(size_t slot = 0; slot < ids.size(); slot++) {
+        if(dead_words[slot / 64] & (uint64_t(1) << (slot % 64))) {
+            continue;
+        }
+
+        ids[num_live] = ids[slot];
+        values[num_live] = values[slot];
+        num_live++;
+    }
+
+    ids.resize(num_live);
+    values.resize(num_live);
+    dead_words.assign((num_live + 63) / 64, 0);
+    num_dead = 0;
+}
+
+size_t num_column_t::size() const {
+    return ids.size() - num_dead;
+}
+
+size_t num_column_t::num_slots() const {
+    return ids.size();
+}
+
+size_t num_column_t::memory_bytes() const {
+    return memory_usage::vector_bytes(ids) + memory_usage::vector_bytes(values) +
+           memory_usage::vector_bytes(dead_words);
+}
+
+void num_column_t::range_inclusive_scan_scalar(const int64_t* values, size_t n, int64_t start, int64_t end,
+                                               uint64_t* match_words) {
+    for(size_t i = 0; i < n; i += 64) {
+        const size_t block_size = std::min<size_t>(64, n - i);
+        uint64_t word = 0;
+
+        // branch free, so that the compiler is free to vectorize it
+        for(size_t j = 0; j < block_size; j++) {
+            word |= uint64_t((values[i + j] >= start) & (values[i + j] <= end)) << j;
+        }
+
+        match_words[i / 64] = word;
+    }
+}
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+#endif
+static void range_inclusive_scan_simd(const int64_t* values, size_t n, int64_t start, int64_t end,
+                                      uint64_t* match_words) {
+    // x in [start, end] <=> !(x < start) && !(x > end)
+    const __m128i start_v = _mm_set1_epi64x(start);
+    const __m128i end_v = _mm_set1_epi64x(end);
+    const size_t num_full_words = n / 64;
+
+    for(size_t w = 0; w < num_full_words; w++) {
+        const int64_t* block = values + w * 64;
+        uint64_t word = 0;
+
+        for(size_t j = 0; j < 64; j += 2) {
+            const __m128i v = _mm_loadu_si128((const __m128i*) (block + j));
+            const __m128i outside = _mm_or_si128(_mm_cmpgt_epi64(start_v, v), _mm_cmpgt_epi64(v, end_v));
+            const uint64_t outside_mask = _mm_movemask_pd(_mm_castsi128_pd(outside));
+            word |= ((~outside_mask) & 3) << j;
+        }
+
+        match_words[w] = word;
+    }
+
+    if(num_full_words * 64 < n) {
+        num_column_t::range_inclusive_scan_scalar(values + num_full_words * 64, n - num_full_words * 64,
+                                                  start, end, match_words + num_full_words);
+    }
+}
+
+#endif
+
+typedef void (*range_scan_fn_t)(const int64_t*, size_t, int64_t, int64_t, uint64_t*);
+
+static range_scan_fn_t resolve_range_inclusive_scan() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse4.2")) {
+        return range_inclusive_scan_simd;
+    }
+
+    return num_column_t::range_inclusive_scan_scalar;
+#elif defined(__aarch64__)
+    return range_inclusive_scan_simd;
+#else
+    return num_column_t::range_inclusive_scan_scalar;
+#endif
+}
+
+void num_column_t::range_inclusive_scan(int64_t start, int64_t end, std::vector<uint32_t>& out) const {
+    static const range_scan_fn_t scan_fn = resolve_range_inclusive_scan();
+
+    if(ids.empty() || start > end) {
+        return ;
+    }
+
+    std::vector<uint64_t> match_words((ids.size() + 63) / 64);
+    scan_fn(values.data(), values.size(), start, end, match_words.data());
+
+    for(size_t w = 0; w < match_words.size(); w++) {
+        uint64_t word = match_words[w] & ~dead_words[w];
+
+        while(word != 0) {
+            const uint32_t id = ids[w * 64 + __builtin_ctzll(word)];
+            word &= (word - 1);
+
+            // the slots of an id are adjacent, so duplicates can only follow each other
+            if(out.empty() || out.back() != id) {
+                out.push_back(id);
+            }
+        }
+    }
+}
@@ -1,17 +1,61 @@
 #include "num_tree.h"
 #include "parasort.h"
 #include "timsort.hpp"
+#include "memory_usage.h"
+
+num_tree_t::num_tree_t(bool has_column): has_column(has_column) {
+
+}
 
 void num_tree_t::insert(int64_t value, uint32_t id) {
     if (int64map.count(value) == 0) {
         int64map.emplace(value, SET_COMPACT_IDS(compact_id_list_t::create(1, {id})));
     } else {
         auto ids = int64map[value];
-        if (!ids_t::contains(ids, id)) {
-            ids_t::upsert(ids, id);
-            int64map[value] = ids;
+        if (ids_t::contains(ids, id)) {
+            return ;
+        }
+
+        ids_t::upsert(ids, id);
+        int64map[value] = ids;
+    }
+
+    if(has_column) {
+        column.insert(id, value);
+    }
+}
+
+bool num_tree_t::prefer_column_scan(std::map<int64_t, void*>::const_iterator it,
+                                    std::map<int64_t, void*>::const_iterator end_it) const {
+    if(!has_column || column.size() < COLUMN_SCAN_MIN_VALUES) {
+        return false;
+    }
+
+    // estimate the selectivity from the sizes of the id lists, stopping as soon as it is known to be large
+    const size_t max_tree_ids = column.num_slots() / COLUMN_SCAN_SELECTIVITY;
+    size_t num_tree_ids = 0;
+
+    while(it != end_it) {
+        num_tree_ids += ids_t::num_ids(it->second);
+        if(num_tree_ids > max_tree_ids) {
+            return true;
         }
+
+        it++;
     }
+
+    return false;
+}
+
+void num_tree_t::column_range_search(int64_t start, int64_t end, uint32_t** ids, size_t& ids_len) const {
+    std::vector<uint32_t> column_ids;
+    column.range_inclusive_scan(start, end, column_ids);
+
+    uint32_t *out = nullptr;
+    ids_len = ArrayUtils::or_scalar(column_ids.data(), column_ids.size(), *ids, ids_len, &out);
+
+    delete [] *ids;
+    *ids = out;
 }
 
 void num_tree_t::range_inclusive_search(int64_t start, int64_t end, uint32_t** ids, size_t& ids_len) {
@@ -21,6 +65,11 @@ void num_tree_t::range_inclusive_search(int64_t start, int64_t end, uint32_t** i
 
     auto it_start = int64map.lower_bound(start);  // iter values will be >= start
 
+    if(start <= end && prefer_column_scan(it_start, int64map.upper_bound(end))) {
+        column_range_search(start, end, ids, ids_len);
+        return ;
+    }
+
     std::vector<uint32_t> consolidated_ids;
     while(it_start != int64map.end() && it_start->first <= end) {
         uint32_t* values = ids_t::uncompress(it_start->second);
@@ -35,8 +84,11 @@ void num_tree_t::range_inclusive_search(int64_t start, int64_t end, uint32_t** i
 
     gfx::timsort(consolidated_ids.begin(), consolidated_ids.end());
 
+    // an array field can hold several values of the range for the same id
+    consolidated_ids.erase(unique(consolidated_ids.begin(), consolidated_ids.end()), consolidated_ids.end());
+
     uint32_t *out = nullptr;
-    ids_len = ArrayUtils::or_scalar(&consolidated_ids[0], consolidated_ids.size(),
+    ids_len = ArrayUtils::or_scalar(consolidated_ids.data(), consolidated_ids.size(),
                                     *ids, ids_len, &out);
 
     delete [] *ids;
@@ -87,6 +139,11 @@ void num_tree_t::search(NUM_COMPARATOR comparator, int64_t value, uint32_t** ids
             iter_ge_value++;
         }
 
+        if(iter_ge_value != int64map.end() && prefer_column_scan(iter_ge_value, int64map.end())) {
+            column_range_search(iter_ge_value->first, INT64_MAX, ids, ids_len);
+            return ;
+        }
+
         std::vector<uint32_t> consolidated_ids;
         while(iter_ge_value != int64map.end()) {
             uint32_t* values = ids_t::uncompress(iter_ge_value->second);
@@ -104,7 +161,7 @@ void num_tree_t::search(NUM_COMPARATOR comparator, int64_t value, uint32_t** ids
         consolidated_ids.erase(unique(consolidated_ids.begin(), consolidated_ids.end()), consolidated_ids.end());
 
         uint32_t *out = nullptr;
-        ids_len = ArrayUtils::or_scalar(&consolidated_ids[0], consolidated_ids.size(),
+        ids_len = ArrayUtils::or_scalar(consolidated_ids.data(), consolidated_ids.size(),
                                         *ids, ids_len, &out);
 
         delete [] *ids;
@@ -114,6 +171,12 @@ void num_tree_t::search(NUM_COMPARATOR comparator, int64_t value, uint32_t** ids
         // iter entries will be >= value, or end() if all entries are before value
         auto iter_ge_value = int64map.lower_bound(value);
 
+        auto iter_end = (comparator == LESS_THAN_EQUALS) ? int64map.upper_bound(value) : iter_ge_value;
+        if(iter_end != int64map.begin() && prefer_column_scan(int64map.begin(), iter_end)) {
+            column_range_search(INT64_MIN, std::prev(iter_end)->first, ids, ids_len);
+            return ;
+        }
+
         std::vector<uint32_t> consolidated_ids;
         auto it = int64map.begin();
 
@@ -141,7 +204,7 @@ void num_tree_t::search(NUM_COMPARATOR comparator, int64_t value, uint32_t** ids
         consolidated_ids.erase(unique(consolidated_ids.begin(), consolidated_ids.end()), consolidated_ids.end());
 
         uint32_t *out = nullptr;
-        ids_len = ArrayUtils::or_scalar(&consolidated_ids[0], consolidated_ids.size(),
+        ids_len = ArrayUtils::or_scalar(consolidated_ids.data(), consolidated_ids.size(),
                                         *ids, ids_len, &out);
 
         delete [] *ids;
@@ -152,21 +215,161 @@ void num_tree_t::search(NUM_COMPARATOR comparator, int64_t value, uint32_t** ids
 void num_tree_t::remove(uint64_t value, uint32_t id) {
     if(int64map.count(value) != 0) {
         void* arr = int64map[value];
+        if(has_column && ids_t::contains(arr, id)) {
+            column.remove(id, value);
+        }
+
         ids_t::erase(arr, id);
 
         if(ids_t::num_ids(arr) == 0) {
             ids_t::destroy_list(arr);
             int64map.erase(value);
+            values_to_compact.erase(value);
         } else {
             int64map[value] = arr;
+
+            if(ids_t::is_fragmented(arr)) {
+                values_to_compact.insert(value);
+            }
+        }
+    }
+}
+
+size_t num_tree_t::compact(size_t max_lists) {
+    size_t num_lists = 0;
+
+    while(num_lists < max_lists && !values_to_compact.empty()) {
+        const auto value_it = values_to_compact.begin();
+        const auto it = int64map.find(*value_it);
+        values_to_compact.erase(value_it);
+        num_lists++;
+
+        // inserts since the removal might have filled the list up again
+        if(it != int64map.end()) {
+            ids_t::compact(it->second);
         }
     }
+
+    return num_lists;
+}
+
+size_t num_tree_t::approx_num_ids(NUM_COMPARATOR comparator, int64_t value) const {
+    if(int64map.empty()) {
+        return 0;
+    }
+
+    if(comparator == EQUALS) {
+        const auto it = int64map.find(value);
+        return (it == int64map.end()) ? 0 : ids_t::num_ids(it->second);
+    }
+
+    if(comparator == GREATER_THAN && value == INT64_MAX) {
+        return 0;
+    }
+
+    if(comparator == LESS_THAN && value == INT64_MIN) {
+        return 0;
+    }
+
+    if(comparator == GREATER_THAN || comparator == GREATER_THAN_EQUALS) {
+        const int64_t start = (comparator == GREATER_THAN) ? value + 1 : value;
+        return approx_range_num_ids(start, int64map.rbegin()->first);
+    }
+
+    if(comparator == LESS_THAN || comparator == LESS_THAN_EQUALS) {
+        const int64_t end = (comparator == LESS_THAN) ? value - 1 : value;
+        return approx_range_num_ids(int64map.begin()->first, end);
+    }
+
+    return approx_range_num_ids(int64map.begin()->first, int64map.rbegin()->first);
+}
+
+size_t num_tree_t::approx_range_num_ids(int64_t start, int64_t end) const {
+    if(int64map.empty()) {
+        return 0;
+    }
+
+    const int64_t min_value = int64map.begin()->first;
+    const int64_t max_value = int64map.rbegin()->first;
+
+    start = std::max(start, min_value);
+    end = std::min(end, max_value);
+
+    if(start > end) {
+        return 0;
+    }
+
+    // without a column, the number of distinct values is the best bound we have
+    const size_t num_ids = has_column ? column.size() : int64map.size();
+
+    if(min_value == max_value) {
+        return num_ids;
+    }
+
+    const long double fraction = ((long double) end - start + 1) / ((long double) max_value - min_value + 1);
+    return size_t(fraction * num_ids);
+}
+
+bool num_tree_t::top_ids(bool ascending, size_t num_ids, const uint32_t* filter_ids, size_t filter_ids_length,
+                         size_t max_scanned_ids, std::vector<uint32_t>& ids) const {
+    size_t num_scanned_ids = 0;
+
+    auto take_value_ids = [&](void* value_ids) {
+        const size_t num_value_ids = ids_t::num_ids(value_ids);
+        num_scanned_ids += num_value_ids;
+
+        if(num_scanned_ids > max_scanned_ids) {
+            return false;
+        }
+
+        uint32_t* values = ids_t::uncompress(value_ids);
+
+        if(filter_ids_length == 0) {
+            ids.insert(ids.end(), values, values + num_value_ids);
+        } else {
+            // the filter is usually much larger than the ids of a value, so they are looked up in it
+            for(size_t i = 0; i < num_value_ids; i++) {
+                if(std::binary_search(filter_ids, filter_ids + filter_ids_length, values[i])) {
+                    ids.push_back(values[i]);
+                }
+            }
+        }
+
+        delete [] values;
+        return true;
+    };
+
+    if(ascending) {
+        for(auto it = int64map.begin(); it != int64map.end() && ids.size() < num_ids; it++) {
+            if(!take_value_ids(it->second)) {
+                return false;
+            }
+        }
+    } else {
+        for(auto it = int64map.rbegin(); it != int64map.rend() && ids.size() < num_ids; it++) {
+            if(!take_value_ids(it->second)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
 size_t num_tree_t::size() {
     return int64map.size();
 }
 
+size_t num_tree_t::memory_bytes() const {
+    size_t bytes = sizeof(num_tree_t) + memory_usage::map_bytes(int64map) + column.memory_bytes();
+
+    for(const auto& kv: int64map) {
+        bytes += ids_t::memory_bytes(kv.second);
+    }
+
+    return bytes;
+}
+
 num_tree_t::~num_tree_t() {
     for(auto& kv: int64map) {
         ids_t::destroy_list(kv.second);
@@ -0,0 +1,81 @@
+#include "numa_topology.h"
+#include <dirent.h>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include "string_utils.h"
+
+bool numa_topology_t::parse_cpu_list(const std::string& cpu_list, std::vector<size_t>& cpus) {
+    std::vector<std::string> ranges;
+    StringUtils::split(cpu_list, ranges, ",");
+
+    for(const std::string& range: ranges) {
+        const size_t dash_pos = range.find('-');
+        const std::string& first_str = range.substr(0, dash_pos);
+        const std::string& last_str = (dash_pos == std::string::npos) ? first_str : range.substr(dash_pos + 1);
+
+        if(!StringUtils::is_uint32_t(first_str) || !StringUtils::is_uint32_t(last_str)) {
+            return false;
+        }
+
+        const size_t first = std::stoul(first_str);
+        const size_t last = std::stoul(last_str);
+
+        if(last < first) {
+            return false;
+        }
+
+        for(size_t cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return true;
+}
+
+numa_topology_t numa_topology_t::detect(const std::string& node_dir_path) {
+    std::vector<std::pair<size_t, std::vector<size_t>>> nodes;
+    DIR* node_dir = opendir(node_dir_path.c_str());
+
+    if(node_dir != nullptr) {
+        struct dirent* entry;
+
+        while((entry = readdir(node_dir)) != nullptr) {
+            const std::string name = entry->d_name;
+            if(name.rfind("node", 0) != 0 || !StringUtils::is_uint32_t(name.substr(4))) {
+                continue;
+            }
+
+            std::ifstream cpu_list_in(node_dir_path + "/" + name + "/cpulist");
+            std::string cpu_list;
+            std::vector<size_t> cpus;
+
+            // a node of memory alone has no cpus to pin to
+            if(std::getline(cpu_list_in, cpu_list) && parse_cpu_list(StringUtils::trim(cpu_list), cpus) &&
+               !cpus.empty()) {
+                nodes.emplace_back(std::stoul(name.substr(4)), std::move(cpus));
+            }
+        }
+
+        closedir(node_dir);
+    }
+
+    std::sort(nodes.begin(), nodes.end());
+
+    numa_topology_t topology;
+
+    for(auto& node: nodes) {
+        topology.node_cpus.push_back(std::move(node.second));
+    }
+
+    if(topology.node_cpus.empty()) {
+        std::vector<size_t> cpus(std::max<size_t>(1, std::thread::hardware_concurrency()));
+        for(size_t cpu = 0; cpu < cpus.size(); cpu++) {
+            cpus[cpu] = cpu;
+        }
+
+        topology.node_cpus.push_back(std::move(cpus));
+    }
+
+    return topology;
+}
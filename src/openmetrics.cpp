@@ -0,0 +1,93 @@
+#include "openmetrics.h"
+#include <cmath>
+#include <cstdio>
+
+void openmetrics_writer_t::append_value(std::string& out, double value) {
+    if(std::isnan(value)) {
+        out += "NaN";
+    } else if(std::isinf(value)) {
+        out += (value > 0) ? "+Inf" : "-Inf";
+    } else if(value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+        // integral values, such as counts and bytes, are written exactly
+        out += std::to_string(int64_t(value));
+    } else {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.10g", value);
+        out += buf;
+    }
+}
+
+std::string openmetrics_writer_t::escape_label_value(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+
+    for(char c: value) {
+        if(c == '\\') {
+            escaped += "\\\\";
+        } else if(c == '"') {
+            escaped += "\\\"";
+        } else if(c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+void openmetrics_writer_t::family(const std::string& name, const std::string& type, const std::string& help) {
+    out += "# TYPE " + name + " " + type + "\n";
+    out += "# HELP " + name + " " + help + "\n";
+}
+
+void openmetrics_writer_t::sample(const std::string& name, const labels_t& labels, double value) {
+    out += name;
+
+    if(!labels.empty()) {
+        out += "{";
+
+        for(size_t i = 0; i < labels.size(); i++) {
+            if(i != 0) {
+                out += ",";
+            }
+
+            out += labels[i].first + "=\"" + escape_label_value(labels[i].second) + "\"";
+        }
+
+        out += "}";
+    }
+
+    out += " ";
+    append_value(out, value);
+    out += "\n";
+}
+
+void openmetrics_writer_t::histogram(const std::string& name, const labels_t& labels,
+                                     const std::vector<std::pair<double, uint64_t>>& buckets,
+                                     uint64_t num_past_buckets, double sum) {
+    labels_t bucket_labels = labels;
+    bucket_labels.emplace_back("le", "");
+
+    // bucket counts are cumulative
+    uint64_t count = 0;
+
+    for(const auto& bucket: buckets) {
+        count += bucket.second;
+        bucket_labels.back().second.clear();
+        append_value(bucket_labels.back().second, bucket.first);
+        sample(name + "_bucket", bucket_labels, count);
+    }
+
+    count += num_past_buckets;
+    bucket_labels.back().second = "+Inf";
+    sample(name + "_bucket", bucket_labels, count);
+
+    sample(name + "_count", labels, count);
+    sample(name + "_sum", labels, sum);
+}
+
+std::string openmetrics_writer_t::finish() {
+    out += "# EOF\n";
+    return std::move(out);
+}
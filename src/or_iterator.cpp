@@ -73,6 +73,9 @@ void or_iterator_t::advance_non_largest(std::vector<or_iterator_t>& its) {
             if(!valid) {
                 its.erase(its.begin() + i);
                 i--;
+            } else if(its[i].id() > greatest_value) {
+                // leapfrog: the remaining iterators can skip straight past ids that this one does not contain
+                greatest_value = its[i].id();
             }
         }
     }
@@ -92,6 +95,35 @@ void or_iterator_t::advance_non_largest2(std::vector<or_iterator_t>& its) {
     }
 }
 
+bool or_iterator_t::current_blocks_range(const std::vector<or_iterator_t>& its, uint32_t& start, uint32_t& end) {
+    start = 0;
+    end = UINT32_MAX;
+
+    for(const auto& it: its) {
+        if(!it.valid()) {
+            return false;
+        }
+
+        start = std::max(start, it.id());
+
+        for(const auto& sub_it: it.its) {
+            end = std::min(end, sub_it.last_block_id());
+        }
+    }
+
+    return start <= end;
+}
+
+void or_iterator_t::skip_all_to(std::vector<or_iterator_t>& its, uint32_t id) {
+    for(size_t i = 0; i < its.size(); i++) {
+        bool valid = its[i].skip_to(id);
+        if(!valid) {
+            its.erase(its.begin() + i);
+            i--;
+        }
+    }
+}
+
 bool or_iterator_t::valid() const {
     return !its.empty();
 }
@@ -120,6 +152,32 @@ bool or_iterator_t::next() {
 void or_iterator_t::advance_smallest() {
     // we will advance the smallest value and point current_index to next smallest value across the lists
     auto smallest_value = its[curr_index].id();
+
+    if(!losers.empty()) {
+        // only the lists that hold the smallest value are advanced, each in O(log(num_lists))
+        bool list_ended = false;
+
+        while(its[curr_index].valid() && its[curr_index].id() == smallest_value) {
+            its[curr_index].next();
+            list_ended = list_ended || !its[curr_index].valid();
+            replay_loser_tree(curr_index);
+        }
+
+        if(list_ended) {
+            for(int i = 0; i < int(its.size()); i++) {
+                if(!its[i].valid()) {
+                    its[i].reset_cache();
+                    its.erase(its.cbegin() + i);
+                    i--;
+                }
+            }
+
+            build_loser_tree();
+        }
+
+        return;
+    }
+
     curr_index = 0;
 
     for(int i = 0; i < int(its.size()); i++) {
@@ -143,6 +201,84 @@ void or_iterator_t::advance_smallest() {
     }
 }
 
+uint32_t or_iterator_t::tree_key(uint32_t index) const {
+    return its[index].valid() ? its[index].id() : UINT32_MAX;
+}
+
+void or_iterator_t::build_loser_tree() {
+    const size_t num_lists = its.size();
+
+    if(num_lists < LOSER_TREE_MIN_LISTS) {
+        losers.clear();
+
+        curr_index = 0;
+        for(size_t i = 1; i < num_lists; i++) {
+            if(its[i].id() < its[curr_index].id()) {
+                curr_index = i;
+            }
+        }
+
+        return;
+    }
+
+    // winners of the matches at each node, computed bottom up
+    std::vector<uint32_t> winners(2 * num_lists);
+    losers.assign(num_lists, 0);
+
+    for(size_t i = 0; i < num_lists; i++) {
+        winners[num_lists + i] = i;
+    }
+
+    for(size_t node = num_lists - 1; node >= 1; node--) {
+        const uint32_t left = winners[2 * node];
+        const uint32_t right = winners[2 * node + 1];
+
+        if(tree_key(left) <= tree_key(right)) {
+            winners[node] = left;
+            losers[node] = right;
+        } else {
+            winners[node] = right;
+            losers[node] = left;
+        }
+    }
+
+    curr_index = winners[1];
+}
+
+void or_iterator_t::replay_loser_tree(uint32_t index) {
+    // replays the matches on the path from the leaf of `index` to the root
+    uint32_t winner = index;
+
+    for(size_t node = (its.size() + index) / 2; node >= 1; node /= 2) {
+        if(tree_key(losers[node]) < tree_key(winner)) {
+            std::swap(losers[node], winner);
+        }
+    }
+
+    curr_index = winner;
+}
+
+void or_iterator_t::merge(std::vector<posting_list_t::iterator_t>& its, std::vector<uint32_t>& result_ids,
+                          uint32_t max_id) {
+    for(size_t i = 0; i < its.size(); i++) {
+        if(!its[i].valid()) {
+            its.erase(its.begin() + i);
+            i--;
+        }
+    }
+
+    if(its.empty()) {
+        return;
+    }
+
+    or_iterator_t it(its);
+
+    while(it.valid() && it.id() <= max_id) {
+        result_ids.push_back(it.id());
+        it.next();
+    }
+}
+
 bool or_iterator_t::skip_to(uint32_t id) {
     auto current_value = UINT32_MAX;
     curr_index = 0;
@@ -163,6 +299,10 @@ bool or_iterator_t::skip_to(uint32_t id) {
         }
     }
 
+    if(!losers.empty()) {
+        build_loser_tree();
+    }
+
     return !its.empty();
 }
 
@@ -174,12 +314,9 @@ bool or_iterator_t::take_id(result_iter_state_t& istate, uint32_t id, bool& is_e
     is_excluded = false;
 
     // decide if this result id should be excluded
-    if(istate.excluded_result_ids_size != 0) {
-        if (std::binary_search(istate.excluded_result_ids,
-                               istate.excluded_result_ids + istate.excluded_result_ids_size, id)) {
-            is_excluded = true;
-            return false;
-        }
+    if(istate.is_excluded(id)) {
+        is_excluded = true;
+        return false;
     }
 
     // decide if this result be matched with filter results
@@ -212,23 +349,19 @@ bool or_iterator_t::take_id(result_iter_state_t& istate, uint32_t id, bool& is_e
 }
 
 or_iterator_t::or_iterator_t(std::vector<posting_list_t::iterator_t>& its): its(std::move(its)) {
-    curr_index = 0;
-
-    for(size_t i = 1; i < this->its.size(); i++) {
-        if(this->its[i].id() < this->its[curr_index].id()) {
-            curr_index = i;
-        }
-    }
+    build_loser_tree();
 }
 
 or_iterator_t::or_iterator_t(or_iterator_t&& rhs) noexcept {
     its = std::move(rhs.its);
     curr_index = rhs.curr_index;
+    losers = std::move(rhs.losers);
 }
 
 or_iterator_t& or_iterator_t::operator=(or_iterator_t&& rhs) noexcept {
     its = std::move(rhs.its);
     curr_index = rhs.curr_index;
+    losers = std::move(rhs.losers);
     return *this;
 }
 
@@ -0,0 +1,117 @@
+#include "override_index.h"
+#include <algorithm>
+#include "string_utils.h"
+
+void override_index_t::split_words(const std::string& text, std::vector<std::string>& words) {
+    words.clear();
+    size_t word_start = 0;
+
+    for(size_t i = 0; i <= text.size(); i++) {
+        if(i == text.size() || text[i] == ' ') {
+            words.push_back(text.substr(word_start, i - word_start));
+            word_start = i + 1;
+        }
+    }
+}
+
+void override_index_t::insert(const std::string& id, const std::string& rule_query, bool exact) {
+    if(exact) {
+        exact_ids[rule_query].push_back(id);
+        return ;
+    }
+
+    std::vector<std::string> words;
+    split_words(rule_query, words);
+    uint32_t node_id = 0;
+
+    for(const auto& word: words) {
+        auto child_it = nodes[node_id].children.find(word);
+        if(child_it == nodes[node_id].children.end()) {
+            const uint32_t child_id = nodes.size();
+            nodes[node_id].children.emplace(word, child_id);
+            nodes.emplace_back();
+            node_id = child_id;
+        } else {
+            node_id = child_it->second;
+        }
+    }
+
+    nodes[node_id].ids.push_back(id);
+}
+
+void override_index_t::remove(const std::string& id, const std::string& rule_query, bool exact) {
+    if(exact) {
+        auto exact_it = exact_ids.find(rule_query);
+        if(exact_it == exact_ids.end()) {
+            return ;
+        }
+
+        auto& ids = exact_it->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+        if(ids.empty()) {
+            exact_ids.erase(exact_it);
+        }
+
+        return ;
+    }
+
+    std::vector<std::string> words;
+    split_words(rule_query, words);
+    uint32_t node_id = 0;
+
+    for(const auto& word: words) {
+        auto child_it = nodes[node_id].children.find(word);
+        if(child_it == nodes[node_id].children.end()) {
+            return ;
+        }
+
+        node_id = child_it->second;
+    }
+
+    auto& ids = nodes[node_id].ids;
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+}
+
+void override_index_t::match(const std::string& query, std::vector<std::string>& ids) const {
+    ids.clear();
+
+    auto exact_it = exact_ids.find(query);
+    if(exact_it != exact_ids.end()) {
+        ids.insert(ids.end(), exact_it->second.begin(), exact_it->second.end());
+    }
+
+    std::vector<std::string> words;
+    split_words(query, words);
+
+    size_t start_offset = 0;
+
+    for(size_t start_index = 0; start_index < words.size(); start_index++) {
+        uint32_t node_id = 0;
+        size_t end_offset = start_offset;
+
+        for(size_t i = start_index; i < words.size(); i++) {
+            auto child_it = nodes[node_id].children.find(words[i]);
+            if(child_it == nodes[node_id].children.end()) {
+                break;
+            }
+
+            node_id = child_it->second;
+            end_offset += (i == start_index ? 0 : 1) + words[i].size();
+
+            if(nodes[node_id].ids.empty()) {
+                continue;
+            }
+
+            // `contains_word()` only considers the first occurrence of a rule query, which might not be this one
+            const std::string rule_query = query.substr(start_offset, end_offset - start_offset);
+            if(StringUtils::contains_word(query, rule_query)) {
+                ids.insert(ids.end(), nodes[node_id].ids.begin(), nodes[node_id].ids.end());
+            }
+        }
+
+        start_offset += words[start_index].size() + 1;
+    }
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
@@ -0,0 +1,137 @@
+#include "perf_baseline.h"
+
+namespace {
+    Option<double> to_ns(double value, const std::string& time_unit) {
+        if(time_unit == "ns") {
+            return Option<double>(value);
+        } else if(time_unit == "us") {
+            return Option<double>(value * 1000);
+        } else if(time_unit == "ms") {
+            return Option<double>(value * 1000000);
+        } else if(time_unit == "s") {
+            return Option<double>(value * 1000000000);
+        }
+
+        return Option<double>(400, "Unknown time unit `" + time_unit + "`.");
+    }
+}
+
+Option<bool> PerfBaseline::parse_results(const nlohmann::json& results_json,
+                                         std::map<std::string, double>& cpu_times) {
+    if(!results_json.is_object() || results_json.count("benchmarks") == 0 ||
+       !results_json["benchmarks"].is_array()) {
+        return Option<bool>(400, "Results have no `benchmarks` array.");
+    }
+
+    // names of the benchmarks whose time comes from the median of their repetitions
+    std::map<std::string, bool> from_median;
+
+    for(const auto& benchmark: results_json["benchmarks"]) {
+        if(!benchmark.is_object() || !benchmark.contains("name") || !benchmark.contains("cpu_time")) {
+            return Option<bool>(400, "A benchmark of the results has no `name` or `cpu_time`.");
+        }
+
+        if(benchmark.value("error_occurred", false)) {
+            continue;
+        }
+
+        const std::string& run_type = benchmark.value("run_type", "iteration");
+        const bool is_median = (run_type == "aggregate" && benchmark.value("aggregate_name", "") == "median");
+
+        if(run_type == "aggregate" && !is_median) {
+            continue;
+        }
+
+        const std::string& name = benchmark.value("run_name", benchmark["name"].get<std::string>());
+        if(!is_median && from_median[name]) {
+            continue;
+        }
+
+        auto ns_op = to_ns(benchmark["cpu_time"].get<double>(), benchmark.value("time_unit", "ns"));
+        if(!ns_op.ok()) {
+            return Option<bool>(ns_op.code(), ns_op.error());
+        }
+
+        // without a median, the last repetition stands
+        cpu_times[name] = ns_op.get();
+        from_median[name] = is_median;
+    }
+
+    return Option<bool>(true);
+}
+
+Option<bool> PerfBaseline::compare(const nlohmann::json& baseline_json, const std::map<std::string, double>& cpu_times,
+                                   std::vector<perf_comparison_t>& comparisons) {
+    if(!baseline_json.is_object() || baseline_json.count("benchmarks") == 0 ||
+       !baseline_json["benchmarks"].is_object()) {
+        return Option<bool>(400, "Baseline has no `benchmarks` object.");
+    }
+
+    const double default_tolerance = baseline_json.value("tolerance", DEFAULT_TOLERANCE);
+
+    for(const auto& item: baseline_json["benchmarks"].items()) {
+        const nlohmann::json& baseline = item.value();
+
+        if(!baseline.is_object() || !baseline.contains("cpu_time_ns") || !baseline["cpu_time_ns"].is_number()) {
+            return Option<bool>(400, "Baseline of `" + item.key() + "` has no `cpu_time_ns`.");
+        }
+
+        perf_comparison_t comparison;
+        comparison.name = item.key();
+        comparison.baseline_ns = baseline["cpu_time_ns"].get<double>();
+        comparison.tolerance = baseline.value("tolerance", default_tolerance);
+
+        const auto cpu_time_it = cpu_times.find(item.key());
+
+        if(cpu_time_it == cpu_times.end()) {
+            comparison.status = perf_comparison_t::MISSING;
+        } else {
+            comparison.result_ns = cpu_time_it->second;
+
+            if(comparison.result_ns > comparison.baseline_ns * (1 + comparison.tolerance)) {
+                comparison.status = perf_comparison_t::REGRESSED;
+            } else if(comparison.result_ns < comparison.baseline_ns * (1 - comparison.tolerance)) {
+                comparison.status = perf_comparison_t::IMPROVED;
+            }
+        }
+
+        comparisons.push_back(comparison);
+    }
+
+    return Option<bool>(true);
+}
+
+nlohmann::json PerfBaseline::update(const nlohmann::json& baseline_json, const std::map<std::string, double>& cpu_times) {
+    nlohmann::json updated_json = baseline_json;
+
+    for(const auto& cpu_time: cpu_times) {
+        updated_json["benchmarks"][cpu_time.first]["cpu_time_ns"] = uint64_t(cpu_time.second);
+    }
+
+    return updated_json;
+}
+
+bool PerfBaseline::has_failed(const std::vector<perf_comparison_t>& comparisons) {
+    for(const auto& comparison: comparisons) {
+        if(comparison.status == perf_comparison_t::REGRESSED || comparison.status == perf_comparison_t::MISSING) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char* PerfBaseline::status_name(perf_comparison_t::status_t status) {
+    switch(status) {
+        case perf_comparison_t::OK:
+            return "ok";
+        case perf_comparison_t::IMPROVED:
+            return "improved";
+        case perf_comparison_t::REGRESSED:
+            return "regressed";
+        case perf_comparison_t::MISSING:
+            return "missing";
+    }
+
+    return "";
+}
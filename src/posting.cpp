@@ -1,5 +1,6 @@
 #include "posting.h"
 #include "posting_list.h"
+#include "or_iterator.h"
 
 int64_t compact_posting_list_t::upsert(const uint32_t id, const std::vector<uint32_t>& offsets) {
     return upsert(id, &offsets[0], offsets.size());
@@ -134,13 +135,42 @@ void compact_posting_list_t::erase(const uint32_t id) {
     ids_length--;
 }
 
+void compact_posting_list_t::erase_sorted(const uint32_t num_ids, const uint32_t* ids) {
+    size_t read_index = 0, write_index = 0, id_index = 0;
+    uint32_t num_erased = 0;
+
+    while(read_index < length) {
+        size_t entry_length = id_offsets[read_index] + 2;
+        uint32_t existing_id = id_offsets[read_index + entry_length - 1];
+
+        while(id_index < num_ids && ids[id_index] < existing_id) {
+            id_index++;
+        }
+
+        if(id_index < num_ids && ids[id_index] == existing_id) {
+            num_erased++;
+        } else {
+            if(write_index != read_index) {
+                memmove(id_offsets + write_index, id_offsets + read_index, entry_length * sizeof(uint32_t));
+            }
+            write_index += entry_length;
+        }
+
+        read_index += entry_length;
+    }
+
+    length = write_index;
+    ids_length -= num_erased;
+}
+
 compact_posting_list_t* compact_posting_list_t::create(uint32_t num_ids, const uint32_t* ids, const uint32_t* offset_index,
                                                        uint32_t num_offsets, const uint32_t* offsets) {
     // format: num_offsets, offset1,..,offsetn, id1 | num_offsets, offset1,..,offsetn, id2
 
     size_t length_required = num_offsets + (2 * num_ids);
-    compact_posting_list_t* pl = (compact_posting_list_t*) malloc(sizeof(compact_posting_list_t) +
-                                                                  (length_required * sizeof(uint32_t)));
+    compact_posting_list_t* pl = (compact_posting_list_t*) CompactListArena::get_instance().allocate(
+        size_bytes(length_required)
+    );
 
     pl->length = 0;
     pl->capacity = length_required;
@@ -155,6 +185,10 @@ compact_posting_list_t* compact_posting_list_t::create(uint32_t num_ids, const u
     return pl;
 }
 
+void compact_posting_list_t::destroy(compact_posting_list_t* list) {
+    CompactListArena::get_instance().release(list, size_bytes(list->capacity));
+}
+
 posting_list_t* compact_posting_list_t::to_full_posting_list() const {
     posting_list_t* pl = new posting_list_t(posting_t::MAX_BLOCK_ELEMENTS);
 
@@ -258,7 +292,7 @@ void posting_t::upsert(void*& obj, uint32_t id, const std::vector<uint32_t>& off
         if((list->capacity + extra_capacity_required) > COMPACT_LIST_THRESHOLD_LENGTH) {
             // we have to convert to a full posting list
             posting_list_t* full_list = list->to_full_posting_list();
-            free(list);
+            compact_posting_list_t::destroy(list);
             obj = full_list;
         }
 
@@ -267,8 +301,9 @@ void posting_t::upsert(void*& obj, uint32_t id, const std::vector<uint32_t>& off
             size_t new_capacity = std::min<size_t>((list->capacity + extra_capacity_required) * 1.3,
                                                    COMPACT_LIST_THRESHOLD_LENGTH);
 
-            size_t new_capacity_bytes = sizeof(compact_posting_list_t) + (new_capacity * sizeof(uint32_t));
-            auto new_list = (compact_posting_list_t *) realloc(list, new_capacity_bytes);
+            auto new_list = (compact_posting_list_t *) CompactListArena::get_instance().reallocate(
+                list, compact_posting_list_t::size_bytes(list->capacity), compact_posting_list_t::size_bytes(new_capacity)
+            );
             if(new_list == nullptr) {
                 abort();
             }
@@ -288,17 +323,92 @@ void posting_t::upsert(void*& obj, uint32_t id, const std::vector<uint32_t>& off
     list->upsert(id, offsets);
 }
 
+void posting_t::upsert_sorted(void*& obj, uint32_t num_ids, const uint32_t* ids, const uint32_t* offset_index,
+                              uint32_t num_offsets, const uint32_t* offsets) {
+    if(num_ids == 0) {
+        return;
+    }
+
+    const bool is_empty = (posting_t::num_ids(obj) == 0);
+    const uint32_t last_id = is_empty ? 0 : IS_COMPACT_POSTING(obj) ? COMPACT_POSTING_PTR(obj)->last_id() :
+                                            ((posting_list_t*)(obj))->last_id();
+
+    // IDs that already exist or fall in between existing IDs have to be upserted in place
+    uint32_t append_start = 0;
+
+    while(append_start < num_ids && !is_empty && ids[append_start] <= last_id) {
+        const uint32_t start_offset = offset_index[append_start];
+        const uint32_t end_offset = (append_start == num_ids-1) ? num_offsets : offset_index[append_start+1];
+        std::vector<uint32_t> id_offsets(offsets + start_offset, offsets + end_offset);
+        upsert(obj, ids[append_start], id_offsets);
+        append_start++;
+    }
+
+    if(append_start == num_ids) {
+        return;
+    }
+
+    const uint32_t num_append_ids = num_ids - append_start;
+    const uint32_t num_append_offsets = num_offsets - offset_index[append_start];
+
+    if(IS_COMPACT_POSTING(obj)) {
+        compact_posting_list_t* list = COMPACT_POSTING_PTR(obj);
+        const size_t length_required = list->length + num_append_offsets + (2 * num_append_ids);
+
+        if(length_required <= COMPACT_LIST_THRESHOLD_LENGTH) {
+            if(length_required > list->capacity) {
+                auto new_list = (compact_posting_list_t *) CompactListArena::get_instance().reallocate(
+                    list, compact_posting_list_t::size_bytes(list->capacity), compact_posting_list_t::size_bytes(length_required)
+                );
+                if(new_list == nullptr) {
+                    abort();
+                }
+
+                list = new_list;
+                list->capacity = length_required;
+                obj = SET_COMPACT_POSTING(list);
+            }
+
+            for(uint32_t i = append_start; i < num_ids; i++) {
+                const uint32_t start_offset = offset_index[i];
+                const uint32_t end_offset = (i == num_ids-1) ? num_offsets : offset_index[i+1];
+                list->upsert(ids[i], offsets + start_offset, end_offset - start_offset);
+            }
+
+            return;
+        }
+
+        posting_list_t* full_list = list->to_full_posting_list();
+        compact_posting_list_t::destroy(list);
+        obj = full_list;
+    }
+
+    posting_list_t* list = (posting_list_t*)(obj);
+    // `offset_index` points into `offsets`, so the offsets of the last ID run up to `num_offsets`
+    list->append_sorted(ids + append_start, num_append_ids, offset_index + append_start,
+                        offsets, num_offsets);
+}
+
 void posting_t::erase(void*& obj, uint32_t id) {
+    erase_sorted(obj, 1, &id);
+}
+
+void posting_t::erase_sorted(void*& obj, uint32_t num_ids, const uint32_t* ids) {
     if(IS_COMPACT_POSTING(obj)) {
         compact_posting_list_t* list = COMPACT_POSTING_PTR(obj);
-        list->erase(id);
+        list->erase_sorted(num_ids, ids);
 
         // if the list becomes too small, we resize it to save memory
         if(list->length < list->capacity/2) {
             // resize container
             size_t new_capacity = list->capacity/2;
-            size_t new_capacity_bytes = sizeof(compact_posting_list_t) + (new_capacity * sizeof(uint32_t));
-            auto new_list = (compact_posting_list_t *) realloc(list, new_capacity_bytes);
+            while(list->length < new_capacity/2) {
+                new_capacity /= 2;
+            }
+
+            auto new_list = (compact_posting_list_t *) CompactListArena::get_instance().reallocate(
+                list, compact_posting_list_t::size_bytes(list->capacity), compact_posting_list_t::size_bytes(new_capacity)
+            );
             if(new_list == nullptr) {
                 abort();
             }
@@ -310,7 +420,9 @@ void posting_t::erase(void*& obj, uint32_t id) {
 
     } else {
         posting_list_t* list = (posting_list_t*)(obj);
-        list->erase(id);
+        for(size_t i = 0; i < num_ids; i++) {
+            list->erase(ids[i]);
+        }
 
         if(list->num_blocks() == 1 && ((2 * list->get_root()->size()) + list->get_root()->offsets.getLength()) <= COMPACT_LIST_THRESHOLD_LENGTH) {
             // convert to compact posting format
@@ -333,6 +445,19 @@ void posting_t::erase(void*& obj, uint32_t id) {
     }
 }
 
+size_t posting_t::compact(void* obj) {
+    if(IS_COMPACT_POSTING(obj)) {
+        return 0;
+    }
+
+    posting_list_t* list = (posting_list_t*)(obj);
+    return list->is_fragmented() ? list->compact() : 0;
+}
+
+bool posting_t::is_fragmented(const void* obj) {
+    return !IS_COMPACT_POSTING(obj) && ((const posting_list_t*)(obj))->is_fragmented();
+}
+
 uint32_t posting_t::num_ids(const void* obj) {
     if(IS_COMPACT_POSTING(obj)) {
         compact_posting_list_t* list = COMPACT_POSTING_PTR(obj);
@@ -343,6 +468,58 @@ uint32_t posting_t::num_ids(const void* obj) {
     }
 }
 
+size_t posting_t::memory_bytes(const void* obj) {
+    if(IS_COMPACT_POSTING(obj)) {
+        compact_posting_list_t* list = COMPACT_POSTING_PTR(obj);
+        return compact_posting_list_t::size_bytes(list->capacity);
+    } else {
+        posting_list_t* list = (posting_list_t*)(obj);
+        return list->memory_bytes();
+    }
+}
+
+void posting_t::add_codec_sizes(const void* obj, std::vector<size_t>& codec_bytes) {
+    const auto& codecs = PostingCodec::codecs();
+    codec_bytes.resize(codecs.size(), 0);
+
+    std::vector<uint8_t> encoded;
+
+    auto add_sizes = [&](const uint32_t* ids, size_t num_ids) {
+        for(size_t i = 0; i < codecs.size(); i++) {
+            encoded.clear();
+            codec_bytes[i] += PostingCodec::encode(codecs[i], ids, num_ids, encoded);
+        }
+    };
+
+    if(IS_COMPACT_POSTING(obj)) {
+        compact_posting_list_t* list = COMPACT_POSTING_PTR(obj);
+        std::vector<uint32_t> ids;
+        ids.reserve(list->ids_length);
+
+        size_t i = 0;
+        while(i < list->length) {
+            size_t num_offsets = list->id_offsets[i];
+            ids.push_back(list->id_offsets[i + num_offsets + 1]);
+            i += num_offsets + 2;
+        }
+
+        add_sizes(ids.data(), ids.size());
+    } else {
+        posting_list_t* list = (posting_list_t*)(obj);
+        posting_list_t::block_t* block = list->get_root();
+
+        while(block != nullptr) {
+            if(block->size() != 0) {
+                uint32_t* ids = block->ids.uncompress();
+                add_sizes(ids, block->size());
+                delete [] ids;
+            }
+
+            block = block->next;
+        }
+    }
+}
+
 uint32_t posting_t::first_id(const void* obj) {
     if(IS_COMPACT_POSTING(obj)) {
         compact_posting_list_t* list = COMPACT_POSTING_PTR(obj);
@@ -386,6 +563,94 @@ void posting_t::merge(const std::vector<void*>& raw_posting_lists, std::vector<u
     }
 }
 
+void posting_t::merge(const std::vector<void*>& raw_posting_lists, std::vector<uint32_t>& result_ids,
+                      ThreadPool* thread_pool, size_t concurrency) {
+    std::vector<posting_list_t*> plists;
+    std::vector<posting_list_t*> expanded_plists;
+    to_expanded_plists(raw_posting_lists, plists, expanded_plists);
+
+    size_t total_ids = 0;
+    posting_list_t* longest_plist = nullptr;
+
+    for(posting_list_t* plist: plists) {
+        total_ids += plist->num_ids();
+        if(longest_plist == nullptr || plist->num_blocks() > longest_plist->num_blocks()) {
+            longest_plist = plist;
+        }
+    }
+
+    if(thread_pool == nullptr || concurrency <= 1 || total_ids < PARALLEL_MERGE_MIN_IDS ||
+       longest_plist->num_blocks() < concurrency) {
+        posting_list_t::merge(plists, result_ids);
+    } else {
+        // ranges: [0, a], [a+1, b], ... [z+1, UINT32_MAX] where a, b, ... z are last IDs of the longest list's blocks
+        const size_t num_blocks = longest_plist->num_blocks();
+        const size_t window_size = (num_blocks + concurrency - 1) / concurrency;  // rounds up
+
+        std::vector<uint32_t> range_ends;
+        for(size_t i = window_size; i < num_blocks; i += window_size) {
+            range_ends.push_back(longest_plist->id_block_map.last_id_at(i - 1));
+        }
+
+        range_ends.push_back(UINT32_MAX);
+
+        std::vector<std::vector<uint32_t>> partial_result_ids(range_ends.size());
+
+        size_t num_processed = 0;
+        std::mutex m_process;
+        std::condition_variable cv_process;
+
+        for(size_t r = 0; r < range_ends.size(); r++) {
+            const uint32_t range_start = (r == 0) ? 0 : range_ends[r - 1] + 1;
+            const uint32_t range_end = range_ends[r];
+
+            thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::SEARCH,
+                                      [&plists, &partial_result_ids, &num_processed, &m_process, &cv_process,
+                                       r, range_start, range_end]() {
+                std::vector<posting_list_t::iterator_t> its;
+
+                for(posting_list_t* plist: plists) {
+                    const block_index_t<posting_list_t::block_t>& id_block_map = plist->id_block_map;
+                    const size_t start_pos = id_block_map.lower_bound(range_start);
+                    if(start_pos == id_block_map.size()) {
+                        continue;
+                    }
+
+                    const size_t end_pos = id_block_map.lower_bound(range_end, start_pos);
+                    posting_list_t::block_t* end_block = (end_pos == id_block_map.size()) ? nullptr :
+                                                         id_block_map.block_at(end_pos)->next;
+
+                    its.push_back(plist->new_iterator(id_block_map.block_at(start_pos), end_block));
+                    its.back().skip_to(range_start);
+                }
+
+                or_iterator_t::merge(its, partial_result_ids[r], range_end);
+
+                std::unique_lock<std::mutex> lock(m_process);
+                num_processed++;
+                cv_process.notify_one();
+            });
+        }
+
+        std::unique_lock<std::mutex> lock_process(m_process);
+        cv_process.wait(lock_process, [&](){ return num_processed == range_ends.size(); });
+
+        size_t num_result_ids = result_ids.size();
+        for(const auto& partial_ids: partial_result_ids) {
+            num_result_ids += partial_ids.size();
+        }
+
+        result_ids.reserve(num_result_ids);
+        for(const auto& partial_ids: partial_result_ids) {
+            result_ids.insert(result_ids.end(), partial_ids.begin(), partial_ids.end());
+        }
+    }
+
+    for(posting_list_t* expanded_plist: expanded_plists) {
+        delete expanded_plist;
+    }
+}
+
 void posting_t::intersect(const std::vector<void*>& raw_posting_lists, std::vector<uint32_t>& result_ids) {
     // we will have to convert the compact posting list (if any) to full form
     std::vector<posting_list_t*> plists;
@@ -423,7 +688,7 @@ void posting_t::destroy_list(void*& obj) {
 
     if(IS_COMPACT_POSTING(obj)) {
         compact_posting_list_t* list = COMPACT_POSTING_PTR(obj);
-        free(list); // assigned via malloc, so must be free()d
+        compact_posting_list_t::destroy(list);
     } else {
         posting_list_t* list = (posting_list_t*)(obj);
         delete list;
@@ -517,3 +782,17 @@ void posting_t::get_phrase_matches(const std::vector<void*>& raw_posting_lists,
         delete expanded_plist;
     }
 }
+
+void posting_t::phrase_intersect(const std::vector<void*>& raw_posting_lists, bool field_is_array,
+                                 std::vector<uint32_t>& phrase_ids) {
+    std::vector<posting_list_t*> plists;
+    std::vector<posting_list_t*> expanded_plists;
+    to_expanded_plists(raw_posting_lists, plists, expanded_plists);
+
+    result_iter_state_t istate;
+    posting_list_t::phrase_intersect(plists, field_is_array, istate, phrase_ids);
+
+    for(posting_list_t* expanded_plist: expanded_plists) {
+        delete expanded_plist;
+    }
+}
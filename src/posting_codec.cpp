@@ -0,0 +1,324 @@
+#include "posting_codec.h"
+#include <cstring>
+#include <for.h>
+#include "array_base.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <sse2neon.h>
+#endif
+
+const std::vector<posting_codec_t>& PostingCodec::codecs() {
+    static const std::vector<posting_codec_t> all_codecs = {FOR_CODEC, STREAM_VBYTE_CODEC, ROARING_CODEC};
+    return all_codecs;
+}
+
+bool PostingCodec::parse(const std::string& name, posting_codec_t& codec) {
+    for(posting_codec_t c: codecs()) {
+        if(PostingCodec::name(c) == name) {
+            codec = c;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::string PostingCodec::name(posting_codec_t codec) {
+    switch(codec) {
+        case STREAM_VBYTE_CODEC:
+            return STREAM_VBYTE_NAME;
+        case ROARING_CODEC:
+            return ROARING_NAME;
+        default:
+            return FOR_NAME;
+    }
+}
+
+size_t PostingCodec::encode(posting_codec_t codec, const uint32_t* sorted_ids, size_t n, std::vector<uint8_t>& out) {
+    switch(codec) {
+        case STREAM_VBYTE_CODEC:
+            return stream_vbyte_encode(sorted_ids, n, out);
+        case ROARING_CODEC:
+            return roaring_encode(sorted_ids, n, out);
+        default:
+            return for_encode(sorted_ids, n, out);
+    }
+}
+
+size_t PostingCodec::decode(posting_codec_t codec, const uint8_t* in, size_t n, uint32_t* out) {
+    switch(codec) {
+        case STREAM_VBYTE_CODEC:
+            return stream_vbyte_decode(in, n, out);
+        case ROARING_CODEC:
+            return roaring_decode(in, n, out);
+        default:
+            return for_decode(in, n, out);
+    }
+}
+
+/* FOR */
+
+size_t PostingCodec::for_encode(const uint32_t* sorted_ids, size_t n, std::vector<uint8_t>& out) {
+    if(n == 0) {
+        return 0;
+    }
+
+    const uint32_t bits = (sorted_ids[n-1] - sorted_ids[0]) == 0 ? 0 :
+                          32 - __builtin_clz(sorted_ids[n-1] - sorted_ids[0]);
+    const size_t max_size = METADATA_OVERHEAD + 4 + for_compressed_size_bits(n, bits);
+
+    const size_t start = out.size();
+    out.resize(start + max_size);
+    const uint32_t actual_size = for_compress_sorted(sorted_ids, &out[start], n);
+    out.resize(start + actual_size);
+
+    return actual_size;
+}
+
+size_t PostingCodec::for_decode(const uint8_t* in, size_t n, uint32_t* out) {
+    if(n == 0) {
+        return 0;
+    }
+
+    return for_uncompress(in, out, n);
+}
+
+/* Stream VByte */
+
+size_t PostingCodec::stream_vbyte_encode(const uint32_t* sorted_ids, size_t n, std::vector<uint8_t>& out) {
+    // [control bytes: 2 bits (byte length - 1) per integer][deltas as little endian bytes]
+    const size_t start = out.size();
+    const size_t num_control_bytes = (n + 3) / 4;
+
+    out.resize(start + num_control_bytes + (n * 4));
+
+    uint8_t* control = &out[start];
+    uint8_t* data = control + num_control_bytes;
+    memset(control, 0, num_control_bytes);
+
+    uint32_t prev = 0;
+
+    for(size_t i = 0; i < n; i++) {
+        const uint32_t delta = sorted_ids[i] - prev;
+        prev = sorted_ids[i];
+
+        const uint32_t code = (delta < (1U << 8)) ? 0 : (delta < (1U << 16)) ? 1 : (delta < (1U << 24)) ? 2 : 3;
+        control[i / 4] |= uint8_t(code << (2 * (i % 4)));
+
+        memcpy(data, &delta, code + 1);
+        data += code + 1;
+    }
+
+    const size_t num_bytes = data - &out[start];
+    out.resize(start + num_bytes);
+
+    return num_bytes;
+}
+
+size_t PostingCodec::stream_vbyte_decode_scalar(const uint8_t* in, size_t n, uint32_t* out) {
+    const uint8_t* control = in;
+    const uint8_t* data = in + (n + 3) / 4;
+    uint32_t prev = 0;
+
+    for(size_t i = 0; i < n; i++) {
+        const uint32_t code = (control[i / 4] >> (2 * (i % 4))) & 3;
+        uint32_t delta = 0;
+        memcpy(&delta, data, code + 1);
+        data += code + 1;
+
+        prev += delta;
+        out[i] = prev;
+    }
+
+    return data - in;
+}
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+struct stream_vbyte_tables_t {
+    uint8_t shuffle[256][16];
+    uint8_t length[256];
+
+    stream_vbyte_tables_t() {
+        for(size_t key = 0; key < 256; key++) {
+            uint8_t offset = 0;
+
+            for(size_t j = 0; j < 4; j++) {
+                const uint8_t len = ((key >> (2 * j)) & 3) + 1;
+                for(size_t b = 0; b < 4; b++) {
+                    // 0xFF lanes are zeroed by the shuffle
+                    shuffle[key][j * 4 + b] = (b < len) ? uint8_t(offset + b) : 0xFF;
+                }
+
+                offset += len;
+            }
+
+            length[key] = offset;
+        }
+    }
+};
+
+#if defined(__x86_64__)
+__attribute__((target("ssse3")))
+#endif
+static size_t stream_vbyte_decode_simd(const uint8_t* in, size_t n, uint32_t* out) {
+    static const stream_vbyte_tables_t tables;
+
+    const uint8_t* control = in;
+    const uint8_t* data = in + (n + 3) / 4;
+    const size_t num_full_groups = n / 4;
+
+    // a shuffle reads 16 bytes of data, so we must stop early enough to not read past the end of the input
+    size_t data_length = 0;
+    for(size_t g = 0; g < num_full_groups; g++) {
+        data_length += tables.length[control[g]];
+    }
+
+    const uint8_t* data_end = data + data_length;
+    __m128i prev = _mm_setzero_si128();
+    size_t g = 0;
+
+    for(; g < num_full_groups && data + 16 <= data_end; g++) {
+        const uint8_t key = control[g];
+        __m128i deltas = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) data),
+                                          _mm_loadu_si128((const __m128i*) tables.shuffle[key]));
+
+        // prefix sum of the 4 deltas on top of the last decoded value
+        deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+        deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+        const __m128i values = _mm_add_epi32(deltas, prev);
+
+        _mm_storeu_si128((__m128i*) (out + g * 4), values);
+        prev = _mm_shuffle_epi32(values, 0xFF);
+        data += tables.length[key];
+    }
+
+    uint32_t last = (g == 0) ? 0 : out[g * 4 - 1];
+
+    for(size_t i = g * 4; i < n; i++) {
+        const uint32_t code = (control[i / 4] >> (2 * (i % 4))) & 3;
+        uint32_t delta = 0;
+        memcpy(&delta, data, code + 1);
+        data += code + 1;
+
+        last += delta;
+        out[i] = last;
+    }
+
+    return data - in;
+}
+
+#endif
+
+typedef size_t (*stream_vbyte_decode_fn_t)(const uint8_t*, size_t, uint32_t*);
+
+static stream_vbyte_decode_fn_t resolve_stream_vbyte_decode() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("ssse3")) {
+        return stream_vbyte_decode_simd;
+    }
+
+    return PostingCodec::stream_vbyte_decode_scalar;
+#elif defined(__aarch64__)
+    return stream_vbyte_decode_simd;
+#else
+    return PostingCodec::stream_vbyte_decode_scalar;
+#endif
+}
+
+size_t PostingCodec::stream_vbyte_decode(const uint8_t* in, size_t n, uint32_t* out) {
+    static const stream_vbyte_decode_fn_t decode_fn = resolve_stream_vbyte_decode();
+    return decode_fn(in, n, out);
+}
+
+/* Roaring */
+
+size_t PostingCodec::roaring_encode(const uint32_t* sorted_ids, size_t n, std::vector<uint8_t>& out) {
+    // Each container: [16 bit key][16 bit (cardinality - 1)][payload]
+    // The payload is either an array of 16 bit low values or a 2^16 bit bitmap, whichever is smaller.
+    const size_t start = out.size();
+    size_t i = 0;
+
+    while(i < n) {
+        const uint16_t key = sorted_ids[i] >> 16;
+        size_t j = i;
+        while(j < n && (sorted_ids[j] >> 16) == key) {
+            j++;
+        }
+
+        const size_t cardinality = j - i;
+        const uint16_t encoded_cardinality = cardinality - 1;
+
+        const size_t header_pos = out.size();
+        out.resize(header_pos + 4);
+        memcpy(&out[header_pos], &key, 2);
+        memcpy(&out[header_pos + 2], &encoded_cardinality, 2);
+
+        if(cardinality <= ROARING_MAX_ARRAY_CONTAINER_SIZE) {
+            const size_t payload_pos = out.size();
+            out.resize(payload_pos + cardinality * 2);
+
+            for(size_t k = 0; k < cardinality; k++) {
+                const uint16_t low = sorted_ids[i + k] & 0xFFFF;
+                memcpy(&out[payload_pos + k * 2], &low, 2);
+            }
+        } else {
+            uint64_t bitmap[1024] = {0};
+            for(size_t k = i; k < j; k++) {
+                const uint16_t low = sorted_ids[k] & 0xFFFF;
+                bitmap[low >> 6] |= (uint64_t(1) << (low & 63));
+            }
+
+            const size_t payload_pos = out.size();
+            out.resize(payload_pos + sizeof(bitmap));
+            memcpy(&out[payload_pos], bitmap, sizeof(bitmap));
+        }
+
+        i = j;
+    }
+
+    return out.size() - start;
+}
+
+size_t PostingCodec::roaring_decode(const uint8_t* in, size_t n, uint32_t* out) {
+    const uint8_t* curr = in;
+    size_t num_decoded = 0;
+
+    while(num_decoded < n) {
+        uint16_t key, encoded_cardinality;
+        memcpy(&key, curr, 2);
+        memcpy(&encoded_cardinality, curr + 2, 2);
+        curr += 4;
+
+        const size_t cardinality = size_t(encoded_cardinality) + 1;
+        const uint32_t high = uint32_t(key) << 16;
+
+        if(cardinality <= ROARING_MAX_ARRAY_CONTAINER_SIZE) {
+            for(size_t k = 0; k < cardinality; k++) {
+                uint16_t low;
+                memcpy(&low, curr + k * 2, 2);
+                out[num_decoded++] = high | low;
+            }
+
+            curr += cardinality * 2;
+        } else {
+            for(size_t w = 0; w < 1024; w++) {
+                uint64_t word;
+                memcpy(&word, curr + w * 8, 8);
+
+                while(word != 0) {
+                    const uint32_t bit = __builtin_ctzll(word);
+                    out[num_decoded++] = high | uint32_t(w * 64 + bit);
+                    word &= (word - 1);
+                }
+            }
+
+            curr += 1024 * 8;
+        }
+    }
+
+    return curr - in;
+}
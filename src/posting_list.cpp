@@ -2,10 +2,14 @@
 #include <bitset>
 #include "for.h"
 #include "array_utils.h"
+#include "or_iterator.h"
+#include "search_profile.h"
 
 /* block_t operations */
 
 uint32_t posting_list_t::block_t::upsert(const uint32_t id, const std::vector<uint32_t>& positions) {
+    update_score_bounds(positions.data(), positions.size());
+
     if(id > ids.last() || ids.getLength() == 0) {
         // append to the end
         ids.append(id);
@@ -212,6 +216,81 @@ bool posting_list_t::block_t::contains(uint32_t id) {
     return ids.contains(id);
 }
 
+void posting_list_t::block_t::update_score_bounds(const uint32_t* positions, size_t num_positions) {
+    // Array fields interleave array indices with positions, so we can't tell them apart here: using the
+    // smallest non-zero value as the smallest position keeps the bounds conservative for both layouts.
+    uint32_t min_position = UINT32_MAX;
+    uint32_t max_value = 0;
+
+    for(size_t i = 0; i < num_positions; i++) {
+        const uint32_t position = positions[i];
+        if(position != 0 && position < min_position) {
+            min_position = position;
+        }
+
+        if(position > max_value) {
+            max_value = position;
+        }
+    }
+
+    if(min_position == UINT32_MAX) {
+        return;
+    }
+
+    // single token matches use a truncated `uint8_t` offset, while multi token matches use zero based offsets
+    const uint8_t offset_score = (max_value > 255) ? 255 : uint8_t(std::min<uint32_t>(255, 256 - min_position));
+    max_offset_score = std::max(max_offset_score, offset_score);
+    has_first_position = has_first_position || (min_position == 1);
+}
+
+void posting_list_t::block_t::append_sorted(const uint32_t* new_ids, uint32_t num_new_ids,
+                                            const uint32_t* new_offset_index,
+                                            const uint32_t* new_offsets, uint32_t num_new_offsets) {
+    if(num_new_ids == 0) {
+        return;
+    }
+
+    const uint32_t curr_num_ids = ids.getLength();
+    const uint32_t curr_num_offsets = offsets.getLength();
+
+    std::vector<uint32_t> all_ids(curr_num_ids + num_new_ids);
+    std::vector<uint32_t> all_offset_index(curr_num_ids + num_new_ids);
+    std::vector<uint32_t> all_offsets(curr_num_offsets + num_new_offsets);
+
+    if(curr_num_ids != 0) {
+        uint32_t* raw_ids = ids.uncompress();
+        uint32_t* raw_offset_index = offset_index.uncompress();
+        std::memcpy(all_ids.data(), raw_ids, curr_num_ids * sizeof(uint32_t));
+        std::memcpy(all_offset_index.data(), raw_offset_index, curr_num_ids * sizeof(uint32_t));
+        delete [] raw_ids;
+        delete [] raw_offset_index;
+    }
+
+    if(curr_num_offsets != 0) {
+        uint32_t* raw_offsets = offsets.uncompress();
+        std::memcpy(all_offsets.data(), raw_offsets, curr_num_offsets * sizeof(uint32_t));
+        delete [] raw_offsets;
+    }
+
+    for(uint32_t i = 0; i < num_new_ids; i++) {
+        all_ids[curr_num_ids + i] = new_ids[i];
+        all_offset_index[curr_num_ids + i] = curr_num_offsets + (new_offset_index[i] - new_offset_index[0]);
+    }
+
+    std::memcpy(all_offsets.data() + curr_num_offsets, new_offsets + new_offset_index[0],
+                num_new_offsets * sizeof(uint32_t));
+
+    update_score_bounds(new_offsets + new_offset_index[0], num_new_offsets);
+
+    ids.load(all_ids.data(), all_ids.size());
+    offset_index.load(all_offset_index.data(), all_offset_index.size());
+
+    if(!all_offsets.empty()) {
+        const auto min_max = std::minmax_element(all_offsets.begin(), all_offsets.end());
+        offsets.load(all_offsets.data(), all_offsets.size(), *min_max.first, *min_max.second);
+    }
+}
+
 /* posting_list_t operations */
 
 posting_list_t::posting_list_t(uint16_t max_block_elements): BLOCK_MAX_ELEMENTS(max_block_elements) {
@@ -355,6 +434,9 @@ void posting_list_t::merge_adjacent_blocks(posting_list_t::block_t* block1, post
         LOG(ERROR) << "Block offset length is smaller than offset index length after merging.";
     }
 
+    block1->max_offset_score = std::max(block1->max_offset_score, block2->max_offset_score);
+    block1->has_first_position = block1->has_first_position || block2->has_first_position;
+
     delete [] offset_index1;
     delete [] offset_index2;
     delete [] new_offset_index;
@@ -383,6 +465,9 @@ void posting_list_t::split_block(posting_list_t::block_t* src_block, posting_lis
     src_block->ids.load(raw_ids, ids_first_half_length);
     dst_block->ids.load(raw_ids + ids_first_half_length, ids_second_half_length);
 
+    dst_block->max_offset_score = src_block->max_offset_score;
+    dst_block->has_first_position = src_block->has_first_position;
+
     uint32_t* raw_offset_indices = src_block->offset_index.uncompress();
     size_t offset_indices_first_half_length = (src_block->offset_index.getLength() / 2);
     size_t offset_indices_second_half_length = (src_block->offset_index.getLength() - offset_indices_first_half_length);
@@ -453,8 +538,8 @@ void posting_list_t::upsert(const uint32_t id, const std::vector<uint32_t>& offs
         upsert_block = &root_block;
         before_upsert_last_id = UINT32_MAX;
     } else {
-        const auto it = id_block_map.lower_bound(id);
-        upsert_block = (it == id_block_map.end()) ? id_block_map.rbegin()->second : it->second;
+        const size_t pos = id_block_map.lower_bound(id);
+        upsert_block = (pos == id_block_map.size()) ? id_block_map.last_block() : id_block_map.block_at(pos);
         before_upsert_last_id = upsert_block->ids.last();
     }
 
@@ -464,9 +549,10 @@ void posting_list_t::upsert(const uint32_t id, const std::vector<uint32_t>& offs
         ids_length += num_inserted;
 
         last_id_t after_upsert_last_id = upsert_block->ids.last();
-        if(before_upsert_last_id != after_upsert_last_id) {
-            id_block_map.erase(before_upsert_last_id);
-            id_block_map.emplace(after_upsert_last_id, upsert_block);
+        if(id_block_map.empty()) {
+            id_block_map.insert(after_upsert_last_id, upsert_block);
+        } else if(before_upsert_last_id != after_upsert_last_id) {
+            id_block_map.update(before_upsert_last_id, after_upsert_last_id);
         }
     } else {
         block_t* new_block = new block_t;
@@ -484,18 +570,49 @@ void posting_list_t::upsert(const uint32_t id, const std::vector<uint32_t>& offs
             split_block(upsert_block, new_block);
 
             last_id_t after_upsert_last_id = upsert_block->ids.last();
-            id_block_map.erase(before_upsert_last_id);
-            id_block_map.emplace(after_upsert_last_id, upsert_block);
+            id_block_map.update(before_upsert_last_id, after_upsert_last_id);
         }
 
         last_id_t after_new_block_id = new_block->ids.last();
-        id_block_map.emplace(after_new_block_id, new_block);
+        id_block_map.insert(after_new_block_id, new_block);
 
         new_block->next = upsert_block->next;
         upsert_block->next = new_block;
     }
 }
 
+void posting_list_t::append_sorted(const uint32_t* ids, uint32_t num_ids, const uint32_t* offset_index,
+                                   const uint32_t* offsets, uint32_t num_offsets) {
+    block_t* last_block = id_block_map.empty() ? &root_block : id_block_map.last_block();
+    uint32_t i = 0;
+
+    while(i < num_ids) {
+        if(last_block->size() >= BLOCK_MAX_ELEMENTS) {
+            block_t* new_block = new block_t;
+            last_block->next = new_block;
+            last_block = new_block;
+        }
+
+        const uint32_t num_block_ids = std::min<uint32_t>(BLOCK_MAX_ELEMENTS - last_block->size(), num_ids - i);
+        const uint32_t offsets_start = offset_index[i];
+        const uint32_t offsets_end = (i + num_block_ids == num_ids) ? num_offsets : offset_index[i + num_block_ids];
+
+        const bool is_new_block = (last_block->size() == 0);
+        const last_id_t before_last_id = is_new_block ? 0 : last_block->ids.last();
+
+        last_block->append_sorted(ids + i, num_block_ids, offset_index + i, offsets, offsets_end - offsets_start);
+
+        if(is_new_block) {
+            id_block_map.insert(last_block->ids.last(), last_block);
+        } else {
+            id_block_map.update(before_last_id, last_block->ids.last());
+        }
+
+        ids_length += num_block_ids;
+        i += num_block_ids;
+    }
+}
+
 void posting_list_t::dump() {
     auto it = new_iterator();
 
@@ -507,14 +624,14 @@ void posting_list_t::dump() {
         auto index = it.index();
         while(index < it.block()->size()) {
             ids_str += std::to_string(it.ids[index]) + ", ";
-            offset_index_str += std::to_string(it.offset_index[index]) + ", ";
+            offset_index_str += std::to_string(it.get_offset_index()[index]) + ", ";
             index++;
         }
 
-        auto last_offset_index = it.offset_index[it.block()->size()-1];
+        auto last_offset_index = it.get_offset_index()[it.block()->size()-1];
 
         for(size_t j = 0; j <= last_offset_index; j++) {
-            offsets_str += std::to_string(it.offsets[j]) + ", ";
+            offsets_str += std::to_string(it.get_offsets()[j]) + ", ";
         }
 
         it.set_index(it.block()->size()-1);
@@ -532,14 +649,14 @@ void posting_list_t::dump() {
 }
 
 void posting_list_t::erase(const uint32_t id) {
-    const auto it = id_block_map.lower_bound(id);
+    const size_t pos = id_block_map.lower_bound(id);
 
-    if(it == id_block_map.end()) {
+    if(pos == id_block_map.size()) {
         return ;
     }
 
-    block_t* erase_block = it->second;
-    last_id_t before_last_id = it->first;
+    block_t* erase_block = id_block_map.block_at(pos);
+    last_id_t before_last_id = id_block_map.last_id_at(pos);
     uint32_t num_erased = erase_block->erase(id);
     ids_length -= num_erased;
 
@@ -550,18 +667,16 @@ void posting_list_t::erase(const uint32_t id) {
 
         if(erase_block != &root_block) {
             // since we will be deleting the empty node, set the previous node's next pointer to null
-            std::prev(it)->second->next = nullptr;
+            id_block_map.block_at(pos - 1)->next = nullptr;
             delete erase_block;
         } else {
             // The root block cannot be empty if there are other blocks so we will pull some contents from next block
             // This is only an issue for blocks with max size of 2
             if(root_block.next != nullptr) {
-                auto next_block_last_id = erase_block->next->ids.last();
+                // last id of the next block does not change since only its first half is moved
                 merge_adjacent_blocks(erase_block, erase_block->next, erase_block->next->size()/2);
-                id_block_map.erase(next_block_last_id);
-
-                id_block_map.emplace(erase_block->next->ids.last(), erase_block->next);
-                id_block_map.emplace(erase_block->ids.last(), erase_block);
+                id_block_map.update(before_last_id, erase_block->ids.last());
+                return;
             }
         }
 
@@ -573,8 +688,7 @@ void posting_list_t::erase(const uint32_t id) {
     if(new_ids_length >= BLOCK_MAX_ELEMENTS/2 || erase_block->next == nullptr) {
         last_id_t after_last_id = erase_block->ids.last();
         if(before_last_id != after_last_id) {
-            id_block_map.erase(before_last_id);
-            id_block_map.emplace(after_last_id, erase_block);
+            id_block_map.update(before_last_id, after_last_id);
         }
 
         return ;
@@ -603,8 +717,7 @@ void posting_list_t::erase(const uint32_t id) {
 
     last_id_t after_last_id = erase_block->ids.last();
     if(before_last_id != after_last_id) {
-        id_block_map.erase(before_last_id);
-        id_block_map.emplace(after_last_id, erase_block);
+        id_block_map.update(before_last_id, after_last_id);
     }
 }
 
@@ -612,10 +725,71 @@ posting_list_t::block_t* posting_list_t::get_root() {
     return &root_block;
 }
 
+static size_t min_num_blocks(size_t num_ids, size_t block_max_elements) {
+    return std::max<size_t>(1, (num_ids + block_max_elements - 1) / block_max_elements);
+}
+
+bool posting_list_t::is_fragmented() const {
+    const size_t num_blocks_needed = min_num_blocks(ids_length, BLOCK_MAX_ELEMENTS);
+    return id_block_map.size() > 1 && id_block_map.size() >= num_blocks_needed + (num_blocks_needed + 3) / 4;
+}
+
+size_t posting_list_t::compact() {
+    if(id_block_map.size() <= min_num_blocks(ids_length, BLOCK_MAX_ELEMENTS)) {
+        return 0;
+    }
+
+    size_t num_freed_blocks = 0;
+    block_t* block = &root_block;
+
+    while(block->next != nullptr) {
+        block_t* next_block = block->next;
+        const size_t num_free_slots = BLOCK_MAX_ELEMENTS - block->size();
+
+        if(num_free_slots == 0) {
+            block = next_block;
+        } else if(next_block->size() <= num_free_slots) {
+            // `block` might still have room for the IDs of the block after `next_block`
+            merge_adjacent_blocks(block, next_block, next_block->size());
+            block->next = next_block->next;
+            delete next_block;
+            num_freed_blocks++;
+        } else {
+            merge_adjacent_blocks(block, next_block, num_free_slots);
+            block = next_block;
+        }
+    }
+
+    id_block_map.clear();
+
+    for(block = &root_block; block != nullptr; block = block->next) {
+        id_block_map.insert(block->ids.last(), block);
+    }
+
+    return num_freed_blocks;
+}
+
 size_t posting_list_t::num_blocks() const {
     return id_block_map.size();
 }
 
+size_t posting_list_t::memory_bytes() const {
+    size_t bytes = sizeof(posting_list_t) + id_block_map.memory_bytes();
+    const block_t* block = &root_block;
+
+    while(block != nullptr) {
+        if(block != &root_block) {
+            bytes += sizeof(block_t);
+        }
+
+        bytes += block->ids.getSizeInBytes() + block->offset_index.getSizeInBytes() +
+                 block->offsets.getSizeInBytes();
+        block = block->next;
+    }
+
+    return bytes;
+}
+
 uint32_t posting_list_t::first_id() {
     if(ids_length == 0) {
         return 0;
@@ -624,13 +798,21 @@ uint32_t posting_list_t::first_id() {
     return root_block.ids.at(0);
 }
 
+uint32_t posting_list_t::last_id() {
+    if(id_block_map.empty()) {
+        return 0;
+    }
+
+    return id_block_map.last_block()->ids.last();
+}
+
 posting_list_t::block_t* posting_list_t::block_of(uint32_t id) {
-    const auto it = id_block_map.lower_bound(id);
-    if(it == id_block_map.end()) {
+    const size_t pos = id_block_map.lower_bound(id);
+    if(pos == id_block_map.size()) {
         return nullptr;
     }
 
-    return it->second;
+    return id_block_map.block_at(pos);
 }
 
 
@@ -684,22 +866,7 @@ void posting_list_t::merge(const std::vector<posting_list_t*>& posting_lists, st
 
             break;
         default:
-            while(!at_end(its)) {
-                if(equals(its)) {
-                    result_ids.push_back(its[0].id());
-                    advance_all(its);
-                } else {
-                    uint32_t smallest_value = advance_smallest(its);
-                    result_ids.push_back(smallest_value);
-                }
-            }
-
-            for(auto& it: its) {
-                while(it.valid()) {
-                    result_ids.push_back(it.id());
-                    it.next();
-                }
-            }
+            or_iterator_t::merge(its, result_ids);
     }
 }
 
@@ -723,6 +890,24 @@ void posting_list_t::intersect(const std::vector<posting_list_t*>& posting_lists
     auto its = std::vector<posting_list_t::iterator_t>();
     its.reserve(posting_lists.size());
 
+    if(is_skewed(posting_lists)) {
+        std::vector<posting_list_t*> sorted_lists = posting_lists;
+        std::sort(sorted_lists.begin(), sorted_lists.end(), [](posting_list_t* a, posting_list_t* b) {
+            return a->num_ids() < b->num_ids();
+        });
+
+        for(const auto& posting_list: sorted_lists) {
+            its.push_back(posting_list->new_iterator());
+        }
+
+        result_iter_state_t istate;
+        block_intersect_skewed(its, istate, [&](uint32_t id, std::vector<iterator_t>& plist_its, size_t index) {
+            result_ids.push_back(id);
+        });
+
+        return ;
+    }
+
     for(const auto& posting_list: posting_lists) {
         its.push_back(posting_list->new_iterator());
     }
@@ -730,17 +915,33 @@ void posting_list_t::intersect(const std::vector<posting_list_t*>& posting_lists
     size_t num_lists = its.size();
 
     switch (num_lists) {
-        case 2:
+        case 2: {
+            std::vector<uint32_t> positions0(posting_lists[0]->BLOCK_MAX_ELEMENTS);
+            std::vector<uint32_t> positions1(posting_lists[0]->BLOCK_MAX_ELEMENTS);
+
             while(!at_end2(its)) {
-                if(equals2(its)) {
-                    //LOG(INFO) << its[0].id();
-                    result_ids.push_back(its[0].id());
-                    advance_all2(its);
-                } else {
-                    advance_non_largest2(its);
+                const uint32_t start_index0 = its[0].index();
+                const uint32_t start_index1 = its[1].index();
+                const uint32_t len0 = its[0].block()->size() - start_index0;
+                const uint32_t len1 = its[1].block()->size() - start_index1;
+
+                if(positions0.size() < std::min(len0, len1)) {
+                    positions0.resize(std::min(len0, len1));
+                    positions1.resize(std::min(len0, len1));
                 }
+
+                size_t num_matches = ArrayUtils::and_positions(its[0].ids + start_index0, len0,
+                                                               its[1].ids + start_index1, len1,
+                                                               positions0.data(), positions1.data());
+
+                for(size_t i = 0; i < num_matches; i++) {
+                    result_ids.push_back(its[0].ids[start_index0 + positions0[i]]);
+                }
+
+                skip_past_overlapping_blocks2(its);
             }
             break;
+        }
         default:
             while(!at_end(its)) {
                 if(equals(its)) {
@@ -754,13 +955,34 @@ void posting_list_t::intersect(const std::vector<posting_list_t*>& posting_lists
     }
 }
 
+bool posting_list_t::is_skewed(const std::vector<posting_list_t*>& posting_lists) {
+    if(posting_lists.size() < 2) {
+        return false;
+    }
+
+    size_t shortest = SIZE_MAX, second_shortest = SIZE_MAX;
+
+    for(const auto& posting_list: posting_lists) {
+        size_t num_ids = posting_list->num_ids();
+        if(num_ids < shortest) {
+            second_shortest = shortest;
+            shortest = num_ids;
+        } else if(num_ids < second_shortest) {
+            second_shortest = num_ids;
+        }
+    }
+
+    return second_shortest / std::max<size_t>(shortest, 1) >= SKEWED_INTERSECTION_RATIO;
+}
+
 bool posting_list_t::take_id(result_iter_state_t& istate, uint32_t id) {
     // decide if this result id should be excluded
-    if(istate.excluded_result_ids_size != 0) {
-        if (std::binary_search(istate.excluded_result_ids,
-                               istate.excluded_result_ids + istate.excluded_result_ids_size, id)) {
-            return false;
-        }
+    if(istate.is_excluded(id)) {
+        return false;
+    }
+
+    if(istate.filter_it != nullptr) {
+        return istate.filter_it->contains(id);
     }
 
     // decide if this result be matched with filter results
@@ -794,12 +1016,12 @@ bool posting_list_t::get_offsets(const std::vector<iterator_t>& its,
             continue;
         }
 
-        uint32_t* offsets = its[j].offsets;
+        const uint32_t* offsets = its[j].get_offsets();
 
-        uint32_t start_offset = its[j].offset_index[curr_index];
+        uint32_t start_offset = its[j].get_offset_index()[curr_index];
         uint32_t end_offset = (curr_index == curr_block->size() - 1) ?
                               curr_block->offsets.getLength() :
-                              its[j].offset_index[curr_index + 1];
+                              its[j].get_offset_index()[curr_index + 1];
 
         std::vector<uint16_t> positions;
         int prev_pos = -1;
@@ -865,8 +1087,8 @@ bool posting_list_t::is_single_token_verbatim_match(const posting_list_t::iterat
         return false;
     }
 
-    uint32_t* offsets = it.offsets;
-    uint32_t start_offset = it.offset_index[curr_index];
+    const uint32_t* offsets = it.get_offsets();
+    uint32_t start_offset = it.get_offset_index()[curr_index];
 
     if(!field_is_array && offsets[start_offset] != 1) {
         // allows us to skip other computes fast
@@ -875,7 +1097,7 @@ bool posting_list_t::is_single_token_verbatim_match(const posting_list_t::iterat
 
     uint32_t end_offset = (curr_index == curr_block->size() - 1) ?
                           curr_block->offsets.getLength() :
-                          it.offset_index[curr_index + 1];
+                          it.get_offset_index()[curr_index + 1];
 
     if(field_is_array) {
        int prev_pos = -1;
@@ -971,6 +1193,29 @@ void posting_list_t::advance_non_largest2(std::vector<posting_list_t::iterator_t
     }
 }
 
+void posting_list_t::skip_past_overlapping_blocks2(std::vector<posting_list_t::iterator_t>& its) {
+    // All common ids up to the smaller of the two block tails have been consumed: move the iterator(s) whose block
+    // ends first to their next block and position the other one right after that tail.
+    const uint32_t last_id0 = its[0].last_block_id();
+    const uint32_t last_id1 = its[1].last_block_id();
+
+    if(last_id0 <= last_id1) {
+        its[0].set_index(its[0].block()->size() - 1);
+        its[0].next();
+    }
+
+    if(last_id1 <= last_id0) {
+        its[1].set_index(its[1].block()->size() - 1);
+        its[1].next();
+    }
+
+    if(last_id0 < last_id1) {
+        its[1].skip_to(last_id0 + 1);
+    } else if(last_id1 < last_id0) {
+        its[0].skip_to(last_id1 + 1);
+    }
+}
+
 uint32_t posting_list_t::advance_smallest(std::vector<posting_list_t::iterator_t>& its) {
     // we will advance the iterator(s) with the smallest value and then return that value
     uint32_t smallest_value = UINT32_MAX;
@@ -1009,13 +1254,13 @@ size_t posting_list_t::num_ids() const {
 }
 
 bool posting_list_t::contains(uint32_t id) {
-    const auto it = id_block_map.lower_bound(id);
+    const size_t pos = id_block_map.lower_bound(id);
 
-    if(it == id_block_map.end()) {
+    if(pos == id_block_map.size()) {
         return false;
     }
 
-    block_t* potential_block = it->second;
+    block_t* potential_block = id_block_map.block_at(pos);
     return potential_block->contains(id);
 }
 
@@ -1076,12 +1321,12 @@ void posting_list_t::get_exact_matches(std::vector<iterator_t>& its, const bool
                         break;
                     }
 
-                    uint32_t* offsets = it.offsets;
+                    const uint32_t* offsets = it.get_offsets();
 
-                    uint32_t start_offset_index = it.offset_index[curr_index];
+                    uint32_t start_offset_index = it.get_offset_index()[curr_index];
                     uint32_t end_offset_index = (curr_index == curr_block->size() - 1) ?
                                                 curr_block->offsets.getLength() :
-                                                it.offset_index[curr_index + 1];
+                                                it.get_offset_index()[curr_index + 1];
 
                     if(j == its.size()-1) {
                         // check if the last query token is the last offset
@@ -1143,11 +1388,11 @@ void posting_list_t::get_exact_matches(std::vector<iterator_t>& its, const bool
                         break;
                     }
 
-                    uint32_t* offsets = it.offsets;
-                    uint32_t start_offset_index = it.offset_index[curr_index];
+                    const uint32_t* offsets = it.get_offsets();
+                    uint32_t start_offset_index = it.get_offset_index()[curr_index];
                     uint32_t end_offset_index = (curr_index == curr_block->size() - 1) ?
                                                 curr_block->offsets.getLength() :
-                                                it.offset_index[curr_index + 1];
+                                                it.get_offset_index()[curr_index + 1];
 
                     int prev_pos = -1;
                     bool has_atleast_one_last_token = false;
@@ -1232,26 +1477,237 @@ void posting_list_t::get_phrase_matches(std::vector<iterator_t>& its, bool field
         for(size_t i = 0; i < num_ids; i++) {
             uint32_t id = ids[i];
 
+            bool has_all_tokens = true;
+
             for (int j = its.size() - 1; j >= 0; j--) {
                 posting_list_t::iterator_t& it = its[j];
                 it.skip_to(id);
+
+                if(!it.valid() || it.id() != id) {
+                    has_all_tokens = false;
+                }
+            }
+
+            if(has_all_tokens && is_phrase_match(its, field_is_array)) {
+                phrase_ids[phrase_id_index] = ids[i];
+                phrase_id_index++;
+            }
+        }
+    }
+
+    num_phrase_ids = phrase_id_index;
+}
+
+namespace {
+    // positions of a token in the document that an iterator is on, plain fields pointing into the offsets as they are
+    struct phrase_token_positions_t {
+        const uint32_t* positions = nullptr;
+        size_t num_positions = 0;
+    };
+
+    void get_offset_range(const posting_list_t::iterator_t& it, uint32_t& start_offset, uint32_t& end_offset) {
+        const uint32_t curr_index = it.index();
+        start_offset = it.get_offset_index()[curr_index];
+        end_offset = (curr_index == it.block()->size() - 1) ? it.block()->offsets.getLength() :
+                     it.get_offset_index()[curr_index + 1];
+    }
+
+    // array index => positions of the token in that element
+    void get_array_positions(const posting_list_t::iterator_t& it,
+                             std::map<uint32_t, std::vector<uint32_t>>& element_positions) {
+        // see `posting_list_t::get_offsets` for the format
+        const uint32_t* offsets = it.get_offsets();
+        uint32_t start_offset, end_offset;
+        get_offset_range(it, start_offset, end_offset);
+
+        std::vector<uint32_t> positions;
+        int prev_pos = -1;
+
+        while(start_offset < end_offset) {
+            int pos = offsets[start_offset];
+            start_offset++;
+
+            if(pos == 0) {
+                start_offset++;
+                continue;
             }
 
-            std::map<size_t, std::vector<token_positions_t>> array_token_positions;
-            get_offsets(its, array_token_positions);
+            if(pos == prev_pos) {
+                if(!positions.empty()) {
+                    uint32_t array_index = offsets[start_offset];
 
-            for(auto& kv: array_token_positions) {
-                bool is_phrase_match = Match(id, kv.second, false, false).phrase_match;
-                if(is_phrase_match) {
-                    phrase_ids[phrase_id_index] = ids[i];
-                    phrase_id_index++;
-                    break;
+                    if(start_offset+1 < end_offset && offsets[start_offset + 1] == 0) {
+                        start_offset++;
+                    }
+
+                    element_positions[array_index] = std::move(positions);
+                    positions.clear();
                 }
+
+                start_offset++;
+                prev_pos = -1;
+                continue;
             }
+
+            prev_pos = pos;
+            positions.push_back(pos);
         }
     }
 
-    num_phrase_ids = phrase_id_index;
+    // Whether a run of consecutive positions holds the tokens one after the other. The candidate start positions of
+    // the run (those of the first token) are narrowed down token by token with the vectorized intersection of the
+    // candidates shifted by the position of the token within the phrase and the positions of the token.
+    bool has_consecutive_positions(const std::vector<phrase_token_positions_t>& token_positions) {
+        thread_local std::vector<uint32_t> starts;
+        thread_local std::vector<uint32_t> shifted_starts;
+        thread_local std::vector<uint32_t> matches0;
+        thread_local std::vector<uint32_t> matches1;
+
+        for(const auto& positions: token_positions) {
+            if(positions.num_positions == 0) {
+                return false;
+            }
+        }
+
+        starts.assign(token_positions[0].positions, token_positions[0].positions + token_positions[0].num_positions);
+
+        for(size_t j = 1; j < token_positions.size(); j++) {
+            shifted_starts.resize(starts.size());
+            for(size_t k = 0; k < starts.size(); k++) {
+                shifted_starts[k] = starts[k] + j;
+            }
+
+            const size_t max_matches = std::min(starts.size(), token_positions[j].num_positions);
+            matches0.resize(max_matches);
+            matches1.resize(max_matches);
+
+            size_t num_matches = ArrayUtils::and_positions(shifted_starts.data(), shifted_starts.size(),
+                                                           token_positions[j].positions,
+                                                           token_positions[j].num_positions,
+                                                           matches0.data(), matches1.data());
+
+            if(num_matches == 0) {
+                return false;
+            }
+
+            for(size_t k = 0; k < num_matches; k++) {
+                starts[k] = starts[matches0[k]];
+            }
+
+            starts.resize(num_matches);
+        }
+
+        return true;
+    }
+}
+
+bool posting_list_t::is_phrase_match(const std::vector<iterator_t>& its, bool field_is_array) {
+    std::vector<const iterator_t*> token_its;
+    for(const auto& it: its) {
+        token_its.push_back(&it);
+    }
+
+    return is_phrase_match(token_its.data(), token_its.size(), field_is_array);
+}
+
+bool posting_list_t::is_phrase_match(const iterator_t* const* token_its, size_t num_tokens, bool field_is_array) {
+    if(num_tokens < 2) {
+        return num_tokens == 1;
+    }
+
+    std::vector<phrase_token_positions_t> token_positions(num_tokens);
+
+    if(!field_is_array) {
+        for(size_t j = 0; j < num_tokens; j++) {
+            uint32_t start_offset, end_offset;
+            get_offset_range(*token_its[j], start_offset, end_offset);
+
+            // the positions are followed by a 0 when the token is the last one of the field
+            const uint32_t* offsets = token_its[j]->get_offsets();
+            if(end_offset > start_offset && offsets[end_offset - 1] == 0) {
+                end_offset--;
+            }
+
+            token_positions[j].positions = offsets + start_offset;
+            token_positions[j].num_positions = end_offset - start_offset;
+        }
+
+        return has_consecutive_positions(token_positions);
+    }
+
+    std::vector<std::map<uint32_t, std::vector<uint32_t>>> token_element_positions(num_tokens);
+    for(size_t j = 0; j < num_tokens; j++) {
+        get_array_positions(*token_its[j], token_element_positions[j]);
+    }
+
+    for(const auto& element: token_element_positions[0]) {
+        bool in_all_tokens = true;
+
+        for(size_t j = 0; j < num_tokens; j++) {
+            const auto element_it = token_element_positions[j].find(element.first);
+            if(element_it == token_element_positions[j].end()) {
+                in_all_tokens = false;
+                break;
+            }
+
+            token_positions[j].positions = element_it->second.data();
+            token_positions[j].num_positions = element_it->second.size();
+        }
+
+        if(in_all_tokens && has_consecutive_positions(token_positions)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void posting_list_t::phrase_intersect(const std::vector<posting_list_t*>& posting_lists, bool field_is_array,
+                                      result_iter_state_t& istate, std::vector<uint32_t>& phrase_ids) {
+    if(posting_lists.empty()) {
+        return;
+    }
+
+    auto its = std::vector<posting_list_t::iterator_t>();
+    its.reserve(posting_lists.size());
+
+    // the iterators of the tokens in the order of the phrase, whatever the order of intersection
+    std::vector<const iterator_t*> token_its(posting_lists.size());
+
+    if(is_skewed(posting_lists)) {
+        std::vector<size_t> list_order(posting_lists.size());
+        for(size_t i = 0; i < list_order.size(); i++) {
+            list_order[i] = i;
+        }
+
+        std::stable_sort(list_order.begin(), list_order.end(), [&](size_t a, size_t b) {
+            return posting_lists[a]->num_ids() < posting_lists[b]->num_ids();
+        });
+
+        for(size_t i = 0; i < list_order.size(); i++) {
+            its.push_back(posting_lists[list_order[i]]->new_iterator());
+            token_its[list_order[i]] = &its.back();
+        }
+
+        block_intersect_skewed(its, istate, [&](uint32_t id, std::vector<iterator_t>& plist_its, size_t index) {
+            if(is_phrase_match(token_its.data(), token_its.size(), field_is_array)) {
+                phrase_ids.push_back(id);
+            }
+        });
+
+        return ;
+    }
+
+    for(size_t i = 0; i < posting_lists.size(); i++) {
+        its.push_back(posting_lists[i]->new_iterator());
+        token_its[i] = &its.back();
+    }
+
+    block_intersect(its, istate, [&](uint32_t id, std::vector<iterator_t>& plist_its, size_t index) {
+        if(is_phrase_match(token_its.data(), token_its.size(), field_is_array)) {
+            phrase_ids.push_back(id);
+        }
+    });
 }
 
 void posting_list_t::get_matching_array_indices(uint32_t id, std::vector<iterator_t>& its,
@@ -1270,11 +1726,11 @@ void posting_list_t::get_matching_array_indices(uint32_t id, std::vector<iterato
             return;
         }
 
-        uint32_t* offsets = it.offsets;
-        uint32_t start_offset_index = it.offset_index[curr_index];
+        const uint32_t* offsets = it.get_offsets();
+        uint32_t start_offset_index = it.get_offset_index()[curr_index];
         uint32_t end_offset_index = (curr_index == curr_block->size() - 1) ?
                                     curr_block->offsets.getLength() :
-                                    it.offset_index[curr_index + 1];
+                                    it.get_offset_index()[curr_index + 1];
 
         int prev_pos = -1;
         while(start_offset_index < end_offset_index) {
@@ -1329,7 +1785,7 @@ bool posting_list_t::all_ended2(const std::vector<posting_list_t::iterator_t>& i
 size_t posting_list_t::get_last_offset(const posting_list_t::iterator_t& it, bool field_is_array) {
     block_t* curr_block = it.block();
     uint32_t curr_index = it.index();
-    uint32_t* offsets = it.offsets;
+    const uint32_t* offsets = it.get_offsets();
 
     if(curr_block == nullptr || curr_index == UINT32_MAX) {
         return 0;
@@ -1337,10 +1793,10 @@ size_t posting_list_t::get_last_offset(const posting_list_t::iterator_t& it, boo
 
     uint32_t end_offset = (curr_index == curr_block->size() - 1) ?
                           curr_block->offsets.getLength() :
-                          it.offset_index[curr_index + 1];
+                          it.get_offset_index()[curr_index + 1];
 
     if(field_is_array) {
-        uint32_t start_offset = it.offset_index[curr_index];
+        uint32_t start_offset = it.get_offset_index()[curr_index];
         int prev_pos = -1;
         size_t max_offset = 0;
 
@@ -1382,7 +1838,7 @@ size_t posting_list_t::get_last_offset(const posting_list_t::iterator_t& it, boo
 
 /* iterator_t operations */
 
-posting_list_t::iterator_t::iterator_t(const std::map<last_id_t, block_t*>* id_block_map,
+posting_list_t::iterator_t::iterator_t(const block_index_t<block_t>* id_block_map,
                                        posting_list_t::block_t* start, posting_list_t::block_t* end,
                                        bool auto_destroy, uint32_t field_id):
         id_block_map(id_block_map), curr_block(start), curr_index(0), end_block(end),
@@ -1390,8 +1846,7 @@ posting_list_t::iterator_t::iterator_t(const std::map<last_id_t, block_t*>* id_b
 
     if(curr_block != end_block) {
         ids = curr_block->ids.uncompress();
-        offset_index = curr_block->offset_index.uncompress();
-        offsets = curr_block->offsets.uncompress();
+        search_profile_add(search_profile_t::BLOCKS_DECOMPRESSED);
     }
 }
 
@@ -1404,17 +1859,13 @@ void posting_list_t::iterator_t::next() {
     if(curr_index == curr_block->size()) {
         curr_index = 0;
         curr_block = curr_block->next;
+        block_pos++;
 
-        delete [] ids;
-        delete [] offset_index;
-        delete [] offsets;
-
-        ids = offset_index = offsets = nullptr;
+        release_block();
 
         if(curr_block != end_block) {
             ids = curr_block->ids.uncompress();
-            offset_index = curr_block->offset_index.uncompress();
-            offsets = curr_block->offsets.uncompress();
+            search_profile_add(search_profile_t::BLOCKS_DECOMPRESSED);
         }
     }
 }
@@ -1448,16 +1899,16 @@ void posting_list_t::iterator_t::skip_to(uint32_t id) {
     // identify the block where the id could exist and skip to that
     reset_cache();
 
-    const auto it = id_block_map->lower_bound(id);
-    if(it == id_block_map->end()) {
+    const size_t pos = id_block_map->lower_bound(id, block_pos);
+    if(pos == id_block_map->size()) {
         return;
     }
 
-    curr_block = it->second;
+    block_pos = pos;
+    curr_block = id_block_map->block_at(pos);
     curr_index = 0;
     ids = curr_block->ids.uncompress();
-    offset_index = curr_block->offset_index.uncompress();
-    offsets = curr_block->offsets.uncompress();
+    search_profile_add(search_profile_t::BLOCKS_DECOMPRESSED);
 
     while(curr_index < curr_block->size() && this->id() < id) {
         curr_index++;
@@ -1468,18 +1919,83 @@ void posting_list_t::iterator_t::skip_to(uint32_t id) {
     }
 }
 
+bool posting_list_t::iterator_t::skip_to_exact(uint32_t id) {
+    // Positions the iterator on `id` only if the list contains it. Unlike `skip_to`, a block is decompressed only
+    // when it actually holds `id`, so probing a long list with a handful of ids touches only a few blocks.
+    // Expects ids to be probed in ascending order.
+
+    if(curr_block == end_block) {
+        return false;
+    }
+
+    if(id <= last_block_id()) {
+        // within the current (decompressed) block
+        uint32_t* found = std::lower_bound(ids + curr_index, ids + curr_block->size(), id);
+        curr_index = (found - ids);
+        return curr_index < curr_block->size() && ids[curr_index] == id;
+    }
+
+    // exponential search over the last ids of the blocks that follow the current block
+    const size_t pos = id_block_map->lower_bound(id, block_pos);
+    if(pos == id_block_map->size()) {
+        // `id` is larger than the last id of the list
+        reset_cache();
+        return false;
+    }
+
+    block_pos = pos;
+    block_t* target_block = id_block_map->block_at(pos);
+
+    // bounded search directly on the compressed ids
+    uint32_t index = target_block->ids.indexOf(id);
+    if(index == target_block->size()) {
+        return false;
+    }
+
+    release_block();
+
+    curr_block = target_block;
+    curr_index = index;
+
+    ids = curr_block->ids.uncompress();
+    search_profile_add(search_profile_t::BLOCKS_DECOMPRESSED);
+
+    return true;
+}
+
 posting_list_t::iterator_t::~iterator_t() {
     if(auto_destroy) {
         reset_cache();
     }
 }
 
-void posting_list_t::iterator_t::reset_cache() {
+void posting_list_t::iterator_t::release_block() {
     delete [] ids;
     delete [] offsets;
     delete [] offset_index;
 
     ids = offset_index = offsets = nullptr;
+}
+
+void posting_list_t::iterator_t::decompress_offsets() const {
+    if(offsets == nullptr && curr_block != end_block) {
+        offset_index = curr_block->offset_index.uncompress();
+        offsets = curr_block->offsets.uncompress();
+    }
+}
+
+const uint32_t* posting_list_t::iterator_t::get_offset_index() const {
+    decompress_offsets();
+    return offset_index;
+}
+
+const uint32_t* posting_list_t::iterator_t::get_offsets() const {
+    decompress_offsets();
+    return offsets;
+}
+
+void posting_list_t::iterator_t::reset_cache() {
+    release_block();
     curr_index = 0;
     curr_block = end_block = nullptr;
 }
@@ -1494,6 +2010,7 @@ posting_list_t::iterator_t::iterator_t(iterator_t&& rhs) noexcept {
     offsets = rhs.offsets;
     auto_destroy = rhs.auto_destroy;
     field_id = rhs.field_id;
+    block_pos = rhs.block_pos;
 
     rhs.id_block_map = nullptr;
     rhs.curr_block = nullptr;
@@ -1513,6 +2030,7 @@ posting_list_t::iterator_t& posting_list_t::iterator_t::operator=(posting_list_t
     offsets = rhs.offsets;
     auto_destroy = rhs.auto_destroy;
     field_id = rhs.field_id;
+    block_pos = rhs.block_pos;
 
     rhs.id_block_map = nullptr;
     rhs.curr_block = nullptr;
@@ -1529,6 +2047,9 @@ void posting_list_t::iterator_t::set_index(uint32_t index) {
 }
 
 posting_list_t::iterator_t posting_list_t::iterator_t::clone() const {
+    // a clone does not own the buffers it shares, so offsets must be decompressed by their owner
+    decompress_offsets();
+
     posting_list_t::iterator_t it(nullptr, nullptr, nullptr);
     it.id_block_map = id_block_map;
     it.curr_block = curr_block;
@@ -1539,6 +2060,7 @@ posting_list_t::iterator_t posting_list_t::iterator_t::clone() const {
     it.offset_index = offset_index;
     it.auto_destroy = false;
     it.field_id = field_id;
+    it.block_pos = block_pos;
     return it;
 }
 
@@ -0,0 +1,53 @@
+#include "query_plan.h"
+#include <algorithm>
+#include <numeric>
+
+void query_plan_t::intersection_order(const std::vector<uint32_t>& token_num_ids, std::vector<uint32_t>& order) {
+    order.resize(token_num_ids.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(), [&token_num_ids](uint32_t a, uint32_t b) {
+        return token_num_ids[a] < token_num_ids[b];
+    });
+}
+
+uint32_t query_plan_t::estimate_num_ids(const std::vector<uint32_t>& token_num_ids, uint32_t filter_ids_length) {
+    if(token_num_ids.empty()) {
+        return 0;
+    }
+
+    uint32_t estimate = *std::min_element(token_num_ids.begin(), token_num_ids.end());
+
+    if(filter_ids_length != 0) {
+        estimate = std::min(estimate, filter_ids_length);
+    }
+
+    return estimate;
+}
+
+void query_plan_t::add_step(query_plan_step_t&& step) {
+    num_suggestions++;
+
+    if(steps.size() < MAX_EXPLAIN_STEPS) {
+        steps.push_back(std::move(step));
+    }
+}
+
+nlohmann::json query_plan_t::to_json() const {
+    nlohmann::json plan = nlohmann::json::object();
+    plan["num_suggestions"] = num_suggestions;
+    plan["suggestions"] = nlohmann::json::array();
+
+    for(const auto& step: steps) {
+        nlohmann::json step_json = nlohmann::json::object();
+        step_json["tokens"] = step.tokens;
+        step_json["token_num_ids"] = step.token_num_ids;
+        step_json["intersection_order"] = step.intersection_order;
+        step_json["typo_cost"] = step.typo_cost;
+        step_json["estimated_num_ids"] = step.estimated_num_ids;
+        step_json["num_found"] = step.num_found;
+        plan["suggestions"].push_back(step_json);
+    }
+
+    return plan;
+}
@@ -1,8 +1,11 @@
 #include "store.h"
 #include "raft_server.h"
 #include <butil/files/file_enumerator.h>
+#include <bthread/unstable.h>
+#include <braft/local_file_meta.pb.h>
 #include <thread>
 #include <algorithm>
+#include <random>
 #include <string_utils.h>
 #include <file_utils.h>
 #include <collection_manager.h>
@@ -87,7 +90,15 @@ int ReplicationState::start(const butil::EndPoint & peering_endpoint, const int
     node_options.election_timeout_ms = election_timeout_ms;
     node_options.fsm = this;
     node_options.node_owns_fsm = false;
+    // a node installing a snapshot copies only the files whose name and checksum its own last snapshot lacks
     node_options.filter_before_copy_remote = true;
+
+    if(config->get_snapshot_max_mb_per_sec() != 0) {
+        snapshot_throttle = new braft::ThroughputSnapshotThrottle(config->get_snapshot_max_mb_per_sec() * 1024 * 1024,
+                                                                  10);
+        node_options.snapshot_throttle = &snapshot_throttle;
+    }
+
     std::string prefix = "local://" + raft_dir;
     node_options.log_uri = prefix + "/" + log_dir_name;
     node_options.raft_meta_uri = prefix + "/" + meta_dir_name;
@@ -192,6 +203,33 @@ void ReplicationState::write(const std::shared_ptr<http_req>& request, const std
         return message_dispatcher->send_message(HttpServer::STREAM_RESPONSE_MESSAGE, req_res);
     }
 
+    // A write of documents to a collection over its memory quota is rejected, and one to a collection nearing it is
+    // shed with a chance that grows as it nears, before it is replicated: the estimates differ from node to node, so
+    // they cannot be acted on as the write is applied. Only the first chunk of an import is checked, so that it is
+    // not cut halfway through.
+    if(request->first_chunk_aggregate && request->http_method != "DELETE" && request->params.count("collection") != 0 &&
+       request->path_without_query.find("/documents") != std::string::npos) {
+        const float quota_usage = CollectionManager::get_instance().get_memory_quota_usage(request->params["collection"]);
+        bool shed = (quota_usage >= 1);
+
+        if(shed) {
+            response->set_422("Rejecting write: collection is over its memory quota.");
+        } else if(quota_usage > Collection::MEMORY_QUOTA_THROTTLE_RATIO) {
+            thread_local std::mt19937 gen(std::random_device{}());
+            std::uniform_real_distribution<float> shed_dist(0, 1);
+            shed = shed_dist(gen) < (quota_usage - Collection::MEMORY_QUOTA_THROTTLE_RATIO) /
+                                    (1 - Collection::MEMORY_QUOTA_THROTTLE_RATIO);
+            response->set(429, "Rejecting write: collection is nearing its memory quota, retry later.");
+        }
+
+        if(shed) {
+            auto req_res = new async_req_res_t(request, response, true);
+            return message_dispatcher->send_message(HttpServer::STREAM_RESPONSE_MESSAGE, req_res);
+        }
+    }
+
+    trace_span_t write_span("raft.write", request->trace_context);
+
     std::shared_lock lock(node_mutex);
 
     if(!node) {
@@ -205,31 +243,135 @@ void ReplicationState::write(const std::shared_ptr<http_req>& request, const std
     // Serialize request to replicated WAL so that all the nodes in the group receive it as well.
     // NOTE: actual write must be done only on the `on_apply` method to maintain consistency.
 
+    const std::string& serialized_request = request->to_json();
+
+    // A write that comes in a single chunk is held back for a few ms, to go into one log entry with the other small
+    // writes made meanwhile. A streamed write has to be proposed chunk by chunk, as its next chunk is only read once
+    // this one is applied.
+    const size_t write_batch_delay_ms = config->get_write_batch_delay_ms();
+    const size_t write_batch_max_bytes = config->get_write_batch_max_bytes();
+
+    if(write_batch_delay_ms != 0 && request->first_chunk_aggregate && request->last_chunk_aggregate &&
+       serialized_request.size() < write_batch_max_bytes) {
+        std::unique_lock batch_lock(write_batch_mutex);
+        const bool schedule_flush = batched_requests.empty();
+
+        append_batch_entry(serialized_request, batched_entry);
+        batched_requests.push_back(request);
+        batched_responses.push_back(response);
+
+        if(batched_entry.size() >= write_batch_max_bytes) {
+            batch_lock.unlock();
+            lock.unlock();
+            return flush_write_batch();
+        }
+
+        if(schedule_flush) {
+            bthread_timer_t timer_id;
+            bthread_timer_add(&timer_id, butil::milliseconds_from_now(write_batch_delay_ms),
+                              on_write_batch_timer, this);
+        }
+
+        return ;
+    }
+
     butil::IOBufBuilder bufBuilder;
-    bufBuilder << request->to_json();
+    bufBuilder << serialized_request;
 
-    //LOG(INFO) << "write() pre request ref count " << request.use_count();
+    // This callback would be invoked when the task actually executes or fails
+    propose(bufBuilder.buf(), new ReplicationClosure(request, response));
+}
 
+void ReplicationState::propose(butil::IOBuf& data, ReplicationClosure* closure) {
     // Apply this log as a braft::Task
 
     braft::Task task;
-    task.data = &bufBuilder.buf();
-    // This callback would be invoked when the task actually executes or fails
-    task.done = new ReplicationClosure(request, response);
-
-    //LOG(INFO) << "write() post request ref count " << request.use_count();
+    task.data = &data;
+    task.done = closure;
 
     // To avoid ABA problem
     task.expected_term = leader_term.load(butil::memory_order_relaxed);
 
-    //LOG(INFO) << ":::" << "body size before apply: " << request->body.size();
-
     // Now the task is applied to the group
     node->apply(task);
 
     pending_writes++;
 }
 
+void ReplicationState::flush_write_batch() {
+    std::vector<std::shared_ptr<http_req>> requests;
+    std::vector<std::shared_ptr<http_res>> responses;
+    std::string entry;
+
+    {
+        std::unique_lock batch_lock(write_batch_mutex);
+        requests = std::move(batched_requests);
+        responses = std::move(batched_responses);
+        entry = std::move(batched_entry);
+
+        batched_requests.clear();
+        batched_responses.clear();
+        batched_entry.clear();
+    }
+
+    if(requests.empty()) {
+        // already flushed for being full
+        return ;
+    }
+
+    std::shared_lock lock(node_mutex);
+
+    if(!node) {
+        return ;
+    }
+
+    butil::IOBuf data;
+
+    if(requests.size() == 1) {
+        // proposed as is, as a single write would have been
+        data.append(entry.data() + 5, entry.size() - 5);
+    } else {
+        data.append(entry);
+    }
+
+    propose(data, new ReplicationClosure(std::move(requests), std::move(responses)));
+}
+
+void ReplicationState::on_write_batch_timer(void* arg) {
+    static_cast<ReplicationState*>(arg)->flush_write_batch();
+}
+
+void ReplicationState::append_batch_entry(const std::string& serialized_request, std::string& entry) {
+    if(entry.empty()) {
+        entry += BATCH_ENTRY_MARKER;
+    }
+
+    entry += StringUtils::serialize_uint32_t(serialized_request.size());
+    entry += serialized_request;
+}
+
+bool ReplicationState::parse_batch_entry(const std::string& entry, std::vector<std::string>& serialized_requests) {
+    size_t offset = 1;
+
+    while(offset < entry.size()) {
+        if(offset + 4 > entry.size()) {
+            return false;
+        }
+
+        const uint32_t size = StringUtils::deserialize_uint32_t(entry.substr(offset, 4));
+        offset += 4;
+
+        if(offset + size > entry.size()) {
+            return false;
+        }
+
+        serialized_requests.push_back(entry.substr(offset, size));
+        offset += size;
+    }
+
+    return true;
+}
+
 void ReplicationState::write_to_leader(const std::shared_ptr<http_req>& request, const std::shared_ptr<http_res>& response) {
     // no lock on `node` needed as caller uses the lock
     if(!node || node->leader_id().is_empty()) {
@@ -267,7 +409,8 @@ void ReplicationState::write_to_leader(const std::shared_ptr<http_req>& request,
     const std::string& scheme = std::string(raw_req->scheme->name.base, raw_req->scheme->name.len);
     const std::string url = get_node_url_path(leader_addr, path, scheme);
 
-    thread_pool->enqueue([request, response, server, path, url, this]() {
+    thread_pool->enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::REQUEST,
+                              [request, response, server, path, url, this]() {
         pending_writes++;
 
         std::map<std::string, std::string> res_headers;
@@ -339,27 +482,49 @@ void ReplicationState::on_apply(braft::Iterator& iter) {
         // Guard invokes replication_arg->done->Run() asynchronously to avoid the callback blocking the main thread
         braft::AsyncClosureGuard closure_guard(iter.done());
 
+        num_applied_entries++;
+        num_applied_bytes += iter.data().size();
+
         //LOG(INFO) << "Apply entry";
 
-        const std::shared_ptr<http_req>& request_generated = iter.done() ?
-                         dynamic_cast<ReplicationClosure*>(iter.done())->get_request() : std::make_shared<http_req>();
+        std::vector<std::shared_ptr<http_req>> requests;
+        std::vector<std::shared_ptr<http_res>> responses;
 
-        //LOG(INFO) << "Post assignment " << request_generated.get() << ", use count: " << request_generated.use_count();
+        if(iter.done()) {
+            ReplicationClosure* closure = dynamic_cast<ReplicationClosure*>(iter.done());
+            requests = closure->get_requests();
+            responses = closure->get_responses();
+        } else {
+            // indicates log serialized request(s)
+            const std::string& entry = iter.data().to_string();
+            std::vector<std::string> serialized_requests;
 
-        const std::shared_ptr<http_res>& response_generated = iter.done() ?
-                dynamic_cast<ReplicationClosure*>(iter.done())->get_response() : std::make_shared<http_res>(nullptr);
+            if(!entry.empty() && entry[0] == BATCH_ENTRY_MARKER) {
+                if(!parse_batch_entry(entry, serialized_requests)) {
+                    LOG(ERROR) << "Skipping malformed batch of writes at log index " << iter.index();
+                }
+            } else {
+                serialized_requests.push_back(entry);
+            }
 
-        if(!iter.done()) {
-            // indicates log serialized request
-            request_generated->load_from_json(iter.data().to_string());
+            for(const auto& serialized_request: serialized_requests) {
+                requests.push_back(std::make_shared<http_req>());
+                requests.back()->load_from_json(serialized_request);
+                responses.push_back(std::make_shared<http_res>(nullptr));
+            }
         }
 
-        request_generated->log_index = iter.index();
-
         // To avoid blocking the serial Raft write thread persist the log entry in local storage.
         // Actual operations will be done in collection-sharded batch indexing threads.
 
-        batched_indexer->enqueue(request_generated, response_generated);
+        for(size_t i = 0; i < requests.size(); i++) {
+            trace_span_t apply_span("raft.apply", requests[i]->trace_context);
+            apply_span.set_attribute("log_index", iter.index());
+
+            // the requests of a batch share its log index
+            requests[i]->log_index = iter.index();
+            batched_indexer->enqueue(requests[i], responses[i]);
+        }
 
         if(iter.done()) {
             pending_writes--;
@@ -380,19 +545,55 @@ void* ReplicationState::save_snapshot(void* arg) {
     SnapshotArg* sa = static_cast<SnapshotArg*>(arg);
     std::unique_ptr<SnapshotArg> arg_guard(sa);
 
-    // add the db snapshot files to writer state
-    butil::FileEnumerator dir_enum(butil::FilePath(sa->db_snapshot_path), false, butil::FileEnumerator::FILES);
+    // Every file is added with a checksum: a node installing the snapshot reuses the files its own last snapshot
+    // holds with the same name and checksum, and keeps the ones it already copied when an earlier install of
+    // this snapshot got interrupted. Table files are hard links to the store's own and get the checksum the
+    // store took when writing them, while the rest were just written and are read back for theirs.
+    uint64_t snapshot_bytes = 0;
+
+    auto add_files = [sa, &snapshot_bytes](const std::string& dir_path, const std::string& dir_name) {
+        butil::FileEnumerator dir_enum(butil::FilePath(dir_path), false, butil::FileEnumerator::FILES);
+
+        for (butil::FilePath file = dir_enum.Next(); !file.empty(); file = dir_enum.Next()) {
+            const std::string& base_name = file.BaseName().value();
+            snapshot_bytes += dir_enum.GetInfo().GetSize();
+            std::string file_name = dir_name + "/" + base_name;
+
+            braft::LocalFileMeta file_meta;
+            std::string checksum;
+            auto checksum_it = sa->db_file_checksums.find(base_name);
+
+            if(dir_name == db_snapshot_name && StringUtils::ends_with(base_name, ".sst")) {
+                // tables written before the store took checksums are not read in full just for one
+                if(checksum_it != sa->db_file_checksums.end()) {
+                    file_meta.set_checksum(checksum_it->second);
+                }
+            } else if(file_checksum(file.value(), checksum)) {
+                file_meta.set_checksum(checksum);
+            }
 
-    for (butil::FilePath file = dir_enum.Next(); !file.empty(); file = dir_enum.Next()) {
-        std::string file_name = std::string(db_snapshot_name) + "/" + file.BaseName().value();
-        if (sa->writer->add_file(file_name) != 0) {
-            sa->done->status().set_error(EIO, "Fail to add file to writer.");
-            return nullptr;
+            if (sa->writer->add_file(file_name, file_meta.has_checksum() ? &file_meta : nullptr) != 0) {
+                return false;
+            }
         }
+
+        return true;
+    };
+
+    // the index snapshot is optional: loading falls back to indexing documents in full without it
+    if(!add_files(sa->db_snapshot_path, db_snapshot_name) ||
+       !add_files(sa->index_snapshot_path, index_snapshot_name)) {
+        sa->done->status().set_error(EIO, "Fail to add file to writer.");
+        return nullptr;
     }
 
     const std::string& temp_snapshot_dir = sa->writer->get_path();
 
+    sa->replication_state->num_snapshots++;
+    sa->replication_state->last_snapshot_bytes = snapshot_bytes;
+    sa->replication_state->last_snapshot_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - sa->start_time).count();
+
     sa->done->Run();
 
     // if an external snapshot is requested, copy latest snapshot directory into that
@@ -433,7 +634,10 @@ void* ReplicationState::save_snapshot(void* arg) {
 void ReplicationState::on_snapshot_save(braft::SnapshotWriter* writer, braft::Closure* done) {
     LOG(INFO) << "on_snapshot_save";
 
+    const auto start_time = std::chrono::steady_clock::now();
+
     std::string db_snapshot_path = writer->get_path() + "/" + db_snapshot_name;
+    std::string index_snapshot_path = writer->get_path() + "/" + index_snapshot_name;
 
     {
         // grab batch indexer lock so that we can take a clean snapshot
@@ -448,6 +652,8 @@ void ReplicationState::on_snapshot_save(braft::SnapshotWriter* writer, braft::Cl
         // this will block writes, but should be pretty fast
         batched_indexer->clear_skip_indices();
 
+        const uint64_t store_seq_number = store->get_latest_seq_number();
+
         rocksdb::Checkpoint* checkpoint = nullptr;
         rocksdb::Status status = store->create_check_point(&checkpoint, db_snapshot_path);
         std::unique_ptr<rocksdb::Checkpoint> checkpoint_guard(checkpoint);
@@ -455,6 +661,17 @@ void ReplicationState::on_snapshot_save(braft::SnapshotWriter* writer, braft::Cl
         if(!status.ok()) {
             LOG(ERROR) << "Failure during checkpoint creation, msg:" << status.ToString();
             done->status().set_error(EIO, "Checkpoint creation failure.");
+        } else {
+            // the in-memory index matches the checkpoint while writes are paused, so a load off this snapshot can
+            // restore the search trees instead of tokenizing all documents again
+            Option<bool> index_snapshot_op = create_directory(index_snapshot_path) ?
+                CollectionManager::get_instance().save_index_snapshots(index_snapshot_path, store_seq_number) :
+                Option<bool>(500, "Could not create the index snapshot directory.");
+
+            if(!index_snapshot_op.ok()) {
+                LOG(ERROR) << "Failure during index snapshot creation, msg: " << index_snapshot_op.error();
+                delete_path(index_snapshot_path);
+            }
         }
     }
 
@@ -463,6 +680,9 @@ void ReplicationState::on_snapshot_save(braft::SnapshotWriter* writer, braft::Cl
     arg->writer = writer;
     arg->state_dir_path = raft_dir_path;
     arg->db_snapshot_path = db_snapshot_path;
+    arg->index_snapshot_path = index_snapshot_path;
+    arg->db_file_checksums = store->get_table_file_checksums();
+    arg->start_time = start_time;
     arg->done = done;
 
     if(!ext_snapshot_path.empty()) {
@@ -512,6 +732,8 @@ int ReplicationState::on_snapshot_load(braft::SnapshotReader* reader) {
         return reload_store;
     }
 
+    CollectionManager::get_instance().set_index_snapshot_dir(reader->get_path() + "/" + index_snapshot_name);
+
     bool init_db_status = init_db();
 
     return init_db_status;
@@ -628,6 +850,10 @@ void ReplicationState::refresh_catchup_status(bool log_msg) {
         }
     }
 
+    // every write this node knows to be committed is searchable
+    const bool is_applied = (apply_lag == 0 && num_queued_writes == 0 &&
+                             n_status.known_applied_index >= n_status.committed_index);
+
     if(is_leader || !this->read_caught_up) {
         // no need to re-check status with leader
         return ;
@@ -663,7 +889,14 @@ void ReplicationState::refresh_catchup_status(bool log_msg) {
     nlohmann::json leader_status = nlohmann::json::parse(api_res);
     if(leader_status.contains("committed_index")) {
         int64_t leader_committed_index = leader_status["committed_index"].get<int64_t>();
+        this->leader_committed_index = leader_committed_index;
+
         if(leader_committed_index <= n_status.committed_index) {
+            if(is_applied) {
+                last_caught_up_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+            }
+
             // this can happen due to network latency in making the /status call
             // we will refrain from changing current status
             return ;
@@ -687,13 +920,14 @@ ReplicationState::ReplicationState(HttpServer* server, BatchedIndexer* batched_i
         num_collections_parallel_load(num_collections_parallel_load),
         num_documents_parallel_load(num_documents_parallel_load),
         ready(false), shutting_down(false), pending_writes(0),
-        last_snapshot_ts(std::time(nullptr)), snapshot_interval_s(config->get_snapshot_interval_seconds()) {
+        last_snapshot_ts(std::time(nullptr)), snapshot_interval_s(config->get_snapshot_interval_seconds()),
+        expiring_documents(false) {
 
 }
 
 bool ReplicationState::is_alive() const {
-    // for general health check we will only care about the `read_caught_up` threshold
-    return read_caught_up;
+    // for general health check we will only care about the `read_caught_up` threshold, once the caches are warm
+    return read_caught_up && !CollectionManager::get_instance().is_warming();
 }
 
 uint64_t ReplicationState::node_state() const {
@@ -750,6 +984,48 @@ void ReplicationState::do_dummy_write() {
     LOG(INFO) << "Dummy write to " << url << ", status = " << status_code << ", response = " << api_res;
 }
 
+void ReplicationState::expire_documents() {
+    std::shared_lock lock(node_mutex);
+
+    if(!node || !node->is_leader() || shutting_down) {
+        return ;
+    }
+
+    const std::string& leader_addr = node->leader_id().to_string();
+    lock.unlock();
+
+    if(expiring_documents.exchange(true)) {
+        // previous sweep is still going on
+        return ;
+    }
+
+    const std::string protocol = api_uses_ssl ? "https" : "http";
+
+    thread_pool->enqueue([this, leader_addr, protocol]() {
+        const uint64_t now_s = std::time(nullptr);
+        const auto& paths = CollectionManager::get_instance().get_expiry_paths(now_s, DOC_EXPIRY_BATCH_SIZE);
+
+        for(const auto& path: paths) {
+            if(shutting_down) {
+                break;
+            }
+
+            // the deletion yields to other requests in between its batches
+            std::string api_res;
+            std::map<std::string, std::string> res_headers;
+            long status_code = HttpClient::delete_response(get_node_url_path(leader_addr, path, protocol),
+                                                           api_res, res_headers);
+
+            if(status_code != 200) {
+                LOG(ERROR) << "Expiry of documents failed, path: " << path << ", status = " << status_code
+                           << ", response = " << api_res;
+            }
+        }
+
+        expiring_documents = false;
+    });
+}
+
 bool ReplicationState::trigger_vote() {
     std::shared_lock lock(node_mutex);
 
@@ -812,6 +1088,42 @@ int64_t ReplicationState::get_num_queued_writes() {
     return batched_indexer->get_queued_writes();
 }
 
+int64_t ReplicationState::get_indexed_index() {
+    std::shared_lock lock(node_mutex);
+
+    if(!node) {
+        return 0;
+    }
+
+    braft::NodeStatus n_status;
+    node->get_status(&n_status);
+    lock.unlock();
+
+    // Applied writes are handed to the batched indexer before braft counts them as applied, so once its queue is
+    // empty, every write applied before the queue was looked at is indexed. Writes are indexed concurrently and
+    // out of log order, so nothing is known of the ones applied since the queue was last found empty.
+    if(batched_indexer->get_queued_writes() == 0) {
+        int64_t prev_indexed_index = indexed_index;
+        while(prev_indexed_index < n_status.known_applied_index &&
+              !indexed_index.compare_exchange_weak(prev_indexed_index, n_status.known_applied_index)) {
+
+        }
+    }
+
+    return indexed_index;
+}
+
+uint64_t ReplicationState::get_staleness_ms() {
+    if(is_leader()) {
+        return 0;
+    }
+
+    const uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+    return now_ms - std::min<uint64_t>(now_ms, last_caught_up_ms);
+}
+
 bool ReplicationState::is_leader() {
     std::shared_lock lock(node_mutex);
 
@@ -845,6 +1157,33 @@ nlohmann::json ReplicationState::get_status() {
     return status;
 }
 
+void ReplicationState::get_replication_stats(replication_stats_t& stats) {
+    {
+        std::shared_lock lock(node_mutex);
+
+        if(node) {
+            braft::NodeStatus n_status;
+            node->get_status(&n_status);
+
+            stats.is_leader = node->is_leader();
+            stats.committed_index = n_status.committed_index;
+            stats.applied_index = n_status.known_applied_index;
+            stats.leader_committed_index = stats.is_leader ? n_status.committed_index : leader_committed_index.load();
+        }
+    }
+
+    stats.indexed_index = get_indexed_index();
+
+    stats.num_applied_entries = num_applied_entries;
+    stats.num_applied_bytes = num_applied_bytes;
+
+    stats.num_snapshots = num_snapshots;
+    stats.last_snapshot_duration_ms = last_snapshot_duration_ms;
+    stats.last_snapshot_bytes = last_snapshot_bytes;
+
+    batched_indexer->get_queued_writes_by_collection(stats.queued_writes);
+}
+
 void ReplicationState::do_snapshot(const std::string& nodes) {
     auto current_ts = std::time(nullptr);
     if(current_ts - last_snapshot_ts < snapshot_interval_s) {
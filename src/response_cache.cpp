@@ -0,0 +1,141 @@
+#include "response_cache.h"
+
+ResponseCache::ResponseCache(size_t max_bytes): max_stripe_bytes(max_bytes / NUM_STRIPES) {
+
+}
+
+size_t ResponseCache::get_bytes(const cached_res_t& res) {
+    size_t bytes = sizeof(entry_t) + res.body.size() + res.content_type_header.size();
+
+    for(const auto& name_generation: res.write_generations) {
+        bytes += sizeof(name_generation) + name_generation.first.size();
+    }
+
+    return bytes;
+}
+
+ResponseCache::stripe_t& ResponseCache::get_stripe(uint64_t hash) {
+    // the low bits of the hash pick the bucket of the stripe's map, so the stripe is picked by the high bits
+    return stripes[(hash >> 32) % NUM_STRIPES];
+}
+
+void ResponseCache::evict(stripe_t& stripe, size_t max_bytes) {
+    while(stripe.bytes > max_bytes && !stripe.entries.empty()) {
+        const entry_t& entry = stripe.entries.back();
+        stripe.bytes -= entry.bytes;
+        stripe.entry_its.erase(entry.hash);
+        stripe.entries.pop_back();
+        num_evictions++;
+    }
+}
+
+void ResponseCache::set_max_bytes(size_t max_bytes) {
+    max_stripe_bytes = max_bytes / NUM_STRIPES;
+
+    for(auto& stripe: stripes) {
+        std::unique_lock lock(stripe.mutex);
+        evict(stripe, max_stripe_bytes);
+    }
+}
+
+bool ResponseCache::get(uint64_t hash, cached_res_t& res) {
+    stripe_t& stripe = get_stripe(hash);
+    std::unique_lock lock(stripe.mutex);
+
+    auto entry_it_it = stripe.entry_its.find(hash);
+    if(entry_it_it == stripe.entry_its.end()) {
+        num_misses++;
+        return false;
+    }
+
+    auto entry_it = entry_it_it->second;
+    const uint64_t seconds_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::high_resolution_clock::now() - entry_it->res.created_at).count();
+
+    if(seconds_elapsed >= entry_it->res.ttl) {
+        stripe.bytes -= entry_it->bytes;
+        stripe.entries.erase(entry_it);
+        stripe.entry_its.erase(entry_it_it);
+        num_misses++;
+        return false;
+    }
+
+    stripe.entries.splice(stripe.entries.begin(), stripe.entries, entry_it);
+    res = entry_it->res;
+    num_hits++;
+
+    return true;
+}
+
+void ResponseCache::insert(uint64_t hash, const cached_res_t& res) {
+    const size_t entry_bytes = get_bytes(res);
+    const size_t stripe_max_bytes = max_stripe_bytes;
+
+    if(entry_bytes > stripe_max_bytes / MAX_ENTRY_FRACTION) {
+        num_rejections++;
+        return ;
+    }
+
+    stripe_t& stripe = get_stripe(hash);
+    std::unique_lock lock(stripe.mutex);
+
+    auto entry_it_it = stripe.entry_its.find(hash);
+    if(entry_it_it != stripe.entry_its.end()) {
+        stripe.bytes -= entry_it_it->second->bytes;
+        stripe.entries.erase(entry_it_it->second);
+        stripe.entry_its.erase(entry_it_it);
+    }
+
+    evict(stripe, stripe_max_bytes - entry_bytes);
+
+    stripe.entries.push_front(entry_t{hash, res, entry_bytes});
+    stripe.entry_its.emplace(hash, stripe.entries.begin());
+    stripe.bytes += entry_bytes;
+}
+
+void ResponseCache::clear() {
+    for(auto& stripe: stripes) {
+        std::unique_lock lock(stripe.mutex);
+        stripe.entries.clear();
+        stripe.entry_its.clear();
+        stripe.bytes = 0;
+    }
+}
+
+size_t ResponseCache::size() {
+    size_t num_entries = 0;
+
+    for(auto& stripe: stripes) {
+        std::unique_lock lock(stripe.mutex);
+        num_entries += stripe.entries.size();
+    }
+
+    return num_entries;
+}
+
+size_t ResponseCache::bytes() {
+    size_t num_bytes = 0;
+
+    for(auto& stripe: stripes) {
+        std::unique_lock lock(stripe.mutex);
+        num_bytes += stripe.bytes;
+    }
+
+    return num_bytes;
+}
+
+uint64_t ResponseCache::get_num_hits() const {
+    return num_hits;
+}
+
+uint64_t ResponseCache::get_num_misses() const {
+    return num_misses;
+}
+
+uint64_t ResponseCache::get_num_evictions() const {
+    return num_evictions;
+}
+
+uint64_t ResponseCache::get_num_rejections() const {
+    return num_rejections;
+}
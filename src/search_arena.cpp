@@ -0,0 +1,48 @@
+#include "search_arena.h"
+
+thread_local search_arena_t* search_arena = nullptr;
+
+search_arena_t::~search_arena_t() {
+    for(auto& block: blocks) {
+        ::operator delete(block.data);
+    }
+}
+
+void* search_arena_t::allocate(size_t num_bytes, size_t alignment) {
+    while(block_index < blocks.size()) {
+        block_t& block = blocks[block_index];
+        const size_t aligned_offset = (offset + alignment - 1) & ~(alignment - 1);
+
+        if(aligned_offset + num_bytes <= block.num_bytes) {
+            offset = aligned_offset + num_bytes;
+            return block.data + aligned_offset;
+        }
+
+        // a block that is too small for the request is skipped over, and used again once the arena is rewound
+        block_index++;
+        offset = 0;
+    }
+
+    // a new block is at least twice as large as the last one, so that a search needs only a few of them
+    size_t block_bytes = blocks.empty() ? FIRST_BLOCK_BYTES : blocks.back().num_bytes * 2;
+    while(block_bytes < num_bytes + alignment) {
+        block_bytes *= 2;
+    }
+
+    blocks.push_back(block_t{static_cast<char*>(::operator new(block_bytes)), block_bytes});
+    block_index = blocks.size() - 1;
+
+    const size_t aligned_offset = (reinterpret_cast<uintptr_t>(blocks.back().data) % alignment == 0) ? 0 :
+                                  alignment - reinterpret_cast<uintptr_t>(blocks.back().data) % alignment;
+    offset = aligned_offset + num_bytes;
+    return blocks.back().data + aligned_offset;
+}
+
+size_t search_arena_t::reserved_bytes() const {
+    size_t num_bytes = 0;
+    for(const auto& block: blocks) {
+        num_bytes += block.num_bytes;
+    }
+
+    return num_bytes;
+}
@@ -0,0 +1,51 @@
+#include "search_profile.h"
+
+const char* search_profile_t::get_stage_name(stage_t stage) {
+    switch(stage) {
+        case FILTER:
+            return "filter";
+        case CANDIDATES:
+            return "candidates";
+        case INTERSECTION:
+            return "intersection";
+        case FACETS:
+            return "facets";
+        case HIGHLIGHT:
+            return "highlight";
+        case HYDRATION:
+            return "hydration";
+        default:
+            return "";
+    }
+}
+
+const char* search_profile_t::get_counter_name(counter_t counter) {
+    switch(counter) {
+        case CANDIDATES_GENERATED:
+            return "candidates_generated";
+        case IDS_INTERSECTED:
+            return "ids_intersected";
+        case BLOCKS_DECOMPRESSED:
+            return "blocks_decompressed";
+        case STORE_READS:
+            return "store_reads";
+        default:
+            return "";
+    }
+}
+
+nlohmann::json search_profile_t::to_json() const {
+    nlohmann::json profile = nlohmann::json::object();
+    profile["stages_ms"] = nlohmann::json::object();
+    profile["counters"] = nlohmann::json::object();
+
+    for(size_t i = 0; i < NUM_STAGES; i++) {
+        profile["stages_ms"][get_stage_name(stage_t(i))] = stage_nanos[i].load(std::memory_order_relaxed) / 1e6;
+    }
+
+    for(size_t i = 0; i < NUM_COUNTERS; i++) {
+        profile["counters"][get_counter_name(counter_t(i))] = counters[i].load(std::memory_order_relaxed);
+    }
+
+    return profile;
+}
@@ -0,0 +1,87 @@
+#include "slow_query_log.h"
+#include <chrono>
+#include <random>
+#include "logger.h"
+
+bool SlowQueryLog::init(const std::string& path, int time_threshold_ms, float sample_ratio) {
+    this->time_threshold_ms = time_threshold_ms;
+    this->sample_ratio = sample_ratio;
+
+    if(time_threshold_ms < 0 && sample_ratio <= 0) {
+        return true;
+    }
+
+    out.open(path, std::ofstream::out | std::ofstream::app);
+    if(!out.is_open()) {
+        LOG(ERROR) << "Could not open the slow query log at " << path;
+        return false;
+    }
+
+    quit = false;
+    writer = std::thread(&SlowQueryLog::run_writer, this);
+    enabled = true;
+
+    return true;
+}
+
+void SlowQueryLog::dispose() {
+    if(!writer.joinable()) {
+        return ;
+    }
+
+    enabled = false;
+    quit = true;
+    writer.join();
+
+    drain();
+    out.close();
+}
+
+bool SlowQueryLog::should_log(uint64_t time_ms, bool& is_slow) const {
+    if(!enabled) {
+        return false;
+    }
+
+    const int threshold_ms = time_threshold_ms;
+    is_slow = (threshold_ms >= 0 && time_ms >= uint64_t(threshold_ms));
+
+    if(is_slow) {
+        return true;
+    }
+
+    const float ratio = sample_ratio;
+    if(ratio <= 0) {
+        return false;
+    }
+
+    thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_real_distribution<float> sample_dist(0, 1);
+    return sample_dist(gen) < ratio;
+}
+
+void SlowQueryLog::log(std::string&& entry) {
+    if(!entries.push(std::move(entry))) {
+        num_dropped++;
+    }
+}
+
+void SlowQueryLog::drain() {
+    std::string entry;
+    bool written = false;
+
+    while(entries.pop(entry)) {
+        out << entry << "\n";
+        written = true;
+    }
+
+    if(written) {
+        out << std::flush;
+    }
+}
+
+void SlowQueryLog::run_writer() {
+    while(!quit) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_INTERVAL_MS));
+    }
+}
@@ -0,0 +1,95 @@
+#include "sort_column.h"
+#include <stdexcept>
+#include <algorithm>
+#include "memory_usage.h"
+
+bool sort_column_t::emplace(uint32_t id, int64_t value) {
+    if(contains(id)) {
+        return false;
+    }
+
+    if(id >= values.size()) {
+        // grows geometrically, so that appending in seq_id order stays amortized O(1)
+        values.resize(size_t(id) + 1);
+        present_words.resize((size_t(id) + 64) / 64, 0);
+    }
+
+    values[id] = value;
+    present_words[id / 64] |= (uint64_t(1) << (id % 64));
+    num_values++;
+
+    return true;
+}
+
+void sort_column_t::erase(uint32_t id) {
+    if(!contains(id)) {
+        return ;
+    }
+
+    present_words[id / 64] &= ~(uint64_t(1) << (id % 64));
+    num_values--;
+
+    if(num_values == 0) {
+        // a column emptied by deletions gives its memory back
+        std::vector<int64_t>().swap(values);
+        std::vector<uint64_t>().swap(present_words);
+    }
+}
+
+void sort_column_t::get_batch(const uint32_t* ids, size_t num_ids, int64_t missing_value, int64_t* out) const {
+    if(values.empty()) {
+        std::fill(out, out + num_ids, missing_value);
+        return ;
+    }
+
+    const size_t num_slots = values.size();
+
+    // branch free, so that the loads of a batch can be in flight together
+    for(size_t i = 0; i < num_ids; i++) {
+        const uint32_t id = ids[i];
+        const bool in_range = id < num_slots;
+        const size_t slot = in_range ? id : 0;
+        const bool present = in_range & ((present_words[slot / 64] >> (slot % 64)) & 1);
+        out[i] = present ? values[slot] : missing_value;
+    }
+}
+
+void sort_column_t::count_ranges(const uint32_t* ids, size_t num_ids, const int64_t* range_mins,
+                                 const int64_t* range_maxs, size_t num_ranges, uint32_t* counts) const {
+    constexpr size_t BATCH_SIZE = 256;
+    int64_t batch_values[BATCH_SIZE];
+
+    for(size_t i = 0; i < num_ids; i += BATCH_SIZE) {
+        const size_t batch_len = std::min(BATCH_SIZE, num_ids - i);
+        get_batch(ids + i, batch_len, INT64_MIN, batch_values);
+
+        for(size_t r = 0; r < num_ranges; r++) {
+            const int64_t range_min = range_mins[r], range_max = range_maxs[r];
+            uint32_t count = 0;
+
+            // without branches, so that the comparisons of a batch are vectorized
+            for(size_t j = 0; j < batch_len; j++) {
+                count += uint32_t(batch_values[j] >= range_min) & uint32_t(batch_values[j] <= range_max);
+            }
+
+            counts[r] += count;
+        }
+    }
+}
+
+int64_t sort_column_t::at(uint32_t id) const {
+    int64_t value;
+    if(!get(id, value)) {
+        throw std::out_of_range("sort_column_t::at");
+    }
+
+    return value;
+}
+
+size_t sort_column_t::size() const {
+    return num_values;
+}
+
+size_t sort_column_t::memory_bytes() const {
+    return sizeof(sort_column_t) + memory_usage::vector_bytes(values) + memory_usage::vector_bytes(present_words);
+}
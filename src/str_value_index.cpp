@@ -0,0 +1,97 @@
+#include "str_value_index.h"
+#include "memory_usage.h"
+
+void str_value_index_t::insert(uint64_t value_hash, uint32_t id) {
+    if(overflowed) {
+        return ;
+    }
+
+    auto it = value_ids.find(value_hash);
+
+    if(it == value_ids.end()) {
+        if(value_ids.size() == MAX_VALUES) {
+            destroy();
+            overflowed = true;
+            return ;
+        }
+
+        value_ids.emplace(value_hash, SET_COMPACT_IDS(compact_id_list_t::create(1, {id})));
+        return ;
+    }
+
+    ids_t::upsert(it->second, id);
+}
+
+void str_value_index_t::remove(uint64_t value_hash, uint32_t id) {
+    auto it = value_ids.find(value_hash);
+    if(it == value_ids.end()) {
+        return ;
+    }
+
+    ids_t::erase(it->second, id);
+
+    if(ids_t::num_ids(it->second) == 0) {
+        ids_t::destroy_list(it->second);
+        value_ids.erase(it);
+    }
+}
+
+bool str_value_index_t::is_usable() const {
+    return !overflowed;
+}
+
+size_t str_value_index_t::num_ids(uint64_t value_hash) const {
+    const auto it = value_ids.find(value_hash);
+    return (it == value_ids.end()) ? 0 : ids_t::num_ids(it->second);
+}
+
+void str_value_index_t::search(const std::vector<uint64_t>& value_hashes, uint32_t** ids, size_t& ids_len) const {
+    std::vector<void*> id_lists;
+
+    for(auto value_hash: value_hashes) {
+        const auto it = value_ids.find(value_hash);
+        if(it != value_ids.end()) {
+            id_lists.push_back(it->second);
+        }
+    }
+
+    *ids = nullptr;
+    ids_len = 0;
+
+    if(id_lists.empty()) {
+        return ;
+    }
+
+    std::vector<uint32_t> result_ids;
+    ids_t::merge(id_lists, result_ids);
+
+    *ids = new uint32_t[result_ids.size()];
+    std::copy(result_ids.begin(), result_ids.end(), *ids);
+    ids_len = result_ids.size();
+}
+
+size_t str_value_index_t::size() const {
+    return value_ids.size();
+}
+
+size_t str_value_index_t::memory_bytes() const {
+    size_t bytes = sizeof(str_value_index_t) + memory_usage::sparse_map_bytes(value_ids);
+
+    for(const auto& kv: value_ids) {
+        bytes += ids_t::memory_bytes(kv.second);
+    }
+
+    return bytes;
+}
+
+void str_value_index_t::destroy() {
+    for(auto& kv: value_ids) {
+        ids_t::destroy_list(kv.second);
+    }
+
+    value_ids.clear();
+}
+
+str_value_index_t::~str_value_index_t() {
+    destroy();
+}
@@ -1,6 +1,41 @@
 #include "synonym_index.h"
 
 
+void SynonymIndex::add_phrase(const std::vector<std::string>& phrase) {
+    uint32_t node_id = 0;
+
+    for(const auto& token: phrase) {
+        auto child_it = phrase_nodes[node_id].children.find(token);
+        if(child_it == phrase_nodes[node_id].children.end()) {
+            const uint32_t child_id = phrase_nodes.size();
+            phrase_nodes[node_id].children.emplace(token, child_id);
+            phrase_nodes.emplace_back();
+            node_id = child_id;
+        } else {
+            node_id = child_it->second;
+        }
+    }
+
+    phrase_nodes[node_id].num_phrases++;
+}
+
+void SynonymIndex::remove_phrase(const std::vector<std::string>& phrase) {
+    uint32_t node_id = 0;
+
+    for(const auto& token: phrase) {
+        auto child_it = phrase_nodes[node_id].children.find(token);
+        if(child_it == phrase_nodes[node_id].children.end()) {
+            return ;
+        }
+
+        node_id = child_it->second;
+    }
+
+    if(phrase_nodes[node_id].num_phrases != 0) {
+        phrase_nodes[node_id].num_phrases--;
+    }
+}
+
 void SynonymIndex::synonym_reduction_internal(const std::vector<std::string>& tokens,
                                             size_t start_window_size, size_t start_index_pos,
                                             std::set<uint64_t>& processed_syn_hashes,
@@ -8,86 +43,116 @@ void SynonymIndex::synonym_reduction_internal(const std::vector<std::string>& to
 
     bool recursed = false;
 
-    for(size_t window_len = start_window_size; window_len > 0; window_len--) {
-        for(size_t start_index = start_index_pos; start_index+window_len-1 < tokens.size(); start_index++) {
-            std::vector<uint64_t> syn_hashes;
-            uint64_t syn_hash = 1;
+    std::vector<uint64_t> token_hashes(tokens.size());
+    for(size_t i = 0; i < tokens.size(); i++) {
+        token_hashes[i] = StringUtils::hash_wy(tokens[i].c_str(), tokens[i].size());
+    }
 
-            for(size_t i = start_index; i < start_index+window_len; i++) {
-                uint64_t token_hash = StringUtils::hash_wy(tokens[i].c_str(), tokens[i].size());
+    // (window_len, start_index) of the windows that spell out a phrase, in a single walk of the trie per token
+    std::vector<std::pair<size_t, size_t>> phrase_windows;
 
-                if(i == start_index) {
-                    syn_hash = token_hash;
-                } else {
-                    syn_hash = StringUtils::hash_combine(syn_hash, token_hash);
-                }
+    for(size_t start_index = 0; start_index < tokens.size(); start_index++) {
+        uint32_t node_id = 0;
 
-                syn_hashes.push_back(token_hash);
+        for(size_t i = start_index; i < tokens.size() && i - start_index < start_window_size; i++) {
+            auto child_it = phrase_nodes[node_id].children.find(tokens[i]);
+            if(child_it == phrase_nodes[node_id].children.end()) {
+                break;
             }
 
-            const auto& syn_itr = synonym_index.find(syn_hash);
+            node_id = child_it->second;
+            const size_t window_len = i - start_index + 1;
 
-            if(syn_itr != synonym_index.end() && processed_syn_hashes.count(syn_hash) == 0) {
-                // tokens in this window match a synonym: reconstruct tokens and rerun synonym mapping against matches
-                const auto& syn_ids = syn_itr->second;
+            if(phrase_nodes[node_id].num_phrases != 0 &&
+               (window_len < start_window_size || start_index >= start_index_pos)) {
+                phrase_windows.emplace_back(window_len, start_index);
+            }
+        }
+    }
 
-                for(const auto& syn_id: syn_ids) {
-                    const auto &syn_def = synonym_definitions.at(syn_id);
+    // the windows are taken up longest first, and from left to right within a length
+    std::sort(phrase_windows.begin(), phrase_windows.end(), [](const auto& a, const auto& b) {
+        return (a.first != b.first) ? (a.first > b.first) : (a.second < b.second);
+    });
 
-                    for (const auto &syn_def_tokens: syn_def.synonyms) {
-                        std::vector<std::string> new_tokens;
+    for(const auto& phrase_window: phrase_windows) {
+        const size_t window_len = phrase_window.first;
+        const size_t start_index = phrase_window.second;
 
-                        for (size_t i = 0; i < start_index; i++) {
-                            new_tokens.push_back(tokens[i]);
-                        }
+        std::vector<uint64_t> syn_hashes;
+        uint64_t syn_hash = 1;
 
-                        std::vector<uint64_t> syn_def_hashes;
-                        uint64_t syn_def_hash = 1;
+        for(size_t i = start_index; i < start_index+window_len; i++) {
+            uint64_t token_hash = token_hashes[i];
 
-                        for (size_t i = 0; i < syn_def_tokens.size(); i++) {
-                            const auto &syn_def_token = syn_def_tokens[i];
-                            new_tokens.push_back(syn_def_token);
-                            uint64_t token_hash = StringUtils::hash_wy(syn_def_token.c_str(),
-                                                                       syn_def_token.size());
+            if(i == start_index) {
+                syn_hash = token_hash;
+            } else {
+                syn_hash = StringUtils::hash_combine(syn_hash, token_hash);
+            }
 
-                            if (i == 0) {
-                                syn_def_hash = token_hash;
-                            } else {
-                                syn_def_hash = StringUtils::hash_combine(syn_def_hash, token_hash);
-                            }
+            syn_hashes.push_back(token_hash);
+        }
 
-                            syn_def_hashes.push_back(token_hash);
-                        }
+        const auto& syn_itr = synonym_index.find(syn_hash);
 
-                        if (syn_def_hash == syn_hash) {
-                            // skip over token matching itself in the group
-                            continue;
-                        }
+        if(syn_itr != synonym_index.end() && processed_syn_hashes.count(syn_hash) == 0) {
+            // tokens in this window match a synonym: reconstruct tokens and rerun synonym mapping against matches
+            const auto& syn_ids = syn_itr->second;
 
-                        for (size_t i = start_index + window_len; i < tokens.size(); i++) {
-                            new_tokens.push_back(tokens[i]);
-                        }
+            for(const auto& syn_id: syn_ids) {
+                const auto &syn_def = synonym_definitions.at(syn_id);
 
-                        processed_syn_hashes.emplace(syn_def_hash);
-                        processed_syn_hashes.emplace(syn_hash);
+                for (const auto &syn_def_tokens: syn_def.synonyms) {
+                    std::vector<std::string> new_tokens;
 
-                        for (uint64_t h: syn_def_hashes) {
-                            processed_syn_hashes.emplace(h);
-                        }
+                    for (size_t i = 0; i < start_index; i++) {
+                        new_tokens.push_back(tokens[i]);
+                    }
+
+                    std::vector<uint64_t> syn_def_hashes;
+                    uint64_t syn_def_hash = 1;
 
-                        for (uint64_t h: syn_hashes) {
-                            processed_syn_hashes.emplace(h);
+                    for (size_t i = 0; i < syn_def_tokens.size(); i++) {
+                        const auto &syn_def_token = syn_def_tokens[i];
+                        new_tokens.push_back(syn_def_token);
+                        uint64_t token_hash = StringUtils::hash_wy(syn_def_token.c_str(),
+                                                                   syn_def_token.size());
+
+                        if (i == 0) {
+                            syn_def_hash = token_hash;
+                        } else {
+                            syn_def_hash = StringUtils::hash_combine(syn_def_hash, token_hash);
                         }
 
-                        recursed = true;
-                        synonym_reduction_internal(new_tokens, window_len, start_index, processed_syn_hashes, results);
+                        syn_def_hashes.push_back(token_hash);
+                    }
+
+                    if (syn_def_hash == syn_hash) {
+                        // skip over token matching itself in the group
+                        continue;
+                    }
+
+                    for (size_t i = start_index + window_len; i < tokens.size(); i++) {
+                        new_tokens.push_back(tokens[i]);
+                    }
+
+                    processed_syn_hashes.emplace(syn_def_hash);
+                    processed_syn_hashes.emplace(syn_hash);
+
+                    for (uint64_t h: syn_def_hashes) {
+                        processed_syn_hashes.emplace(h);
+                    }
+
+                    for (uint64_t h: syn_hashes) {
+                        processed_syn_hashes.emplace(h);
                     }
+
+                    recursed = true;
+                    synonym_reduction_internal(new_tokens, window_len, start_index, processed_syn_hashes, results);
                 }
             }
         }
-
-        // reset it because for the next window we have to start from scratch
-        start_index_pos = 0;
     }
 
     if(!recursed && !processed_syn_hashes.empty()) {
@@ -120,10 +185,12 @@ Option<bool> SynonymIndex::add_synonym(const std::string & collection_name, cons
     if(!synonym.root.empty()) {
         uint64_t root_hash = synonym_t::get_hash(synonym.root);
         synonym_index[root_hash].emplace_back(synonym.id);
+        add_phrase(synonym.root);
     } else {
         for(const auto & syn_tokens : synonym.synonyms) {
             uint64_t syn_hash = synonym_t::get_hash(syn_tokens);
             synonym_index[syn_hash].emplace_back(synonym.id);
+            add_phrase(syn_tokens);
         }
     }
 
@@ -162,10 +229,12 @@ Option<bool> SynonymIndex::remove_synonym(const std::string & collection_name, c
         if(!synonym.root.empty()) {
             uint64_t root_hash = synonym_t::get_hash(synonym.root);
             synonym_index.erase(root_hash);
+            remove_phrase(synonym.root);
         } else {
             for(const auto & syn_tokens : synonym.synonyms) {
                 uint64_t syn_hash = synonym_t::get_hash(syn_tokens);
                 synonym_index.erase(syn_hash);
+                remove_phrase(syn_tokens);
             }
         }
 
@@ -14,6 +14,8 @@
 #include <mach/mach_host.h>
 #endif
 
+#include <mutex>
+#include <vector>
 #include "string_utils.h"
 #include "jemalloc.h"
 
@@ -26,6 +28,20 @@
 uint64_t SystemMetrics::non_proc_mem_last_access = 0;
 uint64_t SystemMetrics::non_proc_mem_bytes = 0;
 
+namespace {
+    std::mutex free_arenas_mutex;
+
+    // arenas created for indices that were freed since, which jemalloc cannot destroy while others are in use
+    std::vector<unsigned> free_arenas;
+
+    // pages of the allocator, in bytes
+    size_t get_page_bytes() {
+        size_t page = 4096, sz = sizeof(size_t);
+        impl_mallctl("arenas.page", &page, &sz, nullptr, 0);
+        return page;
+    }
+}
+
 void SystemMetrics::get(const std::string &data_dir_path, nlohmann::json &result) {
     // DISK METRICS
     struct statvfs st{};
@@ -53,9 +69,15 @@ void SystemMetrics::get(const std::string &data_dir_path, nlohmann::json &result
     impl_mallctl("stats.mapped", &mapped, &sz, nullptr, 0);
     impl_mallctl("stats.retained", &retained, &sz, nullptr, 0);
 
+    // pages freed by all arenas that are yet to be returned to the OS by the background threads
+    size_t dirty_pages = 0;
+    const std::string& pdirty_key = "stats.arenas." + std::to_string(MALLCTL_ARENAS_ALL) + ".pdirty";
+    impl_mallctl(pdirty_key.c_str(), &dirty_pages, &sz, nullptr, 0);
+
     result["typesense_memory_active_bytes"] = std::to_string(active);
     result["typesense_memory_allocated_bytes"] = std::to_string(allocated);
-    result["typesense_memory_resident_bytes"] = std::to_string(active);
+    result["typesense_memory_resident_bytes"] = std::to_string(resident);
+    result["typesense_memory_dirty_bytes"] = std::to_string(dirty_pages * get_page_bytes());
     result["typesense_memory_metadata_bytes"] = std::to_string(metadata);
     result["typesense_memory_mapped_bytes"] = std::to_string(mapped);
     result["typesense_memory_retained_bytes"] = std::to_string(retained);
@@ -119,6 +141,101 @@ uint64_t SystemMetrics::get_memory_active_bytes() {
     return memory_active_bytes;
 }
 
+void SystemMetrics::get_allocator_bytes(uint64_t& allocated, uint64_t& active, uint64_t& resident) {
+    size_t sz = sizeof(size_t), allocated_bytes = 0, active_bytes = 0, resident_bytes = 0;
+    uint64_t epoch = 1;
+
+    impl_mallctl("epoch", &epoch, &sz, &epoch, sz);
+    impl_mallctl("stats.allocated", &allocated_bytes, &sz, nullptr, 0);
+    impl_mallctl("stats.active", &active_bytes, &sz, nullptr, 0);
+    impl_mallctl("stats.resident", &resident_bytes, &sz, nullptr, 0);
+
+    allocated = allocated_bytes;
+    active = active_bytes;
+    resident = resident_bytes;
+}
+
+void SystemMetrics::release_free_memory() {
+    const std::string& purge_key = "arena." + std::to_string(MALLCTL_ARENAS_ALL) + ".purge";
+
+    impl_mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0);
+    impl_mallctl(purge_key.c_str(), nullptr, nullptr, nullptr, 0);
+}
+
+unsigned SystemMetrics::acquire_arena() {
+    {
+        std::unique_lock lock(free_arenas_mutex);
+        if(!free_arenas.empty()) {
+            const unsigned arena = free_arenas.back();
+            free_arenas.pop_back();
+            return arena;
+        }
+    }
+
+    unsigned arena;
+    size_t sz = sizeof(unsigned);
+
+    if(impl_mallctl("arenas.create", &arena, &sz, nullptr, 0) != 0) {
+        return NO_ARENA;
+    }
+
+    return arena;
+}
+
+void SystemMetrics::release_arena(unsigned arena) {
+    if(arena == NO_ARENA) {
+        return;
+    }
+
+    // the regions just freed by this thread are held by its cache until it is flushed
+    const std::string& purge_key = "arena." + std::to_string(arena) + ".purge";
+    impl_mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0);
+    impl_mallctl(purge_key.c_str(), nullptr, nullptr, nullptr, 0);
+
+    std::unique_lock lock(free_arenas_mutex);
+    free_arenas.push_back(arena);
+}
+
+uint64_t SystemMetrics::get_arena_active_bytes(unsigned arena) {
+    if(arena == NO_ARENA) {
+        return 0;
+    }
+
+    size_t sz = sizeof(size_t), active_pages = 0;
+    uint64_t epoch = 1;
+
+    impl_mallctl("epoch", &epoch, &sz, &epoch, sz);
+
+    const std::string& pactive_key = "stats.arenas." + std::to_string(arena) + ".pactive";
+    impl_mallctl(pactive_key.c_str(), &active_pages, &sz, nullptr, 0);
+
+    return active_pages * get_page_bytes();
+}
+
+allocator_arena_scope_t::allocator_arena_scope_t(unsigned arena): prev_arena(SystemMetrics::NO_ARENA) {
+    if(arena == SystemMetrics::NO_ARENA) {
+        return;
+    }
+
+    unsigned current_arena;
+    size_t sz = sizeof(unsigned);
+
+    if(impl_mallctl("thread.arena", &current_arena, &sz, &arena, sizeof(unsigned)) == 0 && current_arena != arena) {
+        // the cache of the thread would otherwise keep handing out regions of the arena it was bound to
+        prev_arena = current_arena;
+        impl_mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0);
+    }
+}
+
+allocator_arena_scope_t::~allocator_arena_scope_t() {
+    if(prev_arena == SystemMetrics::NO_ARENA) {
+        return;
+    }
+
+    impl_mallctl("thread.arena", nullptr, nullptr, &prev_arena, sizeof(unsigned));
+    impl_mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0);
+}
+
 uint64_t SystemMetrics::get_memory_used_bytes() {
     uint64_t memory_used_bytes = 0;
 
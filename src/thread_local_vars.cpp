@@ -5,3 +5,37 @@ thread_local int64_t write_log_index = 0;
 thread_local std::chrono::high_resolution_clock::time_point search_begin;
 thread_local int64_t search_stop_ms;
 thread_local bool search_cutoff = false;
+thread_local search_cancel_token_t* search_cancel_token = nullptr;
+thread_local int64_t search_budget_ms = 0;
+thread_local uint32_t search_degradations = 0;
+thread_local search_profile_t* search_profile = nullptr;
+thread_local size_t search_num_pruned_ids = 0;
+thread_local const trace_context_t* active_trace = nullptr;
+
+bool search_cutoff_reached() {
+    if(search_cancel_token != nullptr && search_cancel_token->is_cancelled()) {
+        return true;
+    }
+
+    if(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - search_begin).count() > search_stop_ms) {
+        if(search_cancel_token != nullptr) {
+            search_cancel_token->cancelled = true;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool search_budget_spent(double share) {
+    if(search_budget_ms <= 0) {
+        return false;
+    }
+
+    const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - search_begin).count();
+
+    return elapsed_us > share * search_budget_ms * 1000;
+}
@@ -1,7 +1,100 @@
 #include <sstream>
 #include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include "lru/lru.hpp"
 #include "tokenizer.h"
 
+// Opening an iconv descriptor and creating ICU iterators costs far more than tokenizing a typical field value, so
+// what a tokenizer releases is kept for the next tokenizers of the same thread.
+struct tokenizer_pool_t {
+    std::vector<iconv_t> cds;
+
+    // locale => released instances
+    std::unordered_map<std::string, std::vector<icu::BreakIterator*>> break_iterators;
+    std::unordered_map<std::string, std::vector<icu::Transliterator*>> transliterators;
+
+    // short values such as category names repeat a lot, so their segmented or transliterated forms are kept
+    // (keyed by locale and value)
+    LRU::Cache<std::string, std::string> normalized_texts;
+
+    tokenizer_pool_t(): normalized_texts(Tokenizer::NORMALIZED_TEXTS_CACHE_CAPACITY) {
+
+    }
+
+    ~tokenizer_pool_t() {
+        for(iconv_t cd: cds) {
+            iconv_close(cd);
+        }
+
+        for(auto& locale_bis: break_iterators) {
+            for(icu::BreakIterator* bi: locale_bis.second) {
+                delete bi;
+            }
+        }
+
+        for(auto& locale_transliterators: transliterators) {
+            for(icu::Transliterator* transliterator: locale_transliterators.second) {
+                delete transliterator;
+            }
+        }
+    }
+};
+
+static thread_local tokenizer_pool_t tokenizer_pool;
+
+template<class T>
+static T* acquire_pooled(std::unordered_map<std::string, std::vector<T*>>& pool, const std::string& locale) {
+    auto pool_it = pool.find(locale);
+    if(pool_it == pool.end() || pool_it->second.empty()) {
+        return nullptr;
+    }
+
+    T* instance = pool_it->second.back();
+    pool_it->second.pop_back();
+    return instance;
+}
+
+static std::string get_normalized_text_key(const std::string& locale, const std::string& input) {
+    return locale + '\0' + input;
+}
+
+static bool find_normalized_text(const std::string& locale, const std::string& input, std::string& output) {
+    if(input.size() > Tokenizer::NORMALIZED_TEXT_MAX_CACHED_LEN) {
+        return false;
+    }
+
+    auto hit_it = tokenizer_pool.normalized_texts.find(get_normalized_text_key(locale, input));
+    if(hit_it == tokenizer_pool.normalized_texts.end()) {
+        return false;
+    }
+
+    output = hit_it.value();
+    return true;
+}
+
+static void cache_normalized_text(const std::string& locale, const std::string& input, const std::string& output) {
+    if(input.size() <= Tokenizer::NORMALIZED_TEXT_MAX_CACHED_LEN) {
+        tokenizer_pool.normalized_texts.insert(get_normalized_text_key(locale, input), output);
+    }
+}
+
+Tokenizer::~Tokenizer() {
+    // drops any partial conversion state
+    iconv(cd, nullptr, nullptr, nullptr, nullptr);
+    tokenizer_pool.cds.push_back(cd);
+
+    free(normalized_text);
+
+    if(bi) {
+        tokenizer_pool.break_iterators[locale].push_back(bi);
+    }
+
+    if(transliterator) {
+        tokenizer_pool.transliterators[locale].push_back(transliterator);
+    }
+}
+
 Tokenizer::Tokenizer(const std::string& input, bool normalize, bool no_op, const std::string& locale,
                      const std::vector<char>& symbols_to_index,
                      const std::vector<char>& separators):
@@ -18,7 +111,12 @@ Tokenizer::Tokenizer(const std::string& input, bool normalize, bool no_op, const
     UErrorCode errcode = U_ZERO_ERROR;
     nfkd = icu::Normalizer2::getNFKDInstance(errcode);
 
-    cd = iconv_open("ASCII//TRANSLIT", "UTF-8");
+    if(tokenizer_pool.cds.empty()) {
+        cd = iconv_open("ASCII//TRANSLIT", "UTF-8");
+    } else {
+        cd = tokenizer_pool.cds.back();
+        tokenizer_pool.cds.pop_back();
+    }
 
     init(input);
 }
@@ -31,8 +129,18 @@ void Tokenizer::init(const std::string& input) {
         normalized_text = nullptr;
     }
 
-    if(locale == "zh") {
+    std::string cached_text;
+
+    if(locale == "zh" && find_normalized_text(locale, input, cached_text)) {
+        normalized_text = strdup(cached_text.c_str());
+        text = normalized_text;
+    }
+
+    else if(locale == "zh") {
         UErrorCode translit_status = U_ZERO_ERROR;
+        if(!transliterator) {
+            transliterator = acquire_pooled(tokenizer_pool.transliterators, locale);
+        }
         if(!transliterator) {
             transliterator = icu::Transliterator::createInstance("Traditional-Simplified",
                                                                  UTRANS_FORWARD, translit_status);
@@ -46,6 +154,7 @@ void Tokenizer::init(const std::string& input) {
             transliterator->transliterate(unicode_input);
             std::string output;
             unicode_input.toUTF8String(output);
+            cache_normalized_text(locale, input, output);
             normalized_text = (char *)malloc(output.size()+1);
             strcpy(normalized_text, output.c_str());
             text = normalized_text;
@@ -53,11 +162,22 @@ void Tokenizer::init(const std::string& input) {
     }
 
     else if(locale == "ja") {
-        normalized_text = JapaneseLocalizer::get_instance().normalize(input);
+        if(find_normalized_text(locale, input, cached_text)) {
+            normalized_text = strdup(cached_text.c_str());
+        } else {
+            normalized_text = JapaneseLocalizer::get_instance().normalize(input);
+            if(normalized_text) {
+                cache_normalized_text(locale, input, normalized_text);
+            }
+        }
+
         text = normalized_text;
     } else if(is_cyrillic(locale)) {
         // init transliterator but will only transliterate during tokenization
         UErrorCode translit_status = U_ZERO_ERROR;
+        if(!transliterator) {
+            transliterator = acquire_pooled(tokenizer_pool.transliterators, locale);
+        }
         if(!transliterator) {
             transliterator = icu::Transliterator::createInstance("Any-Latin; Latin-ASCII",
                                                                  UTRANS_FORWARD, translit_status);
@@ -70,6 +190,9 @@ void Tokenizer::init(const std::string& input) {
     if(!locale.empty() && locale != "en") {
         UErrorCode status = U_ZERO_ERROR;
         const icu::Locale& icu_locale = icu::Locale(locale.c_str());
+        if(!bi) {
+            bi = acquire_pooled(tokenizer_pool.break_iterators, locale);
+        }
         if(!bi) {
             bi = icu::BreakIterator::createWordInstance(icu_locale, status);
         }
@@ -179,7 +302,8 @@ bool Tokenizer::next(std::string &token, size_t& token_index, size_t& start_inde
                     continue;
                 }
 
-                token = out;
+                // the buffer of the previous token is reused for the next one
+                token.swap(out);
                 out.clear();
 
                 token_index = token_counter++;
@@ -191,8 +315,20 @@ bool Tokenizer::next(std::string &token, size_t& token_index, size_t& start_inde
                     start_index = i;
                 }
 
-                out += normalize ? char(std::tolower(text[i])) : text[i];
-                i++;
+                // the whole run of ascii chars to be indexed is appended at once
+                const size_t run_end = get_index_run_end(i);
+                const size_t out_size = out.size();
+                out.resize(out_size + (run_end - i));
+
+                if(normalize) {
+                    for(size_t j = out_size; i < run_end; i++, j++) {
+                        out[j] = ascii_tolower(text[i]);
+                    }
+                } else {
+                    out.replace(out_size, run_end - i, text.data() + i, run_end - i);
+                    i = run_end;
+                }
+
                 continue;
             }
         }
@@ -250,7 +386,7 @@ bool Tokenizer::next(std::string &token, size_t& token_index, size_t& start_inde
         }
     }
 
-    token = out;
+    token.swap(out);
     out.clear();
     end_index = i - 1;
 
@@ -267,7 +403,7 @@ void Tokenizer::tokenize(std::vector<std::string> &tokens) {
     size_t token_index;
 
     while(next(token, token_index)) {
-        tokens.push_back(token);
+        tokens.push_back(std::move(token));
     }
 }
 
@@ -0,0 +1,270 @@
+#include "tracer.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <json.hpp>
+
+namespace {
+    // spans that ended on this thread and wait for its outermost span to end
+    struct thread_spans_t {
+        std::vector<span_record_t> buffer;
+        size_t num_spans = 0;
+    };
+
+    thread_local thread_spans_t thread_spans;
+
+    constexpr size_t THREAD_BUFFER_FLUSH_SIZE = 64;
+
+    bool parse_hex(const std::string& str, size_t begin, size_t len, uint64_t& value) {
+        value = 0;
+
+        for(size_t i = begin; i < begin + len; i++) {
+            const char c = str[i];
+            uint64_t digit;
+
+            if(c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if(c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else {
+                return false;
+            }
+
+            value = (value << 4) | digit;
+        }
+
+        return true;
+    }
+
+    std::string to_hex(uint64_t value) {
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) value);
+        return hex;
+    }
+}
+
+bool trace_context_t::parse_traceparent(const std::string& traceparent, trace_context_t& context) {
+    // versions after 00 may append fields, behind another dash
+    const size_t len = 55;
+    if(traceparent.size() < len || traceparent[2] != '-' || traceparent[35] != '-' || traceparent[52] != '-') {
+        return false;
+    }
+
+    uint64_t version, flags;
+    if(!parse_hex(traceparent, 0, 2, version) || version == 0xff ||
+       (version == 0 && traceparent.size() != len) || (traceparent.size() > len && traceparent[len] != '-')) {
+        return false;
+    }
+
+    trace_context_t parsed;
+
+    if(!parse_hex(traceparent, 3, 16, parsed.trace_id_high) || !parse_hex(traceparent, 19, 16, parsed.trace_id_low) ||
+       !parse_hex(traceparent, 36, 16, parsed.span_id) || !parse_hex(traceparent, 53, 2, flags) ||
+       !parsed.is_valid()) {
+        return false;
+    }
+
+    parsed.sampled = (flags & 0x01) != 0;
+    context = parsed;
+    return true;
+}
+
+std::string trace_context_t::to_traceparent() const {
+    return "00-" + to_hex(trace_id_high) + to_hex(trace_id_low) + "-" + to_hex(span_id) + (sampled ? "-01" : "-00");
+}
+
+void Tracer::init(float sample_ratio, const std::function<bool(const std::string&)>& export_fn) {
+    this->sample_ratio = sample_ratio;
+    this->export_fn = export_fn;
+
+    quit = false;
+    exporter = std::thread(&Tracer::run_exporter, this);
+    enabled = true;
+}
+
+void Tracer::dispose() {
+    if(!exporter.joinable()) {
+        return ;
+    }
+
+    enabled = false;
+    quit = true;
+    exporter.join();
+
+    export_spans();
+}
+
+trace_context_t Tracer::start_trace(const std::string& traceparent) const {
+    trace_context_t context;
+
+    if(!enabled) {
+        return context;
+    }
+
+    trace_context_t parent;
+
+    if(!traceparent.empty() && trace_context_t::parse_traceparent(traceparent, parent)) {
+        context = parent;
+        context.parent_span_id = parent.span_id;
+    } else {
+        context.trace_id_high = new_id();
+        context.trace_id_low = new_id();
+
+        thread_local std::mt19937 gen(std::random_device{}());
+        std::uniform_real_distribution<float> sample_dist(0, 1);
+        const float ratio = sample_ratio;
+        context.sampled = (ratio > 0 && sample_dist(gen) < ratio);
+    }
+
+    context.span_id = new_id();
+    return context;
+}
+
+void Tracer::record(span_record_t&& span) {
+    if(!spans.push(std::move(span))) {
+        num_dropped++;
+    }
+}
+
+size_t Tracer::drain(std::vector<span_record_t>& records, size_t max_spans) {
+    size_t num_drained = 0;
+    span_record_t span;
+
+    while(num_drained < max_spans && spans.pop(span)) {
+        records.push_back(std::move(span));
+        num_drained++;
+    }
+
+    return num_drained;
+}
+
+void Tracer::export_spans() {
+    std::vector<span_record_t> records;
+
+    while(drain(records, MAX_EXPORT_BATCH) != 0) {
+        if(export_fn && export_fn(to_otlp_json(records))) {
+            num_exported += records.size();
+        } else {
+            num_export_failures++;
+        }
+
+        records.clear();
+    }
+}
+
+void Tracer::run_exporter() {
+    while(!quit) {
+        export_spans();
+        std::this_thread::sleep_for(std::chrono::milliseconds(EXPORT_INTERVAL_MS));
+    }
+}
+
+std::string Tracer::to_otlp_json(const std::vector<span_record_t>& records) {
+    // span kinds of the OTLP protocol
+    const int SPAN_KIND_INTERNAL = 1;
+    const int SPAN_KIND_SERVER = 2;
+
+    nlohmann::json spans_json = nlohmann::json::array();
+
+    for(const auto& record: records) {
+        nlohmann::json span_json;
+        span_json["traceId"] = to_hex(record.trace_id_high) + to_hex(record.trace_id_low);
+        span_json["spanId"] = to_hex(record.span_id);
+
+        if(record.parent_span_id != 0) {
+            span_json["parentSpanId"] = to_hex(record.parent_span_id);
+        }
+
+        span_json["name"] = record.name;
+        span_json["kind"] = record.is_server ? SPAN_KIND_SERVER : SPAN_KIND_INTERNAL;
+        span_json["startTimeUnixNano"] = std::to_string(record.start_ns);
+        span_json["endTimeUnixNano"] = std::to_string(record.end_ns);
+
+        nlohmann::json attributes_json = nlohmann::json::array();
+        for(const auto& attribute: record.attributes) {
+            attributes_json.push_back({{"key", attribute.first}, {"value", {{"stringValue", attribute.second}}}});
+        }
+
+        span_json["attributes"] = attributes_json;
+        spans_json.push_back(span_json);
+    }
+
+    nlohmann::json resource_json;
+    resource_json["attributes"] = nlohmann::json::array({
+        {{"key", "service.name"}, {"value", {{"stringValue", "typesense"}}}}
+    });
+
+    nlohmann::json scope_spans_json;
+    scope_spans_json["scope"]["name"] = "typesense";
+    scope_spans_json["spans"] = spans_json;
+
+    nlohmann::json resource_spans_json;
+    resource_spans_json["resource"] = resource_json;
+    resource_spans_json["scopeSpans"] = nlohmann::json::array({scope_spans_json});
+
+    nlohmann::json otlp_json;
+    otlp_json["resourceSpans"] = nlohmann::json::array({resource_spans_json});
+
+    return otlp_json.dump(-1, ' ', false, nlohmann::detail::error_handler_t::ignore);
+}
+
+uint64_t Tracer::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Tracer::new_id() {
+    thread_local std::mt19937_64 gen(std::random_device{}());
+    uint64_t id;
+
+    do {
+        id = gen();
+    } while(id == 0);
+
+    return id;
+}
+
+void trace_span_t::start(const char* name, const trace_context_t& parent) {
+    if(prev_active_trace == nullptr) {
+        // outermost span of this thread
+        thread_spans.num_spans = 0;
+    }
+
+    if(++thread_spans.num_spans > Tracer::MAX_THREAD_SPANS) {
+        return ;
+    }
+
+    record = std::make_unique<span_record_t>();
+    record->trace_id_high = parent.trace_id_high;
+    record->trace_id_low = parent.trace_id_low;
+    record->span_id = Tracer::new_id();
+    record->parent_span_id = parent.span_id;
+    record->name = name;
+    record->start_ns = Tracer::now_ns();
+
+    context.trace_id_high = parent.trace_id_high;
+    context.trace_id_low = parent.trace_id_low;
+    context.span_id = record->span_id;
+    context.parent_span_id = parent.span_id;
+    context.sampled = true;
+
+    active_trace = &context;
+}
+
+void trace_span_t::end() {
+    record->end_ns = Tracer::now_ns();
+    active_trace = prev_active_trace;
+
+    thread_spans.buffer.push_back(std::move(*record));
+    record.reset();
+
+    if(active_trace == nullptr || thread_spans.buffer.size() >= THREAD_BUFFER_FLUSH_SIZE) {
+        Tracer& tracer = Tracer::get_instance();
+
+        for(auto& span: thread_spans.buffer) {
+            tracer.record(std::move(span));
+        }
+
+        thread_spans.buffer.clear();
+    }
+}
@@ -18,7 +18,13 @@
 #include "typesense_server_utils.h"
 #include "file_utils.h"
 #include "threadpool.h"
+#include "compact_list_arena.h"
+#include "response_cache.h"
 #include "jemalloc.h"
+#include "slow_query_log.h"
+#include "hot_query_log.h"
+#include "numa_topology.h"
+#include "tracer.h"
 
 #include "stackprinter.h"
 
@@ -86,22 +92,54 @@ void init_cmdline_options(cmdline::parser & options, int argc, char **argv) {
     options.add<float>("max-memory-ratio", '\0', "Maximum fraction of system memory to be used.", false, 1.0f);
     options.add<int>("snapshot-interval-seconds", '\0', "Frequency of replication log snapshots.", false, 3600);
     options.add<int>("snapshot-max-byte-count-per-rpc", '\0', "Maximum snapshot file size in bytes transferred for each RPC.", false, 4194304);
+    options.add<size_t>("write-batch-delay-ms", '\0', "On the leader, small writes made within this window go into one log entry, 0 to not batch.", false, 0);
+    options.add<size_t>("write-batch-max-bytes", '\0', "Maximum bytes of writes batched into one log entry.", false, 1024 * 1024);
+    options.add<size_t>("max-pending-searches", '\0', "Searches queued or running beyond which new ones are rejected, 0 for no limit.", false, 0);
+    options.add<size_t>("max-search-queue-ms", '\0', "Searches that waited longer than this in the queue are rejected, 0 for no limit.", false, 0);
+    options.add<size_t>("search-threads", '\0', "Threads of a pool of their own that searches run on, 0 to run them on the server thread pool.", false, 0);
+    options.add<bool>("pin-search-threads", '\0', "Pin every search thread to a CPU of its own.", false, false);
+    options.add<bool>("numa-pinning", '\0', "Pin the worker threads to the CPUs of the NUMA nodes in turn, and run the searches and writes of each collection on the workers of one node, so that its memory stays local to them.", false, false);
+    options.add<size_t>("response-cache-max-bytes", '\0', "Maximum bytes of search responses held by the cache.", false, 64 * 1024 * 1024);
+    options.add<size_t>("compression-min-bytes", '\0', "Responses smaller than this are sent uncompressed.", false, 256);
+    options.add<int>("gzip-level", '\0', "Level of gzip compression of responses, from 1 to 9, 0 to disable.", false, 1);
+    options.add<int>("brotli-level", '\0', "Level of brotli compression of responses, from 1 to 11, 0 to disable.", false, 0);
+    options.add<size_t>("http2-stream-window-size", '\0', "Flow-control window of an HTTP/2 stream, in bytes.", false, 196605);
+    options.add<size_t>("snapshot-max-mb-per-sec", '\0', "Caps the MB per second of snapshot files sent to other nodes, 0 for no cap.", false, 0);
     options.add<size_t>("healthy-read-lag", '\0', "Reads are rejected if the updates lag behind this threshold.", false, 1000);
     options.add<size_t>("healthy-write-lag", '\0', "Writes are rejected if the updates lag behind this threshold.", false, 500);
     options.add<int>("log-slow-requests-time-ms", '\0', "When >= 0, requests that take longer than this duration are logged.", false, -1);
+    options.add<int>("log-slow-searches-time-ms", '\0', "When >= 0, searches that take at least this duration are written to the slow query log in the log directory, along with their stage timings.", false, -1);
+    options.add<float>("slow-searches-sample-ratio", '\0', "Fraction of the other searches that are written to the slow query log as a sample.", false, 0.0f);
+    options.add<std::string>("trace-export-url", '\0', "OTLP/HTTP endpoint (e.g. http://localhost:4318/v1/traces) that the spans of traced requests are exported to. Tracing is disabled when empty.", false);
+    options.add<float>("trace-sample-ratio", '\0', "Fraction of the requests without a sampled `traceparent` header that are traced.", false, 0.0f);
 
     options.add<uint32_t>("num-collections-parallel-load", '\0', "Number of collections that are loaded in parallel during start up.", false, 4);
     options.add<uint32_t>("num-documents-parallel-load", '\0', "Number of documents per collection that are indexed in parallel during start up.", false, 1000);
 
     options.add<uint32_t>("thread-pool-size", '\0', "Number of threads used for handling concurrent requests.", false, 4);
+    options.add<uint32_t>("indexing-concurrency", '\0', "Number of threads that a batch of writes is indexed on.", false, 4);
+    options.add<uint32_t>("collection-hibernation-idle-s", '\0', "Collections that are not used for this many seconds have their in-memory index freed until they are used again. Default: 0 (never).", false, 0);
+    options.add<uint32_t>("posting-compaction-rate", '\0', "Number of posting lists left fragmented by deletes and updates that are repacked in the background every second. Default: 1024 (0 disables it).", false, 1024);
+    options.add<bool>("static-rank-seq-ids", '\0', "Renumber the documents of each collection on start up in the descending order of its default sorting field, so that the best ranked ones are met first.", false, false);
+    options.add<bool>("shared-vocabulary", '\0', "Expand the typos and prefixes of query tokens once over a dictionary of the tokens of all the string fields of a collection, instead of once for every searched field.", false, false);
+    options.add<uint32_t>("hot-queries", '\0', "Number of the most frequent searches that are kept track of and replayed in the background on start up, to warm the caches before the node reports itself healthy. Default: 100 (0 disables it).", false, 100);
 
     options.add<std::string>("log-dir", '\0', "Path to the log directory.", false, "");
+    options.add<std::string>("index-mmap-dir", '\0', "Directory of a file that the small in-memory index structures are mapped to, so that cold ones can be paged out.", false, "");
 
     options.add<std::string>("config", '\0', "Path to the configuration file.", false, "");
 
     options.add<bool>("enable-access-logging", '\0', "Enable access logging.", false, false);
     options.add<int>("disk-used-max-percentage", '\0', "Reject writes when used disk space exceeds this percentage. Default: 100 (never reject).", false, 100);
 
+    options.add<uint32_t>("db-block-cache-size-mb", '\0', "Size of the on-disk store's block cache. Default: 0 (RocksDB's default cache of 8 MB per table).", false, 0);
+    options.add<bool>("db-share-block-cache", '\0', "Share the block cache between the document store and the meta store.", false, false);
+    options.add<std::string>("db-compression", '\0', "Compression of the on-disk store: none, snappy, zlib, lz4, lz4hc or zstd, or a comma separated list of one per level.", false, "snappy");
+    options.add<std::string>("db-bottommost-compression", '\0', "Compression of the last level of the on-disk store. Default: same as the other levels.", false, "");
+    options.add<uint32_t>("db-bloom-bits-per-key", '\0', "Bits per key of the bloom filters of the on-disk store. Default: 0 (no filters).", false, 0);
+    options.add<uint32_t>("db-compaction-rate-limit-mb", '\0', "Megabytes per second that the on-disk store's flushes and compactions may write. Default: 0 (no limit).", false, 0);
+    options.add<bool>("db-compaction-direct-io", '\0', "Bypass the page cache for the on-disk store's flushes and compactions.", false, false);
+
     // DEPRECATED
     options.add<std::string>("listen-address", 'h', "[DEPRECATED: use `api-address`] Address to which Typesense API service binds.", false, "0.0.0.0");
     options.add<uint32_t>("listen-port", 'p', "[DEPRECATED: use `api-port`] Port on which Typesense API service listens.", false, 8108);
@@ -322,6 +360,20 @@ int start_raft_server(ReplicationState& replication_state, const std::string& st
             }
         }
 
+        if(raft_counter % ReplicationState::DOC_EXPIRY_INTERVAL_S == 0) {
+            replication_state.expire_documents();
+        }
+
+        if(raft_counter % 60 == 0) {
+            CollectionManager::get_instance().hibernate_idle_collections(static_cast<uint64_t>(std::time(nullptr)));
+        }
+
+        CollectionManager::get_instance().compact_postings();
+
+        if(raft_counter % HotQueryLog::SAVE_INTERVAL_S == 0) {
+            HotQueryLog::get_instance().save();
+        }
+
         if(raft_counter % 3 == 0) {
             // update node catch up status periodically, take care of logging too verbosely
             bool log_msg = (raft_counter % 9 == 0);
@@ -375,6 +427,30 @@ int run_server(const Config & config, const std::string & version, void (*master
         return 1;
     }
 
+    if(!config.get_index_mmap_dir().empty()) {
+        if(!CompactListArena::get_instance().map_slabs(config.get_index_mmap_dir())) {
+            LOG(ERROR) << "Typesense failed to start. " << "Could not create a mapped file in the index mmap directory "
+                       << config.get_index_mmap_dir();
+            return 1;
+        }
+
+        LOG(INFO) << "Mapping small index structures to a file in " << config.get_index_mmap_dir();
+    }
+
+    if(!config.get_slow_searches_log_path().empty()) {
+        if(!SlowQueryLog::get_instance().init(config.get_slow_searches_log_path(),
+                                              config.get_log_slow_searches_time_ms(),
+                                              config.get_slow_searches_sample_ratio())) {
+            LOG(ERROR) << "Typesense failed to start. Could not open the slow searches log at "
+                       << config.get_slow_searches_log_path();
+            return 1;
+        }
+    } else if(config.get_log_slow_searches_time_ms() >= 0 || config.get_slow_searches_sample_ratio() > 0) {
+        LOG(WARNING) << "The slow searches log needs a --log-dir, so slow searches will not be logged.";
+    }
+
+    HotQueryLog::get_instance().init(config.get_data_dir() + "/hot_queries.jsonl", config.get_num_hot_queries());
+
     if(!config.get_master().empty()) {
         LOG(ERROR) << "The --master option has been deprecated. Please use clustering for high availability. "
                    << "Look for the --nodes configuration in the documentation.";
@@ -405,16 +481,93 @@ int run_server(const Config & config, const std::string & version, void (*master
     ThreadPool app_thread_pool(num_threads);
     ThreadPool server_thread_pool(num_threads);
 
+    // searches can get a pool of their own, so that long searches cannot hold up the other requests
+    std::unique_ptr<ThreadPool> search_thread_pool;
+
+    if(config.get_search_threads() != 0) {
+        LOG(INFO) << "Search thread pool size: " << config.get_search_threads();
+        search_thread_pool.reset(new ThreadPool(config.get_search_threads()));
+
+        if(config.get_pin_search_threads() && !search_thread_pool->pin_workers(0, proc_count)) {
+            LOG(WARNING) << "Could not pin the search threads to CPUs.";
+        }
+    }
+
+    if(config.get_numa_pinning()) {
+        // search threads already pinned to CPUs of their own are left as they are
+        const numa_topology_t& numa_topology = numa_topology_t::detect();
+        bool pinned = app_thread_pool.pin_workers_to_nodes(numa_topology.node_cpus);
+
+        if(search_thread_pool && !config.get_pin_search_threads()) {
+            pinned = search_thread_pool->pin_workers_to_nodes(numa_topology.node_cpus) && pinned;
+        }
+
+        if(pinned) {
+            LOG(INFO) << "Pinned the worker threads to " << numa_topology.num_nodes() << " NUMA node(s).";
+        } else {
+            LOG(WARNING) << "Could not pin the worker threads to NUMA nodes.";
+        }
+    }
+
+    store_options_t store_options;
+
+    Option<bool> compression_op = store_options.set_compression(config.get_db_compression());
+    if(!compression_op.ok()) {
+        LOG(ERROR) << "Typesense failed to start. Invalid db-compression: " << compression_op.error();
+        return 1;
+    }
+
+    if(!config.get_db_bottommost_compression().empty() &&
+       !store_options_t::parse_compression(config.get_db_bottommost_compression(),
+                                           store_options.bottommost_compression)) {
+        LOG(ERROR) << "Typesense failed to start. Invalid db-bottommost-compression: "
+                   << config.get_db_bottommost_compression();
+        return 1;
+    }
+
+    if(config.get_db_block_cache_size_mb() != 0) {
+        store_options.block_cache = rocksdb::NewLRUCache(size_t(config.get_db_block_cache_size_mb()) * 1024 * 1024);
+    }
+
+    if(config.get_db_compaction_rate_limit_mb() != 0) {
+        store_options.rate_limiter.reset(rocksdb::NewGenericRateLimiter(
+            int64_t(config.get_db_compaction_rate_limit_mb()) * 1024 * 1024));
+    }
+
+    store_options.bloom_bits_per_key = config.get_db_bloom_bits_per_key();
+    store_options.use_direct_io_for_compaction = config.get_db_compaction_direct_io();
+
+    // the meta store keeps RocksDB's defaults, but for the cache and the rate limiter it may share
+    store_options_t meta_store_options;
+    meta_store_options.rate_limiter = store_options.rate_limiter;
+    if(config.get_db_share_block_cache()) {
+        meta_store_options.block_cache = store_options.block_cache;
+    }
+
     // primary DB used for storing the documents: we will not use WAL since Raft provides that
-    Store store(db_dir);
+    Store store(db_dir, 24*60*60, 1024, true, store_options);
 
     // meta DB for storing house keeping things
-    Store meta_store(meta_dir, 24*60*60, 1024, false);
+    Store meta_store(meta_dir, 24*60*60, 1024, false, meta_store_options);
+
+    ResponseCache::get_instance().set_max_bytes(config.get_response_cache_max_bytes());
 
     curl_global_init(CURL_GLOBAL_SSL);
     HttpClient & httpClient = HttpClient::get_instance();
     httpClient.init(config.get_api_key());
 
+    if(!config.get_trace_export_url().empty()) {
+        const std::string trace_export_url = config.get_trace_export_url();
+        Tracer::get_instance().init(config.get_trace_sample_ratio(), [trace_export_url](const std::string& body) {
+            std::string response;
+            long status_code = HttpClient::post_external_response(trace_export_url, body, "application/json",
+                                                                  response);
+            return status_code >= 200 && status_code < 300;
+        });
+
+        LOG(INFO) << "Exporting the spans of traced requests to " << trace_export_url;
+    }
+
     server = new HttpServer(
         version,
         config.get_api_address(),
@@ -424,10 +577,15 @@ int run_server(const Config & config, const std::string & version, void (*master
         config.get_ssl_refresh_interval_seconds() * 1000,
         config.get_enable_cors(),
         config.get_cors_domains(),
-        &server_thread_pool
+        &server_thread_pool,
+        config.get_compression_min_bytes(),
+        config.get_gzip_level(),
+        config.get_brotli_level(),
+        config.get_http2_stream_window_size()
     );
 
     server->set_auth_handler(handle_authentication);
+    server->set_search_thread_pool(search_thread_pool.get());
 
     server->on(HttpServer::STREAM_RESPONSE_MESSAGE, HttpServer::on_stream_response_message);
     server->on(HttpServer::REQUEST_PROCEED_MESSAGE, HttpServer::on_request_proceed_message);
@@ -441,6 +599,21 @@ int run_server(const Config & config, const std::string & version, void (*master
     collectionManager.init(&store, &app_thread_pool, config.get_max_memory_ratio(),
                            config.get_api_key(), quit_raft_service, batch_indexer);
 
+    collectionManager.set_static_rank_seq_ids(config.get_static_rank_seq_ids());
+    collectionManager.set_posting_compaction_rate(config.get_posting_compaction_rate());
+
+    if(config.get_collection_hibernation_idle_s() != 0) {
+        const std::string hibernation_dir = config.get_data_dir() + "/hibernation";
+        Option<bool> hibernation_op = collectionManager.set_hibernation(config.get_collection_hibernation_idle_s(),
+                                                                        hibernation_dir);
+        if(hibernation_op.ok()) {
+            LOG(INFO) << "Collections that are idle for " << config.get_collection_hibernation_idle_s()
+                      << "s are hibernated.";
+        } else {
+            LOG(ERROR) << "Collections will not be hibernated: " << hibernation_op.error();
+        }
+    }
+
     // first we start the peering service
 
     ReplicationState replication_state(server, batch_indexer, &store,
@@ -451,7 +624,7 @@ int run_server(const Config & config, const std::string & version, void (*master
                                        config.get_num_documents_parallel_load());
 
     std::thread raft_thread([&replication_state, &config, &state_dir,
-                             &app_thread_pool, &server_thread_pool, batch_indexer]() {
+                             &app_thread_pool, &server_thread_pool, &search_thread_pool, batch_indexer]() {
 
         std::thread batch_indexing_thread([batch_indexer]() {
             batch_indexer->run();
@@ -476,6 +649,11 @@ int run_server(const Config & config, const std::string & version, void (*master
 
         server_thread_pool.shutdown();
 
+        if(search_thread_pool) {
+            LOG(INFO) << "Shutting down search_thread_pool";
+            search_thread_pool->shutdown();
+        }
+
         LOG(INFO) << "Shutting down app_thread_pool.";
 
         app_thread_pool.shutdown();
@@ -498,6 +676,8 @@ int run_server(const Config & config, const std::string & version, void (*master
 
     delete batch_indexer;
 
+    Tracer::get_instance().dispose();
+
     LOG(INFO) << "CURL clean up";
 
     curl_global_cleanup();
@@ -510,6 +690,9 @@ int run_server(const Config & config, const std::string & version, void (*master
 
     CollectionManager::get_instance().dispose();
 
+    SlowQueryLog::get_instance().dispose();
+    HotQueryLog::get_instance().save();
+
     LOG(INFO) << "Bye.";
 
     return ret_code;
@@ -0,0 +1,535 @@
+#include "vector_index.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_set>
+#include "memory_usage.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <sse2neon.h>
+#endif
+
+float vector_index_t::dot_product_scalar(const float* a, const float* b, size_t n) {
+    float sum = 0;
+    for(size_t i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+float vector_index_t::dot_product_int8_scalar(const float* a, const int8_t* b, size_t n) {
+    float sum = 0;
+    for(size_t i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2,fma")))
+static float horizontal_sum_avx2(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_product_avx2(const float* a, const float* b, size_t n) {
+    // two accumulators, so that an FMA need not wait on the one before it
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+
+    for(; i + 8 <= n; i += 8) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    }
+
+    float sum = horizontal_sum_avx2(_mm256_add_ps(sum0, sum1));
+    return sum + vector_index_t::dot_product_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_product_int8_avx2(const float* a, const int8_t* b, size_t n) {
+    __m256 sum0 = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        const __m128i codes = _mm_loadl_epi64((const __m128i*) (b + i));
+        const __m256 b_v = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(codes));
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), b_v, sum0);
+    }
+
+    float sum = horizontal_sum_avx2(sum0);
+    return sum + vector_index_t::dot_product_int8_scalar(a + i, b + i, n - i);
+}
+
+#endif
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.1")))
+#endif
+static float dot_product_sse(const float* a, const float* b, size_t n) {
+    __m128 sum_v = _mm_setzero_ps();
+    size_t i = 0;
+
+    for(; i + 4 <= n; i += 4) {
+        sum_v = _mm_add_ps(sum_v, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum_v);
+
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return sum + vector_index_t::dot_product_scalar(a + i, b + i, n - i);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.1")))
+#endif
+static float dot_product_int8_sse(const float* a, const int8_t* b, size_t n) {
+    __m128 sum_v = _mm_setzero_ps();
+    size_t i = 0;
+
+    for(; i + 4 <= n; i += 4) {
+        int32_t packed_codes;
+        memcpy(&packed_codes, b + i, sizeof(packed_codes));
+        const __m128 b_v = _mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed_codes)));
+        sum_v = _mm_add_ps(sum_v, _mm_mul_ps(_mm_loadu_ps(a + i), b_v));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum_v);
+
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return sum + vector_index_t::dot_product_int8_scalar(a + i, b + i, n - i);
+}
+
+#endif
+
+typedef float (*dot_product_fn_t)(const float*, const float*, size_t);
+typedef float (*dot_product_int8_fn_t)(const float*, const int8_t*, size_t);
+
+static dot_product_fn_t resolve_dot_product() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return dot_product_avx2;
+    }
+
+    if(__builtin_cpu_supports("sse4.1")) {
+        return dot_product_sse;
+    }
+
+    return vector_index_t::dot_product_scalar;
+#elif defined(__aarch64__)
+    return dot_product_sse;
+#else
+    return vector_index_t::dot_product_scalar;
+#endif
+}
+
+static dot_product_int8_fn_t resolve_dot_product_int8() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return dot_product_int8_avx2;
+    }
+
+    if(__builtin_cpu_supports("sse4.1")) {
+        return dot_product_int8_sse;
+    }
+
+    return vector_index_t::dot_product_int8_scalar;
+#elif defined(__aarch64__)
+    return dot_product_int8_sse;
+#else
+    return vector_index_t::dot_product_int8_scalar;
+#endif
+}
+
+float vector_index_t::dot_product(const float* a, const float* b, size_t n) {
+    static const dot_product_fn_t dot_product_fn = resolve_dot_product();
+    return dot_product_fn(a, b, n);
+}
+
+float vector_index_t::dot_product_int8(const float* a, const int8_t* b, size_t n) {
+    static const dot_product_int8_fn_t dot_product_int8_fn = resolve_dot_product_int8();
+    return dot_product_int8_fn(a, b, n);
+}
+
+const char* vector_index_t::get_distance_type_name(vector_distance_type_t distance_type) {
+    return (distance_type == vector_distance_type_t::ip) ? "ip" : "cosine";
+}
+
+bool vector_index_t::parse_distance_type(const std::string& name, vector_distance_type_t& distance_type) {
+    if(name == "cosine") {
+        distance_type = vector_distance_type_t::cosine;
+    } else if(name == "ip") {
+        distance_type = vector_distance_type_t::ip;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+vector_index_t::vector_index_t(size_t num_dim, vector_distance_type_t distance_type, bool quantize):
+        num_dim(num_dim), distance_type(distance_type), quantize(quantize), level_gen(100) {
+
+}
+
+size_t vector_index_t::size() const {
+    return seq_id_nodes.size();
+}
+
+size_t vector_index_t::get_num_dim() const {
+    return num_dim;
+}
+
+size_t vector_index_t::memory_bytes() const {
+    size_t bytes = sizeof(vector_index_t) + memory_usage::vector_bytes(nodes) + memory_usage::vector_bytes(values) +
+                   memory_usage::vector_bytes(codes) + memory_usage::vector_bytes(scales) +
+                   memory_usage::unordered_map_bytes(seq_id_nodes);
+
+    for(const auto& node: nodes) {
+        bytes += memory_usage::vector_bytes(node.links);
+        for(const auto& level_links: node.links) {
+            bytes += memory_usage::vector_bytes(level_links);
+        }
+    }
+
+    return bytes;
+}
+
+void vector_index_t::prepare(const float* raw_values, std::vector<float>& out) const {
+    out.assign(raw_values, raw_values + num_dim);
+
+    if(distance_type != vector_distance_type_t::cosine) {
+        return ;
+    }
+
+    const float norm = std::sqrt(dot_product(out.data(), out.data(), num_dim));
+    if(norm == 0) {
+        return ;
+    }
+
+    for(float& value: out) {
+        value /= norm;
+    }
+}
+
+float vector_index_t::node_distance(const float* query, uint32_t node) const {
+    if(quantize) {
+        return 1 - scales[node] * dot_product_int8(query, codes.data() + size_t(node) * num_dim, num_dim);
+    }
+
+    return 1 - dot_product(query, values.data() + size_t(node) * num_dim, num_dim);
+}
+
+void vector_index_t::get_values(uint32_t node, float* out) const {
+    if(quantize) {
+        const int8_t* node_codes = codes.data() + size_t(node) * num_dim;
+        for(size_t i = 0; i < num_dim; i++) {
+            out[i] = node_codes[i] * scales[node];
+        }
+    } else {
+        std::copy_n(values.data() + size_t(node) * num_dim, num_dim, out);
+    }
+}
+
+uint32_t vector_index_t::descend(const float* query, int to_level) const {
+    uint32_t node = entry_node;
+    float node_dist = node_distance(query, node);
+
+    for(int level = max_level; level > to_level; level--) {
+        bool moved = true;
+
+        while(moved) {
+            moved = false;
+
+            for(uint32_t link: nodes[node].links[level]) {
+                const float link_dist = node_distance(query, link);
+                if(link_dist < node_dist) {
+                    node = link;
+                    node_dist = link_dist;
+                    moved = true;
+                }
+            }
+        }
+    }
+
+    return node;
+}
+
+void vector_index_t::search_level(const float* query, uint32_t entry, size_t ef, int level, bool is_lookup,
+                                  const std::function<bool(uint32_t)>* is_allowed,
+                                  std::vector<dist_node_t>& found) const {
+    auto is_kept = [&](uint32_t node) {
+        return !is_lookup || (!nodes[node].deleted && (is_allowed == nullptr || (*is_allowed)(nodes[node].seq_id)));
+    };
+
+    // closest candidate on top, and farthest of the nodes kept on top
+    std::priority_queue<dist_node_t, std::vector<dist_node_t>, std::greater<dist_node_t>> candidates;
+    std::priority_queue<dist_node_t> kept;
+
+    std::unordered_set<uint32_t> visited;
+    visited.reserve(ef * M);
+    visited.insert(entry);
+
+    const float entry_dist = node_distance(query, entry);
+    candidates.emplace(entry_dist, entry);
+
+    if(is_kept(entry)) {
+        kept.emplace(entry_dist, entry);
+    }
+
+    while(!candidates.empty()) {
+        const dist_node_t candidate = candidates.top();
+
+        if(kept.size() >= ef && candidate.first > kept.top().first) {
+            // every node left is farther than the ones kept
+            break;
+        }
+
+        candidates.pop();
+
+        for(uint32_t link: nodes[candidate.second].links[level]) {
+            if(!visited.insert(link).second) {
+                continue;
+            }
+
+            const float link_dist = node_distance(query, link);
+
+            if(kept.size() < ef || link_dist < kept.top().first) {
+                // a node that is not kept can still lead to ones that are
+                candidates.emplace(link_dist, link);
+
+                if(is_kept(link)) {
+                    kept.emplace(link_dist, link);
+                    if(kept.size() > ef) {
+                        kept.pop();
+                    }
+                }
+            }
+        }
+    }
+
+    found.resize(kept.size());
+    for(size_t i = found.size(); i > 0; i--) {
+        found[i - 1] = kept.top();
+        kept.pop();
+    }
+}
+
+void vector_index_t::select_links(const std::vector<dist_node_t>& candidates, size_t max_links,
+                                  std::vector<uint32_t>& links) const {
+    links.clear();
+    std::vector<float> candidate_values(num_dim);
+
+    for(const auto& candidate: candidates) {
+        if(links.size() == max_links) {
+            break;
+        }
+
+        get_values(candidate.second, candidate_values.data());
+        bool is_closer = true;
+
+        for(uint32_t link: links) {
+            if(node_distance(candidate_values.data(), link) < candidate.first) {
+                is_closer = false;
+                break;
+            }
+        }
+
+        if(is_closer) {
+            links.push_back(candidate.second);
+        }
+    }
+}
+
+void vector_index_t::add_node(uint32_t seq_id, const float* node_values) {
+    const uint32_t node = nodes.size();
+
+    std::uniform_real_distribution<double> level_dist(0.0, 1.0);
+    const double r = std::max(level_dist(level_gen), 1e-9);
+    const int level = int(-std::log(r) / std::log(double(M)));
+
+    nodes.push_back({seq_id, false, std::vector<std::vector<uint32_t>>(level + 1)});
+    seq_id_nodes[seq_id] = node;
+
+    if(quantize) {
+        float max_abs = 0;
+        for(size_t i = 0; i < num_dim; i++) {
+            max_abs = std::max(max_abs, std::abs(node_values[i]));
+        }
+
+        const float scale = max_abs / 127;
+        scales.push_back(scale);
+
+        for(size_t i = 0; i < num_dim; i++) {
+            codes.push_back((scale == 0) ? 0 : int8_t(std::lround(node_values[i] / scale)));
+        }
+    } else {
+        values.insert(values.end(), node_values, node_values + num_dim);
+    }
+
+    if(max_level < 0) {
+        entry_node = node;
+        max_level = level;
+        return ;
+    }
+
+    uint32_t entry = descend(node_values, level);
+    std::vector<dist_node_t> found, link_dists;
+    std::vector<uint32_t> links;
+    std::vector<float> link_values(num_dim);
+
+    for(int l = std::min(level, max_level); l >= 0; l--) {
+        const size_t max_links = (l == 0) ? 2 * M : M;
+
+        search_level(node_values, entry, EF_CONSTRUCTION, l, false, nullptr, found);
+        entry = found[0].second;
+
+        select_links(found, M, nodes[node].links[l]);
+
+        for(uint32_t link: nodes[node].links[l]) {
+            std::vector<uint32_t>& back_links = nodes[link].links[l];
+            back_links.push_back(node);
+
+            if(back_links.size() <= max_links) {
+                continue;
+            }
+
+            // the node linked to has too many links now, and keeps the ones that spread out the most
+            get_values(link, link_values.data());
+            link_dists.clear();
+
+            for(uint32_t back_link: back_links) {
+                link_dists.emplace_back(node_distance(link_values.data(), back_link), back_link);
+            }
+
+            std::sort(link_dists.begin(), link_dists.end());
+            select_links(link_dists, max_links, links);
+            back_links = links;
+        }
+    }
+
+    if(level > max_level) {
+        entry_node = node;
+        max_level = level;
+    }
+}
+
+void vector_index_t::insert(uint32_t seq_id, const float* raw_values) {
+    remove(seq_id);
+
+    std::vector<float> node_values;
+    prepare(raw_values, node_values);
+    add_node(seq_id, node_values.data());
+}
+
+void vector_index_t::remove(uint32_t seq_id) {
+    const auto node_it = seq_id_nodes.find(seq_id);
+    if(node_it == seq_id_nodes.end()) {
+        return ;
+    }
+
+    nodes[node_it->second].deleted = true;
+    seq_id_nodes.erase(node_it);
+    num_deleted++;
+
+    if(seq_id_nodes.empty() || (nodes.size() >= REBUILD_MIN_NODES && num_deleted > nodes.size() / 2)) {
+        rebuild();
+    }
+}
+
+void vector_index_t::rebuild() {
+    std::vector<uint32_t> live_seq_ids;
+    std::vector<float> live_values;
+    live_values.reserve(seq_id_nodes.size() * num_dim);
+
+    for(size_t node = 0; node < nodes.size(); node++) {
+        if(nodes[node].deleted) {
+            continue;
+        }
+
+        live_seq_ids.push_back(nodes[node].seq_id);
+        live_values.resize(live_values.size() + num_dim);
+        get_values(node, live_values.data() + live_values.size() - num_dim);
+    }
+
+    nodes.clear();
+    values.clear();
+    codes.clear();
+    scales.clear();
+    seq_id_nodes.clear();
+    entry_node = 0;
+    max_level = -1;
+    num_deleted = 0;
+
+    // the values held are already prepared
+    for(size_t i = 0; i < live_seq_ids.size(); i++) {
+        add_node(live_seq_ids[i], live_values.data() + i * num_dim);
+    }
+}
+
+void vector_index_t::search(const float* query, size_t k, const std::function<bool(uint32_t)>& is_allowed,
+                            std::vector<std::pair<float, uint32_t>>& results) const {
+    results.clear();
+
+    if(k == 0 || seq_id_nodes.empty()) {
+        return ;
+    }
+
+    std::vector<float> query_values;
+    prepare(query, query_values);
+
+    const uint32_t entry = descend(query_values.data(), 0);
+    std::vector<dist_node_t> found;
+    search_level(query_values.data(), entry, std::max(k, EF_SEARCH), 0, true, is_allowed ? &is_allowed : nullptr,
+                 found);
+
+    for(size_t i = 0; i < found.size() && i < k; i++) {
+        results.emplace_back(found[i].first, nodes[found[i].second].seq_id);
+    }
+}
+
+void vector_index_t::distances(const float* query, const uint32_t* seq_ids, size_t num_seq_ids,
+                               std::vector<std::pair<float, uint32_t>>& results) const {
+    std::vector<float> query_values;
+    prepare(query, query_values);
+
+    for(size_t i = 0; i < num_seq_ids; i++) {
+        const auto node_it = seq_id_nodes.find(seq_ids[i]);
+        if(node_it != seq_id_nodes.end()) {
+            results.emplace_back(node_distance(query_values.data(), node_it->second), seq_ids[i]);
+        }
+    }
+}
+
+bool vector_index_t::distance(const float* query, uint32_t seq_id, float& out) const {
+    const auto node_it = seq_id_nodes.find(seq_id);
+    if(node_it == seq_id_nodes.end()) {
+        return false;
+    }
+
+    std::vector<float> query_values;
+    prepare(query, query_values);
+
+    out = node_distance(query_values.data(), node_it->second);
+    return true;
+}
@@ -118,3 +118,46 @@ TEST_F(ADITreeTest, InsertDeleteManyElements) {
         tree.remove(i);
     }
 }
+
+TEST_F(ADITreeTest, MaterializedRanksMatchTreeRanks) {
+    adi_tree_t tree;
+
+    // prefixes of one another, duplicates and chars beyond ASCII
+    const std::vector<std::string> keys = {"a", "ab", "abc", "abd", "b", "ab", "a", "\xc3\xa9t\xc3\xa9", "\xc3\xa9",
+                                           "abc", "zz", "z", "ab\xc3\xa9", "m", "map", "mapped", "maps", "ma"};
+
+    for(size_t i = 0; i < keys.size(); i++) {
+        tree.index(i * 3, keys[i]);
+    }
+
+    tree.remove(12);
+    tree.index(12, "b");
+
+    std::vector<size_t> tree_ranks;
+    for(size_t id = 0; id < keys.size() * 3 + 5; id++) {
+        tree_ranks.push_back(tree.rank(id));
+    }
+
+    // too few lookups to pay for a rebuild
+    tree.materialize_ranks(1);
+    ASSERT_FALSE(tree.has_materialized_ranks());
+
+    tree.materialize_ranks(keys.size());
+    ASSERT_TRUE(tree.has_materialized_ranks());
+
+    for(size_t id = 0; id < tree_ranks.size(); id++) {
+        ASSERT_EQ(tree_ranks[id], tree.rank(id));
+    }
+
+    // any write makes them stale
+    tree.index(1000, "aa");
+    ASSERT_FALSE(tree.has_materialized_ranks());
+    const size_t tree_rank = tree.rank(3);
+
+    tree.materialize_ranks(keys.size());
+    ASSERT_EQ(tree_rank, tree.rank(3));
+    ASSERT_EQ(INT64_MAX, tree.rank(1001));
+
+    tree.remove(1000);
+    ASSERT_FALSE(tree.has_materialized_ranks());
+}
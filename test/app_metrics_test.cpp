@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <thread>
 #include "app_metrics.h"
 
 class AppMetricsTest : public ::testing::Test {
@@ -43,3 +44,98 @@ TEST_F(AppMetricsTest, StatefulRemoveDocs) {
     ASSERT_EQ(result["rps"]["GET /collections"].get<double>(), 0.2);
     ASSERT_EQ(result["rps"]["GET /operations/vote"].get<double>(), 0.1);
 }
+
+TEST_F(AppMetricsTest, ShedSearchesLeftOutOfTotal) {
+    metrics.increment_count("GET /collections", 1);
+    metrics.increment_count(AppMetrics::SEARCH_SHED_LABEL, 3);
+
+    metrics.window_reset();
+
+    nlohmann::json result;
+    metrics.get("rps", "latency", result);
+
+    ASSERT_EQ(result["search_shed_rps"].get<double>(), 0.3);
+    ASSERT_EQ(result["total_rps"].get<double>(), 0.1);
+    ASSERT_EQ(0, result["rps"].count(AppMetrics::SEARCH_SHED_LABEL));
+
+    metrics.window_reset();
+}
+
+TEST_F(AppMetricsTest, LatencyPercentilesAcrossThreads) {
+    std::vector<std::thread> threads;
+
+    for(size_t i = 0; i < 4; i++) {
+        threads.emplace_back([this, i]() {
+            for(uint64_t duration_us = 1; duration_us <= 1000; duration_us++) {
+                metrics.record_latency("GET /collections", duration_us * 1000);
+            }
+
+            metrics.record_latency(AppMetrics::SEARCH_LABEL, (i + 1) * 1000);
+        });
+    }
+
+    for(auto& thread: threads) {
+        thread.join();
+    }
+
+    metrics.window_reset();
+
+    nlohmann::json result;
+    metrics.get("rps", "latency", result);
+
+    const auto& route_percentiles = result["latency_percentiles"]["GET /collections"];
+    ASSERT_EQ(4000, route_percentiles["count"].get<uint64_t>());
+    ASSERT_NEAR(500, route_percentiles["p50"].get<double>(), 500.0 / 32);
+    ASSERT_NEAR(950, route_percentiles["p95"].get<double>(), 950.0 / 32);
+    ASSERT_NEAR(990, route_percentiles["p99"].get<double>(), 990.0 / 32);
+    ASSERT_NEAR(999, route_percentiles["p999"].get<double>(), 999.0 / 32);
+
+    const auto& search_percentiles = result["latency_percentiles"][AppMetrics::SEARCH_LABEL];
+    ASSERT_EQ(4, search_percentiles["count"].get<uint64_t>());
+    ASSERT_NEAR(2, search_percentiles["p50"].get<double>(), 2.0 / 32);
+    ASSERT_EQ(4.0, search_percentiles["p999"].get<double>());
+
+    // only the last window is reported
+    metrics.window_reset();
+    result.clear();
+    metrics.get("rps", "latency", result);
+    ASSERT_EQ(0, result["latency_percentiles"].size());
+}
+
+TEST_F(AppMetricsTest, OpenMetricsTotalsAndQuantiles) {
+    nlohmann::json result;
+    metrics.window_reset();
+
+    std::thread thread([this]() {
+        metrics.record_latency("GET /collections/books", 2000);
+        metrics.record_latency("GET /collections/books", 4000);
+        metrics.record_latency(AppMetrics::SEARCH_LABEL + " books", 1000);
+    });
+
+    thread.join();
+    metrics.window_reset();
+
+    openmetrics_writer_t writer;
+    metrics.get_openmetrics(writer);
+    std::string text = writer.finish();
+
+    ASSERT_NE(std::string::npos, text.find("# TYPE typesense_http_request_duration_seconds summary\n"));
+    ASSERT_NE(std::string::npos, text.find("typesense_http_request_duration_seconds{method=\"GET\","
+                                           "path=\"/collections/books\",quantile=\"0.999\"} 0.004\n"));
+    ASSERT_NE(std::string::npos, text.find("typesense_http_request_duration_seconds_sum{method=\"GET\","
+                                           "path=\"/collections/books\"} 0.006\n"));
+    ASSERT_NE(std::string::npos, text.find("typesense_http_request_duration_seconds_count{method=\"GET\","
+                                           "path=\"/collections/books\"} 2\n"));
+    ASSERT_NE(std::string::npos, text.find("typesense_search_duration_seconds_count{collection=\"books\"} 1\n"));
+
+    // totals outlive the window, and the thread that recorded them
+    metrics.window_reset();
+
+    openmetrics_writer_t next_writer;
+    metrics.get_openmetrics(next_writer);
+    text = next_writer.finish();
+
+    ASSERT_EQ(std::string::npos, text.find("quantile=\"0.999\"} 0.004\n"));
+    ASSERT_NE(std::string::npos, text.find("typesense_http_request_duration_seconds_count{method=\"GET\","
+                                           "path=\"/collections/books\"} 2\n"));
+}
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include "array_utils.h"
 #include "logger.h"
+#include <random>
+#include <set>
+#include <algorithm>
 
 TEST(SortedArrayTest, AndScalar) {
     const size_t size1 = 9;
@@ -172,4 +175,49 @@ TEST(SortedArrayTest, FilterArray) {
     delete[] arr2;
     delete[] arr1;
     delete[] results;
-}
\ No newline at end of file
+}
+TEST(SortedArrayTest, AndPositionsMatchesScalar) {
+    std::mt19937 rng(42);
+
+    for(size_t round = 0; round < 200; round++) {
+        std::set<uint32_t> set_a, set_b;
+        size_t len_a = rng() % 300;
+        size_t len_b = rng() % 300;
+        uint32_t range = 1 + (rng() % 1000);
+
+        while(set_a.size() < len_a && set_a.size() < range) {
+            set_a.insert(rng() % range);
+        }
+
+        while(set_b.size() < len_b && set_b.size() < range) {
+            set_b.insert(rng() % range);
+        }
+
+        std::vector<uint32_t> a(set_a.begin(), set_a.end());
+        std::vector<uint32_t> b(set_b.begin(), set_b.end());
+
+        std::vector<uint32_t> expected;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+
+        std::vector<uint32_t> pos_a(std::min(a.size(), b.size()) + 1);
+        std::vector<uint32_t> pos_b(std::min(a.size(), b.size()) + 1);
+
+        size_t num_found = ArrayUtils::and_positions(a.data(), a.size(), b.data(), b.size(),
+                                                     pos_a.data(), pos_b.data());
+        ASSERT_EQ(expected.size(), num_found);
+
+        for(size_t i = 0; i < num_found; i++) {
+            ASSERT_EQ(expected[i], a[pos_a[i]]);
+            ASSERT_EQ(expected[i], b[pos_b[i]]);
+        }
+
+        num_found = ArrayUtils::and_positions_scalar(a.data(), a.size(), b.data(), b.size(),
+                                                     pos_a.data(), pos_b.data());
+        ASSERT_EQ(expected.size(), num_found);
+
+        for(size_t i = 0; i < num_found; i++) {
+            ASSERT_EQ(expected[i], a[pos_a[i]]);
+            ASSERT_EQ(expected[i], b[pos_b[i]]);
+        }
+    }
+}
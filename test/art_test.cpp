@@ -6,7 +6,9 @@
 #include <gtest/gtest.h>
 #include <art.h>
 #include <chrono>
+#include <map>
 #include <posting.h>
+#include "compact_list_arena.h"
 
 #define words_file_path std::string(std::string(ROOT_DIR)+"/build/test_resources/words.txt").c_str()
 #define uuid_file_path std::string(std::string(ROOT_DIR)+"/build/test_resources/uuid.txt").c_str()
@@ -609,6 +611,62 @@ TEST(ArtTest, test_art_fuzzy_search_single_leaf) {
     ASSERT_TRUE(res == 0);
 }
 
+TEST(ArtTest, test_art_fuzzy_search_transpositions_and_long_terms) {
+    art_tree t;
+    int res = art_tree_init(&t);
+    ASSERT_TRUE(res == 0);
+
+    // terms up to 64 chars use the bit-parallel matrix, longer ones the row based one
+    std::vector<std::string> keys = {"platinum", "plantinum", std::string(64, 'a') + "xyz", std::string(70, 'b') + "xyz"};
+
+    for(size_t i = 0; i < keys.size(); i++) {
+        art_document doc = get_document((uint32_t) i);
+        ASSERT_TRUE(NULL == art_insert(&t, (unsigned char*) keys[i].c_str(), keys[i].size() + 1, &doc));
+    }
+
+    std::vector<art_leaf*> leaves;
+
+    // transposition of 2 adjacent chars costs 1
+    art_fuzzy_search(&t, (const unsigned char *) "pltainum", strlen("pltainum") + 1, 0, 1, 10, FREQUENCY, false,
+                     nullptr, 0, leaves);
+    ASSERT_EQ(1, leaves.size());
+    ASSERT_STREQ("platinum", (const char *) leaves[0]->key);
+
+    leaves.clear();
+    art_fuzzy_search(&t, (const unsigned char *) "pltainum", strlen("pltainum") + 1, 1, 1, 10, FREQUENCY, false,
+                     nullptr, 0, leaves);
+    ASSERT_EQ(1, leaves.size());
+    ASSERT_STREQ("platinum", (const char *) leaves[0]->key);
+
+    for(size_t i = 2; i < keys.size(); i++) {
+        std::string typo_term = keys[i];
+        std::swap(typo_term[typo_term.size() - 1], typo_term[typo_term.size() - 2]);
+
+        leaves.clear();
+        art_fuzzy_search(&t, (const unsigned char *) typo_term.c_str(), typo_term.size() + 1, 0, 0, 10, FREQUENCY,
+                         false, nullptr, 0, leaves);
+        ASSERT_EQ(0, leaves.size());
+
+        leaves.clear();
+        art_fuzzy_search(&t, (const unsigned char *) typo_term.c_str(), typo_term.size() + 1, 1, 1, 10, FREQUENCY,
+                         false, nullptr, 0, leaves);
+        ASSERT_EQ(1, leaves.size());
+        ASSERT_EQ(keys[i], std::string((const char *) leaves[0]->key, leaves[0]->key_len - 1));
+
+        // prefix search on a truncated term with a typo
+        std::string prefix_term = keys[i].substr(0, keys[i].size() - 4) + "q";
+
+        leaves.clear();
+        art_fuzzy_search(&t, (const unsigned char *) prefix_term.c_str(), prefix_term.size(), 0, 1, 10, FREQUENCY,
+                         true, nullptr, 0, leaves);
+        ASSERT_EQ(1, leaves.size());
+        ASSERT_EQ(keys[i], std::string((const char *) leaves[0]->key, leaves[0]->key_len - 1));
+    }
+
+    res = art_tree_destroy(&t);
+    ASSERT_TRUE(res == 0);
+}
+
 TEST(ArtTest, test_art_fuzzy_search_single_leaf_prefix) {
     art_tree t;
     int res = art_tree_init(&t);
@@ -709,6 +767,57 @@ TEST(ArtTest, test_art_fuzzy_search_prefix_token_ordering) {
     ASSERT_TRUE(res == 0);
 }
 
+TEST(ArtTest, test_art_prefix_search_top_k) {
+    art_tree t;
+    art_tree_init(&t);
+
+    // keys with distinct scores, inserted in an order unrelated to the score
+    std::vector<std::string> keys;
+    std::map<int64_t, std::string> score_keys;
+
+    for(size_t i = 0; i < 2000; i++) {
+        std::string key = "a" + std::to_string(i) + "x";
+        int64_t score = (i * 7919) % 2000;
+        art_document doc(i, score, {0});
+        art_insert(&t, (const unsigned char*) key.c_str(), key.size()+1, &doc);
+        score_keys[score] = key;
+    }
+
+    std::vector<art_leaf*> leaves;
+    art_fuzzy_search(&t, (const unsigned char *) "a", 1, 0, 0, 10, MAX_SCORE, true, nullptr, 0, leaves);
+    ASSERT_EQ(10, leaves.size());
+
+    auto score_key_it = score_keys.rbegin();
+    for(size_t i = 0; i < leaves.size(); i++, score_key_it++) {
+        ASSERT_EQ(score_key_it->second, std::string(reinterpret_cast<char*>(leaves[i]->key), leaves[i]->key_len - 1));
+    }
+
+    art_tree_destroy(&t);
+
+    // frequency of a token is propagated to the nodes above it only after the insert
+    art_tree_init(&t);
+
+    uint32_t seq_id = 0;
+    for(size_t i = 0; i < 200; i++) {
+        std::string key = "b" + std::to_string(i);
+        size_t num_docs = 1 + (i * 37) % 200;
+        for(size_t j = 0; j < num_docs; j++) {
+            art_document doc(seq_id++, INT64_MIN, {0});
+            art_insert(&t, (const unsigned char*) key.c_str(), key.size()+1, &doc);
+        }
+    }
+
+    leaves.clear();
+    art_fuzzy_search(&t, (const unsigned char *) "b", 1, 0, 0, 5, FREQUENCY, true, nullptr, 0, leaves);
+    ASSERT_EQ(5, leaves.size());
+
+    for(size_t i = 0; i < leaves.size(); i++) {
+        ASSERT_EQ(200 - i, posting_t::num_ids(leaves[i]->values));
+    }
+
+    art_tree_destroy(&t);
+}
+
 TEST(ArtTest, test_art_fuzzy_search) {
     art_tree t;
     int res = art_tree_init(&t);
@@ -1591,6 +1700,36 @@ TEST(ArtTest, test_int32_array) {
     ASSERT_TRUE(res == 0);
 }
 
+TEST(ArtTest, test_art_tree_stats) {
+    art_tree t;
+    art_tree_init(&t);
+
+    art_tree_stats stats{};
+    art_tree_get_stats(&t, &stats);
+    ASSERT_EQ(0, stats.num_nodes);
+    ASSERT_EQ(0, stats.num_leaves);
+
+    const size_t arena_bytes_before = CompactListArena::get_instance().allocated_bytes();
+
+    std::vector<std::string> keys = {"apple", "apricot", "banana", "band", "bandana", "cherry"};
+
+    for(size_t i = 0; i < keys.size(); i++) {
+        art_document doc = get_document(i);
+        art_insert(&t, (const unsigned char*) keys[i].c_str(), keys[i].size()+1, &doc);
+    }
+
+    art_tree_get_stats(&t, &stats);
+    ASSERT_EQ(keys.size(), stats.num_leaves);
+    ASSERT_LT(0, stats.num_nodes);
+    ASSERT_LT(0, stats.leaf_bytes);
+    ASSERT_LT(0, stats.node_bytes);
+    ASSERT_LT(arena_bytes_before, CompactListArena::get_instance().allocated_bytes());
+
+    int res = art_tree_destroy(&t);
+    ASSERT_TRUE(res == 0);
+    ASSERT_EQ(arena_bytes_before, CompactListArena::get_instance().allocated_bytes());
+}
+
 TEST(ArtTest, test_encode_float_positive) {
     art_tree t;
     art_tree_init(&t);
@@ -395,6 +395,43 @@ TEST_F(AuthManagerTest, ScopedAPIKeys) {
     ASSERT_FALSE(auth_manager.authenticate("documents:search", {collection_key_t("coll1", "SXZqcVdOWjVNNUVsY3ZiTW9YajQ1QnhrUXJaRzRaS0VhTlFvUmlvQ3gycz1LZXlWeyJmaWx0ZXJfYnkiOiAidXNlcl9pZDoxMDgw In0=")}, empty_params, embedded_params));
 }
 
+TEST_F(AuthManagerTest, CachedAuthenticationsDropRemovedKeys) {
+    std::map<std::string, std::string> params;
+    std::vector<nlohmann::json> embedded_params(1);
+
+    api_key_t key_search_coll1("KeyVal", "test key", {"documents:search"}, {"coll.*"}, FUTURE_TS);
+    auth_manager.create_key(key_search_coll1);
+
+    std::string scoped_key = StringUtils::base64_encode(
+      R"(IvjqWNZ5M5ElcvbMoXj45BxkQrZG4ZKEaNQoRioCx2s=KeyV{"filter_by": "user_id:1080"})"
+    );
+
+    // the second time around, the authentication is served from the cache
+    for(size_t i = 0; i < 2; i++) {
+        embedded_params[0] = nlohmann::json::object();
+        ASSERT_TRUE(auth_manager.authenticate("documents:search", {collection_key_t("coll1", scoped_key)},
+                                              params, embedded_params));
+        ASSERT_EQ("user_id:1080", embedded_params[0]["filter_by"].get<std::string>());
+
+        ASSERT_TRUE(auth_manager.authenticate("documents:search", {collection_key_t("coll1", "KeyVal")},
+                                              params, embedded_params));
+        ASSERT_TRUE(embedded_params[0].empty());
+
+        // a granted action or collection does not grant others
+        ASSERT_FALSE(auth_manager.authenticate("documents:search", {collection_key_t("other", scoped_key)},
+                                               params, embedded_params));
+        ASSERT_FALSE(auth_manager.authenticate("documents:create", {collection_key_t("coll1", "KeyVal")},
+                                               params, embedded_params));
+    }
+
+    // removing the parent key revokes its scoped keys
+    ASSERT_TRUE(auth_manager.remove_key(key_search_coll1.id).ok());
+    ASSERT_FALSE(auth_manager.authenticate("documents:search", {collection_key_t("coll1", scoped_key)},
+                                           params, embedded_params));
+    ASSERT_FALSE(auth_manager.authenticate("documents:search", {collection_key_t("coll1", "KeyVal")},
+                                           params, embedded_params));
+}
+
 TEST_F(AuthManagerTest, ValidateBadKeyProperties) {
     nlohmann::json key_obj1;
     key_obj1["description"] = "desc";
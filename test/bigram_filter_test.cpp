@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include "bigram_filter.h"
+
+TEST(BigramFilterTest, AddAndLookup) {
+    bigram_filter_t filter;
+    ASSERT_FALSE(filter.may_contain(bigram_filter_t::pair_hash("new", "york")));
+
+    filter.add(bigram_filter_t::pair_hash("new", "york"));
+    filter.add(bigram_filter_t::pair_hash("new", "york"));
+
+    ASSERT_TRUE(filter.may_contain(bigram_filter_t::pair_hash("new", "york")));
+    ASSERT_FALSE(filter.may_contain(bigram_filter_t::pair_hash("york", "new")));
+    ASSERT_FALSE(filter.may_contain(bigram_filter_t::pair_hash("newy", "ork")));
+    ASSERT_EQ(1, filter.num_pairs());
+}
+
+TEST(BigramFilterTest, GrowsWithoutFalseNegatives) {
+    bigram_filter_t filter;
+    const size_t num_pairs = 100000;
+
+    for(size_t i = 0; i < num_pairs; i++) {
+        filter.add(bigram_filter_t::pair_hash("token" + std::to_string(i), "token" + std::to_string(i + 1)));
+    }
+
+    const size_t first_bytes = filter.memory_bytes();
+    ASSERT_GT(first_bytes, num_pairs * 2);
+
+    size_t num_false_positives = 0;
+
+    for(size_t i = 0; i < num_pairs; i++) {
+        ASSERT_TRUE(filter.may_contain(bigram_filter_t::pair_hash("token" + std::to_string(i),
+                                                                  "token" + std::to_string(i + 1))));
+        num_false_positives += filter.may_contain(bigram_filter_t::pair_hash("token" + std::to_string(i + 1),
+                                                                             "token" + std::to_string(i)));
+    }
+
+    // a handful of the pairs that were never added look like they were
+    ASSERT_LT(num_false_positives, num_pairs / 20);
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "block_index.h"
+
+struct dummy_block_t {
+    uint32_t last = 0;
+};
+
+TEST(BlockIndexTest, InsertUpdateAndErase) {
+    block_index_t<dummy_block_t> index;
+    dummy_block_t b1, b2, b3;
+
+    ASSERT_TRUE(index.empty());
+    ASSERT_EQ(0, index.lower_bound(10));
+
+    index.insert(20, &b2);
+    index.insert(10, &b1);
+    index.insert(30, &b3);
+
+    ASSERT_EQ(3, index.size());
+    ASSERT_EQ(&b1, index.block_at(0));
+    ASSERT_EQ(&b2, index.block_at(1));
+    ASSERT_EQ(&b3, index.last_block());
+
+    ASSERT_EQ(0, index.lower_bound(0));
+    ASSERT_EQ(0, index.lower_bound(10));
+    ASSERT_EQ(1, index.lower_bound(11));
+    ASSERT_EQ(2, index.lower_bound(30));
+    ASSERT_EQ(3, index.lower_bound(31));
+
+    // last id of a block changes without the block moving around
+    index.update(20, 25);
+    ASSERT_EQ(25, index.last_id_at(1));
+    ASSERT_EQ(1, index.lower_bound(21));
+
+    index.erase(25);
+    ASSERT_EQ(2, index.size());
+    ASSERT_EQ(&b3, index.block_at(1));
+
+    // erasing a missing id is a no-op
+    index.erase(100);
+    ASSERT_EQ(2, index.size());
+}
+
+TEST(BlockIndexTest, GallopingLowerBoundMatchesBinarySearch) {
+    block_index_t<dummy_block_t> index;
+    std::vector<dummy_block_t> blocks(500);
+
+    for(size_t i = 0; i < blocks.size(); i++) {
+        index.insert(i * 10 + 5, &blocks[i]);
+    }
+
+    std::mt19937 rng(7);
+
+    for(size_t i = 0; i < 5000; i++) {
+        uint32_t id = rng() % 5100;
+        size_t hint = rng() % 520;
+        ASSERT_EQ(index.lower_bound(id), index.lower_bound(id, hint));
+    }
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "collection_dump.h"
+
+TEST(CollectionDumpTest, HeaderAndPairsRoundTrip) {
+    collection_dump_t dump;
+    dump.meta_json = R"({"name": "products", "id": 4})";
+    dump.next_seq_id = 1200;
+    dump.override_jsons = {R"({"id": "rule-1"})"};
+    dump.synonym_jsons = {R"({"id": "syn-1"})", R"({"id": "syn-2"})"};
+
+    std::stringstream ss;
+    dump.write_header(ss);
+    collection_dump_t::write_kv(ss, "$SI_abc", "{}");
+    collection_dump_t::write_kv(ss, "$DI_0", std::string("\0\1", 2));
+    collection_dump_t::write_kvs_end(ss);
+    ss << "index";
+
+    collection_dump_t read_dump;
+    ASSERT_TRUE(read_dump.read_header(ss));
+    ASSERT_EQ(dump.meta_json, read_dump.meta_json);
+    ASSERT_EQ(1200, read_dump.next_seq_id);
+    ASSERT_EQ(dump.override_jsons, read_dump.override_jsons);
+    ASSERT_EQ(dump.synonym_jsons, read_dump.synonym_jsons);
+
+    std::string key, value;
+    ASSERT_TRUE(collection_dump_t::read_kv(ss, key, value));
+    ASSERT_EQ("$SI_abc", key);
+    ASSERT_EQ("{}", value);
+
+    ASSERT_TRUE(collection_dump_t::read_kv(ss, key, value));
+    ASSERT_EQ("$DI_0", key);
+    ASSERT_EQ(std::string("\0\1", 2), value);
+
+    ASSERT_TRUE(collection_dump_t::read_kv(ss, key, value));
+    ASSERT_TRUE(key.empty());
+
+    // the index snapshot follows the pairs
+    std::string rest;
+    ss >> rest;
+    ASSERT_EQ("index", rest);
+
+    // a dump cut short
+    std::stringstream short_ss;
+    dump.write_header(short_ss);
+    collection_dump_t::write_kv(short_ss, "$SI_abc", "{}");
+    std::string truncated = short_ss.str();
+    truncated.resize(truncated.size() - 1);
+
+    std::stringstream truncated_ss(truncated);
+    ASSERT_TRUE(read_dump.read_header(truncated_ss));
+    ASSERT_FALSE(collection_dump_t::read_kv(truncated_ss, key, value));
+
+    std::stringstream bad_ss("garbage");
+    ASSERT_FALSE(read_dump.read_header(bad_ss));
+}
@@ -938,3 +938,221 @@ TEST_F(CollectionFacetingTest, FacetArrayValuesShouldBeNormalized) {
 
     collectionManager.drop_collection("coll1");
 }
+
+TEST_F(CollectionFacetingTest, SampledFacetCounts) {
+    std::vector<field> fields = {field("category", field_types::STRING, true),
+                                 field("points", field_types::INT32, false)};
+
+    std::vector<sort_by> sort_fields = {sort_by("points", "DESC")};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 4, fields, "points").get();
+
+    for(size_t i = 0; i < 1000; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["points"] = i;
+        doc["category"] = "cat_" + std::to_string(i % 4);
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto search = [&](size_t facet_sample_percent, size_t facet_sample_threshold) {
+        return coll1->search("*", {}, "", {"category"}, sort_fields, {0}, 10, 1,
+                             token_ordering::FREQUENCY, {true}, 10, spp::sparse_hash_set<std::string>(),
+                             spp::sparse_hash_set<std::string>(), 10, "", 30, 5,
+                             "", 10, {}, {}, {}, 0,
+                             "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7, fallback,
+                             10, {off}, 32767, 32767, 2,
+                             false, false, false, nullptr, "", facet_sample_percent, facet_sample_threshold);
+    };
+
+    auto results = search(50, 100).get();
+    ASSERT_EQ(1000, results["found"].get<size_t>());
+    ASSERT_EQ(4, results["facet_counts"][0]["counts"].size());
+    ASSERT_TRUE(results["facet_counts"][0]["sampled"].get<bool>());
+
+    size_t total_count = 0;
+    for(const auto& count: results["facet_counts"][0]["counts"]) {
+        ASSERT_GT(count["count"].get<size_t>(), 200);
+        ASSERT_LT(count["count"].get<size_t>(), 300);
+        total_count += count["count"].get<size_t>();
+    }
+
+    ASSERT_GT(total_count, 990);
+    ASSERT_LT(total_count, 1010);
+
+    // the same ids are sampled every time
+    ASSERT_EQ(results["facet_counts"], search(50, 100).get()["facet_counts"]);
+
+    // below the threshold, counts are exact
+    results = search(50, 2000).get();
+    ASSERT_EQ(0, results["facet_counts"][0].count("sampled"));
+
+    for(const auto& count: results["facet_counts"][0]["counts"]) {
+        ASSERT_EQ(250, count["count"].get<size_t>());
+    }
+
+    auto res_op = search(0, 100);
+    ASSERT_FALSE(res_op.ok());
+    ASSERT_EQ("Parameter `facet_sample_percent` must be between 1 and 100.", res_op.error());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionFacetingTest, FacetResultsAreCachedAcrossPages) {
+    std::vector<field> fields = {field("category", field_types::STRING, true),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 4, fields, "points").get();
+
+    for(size_t i = 0; i < 30; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["points"] = i;
+        doc["category"] = "cat_" + std::to_string(i % 3);
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto results = coll1->search("*", {}, "points: >= 10", {"category"}, {}, {0}, 5, 1).get();
+    ASSERT_EQ(20, results["found"].get<size_t>());
+    ASSERT_EQ(3, results["facet_counts"][0]["counts"].size());
+
+    // later pages get the same facets, computed once
+    for(size_t page = 2; page <= 4; page++) {
+        auto page_results = coll1->search("*", {}, "points: >= 10", {"category"}, {}, {0}, 5, page).get();
+        ASSERT_EQ(results["facet_counts"], page_results["facet_counts"]);
+    }
+
+    // a write invalidates them
+    nlohmann::json doc;
+    doc["id"] = "30";
+    doc["points"] = 30;
+    doc["category"] = "cat_new";
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    results = coll1->search("*", {}, "points: >= 10", {"category"}, {}, {0}, 5, 2).get();
+    ASSERT_EQ(21, results["found"].get<size_t>());
+    ASSERT_EQ(4, results["facet_counts"][0]["counts"].size());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionFacetingTest, FacetValueStringsAreKeptInMemory) {
+    std::vector<field> fields = {field("brand", field_types::STRING, true),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("rating", field_types::FLOAT, true),
+                                 field("in_stock", field_types::BOOL, true),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    nlohmann::json doc;
+    doc["id"] = "0";
+    doc["brand"] = "Acme";
+    doc["tags"] = {"red", "blue"};
+    doc["rating"] = 4.5;
+    doc["in_stock"] = true;
+    doc["points"] = 0;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    doc["id"] = "1";
+    doc["brand"] = "ACME";
+    doc["tags"] = {"blue"};
+    doc["rating"] = 3.0;
+    doc["in_stock"] = false;
+    doc["points"] = 1;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    // the value as last indexed is the one returned
+    auto results = coll1->search("*", {}, "", {"brand", "tags", "rating", "in_stock"}, {}, {0}, 10, 1).get();
+    ASSERT_EQ(4, results["facet_counts"].size());
+    ASSERT_EQ("ACME", results["facet_counts"][0]["counts"][0]["value"].get<std::string>());
+    ASSERT_EQ(2, results["facet_counts"][0]["counts"][0]["count"].get<size_t>());
+    ASSERT_EQ("blue", results["facet_counts"][1]["counts"][0]["value"].get<std::string>());
+    ASSERT_EQ(2, results["facet_counts"][1]["counts"][0]["count"].get<size_t>());
+
+    std::set<std::string> rating_values, in_stock_values;
+    for(const auto& count: results["facet_counts"][2]["counts"]) {
+        rating_values.insert(count["value"].get<std::string>());
+    }
+
+    for(const auto& count: results["facet_counts"][3]["counts"]) {
+        in_stock_values.insert(count["value"].get<std::string>());
+    }
+
+    ASSERT_EQ(std::set<std::string>({"4.5", "3"}), rating_values);
+    ASSERT_EQ(std::set<std::string>({"true", "false"}), in_stock_values);
+
+    // a value stays around for as long as some document has it
+    ASSERT_TRUE(coll1->remove("0").ok());
+    results = coll1->search("*", {}, "", {"brand", "tags"}, {}, {0}, 10, 1).get();
+    ASSERT_EQ("ACME", results["facet_counts"][0]["counts"][0]["value"].get<std::string>());
+    ASSERT_EQ(1, results["facet_counts"][0]["counts"][0]["count"].get<size_t>());
+    ASSERT_EQ(1, results["facet_counts"][1]["counts"].size());
+    ASSERT_EQ("blue", results["facet_counts"][1]["counts"][0]["value"].get<std::string>());
+
+    const field rating_field("rating", field_types::FLOAT, true);
+    const field in_stock_field("in_stock", field_types::BOOL_ARRAY, true);
+    ASSERT_EQ("4.5", Index::facet_value_to_string(rating_field, 4.5));
+    ASSERT_EQ("0", Index::facet_value_to_string(rating_field, 0.0));
+    ASSERT_EQ("true", Index::facet_value_to_string(in_stock_field, true));
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionFacetingTest, RangeFacets) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("price", field_types::INT32, false),
+                                 field("rating", field_types::FLOAT, false),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 200; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i % 2 == 0) ? "even" : "odd";
+        doc["price"] = i;
+        doc["rating"] = (i % 10) * 0.5;
+        doc["tags"] = {"tag"};
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto results = coll1->search("*", {}, "", {"price(..50, 50..150, 100..)", "rating(-1..2.5,2.5..)"}, {},
+                                 {0}, 10, 1).get();
+    ASSERT_EQ(2, results["facet_counts"].size());
+
+    // buckets include their lower bound, exclude their upper bound and may overlap
+    const auto& price_counts = results["facet_counts"][0]["counts"];
+    ASSERT_EQ("price", results["facet_counts"][0]["field_name"].get<std::string>());
+    ASSERT_EQ(3, price_counts.size());
+    ASSERT_EQ("..50", price_counts[0]["value"].get<std::string>());
+    ASSERT_EQ(50, price_counts[0]["count"].get<size_t>());
+    ASSERT_EQ(100, price_counts[1]["count"].get<size_t>());
+    ASSERT_EQ(100, price_counts[2]["count"].get<size_t>());
+
+    const auto& rating_counts = results["facet_counts"][1]["counts"];
+    ASSERT_EQ(100, rating_counts[0]["count"].get<size_t>());
+    ASSERT_EQ("2.5..", rating_counts[1]["value"].get<std::string>());
+    ASSERT_EQ(100, rating_counts[1]["count"].get<size_t>());
+
+    // counted over the results only, along with the other facets
+    results = coll1->search("even", {"title"}, "", {"tags", "price(0..10)"}, {}, {0}, 10, 1).get();
+    ASSERT_EQ(100, results["facet_counts"][0]["counts"][0]["count"].get<size_t>());
+    ASSERT_EQ(5, results["facet_counts"][1]["counts"][0]["count"].get<size_t>());
+
+    auto res_op = coll1->search("*", {}, "", {"price(0..10"}, {}, {0}, 10, 1);
+    ASSERT_FALSE(res_op.ok());
+    ASSERT_EQ("Range facet `price(0..10` must be in the `field(min..max, ...)` format.", res_op.error());
+
+    res_op = coll1->search("*", {}, "", {"price(10..10)"}, {}, {0}, 10, 1);
+    ASSERT_FALSE(res_op.ok());
+    ASSERT_EQ("Range `10..10` of range facet `price` is empty.", res_op.error());
+
+    res_op = coll1->search("*", {}, "", {"title(a..b)"}, {}, {0}, 10, 1);
+    ASSERT_FALSE(res_op.ok());
+    ASSERT_EQ("Range facet field `title` must be a numerical field that is sortable.", res_op.error());
+
+    collectionManager.drop_collection("coll1");
+}
@@ -1350,6 +1350,78 @@ TEST_F(CollectionFilteringTest, GeoPolygonFiltering) {
     collectionManager.drop_collection("coll1");
 }
 
+TEST_F(CollectionFilteringTest, RepeatedGeoPolygonFilterFollowsWrites) {
+    Collection *coll1;
+
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("loc", field_types::GEOPOINT, false),
+                                 field("points", field_types::INT32, false),};
+
+    coll1 = collectionManager.get_collection("coll1").get();
+    if(coll1 == nullptr) {
+        coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+    }
+
+    std::vector<std::vector<std::string>> records = {
+        {"Palais Garnier", "48.872576479306765, 2.332291112241466"},
+        {"Sacre Coeur", "48.888286721920934, 2.342340862419206"},
+        {"Louvre Musuem", "48.86065813197502, 2.3381285349616725"},
+        {"Eiffel Tower", "48.85821022164442, 2.294239067890161"},
+        {"Musee Grevin", "48.872370541246816, 2.3431536410008906"},
+    };
+
+    for(size_t i=0; i<records.size(); i++) {
+        nlohmann::json doc;
+
+        std::vector<std::string> lat_lng;
+        StringUtils::split(records[i][1], lat_lng, ", ");
+
+        doc["id"] = std::to_string(i);
+        doc["title"] = records[i][0];
+        doc["loc"] = {std::stod(lat_lng[0]), std::stod(lat_lng[1])};
+        doc["points"] = i;
+
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    const std::string polygon_filter = "loc: (48.875223042424125,2.323509661928681, "
+                                       "48.85745408145392, 2.3267084486160856, "
+                                       "48.859636574404355,2.351469427048221, "
+                                       "48.87756059389807, 2.3443610121873206)";
+
+    // the ids of the polygon are reused by the following searches, alone or after other filters
+    for(size_t i = 0; i < 2; i++) {
+        auto results = coll1->search("*", {}, polygon_filter, {}, {}, {0}, 10, 1, FREQUENCY).get();
+        ASSERT_EQ(3, results["found"].get<size_t>());
+
+        results = coll1->search("*", {}, "points:>0 && " + polygon_filter, {}, {}, {0}, 10, 1, FREQUENCY).get();
+        ASSERT_EQ(2, results["found"].get<size_t>());
+        ASSERT_STREQ("4", results["hits"][0]["document"]["id"].get<std::string>().c_str());
+        ASSERT_STREQ("2", results["hits"][1]["document"]["id"].get<std::string>().c_str());
+    }
+
+    // a point added inside the polygon and a point moved out of it
+    nlohmann::json doc;
+    doc["id"] = "5";
+    doc["title"] = "Place de la Concorde";
+    doc["loc"] = {48.86536119187326, 2.331850747347093};
+    doc["points"] = 5;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    doc["id"] = "4";
+    doc["title"] = "Musee Grevin";
+    doc["loc"] = {48.888286721920934, 2.342340862419206};
+    doc["points"] = 4;
+    ASSERT_TRUE(coll1->add(doc.dump(), UPSERT).ok());
+
+    auto results = coll1->search("*", {}, "points:>0 && " + polygon_filter, {}, {}, {0}, 10, 1, FREQUENCY).get();
+    ASSERT_EQ(2, results["found"].get<size_t>());
+    ASSERT_STREQ("5", results["hits"][0]["document"]["id"].get<std::string>().c_str());
+    ASSERT_STREQ("2", results["hits"][1]["document"]["id"].get<std::string>().c_str());
+
+    collectionManager.drop_collection("coll1");
+}
+
 TEST_F(CollectionFilteringTest, GeoPolygonFilteringSouthAmerica) {
     Collection *coll1;
 
@@ -2399,3 +2471,154 @@ TEST_F(CollectionFilteringTest, FilteringAfterUpsertOnArrayWithSymbolsToIndex) {
 
     collectionManager.drop_collection("coll1");
 }
+
+TEST_F(CollectionFilteringTest, RepeatedFiltersSeeWrites) {
+    std::vector<field> fields = {field("name", field_types::STRING, false),
+                                 field("in_stock", field_types::BOOL, false),
+                                 field("region", field_types::STRING, false),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 100; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["name"] = "shoe";
+        doc["in_stock"] = (i % 2 == 0);
+        doc["region"] = (i % 4 == 0) ? "EU" : "US";
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // the clauses are served from the filter cache after the first search
+    for(size_t i = 0; i < 2; i++) {
+        auto results = coll1->search("*", {}, "in_stock:true && region:EU", {}, {}, {0}, 10, 1,
+                                     FREQUENCY, {false}).get();
+        ASSERT_EQ(25, results["found"].get<size_t>());
+        ASSERT_EQ("96", results["hits"][0]["document"]["id"].get<std::string>());
+    }
+
+    auto results = coll1->search("*", {}, "in_stock:true && region:US", {}, {}, {0}, 10, 1,
+                                 FREQUENCY, {false}).get();
+    ASSERT_EQ(25, results["found"].get<size_t>());
+
+    nlohmann::json doc;
+    doc["id"] = "100";
+    doc["name"] = "shoe";
+    doc["in_stock"] = true;
+    doc["region"] = "EU";
+    doc["points"] = 100;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    results = coll1->search("*", {}, "in_stock:true && region:EU", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(26, results["found"].get<size_t>());
+    ASSERT_EQ("100", results["hits"][0]["document"]["id"].get<std::string>());
+
+    doc["in_stock"] = false;
+    ASSERT_TRUE(coll1->add(doc.dump(), UPSERT).ok());
+    ASSERT_TRUE(coll1->remove("96").ok());
+
+    results = coll1->search("*", {}, "in_stock:true && region:EU", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(24, results["found"].get<size_t>());
+    ASSERT_EQ("92", results["hits"][0]["document"]["id"].get<std::string>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionFilteringTest, ClausesAreEvaluatedMostSelectiveFirst) {
+    std::vector<field> fields = {field("name", field_types::STRING, false),
+                                 field("in_stock", field_types::BOOL, false),
+                                 field("region", field_types::STRING, false),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 100; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["name"] = "shoe";
+        doc["in_stock"] = (i % 2 == 0);
+        doc["region"] = (i % 4 == 0) ? "EU" : "US";
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // the exclusion is still applied on the results of all the other clauses
+    auto results = coll1->search("*", {}, "region:!=EU && in_stock:true && points:<10", {}, {}, {0}, 10, 1,
+                                 FREQUENCY, {false}).get();
+    ASSERT_EQ(2, results["found"].get<size_t>());
+    ASSERT_EQ("6", results["hits"][0]["document"]["id"].get<std::string>());
+    ASSERT_EQ("2", results["hits"][1]["document"]["id"].get<std::string>());
+
+    // a clause that matches nothing empties the results, wherever it is written
+    results = coll1->search("*", {}, "in_stock:true && region:EU && points:>1000", {}, {}, {0}, 10, 1,
+                            FREQUENCY, {false}).get();
+    ASSERT_EQ(0, results["found"].get<size_t>());
+
+    results = coll1->search("*", {}, "points:>1000 && region:!=EU", {}, {}, {0}, 10, 1,
+                            FREQUENCY, {false}).get();
+    ASSERT_EQ(0, results["found"].get<size_t>());
+
+    results = coll1->search("shoe", {"name"}, "points:[10..19] && in_stock:true && region:EU", {}, {}, {0}, 10, 1,
+                            FREQUENCY, {false}).get();
+    ASSERT_EQ(2, results["found"].get<size_t>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionFilteringTest, ExactFiltersOnStringFacetFields) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("brand", field_types::STRING, true),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    std::vector<std::string> brands = {"Nike", "New Balance", "Adidas", "New"};
+
+    for(size_t i = 0; i < 40; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "shoe";
+        doc["brand"] = brands[i % brands.size()];
+        doc["tags"] = (i % 2 == 0) ? std::vector<std::string>{"running", "trail running"} :
+                      std::vector<std::string>{"trail"};
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // whole values match, regardless of case
+    auto results = coll1->search("*", {}, "brand:= new", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(10, results["found"].get<size_t>());
+    ASSERT_EQ("39", results["hits"][0]["document"]["id"].get<std::string>());
+
+    results = coll1->search("*", {}, "brand:= [nike, New Balance, Puma]", {}, {}, {0}, 10, 1,
+                            FREQUENCY, {false}).get();
+    ASSERT_EQ(20, results["found"].get<size_t>());
+
+    results = coll1->search("*", {}, "brand:!= [Nike, New]", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(20, results["found"].get<size_t>());
+
+    results = coll1->search("*", {}, "tags:= trail", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(20, results["found"].get<size_t>());
+
+    results = coll1->search("*", {}, "tags:= [trail running] && brand:!= Adidas", {}, {}, {0}, 10, 1,
+                            FREQUENCY, {false}).get();
+    ASSERT_EQ(10, results["found"].get<size_t>());
+
+    // updates and deletes are seen
+    nlohmann::json doc;
+    doc["id"] = "0";
+    doc["brand"] = "Puma";
+    ASSERT_TRUE(coll1->add(doc.dump(), UPDATE).ok());
+    ASSERT_TRUE(coll1->remove("4").ok());
+
+    results = coll1->search("*", {}, "brand:= Nike", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(8, results["found"].get<size_t>());
+
+    results = coll1->search("*", {}, "brand:= Puma", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+    ASSERT_EQ("0", results["hits"][0]["document"]["id"].get<std::string>());
+
+    collectionManager.drop_collection("coll1");
+}
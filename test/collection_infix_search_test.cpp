@@ -355,9 +355,7 @@ TEST_F(CollectionInfixSearchTest, InfixDeleteAndUpdate) {
 
     coll1->remove("0");
 
-    for(size_t i = 0; i < coll1->_get_index()->_get_infix_index().at("title").size(); i++) {
-        ASSERT_EQ(0, coll1->_get_index()->_get_infix_index().at("title").at(i)->size());
-    }
+    ASSERT_EQ(0, coll1->_get_index()->_get_infix_index().at("title")->size());
 
     results = coll1->search("100037",
                         {"title"}, "", {}, {}, {0}, 3, 1, FREQUENCY, {true}, 5,
@@ -406,16 +404,7 @@ TEST_F(CollectionInfixSearchTest, InfixDeleteAndUpdate) {
     ASSERT_EQ(0, results["found"].get<size_t>());
     ASSERT_EQ(0, results["hits"].size());
 
-    std::string key = "yhd3342d78912";
-    auto strhash = StringUtils::hash_wy(key.c_str(), key.size());
-    const auto& infix_sets = coll1->_get_index()->_get_infix_index().at("title");
-    ASSERT_EQ(1, infix_sets[strhash % 4]->size());
-
-    for(size_t i = 0; i < infix_sets.size(); i++) {
-        if(i != strhash % 4) {
-            ASSERT_EQ(0, infix_sets[i]->size());
-        }
-    }
+    ASSERT_EQ(1, coll1->_get_index()->_get_infix_index().at("title")->size());
 
     collectionManager.drop_collection("coll1");
 }
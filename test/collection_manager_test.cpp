@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <thread>
 #include <collection_manager.h>
 #include "string_utils.h"
 #include "collection.h"
@@ -69,6 +70,7 @@ TEST_F(CollectionManagerTest, CollectionCreation) {
     ASSERT_EQ(schema.size(), collection1->get_schema().size());
     ASSERT_EQ("points", collection1->get_default_sorting_field());
     ASSERT_EQ(false, schema.at("not_stored").index);
+    ASSERT_EQ(4, collection1->get_summary_json()["num_memory_shards"].get<size_t>());
 
     // check storage as well
     rocksdb::Iterator* it = store->get_iterator();
@@ -99,7 +101,8 @@ TEST_F(CollectionManagerTest, CollectionCreation) {
               "{\"facet\":false,\"index\":true,\"infix\":false,\"locale\":\"\",\"name\":\"location\",\"optional\":true,\"sort\":true,\"type\":\"geopoint\"},"
               "{\"facet\":false,\"index\":false,\"infix\":false,\"locale\":\"\",\"name\":\"not_stored\",\"optional\":true,\"sort\":false,\"type\":\"string\"},"
               "{\"facet\":false,\"index\":true,\"infix\":false,\"locale\":\"\",\"name\":\"points\",\"optional\":false,\"sort\":true,\"type\":\"int32\"}],\"id\":0,"
-              "\"name\":\"collection1\",\"num_memory_shards\":4,\"symbols_to_index\":[\"+\"],\"token_separators\":[\"-\"]}",
+              "\"name\":\"collection1\",\"num_memory_shards\":4,\"posting_codec\":\"for\",\"symbols_to_index\":[\"+\"],"
+              "\"token_separators\":[\"-\"]}",
               collection_meta_json);
     ASSERT_EQ("1", next_collection_id);
 }
@@ -115,6 +118,7 @@ TEST_F(CollectionManagerTest, ShouldInitCollection) {
     ASSERT_EQ(1, collection->get_fields().size());
     ASSERT_EQ("foo", collection->get_default_sorting_field());
     ASSERT_EQ(0, collection->get_created_at());
+    ASSERT_EQ(FOR_CODEC, collection->get_posting_codec());
 
     ASSERT_FALSE(collection->get_fields().at(0).infix);
     ASSERT_FALSE(collection->get_fields().at(0).sort);
@@ -128,11 +132,13 @@ TEST_F(CollectionManagerTest, ShouldInitCollection) {
             nlohmann::json::parse("{\"name\": \"foobar\", \"id\": 100, \"fields\": [{\"name\": \"org\", \"type\": "
                                   "\"string\", \"facet\": false, \"infix\": true, \"sort\": true, \"locale\": \"en\"}], \"created_at\": 12345,"
                                   "\"default_sorting_field\": \"foo\","
-                                  "\"symbols_to_index\": [\"+\"], \"token_separators\": [\"-\"]}");
+                                  "\"symbols_to_index\": [\"+\"], \"token_separators\": [\"-\"],"
+                                  "\"posting_codec\": \"roaring\"}");
 
 
     collection = collectionManager.init_collection(collection_meta2, 100, store, 1.0f);
     ASSERT_EQ(12345, collection->get_created_at());
+    ASSERT_EQ(ROARING_CODEC, collection->get_posting_codec());
 
     std::vector<char> expected_symbols = {'+'};
     std::vector<char> expected_separators = {'-'};
@@ -525,6 +531,85 @@ TEST_F(CollectionManagerTest, DropCollectionCleanly) {
     delete it;
 }
 
+TEST_F(CollectionManagerTest, DropCollectionReleasesInBackground) {
+    std::ifstream infile(std::string(ROOT_DIR)+"test/multi_field_documents.jsonl");
+    std::string json_line;
+
+    while (std::getline(infile, json_line)) {
+        collection1->add(json_line);
+    }
+
+    infile.close();
+
+    ASSERT_TRUE(collectionManager.drop_collection("collection1").ok());
+
+    // the name is free again right away, while the dropped collection may still be getting released
+    ASSERT_EQ(nullptr, collectionManager.get_collection("collection1").get());
+
+    collection1 = collectionManager.create_collection("collection1", 4, search_fields, "points").get();
+    ASSERT_NE(nullptr, collection1);
+    ASSERT_TRUE(collection1->add(R"({"id": "0", "title": "Innerspace", "starring": "Dennis Quaid", "points": 10})").ok());
+
+    collectionManager.wait_for_reclaims();
+
+    rocksdb::Iterator* it = store->scan("0_");
+    ASSERT_FALSE(it->Valid() && it->key().starts_with("0_"));
+    delete it;
+
+    auto results = collection1->search("innerspace", {"title"}, "", {}, sort_fields, {0}, 10, 1, FREQUENCY,
+                                       {false}).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+}
+
+TEST_F(CollectionManagerTest, HibernateIdleCollection) {
+    std::ifstream infile(std::string(ROOT_DIR)+"test/multi_field_documents.jsonl");
+    std::string json_line;
+
+    while (std::getline(infile, json_line)) {
+        collection1->add(json_line);
+    }
+
+    infile.close();
+
+    auto results = collection1->search("the", {"title"}, "", {"cast"}, sort_fields, {0}, 10, 1, FREQUENCY,
+                                       {false}).get();
+    const size_t num_found = results["found"].get<size_t>();
+    ASSERT_LT(0, num_found);
+
+    ASSERT_TRUE(collectionManager.set_hibernation(60, "/tmp/typesense_test/coll_manager_test_hibernation").ok());
+    const size_t num_documents = collection1->get_num_documents();
+
+    // as of an hour later
+    collectionManager.hibernate_idle_collections(static_cast<uint64_t>(std::time(nullptr)) + 3600);
+
+    for(size_t i = 0; i < 500 && !collection1->is_hibernated(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    ASSERT_TRUE(collection1->is_hibernated());
+    ASSERT_EQ(num_documents, collection1->get_num_documents());
+
+    // woken by the lookup
+    collection1 = collectionManager.get_collection("collection1").get();
+    ASSERT_FALSE(collection1->is_hibernated());
+    ASSERT_EQ(num_documents, collection1->get_num_documents());
+
+    auto woken_results = collection1->search("the", {"title"}, "", {"cast"}, sort_fields, {0}, 10, 1, FREQUENCY,
+                                             {false}).get();
+    ASSERT_EQ(num_found, woken_results["found"].get<size_t>());
+    ASSERT_EQ(results["hits"].size(), woken_results["hits"].size());
+    ASSERT_EQ(results["facet_counts"], woken_results["facet_counts"]);
+
+    for(size_t i = 0; i < results["hits"].size(); i++) {
+        ASSERT_EQ(results["hits"][i]["document"]["id"], woken_results["hits"][i]["document"]["id"]);
+    }
+
+    ASSERT_TRUE(collection1->add(R"({"id": "100", "title": "The Innerspace", "starring": "Dennis Quaid", "points": 10})").ok());
+    woken_results = collection1->search("innerspace", {"title"}, "", {}, sort_fields, {0}, 10, 1, FREQUENCY,
+                                        {false}).get();
+    ASSERT_EQ(1, woken_results["found"].get<size_t>());
+}
+
 TEST_F(CollectionManagerTest, Symlinking) {
     CollectionManager & cmanager = CollectionManager::get_instance();
     std::string state_dir_path = "/tmp/typesense_test/cmanager_test_db";
@@ -668,6 +753,199 @@ TEST_F(CollectionManagerTest, LoadMultipleCollections) {
     delete new_store;
 }
 
+TEST_F(CollectionManagerTest, LoadCollectionInChunks) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 1050; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i % 3 == 0) ? "fizz" : "buzz";
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // leaves a chunk empty and others with gaps
+    for(size_t i = 200; i < 300; i++) {
+        ASSERT_TRUE(coll1->remove(std::to_string(i)).ok());
+    }
+
+    for(size_t i = 400; i < 500; i += 7) {
+        ASSERT_TRUE(coll1->remove(std::to_string(i)).ok());
+    }
+
+    const size_t num_docs = coll1->get_num_documents();
+    ASSERT_EQ(1050 - 100 - 15, num_docs);
+
+    collectionManager.dispose();
+    delete store;
+
+    store = new Store("/tmp/typesense_test/coll_manager_test_db");
+    collectionManager.init(store, 1.0, "auth_key", quit);
+    ASSERT_TRUE(collectionManager.load(8, 100).ok());
+    ASSERT_TRUE(collectionManager.get_load_progress().empty());
+
+    coll1 = collectionManager.get_collection("coll1").get();
+    ASSERT_EQ(num_docs, coll1->get_num_documents());
+
+    auto results = coll1->search("fizz", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(312, results["found"].get<size_t>());
+    ASSERT_EQ("1047", results["hits"][0]["document"]["id"].get<std::string>());
+
+    ASSERT_FALSE(coll1->get("250").ok());
+    ASSERT_FALSE(coll1->get("407").ok());
+    ASSERT_TRUE(coll1->get("1049").ok());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionManagerTest, LoadCollectionOffIndexSnapshot) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 500; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i % 3 == 0) ? "fizz" : "buzz";
+        doc["tags"] = {(i % 2 == 0) ? "even" : "odd"};
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    for(size_t i = 0; i < 30; i++) {
+        ASSERT_TRUE(coll1->remove(std::to_string(i)).ok());
+    }
+
+    const std::string snapshot_dir = "/tmp/typesense_test/coll_manager_index_snapshot";
+    system(("rm -rf " + snapshot_dir + " && mkdir -p " + snapshot_dir).c_str());
+
+    ASSERT_TRUE(collectionManager.save_index_snapshots(snapshot_dir, store->get_latest_seq_number()).ok());
+
+    // trees that are not empty are never restored into
+    ASSERT_FALSE(coll1->load_index_snapshot(
+        CollectionManager::get_index_snapshot_path(snapshot_dir, coll1->get_collection_id()),
+        store->get_latest_seq_number()
+    ));
+
+    collectionManager.dispose();
+    delete store;
+
+    store = new Store("/tmp/typesense_test/coll_manager_test_db");
+    collectionManager.init(store, 1.0, "auth_key", quit);
+    collectionManager.set_index_snapshot_dir(snapshot_dir);
+    ASSERT_TRUE(collectionManager.load(8, 100).ok());
+
+    coll1 = collectionManager.get_collection("coll1").get();
+    ASSERT_EQ(470, coll1->get_num_documents());
+
+    auto results = coll1->search("fizz", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(157, results["found"].get<size_t>());
+    ASSERT_EQ("498", results["hits"][0]["document"]["id"].get<std::string>());
+
+    results = coll1->search("even", {"tags"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(235, results["found"].get<size_t>());
+
+    // writes after the load are tokenized as usual
+    nlohmann::json doc;
+    doc["id"] = "500";
+    doc["title"] = "fizz bang";
+    doc["tags"] = {"even"};
+    doc["points"] = 500;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    results = coll1->search("bang", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+
+    // the store has moved on since the snapshot, which is then ignored
+    collectionManager.dispose();
+    delete store;
+
+    store = new Store("/tmp/typesense_test/coll_manager_test_db");
+    collectionManager.init(store, 1.0, "auth_key", quit);
+    collectionManager.set_index_snapshot_dir(snapshot_dir);
+    ASSERT_TRUE(collectionManager.load(8, 100).ok());
+
+    coll1 = collectionManager.get_collection("coll1").get();
+    results = coll1->search("fizz", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(158, results["found"].get<size_t>());
+    ASSERT_EQ("500", results["hits"][0]["document"]["id"].get<std::string>());
+
+    collectionManager.set_index_snapshot_dir("");
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionManagerTest, LoadCollectionRenumberedByDefaultSortingField) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 250; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i % 3 == 0) ? "fizz" : "buzz";
+        doc["points"] = (i * 37) % 250;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    for(size_t i = 0; i < 10; i++) {
+        ASSERT_TRUE(coll1->remove(std::to_string(i)).ok());
+    }
+
+    collectionManager.dispose();
+    delete store;
+
+    store = new Store("/tmp/typesense_test/coll_manager_test_db");
+    collectionManager.init(store, 1.0, "auth_key", quit);
+    collectionManager.set_static_rank_seq_ids(true);
+    ASSERT_TRUE(collectionManager.load(8, 100).ok());
+
+    coll1 = collectionManager.get_collection("coll1").get();
+    ASSERT_EQ(240, coll1->get_num_documents());
+    ASSERT_EQ(490, coll1->peek_next_seq_id());
+
+    // the document with the most points comes first: (27 * 37) % 250 == 249
+    ASSERT_EQ(250, coll1->doc_id_to_seq_id("27").get());
+    ASSERT_EQ(249, coll1->get("27").get()["points"].get<int32_t>());
+    ASSERT_FALSE(coll1->get("5").ok());
+
+    auto results = coll1->search("fizz", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(80, results["found"].get<size_t>());
+    ASSERT_EQ("27", results["hits"][0]["document"]["id"].get<std::string>());
+
+    nlohmann::json doc;
+    doc["id"] = "250";
+    doc["title"] = "fizz";
+    doc["points"] = 0;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    ASSERT_EQ(490, coll1->doc_id_to_seq_id("250").get());
+    ASSERT_TRUE(coll1->remove("27").ok());
+
+    // ids that are already in order are left alone
+    collectionManager.dispose();
+    delete store;
+
+    store = new Store("/tmp/typesense_test/coll_manager_test_db");
+    collectionManager.init(store, 1.0, "auth_key", quit);
+    ASSERT_TRUE(collectionManager.load(8, 100).ok());
+
+    coll1 = collectionManager.get_collection("coll1").get();
+    ASSERT_EQ(491, coll1->peek_next_seq_id());
+    ASSERT_EQ(240, coll1->get_num_documents());
+
+    results = coll1->search("fizz", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(80, results["found"].get<size_t>());
+    ASSERT_EQ("54", results["hits"][0]["document"]["id"].get<std::string>());
+
+    collectionManager.set_static_rank_seq_ids(false);
+    collectionManager.drop_collection("coll1");
+}
+
 TEST_F(CollectionManagerTest, ParseSortByClause) {
     std::vector<sort_by> sort_fields;
     bool sort_by_parsed = CollectionManager::parse_sort_by_str("points:desc,loc(24.56,10.45):ASC", sort_fields);
@@ -797,3 +1075,500 @@ TEST_F(CollectionManagerTest, Presets) {
     preset_op = collectionManager.get_preset("preset1", preset);
     ASSERT_TRUE(preset_op.ok());
 }
+
+TEST_F(CollectionManagerTest, TTLFieldExpiry) {
+    nlohmann::json schema = R"({
+        "name": "events",
+        "fields": [
+            {"name": "title", "type": "string"},
+            {"name": "points", "type": "int32"},
+            {"name": "expires_at", "type": "int64"}
+        ],
+        "ttl_field": "points"
+    })"_json;
+
+    auto create_op = collectionManager.create_collection(schema);
+    ASSERT_FALSE(create_op.ok());
+    ASSERT_EQ("`ttl_field` should be the name of an indexed field of type `int64`.", create_op.error());
+
+    schema["ttl_field"] = "expired";
+    create_op = collectionManager.create_collection(schema);
+    ASSERT_FALSE(create_op.ok());
+
+    schema["ttl_field"] = "expires_at";
+    create_op = collectionManager.create_collection(schema);
+    ASSERT_TRUE(create_op.ok());
+
+    Collection* events = create_op.get();
+    ASSERT_EQ("expires_at", events->get_ttl_field());
+    ASSERT_EQ("expires_at", events->get_summary_json()["ttl_field"]);
+    ASSERT_EQ(0, collection1->get_summary_json().count("ttl_field"));
+
+    for(size_t i = 0; i < 10; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Event " + std::to_string(i);
+        doc["points"] = i;
+        doc["expires_at"] = 1000 + i;
+        ASSERT_TRUE(events->add(doc.dump()).ok());
+    }
+
+    // only the collection with a `ttl_field` is swept
+    auto paths = collectionManager.get_expiry_paths(1004, 100);
+    ASSERT_EQ(1, paths.size());
+    ASSERT_EQ("/collections/events/documents?filter_by=expires_at%3A%3C%3D1004&batch_size=100", paths[0]);
+
+    std::vector<std::pair<size_t, uint32_t*>> index_ids;
+    std::string filter_by = StringUtils::url_decode("expires_at%3A%3C%3D1004");
+    ASSERT_TRUE(events->get_filter_ids(filter_by, index_ids).ok());
+    ASSERT_EQ(1, index_ids.size());
+    ASSERT_EQ(5, index_ids[0].first);
+
+    for(auto& kv: index_ids) {
+        delete [] kv.second;
+    }
+
+    // the ttl field cannot be dropped
+    auto alter_payload = R"({"fields": [{"name": "expires_at", "drop": true}]})"_json;
+    auto alter_op = events->alter(alter_payload);
+    ASSERT_FALSE(alter_op.ok());
+    ASSERT_EQ("Field `expires_at` is the `ttl_field` of the collection, so it cannot be dropped.", alter_op.error());
+
+    // restored from the collection meta
+    collectionManager.dispose();
+    delete store;
+
+    store = new Store("/tmp/typesense_test/coll_manager_test_db");
+    collectionManager.init(store, 1.0, "auth_key", quit);
+    collectionManager.load(8, 1000);
+
+    events = collectionManager.get_collection("events").get();
+    ASSERT_NE(nullptr, events);
+    ASSERT_EQ("expires_at", events->get_ttl_field());
+
+    collectionManager.drop_collection("events");
+}
+
+TEST_F(CollectionManagerTest, CompactDocumentEncoding) {
+    nlohmann::json schema = R"({
+        "name": "products",
+        "fields": [
+            {"name": "title", "type": "string"},
+            {"name": "points", "type": "int32"}
+        ],
+        "document_encoding": "bson"
+    })"_json;
+
+    auto create_op = collectionManager.create_collection(schema);
+    ASSERT_FALSE(create_op.ok());
+    ASSERT_EQ("`document_encoding` should be either `json` or `compact`.", create_op.error());
+
+    schema["document_encoding"] = "compact";
+    create_op = collectionManager.create_collection(schema);
+    ASSERT_TRUE(create_op.ok());
+
+    Collection* products = create_op.get();
+    ASSERT_EQ(COMPACT_ENCODING, products->get_document_encoding());
+    ASSERT_EQ("compact", products->get_summary_json()["document_encoding"]);
+
+    for(size_t i = 0; i < 10; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Product " + std::to_string(i);
+        doc["points"] = i;
+        doc["details"] = {{"color", "red"}, {"sizes", {1, 2, 3}}};
+        ASSERT_TRUE(products->add(doc.dump()).ok());
+    }
+
+    // stored without the key strings
+    std::string stored_doc;
+    ASSERT_EQ(StoreStatus::FOUND, store->get(products->get_seq_id_key(3), stored_doc));
+    ASSERT_EQ(std::string::npos, stored_doc.find("title"));
+
+    nlohmann::json document;
+    ASSERT_TRUE(products->get_document_from_store(3, document).ok());
+    ASSERT_EQ("Product 3", document["title"]);
+    ASSERT_EQ("red", document["details"]["color"]);
+
+    // partial updates rewrite the whole document
+    ASSERT_TRUE(products->add(R"({"id": "3", "points": 100})", UPDATE).ok());
+    ASSERT_TRUE(products->get_document_from_store(3, document).ok());
+    ASSERT_EQ(100, document["points"]);
+    ASSERT_EQ("Product 3", document["title"]);
+
+    auto results = products->search("product", {"title"}, "points:>50", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("3", results["hits"][0]["document"]["id"]);
+
+    // the key dictionary is restored along with the collection
+    collectionManager.dispose();
+    delete store;
+
+    store = new Store("/tmp/typesense_test/coll_manager_test_db");
+    collectionManager.init(store, 1.0, "auth_key", quit);
+    collectionManager.load(8, 1000);
+
+    products = collectionManager.get_collection("products").get();
+    ASSERT_NE(nullptr, products);
+    ASSERT_EQ(10, products->get_num_documents());
+    ASSERT_TRUE(products->get_document_from_store(7, document).ok());
+    ASSERT_EQ("Product 7", document["title"]);
+    ASSERT_EQ(std::vector<int>({1, 2, 3}), document["details"]["sizes"].get<std::vector<int>>());
+
+    const std::string document_keys_key = products->get_document_keys_key();
+    ASSERT_TRUE(store->contains(document_keys_key));
+    collectionManager.drop_collection("products");
+    ASSERT_FALSE(store->contains(document_keys_key));
+}
+
+TEST_F(CollectionManagerTest, SummaryFields) {
+    nlohmann::json schema = R"({
+        "name": "articles",
+        "fields": [
+            {"name": "title", "type": "string"},
+            {"name": "body", "type": "string"},
+            {"name": "points", "type": "int32"}
+        ],
+        "summary_fields": "title"
+    })"_json;
+
+    auto create_op = collectionManager.create_collection(schema);
+    ASSERT_FALSE(create_op.ok());
+    ASSERT_EQ("`summary_fields` should be an array of field names.", create_op.error());
+
+    schema["summary_fields"] = {"title", "points"};
+    create_op = collectionManager.create_collection(schema);
+    ASSERT_TRUE(create_op.ok());
+
+    Collection* articles = create_op.get();
+    ASSERT_EQ(std::vector<std::string>({"title", "points"}), articles->get_summary_fields());
+
+    for(size_t i = 0; i < 5; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Article " + std::to_string(i);
+        doc["body"] = std::string(1000, 'x');
+        doc["points"] = i;
+        ASSERT_TRUE(articles->add(doc.dump()).ok());
+    }
+
+    std::string stored_summary;
+    ASSERT_EQ(StoreStatus::FOUND, store->get(articles->get_summary_key(2), stored_summary));
+    ASSERT_EQ(R"({"id":"2","points":2,"title":"Article 2"})", stored_summary);
+
+    // the body is not in the summary, so that it is not even read when only summary fields are included
+    store->insert(articles->get_seq_id_key(2), R"({"id":"2","title":"Stale","body":"x","points":2})");
+
+    spp::sparse_hash_set<std::string> include_fields = {"id", "title"};
+    auto results = articles->search("article", {"title"}, "points:2", {}, {}, {0}, 10, 1, FREQUENCY, {false}, 1,
+                                    include_fields).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ(nlohmann::json::parse(R"({"id":"2","title":"Article 2"})"), results["hits"][0]["document"]);
+    ASSERT_EQ(1, results["hits"][0]["highlights"].size());
+
+    // the whole document is read for the other fields
+    include_fields = {"title", "body"};
+    results = articles->search("article", {"title"}, "points:2", {}, {}, {0}, 10, 1, FREQUENCY, {false}, 1,
+                               include_fields).get();
+    ASSERT_EQ("Stale", results["hits"][0]["document"]["title"]);
+
+    // and for a hit whose summary is missing
+    store->remove(articles->get_summary_key(3));
+    include_fields = {"title"};
+    results = articles->search("article", {"title"}, "points:3", {}, {}, {0}, 10, 1, FREQUENCY, {false}, 1,
+                               include_fields).get();
+    ASSERT_EQ("Article 3", results["hits"][0]["document"]["title"]);
+
+    // updates and removals carry over to the summary
+    ASSERT_TRUE(articles->add(R"({"id": "1", "points": 100})", UPDATE).ok());
+    ASSERT_EQ(StoreStatus::FOUND, store->get(articles->get_summary_key(1), stored_summary));
+    ASSERT_EQ(R"({"id":"1","points":100,"title":"Article 1"})", stored_summary);
+
+    ASSERT_TRUE(articles->remove("1").ok());
+    ASSERT_FALSE(store->contains(articles->get_summary_key(1)));
+
+    collectionManager.drop_collection("articles");
+}
+
+TEST_F(CollectionManagerTest, MemoryQuota) {
+    nlohmann::json schema = R"({
+        "name": "articles",
+        "fields": [
+            {"name": "title", "type": "string"},
+            {"name": "points", "type": "int32"}
+        ],
+        "memory_quota_bytes": 0
+    })"_json;
+
+    auto create_op = collectionManager.create_collection(schema);
+    ASSERT_FALSE(create_op.ok());
+    ASSERT_EQ("`memory_quota_bytes` should be a positive integer.", create_op.error());
+
+    schema["memory_quota_bytes"] = 100000;
+    create_op = collectionManager.create_collection(schema);
+    ASSERT_TRUE(create_op.ok());
+
+    Collection* articles = create_op.get();
+    ASSERT_EQ(100000, articles->get_memory_quota_bytes());
+    ASSERT_EQ(100000, articles->get_summary_json()["memory_quota_bytes"].get<uint64_t>());
+    ASSERT_EQ(0, collectionManager.get_memory_quota_usage("articles"));
+
+    for(size_t i = 0; i < 100; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Article number " + std::to_string(i) + " about " + std::to_string(i * 7919);
+        doc["points"] = i;
+        ASSERT_TRUE(articles->add(doc.dump()).ok());
+    }
+
+    const float usage = collectionManager.get_memory_quota_usage("articles");
+    ASSERT_LT(0, usage);
+
+    // the estimate follows the number of documents
+    const float walked_usage = float(articles->get_memory_stats()["total_bytes"].get<uint64_t>()) / 100000;
+    ASSERT_NEAR(walked_usage, usage, walked_usage * 0.1);
+
+    ASSERT_TRUE(articles->remove("0").ok());
+    ASSERT_GT(usage, collectionManager.get_memory_quota_usage("articles"));
+
+    // the quota is kept along with the collection
+    std::string collection_meta_json;
+    ASSERT_EQ(StoreStatus::FOUND, store->get(Collection::get_meta_key("articles"), collection_meta_json));
+    Collection* loaded = collectionManager.init_collection(nlohmann::json::parse(collection_meta_json), 0, store, 1.0f);
+    ASSERT_EQ(100000, loaded->get_memory_quota_bytes());
+    delete loaded;
+
+    // collections without a quota have no usage
+    ASSERT_EQ(0, collection1->get_memory_quota_usage());
+    ASSERT_EQ(0, collectionManager.get_memory_quota_usage("unknown"));
+
+    collectionManager.drop_collection("articles");
+}
+
+TEST_F(CollectionManagerTest, UnionSearchMergesShards) {
+    std::vector<field> fields = {
+        field("title", field_types::STRING, false),
+        field("genre", field_types::STRING, true),
+        field("points", field_types::INT32, false)
+    };
+
+    std::vector<Collection*> shards;
+    std::vector<std::vector<int32_t>> shard_points = {{10, 30, 50}, {20, 40}};
+
+    for(size_t i = 0; i < shard_points.size(); i++) {
+        shards.push_back(collectionManager.create_collection("shard" + std::to_string(i), 1, fields, "points").get());
+
+        for(int32_t points: shard_points[i]) {
+            nlohmann::json doc;
+            doc["title"] = "Title " + std::to_string(points);
+            doc["genre"] = (points % 20 == 0) ? "drama" : "comedy";
+            doc["points"] = points;
+            ASSERT_TRUE(shards[i]->add(doc.dump()).ok());
+        }
+    }
+
+    std::vector<nlohmann::json> embedded_params_vec(2, nlohmann::json::object());
+    std::vector<std::map<std::string, std::string>> searches_params(2);
+
+    auto set_params = [&](const std::string& page) {
+        for(size_t i = 0; i < searches_params.size(); i++) {
+            searches_params[i].clear();
+            searches_params[i]["collection"] = "shard" + std::to_string(i);
+            searches_params[i]["q"] = "*";
+            searches_params[i]["sort_by"] = "points:desc";
+            searches_params[i]["facet_by"] = "genre";
+            searches_params[i]["per_page"] = "2";
+            searches_params[i]["page"] = page;
+        }
+    };
+
+    set_params("1");
+    std::string json_res;
+    ASSERT_TRUE(CollectionManager::do_union(searches_params, embedded_params_vec, json_res).ok());
+
+    nlohmann::json res_obj = nlohmann::json::parse(json_res);
+    ASSERT_EQ(5, res_obj["found"].get<size_t>());
+    ASSERT_EQ(2, res_obj["hits"].size());
+    ASSERT_EQ(50, res_obj["hits"][0]["document"]["points"].get<int32_t>());
+    ASSERT_EQ(0, res_obj["hits"][0]["search_index"].get<size_t>());
+    ASSERT_EQ(40, res_obj["hits"][1]["document"]["points"].get<int32_t>());
+    ASSERT_EQ(1, res_obj["hits"][1]["search_index"].get<size_t>());
+
+    ASSERT_EQ(1, res_obj["facet_counts"].size());
+    ASSERT_EQ("comedy", res_obj["facet_counts"][0]["counts"][0]["value"].get<std::string>());
+    ASSERT_EQ(3, res_obj["facet_counts"][0]["counts"][0]["count"].get<size_t>());
+    ASSERT_EQ("drama", res_obj["facet_counts"][0]["counts"][1]["value"].get<std::string>());
+    ASSERT_EQ(2, res_obj["facet_counts"][0]["counts"][1]["count"].get<size_t>());
+
+    set_params("2");
+    ASSERT_TRUE(CollectionManager::do_union(searches_params, embedded_params_vec, json_res).ok());
+
+    res_obj = nlohmann::json::parse(json_res);
+    ASSERT_EQ(2, res_obj["hits"].size());
+    ASSERT_EQ(30, res_obj["hits"][0]["document"]["points"].get<int32_t>());
+    ASSERT_EQ(20, res_obj["hits"][1]["document"]["points"].get<int32_t>());
+
+    // shards must be ranked alike
+    set_params("1");
+    searches_params[1]["sort_by"] = "points:asc";
+    auto union_op = CollectionManager::do_union(searches_params, embedded_params_vec, json_res);
+    ASSERT_FALSE(union_op.ok());
+    ASSERT_EQ(400, union_op.code());
+
+    collectionManager.drop_collection("shard0");
+    collectionManager.drop_collection("shard1");
+}
+
+TEST_F(CollectionManagerTest, UnionSearchOverFetchesFacetValues) {
+    std::vector<field> fields = {
+        field("genre", field_types::STRING, true),
+        field("points", field_types::INT32, false)
+    };
+
+    // "drama" is second in both shards but first when merged
+    std::vector<std::vector<std::string>> shard_genres = {
+        {"comedy", "comedy", "comedy", "drama", "drama"},
+        {"thriller", "thriller", "thriller", "drama", "drama"}
+    };
+
+    std::vector<nlohmann::json> embedded_params_vec(2, nlohmann::json::object());
+    std::vector<std::map<std::string, std::string>> searches_params(2);
+
+    for(size_t i = 0; i < shard_genres.size(); i++) {
+        const std::string shard_name = "shard" + std::to_string(i);
+        Collection* shard = collectionManager.create_collection(shard_name, 1, fields, "points").get();
+
+        for(const auto& genre: shard_genres[i]) {
+            nlohmann::json doc;
+            doc["genre"] = genre;
+            doc["points"] = 1;
+            ASSERT_TRUE(shard->add(doc.dump()).ok());
+        }
+
+        searches_params[i]["collection"] = shard_name;
+        searches_params[i]["q"] = "*";
+        searches_params[i]["facet_by"] = "genre";
+        searches_params[i]["max_facet_values"] = "1";
+    }
+
+    std::string json_res;
+    ASSERT_TRUE(CollectionManager::do_union(searches_params, embedded_params_vec, json_res).ok());
+
+    nlohmann::json res_obj = nlohmann::json::parse(json_res);
+    ASSERT_EQ(1, res_obj["facet_counts"][0]["counts"].size());
+    ASSERT_EQ("drama", res_obj["facet_counts"][0]["counts"][0]["value"].get<std::string>());
+    ASSERT_EQ(4, res_obj["facet_counts"][0]["counts"][0]["count"].get<size_t>());
+
+    collectionManager.drop_collection("shard0");
+    collectionManager.drop_collection("shard1");
+}
+
+TEST_F(CollectionManagerTest, WriteGenerationChangesWithSearchResults) {
+    uint64_t write_generation = collection1->get_write_generation();
+
+    nlohmann::json doc;
+    doc["id"] = "0";
+    doc["title"] = "The Martian";
+    doc["starring"] = "Matt Damon";
+    doc["cast"] = {"Matt Damon"};
+    doc["points"] = 10;
+    doc["location"] = {45.0, 7.0};
+    doc["not_stored"] = "foo";
+    ASSERT_TRUE(collection1->add(doc.dump()).ok());
+
+    ASSERT_NE(write_generation, collection1->get_write_generation());
+    write_generation = collection1->get_write_generation();
+
+    // reads leave it as is
+    ASSERT_TRUE(collection1->search("martian", {"title"}, "", {}, sort_fields, {0}, 10).ok());
+    ASSERT_EQ(write_generation, collection1->get_write_generation());
+
+    synonym_t synonym("id1", {"mars"}, {{"martian"}});
+    ASSERT_TRUE(collection1->add_synonym(synonym).ok());
+    ASSERT_NE(write_generation, collection1->get_write_generation());
+    write_generation = collection1->get_write_generation();
+
+    ASSERT_TRUE(collection1->remove("0").ok());
+    ASSERT_NE(write_generation, collection1->get_write_generation());
+
+    // a collection created in place of a dropped one starts off a generation of its own
+    write_generation = collection1->get_write_generation();
+    collectionManager.drop_collection("collection1");
+    collection1 = collectionManager.create_collection("collection1", 4, search_fields, "points").get();
+    ASSERT_NE(write_generation, collection1->get_write_generation());
+}
+
+TEST_F(CollectionManagerTest, DumpAndRestoreCollection) {
+    std::vector<std::string> titles = {"The Martian", "Mars Attacks", "Red Planet"};
+
+    for(size_t i = 0; i < titles.size(); i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = titles[i];
+        doc["starring"] = "Matt Damon";
+        doc["cast"] = {"Matt Damon"};
+        doc["points"] = int32_t(i);
+        doc["location"] = {45.0, 7.0};
+        doc["not_stored"] = "foo";
+        ASSERT_TRUE(collection1->add(doc.dump()).ok());
+    }
+
+    ASSERT_TRUE(collection1->remove("1").ok());
+
+    nlohmann::json override_json = {
+        {"id", "exclude-rule"},
+        {"rule", {{"query", "planet"}, {"match", override_t::MATCH_EXACT}}}
+    };
+    override_json["excludes"] = nlohmann::json::array();
+    override_json["excludes"][0] = nlohmann::json::object();
+    override_json["excludes"][0]["id"] = "2";
+
+    override_t override;
+    ASSERT_TRUE(override_t::parse(override_json, "", override).ok());
+    collection1->add_override(override);
+
+    synonym_t synonym("syn1", {"mars"}, {{"martian"}});
+    ASSERT_TRUE(collection1->add_synonym(synonym).ok());
+
+    const std::string dump_path = "/tmp/typesense_test/collection1.dump";
+    ASSERT_TRUE(collectionManager.dump_collection("collection1", dump_path).ok());
+    ASSERT_EQ(404, collectionManager.dump_collection("unknown", dump_path).code());
+
+    auto restore_op = collectionManager.restore_collection("collection2", dump_path);
+    ASSERT_TRUE(restore_op.ok());
+
+    Collection* collection2 = restore_op.get();
+    ASSERT_NE(collection1->get_collection_id(), collection2->get_collection_id());
+    ASSERT_EQ(collection1->get_num_documents(), collection2->get_num_documents());
+    ASSERT_EQ(collection1->peek_next_seq_id(), collection2->peek_next_seq_id());
+    ASSERT_EQ(1, collection2->get_overrides().size());
+    ASSERT_EQ(1, collection2->get_synonyms().size());
+
+    auto results = collection2->search("mars", {"title"}, "", {}, sort_fields, {0}, 10).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+    ASSERT_EQ("0", results["hits"][0]["document"]["id"].get<std::string>());
+
+    results = collection2->search("planet", {"title"}, "", {}, sort_fields, {0}, 10).get();
+    ASSERT_EQ(0, results["found"].get<size_t>());
+
+    auto doc_op = collection2->get("2");
+    ASSERT_TRUE(doc_op.ok());
+    ASSERT_EQ("Red Planet", doc_op.get()["title"].get<std::string>());
+    ASSERT_FALSE(collection2->get("1").ok());
+
+    // the restored collection is not tied to the one it was dumped off
+    collectionManager.drop_collection("collection1");
+    collection1 = nullptr;
+
+    results = collection2->search("martian", {"title"}, "", {}, sort_fields, {0}, 10).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+
+    ASSERT_EQ(409, collectionManager.restore_collection("collection2", dump_path).code());
+
+    std::ofstream garbage_out("/tmp/typesense_test/garbage.dump");
+    garbage_out << "garbage";
+    garbage_out.close();
+    ASSERT_EQ(400, collectionManager.restore_collection("collection3", "/tmp/typesense_test/garbage.dump").code());
+
+    collectionManager.drop_collection("collection2");
+}
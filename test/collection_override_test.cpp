@@ -2199,3 +2199,82 @@ TEST_F(CollectionOverrideTest, DynamicFilteringWithPartialTokenMatch) {
 
     collectionManager.drop_collection("coll1");
 }
+
+TEST_F(CollectionOverrideTest, DynamicFilteringResolutionFollowsWrites) {
+    Collection *coll1;
+
+    std::vector<field> fields = {field("name", field_types::STRING, false),
+                                 field("brand", field_types::STRING, true),
+                                 field("points", field_types::INT32, false)};
+
+    coll1 = collectionManager.get_collection("coll1").get();
+    if(coll1 == nullptr) {
+        coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+    }
+
+    nlohmann::json doc;
+    doc["id"] = "0";
+    doc["name"] = "Amazing Shoes";
+    doc["brand"] = "Nike";
+    doc["points"] = 3;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    doc["id"] = "1";
+    doc["name"] = "Track Shoes";
+    doc["brand"] = "Puma";
+    doc["points"] = 5;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    nlohmann::json override_json = {
+            {"id",   "dynamic-brand-filter"},
+            {
+             "rule", {
+                         {"query", "{brand} shoes"},
+                         {"match", override_t::MATCH_EXACT}
+                     }
+            },
+            {"remove_matched_tokens", true},
+            {"filter_by", "brand: {brand}"}
+    };
+
+    override_t override;
+    ASSERT_TRUE(override_t::parse(override_json, "dynamic-brand-filter", override).ok());
+    coll1->add_override(override);
+
+    std::vector<sort_by> sort_fields = { sort_by("_text_match", "DESC"), sort_by("points", "DESC") };
+
+    // the same resolution is had when the query comes again
+    for(size_t i = 0; i < 2; i++) {
+        auto results = coll1->search("nike shoes", {"name", "brand"}, "",
+                                     {}, sort_fields, {0, 0}, 10, 1, FREQUENCY, {false}, 10).get();
+        ASSERT_EQ(1, results["hits"].size());
+        ASSERT_EQ("0", results["hits"][0]["document"]["id"].get<std::string>());
+    }
+
+    // no document has the brand yet, so the placeholder is not bound and the query falls back to "shoes"
+    auto results = coll1->search("adidas shoes", {"name", "brand"}, "",
+                                 {}, sort_fields, {0, 0}, 10, 1, FREQUENCY, {false}, 10).get();
+    ASSERT_EQ(2, results["hits"].size());
+
+    doc["id"] = "2";
+    doc["name"] = "Running Shoes";
+    doc["brand"] = "Adidas";
+    doc["points"] = 1;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    results = coll1->search("adidas shoes", {"name", "brand"}, "",
+                            {}, sort_fields, {0, 0}, 10, 1, FREQUENCY, {false}, 10).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("2", results["hits"][0]["document"]["id"].get<std::string>());
+
+    // nor does the filter outlive the documents it was bound to
+    ASSERT_TRUE(coll1->remove("0").ok());
+
+    results = coll1->search("nike shoes", {"name", "brand"}, "",
+                            {}, sort_fields, {0, 0}, 10, 1, FREQUENCY, {false}, 10).get();
+    ASSERT_EQ(2, results["hits"].size());
+    ASSERT_EQ("1", results["hits"][0]["document"]["id"].get<std::string>());
+    ASSERT_EQ("2", results["hits"][1]["document"]["id"].get<std::string>());
+
+    collectionManager.drop_collection("coll1");
+}
@@ -3,6 +3,7 @@
 #include <vector>
 #include <fstream>
 #include <algorithm>
+#include <thread>
 #include <collection_manager.h>
 #include "collection.h"
 
@@ -983,3 +984,88 @@ TEST_F(CollectionSchemaChangeTest, ChangeFromStringStarToAutoField) {
     ASSERT_EQ(2, coll1->get_fields().size());
     ASSERT_EQ(1, coll1->get_dynamic_fields().size());
 }
+
+TEST_F(CollectionSchemaChangeTest, AlterWhileWritingAndSearching) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    auto make_doc = [](size_t i, const std::string& category) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Document number " + std::to_string(i);
+        doc["category"] = category;
+        doc["points"] = int32_t(i);
+        return doc.dump();
+    };
+
+    std::vector<std::string> records;
+    for(size_t i = 0; i < 2000; i++) {
+        records.push_back(make_doc(i, "stored"));
+    }
+
+    nlohmann::json document;
+    ASSERT_TRUE(coll1->add_many(records, document)["success"].get<bool>());
+
+    // documents get added, updated and removed while the alter builds its index, which has to catch up with them
+    std::atomic<bool> altered = false;
+    std::atomic<size_t> num_search_errors = 0;
+
+    std::thread writer([&]() {
+        for(size_t i = 2000; i < 2500; i++) {
+            coll1->add(make_doc(i, "written"));
+        }
+
+        for(size_t i = 0; i < 100; i++) {
+            coll1->add(make_doc(i, "updated"), UPSERT);
+        }
+
+        for(size_t i = 100; i < 200; i++) {
+            coll1->remove(std::to_string(i));
+        }
+    });
+
+    std::thread searcher([&]() {
+        while(!altered) {
+            auto res_op = coll1->search("document", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false});
+            if(!res_op.ok()) {
+                num_search_errors++;
+            }
+        }
+    });
+
+    auto schema_changes = R"({
+        "fields": [
+            {"name": "category", "type": "string", "facet": true}
+        ]
+    })"_json;
+
+    auto alter_op = coll1->alter(schema_changes);
+    altered = true;
+
+    writer.join();
+    searcher.join();
+
+    ASSERT_TRUE(alter_op.ok());
+    ASSERT_EQ(0, num_search_errors.load());
+
+    auto results = coll1->search("*", {}, "", {"category"}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(2400, results["found"].get<size_t>());
+
+    std::map<std::string, size_t> category_counts;
+    for(const auto& count: results["facet_counts"][0]["counts"]) {
+        category_counts[count["value"].get<std::string>()] = count["count"].get<size_t>();
+    }
+
+    ASSERT_EQ(3, category_counts.size());
+    ASSERT_EQ(1800, category_counts["stored"]);
+    ASSERT_EQ(500, category_counts["written"]);
+    ASSERT_EQ(100, category_counts["updated"]);
+
+    results = coll1->search("*", {}, "category:=written", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(500, results["found"].get<size_t>());
+
+    results = coll1->search("updated", {"category"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(100, results["found"].get<size_t>());
+}
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <collection_manager.h>
 #include "collection.h"
+#include "config.h"
 
 class CollectionSpecificMoreTest : public ::testing::Test {
 protected:
@@ -723,3 +724,770 @@ TEST_F(CollectionSpecificMoreTest, OrderWithThreeSortFields) {
 
     collectionManager.drop_collection("coll1");
 }
+
+TEST_F(CollectionSpecificMoreTest, ExplainQueryPlan) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields).get();
+
+    std::vector<std::string> titles = {"the quick fox", "the lazy dog", "the quick dog", "the end"};
+
+    for(size_t i = 0; i < titles.size(); i++) {
+        nlohmann::json doc;
+        doc["title"] = titles[i];
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto results = coll1->search("the quick", {"title"},
+                                 "", {}, {}, {0}, 10,
+                                 1, FREQUENCY, {false}, 0).get();
+
+    ASSERT_EQ(2, results["hits"].size());
+    ASSERT_EQ(0, results.count("explain"));
+
+    results = coll1->search("the quick", {"title"},
+                            "", {}, {}, {0}, 10, 1, FREQUENCY, {false}, 0,
+                            spp::sparse_hash_set<std::string>(),
+                            spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                            "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7, fallback,
+                            4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, true).get();
+
+    ASSERT_EQ(2, results["hits"].size());
+    ASSERT_EQ(1, results["explain"]["num_suggestions"].get<size_t>());
+
+    const auto& step = results["explain"]["suggestions"][0];
+    ASSERT_EQ(std::vector<std::string>({"the", "quick"}), step["tokens"].get<std::vector<std::string>>());
+    ASSERT_EQ(std::vector<uint32_t>({4, 2}), step["token_num_ids"].get<std::vector<uint32_t>>());
+
+    // rarest token is intersected first
+    ASSERT_EQ(std::vector<uint32_t>({1, 0}), step["intersection_order"].get<std::vector<uint32_t>>());
+    ASSERT_EQ(2, step["estimated_num_ids"].get<uint32_t>());
+    ASSERT_EQ(2, step["num_found"].get<size_t>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, CachedPrefixLookupsSeeWrites) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields).get();
+
+    std::vector<std::string> titles = {"apple pie", "application form"};
+
+    for(size_t i = 0; i < titles.size(); i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = titles[i];
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // repeated lookups are served from the cache
+    for(size_t i = 0; i < 2; i++) {
+        auto results = coll1->search("app", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+        ASSERT_EQ(2, results["hits"].size());
+    }
+
+    nlohmann::json doc;
+    doc["id"] = "2";
+    doc["title"] = "apply now";
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    auto results = coll1->search("app", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(3, results["hits"].size());
+
+    ASSERT_TRUE(coll1->remove("0").ok());
+
+    results = coll1->search("app", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(2, results["hits"].size());
+
+    results = coll1->search("apple", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, DisposedRequestStopsSearch) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields).get();
+
+    nlohmann::json doc;
+    doc["title"] = "the quick fox";
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    std::atomic<bool> req_disposed(false);
+
+    auto results = coll1->search("quick", {"title"},
+                                 "", {}, {}, {0}, 10, 1, FREQUENCY, {false}, 0,
+                                 spp::sparse_hash_set<std::string>(),
+                                 spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                                 "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                                 fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                                 &req_disposed).get();
+
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ(1, results["hits"][0]["highlights"].size());
+    ASSERT_FALSE(results["search_cutoff"].get<bool>());
+
+    // client went away: the search stops at its first check
+    req_disposed = true;
+
+    results = coll1->search("quick", {"title"},
+                            "", {}, {}, {0}, 10, 1, FREQUENCY, {false}, 0,
+                            spp::sparse_hash_set<std::string>(),
+                            spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                            "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                            fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                            &req_disposed).get();
+
+    ASSERT_EQ(0, results["hits"].size());
+    ASSERT_TRUE(results["search_cutoff"].get<bool>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, MultiFieldSearchAcrossSeqIdRanges) {
+    std::vector<field> fields = {field("points", field_types::INT32, false)};
+    std::vector<std::string> query_by;
+
+    for(size_t i = 0; i < 6; i++) {
+        fields.emplace_back("title" + std::to_string(i), field_types::STRING, false);
+        query_by.push_back("title" + std::to_string(i));
+    }
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    // enough candidates across the fields for them to be scored in multiple seq_id ranges
+    std::vector<std::string> json_lines;
+
+    for(size_t i = 0; i < 2000; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["points"] = i;
+
+        for(size_t j = 0; j < 6; j++) {
+            doc["title" + std::to_string(j)] = "alpha beta";
+        }
+
+        json_lines.push_back(doc.dump());
+    }
+
+    nlohmann::json insert_doc;
+    coll1->add_many(json_lines, insert_doc);
+
+    std::vector<sort_by> sort_fields = {sort_by("points", "DESC")};
+
+    auto results = coll1->search("alpha beta", query_by, "", {}, sort_fields, {0}, 10, 1, FREQUENCY, {false}).get();
+
+    ASSERT_EQ(2000, results["found"].get<size_t>());
+    ASSERT_EQ(10, results["hits"].size());
+    for(size_t i = 0; i < 10; i++) {
+        ASSERT_EQ(std::to_string(1999 - i), results["hits"][i]["document"]["id"].get<std::string>());
+    }
+
+    sort_fields = {sort_by("points", "ASC")};
+
+    results = coll1->search("alpha beta", query_by, "points:>=500", {}, sort_fields, {0}, 10, 1, FREQUENCY,
+                            {false}).get();
+
+    ASSERT_EQ(1500, results["found"].get<size_t>());
+    for(size_t i = 0; i < 10; i++) {
+        ASSERT_EQ(std::to_string(500 + i), results["hits"][i]["document"]["id"].get<std::string>());
+    }
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, SearchAfterCursor) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 25; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "document " + std::to_string(i);
+        doc["points"] = i % 10;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto expected = coll1->search("*", {}, "", {}, {}, {0}, 25, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(25, expected["hits"].size());
+
+    // walking the pages with the cursor yields the same hits as a single page
+    std::vector<std::string> ids;
+    std::string search_after;
+
+    for(size_t i = 0; i < 4; i++) {
+        auto results = coll1->search("*", {}, "", {}, {}, {0}, 7, 1, FREQUENCY, {false}, 0,
+                                     spp::sparse_hash_set<std::string>(),
+                                     spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                                     "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                                     fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                                     nullptr, search_after).get();
+
+        ASSERT_EQ(25, results["found"].get<size_t>());
+
+        for(const auto& hit: results["hits"]) {
+            ids.push_back(hit["document"]["id"].get<std::string>());
+        }
+
+        if(results.count("search_after") == 0) {
+            // the last page is not full
+            ASSERT_EQ(3, i);
+            ASSERT_EQ(4, results["hits"].size());
+            break;
+        }
+
+        search_after = results["search_after"].get<std::string>();
+    }
+
+    ASSERT_EQ(25, ids.size());
+    for(size_t i = 0; i < ids.size(); i++) {
+        ASSERT_EQ(expected["hits"][i]["document"]["id"].get<std::string>(), ids[i]);
+    }
+
+    auto res_op = coll1->search("*", {}, "", {}, {}, {0}, 7, 2, FREQUENCY, {false}, 0,
+                                spp::sparse_hash_set<std::string>(),
+                                spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                                "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                                fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                                nullptr, search_after);
+    ASSERT_FALSE(res_op.ok());
+    ASSERT_EQ("Parameter `page` can't be used along with `search_after`.", res_op.error());
+
+    res_op = coll1->search("*", {}, "", {}, {}, {0}, 7, 1, FREQUENCY, {false}, 0,
+                           spp::sparse_hash_set<std::string>(),
+                           spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                           "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                           fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                           nullptr, "1,2,x,4");
+    ASSERT_FALSE(res_op.ok());
+    ASSERT_EQ("Parameter `search_after` is malformed.", res_op.error());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, FilteredLookupsShareCachedCandidates) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    std::vector<std::string> titles = {"apple pie", "application form", "apply now", "apricot jam"};
+
+    for(size_t i = 0; i < titles.size(); i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = titles[i];
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // fills the cache, whose candidates the filtered searches then narrow down
+    auto results = coll1->search("app", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(3, results["hits"].size());
+
+    results = coll1->search("app", {"title"}, "points: >= 1", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(2, results["hits"].size());
+
+    std::set<std::string> ids = {results["hits"][0]["document"]["id"].get<std::string>(),
+                                 results["hits"][1]["document"]["id"].get<std::string>()};
+    ASSERT_EQ(std::set<std::string>({"1", "2"}), ids);
+
+    results = coll1->search("app", {"title"}, "points: 0", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("0", results["hits"][0]["document"]["id"].get<std::string>());
+
+    results = coll1->search("app", {"title"}, "points: 3", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, FallbackRoundsReuseIntersections) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    std::vector<std::string> titles = {"quick brown fox", "quick brown foxes", "quick brown four",
+                                       "quick brown dog", "quick red fox"};
+
+    for(size_t i = 0; i < titles.size(); i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = titles[i];
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // every candidate of the last token is intersected with the same tokens before it
+    auto results = coll1->search("quick brown fo", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(3, results["found"].get<size_t>());
+
+    results = coll1->search("quick brown fo", {"title"}, "points: >= 1", {}, {}, {0}, 10, 1, FREQUENCY,
+                            {true}, 0).get();
+    ASSERT_EQ(2, results["found"].get<size_t>());
+    ASSERT_EQ("2", results["hits"][0]["document"]["id"].get<std::string>());
+    ASSERT_EQ("1", results["hits"][1]["document"]["id"].get<std::string>());
+
+    // the rounds that drop tokens come back to the tokens of the earlier rounds
+    results = coll1->search("quick brown zzz", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}, 10).get();
+    ASSERT_EQ(5, results["found"].get<size_t>());
+    ASSERT_EQ("4", results["hits"].back()["document"]["id"].get<std::string>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, ExactMatchesByTokenCount) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    std::vector<std::string> titles = {"quick brown fox", "quick brown", "brown quick", "quick", "quick quick"};
+
+    for(size_t i = 0; i < titles.size(); i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = titles[i];
+        doc["points"] = 100 - i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto results = coll1->search("quick", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(5, results["found"].get<size_t>());
+    ASSERT_EQ("3", results["hits"][0]["document"]["id"].get<std::string>());
+
+    results = coll1->search("quick brown", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(3, results["found"].get<size_t>());
+    ASSERT_EQ("1", results["hits"][0]["document"]["id"].get<std::string>());
+
+    results = coll1->search("*", {}, "title:= quick brown", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+    ASSERT_EQ("1", results["hits"][0]["document"]["id"].get<std::string>());
+
+    // the count goes with the document as it is updated or removed
+    nlohmann::json doc;
+    doc["id"] = "1";
+    doc["title"] = "quick brown bear";
+    doc["points"] = 99;
+    ASSERT_TRUE(coll1->add(doc.dump(), UPSERT).ok());
+
+    results = coll1->search("*", {}, "title:= quick brown", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(0, results["found"].get<size_t>());
+
+    results = coll1->search("*", {}, "title:= quick brown bear", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+
+    ASSERT_TRUE(coll1->remove("3").ok());
+
+    results = coll1->search("*", {}, "title:= quick", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(0, results["found"].get<size_t>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, WildcardSortReadsTopValues) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),
+                                 field("score", field_types::FLOAT, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 3000; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "title " + std::to_string(i);
+        doc["points"] = i % 500;
+        doc["score"] = float(i) / 10;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // default sort
+    auto results = coll1->search("*", {}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(3000, results["found"].get<size_t>());
+
+    for(size_t i = 0; i < 6; i++) {
+        ASSERT_EQ(499, results["hits"][i]["document"]["points"].get<int32_t>());
+    }
+
+    ASSERT_EQ(498, results["hits"][6]["document"]["points"].get<int32_t>());
+
+    // ties on the first field are broken by the next one
+    std::vector<sort_by> sort_fields = {sort_by("points", "ASC"), sort_by("score", "DESC")};
+    results = coll1->search("*", {}, "", {}, sort_fields, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(3000, results["found"].get<size_t>());
+    ASSERT_EQ("2500", results["hits"][0]["document"]["id"].get<std::string>());
+    ASSERT_EQ("2000", results["hits"][1]["document"]["id"].get<std::string>());
+    ASSERT_EQ("1001", results["hits"][9]["document"]["id"].get<std::string>());
+
+    sort_fields = {sort_by("score", "DESC")};
+    results = coll1->search("*", {}, "points:>= 100", {}, sort_fields, {0}, 10, 3, FREQUENCY, {false}).get();
+    ASSERT_EQ(2400, results["found"].get<size_t>());
+    ASSERT_EQ("2979", results["hits"][0]["document"]["id"].get<std::string>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, CachedFiltersSeeWritesAndAlters) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields).get();
+
+    for(size_t i = 0; i < 3; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Title " + std::to_string(i);
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // repeated filters are served from the cache
+    for(size_t i = 0; i < 2; i++) {
+        auto results = coll1->search("*", {}, "points: >= 1", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+        ASSERT_EQ(2, results["found"].get<size_t>());
+    }
+
+    auto results = coll1->search("*", {}, "id: 1", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+
+    // the id is looked up again once it belongs to another document
+    ASSERT_TRUE(coll1->remove("1").ok());
+
+    nlohmann::json doc;
+    doc["id"] = "1";
+    doc["title"] = "Title 1 again";
+    doc["points"] = 1;
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    results = coll1->search("*", {}, "id: 1", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+    ASSERT_EQ("Title 1 again", results["hits"][0]["document"]["title"].get<std::string>());
+
+    // a dropped field can no longer be filtered on
+    nlohmann::json alter_payload = R"({"fields": [{"name": "points", "drop": true}]})"_json;
+    ASSERT_TRUE(coll1->alter(alter_payload).ok());
+
+    auto results_op = coll1->search("*", {}, "points: >= 1", {}, {}, {0}, 10, 1, FREQUENCY, {true}, 0);
+    ASSERT_FALSE(results_op.ok());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, VectorQuery) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("vec", field_types::FLOAT_ARRAY, false),};
+    fields[1].num_dim = 4;
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields).get();
+
+    std::vector<std::vector<float>> vectors = {{0.9, 0.1, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0},
+                                               {0.7, 0.7, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}};
+
+    for(size_t i = 0; i < vectors.size(); i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i % 2 == 0) ? "red shoe" : "blue shoe";
+        doc["vec"] = vectors[i];
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto search_vector = [&](const std::string& q, const std::string& filter,
+                             const std::string& vector_query) {
+        return coll1->search(q, {"title"}, filter, {}, {}, {0}, 10, 1, FREQUENCY, {false}, 0,
+                             spp::sparse_hash_set<std::string>(),
+                             spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                             "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                             fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                             nullptr, "", 100, 0, vector_query);
+    };
+
+    // wildcard query: the nearest vectors, closest first
+    auto results = search_vector("*", "", "vec:([1.0, 0.0, 0.0, 0.0], k: 2)").get();
+    ASSERT_EQ(2, results["found"].get<size_t>());
+    ASSERT_EQ("0", results["hits"][0]["document"]["id"].get<std::string>());
+    ASSERT_EQ("2", results["hits"][1]["document"]["id"].get<std::string>());
+    ASSERT_LT(results["hits"][0]["vector_distance"].get<float>(), results["hits"][1]["vector_distance"].get<float>());
+
+    // filtered ids are left out
+    results = search_vector("*", "id: [1, 2]", "vec:([1.0, 0.0, 0.0, 0.0], k: 2)").get();
+    ASSERT_EQ(2, results["found"].get<size_t>());
+    ASSERT_EQ("2", results["hits"][0]["document"]["id"].get<std::string>());
+    ASSERT_EQ("1", results["hits"][1]["document"]["id"].get<std::string>());
+
+    // hybrid query: text hits and vector hits are fused
+    results = search_vector("blue", "", "vec:([0.0, 0.0, 1.0, 0.0], k: 1, alpha: 0.9)").get();
+    ASSERT_EQ(2, results["found"].get<size_t>());
+    ASSERT_EQ("3", results["hits"][0]["document"]["id"].get<std::string>());
+    ASSERT_EQ("1", results["hits"][1]["document"]["id"].get<std::string>());
+
+    // errors
+    auto res_op = search_vector("*", "", "vec:([1.0, 0.0], k: 2)");
+    ASSERT_FALSE(res_op.ok());
+
+    res_op = search_vector("*", "", "title:([1.0, 0.0, 0.0, 0.0])");
+    ASSERT_FALSE(res_op.ok());
+
+    res_op = search_vector("*", "", "vec:[1.0, 0.0, 0.0, 0.0]");
+    ASSERT_FALSE(res_op.ok());
+    ASSERT_EQ("Parameter `vector_query` is malformed.", res_op.error());
+
+    nlohmann::json doc;
+    doc["id"] = "4";
+    doc["title"] = "green shoe";
+    doc["vec"] = std::vector<float>{1.0, 0.0};
+    auto add_op = coll1->add(doc.dump());
+    ASSERT_FALSE(add_op.ok());
+    ASSERT_EQ("Field `vec` must have 4 dimensions.", add_op.error());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, SearchProfile) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, true),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields).get();
+
+    for(size_t i = 0; i < 10; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "running shoe " + std::to_string(i);
+        doc["points"] = i % 3;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto results = coll1->search("running shoe", {"title"}, "points: >= 1", {"points"}, {}, {0}, 10, 1, FREQUENCY,
+                                 {false}, 0, spp::sparse_hash_set<std::string>(),
+                                 spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                                 "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                                 fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                                 nullptr, "", 100, 0, "", true).get();
+
+    ASSERT_EQ(6, results["hits"].size());
+    ASSERT_EQ(1, results.count("profile"));
+
+    const auto& profile = results["profile"];
+    ASSERT_EQ(6, profile["stages_ms"].size());
+    ASSERT_LT(0, profile["stages_ms"]["highlight"].get<double>());
+    ASSERT_LT(0, profile["counters"]["candidates_generated"].get<uint64_t>());
+    ASSERT_LE(6, profile["counters"]["ids_intersected"].get<uint64_t>());
+    ASSERT_LT(0, profile["counters"]["blocks_decompressed"].get<uint64_t>());
+
+    // documents are read from the store only once, and from the cache afterwards
+    ASSERT_GE(6, profile["counters"]["store_reads"].get<uint64_t>());
+
+    // not profiled by default
+    results = coll1->search("running shoe", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(0, results.count("profile"));
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, MemoryStats) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("brand", field_types::STRING, true),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    auto memory_stats = coll1->get_memory_stats();
+    const size_t empty_bytes = memory_stats["total_bytes"].get<size_t>();
+
+    // facet shards are only allocated once a document lands in them
+    ASSERT_EQ(0, memory_stats["fields"]["brand"]["facet_index_v3"].get<size_t>());
+
+    for(size_t i = 0; i < 100; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "running shoe number " + std::to_string(i);
+        doc["brand"] = "brand " + std::to_string(i % 5);
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    memory_stats = coll1->get_memory_stats();
+    ASSERT_LT(empty_bytes, memory_stats["total_bytes"].get<size_t>());
+
+    const auto& title_stats = memory_stats["fields"]["title"];
+    ASSERT_LT(0, title_stats["search_index"].get<size_t>());
+    ASSERT_LT(0, title_stats["token_count_index"].get<size_t>());
+    ASSERT_EQ(title_stats["search_index"].get<size_t>() + title_stats["token_count_index"].get<size_t>(),
+              title_stats["total_bytes"].get<size_t>());
+
+    const auto& brand_stats = memory_stats["fields"]["brand"];
+    ASSERT_LT(0, brand_stats["facet_index_v3"].get<size_t>());
+
+    const auto& points_stats = memory_stats["fields"]["points"];
+    ASSERT_LT(0, points_stats["numerical_index"].get<size_t>());
+    ASSERT_LT(0, points_stats["sort_index"].get<size_t>());
+
+    // per structure totals add up to the total
+    size_t structure_bytes = 0;
+    for(const auto& structure: memory_stats["structures"].items()) {
+        structure_bytes += structure.value().get<size_t>();
+    }
+
+    ASSERT_EQ(memory_stats["total_bytes"].get<size_t>(), structure_bytes);
+    ASSERT_LT(0, memory_stats["structures"]["seq_ids"].get<size_t>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, ApproximateFoundSkipsBlocks) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields).get();
+
+    // the exact matches fill the topster, so that the blocks of the other matches can be skipped
+    for(size_t i = 0; i < 3000; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i < 300) ? "hello" : "bar hello";
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto search = [&](bool exhaustive_found) {
+        return coll1->search("hello", {"title"}, "", {}, {}, {0}, 10, 1, FREQUENCY,
+                             {false}, 0, spp::sparse_hash_set<std::string>(),
+                             spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                             "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                             fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                             nullptr, "", 100, 0, "", false, exhaustive_found).get();
+    };
+
+    auto results = search(true);
+    ASSERT_EQ(3000, results["found"].get<size_t>());
+    ASSERT_EQ(0, results.count("found_is_estimate"));
+
+    auto approximate_results = search(false);
+    ASSERT_TRUE(approximate_results["found_is_estimate"].get<bool>());
+
+    // a single token has all of its skipped ids match
+    ASSERT_EQ(3000, approximate_results["found"].get<size_t>());
+
+    ASSERT_EQ(10, approximate_results["hits"].size());
+    for(size_t i = 0; i < results["hits"].size(); i++) {
+        ASSERT_EQ(results["hits"][i]["document"]["id"], approximate_results["hits"][i]["document"]["id"]);
+    }
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificMoreTest, SharedVocabularyMatchesPerFieldExpansion) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("brand", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    std::vector<std::vector<std::string>> records = {
+        {"Running shoes", "Nike"},
+        {"Trail running shoes", "Salomon"},
+        {"Nikon camera body", "Nikon"},
+        {"Camera bag for trails", "Lowepro"},
+    };
+
+    Config::get_instance().set_shared_vocabulary(true);
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+    Config::get_instance().set_shared_vocabulary(false);
+
+    Collection* coll2 = collectionManager.create_collection("coll2", 1, fields, "points").get();
+
+    for(size_t i = 0; i < records.size(); i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = records[i][0];
+        doc["brand"] = records[i][1];
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+        ASSERT_TRUE(coll2->add(doc.dump()).ok());
+    }
+
+    auto search = [](Collection* coll, const std::string& q, const std::string& filter) {
+        return coll->search(q, {"title", "brand"}, filter, {}, {}, {2}, 10, 1, FREQUENCY, {true}, 0).get();
+    };
+
+    auto get_ids = [](const nlohmann::json& results) {
+        std::vector<std::string> ids;
+        for(const auto& hit: results["hits"]) {
+            ids.push_back(hit["document"]["id"].get<std::string>());
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    std::vector<std::string> queries = {"nikr", "nik", "runing shoes", "camra", "sal", "trail", "lowepro camera"};
+
+    for(const auto& q: queries) {
+        auto results = search(coll1, q, "");
+        auto expected_results = search(coll2, q, "");
+        ASSERT_EQ(expected_results["found"].get<size_t>(), results["found"].get<size_t>()) << q;
+        ASSERT_EQ(get_ids(expected_results), get_ids(results)) << q;
+
+        results = search(coll1, q, "points:>0");
+        expected_results = search(coll2, q, "points:>0");
+        ASSERT_EQ(get_ids(expected_results), get_ids(results)) << q;
+    }
+
+    // tokens go away from the vocabulary along with the last document of the field that has them
+    ASSERT_TRUE(coll1->remove("1").ok());
+
+    auto results = search(coll1, "salomon", "");
+    ASSERT_EQ(0, results["found"].get<size_t>());
+
+    results = search(coll1, "trail", "");
+    ASSERT_EQ(1, results["found"].get<size_t>());
+    ASSERT_EQ("3", results["hits"][0]["document"]["id"].get<std::string>());
+
+    collectionManager.drop_collection("coll1");
+    collectionManager.drop_collection("coll2");
+}
+
+TEST_F(CollectionSpecificMoreTest, LatencyBudgetReportsDegradations) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields).get();
+
+    for(size_t i = 0; i < 10; i++) {
+        nlohmann::json doc;
+        doc["title"] = "running shoes " + std::to_string(i);
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    auto search = [&](size_t latency_budget_ms) {
+        return coll1->search("runing", {"title"}, "", {}, {}, {2}, 10, 1, FREQUENCY,
+                             {false}, 0, spp::sparse_hash_set<std::string>(),
+                             spp::sparse_hash_set<std::string>(), 10, "", 30, 4, "", 20, {}, {}, {}, 0,
+                             "<mark>", "</mark>", {}, 1000, true, false, true, "", false, 6000 * 1000, 4, 7,
+                             fallback, 4, {off}, INT16_MAX, INT16_MAX, 2, 2, false, false, false,
+                             nullptr, "", 100, 0, "", false, true, latency_budget_ms).get();
+    };
+
+    auto results = search(0);
+    ASSERT_EQ(10, results["found"].get<size_t>());
+    ASSERT_EQ(0, results.count("search_degradations"));
+
+    // a search well within its budget gives up on nothing
+    results = search(60 * 1000);
+    ASSERT_EQ(10, results["found"].get<size_t>());
+    ASSERT_TRUE(results["search_degradations"].is_array());
+    ASSERT_TRUE(results["search_degradations"].empty());
+
+    // shares of the budget are told apart off the beginning of the search
+    search_budget_ms = 100;
+    search_begin = std::chrono::high_resolution_clock::now() - std::chrono::milliseconds(60);
+    ASSERT_TRUE(search_budget_spent(0.5));
+    ASSERT_FALSE(search_budget_spent(0.9));
+
+    search_budget_ms = 0;
+    ASSERT_FALSE(search_budget_spent(0));
+
+    collectionManager.drop_collection("coll1");
+}
@@ -2916,3 +2916,115 @@ TEST_F(CollectionSpecificTest, DontHighlightPunctuation) {
     collectionManager.drop_collection("coll1");
 }
 
+
+TEST_F(CollectionSpecificTest, HitsReflectWritesToCachedDocuments) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    nlohmann::json doc1;
+    doc1["id"] = "0";
+    doc1["title"] = "The Quick Brown Fox";
+    doc1["points"] = 100;
+
+    ASSERT_TRUE(coll1->add(doc1.dump()).ok());
+
+    // first search caches the document, the second one is served from the cache
+    for(size_t i = 0; i < 2; i++) {
+        auto results = coll1->search("fox", {"title"}, "", {}, {}, {0}, 3, 1, FREQUENCY, {true}, 5).get();
+        ASSERT_EQ(1, results["hits"].size());
+        ASSERT_EQ(100, results["hits"][0]["document"]["points"].get<int32_t>());
+    }
+
+    doc1["points"] = 200;
+    ASSERT_TRUE(coll1->add(doc1.dump(), UPSERT).ok());
+
+    auto results = coll1->search("fox", {"title"}, "", {}, {}, {0}, 3, 1, FREQUENCY, {true}, 5).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ(200, results["hits"][0]["document"]["points"].get<int32_t>());
+
+    ASSERT_TRUE(coll1->remove("0").ok());
+
+    results = coll1->search("fox", {"title"}, "", {}, {}, {0}, 3, 1, FREQUENCY, {true}, 5).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificTest, ImportLinesParsedAheadOfBatches) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    // spans 3 parse windows: a bad line in the second, and repeated ids both within and across windows
+    std::vector<std::string> json_lines;
+
+    for(size_t i = 0; i < 2500; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Title " + std::to_string(i);
+        doc["points"] = int32_t(i);
+        json_lines.push_back(doc.dump());
+    }
+
+    json_lines[1500] = "{\"id\": \"1500\", \"title\": ";
+    json_lines[1999] = R"({"id": "1998", "title": "Title 1998", "points": 5000})";
+    json_lines[2000] = R"({"id": "5", "title": "Title 5", "points": 6000})";
+
+    nlohmann::json document;
+    nlohmann::json import_response = coll1->add_many(json_lines, document, UPSERT);
+    ASSERT_FALSE(import_response["success"].get<bool>());
+    ASSERT_EQ(2499, import_response["num_imported"].get<int>());
+
+    nlohmann::json bad_line_response = nlohmann::json::parse(json_lines[1500]);
+    ASSERT_FALSE(bad_line_response["success"].get<bool>());
+    ASSERT_EQ(400, bad_line_response["code"].get<size_t>());
+    ASSERT_EQ(0, bad_line_response["error"].get<std::string>().find("Bad JSON: "));
+
+    ASSERT_TRUE(nlohmann::json::parse(json_lines[1999])["success"].get<bool>());
+    ASSERT_TRUE(nlohmann::json::parse(json_lines[2499])["success"].get<bool>());
+
+    ASSERT_EQ(2497, coll1->get_num_documents());
+    ASSERT_EQ(5000, coll1->get("1998").get()["points"].get<int32_t>());
+    ASSERT_EQ(6000, coll1->get("5").get()["points"].get<int32_t>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionSpecificTest, BulkLoadIngestsNewDocuments) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+    ASSERT_TRUE(coll1->add(R"({"id": "0", "title": "Existing", "points": 1})").ok());
+
+    // a new document, an update of a stored one, and one that does not index
+    std::vector<std::string> json_lines = {
+        R"({"id": "1", "title": "Bulk loaded", "points": 2})",
+        R"({"id": "0", "title": "Updated", "points": 3})",
+        R"({"id": "2", "title": "Bad points", "points": "x"})",
+    };
+
+    nlohmann::json document;
+    nlohmann::json import_response = coll1->add_many(json_lines, document, UPSERT, "",
+                                                     DIRTY_VALUES::REJECT, false, false, true);
+    ASSERT_FALSE(import_response["success"].get<bool>());
+    ASSERT_EQ(2, import_response["num_imported"].get<int>());
+
+    ASSERT_TRUE(nlohmann::json::parse(json_lines[0])["success"].get<bool>());
+    ASSERT_TRUE(nlohmann::json::parse(json_lines[1])["success"].get<bool>());
+    ASSERT_FALSE(nlohmann::json::parse(json_lines[2])["success"].get<bool>());
+
+    ASSERT_EQ(2, coll1->get_num_documents());
+    ASSERT_EQ("Bulk loaded", coll1->get("1").get()["title"].get<std::string>());
+    ASSERT_EQ("Updated", coll1->get("0").get()["title"].get<std::string>());
+    ASSERT_FALSE(coll1->get("2").ok());
+
+    auto results = coll1->search("bulk", {"title"}, "", {}, {}, {0}).get();
+    ASSERT_EQ(1, results["found"].get<size_t>());
+    ASSERT_EQ("1", results["hits"][0]["document"]["id"].get<std::string>());
+
+    collectionManager.drop_collection("coll1");
+}
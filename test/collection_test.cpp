@@ -1909,13 +1909,15 @@ TEST_F(CollectionTest, DeletionOfADocument) {
     results = collection_for_del->search("cryogenic", query_fields, "", {}, sort_fields, {0}, 5, 1, FREQUENCY, {false}).get();
     ASSERT_EQ(1, results["hits"].size());
 
-    it = store->get_iterator();
     num_keys = 0;
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        num_keys += 1;
+    for(size_t cf = 0; cf < Store::NUM_COLUMN_FAMILIES; cf++) {
+        it = store->get_iterator(Store::column_family_t(cf));
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            num_keys += 1;
+        }
+        delete it;
     }
     ASSERT_EQ(25+25+3, num_keys);  // 25 records, 25 id mapping, 3 meta keys
-    delete it;
 
     // actually remove a record now
     collection_for_del->remove("1");
@@ -1940,12 +1942,14 @@ TEST_F(CollectionTest, DeletionOfADocument) {
 
     ASSERT_EQ(0, collection_for_del->get_num_documents());
 
-    it = store->get_iterator();
     num_keys = 0;
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        num_keys += 1;
+    for(size_t cf = 0; cf < Store::NUM_COLUMN_FAMILIES; cf++) {
+        it = store->get_iterator(Store::column_family_t(cf));
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            num_keys += 1;
+        }
+        delete it;
     }
-    delete it;
     ASSERT_EQ(3, num_keys);
 
     collectionManager.drop_collection("collection_for_del");
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "compact_list_arena.h"
+#include "posting.h"
+#include "ids_t.h"
+
+TEST(CompactListArenaTest, ReusesReleasedSlots) {
+    CompactListArena& arena = CompactListArena::get_instance();
+    const size_t num_allocations = arena.num_allocations();
+
+    void* a = arena.allocate(20);
+    void* b = arena.allocate(20);
+    ASSERT_NE(a, b);
+    ASSERT_EQ(num_allocations + 2, arena.num_allocations());
+
+    arena.release(a, 20);
+    ASSERT_EQ(num_allocations + 1, arena.num_allocations());
+
+    // same size class
+    void* c = arena.allocate(32);
+    ASSERT_EQ(a, c);
+
+    // growth within a size class happens in place
+    ASSERT_EQ(c, arena.reallocate(c, 32, 28));
+
+    memset(b, 7, 20);
+    void* d = arena.reallocate(b, 20, 100);
+    ASSERT_NE(b, d);
+    ASSERT_EQ(7, ((uint8_t*) d)[19]);
+
+    // larger requests bypass the slabs
+    const size_t reserved_bytes = arena.reserved_bytes();
+    void* e = arena.allocate(CompactListArena::MAX_SLOT_BYTES + 1);
+    ASSERT_EQ(reserved_bytes + CompactListArena::MAX_SLOT_BYTES + 1, arena.reserved_bytes());
+
+    arena.release(c, 28);
+    arena.release(d, 100);
+    arena.release(e, CompactListArena::MAX_SLOT_BYTES + 1);
+
+    ASSERT_EQ(num_allocations, arena.num_allocations());
+    ASSERT_EQ(reserved_bytes, arena.reserved_bytes());
+}
+
+TEST(CompactListArenaTest, CompactListsAreReleasedToArena) {
+    CompactListArena& arena = CompactListArena::get_instance();
+    const size_t allocated_bytes = arena.allocated_bytes();
+
+    void* postings = nullptr;
+    void* ids = SET_COMPACT_IDS(compact_id_list_t::create(1, {10}));
+
+    uint32_t posting_ids[] = {1};
+    uint32_t offset_index[] = {0};
+    uint32_t offsets[] = {1, 2};
+    postings = SET_COMPACT_POSTING(compact_posting_list_t::create(1, posting_ids, offset_index, 2, offsets));
+
+    for(uint32_t id = 2; id < 12; id++) {
+        posting_t::upsert(postings, id, {1});
+        ids_t::upsert(ids, id + 10);
+    }
+
+    ASSERT_TRUE(IS_COMPACT_POSTING(postings));
+    ASSERT_TRUE(IS_COMPACT_IDS(ids));
+    ASSERT_LT(allocated_bytes, arena.allocated_bytes());
+
+    // erasing shrinks the lists within the arena
+    for(uint32_t id = 2; id < 12; id++) {
+        posting_t::erase(postings, id);
+        ids_t::erase(ids, id + 10);
+    }
+
+    ASSERT_EQ(1, posting_t::num_ids(postings));
+    ASSERT_EQ(1, ids_t::num_ids(ids));
+
+    posting_t::destroy_list(postings);
+    ids_t::destroy_list(ids);
+
+    ASSERT_EQ(allocated_bytes, arena.allocated_bytes());
+}
+
+TEST(CompactListArenaTest, MapsSlabsToFile) {
+    CompactListArena& arena = CompactListArena::get_instance();
+    ASSERT_FALSE(arena.map_slabs("/tmp/typesense_test/no_such_dir"));
+
+    system("mkdir -p /tmp/typesense_test/arena");
+    ASSERT_TRUE(arena.map_slabs("/tmp/typesense_test/arena"));
+    ASSERT_EQ(0, arena.mapped_bytes());
+
+    // more than a slab worth of the largest size class, which needs new slabs
+    std::vector<void*> ptrs;
+    for(size_t i = 0; i < 2 * CompactListArena::SLAB_BYTES / CompactListArena::MAX_SLOT_BYTES; i++) {
+        void* ptr = arena.allocate(CompactListArena::MAX_SLOT_BYTES);
+        memset(ptr, i % 256, CompactListArena::MAX_SLOT_BYTES);
+        ptrs.push_back(ptr);
+    }
+
+    ASSERT_EQ(CompactListArena::MAPPED_EXTENT_BYTES, arena.mapped_bytes());
+
+    for(size_t i = 0; i < ptrs.size(); i++) {
+        ASSERT_EQ(i % 256, ((uint8_t*) ptrs[i])[CompactListArena::MAX_SLOT_BYTES - 1]);
+        arena.release(ptrs[i], CompactListArena::MAX_SLOT_BYTES);
+    }
+
+    // the file is unlinked right away
+    ASSERT_EQ(0, system("test -z \"$(ls /tmp/typesense_test/arena)\""));
+}
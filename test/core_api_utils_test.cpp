@@ -4,6 +4,7 @@
 #include <collection_manager.h>
 #include <core_api.h>
 #include "core_api_utils.h"
+#include "response_cache.h"
 
 class CoreAPIUtilsTest : public ::testing::Test {
 protected:
@@ -177,6 +178,82 @@ TEST_F(CoreAPIUtilsTest, StatefulRemoveDocs) {
     collectionManager.drop_collection("coll1");
 }
 
+TEST_F(CoreAPIUtilsTest, StatefulRemoveDocsErasesTokensOfBatch) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("tags", field_types::STRING_ARRAY, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 20; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Title " + std::to_string(i);
+        doc["tags"] = {(i % 2 == 0) ? "even" : "odd", "shared"};
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    bool done;
+    deletion_state_t deletion_state;
+    deletion_state.collection = coll1;
+    deletion_state.num_removed = 0;
+
+    // odd ids are not contiguous, and one more than the batch is matched
+    coll1->get_filter_ids("tags: odd && points: < 12", deletion_state.index_ids);
+    for(size_t i = 0; i < deletion_state.index_ids.size(); i++) {
+        deletion_state.offsets.push_back(0);
+    }
+
+    stateful_remove_docs(&deletion_state, 5, done);
+    ASSERT_EQ(5, deletion_state.num_removed);
+    ASSERT_FALSE(done);
+
+    stateful_remove_docs(&deletion_state, 5, done);
+    ASSERT_EQ(6, deletion_state.num_removed);
+    ASSERT_TRUE(done);
+
+    for(auto& kv: deletion_state.index_ids) {
+        delete [] kv.second;
+    }
+    deletion_state.index_ids.clear();
+    deletion_state.offsets.clear();
+    deletion_state.num_removed = 0;
+
+    // ids 12 to 16 are contiguous
+    coll1->get_filter_ids("points: [12..16]", deletion_state.index_ids);
+    for(size_t i = 0; i < deletion_state.index_ids.size(); i++) {
+        deletion_state.offsets.push_back(0);
+    }
+
+    stateful_remove_docs(&deletion_state, 10, done);
+    ASSERT_EQ(5, deletion_state.num_removed);
+    ASSERT_TRUE(done);
+
+    for(auto& kv: deletion_state.index_ids) {
+        delete [] kv.second;
+    }
+
+    ASSERT_EQ(9, coll1->get_num_documents());
+    ASSERT_FALSE(coll1->get("3").ok());
+    ASSERT_FALSE(coll1->get("14").ok());
+    ASSERT_TRUE(coll1->get("17").ok());
+
+    auto results = coll1->search("shared", {"tags"}, "", {}, {}, {0}, 20, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(9, results["found"].get<size_t>());
+
+    results = coll1->search("odd", {"tags"}, "", {}, {}, {0}, 20, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(2, results["found"].get<size_t>());
+
+    results = coll1->search("14", {"title"}, "", {}, {}, {0}, 20, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(0, results["found"].get<size_t>());
+
+    results = coll1->search("*", {}, "points: < 20", {}, {}, {0}, 20, 1, FREQUENCY, {false}).get();
+    ASSERT_EQ(9, results["found"].get<size_t>());
+
+    collectionManager.drop_collection("coll1");
+}
+
 TEST_F(CoreAPIUtilsTest, MultiSearchEmbeddedKeys) {
     std::shared_ptr<http_req> req = std::make_shared<http_req>();
     std::shared_ptr<http_res> res = std::make_shared<http_res>(nullptr);
@@ -530,9 +607,303 @@ TEST_F(CoreAPIUtilsTest, ExportWithFilter) {
     stateful_export_docs(&export_state, 2, done);
     ASSERT_FALSE(done);
     ASSERT_EQ('\n', export_state.res_body->back());
+    ASSERT_EQ("{\"id\":\"0\",\"points\":0,\"title\":\"Title 0\"}\n"
+              "{\"id\":\"1\",\"points\":1,\"title\":\"Title 1\"}\n", *export_state.res_body);
 
     // should not have trailing newline character for the last line
     stateful_export_docs(&export_state, 2, done);
     ASSERT_TRUE(done);
     ASSERT_EQ('}', export_state.res_body->back());
+
+    // documents are read in batches, and the ones that cannot be read are left discarded
+    std::vector<uint32_t> seq_ids = {3, 1, 100};
+    std::vector<nlohmann::json> docs;
+    coll1->get_documents_from_store(seq_ids.data(), seq_ids.size(), docs);
+    ASSERT_EQ(3, docs.size());
+    ASSERT_EQ("3", docs[0]["id"].get<std::string>());
+    ASSERT_EQ("1", docs[1]["id"].get<std::string>());
+    ASSERT_TRUE(docs[2].is_discarded());
+}
+
+TEST_F(CoreAPIUtilsTest, ExportInRanges) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i=0; i<10; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Title " + std::to_string(i);
+        doc["points"] = i;
+        coll1->add(doc.dump());
+    }
+
+    // a single range gives the documents in order
+    std::string res_body;
+    bool done;
+
+    export_state_t export_state;
+    export_state.collection = coll1;
+    export_state.res_body = &res_body;
+    export_state.include_fields = {"id"};
+    init_export_ranges(&export_state, store, 1);
+    ASSERT_EQ(1, export_state.ranges.size());
+
+    stateful_export_docs(&export_state, 6, done);
+    ASSERT_FALSE(done);
+    ASSERT_EQ("{\"id\":\"0\"}\n{\"id\":\"1\"}\n{\"id\":\"2\"}\n{\"id\":\"3\"}\n{\"id\":\"4\"}\n{\"id\":\"5\"}\n",
+              res_body);
+
+    stateful_export_docs(&export_state, 6, done);
+    ASSERT_TRUE(done);
+    ASSERT_EQ("{\"id\":\"6\"}\n{\"id\":\"7\"}\n{\"id\":\"8\"}\n{\"id\":\"9\"}", res_body);
+
+    // ranges read in parallel give every document once
+    export_state_t parallel_export_state;
+    parallel_export_state.collection = coll1;
+    parallel_export_state.res_body = &res_body;
+    init_export_ranges(&parallel_export_state, store, 3);
+    ASSERT_EQ(3, parallel_export_state.ranges.size());
+
+    std::string exported;
+    done = false;
+
+    while(!done) {
+        stateful_export_docs(&parallel_export_state, 4, done);
+        exported += res_body;
+    }
+
+    std::vector<std::string> lines;
+    StringUtils::split(exported, lines, "\n");
+    ASSERT_EQ(10, lines.size());
+
+    std::set<std::string> ids;
+    for(const auto& line: lines) {
+        ids.insert(nlohmann::json::parse(line)["id"].get<std::string>());
+    }
+
+    ASSERT_EQ(10, ids.size());
+
+    // more ranges than documents
+    export_state_t empty_export_state;
+    empty_export_state.collection = collectionManager.create_collection("coll2", 1, fields, "points").get();
+    empty_export_state.res_body = &res_body;
+    init_export_ranges(&empty_export_state, store, 4);
+    ASSERT_EQ(1, empty_export_state.ranges.size());
+
+    stateful_export_docs(&empty_export_state, 4, done);
+    ASSERT_TRUE(done);
+    ASSERT_TRUE(res_body.empty());
+}
+
+TEST_F(CoreAPIUtilsTest, ImportHoldsBackPartialRecordOfChunk) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    std::shared_ptr<http_req> req = std::make_shared<http_req>();
+    std::shared_ptr<http_res> res = std::make_shared<http_res>(nullptr);
+    req->params["collection"] = "coll1";
+
+    // chunk ends in the middle of a record
+    req->body = "{\"id\": \"0\", \"title\": \"Foo\", \"points\": 10}\n{\"id\": \"1\", \"title\": \"Bar  ";
+    req->last_chunk_aggregate = false;
+
+    ASSERT_TRUE(post_import_documents(req, res));
+    ASSERT_EQ("{\"success\":true}\n", res->body);
+    ASSERT_EQ("{\"id\": \"1\", \"title\": \"Bar  ", req->body);
+
+    // chunk ends with a whole record that is not followed by a newline
+    req->body += "Baz\", \"points\": 20}\n{\"id\": \"2\", \"title\": \"Qux\", \"points\": 30}";
+
+    ASSERT_TRUE(post_import_documents(req, res));
+    ASSERT_EQ("{\"success\":true}\n{\"success\":true}\n", res->body);
+    ASSERT_TRUE(req->body.empty());
+
+    req->body = "{\"id\": \"3\", \"title\": \"Quux\", \"points\": 40}";
+    req->last_chunk_aggregate = true;
+
+    ASSERT_TRUE(post_import_documents(req, res));
+    ASSERT_EQ("{\"success\":true}", res->body);
+
+    ASSERT_EQ(4, coll1->get_num_documents());
+    ASSERT_EQ("Bar  Baz", coll1->get("1").get()["title"].get<std::string>());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CoreAPIUtilsTest, IdenticalSearchesShareOneFlight) {
+    std::shared_ptr<http_res> leader_res = std::make_shared<http_res>(nullptr);
+    std::shared_ptr<http_res> follower_res = std::make_shared<http_res>(nullptr);
+    std::shared_ptr<http_res> other_res = std::make_shared<http_res>(nullptr);
+
+    auto leader_flight = std::make_unique<search_flight_t>(42, leader_res);
+    ASSERT_FALSE(leader_flight->join());
+
+    // a different search runs on its own
+    {
+        search_flight_t other_flight(43, other_res);
+        ASSERT_FALSE(other_flight.join());
+    }
+
+    // joins the running search and waits for it
+    auto follower_flight = std::make_unique<search_flight_t>(42, follower_res);
+    std::thread follower_thread([&follower_flight]() {
+        ASSERT_TRUE(follower_flight->join());
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    leader_res->set_200("{\"found\": 1}");
+    leader_flight.reset();
+    follower_thread.join();
+
+    ASSERT_EQ(200, follower_res->status_code);
+    ASSERT_EQ("{\"found\": 1}", follower_res->body);
+
+    // the flight is over, so the next search of the hash runs again
+    std::shared_ptr<http_res> next_res = std::make_shared<http_res>(nullptr);
+    search_flight_t next_flight(42, next_res);
+    ASSERT_FALSE(next_flight.join());
+}
+
+TEST_F(CoreAPIUtilsTest, MultiSearchRunsSearchesConcurrently) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 10; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Title " + std::to_string(i);
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    nlohmann::json body;
+    body["searches"] = nlohmann::json::array();
+
+    for(size_t i = 0; i < 6; i++) {
+        nlohmann::json search;
+        search["collection"] = (i == 3) ? "unknown" : "coll1";
+        search["q"] = std::to_string(i);
+        search["query_by"] = "title";
+        body["searches"].push_back(search);
+    }
+
+    std::shared_ptr<http_req> req = std::make_shared<http_req>();
+    std::shared_ptr<http_res> res = std::make_shared<http_res>(nullptr);
+
+    req->params["multi_search_concurrency"] = "3";
+    req->params["use_cache"] = "true";
+    req->body = body.dump();
+    req->embedded_params_vec = std::vector<nlohmann::json>(6, nlohmann::json::object());
+
+    ASSERT_TRUE(post_multi_search(req, res));
+
+    // results are in the order of the searches, whichever finished first
+    nlohmann::json results = nlohmann::json::parse(res->body)["results"];
+    ASSERT_EQ(6, results.size());
+
+    for(size_t i = 0; i < 6; i++) {
+        if(i == 3) {
+            ASSERT_EQ(404, results[i]["code"].get<size_t>());
+            continue;
+        }
+
+        ASSERT_EQ(1, results[i]["found"].get<size_t>());
+        ASSERT_EQ(std::to_string(i), results[i]["hits"][0]["document"]["id"].get<std::string>());
+    }
+
+    // another multi search sharing a search finds it cached on its own
+    body["searches"] = nlohmann::json::array({body["searches"][2]});
+
+    std::shared_ptr<http_req> other_req = std::make_shared<http_req>();
+    std::shared_ptr<http_res> other_res = std::make_shared<http_res>(nullptr);
+    other_req->params["use_cache"] = "true";
+    other_req->body = body.dump();
+    other_req->embedded_params_vec.push_back(nlohmann::json::object());
+
+    const uint64_t num_hits = ResponseCache::get_instance().get_num_hits();
+    ASSERT_TRUE(post_multi_search(other_req, other_res));
+    ASSERT_EQ(num_hits + 1, ResponseCache::get_instance().get_num_hits());
+    ASSERT_EQ(results[2], nlohmann::json::parse(other_res->body)["results"][0]);
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CoreAPIUtilsTest, MessagePackSearchAndExport) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),};
+
+    Collection* coll1 = collectionManager.create_collection("coll1", 1, fields, "points").get();
+
+    for(size_t i = 0; i < 3; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Title " + std::to_string(i);
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // more searches than fit the short form of an array's header
+    nlohmann::json body;
+    body["searches"] = nlohmann::json::array();
+
+    for(size_t i = 0; i < 17; i++) {
+        nlohmann::json search;
+        search["collection"] = (i == 5) ? "unknown" : "coll1";
+        search["q"] = std::to_string(i % 3);
+        search["query_by"] = "title";
+        body["searches"].push_back(search);
+    }
+
+    std::shared_ptr<http_req> req = std::make_shared<http_req>();
+    std::shared_ptr<http_res> res = std::make_shared<http_res>(nullptr);
+
+    req->params[http_req::RESPONSE_FORMAT] = http_req::MSGPACK_FORMAT;
+    req->body = body.dump();
+    req->embedded_params_vec = std::vector<nlohmann::json>(17, nlohmann::json::object());
+
+    ASSERT_TRUE(post_multi_search(req, res));
+    ASSERT_EQ(http_req::MSGPACK_CONTENT_TYPE, res->content_type_header);
+
+    nlohmann::json results = nlohmann::json::from_msgpack(res->body)["results"];
+    ASSERT_EQ(17, results.size());
+    ASSERT_EQ(404, results[5]["code"].get<size_t>());
+    ASSERT_EQ(1, results[16]["found"].get<size_t>());
+    ASSERT_EQ("1", results[16]["hits"][0]["document"]["id"].get<std::string>());
+
+    // documents are exported as a stream of maps
+    bool done;
+    std::string res_body;
+
+    export_state_t export_state;
+    coll1->get_filter_ids("points:>=0", export_state.index_ids);
+    for(size_t i = 0; i < export_state.index_ids.size(); i++) {
+        export_state.offsets.push_back(0);
+    }
+
+    export_state.collection = coll1;
+    export_state.res_body = &res_body;
+    export_state.is_msgpack = true;
+    export_state.exclude_fields = {"points"};
+
+    stateful_export_docs(&export_state, 3, done);
+    ASSERT_TRUE(done);
+
+    std::string expected_body;
+    for(size_t i = 0; i < 3; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Title " + std::to_string(i);
+        const std::vector<uint8_t>& doc_msgpack = nlohmann::json::to_msgpack(doc);
+        expected_body.append(doc_msgpack.begin(), doc_msgpack.end());
+    }
+
+    ASSERT_EQ(expected_body, res_body);
+
+    collectionManager.drop_collection("coll1");
 }
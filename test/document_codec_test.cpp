@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "document_codec.h"
+
+TEST(DocumentCodecTest, CompactRoundTrip) {
+    document_codec_t codec(COMPACT_ENCODING);
+    std::string persisted_keys;
+    auto persist_keys = [&persisted_keys](const std::string& keys) {
+        persisted_keys = keys;
+        return true;
+    };
+
+    auto document = R"({"id": "1", "title": "Foo", "points": -10, "rating": 4.5, "in_stock": true,
+                        "tags": ["a", "b"], "details": {"color": "red", "sizes": [1, 2]}})"_json;
+
+    std::string value;
+    ASSERT_TRUE(codec.encode(document, value, persist_keys));
+    ASSERT_LT(value.size(), document.dump().size());
+    ASSERT_EQ(std::string::npos, value.find("title"));
+    ASSERT_EQ(R"(["details","id","in_stock","points","rating","tags","title"])", persisted_keys);
+
+    nlohmann::json decoded;
+    ASSERT_TRUE(codec.decode(value, decoded));
+    ASSERT_EQ(document, decoded);
+
+    // a known set of keys is not persisted again
+    persisted_keys.clear();
+    document["title"] = "Bar";
+    ASSERT_TRUE(codec.encode(document, value, persist_keys));
+    ASSERT_TRUE(persisted_keys.empty());
+
+    // decoded by a codec loaded off the persisted dictionary
+    document_codec_t loaded_codec(COMPACT_ENCODING);
+    ASSERT_TRUE(loaded_codec.load_keys(codec.serialize_keys()));
+    ASSERT_TRUE(loaded_codec.decode(value, decoded));
+    ASSERT_EQ(document, decoded);
+
+    // documents stored as JSON are still read
+    ASSERT_TRUE(codec.decode(document.dump(), decoded));
+    ASSERT_EQ(document, decoded);
+
+    ASSERT_FALSE(codec.decode(std::string("\x01garbage"), decoded));
+    ASSERT_TRUE(decoded.is_discarded());
+}
+
+TEST(DocumentCodecTest, FailedPersistLeavesDictionary) {
+    document_codec_t codec(COMPACT_ENCODING);
+    std::string value;
+    ASSERT_TRUE(codec.encode(R"({"id": "1"})"_json, value, [](const std::string&) { return true; }));
+
+    ASSERT_FALSE(codec.encode(R"({"id": "2", "title": "Foo"})"_json, value,
+                              [](const std::string&) { return false; }));
+    ASSERT_EQ(R"(["id"])", codec.serialize_keys());
+}
+
+TEST(DocumentCodecTest, JsonEncoding) {
+    document_codec_t codec;
+    auto document = R"({"id": "1", "title": "Foo"})"_json;
+
+    std::string value;
+    ASSERT_TRUE(codec.encode(document, value, [](const std::string&) { return false; }));
+    ASSERT_EQ(document.dump(), value);
+
+    document_encoding_t encoding;
+    ASSERT_TRUE(document_codec_t::parse("compact", encoding));
+    ASSERT_EQ(COMPACT_ENCODING, encoding);
+    ASSERT_FALSE(document_codec_t::parse("bson", encoding));
+    ASSERT_EQ("json", document_codec_t::name(JSON_ENCODING));
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "facet_column.h"
+
+TEST(FacetColumnTest, SetEraseAndCount) {
+    facet_column_t column;
+    ASSERT_EQ(0, column.num_values());
+
+    // ids 0..999 cycle through 3 values, with every 10th id left without one
+    const uint64_t hashes[3] = {1000, 2000, 3000};
+    for(uint32_t id = 0; id < 1000; id++) {
+        if(id % 10 != 0) {
+            column.set(id, hashes[id % 3]);
+        }
+    }
+
+    ASSERT_EQ(3, column.num_values());
+    ASSERT_EQ(900, column.size());
+
+    // an update replaces the value, while an erased id no longer counts
+    column.set(1, hashes[0]);
+    column.erase(2);
+    column.erase(10);
+    column.erase(5000);
+    ASSERT_EQ(899, column.size());
+
+    std::vector<uint32_t> ids;
+    for(uint32_t id = 0; id < 1000; id += 2) {
+        ids.push_back(id);
+    }
+
+    // ids beyond the column have no value
+    ids.push_back(2000);
+
+    std::vector<uint32_t> counts(column.num_values(), 0);
+    std::vector<uint32_t> last_ids(column.num_values(), 0);
+    column.count(ids.data(), ids.size(), counts.data(), last_ids.data());
+
+    std::vector<uint32_t> expected_counts(3, 0);
+    std::vector<uint32_t> expected_last_ids(3, 0);
+    for(uint32_t id: ids) {
+        if(id >= 1000 || id % 10 == 0 || id == 2) {
+            continue;
+        }
+
+        const uint64_t hash = (id == 1) ? hashes[0] : hashes[id % 3];
+        for(uint32_t ordinal = 0; ordinal < 3; ordinal++) {
+            if(column.get_hash(ordinal) == hash) {
+                expected_counts[ordinal]++;
+                expected_last_ids[ordinal] = id;
+            }
+        }
+    }
+
+    ASSERT_EQ(expected_counts, counts);
+    ASSERT_EQ(expected_last_ids, last_ids);
+
+    // counts add up over calls
+    column.count(ids.data(), ids.size(), counts.data(), last_ids.data());
+    for(size_t i = 0; i < counts.size(); i++) {
+        ASSERT_EQ(expected_counts[i] * 2, counts[i]);
+    }
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "facet_value_index.h"
+
+TEST(FacetValueIndexTest, InsertRemoveAndSearch) {
+    facet_value_index_t index;
+
+    index.insert(1, "Country Punk Rock", {"country", "punk", "rock"});
+    index.insert(2, "Soft Rock", {"soft", "rock"});
+    index.insert(3, "Rockabilly", {"rockabilly"});
+    index.insert(4, "Punk", {"punk"});
+
+    // same hash: the value is the one last indexed, while the tokens stay as they are
+    index.insert(4, "PUNK", {});
+    ASSERT_EQ(4, index.size());
+
+    std::string value;
+    ASSERT_TRUE(index.get_value(4, value));
+    ASSERT_EQ("PUNK", value);
+    ASSERT_FALSE(index.get_value(5, value));
+
+    std::unordered_map<uint64_t, std::vector<std::string>> hash_tokens;
+    index.search({"roc"}, hash_tokens);
+    ASSERT_EQ(3, hash_tokens.size());
+    ASSERT_EQ(std::vector<std::string>({"rock"}), hash_tokens[1]);
+    ASSERT_EQ(std::vector<std::string>({"rockabilly"}), hash_tokens[3]);
+
+    hash_tokens.clear();
+    index.search({"punk", "ro"}, hash_tokens);
+    ASSERT_EQ(1, hash_tokens.size());
+    ASSERT_EQ(std::vector<std::string>({"punk", "rock"}), hash_tokens[1]);
+
+    hash_tokens.clear();
+    index.search({"jazz", "ro"}, hash_tokens);
+    ASSERT_TRUE(hash_tokens.empty());
+
+    // a value goes away with its last occurrence
+    index.remove(4);
+    ASSERT_TRUE(index.contains(4));
+    index.remove(4);
+    ASSERT_FALSE(index.contains(4));
+
+    index.remove(1);
+    hash_tokens.clear();
+    index.search({"pun"}, hash_tokens);
+    ASSERT_TRUE(hash_tokens.empty());
+
+    hash_tokens.clear();
+    index.search({"rock"}, hash_tokens);
+    ASSERT_EQ(2, hash_tokens.size());
+    ASSERT_EQ(1, hash_tokens.count(2));
+    ASSERT_EQ(1, hash_tokens.count(3));
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include "filter_iterator.h"
+#include "posting_list.h"
+
+static std::vector<uint32_t> get_ids(filter_iterator_t& it) {
+    std::vector<uint32_t> ids;
+    while(it.valid()) {
+        ids.push_back(it.id());
+        it.next();
+    }
+
+    return ids;
+}
+
+TEST(FilterIteratorTest, LeavesAndNodes) {
+    std::vector<uint32_t> ids1 = {1, 3, 5, 7, 9, 100, 200};
+    std::vector<uint32_t> ids2 = {2, 3, 4, 7, 100, 150};
+    std::vector<uint32_t> dense_ids;
+    for(uint32_t id = 0; id < 300; id++) {
+        if(id % 3 != 2) {
+            dense_ids.push_back(id);
+        }
+    }
+
+    auto bitmap = std::make_shared<const id_bitmap_t>(dense_ids.data(), dense_ids.size());
+    ASSERT_TRUE(bitmap->is_bitmap());
+
+    auto it = filter_iterator_t::new_ids_iterator(ids1.data(), ids1.size(), false);
+    ASSERT_EQ(ids1, get_ids(it));
+
+    it = filter_iterator_t::new_bitmap_iterator(bitmap);
+    ASSERT_EQ(dense_ids, get_ids(it));
+
+    std::vector<filter_iterator_t> children;
+    children.push_back(filter_iterator_t::new_ids_iterator(ids1.data(), ids1.size(), false));
+    children.push_back(filter_iterator_t::new_ids_iterator(ids2.data(), ids2.size(), false));
+    children.push_back(filter_iterator_t::new_bitmap_iterator(bitmap));
+    it = filter_iterator_t::new_and_iterator(std::move(children));
+    ASSERT_EQ(filter_iterator_t::AND, it.get_type());
+    ASSERT_EQ(std::vector<uint32_t>({3, 7, 100}), get_ids(it));
+
+    children.clear();
+    children.push_back(filter_iterator_t::new_ids_iterator(ids1.data(), ids1.size(), false));
+    children.push_back(filter_iterator_t::new_ids_iterator(ids2.data(), ids2.size(), false));
+    it = filter_iterator_t::new_or_iterator(std::move(children));
+    ASSERT_EQ(std::vector<uint32_t>({1, 2, 3, 4, 5, 7, 9, 100, 150, 200}), get_ids(it));
+
+    it = filter_iterator_t::new_not_iterator(filter_iterator_t::new_ids_iterator(ids2.data(), ids2.size(), false), 8);
+    ASSERT_EQ(std::vector<uint32_t>({0, 1, 5, 6}), get_ids(it));
+
+    // ids1 AND NOT (bitmap)
+    children.clear();
+    children.push_back(filter_iterator_t::new_ids_iterator(ids1.data(), ids1.size(), false));
+    children.push_back(filter_iterator_t::new_not_iterator(filter_iterator_t::new_bitmap_iterator(bitmap), 300));
+    it = filter_iterator_t::new_and_iterator(std::move(children));
+    ASSERT_EQ(std::vector<uint32_t>({5, 200}), get_ids(it));
+
+    // a single child is not wrapped
+    children.clear();
+    children.push_back(filter_iterator_t::new_bitmap_iterator(bitmap));
+    it = filter_iterator_t::new_and_iterator(std::move(children));
+    ASSERT_EQ(filter_iterator_t::BITMAP, it.get_type());
+}
+
+TEST(FilterIteratorTest, SkipToAndContains) {
+    std::vector<uint32_t> ids1 = {1, 3, 5, 7, 9, 100, 200};
+    std::vector<uint32_t> ids2 = {3, 5, 9, 150, 200};
+
+    std::vector<filter_iterator_t> children;
+    children.push_back(filter_iterator_t::new_ids_iterator(ids1.data(), ids1.size(), false));
+    children.push_back(filter_iterator_t::new_ids_iterator(ids2.data(), ids2.size(), false));
+    auto it = filter_iterator_t::new_and_iterator(std::move(children));
+
+    it.skip_to(4);
+    ASSERT_TRUE(it.valid());
+    ASSERT_EQ(5, it.id());
+
+    // never moves backwards
+    it.skip_to(2);
+    ASSERT_EQ(5, it.id());
+
+    ASSERT_FALSE(it.contains(8));
+    ASSERT_TRUE(it.contains(9));
+    ASSERT_FALSE(it.contains(150));
+    ASSERT_TRUE(it.contains(200));
+    ASSERT_FALSE(it.contains(201));
+    ASSERT_FALSE(it.valid());
+}
+
+TEST(FilterIteratorTest, ToIds) {
+    // an owned array is handed over without a copy
+    uint32_t* ids = new uint32_t[3]{2, 4, 6};
+    auto it = filter_iterator_t::new_ids_iterator(ids, 3, true);
+
+    uint32_t* out = nullptr;
+    ASSERT_EQ(3, it.to_ids(&out));
+    ASSERT_EQ(ids, out);
+    ASSERT_FALSE(it.valid());
+    delete [] out;
+
+    std::vector<uint32_t> ids1 = {1, 2, 3, 4};
+    std::vector<uint32_t> ids2 = {2, 4, 8};
+    std::vector<filter_iterator_t> children;
+    children.push_back(filter_iterator_t::new_ids_iterator(ids1.data(), ids1.size(), false));
+    children.push_back(filter_iterator_t::new_ids_iterator(ids2.data(), ids2.size(), false));
+    it = filter_iterator_t::new_and_iterator(std::move(children));
+    ASSERT_EQ(3, it.estimate_size());
+
+    ASSERT_EQ(2, it.to_ids(&out));
+    ASSERT_EQ(2, out[0]);
+    ASSERT_EQ(4, out[1]);
+    delete [] out;
+
+    ASSERT_EQ(0, it.to_ids(&out));
+    ASSERT_EQ(nullptr, out);
+}
+
+TEST(FilterIteratorTest, CloneAndRangeIds) {
+    std::vector<uint32_t> ids1, ids2;
+    for(uint32_t id = 0; id < 1000; id++) {
+        if(id % 2 == 0) {
+            ids1.push_back(id);
+        }
+
+        if(id % 3 == 0) {
+            ids2.push_back(id);
+        }
+    }
+
+    std::vector<filter_iterator_t> children;
+    children.push_back(filter_iterator_t::new_ids_iterator(ids1.data(), ids1.size(), false));
+    children.push_back(filter_iterator_t::new_not_iterator(
+            filter_iterator_t::new_ids_iterator(ids2.data(), ids2.size(), false), UINT32_MAX));
+    auto it = filter_iterator_t::new_and_iterator(std::move(children));
+
+    std::vector<uint32_t> expected_ids = get_ids(it);
+    ASSERT_EQ(333, expected_ids.size());
+
+    children.clear();
+    children.push_back(filter_iterator_t::new_ids_iterator(ids1.data(), ids1.size(), false));
+    children.push_back(filter_iterator_t::new_not_iterator(
+            filter_iterator_t::new_ids_iterator(ids2.data(), ids2.size(), false), UINT32_MAX));
+    it = filter_iterator_t::new_and_iterator(std::move(children));
+
+    // ranges collected from clones add up to the whole result, while the original stays where it is
+    std::vector<uint32_t> range_ids;
+    const std::vector<std::pair<uint32_t, uint32_t>> ranges = {{0, 99}, {100, 100}, {101, 640}, {641, UINT32_MAX}};
+    for(const auto& range: ranges) {
+        auto range_it = it.clone();
+        range_it.range_ids(range.first, range.second, range_ids);
+    }
+
+    ASSERT_EQ(expected_ids, range_ids);
+    ASSERT_TRUE(it.valid());
+    ASSERT_EQ(2, it.id());
+}
+
+TEST(FilterIteratorTest, DrivesBlockIntersection) {
+    std::vector<uint32_t> offsets = {0, 1, 3};
+    posting_list_t p1(4), p2(4);
+
+    for(uint32_t id = 0; id < 100; id++) {
+        p1.upsert(id, offsets);
+        if(id % 2 == 0) {
+            p2.upsert(id, offsets);
+        }
+    }
+
+    std::vector<uint32_t> filter_ids;
+    for(uint32_t id = 0; id < 100; id += 3) {
+        filter_ids.push_back(id);
+    }
+
+    auto bitmap = std::make_shared<const id_bitmap_t>(filter_ids.data(), filter_ids.size());
+    auto filter_it = filter_iterator_t::new_bitmap_iterator(bitmap);
+
+    result_iter_state_t istate;
+    istate.filter_it = &filter_it;
+
+    std::vector<posting_list_t::iterator_t> its;
+    its.push_back(p1.new_iterator());
+    its.push_back(p2.new_iterator());
+
+    std::vector<uint32_t> result_ids;
+    posting_list_t::block_intersect(its, istate, [&](uint32_t id, std::vector<posting_list_t::iterator_t>& its,
+                                                     size_t index) {
+        result_ids.push_back(id);
+    });
+
+    std::vector<uint32_t> expected_ids;
+    for(uint32_t id = 0; id < 100; id += 6) {
+        expected_ids.push_back(id);
+    }
+
+    ASSERT_EQ(expected_ids, result_ids);
+}
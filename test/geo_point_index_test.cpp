@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <s2/s2cap.h>
+#include <s2/s2earth.h>
+#include "geo_point_index.h"
+#include "field.h"
+
+TEST(GeoPointIndexTest, RegionIds) {
+    geo_point_index_t index;
+
+    index.insert(0, GeoPoint::pack_lat_lng(48.85821022164442, 2.294239067890161));   // paris
+    index.insert(1, GeoPoint::pack_lat_lng(48.86061, 2.33763));                      // paris
+    index.insert(2, GeoPoint::pack_lat_lng(51.50100, -0.14196));                     // london
+    index.insert(3, GeoPoint::pack_lat_lng(40.74844, -73.98566));                    // new york
+    index.insert(3, GeoPoint::pack_lat_lng(48.87538, 2.29504));                      // paris, second point of 3
+    ASSERT_EQ(5, index.size());
+
+    S2Cap paris_cap(S2LatLng::FromDegrees(48.85821, 2.29424).ToPoint(),
+                    S1Angle::Radians(S2Earth::MetersToRadians(10 * 1000)));
+
+    std::vector<uint32_t> ids;
+    index.region_ids(paris_cap, ids);
+    ASSERT_EQ(std::vector<uint32_t>({0, 1, 3}), ids);
+
+    index.remove(3, GeoPoint::pack_lat_lng(48.87538, 2.29504));
+    ASSERT_EQ(4, index.size());
+
+    ids.clear();
+    index.region_ids(paris_cap, ids);
+    ASSERT_EQ(std::vector<uint32_t>({0, 1}), ids);
+}
+
+TEST(GeoPointIndexTest, NumPointsOfCovering) {
+    geo_point_index_t index;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> lat_dist(48.0, 49.5), lng_dist(1.5, 3.0);
+
+    for(uint32_t id = 0; id < 2000; id++) {
+        index.insert(id, GeoPoint::pack_lat_lng(lat_dist(gen), lng_dist(gen)));
+    }
+
+    S2Cap paris_cap(S2LatLng::FromDegrees(48.85821, 2.29424).ToPoint(),
+                    S1Angle::Radians(S2Earth::MetersToRadians(20 * 1000)));
+    const S2CellUnion covering = geo_point_index_t::get_covering(paris_cap);
+
+    // one point per id, so the points in the cells are the ids found in them
+    std::vector<uint32_t> ids;
+    index.region_ids(covering, ids);
+    ASSERT_FALSE(ids.empty());
+    ASSERT_EQ(ids.size(), index.num_points(covering));
+
+    S2Cap far_cap(S2LatLng::FromDegrees(40.74844, -73.98566).ToPoint(),
+                  S1Angle::Radians(S2Earth::MetersToRadians(20 * 1000)));
+    ASSERT_EQ(0, index.num_points(geo_point_index_t::get_covering(far_cap)));
+}
+
+TEST(GeoPointIndexTest, NearestMatchesBruteForce) {
+    geo_point_index_t index;
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> lat_dist(40.0, 41.0), lng_dist(-74.5, -73.5);
+
+    const size_t num_ids = 5000;
+    std::vector<int64_t> id_points(num_ids);
+
+    for(uint32_t id = 0; id < num_ids; id++) {
+        id_points[id] = GeoPoint::pack_lat_lng(lat_dist(gen), lng_dist(gen));
+        index.insert(id, id_points[id]);
+    }
+
+    // every other id passes the filter
+    std::vector<uint32_t> filter_ids;
+    for(uint32_t id = 0; id < num_ids; id += 2) {
+        filter_ids.push_back(id);
+    }
+
+    const S2LatLng center = S2LatLng::FromDegrees(40.5, -74.0);
+
+    for(size_t k: {1, 10, 250}) {
+        std::vector<uint32_t> ids;
+        index.nearest(center, k, filter_ids.data(), filter_ids.size(), ids);
+        ASSERT_GE(ids.size(), k);
+
+        std::vector<int64_t> distances;
+        for(uint32_t id: filter_ids) {
+            S2LatLng lat_lng;
+            GeoPoint::unpack_lat_lng(id_points[id], lat_lng);
+            distances.push_back(GeoPoint::distance(lat_lng, center));
+        }
+
+        std::vector<int64_t> sorted_distances = distances;
+        std::sort(sorted_distances.begin(), sorted_distances.end());
+        const int64_t max_distance = sorted_distances[k - 1];
+
+        std::vector<uint32_t> expected_ids;
+        for(size_t i = 0; i < filter_ids.size(); i++) {
+            if(distances[i] <= max_distance) {
+                expected_ids.push_back(filter_ids[i]);
+            }
+        }
+
+        ASSERT_EQ(expected_ids, ids);
+    }
+
+    // fewer ids than asked for
+    std::vector<uint32_t> few_filter_ids = {3, 8, 100};
+    std::vector<uint32_t> ids;
+    index.nearest(center, 10, few_filter_ids.data(), few_filter_ids.size(), ids);
+    ASSERT_EQ(few_filter_ids, ids);
+}
+
+TEST(GeoPointIndexTest, BatchedDistancesMatchDistance) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> lat_dist(-90.0, 90.0), lng_dist(-180.0, 180.0);
+
+    // not a multiple of the block size of the kernel
+    std::vector<int64_t> lat_lngs;
+    for(size_t i = 0; i < 1000; i++) {
+        lat_lngs.push_back(GeoPoint::pack_lat_lng(lat_dist(gen), lng_dist(gen)));
+    }
+
+    const S2LatLng reference = S2LatLng::FromDegrees(48.85821, 2.29424);
+    std::vector<int64_t> distances(lat_lngs.size());
+    GeoPoint::distances(lat_lngs.data(), lat_lngs.size(), reference, distances.data());
+
+    for(size_t i = 0; i < lat_lngs.size(); i++) {
+        S2LatLng lat_lng;
+        GeoPoint::unpack_lat_lng(lat_lngs[i], lat_lng);
+        ASSERT_EQ(GeoPoint::distance(lat_lng, reference), distances[i]);
+    }
+}
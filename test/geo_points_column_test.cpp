@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "geo_points_column.h"
+
+TEST(GeoPointsColumnTest, SetReplaceAndErase) {
+    geo_points_column_t column;
+    ASSERT_EQ(0, column.size());
+    ASSERT_EQ(nullptr, column.get(0));
+
+    const int64_t points_a[3] = {11, 12, 13};
+    const int64_t points_b[1] = {21};
+
+    column.set(5, points_a, 3);
+    column.set(2, points_b, 1);
+    ASSERT_EQ(2, column.size());
+
+    const int64_t* run = column.get(5);
+    ASSERT_NE(nullptr, run);
+    ASSERT_EQ(3, run[0]);
+    ASSERT_EQ(11, run[1]);
+    ASSERT_EQ(13, run[3]);
+
+    ASSERT_EQ(nullptr, column.get(3));
+    ASSERT_EQ(nullptr, column.get(1000));
+
+    // an update replaces the points of the id
+    column.set(5, points_b, 1);
+    ASSERT_EQ(2, column.size());
+    run = column.get(5);
+    ASSERT_EQ(1, run[0]);
+    ASSERT_EQ(21, run[1]);
+
+    column.erase(2);
+    column.erase(2);
+    column.erase(1000);
+    ASSERT_EQ(1, column.size());
+    ASSERT_EQ(nullptr, column.get(2));
+    ASSERT_EQ(21, column.get(5)[1]);
+}
+
+TEST(GeoPointsColumnTest, RunsSurviveCompaction) {
+    geo_points_column_t column;
+
+    // repeated updates leave dead runs behind, which get compacted away
+    for(int64_t round = 0; round < 20; round++) {
+        for(uint32_t id = 0; id < 100; id++) {
+            std::vector<int64_t> points(id % 4 + 1, round * 1000 + id);
+            column.set(id, points.data(), points.size());
+        }
+
+        for(uint32_t id = 0; id < 100; id += 7) {
+            column.erase(id);
+        }
+    }
+
+    ASSERT_EQ(85, column.size());
+
+    for(uint32_t id = 0; id < 100; id++) {
+        const int64_t* run = column.get(id);
+
+        if(id % 7 == 0) {
+            ASSERT_EQ(nullptr, run);
+            continue;
+        }
+
+        ASSERT_NE(nullptr, run);
+        ASSERT_EQ(id % 4 + 1, run[0]);
+        for(int64_t pi = 0; pi < run[0]; pi++) {
+            ASSERT_EQ(19 * 1000 + id, run[pi + 1]);
+        }
+    }
+}
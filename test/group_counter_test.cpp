@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "group_counter.h"
+
+TEST(GroupCounterTest, ExactBelowThreshold) {
+    group_counter_t counter;
+
+    for(uint64_t key = 0; key < group_counter_t::EXACT_MAX_GROUPS; key++) {
+        counter.emplace(key);
+        counter.emplace(key);
+    }
+
+    ASSERT_TRUE(counter.is_exact());
+    ASSERT_EQ(group_counter_t::EXACT_MAX_GROUPS, counter.size());
+
+    group_counter_t other;
+    other.emplace(0);
+    other.emplace(1);
+    other.emplace(group_counter_t::EXACT_MAX_GROUPS + 10);
+
+    counter.merge(other);
+    ASSERT_FALSE(counter.is_exact());
+    ASSERT_NEAR(group_counter_t::EXACT_MAX_GROUPS + 1, counter.size(), group_counter_t::EXACT_MAX_GROUPS * 0.03);
+    ASSERT_LE(group_counter_t::EXACT_MAX_GROUPS + 1, counter.size());
+}
+
+TEST(GroupCounterTest, EstimatesManyGroups) {
+    for(size_t num_groups: {5000, 20000, 100000, 1000000}) {
+        group_counter_t counter;
+
+        for(uint64_t key = 0; key < num_groups; key++) {
+            counter.emplace(key * 7);
+        }
+
+        ASSERT_FALSE(counter.is_exact());
+        ASSERT_NEAR(num_groups, counter.size(), num_groups * 0.03);
+    }
+}
+
+TEST(GroupCounterTest, MergesOverlappingCounters) {
+    // the counters of the threads of a search share some groups
+    std::vector<group_counter_t> counters(4);
+
+    for(size_t i = 0; i < counters.size(); i++) {
+        for(uint64_t key = i * 10000; key < i * 10000 + 30000; key++) {
+            counters[i].emplace(key);
+        }
+    }
+
+    group_counter_t merged;
+    for(const auto& counter: counters) {
+        merged.merge(counter);
+    }
+
+    ASSERT_NEAR(60000, merged.size(), 60000 * 0.03);
+
+    group_counter_t small;
+    small.emplace(1);
+    small.merge(merged);
+    ASSERT_NEAR(60000, small.size(), 60000 * 0.03);
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include "hot_query_log.h"
+
+static std::map<std::string, std::string> search_params(const std::string& q) {
+    return {{"collection", "products"}, {"q", q}, {"query_by", "title"}, {"x-typesense-api-key", "secret"}};
+}
+
+TEST(HotQueryLogTest, KeepsTheMostFrequentSearches) {
+    HotQueryLog log;
+    log.init("/tmp/typesense_test_hot_queries.jsonl", 2);
+
+    for(size_t i = 0; i < 10; i++) {
+        log.record(search_params("shoes"), "x-typesense-api-key");
+    }
+
+    for(size_t i = 0; i < 5; i++) {
+        log.record(search_params("socks"), "x-typesense-api-key");
+    }
+
+    // more one-off searches than are counted take each other's place, but not the place of the frequent ones
+    for(size_t i = 0; i < 20; i++) {
+        log.record(search_params("one-off " + std::to_string(i)), "x-typesense-api-key");
+    }
+
+    const std::vector<hot_query_t>& hot_queries = log.get_hot_queries();
+    ASSERT_EQ(2, hot_queries.size());
+    ASSERT_EQ("shoes", hot_queries[0].params.at("q"));
+    ASSERT_EQ(10, hot_queries[0].count);
+    ASSERT_EQ("socks", hot_queries[1].params.at("q"));
+    ASSERT_EQ(5, hot_queries[1].count);
+
+    // the API key is not kept
+    ASSERT_EQ(0, hot_queries[0].params.count("x-typesense-api-key"));
+    ASSERT_EQ(3, hot_queries[0].params.size());
+}
+
+TEST(HotQueryLogTest, SaveAndRead) {
+    const std::string path = "/tmp/typesense_test_hot_queries.jsonl";
+    std::remove(path.c_str());
+
+    HotQueryLog log;
+    log.init(path, 10);
+
+    // nothing to save yet
+    ASSERT_TRUE(log.save().ok());
+    std::vector<hot_query_t> hot_queries;
+    ASSERT_FALSE(HotQueryLog::read(path, hot_queries).ok());
+
+    log.record(search_params("shoes"), "x-typesense-api-key");
+    log.record(search_params("shoes"), "x-typesense-api-key");
+    log.record(search_params("socks"), "x-typesense-api-key");
+    ASSERT_TRUE(log.save().ok());
+
+    ASSERT_TRUE(HotQueryLog::read(path, hot_queries).ok());
+    ASSERT_EQ(2, hot_queries.size());
+    ASSERT_EQ("shoes", hot_queries[0].params.at("q"));
+    ASSERT_EQ(2, hot_queries[0].count);
+    ASSERT_EQ("products", hot_queries[1].params.at("collection"));
+
+    // disabled
+    HotQueryLog disabled_log;
+    disabled_log.init(path, 0);
+    disabled_log.record(search_params("shoes"), "x-typesense-api-key");
+    ASSERT_TRUE(disabled_log.get_hot_queries().empty());
+
+    std::remove(path.c_str());
+}
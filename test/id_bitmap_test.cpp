@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include "id_bitmap.h"
+
+TEST(IdBitmapTest, SparseIdsAreKeptAsArray) {
+    std::vector<uint32_t> ids = {5, 1000, 200000};
+    id_bitmap_t id_bitmap(&ids[0], ids.size());
+
+    ASSERT_FALSE(id_bitmap.is_bitmap());
+    ASSERT_EQ(3, id_bitmap.size());
+    ASSERT_TRUE(id_bitmap.contains(1000));
+    ASSERT_FALSE(id_bitmap.contains(1001));
+
+    uint32_t* out = nullptr;
+    size_t out_len = id_bitmap.to_ids(&out);
+    ASSERT_EQ(ids, std::vector<uint32_t>(out, out + out_len));
+    delete [] out;
+
+    std::vector<uint32_t> other_ids = {1, 5, 200000, 300000};
+    out = nullptr;
+    out_len = id_bitmap.and_ids(&other_ids[0], other_ids.size(), &out);
+    ASSERT_EQ(std::vector<uint32_t>({5, 200000}), std::vector<uint32_t>(out, out + out_len));
+    delete [] out;
+}
+
+TEST(IdBitmapTest, DenseIdsBecomeBitmap) {
+    std::vector<uint32_t> ids;
+    for(uint32_t i = 0; i < 10000; i += 3) {
+        ids.push_back(i);
+    }
+
+    id_bitmap_t id_bitmap(&ids[0], ids.size());
+
+    ASSERT_TRUE(id_bitmap.is_bitmap());
+    ASSERT_EQ(ids.size(), id_bitmap.size());
+    ASSERT_LT(id_bitmap.memory_bytes(), ids.size() * sizeof(uint32_t));
+    ASSERT_TRUE(id_bitmap.contains(9999));
+    ASSERT_FALSE(id_bitmap.contains(9998));
+    ASSERT_FALSE(id_bitmap.contains(20000));
+
+    uint32_t* out = nullptr;
+    size_t out_len = id_bitmap.to_ids(&out);
+    ASSERT_EQ(ids, std::vector<uint32_t>(out, out + out_len));
+    delete [] out;
+
+    std::vector<uint32_t> other_ids = {0, 1, 2, 3, 6, 9998, 9999, 20001};
+    out = nullptr;
+    out_len = id_bitmap.and_ids(&other_ids[0], other_ids.size(), &out);
+    ASSERT_EQ(std::vector<uint32_t>({0, 3, 6, 9999}), std::vector<uint32_t>(out, out + out_len));
+    delete [] out;
+}
+
+TEST(IdBitmapTest, EmptySet) {
+    id_bitmap_t id_bitmap(nullptr, 0);
+
+    ASSERT_EQ(0, id_bitmap.size());
+    ASSERT_FALSE(id_bitmap.contains(0));
+
+    uint32_t* out = nullptr;
+    ASSERT_EQ(0, id_bitmap.to_ids(&out));
+    ASSERT_EQ(nullptr, out);
+
+    std::vector<uint32_t> other_ids = {1, 2};
+    ASSERT_EQ(0, id_bitmap.and_ids(&other_ids[0], other_ids.size(), &out));
+}
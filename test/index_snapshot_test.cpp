@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include "index_snapshot.h"
+#include "posting.h"
+
+TEST(IndexSnapshotTest, HeaderRoundTrip) {
+    index_snapshot_t snapshot;
+    snapshot.collection_id = 3;
+    snapshot.next_seq_id = 1200;
+    snapshot.store_seq_number = 987654321;
+    snapshot.fields = {{"title", "string"}, {"tags", "string[]"}};
+
+    std::stringstream ss;
+    snapshot.write_header(ss);
+
+    index_snapshot_t read_snapshot;
+    ASSERT_TRUE(read_snapshot.read_header(ss));
+    ASSERT_EQ(3, read_snapshot.collection_id);
+    ASSERT_EQ(1200, read_snapshot.next_seq_id);
+    ASSERT_EQ(987654321, read_snapshot.store_seq_number);
+    ASSERT_EQ(snapshot.fields, read_snapshot.fields);
+
+    // not a snapshot
+    std::stringstream bad_ss("garbage");
+    ASSERT_FALSE(read_snapshot.read_header(bad_ss));
+}
+
+TEST(IndexSnapshotTest, TreeRoundTrip) {
+    art_tree t;
+    art_tree_init(&t);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> num_offsets_dist(1, 4);
+
+    // tokens held by few ids get compact lists, and those held by most ids get full lists of many blocks
+    const std::vector<std::string> tokens = {"apple", "apricot", "banana", "band", "bandana", "cherry"};
+
+    for(size_t i = 0; i < tokens.size(); i++) {
+        const size_t id_step = (i % 2 == 0) ? 1 : 97;
+        std::vector<art_document> documents;
+
+        for(uint32_t id = i; id < 2000; id += id_step) {
+            std::vector<uint32_t> offsets;
+            for(uint32_t j = 0; j < num_offsets_dist(gen); j++) {
+                offsets.push_back(j * 3);
+            }
+
+            documents.emplace_back(id, id % 50, offsets);
+        }
+
+        art_inserts(&t, (const unsigned char*) tokens[i].c_str(), tokens[i].size() + 1, 49, documents);
+    }
+
+    std::stringstream ss;
+    index_snapshot_t::write_tree(&t, ss);
+    const std::string dump = ss.str();
+
+    art_tree read_t;
+    art_tree_init(&read_t);
+    ASSERT_TRUE(index_snapshot_t::read_tree(ss, &read_t));
+    ASSERT_EQ(t.size, read_t.size);
+
+    for(const auto& token: tokens) {
+        auto leaf = (art_leaf*) art_search(&t, (const unsigned char*) token.c_str(), token.size() + 1);
+        auto read_leaf = (art_leaf*) art_search(&read_t, (const unsigned char*) token.c_str(), token.size() + 1);
+        ASSERT_NE(nullptr, read_leaf);
+        ASSERT_EQ(leaf->max_score, read_leaf->max_score);
+        ASSERT_EQ(posting_t::num_ids(leaf->values), posting_t::num_ids(read_leaf->values));
+        ASSERT_EQ(IS_COMPACT_POSTING(leaf->values), IS_COMPACT_POSTING(read_leaf->values));
+    }
+
+    // same ids and offsets in every leaf
+    std::stringstream read_ss;
+    index_snapshot_t::write_tree(&read_t, read_ss);
+    ASSERT_EQ(dump, read_ss.str());
+
+    // a truncated dump is rejected
+    std::stringstream truncated_ss(dump.substr(0, dump.size() / 2));
+    art_tree truncated_t;
+    art_tree_init(&truncated_t);
+    ASSERT_FALSE(index_snapshot_t::read_tree(truncated_ss, &truncated_t));
+
+    art_tree_destroy(&t);
+    art_tree_destroy(&read_t);
+    art_tree_destroy(&truncated_t);
+}
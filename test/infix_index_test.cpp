@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include "infix_index.h"
+
+static std::vector<std::string> sorted_search(const infix_index_t& index, const std::string& query,
+                                              size_t max_extra_prefix, size_t max_extra_suffix) {
+    std::vector<std::string> tokens;
+    index.search(query, max_extra_prefix, max_extra_suffix, tokens);
+    std::sort(tokens.begin(), tokens.end());
+    return tokens;
+}
+
+TEST(InfixIndexTest, SearchInsertAndErase) {
+    infix_index_t index;
+    index.insert("gh100037in8900x");
+    index.insert("yhd3342d78912");
+    index.insert("100037");
+    index.insert("100037");
+    index.insert("abcab");
+    ASSERT_EQ(4, index.size());
+
+    ASSERT_EQ(std::vector<std::string>({"100037", "gh100037in8900x"}),
+              sorted_search(index, "100037", SIZE_MAX, SIZE_MAX));
+
+    // the extra prefix and suffix are bounded
+    ASSERT_EQ(std::vector<std::string>({"100037"}), sorted_search(index, "100037", 1, SIZE_MAX));
+    ASSERT_EQ(std::vector<std::string>({"100037"}), sorted_search(index, "100037", SIZE_MAX, 6));
+
+    // shares all the trigrams of the query without containing it
+    ASSERT_TRUE(sorted_search(index, "bcabc", SIZE_MAX, SIZE_MAX).empty());
+    ASSERT_EQ(std::vector<std::string>({"abcab"}), sorted_search(index, "bca", SIZE_MAX, SIZE_MAX));
+
+    // queries shorter than a trigram
+    ASSERT_EQ(std::vector<std::string>({"gh100037in8900x", "yhd3342d78912"}),
+              sorted_search(index, "9", SIZE_MAX, SIZE_MAX));
+    ASSERT_EQ(std::vector<std::string>({"yhd3342d78912"}), sorted_search(index, "2d", SIZE_MAX, SIZE_MAX));
+
+    index.erase("100037");
+    index.erase("missing");
+    ASSERT_EQ(3, index.size());
+    ASSERT_EQ(std::vector<std::string>({"gh100037in8900x"}), sorted_search(index, "100037", SIZE_MAX, SIZE_MAX));
+}
+
+TEST(InfixIndexTest, MatchesScanAcrossCompaction) {
+    infix_index_t index;
+    std::mt19937 gen(99);
+    std::uniform_int_distribution<int> len_dist(1, 12), char_dist('a', 'e');
+
+    std::vector<std::string> live_tokens;
+
+    for(size_t round = 0; round < 4; round++) {
+        for(size_t i = 0; i < 500; i++) {
+            std::string token;
+            const size_t len = len_dist(gen);
+            for(size_t c = 0; c < len; c++) {
+                token += char(char_dist(gen));
+            }
+
+            if(std::find(live_tokens.begin(), live_tokens.end(), token) == live_tokens.end()) {
+                live_tokens.push_back(token);
+            }
+
+            index.insert(token);
+        }
+
+        // erasing two thirds of the tokens forces the ids to be renumbered
+        std::vector<std::string> kept_tokens;
+        for(size_t i = 0; i < live_tokens.size(); i++) {
+            if(i % 3 == 0) {
+                kept_tokens.push_back(live_tokens[i]);
+            } else {
+                index.erase(live_tokens[i]);
+            }
+        }
+
+        live_tokens = kept_tokens;
+        ASSERT_EQ(live_tokens.size(), index.size());
+
+        for(const std::string query: {"a", "ab", "abc", "dcba", "eeee", "cadeb"}) {
+            for(size_t max_extra: {size_t(0), size_t(2), SIZE_MAX}) {
+                std::vector<std::string> expected_tokens;
+                for(const auto& token: live_tokens) {
+                    const size_t start_index = token.find(query);
+                    if(start_index != std::string::npos && start_index <= max_extra &&
+                       token.size() - (start_index + query.size()) <= max_extra) {
+                        expected_tokens.push_back(token);
+                    }
+                }
+
+                std::sort(expected_tokens.begin(), expected_tokens.end());
+                ASSERT_EQ(expected_tokens, sorted_search(index, query, max_extra, max_extra));
+            }
+        }
+    }
+}
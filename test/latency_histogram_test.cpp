@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include "latency_histogram.h"
+
+TEST(LatencyHistogramTest, BucketsCoverValuesWithinTheirWidth) {
+    size_t prev_index = 0;
+
+    for(uint64_t value = 0; value < (1 << 20); value++) {
+        const size_t index = latency_histogram_t::bucket_index(value);
+        ASSERT_LE(prev_index, index);
+        ASSERT_LT(index, latency_histogram_t::NUM_BUCKETS);
+
+        const uint64_t max_value = latency_histogram_t::bucket_max_value(index);
+        ASSERT_LE(value, max_value);
+        ASSERT_LE(max_value - value, value / latency_histogram_t::SUB_BUCKETS);
+
+        prev_index = index;
+    }
+
+    ASSERT_EQ(latency_histogram_t::NUM_BUCKETS - 1, latency_histogram_t::bucket_index(latency_histogram_t::MAX_VALUE));
+    ASSERT_EQ(latency_histogram_t::NUM_BUCKETS - 1, latency_histogram_t::bucket_index(UINT64_MAX));
+    ASSERT_EQ(latency_histogram_t::MAX_VALUE,
+              latency_histogram_t::bucket_max_value(latency_histogram_t::NUM_BUCKETS - 1));
+}
+
+TEST(LatencyHistogramTest, PercentilesMatchSortedValues) {
+    std::mt19937 gen(42);
+    std::lognormal_distribution<double> latency_dist(7, 1.5);
+
+    latency_histogram_t histogram, merged_histogram, other_histogram;
+    std::vector<uint64_t> values;
+
+    for(size_t i = 0; i < 100000; i++) {
+        const uint64_t value = latency_dist(gen);
+        values.push_back(value);
+        histogram.record(value);
+        (i % 2 == 0 ? merged_histogram : other_histogram).record(value);
+    }
+
+    merged_histogram.merge(other_histogram);
+    std::sort(values.begin(), values.end());
+
+    for(double percentile: {1.0, 50.0, 95.0, 99.0, 99.9, 100.0}) {
+        const size_t rank = std::max<size_t>(1, std::ceil(percentile / 100 * values.size()));
+        const uint64_t expected = values[rank - 1];
+        const uint64_t actual = histogram.value_at_percentile(percentile);
+
+        ASSERT_LE(expected, actual);
+        ASSERT_LE(actual - expected, expected / latency_histogram_t::SUB_BUCKETS);
+        ASSERT_EQ(actual, merged_histogram.value_at_percentile(percentile));
+    }
+
+    ASSERT_EQ(values.back(), histogram.value_at_percentile(100));
+    ASSERT_EQ(values.size(), merged_histogram.num_values);
+
+    latency_histogram_t empty_histogram;
+    ASSERT_EQ(0, empty_histogram.value_at_percentile(99));
+    merged_histogram.merge(empty_histogram);
+    ASSERT_EQ(values.size(), merged_histogram.num_values);
+}
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "load_replay.h"
+
+TEST(LoadReplayTest, ParseLogLines) {
+    // an entry of the slow query log
+    auto request_op = LoadReplayer::parse_log_line(
+        R"({"collection": "my coll", "slow": true, "params": {"q": "the fox", "query_by": "title", "per_page": 10}})"
+    );
+
+    ASSERT_TRUE(request_op.ok());
+    ASSERT_EQ(replay_request_t::SEARCH, request_op.get().kind);
+    ASSERT_EQ("/collections/my%20coll/documents/search?per_page=10&q=the%20fox&query_by=title",
+              request_op.get().path);
+    ASSERT_TRUE(request_op.get().body.empty());
+
+    request_op = LoadReplayer::parse_log_line("/collections/coll1/documents/search?q=fox&query_by=title");
+    ASSERT_TRUE(request_op.ok());
+    ASSERT_EQ("/collections/coll1/documents/search?q=fox&query_by=title", request_op.get().path);
+
+    request_op = LoadReplayer::parse_log_line(R"({"path": "/multi_search", "body": "{\"searches\": []}"})");
+    ASSERT_TRUE(request_op.ok());
+    ASSERT_EQ(replay_request_t::SEARCH, request_op.get().kind);
+    ASSERT_EQ("/multi_search", request_op.get().path);
+    ASSERT_EQ(R"({"searches": []})", request_op.get().body);
+
+    request_op = LoadReplayer::parse_log_line(R"({"path": "/collections/coll1/documents/import", "body": "{}"})");
+    ASSERT_TRUE(request_op.ok());
+    ASSERT_EQ(replay_request_t::IMPORT, request_op.get().kind);
+
+    ASSERT_FALSE(LoadReplayer::parse_log_line("").ok());
+    ASSERT_FALSE(LoadReplayer::parse_log_line("not json").ok());
+    ASSERT_FALSE(LoadReplayer::parse_log_line("[1, 2]").ok());
+    ASSERT_FALSE(LoadReplayer::parse_log_line(R"({"collection": "coll1"})").ok());
+}
+
+TEST(LoadReplayTest, LoadFiles) {
+    const std::string log_path = "/tmp/typesense_load_replay_test.log";
+    const std::string docs_path = "/tmp/typesense_load_replay_test.jsonl";
+
+    std::ofstream log_out(log_path);
+    log_out << R"({"collection": "coll1", "params": {"q": "a"}})" << "\n\n";
+    log_out << "/collections/coll1/documents/search?q=b" << "\n";
+    log_out.close();
+
+    std::vector<replay_request_t> searches;
+    ASSERT_TRUE(LoadReplayer::load_query_log(log_path, searches).ok());
+    ASSERT_EQ(2, searches.size());
+
+    std::ofstream log_bad_out(log_path);
+    log_bad_out << "/collections/coll1/documents/search?q=b" << "\n" << "oops" << "\n";
+    log_bad_out.close();
+
+    searches.clear();
+    auto load_op = LoadReplayer::load_query_log(log_path, searches);
+    ASSERT_FALSE(load_op.ok());
+    ASSERT_EQ("Line 2 of the query log: Line is not a request path or a JSON object.", load_op.error());
+
+    std::ofstream docs_out(docs_path);
+    for(size_t i = 0; i < 5; i++) {
+        docs_out << R"({"id": ")" << i << R"("})" << "\n";
+    }
+    docs_out.close();
+
+    std::vector<replay_request_t> imports;
+    ASSERT_TRUE(LoadReplayer::load_import_batches(docs_path, "coll1", 2, imports).ok());
+    ASSERT_EQ(3, imports.size());
+    ASSERT_EQ(replay_request_t::IMPORT, imports[0].kind);
+    ASSERT_EQ("/collections/coll1/documents/import?action=upsert", imports[0].path);
+    ASSERT_EQ("{\"id\": \"0\"}\n{\"id\": \"1\"}", imports[0].body);
+    ASSERT_EQ("{\"id\": \"4\"}", imports[2].body);
+
+    ASSERT_FALSE(LoadReplayer::load_query_log("/tmp/typesense_load_replay_missing.log", searches).ok());
+
+    std::remove(log_path.c_str());
+    std::remove(docs_path.c_str());
+}
+
+TEST(LoadReplayTest, ClosedLoopReplaysLog) {
+    std::vector<replay_request_t> searches(3);
+    searches[0].path = "/a";
+    searches[1].path = "/b";
+    searches[2].path = "/fail";
+
+    std::atomic<size_t> num_sent{0};
+
+    load_replay_config_t config;
+    config.concurrency = 4;
+    config.num_loops = 10;
+
+    LoadReplayer replayer(config, [&num_sent](const replay_request_t& request) {
+        num_sent++;
+        return request.path == "/fail" ? 503L : 200L;
+    });
+
+    replayer.run(searches, {});
+
+    ASSERT_EQ(30, num_sent);
+    ASSERT_EQ(30, replayer.get_search_stats().num_requests);
+    ASSERT_EQ(10, replayer.get_search_stats().num_errors);
+    ASSERT_EQ(30, replayer.get_search_stats().latencies.num_values);
+    ASSERT_EQ(0, replayer.get_import_stats().num_requests);
+
+    nlohmann::json report = replayer.get_report();
+    ASSERT_EQ(30, report["searches"]["num_requests"].get<size_t>());
+    ASSERT_EQ(1, report["searches"]["latency_us"].count("p999"));
+    ASSERT_EQ(0, report.count("imports"));
+}
+
+TEST(LoadReplayTest, OpenLoopCountsQueueing) {
+    std::vector<replay_request_t> searches(1);
+    searches[0].path = "/a";
+
+    // a single worker that takes 5ms a search cannot keep up with a search due every 1ms
+    load_replay_config_t config;
+    config.concurrency = 1;
+    config.rate = 1000;
+    config.num_loops = 20;
+
+    LoadReplayer replayer(config, [](const replay_request_t& request) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return 200L;
+    });
+
+    replayer.run(searches, {});
+
+    const replay_stats_t& stats = replayer.get_search_stats();
+    ASSERT_EQ(20, stats.num_requests);
+
+    // the last search is due at 19ms, but is only answered after 100ms
+    ASSERT_GE(stats.latencies.max_value, 70000);
+}
+
+TEST(LoadReplayTest, ImportsAlongsideSearches) {
+    std::vector<replay_request_t> searches(1);
+    searches[0].path = "/collections/coll1/documents/search?q=a";
+
+    std::vector<replay_request_t> imports(1);
+    imports[0].kind = replay_request_t::IMPORT;
+    imports[0].path = "/collections/coll1/documents/import?action=upsert";
+    imports[0].body = R"({"id": "0"})";
+
+    std::atomic<size_t> num_imports{0};
+
+    load_replay_config_t config;
+    config.concurrency = 2;
+    config.rate = 500;
+    config.duration_ms = 200;
+    config.import_rate = 50;
+
+    LoadReplayer replayer(config, [&num_imports](const replay_request_t& request) {
+        if(request.kind == replay_request_t::IMPORT) {
+            num_imports++;
+        }
+
+        return 200L;
+    });
+
+    replayer.run(searches, imports);
+
+    ASSERT_GT(replayer.get_search_stats().num_requests, 50);
+    ASSERT_LE(replayer.get_search_stats().num_requests, 100);
+    ASSERT_GT(replayer.get_import_stats().num_requests, 2);
+    ASSERT_EQ(num_imports, replayer.get_import_stats().num_requests);
+
+    nlohmann::json report = replayer.get_report();
+    ASSERT_EQ(1, report.count("imports"));
+    ASSERT_EQ(0, report["imports"]["num_errors"].get<size_t>());
+}
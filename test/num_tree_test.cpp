@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <art.h>
+#include <random>
 #include "num_tree.h"
 
 TEST(NumTreeTest, Searches) {
@@ -72,3 +73,220 @@ TEST(NumTreeTest, EraseFullList) {
     tree.search(NUM_COMPARATOR::EQUALS, 0, &ids, ids_len);
     ASSERT_EQ(nullptr, ids);
 }
+
+TEST(NumTreeTest, ColumnScanMatchesTreeSearch) {
+    // only `tree` has a column, so wide ranges are answered by scanning it while `tree_only` merges id lists
+    num_tree_t tree;
+    num_tree_t tree_only(false);
+    std::mt19937 gen(137723);
+    std::uniform_int_distribution<int64_t> value_dist(-5000, 5000);
+
+    std::vector<std::vector<int64_t>> doc_values(3000);
+
+    for(uint32_t id = 0; id < doc_values.size(); id++) {
+        // every 5th document holds an array of values
+        const size_t num_values = (id % 5 == 0) ? 3 : 1;
+        for(size_t i = 0; i < num_values; i++) {
+            doc_values[id].push_back(value_dist(gen));
+            tree.insert(doc_values[id].back(), id);
+            tree_only.insert(doc_values[id].back(), id);
+        }
+    }
+
+    // updates and deletes
+    for(uint32_t id = 0; id < doc_values.size(); id += 7) {
+        for(auto value: doc_values[id]) {
+            tree.remove(value, id);
+            tree_only.remove(value, id);
+        }
+
+        if(id % 2 == 0) {
+            tree.insert(id, id);
+            tree_only.insert(id, id);
+        }
+    }
+
+    auto assert_same_ids = [&](const std::function<void(num_tree_t&, uint32_t**, size_t&)>& search) {
+        uint32_t* ids = nullptr;
+        size_t ids_len = 0;
+        search(tree, &ids, ids_len);
+
+        uint32_t* expected_ids = nullptr;
+        size_t expected_ids_len = 0;
+        search(tree_only, &expected_ids, expected_ids_len);
+
+        ASSERT_EQ(std::vector<uint32_t>(expected_ids, expected_ids + expected_ids_len),
+                  std::vector<uint32_t>(ids, ids + ids_len));
+
+        delete [] ids;
+        delete [] expected_ids;
+    };
+
+    const std::vector<std::pair<int64_t, int64_t>> ranges = {{-100, 100}, {-4000, 4000}, {0, 5000}, {-6000, 6000},
+                                                             {6000, 7000}, {17, 17}};
+
+    for(const auto& range: ranges) {
+        assert_same_ids([&](num_tree_t& t, uint32_t** ids, size_t& ids_len) {
+            t.range_inclusive_search(range.first, range.second, ids, ids_len);
+        });
+
+        for(auto comparator: {GREATER_THAN, GREATER_THAN_EQUALS, LESS_THAN, LESS_THAN_EQUALS}) {
+            assert_same_ids([&](num_tree_t& t, uint32_t** ids, size_t& ids_len) {
+                t.search(comparator, range.first, ids, ids_len);
+            });
+        }
+    }
+
+    // results are merged into the ids passed in
+    assert_same_ids([&](num_tree_t& t, uint32_t** ids, size_t& ids_len) {
+        t.range_inclusive_search(-5000, -4000, ids, ids_len);
+        t.range_inclusive_search(-3000, 3000, ids, ids_len);
+    });
+}
+
+TEST(NumTreeTest, ColumnScanSkipsRemovedValues) {
+    num_column_t column;
+
+    for(uint32_t id = 0; id < 200; id++) {
+        column.insert(id, id);
+    }
+
+    for(uint32_t id = 0; id < 200; id += 2) {
+        column.remove(id, id);
+    }
+
+    // reuses the slot of the removed value
+    column.insert(10, 1000);
+
+    ASSERT_EQ(101, column.size());
+    ASSERT_EQ(200, column.num_slots());
+
+    std::vector<uint32_t> ids;
+    column.range_inclusive_scan(5, 12, ids);
+    ASSERT_EQ(std::vector<uint32_t>({5, 7, 9, 11}), ids);
+
+    ids.clear();
+    column.range_inclusive_scan(1000, 1000, ids);
+    ASSERT_EQ(std::vector<uint32_t>({10}), ids);
+
+    // removing more than half of the values compacts the column
+    column.remove(1, 1);
+    column.remove(3, 3);
+    ASSERT_EQ(99, column.size());
+    ASSERT_EQ(99, column.num_slots());
+
+    ids.clear();
+    column.range_inclusive_scan(0, 12, ids);
+    ASSERT_EQ(std::vector<uint32_t>({5, 7, 9, 11}), ids);
+}
+
+TEST(NumTreeTest, ApproxNumIds) {
+    num_tree_t tree;
+
+    for(uint32_t id = 0; id < 1000; id++) {
+        tree.insert(id % 100, id);
+    }
+
+    ASSERT_EQ(10, tree.approx_num_ids(EQUALS, 42));
+    ASSERT_EQ(0, tree.approx_num_ids(EQUALS, 420));
+
+    ASSERT_EQ(500, tree.approx_num_ids(GREATER_THAN_EQUALS, 50));
+    ASSERT_EQ(100, tree.approx_num_ids(LESS_THAN, 10));
+    ASSERT_EQ(1000, tree.approx_num_ids(LESS_THAN, 1000));
+    ASSERT_EQ(0, tree.approx_num_ids(GREATER_THAN, 1000));
+
+    ASSERT_EQ(200, tree.approx_range_num_ids(10, 29));
+    ASSERT_EQ(1000, tree.approx_range_num_ids(-100, 100));
+    ASSERT_EQ(0, tree.approx_range_num_ids(30, 10));
+}
+
+TEST(NumTreeTest, TopIds) {
+    num_tree_t tree;
+
+    for(uint32_t id = 0; id < 1000; id++) {
+        tree.insert(id % 100, id);
+    }
+
+    // the ids tied on the last value taken are all in
+    std::vector<uint32_t> ids;
+    ASSERT_TRUE(tree.top_ids(false, 15, nullptr, 0, 1000, ids));
+    std::sort(ids.begin(), ids.end());
+    ASSERT_EQ(20, ids.size());
+    ASSERT_EQ(98, ids[0]);
+    ASSERT_EQ(99, ids[1]);
+    ASSERT_EQ(999, ids.back());
+
+    ids.clear();
+    ASSERT_TRUE(tree.top_ids(true, 1, nullptr, 0, 1000, ids));
+    std::sort(ids.begin(), ids.end());
+    ASSERT_EQ(10, ids.size());
+    ASSERT_EQ(0, ids[0]);
+    ASSERT_EQ(900, ids.back());
+
+    std::vector<uint32_t> filter_ids = {5, 105, 199, 950};
+    ids.clear();
+    ASSERT_TRUE(tree.top_ids(false, 2, filter_ids.data(), filter_ids.size(), 1000, ids));
+    ASSERT_EQ(std::vector<uint32_t>({199, 950}), ids);
+
+    // fewer ids than asked for
+    ids.clear();
+    ASSERT_TRUE(tree.top_ids(false, 10, filter_ids.data(), filter_ids.size(), 1000, ids));
+    ASSERT_EQ(4, ids.size());
+
+    ids.clear();
+    ASSERT_FALSE(tree.top_ids(false, 10, filter_ids.data(), filter_ids.size(), 100, ids));
+}
+
+TEST(NumTreeTest, MemoryBytes) {
+    num_tree_t tree;
+    const size_t empty_bytes = tree.memory_bytes();
+
+    for(uint32_t id = 0; id < 100; id++) {
+        tree.insert(id % 10, id);
+    }
+
+    const size_t compact_bytes = tree.memory_bytes();
+    ASSERT_LT(empty_bytes, compact_bytes);
+
+    // values with more ids than fit a compact list grow full id lists
+    for(uint32_t id = 100; id < 10000; id++) {
+        tree.insert(id % 10, id);
+    }
+
+    ASSERT_LT(compact_bytes + 10000 * sizeof(int64_t), tree.memory_bytes());
+}
+
+TEST(NumTreeTest, CompactRepacksListsFragmentedByRemovals) {
+    num_tree_t tree;
+
+    for(uint32_t id = 0; id < 2560; id++) {
+        tree.insert(7, id);
+        tree.insert(9, id);
+    }
+
+    ASSERT_EQ(0, tree.num_values_to_compact());
+
+    // removals leave blocks half full
+    for(uint32_t id = 0; id < 2560; id += 2) {
+        tree.remove(7, id);
+    }
+
+    ASSERT_EQ(1, tree.num_values_to_compact());
+    const size_t fragmented_bytes = tree.memory_bytes();
+
+    ASSERT_EQ(1, tree.compact(10));
+    ASSERT_EQ(0, tree.num_values_to_compact());
+    ASSERT_GT(fragmented_bytes, tree.memory_bytes());
+    ASSERT_EQ(0, tree.compact(10));
+
+    uint32_t* ids = nullptr;
+    size_t ids_len = 0;
+    tree.search(EQUALS, 7, &ids, ids_len);
+    ASSERT_EQ(1280, ids_len);
+
+    for(size_t i = 0; i < ids_len; i++) {
+        ASSERT_EQ(i * 2 + 1, ids[i]);
+    }
+
+    delete [] ids;
+}
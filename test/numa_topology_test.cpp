@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <filesystem>
+#include "numa_topology.h"
+
+TEST(NumaTopologyTest, ParseCpuList) {
+    std::vector<size_t> cpus;
+    ASSERT_TRUE(numa_topology_t::parse_cpu_list("0-3,8,10-11", cpus));
+    ASSERT_EQ(std::vector<size_t>({0, 1, 2, 3, 8, 10, 11}), cpus);
+
+    cpus.clear();
+    ASSERT_TRUE(numa_topology_t::parse_cpu_list("", cpus));
+    ASSERT_TRUE(cpus.empty());
+
+    ASSERT_FALSE(numa_topology_t::parse_cpu_list("3-1", cpus));
+    ASSERT_FALSE(numa_topology_t::parse_cpu_list("0,a", cpus));
+    ASSERT_FALSE(numa_topology_t::parse_cpu_list("0-", cpus));
+}
+
+TEST(NumaTopologyTest, DetectNodesOfSysfs) {
+    const std::string node_dir_path = "/tmp/typesense_test/numa_topology";
+    std::filesystem::remove_all(node_dir_path);
+    std::filesystem::create_directories(node_dir_path + "/node0");
+    std::filesystem::create_directories(node_dir_path + "/node1");
+    std::filesystem::create_directories(node_dir_path + "/power");
+
+    std::ofstream(node_dir_path + "/node0/cpulist") << "0-1,4\n";
+    std::ofstream(node_dir_path + "/node1/cpulist") << "2-3\n";
+
+    numa_topology_t topology = numa_topology_t::detect(node_dir_path);
+    ASSERT_EQ(2, topology.num_nodes());
+    ASSERT_EQ(std::vector<size_t>({0, 1, 4}), topology.node_cpus[0]);
+    ASSERT_EQ(std::vector<size_t>({2, 3}), topology.node_cpus[1]);
+
+    // no nodes listed: all the cpus form a single node
+    topology = numa_topology_t::detect(node_dir_path + "/power");
+    ASSERT_EQ(1, topology.num_nodes());
+    ASSERT_FALSE(topology.node_cpus[0].empty());
+
+    std::filesystem::remove_all(node_dir_path);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "openmetrics.h"
+
+TEST(OpenMetricsTest, WritesFamiliesAndSamples) {
+    openmetrics_writer_t writer;
+
+    writer.family("typesense_requests", "counter", "Requests served.");
+    writer.sample("typesense_requests_total", {{"method", "GET"}, {"path", "/collections"}}, 42);
+    writer.sample("typesense_requests_total", {{"method", "POST"}, {"path", "/multi_search"}}, 7);
+
+    writer.family("typesense_load", "gauge", "Load of the node.");
+    writer.sample("typesense_load", 0.25);
+    writer.sample("typesense_load", {{"node", "a"}}, 1e12);
+    writer.sample("typesense_load", {{"node", "b"}}, NAN);
+    writer.sample("typesense_load", {{"node", "c"}}, INFINITY);
+
+    std::string expected = "# TYPE typesense_requests counter\n"
+                           "# HELP typesense_requests Requests served.\n"
+                           "typesense_requests_total{method=\"GET\",path=\"/collections\"} 42\n"
+                           "typesense_requests_total{method=\"POST\",path=\"/multi_search\"} 7\n"
+                           "# TYPE typesense_load gauge\n"
+                           "# HELP typesense_load Load of the node.\n"
+                           "typesense_load 0.25\n"
+                           "typesense_load{node=\"a\"} 1000000000000\n"
+                           "typesense_load{node=\"b\"} NaN\n"
+                           "typesense_load{node=\"c\"} +Inf\n"
+                           "# EOF\n";
+
+    ASSERT_EQ(expected, writer.finish());
+}
+
+TEST(OpenMetricsTest, EscapesLabelValues) {
+    ASSERT_EQ("plain", openmetrics_writer_t::escape_label_value("plain"));
+    ASSERT_EQ("say \\\"hi\\\"\\n\\\\", openmetrics_writer_t::escape_label_value("say \"hi\"\n\\"));
+}
+
+TEST(OpenMetricsTest, WritesHistograms) {
+    openmetrics_writer_t writer;
+
+    writer.family("typesense_task_seconds", "histogram", "Time taken by tasks.");
+    writer.histogram("typesense_task_seconds", {{"kind", "search"}}, {{0.001, 3}, {0.01, 0}, {0.1, 2}}, 1, 1.5);
+
+    std::string expected = "# TYPE typesense_task_seconds histogram\n"
+                           "# HELP typesense_task_seconds Time taken by tasks.\n"
+                           "typesense_task_seconds_bucket{kind=\"search\",le=\"0.001\"} 3\n"
+                           "typesense_task_seconds_bucket{kind=\"search\",le=\"0.01\"} 3\n"
+                           "typesense_task_seconds_bucket{kind=\"search\",le=\"0.1\"} 5\n"
+                           "typesense_task_seconds_bucket{kind=\"search\",le=\"+Inf\"} 6\n"
+                           "typesense_task_seconds_count{kind=\"search\"} 6\n"
+                           "typesense_task_seconds_sum{kind=\"search\"} 1.5\n"
+                           "# EOF\n";
+
+    ASSERT_EQ(expected, writer.finish());
+}
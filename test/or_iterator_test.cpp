@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include <or_iterator.h>
 #include <posting_list.h>
+#include <random>
+#include <set>
 #include "logger.h"
 
 TEST(OrIteratorTest, IntersectTwoListsWith3SubLists) {
@@ -256,3 +258,175 @@ TEST(OrIteratorTest, IntersectAndFilterTwoIts) {
     delete p1;
     delete p2;
 }
+
+TEST(OrIteratorTest, IntersectExcludesIds) {
+    std::vector<uint32_t> offsets = {0, 1, 3};
+
+    posting_list_t* p1 = new posting_list_t(4);
+    posting_list_t* p2 = new posting_list_t(4);
+
+    for(uint32_t id = 0; id < 50; id++) {
+        p1->upsert(id, offsets);
+        if(id % 2 == 0) {
+            p2->upsert(id, offsets);
+        }
+    }
+
+    std::vector<uint32_t> excluded_ids = {0, 1, 2, 10, 11, 30, 48, 100};
+
+    // the state is reused in the second round, so the exclusions have to be probed from the start again
+    result_iter_state_t istate(&excluded_ids[0], excluded_ids.size(), nullptr, 0);
+
+    for(size_t round = 0; round < 2; round++) {
+        std::vector<posting_list_t::iterator_t> pits1;
+        std::vector<posting_list_t::iterator_t> pits2;
+        pits1.push_back(p1->new_iterator());
+        pits2.push_back(p2->new_iterator());
+
+        std::vector<or_iterator_t> or_its;
+        or_its.emplace_back(pits1);
+        or_its.emplace_back(pits2);
+
+        std::vector<uint32_t> results;
+        or_iterator_t::intersect(or_its, istate, [&results](uint32_t id, std::vector<or_iterator_t>& its) {
+            results.push_back(id);
+        });
+
+        std::vector<uint32_t> expected_results;
+        for(uint32_t id = 0; id < 50; id += 2) {
+            if(!std::binary_search(excluded_ids.begin(), excluded_ids.end(), id)) {
+                expected_results.push_back(id);
+            }
+        }
+
+        ASSERT_EQ(expected_results, results);
+    }
+
+    delete p1;
+    delete p2;
+}
+
+TEST(OrIteratorTest, IntersectSkipsPrunedBlocks) {
+    posting_list_t* p1 = new posting_list_t(4);
+    posting_list_t* p2 = new posting_list_t(4);
+
+    // documents in the second half have the token at the very first position
+    for(uint32_t id = 0; id < 40; id++) {
+        std::vector<uint32_t> offsets = {id < 20 ? 5u : 1u};
+        p1->upsert(id, offsets);
+        p2->upsert(id, offsets);
+    }
+
+    std::vector<posting_list_t::iterator_t> pits1;
+    std::vector<posting_list_t::iterator_t> pits2;
+    pits1.push_back(p1->new_iterator());
+    pits2.push_back(p2->new_iterator());
+
+    std::vector<or_iterator_t> or_its;
+    or_its.emplace_back(pits1);
+    or_its.emplace_back(pits2);
+
+    result_iter_state_t istate;
+    size_t num_pruned = 0;
+
+    auto pruner = [&num_pruned](std::vector<or_iterator_t>& its) {
+        uint32_t start_id, end_id;
+        if(!or_iterator_t::current_blocks_range(its, start_id, end_id)) {
+            return false;
+        }
+
+        for(const auto& it: its) {
+            for(const auto& sub_it: it.get_its()) {
+                if(sub_it.block()->has_first_position) {
+                    return false;
+                }
+            }
+        }
+
+        num_pruned++;
+        or_iterator_t::skip_all_to(its, end_id + 1);
+        return true;
+    };
+
+    std::vector<uint32_t> results;
+    or_iterator_t::intersect(or_its, istate, [&results](uint32_t id, std::vector<or_iterator_t>& its) {
+        results.push_back(id);
+    }, pruner);
+
+    ASSERT_EQ(20, results.size());
+    ASSERT_EQ(5, num_pruned);
+
+    for(size_t i = 0; i < results.size(); i++) {
+        ASSERT_EQ(20 + i, results[i]);
+    }
+
+    delete p1;
+    delete p2;
+}
+
+TEST(OrIteratorTest, LoserTreeMergeOfManyLists) {
+    std::vector<uint32_t> offsets = {0, 1, 3};
+    std::mt19937 gen(1729);
+    std::uniform_int_distribution<uint32_t> id_dist(0, 2000);
+
+    // some lists end early and are dropped from the tree while merging
+    std::vector<posting_list_t*> postings;
+    std::set<uint32_t> expected_ids;
+
+    for(size_t i = 0; i < 40; i++) {
+        postings.push_back(new posting_list_t(4));
+        size_t num_ids = (i % 5 == 0) ? 1 : 10 + (i * 7);
+
+        for(size_t j = 0; j < num_ids; j++) {
+            uint32_t id = (i % 3 == 0) ? id_dist(gen) / 10 : id_dist(gen);
+            postings.back()->upsert(id, offsets);
+            expected_ids.insert(id);
+        }
+    }
+
+    std::vector<posting_list_t::iterator_t> its;
+    for(auto& posting_list: postings) {
+        its.push_back(posting_list->new_iterator());
+    }
+
+    or_iterator_t it(its);
+    std::vector<uint32_t> results;
+
+    while(it.valid()) {
+        results.push_back(it.id());
+        it.next();
+    }
+
+    ASSERT_EQ(std::vector<uint32_t>(expected_ids.begin(), expected_ids.end()), results);
+
+    // skipping rebuilds the tree
+    std::vector<posting_list_t::iterator_t> its2;
+    for(auto& posting_list: postings) {
+        its2.push_back(posting_list->new_iterator());
+    }
+
+    or_iterator_t it2(its2);
+    it2.skip_to(1000);
+    results.clear();
+
+    while(it2.valid()) {
+        results.push_back(it2.id());
+        it2.next();
+    }
+
+    ASSERT_EQ(std::vector<uint32_t>(expected_ids.lower_bound(1000), expected_ids.end()), results);
+
+    // bounded merge
+    std::vector<posting_list_t::iterator_t> its3;
+    for(auto& posting_list: postings) {
+        its3.push_back(posting_list->new_iterator());
+    }
+
+    results.clear();
+    or_iterator_t::merge(its3, results, 500);
+    ASSERT_EQ(std::vector<uint32_t>(expected_ids.begin(), expected_ids.upper_bound(500)), results);
+
+    for(auto p: postings) {
+        delete p;
+    }
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "override_index.h"
+#include "string_utils.h"
+
+TEST(OverrideIndexTest, MatchExactAndContainsRules) {
+    override_index_t index;
+    index.insert("exact-1", "red shoes", true);
+    index.insert("contains-1", "shoes", false);
+    index.insert("contains-2", "red", false);
+    index.insert("contains-3", "red shoes for", false);
+    index.insert("contains-4", "hoes", false);
+
+    std::vector<std::string> ids;
+    index.match("red shoes", ids);
+    ASSERT_EQ(std::vector<std::string>({"contains-1", "contains-2", "exact-1"}), ids);
+
+    index.match("cheap red shoes for men", ids);
+    ASSERT_EQ(std::vector<std::string>({"contains-1", "contains-2", "contains-3"}), ids);
+
+    index.match("horseshoes", ids);
+    ASSERT_TRUE(ids.empty());
+
+    // only a rule's first occurrence counts, as with `StringUtils::contains_word()`
+    index.match("redder red", ids);
+    ASSERT_TRUE(ids.empty());
+
+    index.remove("contains-2", "red", false);
+    index.remove("exact-1", "red shoes", true);
+    index.remove("missing", "blue", false);
+    index.match("red shoes", ids);
+    ASSERT_EQ(std::vector<std::string>({"contains-1"}), ids);
+}
+
+TEST(OverrideIndexTest, MatchesContainsWordOverRules) {
+    override_index_t index;
+    std::mt19937 gen(3);
+    std::vector<std::string> words = {"a", "b", "ab", "ba", ""};
+    std::uniform_int_distribution<int> word_dist(0, words.size() - 1), len_dist(1, 3);
+
+    auto random_text = [&](size_t len) {
+        std::vector<std::string> text_words;
+        for(size_t i = 0; i < len; i++) {
+            text_words.push_back(words[word_dist(gen)]);
+        }
+        return StringUtils::join(text_words, " ");
+    };
+
+    std::vector<std::pair<std::string, bool>> rules;
+    for(size_t i = 0; i < 200; i++) {
+        rules.emplace_back(random_text(len_dist(gen)), i % 4 == 0);
+        index.insert(std::to_string(1000 + i), rules.back().first, rules.back().second);
+    }
+
+    for(size_t q = 0; q < 500; q++) {
+        const std::string query = random_text(len_dist(gen) + 2);
+
+        std::vector<std::string> expected_ids;
+        for(size_t i = 0; i < rules.size(); i++) {
+            if(rules[i].second ? (rules[i].first == query) : StringUtils::contains_word(query, rules[i].first)) {
+                expected_ids.push_back(std::to_string(1000 + i));
+            }
+        }
+
+        std::vector<std::string> ids;
+        index.match(query, ids);
+        ASSERT_EQ(expected_ids, ids) << query;
+    }
+}
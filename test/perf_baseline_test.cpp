@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <json.hpp>
+#include "perf_baseline.h"
+
+TEST(PerfBaselineTest, ParseResults) {
+    nlohmann::json results = R"({
+        "context": {"num_cpus": 1},
+        "benchmarks": [
+            {"name": "BM_A/10", "run_name": "BM_A/10", "run_type": "iteration", "cpu_time": 100, "time_unit": "ns"},
+            {"name": "BM_A/10_mean", "run_name": "BM_A/10", "run_type": "aggregate", "aggregate_name": "mean",
+             "cpu_time": 300, "time_unit": "ns"},
+            {"name": "BM_A/10_median", "run_name": "BM_A/10", "run_type": "aggregate", "aggregate_name": "median",
+             "cpu_time": 200, "time_unit": "ns"},
+            {"name": "BM_A/10", "run_name": "BM_A/10", "run_type": "iteration", "cpu_time": 900, "time_unit": "ns"},
+            {"name": "BM_B", "cpu_time": 2.5, "time_unit": "ms"},
+            {"name": "BM_C", "cpu_time": 0, "error_occurred": true}
+        ]
+    })"_json;
+
+    std::map<std::string, double> cpu_times;
+    ASSERT_TRUE(PerfBaseline::parse_results(results, cpu_times).ok());
+
+    // the median stands for the repetitions
+    ASSERT_EQ(2, cpu_times.size());
+    ASSERT_EQ(200, cpu_times["BM_A/10"]);
+    ASSERT_EQ(2500000, cpu_times["BM_B"]);
+
+    results["benchmarks"].push_back(R"({"name": "BM_D", "cpu_time": 1, "time_unit": "days"})"_json);
+    ASSERT_FALSE(PerfBaseline::parse_results(results, cpu_times).ok());
+
+    ASSERT_FALSE(PerfBaseline::parse_results(R"({"benchmarks": {}})"_json, cpu_times).ok());
+}
+
+TEST(PerfBaselineTest, CompareWithTolerances) {
+    nlohmann::json baseline = R"({
+        "tolerance": 0.2,
+        "benchmarks": {
+            "BM_Fast": {"cpu_time_ns": 1000},
+            "BM_Noisy": {"cpu_time_ns": 1000, "tolerance": 0.5},
+            "BM_Slow": {"cpu_time_ns": 1000},
+            "BM_Better": {"cpu_time_ns": 1000},
+            "BM_Renamed": {"cpu_time_ns": 1000}
+        }
+    })"_json;
+
+    std::map<std::string, double> cpu_times = {
+        {"BM_Fast", 1150}, {"BM_Noisy", 1400}, {"BM_Slow", 1300}, {"BM_Better", 500}, {"BM_New", 10}
+    };
+
+    std::vector<perf_comparison_t> comparisons;
+    ASSERT_TRUE(PerfBaseline::compare(baseline, cpu_times, comparisons).ok());
+    ASSERT_EQ(5, comparisons.size());
+
+    std::map<std::string, perf_comparison_t> comparison_map;
+    for(const auto& comparison: comparisons) {
+        comparison_map[comparison.name] = comparison;
+    }
+
+    ASSERT_EQ(perf_comparison_t::OK, comparison_map["BM_Fast"].status);
+    ASSERT_EQ(perf_comparison_t::OK, comparison_map["BM_Noisy"].status);
+    ASSERT_EQ(0.5, comparison_map["BM_Noisy"].tolerance);
+    ASSERT_EQ(perf_comparison_t::REGRESSED, comparison_map["BM_Slow"].status);
+    ASSERT_DOUBLE_EQ(1.3, comparison_map["BM_Slow"].ratio());
+    ASSERT_EQ(perf_comparison_t::IMPROVED, comparison_map["BM_Better"].status);
+    ASSERT_EQ(perf_comparison_t::MISSING, comparison_map["BM_Renamed"].status);
+    ASSERT_TRUE(PerfBaseline::has_failed(comparisons));
+
+    comparisons.clear();
+    baseline["benchmarks"].erase("BM_Slow");
+    baseline["benchmarks"].erase("BM_Renamed");
+    ASSERT_TRUE(PerfBaseline::compare(baseline, cpu_times, comparisons).ok());
+    ASSERT_FALSE(PerfBaseline::has_failed(comparisons));
+
+    baseline["benchmarks"]["BM_Broken"] = R"({"tolerance": 0.1})"_json;
+    ASSERT_FALSE(PerfBaseline::compare(baseline, cpu_times, comparisons).ok());
+}
+
+TEST(PerfBaselineTest, Update) {
+    nlohmann::json baseline = R"({
+        "tolerance": 0.2,
+        "benchmarks": {
+            "BM_Noisy": {"cpu_time_ns": 1000, "tolerance": 0.5},
+            "BM_Kept": {"cpu_time_ns": 1000}
+        }
+    })"_json;
+
+    nlohmann::json updated = PerfBaseline::update(baseline, {{"BM_Noisy", 1234.7}, {"BM_New", 10}});
+
+    ASSERT_EQ(0.2, updated["tolerance"].get<double>());
+    ASSERT_EQ(1234, updated["benchmarks"]["BM_Noisy"]["cpu_time_ns"].get<uint64_t>());
+    ASSERT_EQ(0.5, updated["benchmarks"]["BM_Noisy"]["tolerance"].get<double>());
+    ASSERT_EQ(1000, updated["benchmarks"]["BM_Kept"]["cpu_time_ns"].get<uint64_t>());
+    ASSERT_EQ(10, updated["benchmarks"]["BM_New"]["cpu_time_ns"].get<uint64_t>());
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <algorithm>
+#include "posting_codec.h"
+
+static std::vector<uint32_t> random_sorted_ids(std::mt19937& gen, size_t n, uint32_t max_gap) {
+    std::uniform_int_distribution<uint32_t> gap_dist(1, max_gap);
+    std::vector<uint32_t> ids;
+    uint32_t id = 0;
+
+    for(size_t i = 0; i < n; i++) {
+        id += gap_dist(gen);
+        ids.push_back(id);
+    }
+
+    return ids;
+}
+
+TEST(PostingCodecTest, ParseAndName) {
+    posting_codec_t codec;
+
+    ASSERT_TRUE(PostingCodec::parse("stream_vbyte", codec));
+    ASSERT_EQ(STREAM_VBYTE_CODEC, codec);
+    ASSERT_TRUE(PostingCodec::parse("roaring", codec));
+    ASSERT_EQ(ROARING_CODEC, codec);
+    ASSERT_TRUE(PostingCodec::parse("for", codec));
+    ASSERT_EQ(FOR_CODEC, codec);
+    ASSERT_FALSE(PostingCodec::parse("pfor", codec));
+
+    for(auto c: PostingCodec::codecs()) {
+        ASSERT_TRUE(PostingCodec::parse(PostingCodec::name(c), codec));
+        ASSERT_EQ(c, codec);
+    }
+}
+
+TEST(PostingCodecTest, RoundTripAllCodecs) {
+    std::mt19937 gen(137723);
+
+    // sparse, dense and mixed gaps, along with lengths that don't align with the group size of 4
+    std::vector<std::pair<size_t, uint32_t>> shapes = {
+        {0, 1}, {1, 1}, {3, 2}, {7, 300}, {256, 1}, {257, 70000}, {5000, 3}, {10000, 1 << 18}
+    };
+
+    for(auto& shape: shapes) {
+        std::vector<uint32_t> ids = random_sorted_ids(gen, shape.first, shape.second);
+
+        for(auto codec: PostingCodec::codecs()) {
+            std::vector<uint8_t> encoded = {42};  // encoding must append to existing contents
+            size_t num_bytes = PostingCodec::encode(codec, ids.data(), ids.size(), encoded);
+            ASSERT_EQ(num_bytes + 1, encoded.size());
+
+            std::vector<uint32_t> decoded(ids.size());
+            size_t num_read = PostingCodec::decode(codec, encoded.data() + 1, ids.size(), decoded.data());
+
+            ASSERT_EQ(ids, decoded) << PostingCodec::name(codec) << ", n: " << ids.size();
+
+            if(codec != FOR_CODEC) {
+                ASSERT_EQ(num_bytes, num_read);
+            }
+        }
+    }
+}
+
+TEST(PostingCodecTest, StreamVByteMatchesScalarDecode) {
+    std::mt19937 gen(9021);
+
+    for(size_t n = 0; n < 200; n++) {
+        std::vector<uint32_t> ids = random_sorted_ids(gen, n, (n % 4 == 0) ? 10 : (1 << 26) / (n + 1));
+
+        std::vector<uint8_t> encoded;
+        size_t num_bytes = PostingCodec::stream_vbyte_encode(ids.data(), ids.size(), encoded);
+
+        std::vector<uint32_t> decoded(n), decoded_scalar(n);
+        ASSERT_EQ(num_bytes, PostingCodec::stream_vbyte_decode(encoded.data(), n, decoded.data()));
+        ASSERT_EQ(num_bytes, PostingCodec::stream_vbyte_decode_scalar(encoded.data(), n, decoded_scalar.data()));
+
+        ASSERT_EQ(ids, decoded);
+        ASSERT_EQ(ids, decoded_scalar);
+    }
+}
+
+TEST(PostingCodecTest, RoaringUsesBitmapsForDenseIds) {
+    std::vector<uint32_t> ids;
+    for(uint32_t id = 0; id < 60000; id++) {
+        ids.push_back(id);
+    }
+
+    std::vector<uint8_t> encoded;
+    size_t num_bytes = PostingCodec::roaring_encode(ids.data(), ids.size(), encoded);
+
+    // single 8KB bitmap container with its header
+    ASSERT_EQ(4 + 8192, num_bytes);
+
+    std::vector<uint32_t> decoded(ids.size());
+    PostingCodec::roaring_decode(encoded.data(), ids.size(), decoded.data());
+    ASSERT_EQ(ids, decoded);
+}
@@ -3,6 +3,7 @@
 #include "array_utils.h"
 #include <chrono>
 #include <vector>
+#include <set>
 
 class PostingListTest : public ::testing::Test {
 protected:
@@ -600,6 +601,45 @@ TEST_F(PostingListTest, MergeBasics) {
     }
 }
 
+TEST_F(PostingListTest, ParallelMergeMatchesSerialMerge) {
+    std::vector<uint32_t> offsets = {0, 1, 3};
+    std::vector<posting_list_t*> lists;
+    std::set<uint32_t> expected_ids;
+
+    // enough IDs across the lists to be split into ranges
+    for(size_t i = 0; i < 5; i++) {
+        posting_list_t* list = new posting_list_t(256);
+        for(uint32_t id = i; id < 150000; id += (i + 2)) {
+            list->upsert(id, offsets);
+            expected_ids.insert(id);
+        }
+        lists.push_back(list);
+    }
+
+    uint32_t ids[] = {3, 149999, 200000};
+    uint32_t offset_index[] = {0, 3, 6};
+    uint32_t compact_offsets[] = {0, 1, 3, 0, 1, 3, 0, 1, 3};
+    compact_posting_list_t* compact_list = compact_posting_list_t::create(3, ids, offset_index, 9, compact_offsets);
+    expected_ids.insert(std::begin(ids), std::end(ids));
+
+    std::vector<void*> raw_lists(lists.begin(), lists.end());
+    raw_lists.push_back(SET_COMPACT_POSTING(compact_list));
+
+    std::vector<uint32_t> result_ids;
+    posting_t::merge(raw_lists, result_ids, pool);
+    ASSERT_EQ(std::vector<uint32_t>(expected_ids.begin(), expected_ids.end()), result_ids);
+
+    std::vector<uint32_t> serial_result_ids;
+    posting_t::merge(raw_lists, serial_result_ids);
+    ASSERT_EQ(serial_result_ids, result_ids);
+
+    for(auto list: lists) {
+        delete list;
+    }
+
+    compact_posting_list_t::destroy(compact_list);
+}
+
 TEST_F(PostingListTest, IntersectionBasics) {
     std::vector<uint32_t> offsets = {0, 1, 3};
 
@@ -1097,7 +1137,7 @@ TEST_F(PostingListTest, CompactPostingListUpserts) {
         ASSERT_EQ(expected_id_offsets[i], COMPACT_POSTING_PTR(obj)->id_offsets[i]);
     }
 
-    free(COMPACT_POSTING_PTR(obj));
+    compact_posting_list_t::destroy(COMPACT_POSTING_PTR(obj));
 }
 
 TEST_F(PostingListTest, CompactPostingListUpdateWithLessOffsets) {
@@ -1145,7 +1185,7 @@ TEST_F(PostingListTest, CompactPostingListUpdateWithLessOffsets) {
         ASSERT_EQ(expected_id_offsets3[i], list->id_offsets[i]);
     }
 
-    free(list);
+    compact_posting_list_t::destroy(list);
 }
 
 TEST_F(PostingListTest, CompactPostingListUpdateWithMoreOffsets) {
@@ -1194,7 +1234,7 @@ TEST_F(PostingListTest, CompactPostingListUpdateWithMoreOffsets) {
         ASSERT_EQ(expected_id_offsets3[i], list->id_offsets[i]);
     }
 
-    free(list);
+    compact_posting_list_t::destroy(list);
 }
 
 TEST_F(PostingListTest, CompactPostingListErase) {
@@ -1234,7 +1274,7 @@ TEST_F(PostingListTest, CompactPostingListErase) {
     ASSERT_EQ(1002, list->last_id());
     ASSERT_EQ(2, list->num_ids());
 
-    free(list);
+    compact_posting_list_t::destroy(list);
 }
 
 TEST_F(PostingListTest, CompactPostingListContainsAtleastOne) {
@@ -1248,10 +1288,9 @@ TEST_F(PostingListTest, CompactPostingListContainsAtleastOne) {
     compact_posting_list_t* list1 = compact_posting_list_t::create(4, ids, offset_index, 12, offsets);
     ASSERT_TRUE(list1->contains_atleast_one(&target_ids1[0], target_ids1.size()));
     ASSERT_FALSE(list1->contains_atleast_one(&target_ids2[0], target_ids2.size()));
-    free(list1);
+    compact_posting_list_t::destroy(list1);
 
-    compact_posting_list_t* list2 = static_cast<compact_posting_list_t*>(malloc(sizeof(compact_posting_list_t)));
-    list2->capacity = list2->ids_length = list2->length = 0;
+    compact_posting_list_t* list2 = compact_posting_list_t::create(0, nullptr, nullptr, 0, nullptr);
     void* obj = SET_COMPACT_POSTING(list2);
     posting_t::upsert(obj, 3, {1, 5});
 
@@ -1281,10 +1320,265 @@ TEST_F(PostingListTest, CompactToFullPostingListConversion) {
     ASSERT_EQ(4, c1->num_ids());
     ASSERT_EQ(4, p1->num_ids());
 
-    free(c1);
+    compact_posting_list_t::destroy(c1);
     delete p1;
 }
 
+TEST_F(PostingListTest, AppendSortedFillsBlocks) {
+    posting_list_t list(4);
+    list.upsert(1, {0, 1});
+
+    std::vector<uint32_t> ids, offset_index, offsets;
+    for(uint32_t id = 2; id < 12; id++) {
+        ids.push_back(id);
+        offset_index.push_back(offsets.size());
+        for(uint32_t j = 0; j <= id % 3; j++) {
+            offsets.push_back(id + j);
+        }
+    }
+
+    list.append_sorted(ids.data(), ids.size(), offset_index.data(), offsets.data(), offsets.size());
+
+    // root block is topped up first: [1, 2, 3, 4] [5, 6, 7, 8] [9, 10, 11]
+    ASSERT_EQ(11, list.num_ids());
+    ASSERT_EQ(3, list.num_blocks());
+    ASSERT_EQ(4, list.get_root()->size());
+    ASSERT_EQ(3, list.get_root()->next->next->size());
+    ASSERT_EQ(11, list.last_id());
+    ASSERT_EQ(list.get_root()->next->next, list.block_of(11));
+
+    // must be identical to a list that is built one ID at a time
+    posting_list_t expected(4);
+    expected.upsert(1, {0, 1});
+    for(size_t i = 0; i < ids.size(); i++) {
+        uint32_t end = (i == ids.size() - 1) ? offsets.size() : offset_index[i + 1];
+        expected.upsert(ids[i], std::vector<uint32_t>(offsets.begin() + offset_index[i], offsets.begin() + end));
+    }
+
+    auto it = list.new_iterator();
+    auto expected_it = expected.new_iterator();
+
+    while(expected_it.valid()) {
+        ASSERT_TRUE(it.valid());
+        ASSERT_EQ(expected_it.id(), it.id());
+
+        posting_list_t::block_t* block = it.block();
+        posting_list_t::block_t* expected_block = expected_it.block();
+        uint32_t index = it.index(), expected_index = expected_it.index();
+
+        uint32_t start = it.get_offset_index()[index];
+        uint32_t end = (index == block->size() - 1) ? block->offsets.getLength() :
+                       it.get_offset_index()[index + 1];
+        uint32_t expected_start = expected_it.get_offset_index()[expected_index];
+        uint32_t expected_end = (expected_index == expected_block->size() - 1) ?
+                                expected_block->offsets.getLength() : expected_it.get_offset_index()[expected_index + 1];
+
+        const uint32_t* offsets = it.get_offsets();
+        const uint32_t* expected_offsets = expected_it.get_offsets();
+
+        ASSERT_EQ(std::vector<uint32_t>(expected_offsets + expected_start, expected_offsets + expected_end),
+                  std::vector<uint32_t>(offsets + start, offsets + end));
+
+        it.next();
+        expected_it.next();
+    }
+
+    ASSERT_FALSE(it.valid());
+}
+
+TEST_F(PostingListTest, CompactRepacksHalfEmptyBlocks) {
+    posting_list_t list(4);
+    posting_list_t expected(4);
+
+    // the second round of upserts land in the middle of full blocks and split them
+    for(uint32_t round = 0; round < 2; round++) {
+        for(uint32_t id = 1; id <= 60; id++) {
+            list.upsert(id * 3 - round, {id, id + 1});
+            expected.upsert(id * 3 - round, {id, id + 1});
+        }
+    }
+
+    const size_t num_blocks = list.num_blocks();
+    ASSERT_LT(30, num_blocks);
+    ASSERT_TRUE(list.is_fragmented());
+
+    ASSERT_EQ(num_blocks - 30, posting_t::compact(&list));
+    ASSERT_EQ(30, list.num_blocks());
+    ASSERT_FALSE(list.is_fragmented());
+    ASSERT_EQ(0, list.compact());
+
+    for(uint32_t id = 1; id <= 60; id++) {
+        ASSERT_TRUE(list.contains(id * 3));
+        ASSERT_TRUE(list.contains(id * 3 - 1));
+        ASSERT_FALSE(list.contains(id * 3 - 2));
+    }
+
+    // compacted list must continue to be updated like any other list
+    list.erase(21);
+    expected.erase(21);
+    list.upsert(22, {7});
+    expected.upsert(22, {7});
+
+    auto it = list.new_iterator();
+    auto expected_it = expected.new_iterator();
+
+    while(expected_it.valid()) {
+        ASSERT_TRUE(it.valid());
+        ASSERT_EQ(expected_it.id(), it.id());
+
+        uint32_t index = it.index(), expected_index = expected_it.index();
+        uint32_t end = (index == it.block()->size() - 1) ? it.block()->offsets.getLength() :
+                       it.get_offset_index()[index + 1];
+        uint32_t expected_end = (expected_index == expected_it.block()->size() - 1) ?
+                                expected_it.block()->offsets.getLength() :
+                                expected_it.get_offset_index()[expected_index + 1];
+
+        ASSERT_EQ(std::vector<uint32_t>(expected_it.get_offsets() + expected_it.get_offset_index()[expected_index],
+                                        expected_it.get_offsets() + expected_end),
+                  std::vector<uint32_t>(it.get_offsets() + it.get_offset_index()[index], it.get_offsets() + end));
+
+        it.next();
+        expected_it.next();
+    }
+
+    ASSERT_FALSE(it.valid());
+    ASSERT_EQ(expected.num_ids(), list.num_ids());
+    ASSERT_EQ(180, list.last_id());
+}
+
+TEST_F(PostingListTest, IteratorDecompressesOffsetsOnDemand) {
+    posting_list_t list(4);
+    for(uint32_t id = 0; id < 20; id++) {
+        list.upsert(id, {id * 10, id * 10 + 1});
+    }
+
+    auto offsets_of = [](const posting_list_t::iterator_t& it) {
+        const uint32_t* offset_index = it.get_offset_index();
+        return std::vector<uint32_t>{it.get_offsets()[offset_index[it.index()]],
+                                     it.get_offsets()[offset_index[it.index()] + 1]};
+    };
+
+    auto it = list.new_iterator();
+
+    // offsets of a block are never touched while moving across it
+    it.next();
+    it.next();
+    ASSERT_EQ(2, it.id());
+    ASSERT_EQ(std::vector<uint32_t>({20, 21}), offsets_of(it));
+
+    it.next();
+    it.next();
+    ASSERT_EQ(4, it.id());
+    ASSERT_EQ(std::vector<uint32_t>({40, 41}), offsets_of(it));
+
+    it.skip_to(13);
+    ASSERT_EQ(13, it.id());
+    ASSERT_EQ(std::vector<uint32_t>({130, 131}), offsets_of(it));
+
+    auto cloned = it.clone();
+    ASSERT_EQ(std::vector<uint32_t>({130, 131}), offsets_of(cloned));
+
+    ASSERT_TRUE(it.skip_to_exact(17));
+    ASSERT_EQ(std::vector<uint32_t>({170, 171}), offsets_of(it));
+
+    it.next();
+    it.next();
+    it.next();
+    ASSERT_FALSE(it.valid());
+}
+
+TEST_F(PostingListTest, UpsertSortedOnCompactAndFullLists) {
+    uint32_t ids[] = {5, 6};
+    uint32_t offset_index[] = {0, 1};
+    uint32_t offsets[] = {1, 2};
+
+    void* obj = SET_COMPACT_POSTING(compact_posting_list_t::create(2, ids, offset_index, 2, offsets));
+
+    // fits within a compact list: 6 is updated in-place and 7 is appended
+    uint32_t ids2[] = {6, 7};
+    uint32_t offset_index2[] = {0, 2};
+    uint32_t offsets2[] = {3, 4, 5};
+    posting_t::upsert_sorted(obj, 2, ids2, offset_index2, 3, offsets2);
+
+    ASSERT_TRUE(IS_COMPACT_POSTING(obj));
+    ASSERT_EQ(3, posting_t::num_ids(obj));
+    ASSERT_EQ(7, COMPACT_POSTING_PTR(obj)->last_id());
+
+    // too large for a compact list
+    std::vector<uint32_t> ids3, offset_index3, offsets3;
+    ids3.push_back(2);
+    offset_index3.push_back(0);
+    offsets3.push_back(1);
+
+    for(uint32_t id = 100; id < 700; id++) {
+        ids3.push_back(id);
+        offset_index3.push_back(offsets3.size());
+        offsets3.push_back(id % 7);
+    }
+
+    posting_t::upsert_sorted(obj, ids3.size(), ids3.data(), offset_index3.data(), offsets3.size(), offsets3.data());
+
+    ASSERT_FALSE(IS_COMPACT_POSTING(obj));
+    posting_list_t* list = (posting_list_t*) obj;
+    ASSERT_EQ(604, list->num_ids());
+    ASSERT_EQ(3, list->num_blocks());
+    ASSERT_EQ(256, list->get_root()->next->size());
+    ASSERT_TRUE(list->contains(2));
+    ASSERT_TRUE(list->contains(7));
+    ASSERT_TRUE(list->contains(699));
+    ASSERT_FALSE(list->contains(700));
+
+    posting_t::destroy_list(obj);
+}
+
+TEST_F(PostingListTest, EraseSortedOnCompactAndFullLists) {
+    uint32_t ids[] = {2, 5, 6, 9};
+    uint32_t offset_index[] = {0, 1, 3, 4};
+    uint32_t offsets[] = {1, 2, 3, 4, 5};
+
+    void* obj = SET_COMPACT_POSTING(compact_posting_list_t::create(4, ids, offset_index, 5, offsets));
+
+    // 7 is not in the list
+    uint32_t erase_ids[] = {2, 6, 7};
+    posting_t::erase_sorted(obj, 3, erase_ids);
+
+    ASSERT_TRUE(IS_COMPACT_POSTING(obj));
+    ASSERT_EQ(2, posting_t::num_ids(obj));
+    ASSERT_FALSE(posting_t::contains(obj, 2));
+    ASSERT_TRUE(posting_t::contains(obj, 5));
+    ASSERT_FALSE(posting_t::contains(obj, 6));
+    ASSERT_TRUE(posting_t::contains(obj, 9));
+    ASSERT_EQ(7, COMPACT_POSTING_PTR(obj)->length);
+    ASSERT_EQ(9, COMPACT_POSTING_PTR(obj)->last_id());
+
+    std::vector<uint32_t> ids2, offset_index2, offsets2;
+    for(uint32_t id = 100; id < 700; id++) {
+        ids2.push_back(id);
+        offset_index2.push_back(offsets2.size());
+        offsets2.push_back(id % 7);
+    }
+
+    posting_t::upsert_sorted(obj, ids2.size(), ids2.data(), offset_index2.data(), offsets2.size(), offsets2.data());
+    ASSERT_FALSE(IS_COMPACT_POSTING(obj));
+
+    // erasing all but a few IDs turns the list back into a compact one
+    std::vector<uint32_t> erase_ids2;
+    for(uint32_t id = 100; id < 698; id++) {
+        erase_ids2.push_back(id);
+    }
+
+    posting_t::erase_sorted(obj, erase_ids2.size(), erase_ids2.data());
+
+    ASSERT_TRUE(IS_COMPACT_POSTING(obj));
+    ASSERT_EQ(4, posting_t::num_ids(obj));
+    ASSERT_TRUE(posting_t::contains(obj, 5));
+    ASSERT_TRUE(posting_t::contains(obj, 698));
+    ASSERT_TRUE(posting_t::contains(obj, 699));
+    ASSERT_FALSE(posting_t::contains(obj, 100));
+
+    posting_t::destroy_list(obj);
+}
+
 TEST_F(PostingListTest, BlockIntersectionOnMixedLists) {
     uint32_t ids[] = {5, 6, 7, 8};
     uint32_t offset_index[] = {0, 3, 6, 9};
@@ -1317,7 +1611,202 @@ TEST_F(PostingListTest, BlockIntersectionOnMixedLists) {
     ASSERT_EQ(5, result_ids[0]);
     ASSERT_EQ(8, result_ids[1]);
 
-    free(list1);
+    compact_posting_list_t::destroy(list1);
+}
+
+TEST_F(PostingListTest, BlockIntersectionAcrossManyBlocks) {
+    posting_list_t p1(16);
+    posting_list_t p2(16);
+
+    std::vector<uint32_t> p1_ids, p2_ids;
+
+    for(uint32_t id = 0; id < 2000; id++) {
+        if(id % 3 == 0) {
+            p1_ids.push_back(id);
+            p1.upsert(id, {id % 7, id % 11});
+        }
+
+        if(id % 5 == 0 || (id > 1000 && id < 1100)) {
+            p2_ids.push_back(id);
+            p2.upsert(id, {id % 13});
+        }
+    }
+
+    std::vector<uint32_t> expected_ids;
+    std::set_intersection(p1_ids.begin(), p1_ids.end(), p2_ids.begin(), p2_ids.end(),
+                          std::back_inserter(expected_ids));
+
+    std::vector<uint32_t> result_ids;
+    posting_list_t::intersect({&p1, &p2}, result_ids);
+    ASSERT_EQ(expected_ids, result_ids);
+
+    result_ids.clear();
+    std::vector<void*> raw_posting_lists = {&p1, &p2};
+    result_iter_state_t iter_state;
+
+    posting_t::block_intersector_t(raw_posting_lists, iter_state, pool)
+    .intersect([&](auto seq_id, auto& its, size_t index) {
+        // iterators must point to the matched id so that offsets can be read
+        ASSERT_EQ(seq_id, its[0].id());
+        ASSERT_EQ(seq_id, its[1].id());
+        result_ids.push_back(seq_id);
+    });
+
+    ASSERT_EQ(expected_ids, result_ids);
+}
+
+TEST_F(PostingListTest, SkewedIntersection) {
+    posting_list_t rare(16);
+    posting_list_t common(16);
+    posting_list_t medium(16);
+
+    std::vector<uint32_t> rare_ids = {3, 17, 18, 400, 401, 999, 5000, 19999, 25000};
+
+    for(auto id: rare_ids) {
+        rare.upsert(id, {1, 2});
+    }
+
+    for(uint32_t id = 0; id < 20000; id++) {
+        if(id % 3 != 0) {
+            common.upsert(id, {1 + id % 5});
+        }
+
+        if(id % 2 != 0) {
+            medium.upsert(id, {1 + id % 7});
+        }
+    }
+
+    ASSERT_TRUE(posting_list_t::is_skewed({&common, &rare}));
+    ASSERT_FALSE(posting_list_t::is_skewed({&common, &medium}));
+
+    std::vector<uint32_t> result_ids;
+    posting_list_t::intersect({&common, &rare}, result_ids);
+    ASSERT_EQ(std::vector<uint32_t>({17, 400, 401, 5000, 19999}), result_ids);
+
+    result_ids.clear();
+    posting_list_t::intersect({&common, &rare, &medium}, result_ids);
+    ASSERT_EQ(std::vector<uint32_t>({17, 401, 19999}), result_ids);
+
+    result_ids.clear();
+    std::vector<void*> raw_posting_lists = {&common, &medium, &rare};
+    result_iter_state_t iter_state;
+
+    posting_t::block_intersector_t(raw_posting_lists, iter_state, pool)
+    .intersect([&](auto seq_id, auto& its, size_t index) {
+        for(auto& it: its) {
+            ASSERT_EQ(seq_id, it.id());
+        }
+
+        std::map<size_t, std::vector<token_positions_t>> array_token_positions;
+        posting_list_t::get_offsets(its, array_token_positions);
+        ASSERT_EQ(3, array_token_positions[0].size());
+
+        result_ids.push_back(seq_id);
+    });
+
+    ASSERT_EQ(std::vector<uint32_t>({17, 401, 19999}), result_ids);
+}
+
+TEST_F(PostingListTest, PhraseIntersection) {
+    posting_list_t new_list(2);
+    posting_list_t york_list(2);
+
+    new_list.upsert(1, {1});        // new york
+    york_list.upsert(1, {2, 0});
+
+    new_list.upsert(2, {2, 0});     // york new
+    york_list.upsert(2, {1});
+
+    new_list.upsert(3, {1, 2});     // new new york city
+    york_list.upsert(3, {3});
+
+    new_list.upsert(4, {1});        // new jersey york
+    york_list.upsert(4, {3, 0});
+
+    result_iter_state_t istate;
+    std::vector<uint32_t> phrase_ids;
+    posting_list_t::phrase_intersect({&new_list, &york_list}, false, istate, phrase_ids);
+    ASSERT_EQ(std::vector<uint32_t>({1, 3}), phrase_ids);
+
+    // repeated tokens
+    phrase_ids.clear();
+    posting_list_t::phrase_intersect({&new_list, &new_list}, false, istate, phrase_ids);
+    ASSERT_EQ(std::vector<uint32_t>({3}), phrase_ids);
+
+    phrase_ids.clear();
+    std::vector<uint32_t> filter_ids = {3, 4};
+    result_iter_state_t filter_state(nullptr, 0, filter_ids.data(), filter_ids.size());
+    posting_list_t::phrase_intersect({&new_list, &york_list}, false, filter_state, phrase_ids);
+    ASSERT_EQ(std::vector<uint32_t>({3}), phrase_ids);
+
+    // the tokens must be within the same element of an array
+    posting_list_t new_array_list(2);
+    posting_list_t york_array_list(2);
+
+    new_array_list.upsert(5, {1, 1, 0, 0});             // ["new", "york"]
+    york_array_list.upsert(5, {1, 1, 1, 0});
+
+    new_array_list.upsert(6, {1, 1, 0, 2, 2, 1});       // ["new", "big new york"]
+    york_array_list.upsert(6, {3, 3, 1, 0});
+
+    phrase_ids.clear();
+    posting_list_t::phrase_intersect({&new_array_list, &york_array_list}, true, istate, phrase_ids);
+    ASSERT_EQ(std::vector<uint32_t>({6}), phrase_ids);
+
+    // the order of the tokens holds when the shortest list drives the intersection
+    posting_list_t the_list(16);
+    posting_list_t end_list(16);
+
+    for(uint32_t id = 0; id < 20000; id++) {
+        the_list.upsert(id, {1});
+    }
+
+    end_list.upsert(5, {2, 0});
+    end_list.upsert(100, {3, 0});
+    end_list.upsert(7000, {2, 0});
+
+    ASSERT_TRUE(posting_list_t::is_skewed({&the_list, &end_list}));
+
+    phrase_ids.clear();
+    posting_list_t::phrase_intersect({&the_list, &end_list}, false, istate, phrase_ids);
+    ASSERT_EQ(std::vector<uint32_t>({5, 7000}), phrase_ids);
+
+    phrase_ids.clear();
+    posting_list_t::phrase_intersect({&end_list, &the_list}, false, istate, phrase_ids);
+    ASSERT_TRUE(phrase_ids.empty());
+}
+
+TEST_F(PostingListTest, BlockScoreBounds) {
+    posting_list_t list(4);
+
+    list.upsert(0, {6, 10});
+    list.upsert(2, {3, 0});
+    list.upsert(4, {300});
+
+    posting_list_t::block_t* root = list.get_root();
+    ASSERT_EQ(255, root->max_offset_score);
+    ASSERT_FALSE(root->has_first_position);
+
+    list.upsert(6, {1, 7, 0});
+    ASSERT_TRUE(root->has_first_position);
+
+    // bounds are carried over to the new block on split
+    list.upsert(5, {2});
+    ASSERT_EQ(2, list.num_blocks());
+    ASSERT_EQ(255, root->next->max_offset_score);
+    ASSERT_TRUE(root->next->has_first_position);
+
+    // appending to a new block only considers the appended document
+    list.upsert(10, {2});
+    list.upsert(11, {9});
+    list.upsert(12, {20});
+    ASSERT_EQ(3, list.num_blocks());
+    ASSERT_EQ(247, root->next->next->max_offset_score);
+    ASSERT_FALSE(root->next->next->has_first_position);
+
+    // erasing a document never lowers the bounds
+    list.erase(11);
+    ASSERT_EQ(247, root->next->next->max_offset_score);
 }
 
 TEST_F(PostingListTest, InsertAndEraseSequence) {
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "query_plan.h"
+
+TEST(QueryPlanTest, IntersectionOrderIsRarestFirst) {
+    std::vector<uint32_t> order;
+
+    query_plan_t::intersection_order({300, 5, 40, 5}, order);
+    ASSERT_EQ(std::vector<uint32_t>({1, 3, 2, 0}), order);
+
+    query_plan_t::intersection_order({}, order);
+    ASSERT_TRUE(order.empty());
+}
+
+TEST(QueryPlanTest, EstimateNumIds) {
+    ASSERT_EQ(0, query_plan_t::estimate_num_ids({}, 0));
+    ASSERT_EQ(5, query_plan_t::estimate_num_ids({300, 5, 40}, 0));
+    ASSERT_EQ(3, query_plan_t::estimate_num_ids({300, 5, 40}, 3));
+    ASSERT_EQ(5, query_plan_t::estimate_num_ids({300, 5, 40}, 100));
+}
+
+TEST(QueryPlanTest, ExplainOutputIsBounded) {
+    query_plan_t plan;
+
+    for(size_t i = 0; i < query_plan_t::MAX_EXPLAIN_STEPS + 10; i++) {
+        query_plan_step_t step;
+        step.tokens = {"hello", "world"};
+        step.token_num_ids = {10, 2};
+        query_plan_t::intersection_order(step.token_num_ids, step.intersection_order);
+        step.estimated_num_ids = query_plan_t::estimate_num_ids(step.token_num_ids, 0);
+        step.num_found = 1;
+        plan.add_step(std::move(step));
+    }
+
+    nlohmann::json plan_json = plan.to_json();
+    ASSERT_EQ(query_plan_t::MAX_EXPLAIN_STEPS + 10, plan_json["num_suggestions"].get<size_t>());
+    ASSERT_EQ(query_plan_t::MAX_EXPLAIN_STEPS, plan_json["suggestions"].size());
+
+    const auto& step_json = plan_json["suggestions"][0];
+    ASSERT_EQ("world", step_json["tokens"][1].get<std::string>());
+    ASSERT_EQ(1, step_json["intersection_order"][0].get<uint32_t>());
+    ASSERT_EQ(2, step_json["estimated_num_ids"].get<uint32_t>());
+    ASSERT_EQ(1, step_json["num_found"].get<size_t>());
+}
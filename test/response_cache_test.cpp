@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include "response_cache.h"
+
+static cached_res_t make_res(uint64_t hash, size_t body_size, uint32_t ttl = 60) {
+    cached_res_t res;
+    res.load(200, "application/json", std::string(body_size, 'x'), std::chrono::high_resolution_clock::now(),
+             ttl, hash);
+    return res;
+}
+
+TEST(ResponseCacheTest, GetInsertAndExpire) {
+    ResponseCache cache(1024 * 1024);
+    cached_res_t res;
+
+    ASSERT_FALSE(cache.get(1, res));
+    cache.insert(1, make_res(1, 100));
+    ASSERT_TRUE(cache.get(1, res));
+    ASSERT_EQ(100, res.body.size());
+    ASSERT_EQ(200, res.status_code);
+
+    // replacing an entry does not count it twice
+    cache.insert(1, make_res(1, 200));
+    ASSERT_EQ(1, cache.size());
+    ASSERT_TRUE(cache.get(1, res));
+    ASSERT_EQ(200, res.body.size());
+
+    cache.insert(2, make_res(2, 100, 0));
+    ASSERT_FALSE(cache.get(2, res));
+
+    ASSERT_EQ(2, cache.get_num_hits());
+    ASSERT_EQ(2, cache.get_num_misses());
+
+    cache.clear();
+    ASSERT_EQ(0, cache.size());
+    ASSERT_EQ(0, cache.bytes());
+}
+
+TEST(ResponseCacheTest, EvictsLeastRecentlyUsedByBytes) {
+    // 4 KB per stripe, so that an entry can be up to 512 bytes: small hashes all land on the first stripe
+    ResponseCache cache(ResponseCache::NUM_STRIPES * 4096);
+    cached_res_t res;
+
+    for(uint64_t i = 0; i < 100; i++) {
+        cache.insert(i, make_res(i, 300));
+        ASSERT_LE(cache.bytes(), ResponseCache::NUM_STRIPES * 4096);
+
+        // the first entry is kept in use, and so is never evicted
+        ASSERT_TRUE(cache.get(0, res));
+    }
+
+    ASSERT_LT(cache.size(), 100);
+    ASSERT_GT(cache.get_num_evictions(), 0);
+    ASSERT_TRUE(cache.get(99, res));
+    ASSERT_FALSE(cache.get(1, res));
+
+    // a response too large for its stripe is not admitted, and evicts nothing
+    const size_t num_entries = cache.size();
+    const uint64_t num_evictions = cache.get_num_evictions();
+    cache.insert(1000, make_res(1000, 4096));
+
+    ASSERT_FALSE(cache.get(1000, res));
+    ASSERT_EQ(1, cache.get_num_rejections());
+    ASSERT_EQ(num_entries, cache.size());
+    ASSERT_EQ(num_evictions, cache.get_num_evictions());
+
+    // shrinking the budget evicts down to it
+    cache.set_max_bytes(ResponseCache::NUM_STRIPES * 1024);
+    ASSERT_LE(cache.bytes(), ResponseCache::NUM_STRIPES * 1024);
+}
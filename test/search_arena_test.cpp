@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "search_arena.h"
+#include "topster.h"
+
+TEST(SearchArenaTest, AllocateAndRewind) {
+    search_arena_t arena;
+    ASSERT_EQ(0, arena.num_blocks());
+
+    auto small = static_cast<char*>(arena.allocate(3, 1));
+    auto aligned = arena.allocate_array<uint64_t>(10);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(aligned) % alignof(uint64_t));
+    ASSERT_LE(small + 3, reinterpret_cast<char*>(aligned));
+    ASSERT_EQ(1, arena.num_blocks());
+
+    const auto mark = arena.mark();
+    auto first = arena.allocate_array<uint32_t>(100);
+
+    // larger than the blocks so far
+    auto large = arena.allocate_array<uint32_t>(search_arena_t::FIRST_BLOCK_BYTES);
+    ASSERT_EQ(2, arena.num_blocks());
+    large[search_arena_t::FIRST_BLOCK_BYTES - 1] = 42;
+
+    const size_t reserved_bytes = arena.reserved_bytes();
+    ASSERT_LE(search_arena_t::FIRST_BLOCK_BYTES * 5, reserved_bytes);
+
+    // the same memory is handed out again once rewound, without any more blocks
+    arena.rewind(mark);
+    ASSERT_EQ(first, arena.allocate_array<uint32_t>(100));
+    ASSERT_EQ(large, arena.allocate_array<uint32_t>(search_arena_t::FIRST_BLOCK_BYTES));
+    ASSERT_EQ(reserved_bytes, arena.reserved_bytes());
+}
+
+TEST(SearchArenaTest, ScopesAndScratchOfThread) {
+    // without an arena the heap is used
+    {
+        search_scratch_t<uint32_t> ids(10);
+        ids.data[9] = 1;
+        ASSERT_EQ(nullptr, ids.scope.arena);
+    }
+
+    search_arena_t arena;
+    search_arena = &arena;
+
+    uint32_t* scratch_ids;
+
+    {
+        search_arena_scope_t scope;
+        search_scratch_t<uint32_t> ids(10);
+        scratch_ids = ids.data;
+
+        search_scratch_t<uint32_t> more_ids(10);
+        ASSERT_NE(scratch_ids, more_ids.data);
+    }
+
+    {
+        search_scratch_t<uint32_t> ids(10);
+        ASSERT_EQ(scratch_ids, ids.data);
+    }
+
+    search_arena = nullptr;
+    ASSERT_EQ(1, arena.num_blocks());
+}
+
+TEST(SearchArenaTest, TopsterOffArena) {
+    search_arena_t arena;
+    Topster heap_topster(50);
+    Topster arena_topster(50, 0, &arena);
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<uint64_t> key_dist(0, 500);
+    std::uniform_int_distribution<int64_t> score_dist(0, 1000);
+
+    for(size_t i = 0; i < 5000; i++) {
+        int64_t scores[3] = {score_dist(gen), score_dist(gen), 0};
+        KV kv(0, 0, 0, key_dist(gen), 0, 0, scores);
+        heap_topster.add(&kv);
+        arena_topster.add(&kv);
+    }
+
+    heap_topster.sort();
+    arena_topster.sort();
+
+    ASSERT_EQ(heap_topster.size, arena_topster.size);
+    for(size_t i = 0; i < heap_topster.size; i++) {
+        ASSERT_EQ(heap_topster.getKeyAt(i), arena_topster.getKeyAt(i));
+    }
+
+    ASSERT_EQ(1, arena.num_blocks());
+}
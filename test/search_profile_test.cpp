@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "search_profile.h"
+
+TEST(SearchProfileTest, TimersAndCountersAreRecordedOnlyWhenProfiling) {
+    search_profile_t profile;
+
+    {
+        search_profile = nullptr;
+        search_stage_timer_t timer(search_profile_t::FILTER);
+        search_profile_add(search_profile_t::STORE_READS, 3);
+    }
+
+    ASSERT_EQ(0, profile.stage_nanos[search_profile_t::FILTER].load());
+    ASSERT_EQ(0, profile.counters[search_profile_t::STORE_READS].load());
+
+    search_profile = &profile;
+
+    {
+        search_stage_timer_t timer(search_profile_t::FILTER);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        search_profile_add(search_profile_t::STORE_READS, 3);
+        search_profile_add(search_profile_t::STORE_READS);
+    }
+
+    search_profile = nullptr;
+
+    ASSERT_GE(profile.stage_nanos[search_profile_t::FILTER].load(), 2000000);
+    ASSERT_EQ(0, profile.stage_nanos[search_profile_t::FACETS].load());
+    ASSERT_EQ(4, profile.counters[search_profile_t::STORE_READS].load());
+
+    nlohmann::json profile_json = profile.to_json();
+    ASSERT_EQ(search_profile_t::NUM_STAGES, profile_json["stages_ms"].size());
+    ASSERT_EQ(search_profile_t::NUM_COUNTERS, profile_json["counters"].size());
+    ASSERT_GE(profile_json["stages_ms"]["filter"].get<double>(), 2.0);
+    ASSERT_EQ(0, profile_json["stages_ms"]["hydration"].get<double>());
+    ASSERT_EQ(4, profile_json["counters"]["store_reads"].get<uint64_t>());
+    ASSERT_EQ(0, profile_json["counters"]["blocks_decompressed"].get<uint64_t>());
+}
+
+TEST(SearchProfileTest, ThreadsAddToTheSameProfile) {
+    search_profile_t profile;
+    std::vector<std::thread> threads;
+
+    for(size_t i = 0; i < 4; i++) {
+        threads.emplace_back([&profile]() {
+            search_profile = &profile;
+            for(size_t j = 0; j < 1000; j++) {
+                search_profile_add(search_profile_t::BLOCKS_DECOMPRESSED);
+            }
+            search_profile = nullptr;
+        });
+    }
+
+    for(auto& thread: threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(4000, profile.counters[search_profile_t::BLOCKS_DECOMPRESSED].load());
+}
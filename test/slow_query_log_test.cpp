@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include "mpsc_ring.h"
+#include "slow_query_log.h"
+
+TEST(MpscRingTest, PushPopAndFull) {
+    mpsc_ring_t<int> ring(4);
+    int value;
+
+    ASSERT_FALSE(ring.pop(value));
+
+    for(int i = 0; i < 4; i++) {
+        ASSERT_TRUE(ring.push(int(i)));
+    }
+
+    ASSERT_FALSE(ring.push(4));
+
+    ASSERT_TRUE(ring.pop(value));
+    ASSERT_EQ(0, value);
+
+    // a popped cell can be reused
+    ASSERT_TRUE(ring.push(4));
+
+    for(int i = 1; i <= 4; i++) {
+        ASSERT_TRUE(ring.pop(value));
+        ASSERT_EQ(i, value);
+    }
+
+    ASSERT_FALSE(ring.pop(value));
+}
+
+TEST(MpscRingTest, ManyProducers) {
+    const size_t num_producers = 4;
+    const size_t num_values = 10000;
+
+    mpsc_ring_t<size_t> ring(1024);
+    std::vector<std::thread> producers;
+
+    for(size_t p = 0; p < num_producers; p++) {
+        producers.emplace_back([&ring, p]() {
+            for(size_t i = 0; i < num_values; i++) {
+                while(!ring.push(p * num_values + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // values of each producer arrive in the order they were pushed
+    std::vector<size_t> next(num_producers, 0);
+    size_t num_popped = 0;
+    size_t value;
+
+    while(num_popped < num_producers * num_values) {
+        if(!ring.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const size_t p = value / num_values;
+        ASSERT_EQ(next[p], value % num_values);
+        next[p]++;
+        num_popped++;
+    }
+
+    for(auto& producer: producers) {
+        producer.join();
+    }
+
+    ASSERT_FALSE(ring.pop(value));
+}
+
+static std::vector<std::string> read_lines(const std::string& path) {
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    std::string line;
+
+    while(std::getline(in, line)) {
+        lines.push_back(line);
+    }
+
+    return lines;
+}
+
+TEST(SlowQueryLogTest, ThresholdAndSampling) {
+    SlowQueryLog slow_log;
+    bool is_slow = true;
+
+    // not enabled until initialized with a threshold or sample ratio
+    ASSERT_FALSE(slow_log.should_log(1000, is_slow));
+    ASSERT_TRUE(slow_log.init("/tmp/typesense_test/unused-slow-searches.log", -1, 0));
+    ASSERT_FALSE(slow_log.is_enabled());
+
+    const std::string path = "/tmp/typesense_slow_searches_test.log";
+    std::remove(path.c_str());
+
+    ASSERT_TRUE(slow_log.init(path, 100, 0));
+    ASSERT_TRUE(slow_log.is_enabled());
+
+    ASSERT_TRUE(slow_log.should_log(100, is_slow));
+    ASSERT_TRUE(is_slow);
+    ASSERT_FALSE(slow_log.should_log(99, is_slow));
+    ASSERT_FALSE(is_slow);
+
+    slow_log.log(R"({"collection": "coll1"})");
+    slow_log.log(R"({"collection": "coll2"})");
+    slow_log.dispose();
+
+    ASSERT_FALSE(slow_log.is_enabled());
+
+    std::vector<std::string> lines = read_lines(path);
+    ASSERT_EQ(2, lines.size());
+    ASSERT_EQ(R"({"collection": "coll1"})", lines[0]);
+    ASSERT_EQ(R"({"collection": "coll2"})", lines[1]);
+    ASSERT_EQ(0, slow_log.get_num_dropped());
+
+    // with a ratio of 1, every search is sampled without being slow
+    SlowQueryLog sampled_log;
+    ASSERT_TRUE(sampled_log.init(path, -1, 1));
+    ASSERT_TRUE(sampled_log.should_log(0, is_slow));
+    ASSERT_FALSE(is_slow);
+    sampled_log.dispose();
+
+    std::remove(path.c_str());
+}
+
+TEST(SlowQueryLogTest, DropsWhenFull) {
+    SlowQueryLog slow_log;
+
+    // the writer is not running, so nothing takes the entries off the ring
+    for(size_t i = 0; i < SlowQueryLog::CAPACITY + 10; i++) {
+        slow_log.log(std::to_string(i));
+    }
+
+    ASSERT_EQ(10, slow_log.get_num_dropped());
+}
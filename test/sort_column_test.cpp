@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "sort_column.h"
+
+TEST(SortColumnTest, EmplaceGetErase) {
+    sort_column_t column;
+    int64_t value = 0;
+
+    ASSERT_FALSE(column.get(0, value));
+    ASSERT_EQ(0, column.size());
+
+    ASSERT_TRUE(column.emplace(0, 10));
+    ASSERT_TRUE(column.emplace(1, INT64_MIN + 1));
+    ASSERT_TRUE(column.emplace(200, -5));
+
+    // an existing value is kept
+    ASSERT_FALSE(column.emplace(200, 7));
+    ASSERT_EQ(3, column.size());
+
+    ASSERT_TRUE(column.get(200, value));
+    ASSERT_EQ(-5, value);
+    ASSERT_EQ(INT64_MIN + 1, column.at(1));
+
+    // ids in between and beyond the last one have no value
+    ASSERT_FALSE(column.contains(2));
+    ASSERT_FALSE(column.contains(199));
+    ASSERT_FALSE(column.get(201, value));
+    ASSERT_THROW(column.at(100), std::out_of_range);
+
+    column.erase(200);
+    ASSERT_FALSE(column.contains(200));
+    ASSERT_EQ(2, column.size());
+
+    ASSERT_TRUE(column.emplace(200, 7));
+    ASSERT_EQ(7, column.at(200));
+
+    column.erase(0);
+    column.erase(1);
+    column.erase(200);
+    column.erase(300);
+    ASSERT_EQ(0, column.size());
+    ASSERT_FALSE(column.get(0, value));
+}
+
+TEST(SortColumnTest, GetBatch) {
+    sort_column_t column;
+    std::vector<uint32_t> ids = {0, 3, 64, 65, 1000};
+    std::vector<int64_t> values(ids.size());
+
+    column.get_batch(ids.data(), ids.size(), INT64_MIN, values.data());
+    ASSERT_EQ(std::vector<int64_t>(ids.size(), INT64_MIN), values);
+
+    column.emplace(3, 30);
+    column.emplace(65, -65);
+    column.emplace(70, 70);
+
+    column.get_batch(ids.data(), ids.size(), INT64_MIN, values.data());
+    ASSERT_EQ(std::vector<int64_t>({INT64_MIN, 30, INT64_MIN, -65, INT64_MIN}), values);
+}
+
+TEST(SortColumnTest, CountRanges) {
+    sort_column_t column;
+    std::vector<uint32_t> ids;
+
+    for(uint32_t id = 0; id < 1000; id++) {
+        // every tenth document has no value
+        if(id % 10 != 0) {
+            column.emplace(id, int64_t(id) - 500);
+        }
+        ids.push_back(id);
+    }
+
+    // [.., -1], [0, 99], [50, 149] and [900, ..]
+    std::vector<int64_t> range_mins = {INT64_MIN + 1, 0, 50, 900};
+    std::vector<int64_t> range_maxs = {-1, 99, 149, INT64_MAX};
+    std::vector<uint32_t> counts(range_mins.size(), 0);
+
+    column.count_ranges(ids.data(), ids.size(), range_mins.data(), range_maxs.data(), range_mins.size(),
+                        counts.data());
+    ASSERT_EQ(std::vector<uint32_t>({450, 90, 90, 0}), counts);
+
+    // counts add up across calls
+    column.count_ranges(ids.data() + 500, 100, range_mins.data(), range_maxs.data(), range_mins.size(),
+                        counts.data());
+    ASSERT_EQ(std::vector<uint32_t>({450, 180, 135, 0}), counts);
+}
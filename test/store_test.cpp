@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <vector>
+#include <fstream>
 #include <store.h>
 #include <string_utils.h>
 
@@ -165,4 +166,261 @@ TEST(StoreTest, Contains) {
     ASSERT_EQ(true, primary_store.contains("foo4"));
     ASSERT_EQ(false, primary_store.contains("foo"));
     ASSERT_EQ(false, primary_store.contains("foo5"));
-}
\ No newline at end of file
+}
+TEST(StoreTest, MultiGet) {
+    std::string primary_store_path = "/tmp/typesense_test/primary_store_test";
+    LOG(INFO) << "Truncating and creating: " << primary_store_path;
+    system(("rm -rf "+primary_store_path+" && mkdir -p "+primary_store_path).c_str());
+
+    Store primary_store(primary_store_path, 0, 0, true);  // disable WAL
+    primary_store.insert("foo1", "bar1");
+    primary_store.insert("foo2", "bar2");
+    primary_store.flush();
+    primary_store.insert("foo3", "bar3");
+
+    std::vector<std::string> values;
+    std::vector<StoreStatus> statuses;
+    primary_store.multi_get({"foo3", "foo", "foo1", "foo2"}, values, statuses);
+
+    ASSERT_EQ(4, statuses.size());
+    ASSERT_EQ(StoreStatus::FOUND, statuses[0]);
+    ASSERT_EQ("bar3", values[0]);
+    ASSERT_EQ(StoreStatus::NOT_FOUND, statuses[1]);
+    ASSERT_EQ(StoreStatus::FOUND, statuses[2]);
+    ASSERT_EQ("bar1", values[2]);
+    ASSERT_EQ(StoreStatus::FOUND, statuses[3]);
+    ASSERT_EQ("bar2", values[3]);
+}
+
+TEST(StoreTest, MergePatchAndIncrement) {
+    std::string primary_store_path = "/tmp/typesense_test/primary_store_test";
+    LOG(INFO) << "Truncating and creating: " << primary_store_path;
+    system(("rm -rf "+primary_store_path+" && mkdir -p "+primary_store_path).c_str());
+
+    Store primary_store(primary_store_path, 0, 0, true);  // disable WAL
+    primary_store.insert("doc1", R"({"id":"1","title":"Foo","points":10})");
+
+    ASSERT_TRUE(primary_store.merge_patch("doc1", R"({"points":20})"));
+    primary_store.flush();
+    ASSERT_TRUE(primary_store.merge_patch("doc1", R"({"title":null,"tags":["a"]})"));
+
+    std::string value;
+    ASSERT_EQ(StoreStatus::FOUND, primary_store.get("doc1", value));
+    ASSERT_EQ(nlohmann::json::parse(R"({"id":"1","points":20,"tags":["a"]})"), nlohmann::json::parse(value));
+
+    // a patch of a missing key makes up a new document
+    ASSERT_TRUE(primary_store.merge_patch("doc2", R"({"id":"2"})"));
+    ASSERT_EQ(StoreStatus::FOUND, primary_store.get("doc2", value));
+    ASSERT_EQ(R"({"id":"2"})", value);
+
+    // counters are still merged as increments
+    primary_store.increment("$counter", 5);
+    primary_store.flush();
+    primary_store.increment("$counter", 7);
+    ASSERT_EQ(StoreStatus::FOUND, primary_store.get("$counter", value));
+    ASSERT_EQ(12, StringUtils::deserialize_uint32_t(value));
+}
+
+TEST(StoreTest, ColumnFamilies) {
+    ASSERT_EQ(Store::DOCUMENTS_CF, Store::get_column_family("12_$SI_"));
+    ASSERT_EQ(Store::DOC_IDS_CF, Store::get_column_family("12_$DI_doc1"));
+    ASSERT_EQ(Store::REQUEST_LOG_CF, Store::get_column_family("$RL_"));
+    ASSERT_EQ(Store::DEFAULT_CF, Store::get_column_family("$CM_books"));
+    ASSERT_EQ(Store::DEFAULT_CF, Store::get_column_family("12_"));
+    ASSERT_EQ(Store::DEFAULT_CF, Store::get_column_family("_$SI_"));
+
+    std::string store_path = "/tmp/typesense_test/cf_store_test";
+    LOG(INFO) << "Truncating and creating: " << store_path;
+    system(("rm -rf "+store_path+" && mkdir -p "+store_path).c_str());
+
+    // keys written by a store without the column families are moved to theirs on open
+    rocksdb::DB* plain_db;
+    rocksdb::Options plain_options;
+    plain_options.create_if_missing = true;
+    ASSERT_TRUE(rocksdb::DB::Open(plain_options, store_path, &plain_db).ok());
+    plain_db->Put(rocksdb::WriteOptions(), "1_$SI_a", "doc_a");
+    plain_db->Put(rocksdb::WriteOptions(), "1_$DI_a", "seq_a");
+    plain_db->Put(rocksdb::WriteOptions(), "$CM_books", "meta");
+    delete plain_db;
+
+    Store store(store_path, 24*60*60, 1024, false);
+    std::string value;
+    ASSERT_EQ(StoreStatus::FOUND, store.get("1_$SI_a", value));
+    ASSERT_EQ("doc_a", value);
+    ASSERT_EQ(StoreStatus::FOUND, store.get("$CM_books", value));
+
+    // writes of a batch land in the families of their keys
+    rocksdb::WriteBatch batch;
+    batch.Put("1_$SI_b", "doc_b");
+    batch.Put("1_$DI_b", "seq_b");
+    batch.Put("$RL_1", "request");
+    batch.Delete("1_$DI_a");
+    ASSERT_TRUE(store.batch_write(batch));
+
+    ASSERT_FALSE(store.contains("1_$DI_a"));
+    ASSERT_TRUE(store.contains("1_$DI_b"));
+
+    auto count_keys = [&store](Store::column_family_t column_family) {
+        size_t num_keys = 0;
+        std::unique_ptr<rocksdb::Iterator> it(store.get_iterator(column_family));
+        for(it->SeekToFirst(); it->Valid(); it->Next()) {
+            num_keys++;
+        }
+        return num_keys;
+    };
+
+    ASSERT_EQ(1, count_keys(Store::DEFAULT_CF));
+    ASSERT_EQ(2, count_keys(Store::DOCUMENTS_CF));
+    ASSERT_EQ(1, count_keys(Store::DOC_IDS_CF));
+    ASSERT_EQ(1, count_keys(Store::REQUEST_LOG_CF));
+
+    std::vector<std::string> values;
+    store.scan_fill("1_$SI_", values);
+    ASSERT_EQ(std::vector<std::string>({"doc_a", "doc_b"}), values);
+
+    // a collection's keys go from every family at once
+    store.insert("10_$SI_a", "doc_10_a");
+    ASSERT_TRUE(store.delete_prefix("1_").ok());
+    ASSERT_EQ(0, count_keys(Store::DOC_IDS_CF));
+    ASSERT_EQ(1, count_keys(Store::DOCUMENTS_CF));
+    ASSERT_EQ(StoreStatus::FOUND, store.get("10_$SI_a", value));
+    ASSERT_EQ(1, count_keys(Store::REQUEST_LOG_CF));
+
+    // the families are found again on reopening
+    store.close();
+    Store reopened_store(store_path, 24*60*60, 1024, false);
+    ASSERT_EQ(StoreStatus::FOUND, reopened_store.get("10_$SI_a", value));
+    ASSERT_EQ(StoreStatus::FOUND, reopened_store.get("$RL_1", value));
+}
+
+TEST(StoreTest, TuningOptions) {
+    store_options_t store_options;
+    ASSERT_TRUE(store_options.set_compression("none,none,lz4,lz4,zstd").ok());
+    ASSERT_EQ(rocksdb::CompressionType::kNoCompression, store_options.compression);
+    ASSERT_EQ(5, store_options.compression_per_level.size());
+    ASSERT_EQ(rocksdb::CompressionType::kZSTD, store_options.compression_per_level[4]);
+
+    ASSERT_TRUE(store_options.set_compression("snappy").ok());
+    ASSERT_EQ(rocksdb::CompressionType::kSnappyCompression, store_options.compression);
+    ASSERT_TRUE(store_options.compression_per_level.empty());
+
+    auto compression_op = store_options.set_compression("snappy,brotli");
+    ASSERT_FALSE(compression_op.ok());
+    ASSERT_EQ("Unknown compression `brotli`.", compression_op.error());
+
+    std::string primary_store_path = "/tmp/typesense_test/primary_store_test";
+    std::string meta_store_path = "/tmp/typesense_test/meta_store_test";
+    LOG(INFO) << "Truncating and creating: " << primary_store_path << ", " << meta_store_path;
+    system(("rm -rf "+primary_store_path+" "+meta_store_path+" && mkdir -p "+primary_store_path+" "+
+            meta_store_path).c_str());
+
+    // both stores fill the same cache
+    store_options.block_cache = rocksdb::NewLRUCache(8 * 1024 * 1024);
+    store_options.bloom_bits_per_key = 10;
+    store_options.rate_limiter.reset(rocksdb::NewGenericRateLimiter(16 * 1024 * 1024));
+
+    Store primary_store(primary_store_path, 24*60*60, 1024, false, store_options);
+    Store meta_store(meta_store_path, 24*60*60, 1024, false, store_options);
+    ASSERT_EQ(store_options.rate_limiter, primary_store.get_db_options().rate_limiter);
+
+    primary_store.insert("1_$SI_a", "doc_a");
+    primary_store.flush();
+    std::string value;
+    ASSERT_EQ(StoreStatus::FOUND, primary_store.get("1_$SI_a", value));
+    const size_t primary_usage = store_options.block_cache->GetUsage();
+    ASSERT_GT(primary_usage, 0);
+
+    meta_store.insert("$CS_foo", "bar");
+    meta_store.flush();
+    ASSERT_EQ(StoreStatus::FOUND, meta_store.get("$CS_foo", value));
+    ASSERT_GT(store_options.block_cache->GetUsage(), primary_usage);
+}
+
+TEST(StoreTest, IngestSortedTables) {
+    std::string store_path = "/tmp/typesense_test/ingest_store_test";
+    LOG(INFO) << "Truncating and creating: " << store_path;
+    system(("rm -rf "+store_path+" && mkdir -p "+store_path).c_str());
+
+    Store store(store_path);
+    store.insert("1_$SI_a", "old_doc_a");
+
+    // unsorted, spread over two column families, and with a repeated key
+    std::vector<std::pair<std::string, std::string>> kvs = {
+        {"1_$SI_c", "doc_c"}, {"1_$DI_c", "2"}, {"1_$SI_a", "doc_a"},
+        {"1_$DI_a", "0"}, {"1_$SI_b", "doc_b"}, {"1_$SI_a", "new_doc_a"},
+    };
+
+    ASSERT_TRUE(store.ingest(kvs));
+
+    std::string value;
+    ASSERT_EQ(StoreStatus::FOUND, store.get("1_$SI_a", value));
+    ASSERT_EQ("new_doc_a", value);
+    ASSERT_EQ(StoreStatus::FOUND, store.get("1_$DI_c", value));
+    ASSERT_EQ("2", value);
+
+    std::vector<std::string> docs;
+    store.scan_fill("1_$SI_", docs);
+    ASSERT_EQ(std::vector<std::string>({"new_doc_a", "doc_b", "doc_c"}), docs);
+
+    // the tables were moved into the store, not left behind in the state dir
+    ASSERT_FALSE(std::ifstream(store_path + "/ingest_0.sst").good());
+    ASSERT_FALSE(std::ifstream(store_path + "/ingest_1.sst").good());
+}
+
+TEST(StoreTest, TableFileChecksums) {
+    std::string store_path = "/tmp/typesense_test/checksum_store_test";
+    LOG(INFO) << "Truncating and creating: " << store_path;
+    system(("rm -rf "+store_path+" && mkdir -p "+store_path).c_str());
+
+    Store store(store_path);
+    ASSERT_TRUE(store.get_table_file_checksums().empty());
+
+    store.insert("1_$SI_a", "doc_a");
+    store.flush();
+
+    const auto& file_checksums = store.get_table_file_checksums();
+    ASSERT_EQ(1, file_checksums.size());
+    ASSERT_NE(std::string::npos, file_checksums.begin()->first.find(".sst"));
+
+    // unchanged files keep their checksums
+    store.insert("$CS_foo", "bar");
+    store.flush();
+
+    const auto& later_file_checksums = store.get_table_file_checksums();
+    ASSERT_EQ(2, later_file_checksums.size());
+    ASSERT_EQ(file_checksums.begin()->second, later_file_checksums.at(file_checksums.begin()->first));
+}
+
+TEST(StoreTest, Statistics) {
+    std::string store_path = "/tmp/typesense_test/stats_store_test";
+    LOG(INFO) << "Truncating and creating: " << store_path;
+    system(("rm -rf "+store_path+" && mkdir -p "+store_path).c_str());
+
+    Store store(store_path);
+
+    for(size_t i = 0; i < 10; i++) {
+        store.insert("1_$SI_" + std::to_string(i), "doc");
+    }
+
+    std::string value;
+    for(size_t i = 0; i < Store::READ_SAMPLE_INTERVAL * 2; i++) {
+        store.get("1_$SI_" + std::to_string(i % 20), value);
+    }
+
+    store_stats_t stats;
+    store.get_stats(stats);
+
+    std::map<std::string, uint64_t> tickers(stats.tickers.begin(), stats.tickers.end());
+    ASSERT_EQ(10, tickers.at("keys_written"));
+    ASSERT_EQ(Store::READ_SAMPLE_INTERVAL * 2, tickers.at("memtable_hit") + tickers.at("memtable_miss"));
+
+    auto get_histogram = std::find_if(stats.histograms.begin(), stats.histograms.end(),
+                                      [](const auto& histogram) { return histogram.first == "get"; });
+    ASSERT_NE(stats.histograms.end(), get_histogram);
+    ASSERT_EQ(Store::READ_SAMPLE_INTERVAL * 2, get_histogram->second.count);
+
+    // reads from this thread are sampled one in `READ_SAMPLE_INTERVAL`
+    ASSERT_EQ(2, stats.num_sampled_reads);
+    ASSERT_EQ(5, stats.sampled_read_nanos.size());
+    ASSERT_EQ("memtable", stats.sampled_read_nanos[0].first);
+}
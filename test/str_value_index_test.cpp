@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "str_value_index.h"
+
+TEST(StrValueIndexTest, InsertRemoveAndSearch) {
+    str_value_index_t index;
+
+    for(uint32_t id = 0; id < 100; id++) {
+        index.insert(id % 3, id);
+    }
+
+    // an array holding 2 values
+    index.insert(1, 51);
+
+    ASSERT_TRUE(index.is_usable());
+    ASSERT_EQ(3, index.size());
+    ASSERT_EQ(34, index.num_ids(0));
+    ASSERT_EQ(0, index.num_ids(7));
+
+    uint32_t* ids = nullptr;
+    size_t ids_len = 0;
+
+    // union of the values
+    index.search({1, 2, 7}, &ids, ids_len);
+    ASSERT_EQ(67, ids_len);
+    for(size_t i = 1; i < ids_len; i++) {
+        ASSERT_LT(ids[i-1], ids[i]);
+    }
+    ASSERT_TRUE(std::binary_search(ids, ids + ids_len, 51));
+    delete [] ids;
+
+    index.search({7}, &ids, ids_len);
+    ASSERT_EQ(nullptr, ids);
+    ASSERT_EQ(0, ids_len);
+
+    for(uint32_t id = 0; id < 100; id += 3) {
+        index.remove(0, id);
+    }
+
+    ASSERT_EQ(2, index.size());
+    ASSERT_EQ(0, index.num_ids(0));
+}
+
+TEST(StrValueIndexTest, DroppedBeyondMaxValues) {
+    str_value_index_t index;
+
+    for(uint32_t id = 0; id < str_value_index_t::MAX_VALUES; id++) {
+        index.insert(id, id);
+    }
+
+    ASSERT_TRUE(index.is_usable());
+    ASSERT_EQ(str_value_index_t::MAX_VALUES, index.size());
+
+    index.insert(str_value_index_t::MAX_VALUES, 0);
+
+    ASSERT_FALSE(index.is_usable());
+    ASSERT_EQ(0, index.size());
+
+    // stays dropped
+    index.insert(1, 1);
+    ASSERT_FALSE(index.is_usable());
+    ASSERT_EQ(0, index.size());
+}
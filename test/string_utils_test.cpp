@@ -275,6 +275,16 @@ TEST(StringUtilsTest, ShouldParseStringifiedList) {
     ASSERT_EQ("John Galt", strs[0]);
 }
 
+TEST(StringUtilsTest, ShouldSplitFacet) {
+    std::vector<std::string> facet_fields;
+    StringUtils::split_facet("brand, price(0..50, 50..100, 100..),rating(..3) ,", facet_fields);
+    ASSERT_EQ(std::vector<std::string>({"brand", "price(0..50, 50..100, 100..)", "rating(..3)"}), facet_fields);
+
+    facet_fields.clear();
+    StringUtils::split_facet("", facet_fields);
+    ASSERT_TRUE(facet_fields.empty());
+}
+
 TEST(StringUtilsTest, ShouldTrimCurlySpaces) {
     ASSERT_EQ("foo {bar}", StringUtils::trim_curly_spaces("foo { bar }"));
     ASSERT_EQ("foo  {bar}", StringUtils::trim_curly_spaces("foo  { bar }"));
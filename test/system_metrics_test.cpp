@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <vector>
 #include "system_metrics.h"
 
 TEST(SystemMetricsTest, ParsingNetworkStats) {
@@ -7,4 +8,32 @@ TEST(SystemMetricsTest, ParsingNetworkStats) {
     SystemMetrics::linux_get_network_data(proc_net_dev_path, received_bytes, sent_bytes);
     ASSERT_EQ(324278716, received_bytes);
     ASSERT_EQ(93933882, sent_bytes);
-}
\ No newline at end of file
+}
+TEST(SystemMetricsTest, DedicatedArenas) {
+    unsigned arena = SystemMetrics::acquire_arena();
+    ASSERT_NE(SystemMetrics::NO_ARENA, arena);
+
+    std::vector<char*> blocks;
+
+    {
+        allocator_arena_scope_t arena_scope(arena);
+        for(size_t i = 0; i < 256; i++) {
+            blocks.push_back(new char[64 * 1024]);
+        }
+    }
+
+    ASSERT_LE(16 * 1024 * 1024, SystemMetrics::get_arena_active_bytes(arena));
+
+    for(char* block: blocks) {
+        delete [] block;
+    }
+
+    SystemMetrics::release_arena(arena);
+    ASSERT_GT(1024 * 1024, SystemMetrics::get_arena_active_bytes(arena));
+
+    // released arenas are handed out again
+    ASSERT_EQ(arena, SystemMetrics::acquire_arena());
+    SystemMetrics::release_arena(arena);
+
+    ASSERT_EQ(0, SystemMetrics::get_arena_active_bytes(SystemMetrics::NO_ARENA));
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include "threadpool.h"
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+    ThreadPool pool(4);
+    std::atomic<size_t> num_run(0);
+    std::vector<std::future<size_t>> results;
+
+    for(size_t i = 0; i < 1000; i++) {
+        auto priority = (i % 2 == 0) ? task_priority_t::INTERACTIVE : task_priority_t::BACKGROUND;
+        results.push_back(pool.enqueue_priority(priority, [&num_run, i]() {
+            num_run++;
+            return i;
+        }));
+    }
+
+    for(size_t i = 0; i < results.size(); i++) {
+        ASSERT_EQ(i, results[i].get());
+    }
+
+    pool.shutdown();
+
+    ASSERT_EQ(1000, num_run.load());
+    ASSERT_EQ(500, pool.get_stats(task_priority_t::INTERACTIVE).num_dequeued);
+    ASSERT_EQ(500, pool.get_stats(task_priority_t::BACKGROUND).num_dequeued);
+    ASSERT_EQ(0, pool.get_stats(task_priority_t::INTERACTIVE).queue_depth);
+    ASSERT_EQ(0, pool.get_stats(task_priority_t::BACKGROUND).queue_depth);
+}
+
+TEST(ThreadPoolTest, InteractiveTasksRunBeforeBackgroundTasks) {
+    ThreadPool pool(1);
+
+    // keeps the only worker busy until all the other tasks are queued
+    std::promise<void> started, gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+    pool.enqueue([&started, gate_future]() {
+        started.set_value();
+        gate_future.wait();
+    });
+    started.get_future().wait();
+
+    std::mutex order_mutex;
+    std::vector<std::string> order;
+
+    auto record = [&](const std::string& name) {
+        std::unique_lock<std::mutex> lock(order_mutex);
+        order.push_back(name);
+    };
+
+    pool.enqueue_priority(task_priority_t::BACKGROUND, record, "index1");
+    pool.enqueue_priority(task_priority_t::BACKGROUND, record, "index2");
+    pool.enqueue(record, "search1");
+    pool.enqueue(record, "search2");
+
+    ASSERT_EQ(2, pool.get_stats(task_priority_t::BACKGROUND).queue_depth);
+    ASSERT_EQ(2, pool.get_stats(task_priority_t::INTERACTIVE).queue_depth);
+
+    gate.set_value();
+    pool.shutdown();
+
+    ASSERT_EQ(std::vector<std::string>({"search1", "search2", "index1", "index2"}), order);
+}
+
+TEST(ThreadPoolTest, IdleWorkersStealFromBusyWorkers) {
+    ThreadPool pool(4);
+
+    // sub-tasks enqueued from a worker land on that worker's queue while it blocks on them
+    auto parent = pool.enqueue([&pool]() {
+        std::vector<std::future<int>> children;
+
+        for(int i = 0; i < 100; i++) {
+            children.push_back(pool.enqueue([i]() { return i * 2; }));
+        }
+
+        int sum = 0;
+        for(auto& child: children) {
+            sum += child.get();
+        }
+
+        return sum;
+    });
+
+    ASSERT_EQ(9900, parent.get());
+    pool.shutdown();
+}
+
+TEST(ThreadPoolTest, PinnedWorkersRunTasks) {
+    ThreadPool pool(2);
+    ASSERT_EQ(2, pool.size());
+    ASSERT_TRUE(pool.pin_workers(0, 1));
+
+    std::vector<std::future<int>> results;
+    for(int i = 0; i < 10; i++) {
+        results.push_back(pool.enqueue([i]() { return i * 2; }));
+    }
+
+    for(int i = 0; i < 10; i++) {
+        ASSERT_EQ(i * 2, results[i].get());
+    }
+
+    pool.shutdown();
+}
+
+TEST(ThreadPoolTest, WorkersPinnedToNodesRunTasksOfTheirNode) {
+    ThreadPool pool(4);
+    ASSERT_EQ(0, pool.num_nodes());
+    ASSERT_EQ(-1, pool.get_node(7));
+
+    ASSERT_TRUE(pool.pin_workers_to_nodes({{0}, {0}}));
+    ASSERT_FALSE(pool.pin_workers_to_nodes({{0}, {0}}));
+    ASSERT_EQ(2, pool.num_nodes());
+    ASSERT_EQ(1, pool.get_node(7));
+    ASSERT_EQ(0, pool.get_node(8));
+
+    std::vector<std::future<int>> results;
+
+    for(int i = 0; i < 100; i++) {
+        numa_node_scope_t numa_scope(pool.get_node(i));
+        results.push_back(pool.enqueue([i]() { return i * 2; }));
+    }
+
+    ASSERT_EQ(-1, ThreadPool::numa_node_hint);
+
+    // tasks enqueued outside of a scope still run on any worker
+    results.push_back(pool.enqueue([]() { return 200; }));
+
+    for(int i = 0; i <= 100; i++) {
+        ASSERT_EQ(i * 2, results[i].get());
+    }
+
+    pool.shutdown();
+}
+
+TEST(ThreadPoolTest, TaskStatsByKind) {
+    ThreadPool pool(1);
+
+    std::promise<void> started, gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+    pool.enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::REQUEST, [&started, gate_future]() {
+        started.set_value();
+        gate_future.wait();
+    });
+    started.get_future().wait();
+
+    for(size_t i = 0; i < 3; i++) {
+        pool.enqueue_task(task_priority_t::INTERACTIVE, task_kind_t::SEARCH, []() {});
+    }
+
+    pool.enqueue_task(task_priority_t::BACKGROUND, task_kind_t::INDEXING, []() {});
+
+    ASSERT_EQ(1, pool.num_active());
+    ASSERT_EQ(1, pool.get_task_stats(task_kind_t::REQUEST).num_active);
+    ASSERT_EQ(3, pool.get_task_stats(task_kind_t::SEARCH).queue_depth);
+    ASSERT_EQ(1, pool.get_task_stats(task_kind_t::INDEXING).queue_depth);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    gate.set_value();
+    pool.shutdown();
+
+    ASSERT_EQ(0, pool.num_active());
+
+    const thread_pool_task_stats_t& request_stats = pool.get_task_stats(task_kind_t::REQUEST);
+    ASSERT_EQ(1, request_stats.num_finished);
+    ASSERT_LE(5000, request_stats.total_run_us);
+
+    const thread_pool_task_stats_t& search_stats = pool.get_task_stats(task_kind_t::SEARCH);
+    ASSERT_EQ(0, search_stats.queue_depth);
+    ASSERT_EQ(3, search_stats.num_started);
+    ASSERT_EQ(3, search_stats.num_finished);
+
+    // the searches waited behind the request
+    ASSERT_LE(3 * 5000, search_stats.total_wait_us);
+
+    uint64_t num_waits = 0;
+    for(uint64_t bucket_count: search_stats.wait_buckets) {
+        num_waits += bucket_count;
+    }
+
+    ASSERT_EQ(3, num_waits);
+    ASSERT_EQ(0, pool.get_task_stats(task_kind_t::OTHER).num_started);
+
+    ASSERT_EQ(0, thread_pool_task_stats_t::duration_bucket(0));
+    ASSERT_EQ(1, thread_pool_task_stats_t::duration_bucket(1));
+    ASSERT_EQ(11, thread_pool_task_stats_t::duration_bucket(1024));
+    ASSERT_EQ(thread_pool_task_stats_t::NUM_DURATION_BUCKETS - 1,
+              thread_pool_task_stats_t::duration_bucket(UINT64_MAX));
+    ASSERT_STREQ("search", ThreadPool::task_kind_name(task_kind_t::SEARCH));
+}
@@ -157,6 +157,34 @@ TEST(TokenizerTest, ShouldTokenizeTextWithCustomSpecialChars) {
     ASSERT_EQ("-more", tokens[2]);
 }
 
+TEST(TokenizerTest, ShouldTokenizeAsciiRunsAroundSymbols) {
+    const std::string text = "Foo-Bar q@Baz2 !Qux.";
+    Tokenizer tokenizer(text, true, false, "", {'@'}, {'-'});
+
+    std::vector<std::string> expected_tokens = {"foo", "bar", "q@baz2", "qux"};
+    std::vector<size_t> expected_start_indices = {0, 4, 8, 16};
+    std::vector<size_t> expected_end_indices = {2, 6, 13, text.size() - 1};
+
+    std::string token;
+    size_t token_index, start_index, end_index;
+    size_t num_tokens = 0;
+
+    while(tokenizer.next(token, token_index, start_index, end_index)) {
+        ASSERT_EQ(num_tokens, token_index);
+        ASSERT_EQ(expected_tokens[num_tokens], token);
+        ASSERT_EQ(expected_start_indices[num_tokens], start_index);
+        ASSERT_EQ(expected_end_indices[num_tokens], end_index);
+        num_tokens++;
+    }
+
+    ASSERT_EQ(4, num_tokens);
+
+    // verbatim chars when not normalized
+    std::vector<std::string> tokens;
+    Tokenizer("Foo-Bar q@Baz2", false, false, "", {'@'}, {'-'}).tokenize(tokens);
+    ASSERT_EQ(std::vector<std::string>({"Foo", "Bar", "q@Baz2"}), tokens);
+}
+
 TEST(TokenizerTest, ShouldTokenizeChineseText) {
     std::vector<std::string> tokens;
 
@@ -181,6 +209,11 @@ TEST(TokenizerTest, ShouldTokenizeChineseText) {
     ASSERT_EQ("时间", tokens[4]);
     ASSERT_EQ("而", tokens[5]);
 
+    // the transliterated value is cached by the first tokenizer, and handed to the next ones
+    std::vector<std::string> cached_tokens;
+    Tokenizer("愛並不會因時間而", false, false, "zh").tokenize(cached_tokens);
+    ASSERT_EQ(tokens, cached_tokens);
+
     // tokenize simplified
     tokens.clear();
     Tokenizer("爱并不会因时间而", false, false, "zh").tokenize(tokens);
@@ -325,3 +358,29 @@ TEST(TokenizerTest, ShouldTokenizeLocaleTextWithEnglishText) {
     ASSERT_EQ("discrete", ttokens[7]);
     ASSERT_EQ("math", ttokens[8]);
 }
+
+TEST(TokenizerTest, ShouldTokenizeAlikeWithPooledIterators) {
+    // iterators released by a tokenizer are handed to the next ones of the thread, including nested ones
+    std::vector<std::vector<std::string>> first_tokens;
+
+    for(size_t round = 0; round < 3; round++) {
+        std::vector<std::vector<std::string>> round_tokens(3);
+
+        Tokenizer outer("ลงที่นั่นโดยรถไฟ Café", true, false, "th");
+        std::string token;
+        size_t token_index;
+
+        while(outer.next(token, token_index)) {
+            round_tokens[0].push_back(token);
+            Tokenizer("Привет мир", true, false, "ru").tokenize(round_tokens[1]);
+            Tokenizer("ไปที่นั่น", true, false, "th").tokenize(round_tokens[2]);
+        }
+
+        if(round == 0) {
+            ASSERT_FALSE(round_tokens[0].empty());
+            first_tokens = round_tokens;
+        } else {
+            ASSERT_EQ(first_tokens, round_tokens);
+        }
+    }
+}
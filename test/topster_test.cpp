@@ -3,6 +3,7 @@
 #include "topster.h"
 #include "match_score.h"
 #include <fstream>
+#include <random>
 
 TEST(TopsterTest, MaxIntValues) {
     Topster topster(5);
@@ -222,23 +223,198 @@ TEST(TopsterTest, DistinctIntValues) {
 
     dist_topster.sort();
 
-    std::vector<uint64_t> distinct_ids = {4, 1, 8, 5, 9};
+    group_topster_t& groups = dist_topster.groups;
+    ASSERT_EQ(10, groups.num_groups());
 
-    for(uint32_t i = 0; i < dist_topster.size; i++) {
-        EXPECT_EQ(distinct_ids[i], dist_topster.getDistinctKeyAt(i));
+    // the top groups are picked by their best KV
+    Topster group_heads(5);
+    for(size_t group_index = 0; group_index < groups.num_groups(); group_index++) {
+        group_heads.add(groups.get_group_kvs(group_index));
+    }
+
+    group_heads.sort();
+
+    std::vector<uint64_t> distinct_ids = {4, 1, 5, 8, 9};
+    ASSERT_EQ(5, group_heads.size);
+
+    for(uint32_t i = 0; i < group_heads.size; i++) {
+        EXPECT_EQ(distinct_ids[i], group_heads.getDistinctKeyAt(i));
+
+        size_t group_index = 0;
+        ASSERT_TRUE(groups.find_group(distinct_ids[i], group_index));
+        KV* group_kvs = groups.get_group_kvs(group_index);
 
         if(distinct_ids[i] == 1) {
-            EXPECT_EQ(12, (int) dist_topster.getKV(i)->scores[dist_topster.getKV(i)->match_score_index]);
-            EXPECT_EQ(2, dist_topster.group_kv_map[dist_topster.getDistinctKeyAt(i)]->size);
-            EXPECT_EQ(12, dist_topster.group_kv_map[dist_topster.getDistinctKeyAt(i)]->getKV(0)->scores[0]);
-            EXPECT_EQ(11, dist_topster.group_kv_map[dist_topster.getDistinctKeyAt(i)]->getKV(1)->scores[0]);
+            EXPECT_EQ(12, (int) group_heads.getKV(i)->scores[group_heads.getKV(i)->match_score_index]);
+            EXPECT_EQ(2, groups.get_group_size(group_index));
+            EXPECT_EQ(12, group_kvs[0].scores[0]);
+            EXPECT_EQ(11, group_kvs[1].scores[0]);
         }
 
         if(distinct_ids[i] == 5) {
-            EXPECT_EQ(9, (int) dist_topster.getKV(i)->scores[dist_topster.getKV(i)->match_score_index]);
-            EXPECT_EQ(2, dist_topster.group_kv_map[dist_topster.getDistinctKeyAt(i)]->size);
-            EXPECT_EQ(10, dist_topster.group_kv_map[dist_topster.getDistinctKeyAt(i)]->getKV(0)->scores[0]);
-            EXPECT_EQ(9, dist_topster.group_kv_map[dist_topster.getDistinctKeyAt(i)]->getKV(1)->scores[0]);
+            // only the top 2 of the 3 KVs of the group are kept
+            EXPECT_EQ(10, (int) group_heads.getKV(i)->scores[group_heads.getKV(i)->match_score_index]);
+            EXPECT_EQ(2, groups.get_group_size(group_index));
+            EXPECT_EQ(10, group_kvs[0].scores[0]);
+            EXPECT_EQ(9, group_kvs[1].scores[0]);
+        }
+    }
+
+    size_t group_index = 0;
+    ASSERT_FALSE(groups.find_group(11, group_index));
+}
+
+TEST(TopsterTest, DuplicateKeysUnderChurn) {
+    // keys are re-added with changing scores, so that the key map sees many replacements and erasures
+    Topster topster(10);
+    std::map<uint64_t, int64_t> best_scores;
+
+    for(size_t i = 0; i < 5000; i++) {
+        const uint64_t key = (i * 7919) % 37;
+        int64_t scores[3] = {int64_t((i * 104729) % 1000), 0, 0};
+
+        KV kv(0, 0, 0, key, key, 0, scores);
+        topster.add(&kv);
+
+        best_scores[key] = std::max(best_scores.count(key) ? best_scores[key] : INT64_MIN, scores[0]);
+    }
+
+    std::vector<std::pair<int64_t, uint64_t>> expected;
+    for(const auto& key_score: best_scores) {
+        expected.emplace_back(key_score.second, key_score.first);
+    }
+
+    std::sort(expected.rbegin(), expected.rend());
+    expected.resize(10);
+
+    topster.sort();
+    ASSERT_EQ(10, topster.size);
+
+    for(uint32_t i = 0; i < topster.size; i++) {
+        EXPECT_EQ(expected[i].second, topster.getKeyAt(i));
+        EXPECT_EQ(expected[i].first, topster.getKV(i)->scores[0]);
+    }
+}
+
+TEST(TopsterTest, BufferedAddMatchesAdd) {
+    Topster topster(25);
+    Topster buffered_topster(25);
+
+    for(size_t i = 0; i < 1000; i++) {
+        // a few keys repeat with a different score
+        const uint64_t key = (i % 10 == 0) ? i / 2 : i;
+        int64_t scores[3] = {int64_t((i * 7919) % 101), int64_t(i % 3), 0};
+
+        KV kv(0, 0, 0, key, key, 0, scores);
+        topster.add(&kv);
+
+        KV buffered_kv(0, 0, 0, key, key, 0, scores);
+        buffered_topster.add_buffered(&buffered_kv);
+
+        if(buffered_topster.get_threshold() != nullptr) {
+            // the threshold is the smallest KV held
+            for(uint32_t j = 0; j < buffered_topster.size; j++) {
+                EXPECT_FALSE(Topster::is_smaller(buffered_topster.getKV(j), buffered_topster.get_threshold()));
+            }
+        }
+    }
+
+    topster.sort();
+    buffered_topster.sort();
+
+    ASSERT_EQ(topster.size, buffered_topster.size);
+    ASSERT_TRUE(buffered_topster.buffer.empty());
+
+    for(uint32_t i = 0; i < topster.size; i++) {
+        EXPECT_EQ(topster.getKeyAt(i), buffered_topster.getKeyAt(i));
+        EXPECT_EQ(topster.getKV(i)->scores[0], buffered_topster.getKV(i)->scores[0]);
+        EXPECT_EQ(topster.getKV(i)->scores[1], buffered_topster.getKV(i)->scores[1]);
+    }
+
+    // not yet full
+    Topster small_topster(5);
+    ASSERT_EQ(nullptr, small_topster.get_threshold());
+}
+
+TEST(TopsterTest, SearchAfterCursor) {
+    Topster topster(3);
+
+    KV cursor;
+    cursor.key = 50;
+    cursor.scores[0] = 10;
+    topster.set_search_after(&cursor);
+
+    for(size_t i = 0; i < 100; i++) {
+        int64_t scores[3] = {int64_t(i % 20), 0, 0};
+        KV kv(0, 0, 0, i, i, 0, scores);
+        topster.add(&kv);
+    }
+
+    // only the KVs smaller than (10, key 50) get in: (10, 30), (10, 10) and (9, 89)
+    topster.sort();
+    ASSERT_EQ(3, topster.size);
+    EXPECT_EQ(30, topster.getKeyAt(0));
+    EXPECT_EQ(10, topster.getKeyAt(1));
+    EXPECT_EQ(89, topster.getKeyAt(2));
+
+    // the cursor is handed down to topsters that aggregate into this one
+    Topster thread_topster(3);
+    thread_topster.set_search_after(topster.get_search_after());
+    ASSERT_NE(nullptr, thread_topster.get_search_after());
+
+    int64_t scores[3] = {10, 0, 0};
+    KV kv(0, 0, 0, 70, 70, 0, scores);
+    ASSERT_FALSE(thread_topster.add_buffered(&kv));
+}
+
+TEST(TopsterTest, SingleKVGroupsBeyondPageAreLetGo) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int64_t> score_dist(0, 100000);
+
+    // every group gets a few KVs, some of which come after the group was let go
+    const size_t num_groups = 20000;
+    std::vector<KV> kvs;
+    for(size_t round = 0; round < 3; round++) {
+        for(uint64_t group = 0; group < num_groups; group++) {
+            int64_t scores[3] = {score_dist(rng), 0, 0};
+            kvs.emplace_back(0, 0, 0, group * 3 + round, group, 0, scores);
         }
     }
-}
\ No newline at end of file
+
+    std::shuffle(kvs.begin(), kvs.end(), rng);
+
+    Topster all_groups(50, 1);
+    Topster page_groups(50, 1);
+    page_groups.groups.set_max_groups(50);
+
+    for(auto& kv: kvs) {
+        all_groups.add(&kv);
+        page_groups.add(&kv);
+    }
+
+    ASSERT_EQ(num_groups, all_groups.groups.num_groups());
+    ASSERT_GT(4 * group_topster_t::MIN_PRUNED_GROUPS, page_groups.groups.num_groups());
+
+    auto top_groups = [](Topster& topster) {
+        Topster group_heads(topster.MAX_SIZE);
+        for(size_t group_index = 0; group_index < topster.groups.num_groups(); group_index++) {
+            group_heads.add(topster.groups.get_group_kvs(group_index));
+        }
+
+        group_heads.sort();
+
+        std::vector<std::pair<uint64_t, uint64_t>> group_keys;
+        for(uint32_t i = 0; i < group_heads.size; i++) {
+            group_keys.emplace_back(group_heads.getDistinctKeyAt(i), group_heads.getKeyAt(i));
+        }
+
+        return group_keys;
+    };
+
+    ASSERT_EQ(top_groups(all_groups), top_groups(page_groups));
+
+    // groups of more than a single KV are all kept
+    Topster multi_kv_groups(50, 2);
+    multi_kv_groups.groups.set_max_groups(50);
+    ASSERT_EQ(0, multi_kv_groups.groups.get_max_groups());
+}
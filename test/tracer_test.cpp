@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "tracer.h"
+
+TEST(TracerTest, ParseAndFormatTraceparent) {
+    trace_context_t context;
+
+    const std::string traceparent = "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01";
+    ASSERT_TRUE(trace_context_t::parse_traceparent(traceparent, context));
+    ASSERT_EQ(0x4bf92f3577b34da6ULL, context.trace_id_high);
+    ASSERT_EQ(0xa3ce929d0e0e4736ULL, context.trace_id_low);
+    ASSERT_EQ(0x00f067aa0ba902b7ULL, context.span_id);
+    ASSERT_TRUE(context.sampled);
+    ASSERT_EQ(traceparent, context.to_traceparent());
+
+    ASSERT_TRUE(trace_context_t::parse_traceparent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00",
+                                                   context));
+    ASSERT_FALSE(context.sampled);
+
+    // a later version may carry more fields
+    ASSERT_TRUE(trace_context_t::parse_traceparent("01-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-abc",
+                                                   context));
+
+    const std::vector<std::string> invalid_traceparents = {
+        "",
+        "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7",
+        "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-abc",
+        "ff-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01",
+        "00-00000000000000000000000000000000-00f067aa0ba902b7-01",
+        "00-4bf92f3577b34da6a3ce929d0e0e4736-0000000000000000-01",
+        "00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01",
+        "00_4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01",
+    };
+
+    for(const auto& invalid_traceparent: invalid_traceparents) {
+        ASSERT_FALSE(trace_context_t::parse_traceparent(invalid_traceparent, context)) << invalid_traceparent;
+    }
+}
+
+TEST(TracerTest, NestedSpans) {
+    Tracer& tracer = Tracer::get_instance();
+    std::vector<span_record_t> records;
+    tracer.drain(records, Tracer::CAPACITY);
+    records.clear();
+
+    trace_context_t request_context;
+    ASSERT_TRUE(trace_context_t::parse_traceparent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01",
+                                                   request_context));
+
+    {
+        // without an active span, nothing is recorded
+        trace_span_t orphan_span("orphan");
+        ASSERT_FALSE(orphan_span.is_recording());
+    }
+
+    {
+        trace_span_t outer_span("outer", request_context);
+        ASSERT_TRUE(outer_span.is_recording());
+        outer_span.set_attribute("collection", "coll1");
+
+        {
+            trace_span_t inner_span("inner");
+            ASSERT_TRUE(inner_span.is_recording());
+            inner_span.set_attribute("keys", int64_t(3));
+        }
+
+        // spans are held by the thread until the outermost one ends
+        ASSERT_EQ(0, tracer.drain(records, Tracer::CAPACITY));
+    }
+
+    ASSERT_EQ(nullptr, active_trace);
+    ASSERT_EQ(2, tracer.drain(records, Tracer::CAPACITY));
+
+    const span_record_t& inner = records[0];
+    const span_record_t& outer = records[1];
+
+    ASSERT_EQ("inner", inner.name);
+    ASSERT_EQ("outer", outer.name);
+    ASSERT_EQ(request_context.trace_id_high, inner.trace_id_high);
+    ASSERT_EQ(request_context.trace_id_low, outer.trace_id_low);
+    ASSERT_EQ(request_context.span_id, outer.parent_span_id);
+    ASSERT_EQ(outer.span_id, inner.parent_span_id);
+    ASSERT_LE(outer.start_ns, inner.start_ns);
+    ASSERT_LE(inner.end_ns, outer.end_ns);
+
+    ASSERT_EQ(1, outer.attributes.size());
+    ASSERT_EQ("collection", outer.attributes[0].first);
+    ASSERT_EQ("coll1", outer.attributes[0].second);
+    ASSERT_EQ("3", inner.attributes[0].second);
+
+    // a request that is not sampled is not traced
+    request_context.sampled = false;
+
+    {
+        trace_span_t outer_span("outer", request_context);
+        ASSERT_FALSE(outer_span.is_recording());
+        trace_span_t inner_span("inner");
+        ASSERT_FALSE(inner_span.is_recording());
+    }
+
+    records.clear();
+    ASSERT_EQ(0, tracer.drain(records, Tracer::CAPACITY));
+}
+
+TEST(TracerTest, ThreadSpansAreCapped) {
+    Tracer& tracer = Tracer::get_instance();
+    std::vector<span_record_t> records;
+    tracer.drain(records, Tracer::CAPACITY);
+    records.clear();
+
+    trace_context_t request_context;
+    trace_context_t::parse_traceparent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01", request_context);
+
+    {
+        trace_span_t outer_span("outer", request_context);
+
+        for(size_t i = 0; i < Tracer::MAX_THREAD_SPANS + 10; i++) {
+            trace_span_t inner_span("inner");
+        }
+    }
+
+    ASSERT_EQ(Tracer::MAX_THREAD_SPANS, tracer.drain(records, Tracer::CAPACITY));
+}
+
+TEST(TracerTest, StartTraceAndExport) {
+    Tracer tracer;
+
+    // not enabled until initialized
+    trace_context_t context = tracer.start_trace("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01");
+    ASSERT_FALSE(context.sampled);
+    ASSERT_FALSE(context.is_valid());
+
+    std::mutex bodies_mutex;
+    std::vector<std::string> bodies;
+
+    tracer.init(0, [&bodies, &bodies_mutex](const std::string& body) {
+        std::unique_lock lk(bodies_mutex);
+        bodies.push_back(body);
+        return true;
+    });
+
+    // continues the trace of the header, under a span of its own
+    context = tracer.start_trace("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01");
+    ASSERT_TRUE(context.sampled);
+    ASSERT_EQ(0x4bf92f3577b34da6ULL, context.trace_id_high);
+    ASSERT_EQ(0x00f067aa0ba902b7ULL, context.parent_span_id);
+    ASSERT_NE(context.parent_span_id, context.span_id);
+
+    // starts a trace of its own at a ratio of 0, which is not sampled
+    context = tracer.start_trace("");
+    ASSERT_TRUE(context.is_valid());
+    ASSERT_FALSE(context.sampled);
+    ASSERT_EQ(0, context.parent_span_id);
+
+    span_record_t span;
+    span.trace_id_high = 1;
+    span.trace_id_low = 2;
+    span.span_id = 3;
+    span.name = "GET /health";
+    span.start_ns = 100;
+    span.end_ns = 200;
+    span.is_server = true;
+    span.attributes.emplace_back("action", "health:read");
+    tracer.record(std::move(span));
+
+    tracer.dispose();
+
+    ASSERT_EQ(1, bodies.size());
+    ASSERT_EQ(1, tracer.get_num_exported());
+    ASSERT_EQ(0, tracer.get_num_dropped());
+
+    nlohmann::json otlp_json = nlohmann::json::parse(bodies[0]);
+    nlohmann::json& span_json = otlp_json["resourceSpans"][0]["scopeSpans"][0]["spans"][0];
+
+    ASSERT_EQ("typesense", otlp_json["resourceSpans"][0]["resource"]["attributes"][0]["value"]["stringValue"]);
+    ASSERT_EQ("00000000000000010000000000000002", span_json["traceId"]);
+    ASSERT_EQ("0000000000000003", span_json["spanId"]);
+    ASSERT_EQ(0, span_json.count("parentSpanId"));
+    ASSERT_EQ("GET /health", span_json["name"]);
+    ASSERT_EQ(2, span_json["kind"]);
+    ASSERT_EQ("100", span_json["startTimeUnixNano"]);
+    ASSERT_EQ("200", span_json["endTimeUnixNano"]);
+    ASSERT_EQ("action", span_json["attributes"][0]["key"]);
+    ASSERT_EQ("health:read", span_json["attributes"][0]["value"]["stringValue"]);
+}
+
+TEST(TracerTest, DropsWhenFull) {
+    Tracer tracer;
+
+    // the exporter is not running, so nothing takes the spans off the ring
+    for(size_t i = 0; i < Tracer::CAPACITY + 10; i++) {
+        tracer.record(span_record_t());
+    }
+
+    ASSERT_EQ(10, tracer.get_num_dropped());
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include "vector_index.h"
+
+static std::vector<float> random_vectors(size_t num_vectors, size_t num_dim, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> value_dist(0, 1);
+
+    std::vector<float> vectors(num_vectors * num_dim);
+    for(float& value: vectors) {
+        value = value_dist(gen);
+    }
+
+    return vectors;
+}
+
+// seq_ids of the `k` vectors closest to `query` by brute force, among the ids that pass `is_allowed`
+static std::set<uint32_t> nearest_ids(const vector_index_t& index, const float* query, size_t num_ids, size_t k,
+                                      const std::function<bool(uint32_t)>& is_allowed) {
+    std::vector<uint32_t> seq_ids;
+    for(uint32_t seq_id = 0; seq_id < num_ids; seq_id++) {
+        if(!is_allowed || is_allowed(seq_id)) {
+            seq_ids.push_back(seq_id);
+        }
+    }
+
+    std::vector<std::pair<float, uint32_t>> dist_ids;
+    index.distances(query, seq_ids.data(), seq_ids.size(), dist_ids);
+    std::sort(dist_ids.begin(), dist_ids.end());
+
+    std::set<uint32_t> ids;
+    for(size_t i = 0; i < k && i < dist_ids.size(); i++) {
+        ids.insert(dist_ids[i].second);
+    }
+
+    return ids;
+}
+
+static double recall(const vector_index_t& index, const std::vector<float>& queries, size_t num_dim, size_t num_ids,
+                     size_t k, const std::function<bool(uint32_t)>& is_allowed) {
+    const size_t num_queries = queries.size() / num_dim;
+    size_t num_found = 0, num_expected = 0;
+
+    for(size_t i = 0; i < num_queries; i++) {
+        const float* query = queries.data() + i * num_dim;
+        const std::set<uint32_t> expected_ids = nearest_ids(index, query, num_ids, k, is_allowed);
+
+        std::vector<std::pair<float, uint32_t>> results;
+        index.search(query, k, is_allowed, results);
+        EXPECT_LE(results.size(), k);
+
+        for(size_t j = 0; j < results.size(); j++) {
+            EXPECT_TRUE(!is_allowed || is_allowed(results[j].second));
+            if(j != 0) {
+                EXPECT_LE(results[j - 1].first, results[j].first);
+            }
+
+            num_found += expected_ids.count(results[j].second);
+        }
+
+        num_expected += expected_ids.size();
+    }
+
+    return double(num_found) / num_expected;
+}
+
+TEST(VectorIndexTest, DotProductsMatchScalar) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> value_dist(-1, 1);
+    std::uniform_int_distribution<int> code_dist(-127, 127);
+
+    // not a multiple of the widths of the kernels
+    for(size_t n: {1, 3, 4, 7, 8, 15, 16, 17, 33, 131, 768}) {
+        std::vector<float> a(n), b(n);
+        std::vector<int8_t> codes(n);
+
+        for(size_t i = 0; i < n; i++) {
+            a[i] = value_dist(gen);
+            b[i] = value_dist(gen);
+            codes[i] = code_dist(gen);
+        }
+
+        ASSERT_NEAR(vector_index_t::dot_product_scalar(a.data(), b.data(), n),
+                    vector_index_t::dot_product(a.data(), b.data(), n), 1e-3);
+        ASSERT_NEAR(vector_index_t::dot_product_int8_scalar(a.data(), codes.data(), n),
+                    vector_index_t::dot_product_int8(a.data(), codes.data(), n), 1e-2);
+    }
+}
+
+TEST(VectorIndexTest, SearchFindsNearestNeighbours) {
+    const size_t num_ids = 3000, num_dim = 32, k = 10;
+    const std::vector<float> vectors = random_vectors(num_ids, num_dim, 7);
+    const std::vector<float> queries = random_vectors(20, num_dim, 8);
+
+    vector_index_t index(num_dim, vector_distance_type_t::cosine);
+    for(uint32_t seq_id = 0; seq_id < num_ids; seq_id++) {
+        index.insert(seq_id, vectors.data() + seq_id * num_dim);
+    }
+
+    ASSERT_EQ(num_ids, index.size());
+    ASSERT_GE(recall(index, queries, num_dim, num_ids, k, nullptr), 0.9);
+
+    // a vector is its own nearest neighbour, at no distance
+    std::vector<std::pair<float, uint32_t>> results;
+    index.search(vectors.data() + 123 * num_dim, 1, nullptr, results);
+    ASSERT_EQ(1, results.size());
+    ASSERT_EQ(123, results[0].second);
+    ASSERT_NEAR(0, results[0].first, 1e-5);
+
+    float distance;
+    ASSERT_TRUE(index.distance(vectors.data() + 123 * num_dim, 123, distance));
+    ASSERT_NEAR(0, distance, 1e-5);
+    ASSERT_FALSE(index.distance(vectors.data() + 123 * num_dim, num_ids, distance));
+}
+
+TEST(VectorIndexTest, FilteredSearchAndRemovals) {
+    const size_t num_ids = 2000, num_dim = 16, k = 10;
+    const std::vector<float> vectors = random_vectors(num_ids, num_dim, 11);
+    const std::vector<float> queries = random_vectors(20, num_dim, 12);
+
+    vector_index_t index(num_dim, vector_distance_type_t::ip);
+    for(uint32_t seq_id = 0; seq_id < num_ids; seq_id++) {
+        index.insert(seq_id, vectors.data() + seq_id * num_dim);
+    }
+
+    auto is_even = [](uint32_t seq_id) { return seq_id % 2 == 0; };
+    ASSERT_GE(recall(index, queries, num_dim, num_ids, k, is_even), 0.9);
+
+    // removed ids are never found, while the ones left still are
+    for(uint32_t seq_id = 0; seq_id < num_ids; seq_id += 3) {
+        index.remove(seq_id);
+    }
+
+    ASSERT_EQ(num_ids - (num_ids + 2) / 3, index.size());
+
+    std::vector<std::pair<float, uint32_t>> results;
+    for(size_t i = 0; i < 20; i++) {
+        index.search(queries.data() + i * num_dim, k, nullptr, results);
+        ASSERT_EQ(k, results.size());
+
+        for(const auto& dist_id: results) {
+            ASSERT_NE(0, dist_id.second % 3);
+        }
+    }
+
+    auto is_left = [](uint32_t seq_id) { return seq_id % 3 != 0; };
+    ASSERT_GE(recall(index, queries, num_dim, num_ids, k, is_left), 0.9);
+
+    // enough removals rebuild the graph off the vectors left
+    for(uint32_t seq_id = 0; seq_id < num_ids; seq_id++) {
+        if(seq_id % 5 != 0) {
+            index.remove(seq_id);
+        }
+    }
+
+    auto is_kept = [](uint32_t seq_id) { return seq_id % 3 != 0 && seq_id % 5 == 0; };
+    ASSERT_GE(recall(index, queries, num_dim, num_ids, k, is_kept), 0.9);
+
+    // a vector inserted again replaces the one before it
+    index.insert(5, vectors.data() + 7 * num_dim);
+    index.search(vectors.data() + 7 * num_dim, 1, nullptr, results);
+    ASSERT_EQ(1, results.size());
+    ASSERT_EQ(5, results[0].second);
+}
+
+TEST(VectorIndexTest, QuantizedSearch) {
+    const size_t num_ids = 2000, num_dim = 64, k = 10;
+    const std::vector<float> vectors = random_vectors(num_ids, num_dim, 21);
+    const std::vector<float> queries = random_vectors(20, num_dim, 22);
+
+    vector_index_t index(num_dim, vector_distance_type_t::cosine, true);
+    vector_index_t exact_index(num_dim, vector_distance_type_t::cosine);
+
+    for(uint32_t seq_id = 0; seq_id < num_ids; seq_id++) {
+        index.insert(seq_id, vectors.data() + seq_id * num_dim);
+        exact_index.insert(seq_id, vectors.data() + seq_id * num_dim);
+    }
+
+    ASSERT_GE(recall(index, queries, num_dim, num_ids, k, nullptr), 0.9);
+
+    // quantized distances stay close to the exact ones
+    for(uint32_t seq_id = 0; seq_id < num_ids; seq_id += 50) {
+        float distance, exact_distance;
+        ASSERT_TRUE(index.distance(queries.data(), seq_id, distance));
+        ASSERT_TRUE(exact_index.distance(queries.data(), seq_id, exact_distance));
+        ASSERT_NEAR(exact_distance, distance, 0.02);
+    }
+}